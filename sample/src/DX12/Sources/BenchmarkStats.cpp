@@ -0,0 +1,217 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "BenchmarkStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+
+double BenchmarkPercentile(std::vector<double> const &sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    double rank  = std::min(std::max(p, 0.0), 100.0) / 100.0 * double(sorted.size() - 1);
+    size_t lower = (size_t)rank;
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - double(lower));
+}
+
+BenchmarkSummary SummarizeBenchmarkSeries(std::vector<double> const &samples) {
+    BenchmarkSummary summary;
+    summary.count = samples.size();
+    if (samples.empty()) return summary;
+
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    summary.min = sorted.front();
+    summary.max = sorted.back();
+    summary.p50 = BenchmarkPercentile(sorted, 50.0);
+    summary.p95 = BenchmarkPercentile(sorted, 95.0);
+    summary.p99 = BenchmarkPercentile(sorted, 99.0);
+
+    double sum = 0.0;
+    for (double x : samples) sum += x;
+    summary.mean = sum / double(samples.size());
+
+    double sq = 0.0;
+    for (double x : samples) sq += (x - summary.mean) * (x - summary.mean);
+    summary.variance = samples.size() > 1 ? sq / double(samples.size() - 1) : 0.0;
+
+    if (samples.size() > 2) {
+        double deltaMean = (samples.back() - samples.front()) / double(samples.size() - 1);
+        double deltaSq   = 0.0;
+        for (size_t i = 1; i < samples.size(); i++) {
+            double d = samples[i] - samples[i - 1] - deltaMean;
+            deltaSq += d * d;
+        }
+        summary.frameToFrameVariance = deltaSq / double(samples.size() - 2);
+    }
+    return summary;
+}
+
+MannWhitneyResult MannWhitneyUTest(std::vector<double> const &a, std::vector<double> const &b) {
+    MannWhitneyResult result;
+    if (a.empty() || b.empty()) return result;
+
+    struct Sample {
+        double value;
+        bool   first;
+    };
+    std::vector<Sample> all;
+    all.reserve(a.size() + b.size());
+    for (double x : a) all.push_back({x, true});
+    for (double x : b) all.push_back({x, false});
+    std::sort(all.begin(), all.end(), [](Sample const &l, Sample const &r) { return l.value < r.value; });
+
+    // Average ranks over ties, accumulate the tie correction term.
+    double rankSumA = 0.0;
+    double ties     = 0.0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].value == all[i].value) j++;
+        double rank = 0.5 * double(i + 1 + j);
+        for (size_t k = i; k < j; k++)
+            if (all[k].first) rankSumA += rank;
+        double t = double(j - i);
+        ties += t * t * t - t;
+        i = j;
+    }
+
+    double n1 = double(a.size());
+    double n2 = double(b.size());
+    double n  = n1 + n2;
+    result.u  = rankSumA - n1 * (n1 + 1.0) * 0.5;
+
+    double mean  = n1 * n2 * 0.5;
+    double sigma = std::sqrt(n1 * n2 / 12.0 * ((n + 1.0) - ties / (n * (n - 1.0))));
+    if (sigma <= 0.0) return result;
+    double delta  = result.u - mean;
+    double cc     = delta > 0.0 ? -0.5 : delta < 0.0 ? 0.5 : 0.0;
+    result.z      = (delta + cc) / sigma;
+    result.pValue = std::erfc(std::fabs(result.z) / std::sqrt(2.0));
+    return result;
+}
+
+void BenchmarkLog::SetColumns(std::vector<std::string> const &columns) {
+    m_columns = columns;
+    m_series.assign(columns.size(), {});
+}
+
+void BenchmarkLog::AddFrame(std::vector<double> const &values) {
+    for (size_t i = 0; i < m_series.size(); i++) m_series[i].push_back(i < values.size() ? values[i] : 0.0);
+}
+
+int BenchmarkLog::FindColumn(std::string const &name) const {
+    for (size_t i = 0; i < m_columns.size(); i++)
+        if (m_columns[i] == name) return (int)i;
+    return -1;
+}
+
+void BenchmarkLog::WriteCsvHeader(std::ostream &out) const {
+    out << "# schema_version=" << HSR_BENCHMARK_SCHEMA_VERSION << "\n";
+    for (auto const &item : m_metadata) out << "# " << item.first << "=" << item.second << "\n";
+    for (size_t i = 0; i < m_columns.size(); i++) out << (i ? "," : "") << m_columns[i];
+    out << "\n";
+}
+
+void BenchmarkLog::WriteCsvFrame(std::ostream &out, size_t frame) const {
+    std::ostringstream ss;
+    ss.imbue(std::locale::classic());
+    ss << std::setprecision(9);
+    for (size_t i = 0; i < m_series.size(); i++) ss << (i ? "," : "") << m_series[i][frame];
+    out << ss.str() << "\n";
+}
+
+static std::string JsonEscape(std::string const &str) {
+    std::string escaped;
+    for (char c : str) {
+        if (c == '"' || c == '\\')
+            escaped += std::string("\\") + c;
+        else if ((unsigned char)c < 0x20)
+            escaped += ' ';
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+void BenchmarkLog::WriteSummaryJson(std::ostream &out) const {
+    std::ostringstream ss;
+    ss.imbue(std::locale::classic());
+    ss << std::setprecision(9);
+    ss << "{\n";
+    ss << "    \"schema_version\": " << HSR_BENCHMARK_SCHEMA_VERSION << ",\n";
+    ss << "    \"frames\": " << GetFrameCount() << ",\n";
+    ss << "    \"metadata\": {";
+    bool first = true;
+    for (auto const &item : m_metadata) {
+        ss << (first ? "\n" : ",\n") << "        \"" << JsonEscape(item.first) << "\": \"" << JsonEscape(item.second) << "\"";
+        first = false;
+    }
+    ss << "\n    },\n";
+    ss << "    \"columns\": {";
+    for (size_t i = 0; i < m_columns.size(); i++) {
+        BenchmarkSummary s = SummarizeBenchmarkSeries(m_series[i]);
+        ss << (i ? ",\n" : "\n") << "        \"" << JsonEscape(m_columns[i]) << "\": {";
+        ss << "\"mean\": " << s.mean << ", \"min\": " << s.min << ", \"p50\": " << s.p50 << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << ", \"max\": " << s.max;
+        ss << ", \"variance\": " << s.variance << ", \"frame_to_frame_variance\": " << s.frameToFrameVariance << "}";
+    }
+    ss << "\n    }\n}\n";
+    out << ss.str();
+}
+
+bool BenchmarkLog::ReadCsv(std::istream &in, BenchmarkLog &log) {
+    log = BenchmarkLog();
+    std::string line;
+    bool        header = false;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        if (line[0] == '#') {
+            size_t eq = line.find('=');
+            if (eq == std::string::npos) continue;
+            size_t begin = line.find_first_not_of(" ", 1);
+            log.SetMetadata(line.substr(begin, eq - begin), line.substr(eq + 1));
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::stringstream        ss(line);
+        std::string              field;
+        while (std::getline(ss, field, ',')) fields.push_back(field);
+        if (!header) {
+            log.SetColumns(fields);
+            header = true;
+            continue;
+        }
+        std::vector<double> values;
+        for (auto const &f : fields) {
+            std::istringstream number(f);
+            number.imbue(std::locale::classic());
+            double value = 0.0;
+            number >> value;
+            values.push_back(value);
+        }
+        log.AddFrame(values);
+    }
+    return header && log.GetMetadata().count("schema_version");
+}
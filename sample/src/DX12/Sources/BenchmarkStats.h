@@ -0,0 +1,96 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+// Bump when the columns or the meaning of the frame log change.
+#define HSR_BENCHMARK_SCHEMA_VERSION 2
+
+/**
+        Distribution of one benchmark column over a run.
+*/
+struct BenchmarkSummary {
+    size_t count = 0;
+    double mean  = 0.0;
+    double min   = 0.0;
+    double p50   = 0.0;
+    double p95   = 0.0;
+    double p99   = 0.0;
+    double max   = 0.0;
+    // Variance of the samples around the mean.
+    double variance = 0.0;
+    // Variance of the differences between consecutive frames, sensitive to stutter rather than to slow drift.
+    double frameToFrameVariance = 0.0;
+};
+
+// Linearly interpolated percentile, p in [0, 100]. The samples must be sorted.
+double           BenchmarkPercentile(std::vector<double> const &sorted, double p);
+BenchmarkSummary SummarizeBenchmarkSeries(std::vector<double> const &samples);
+
+/**
+        Two sided Mann-Whitney U test with the normal approximation, tie correction and continuity correction.
+        It makes no assumption on the shape of the distributions, which frame times rarely follow.
+*/
+struct MannWhitneyResult {
+    double u      = 0.0; // U statistic of the first sample.
+    double z      = 0.0; // Positive when the first sample tends to be larger.
+    double pValue = 1.0;
+};
+MannWhitneyResult MannWhitneyUTest(std::vector<double> const &a, std::vector<double> const &b);
+
+/**
+        Per frame benchmark log.
+
+        The frame log is a CSV file: "# key=value" metadata lines, one header line with the column names and then one
+        comma separated line per frame, numbers use '.' as the decimal separator. The summary is a JSON document with
+        the metadata and a BenchmarkSummary per column.
+*/
+class BenchmarkLog {
+public:
+    void SetMetadata(std::string const &key, std::string const &value) { m_metadata[key] = value; }
+    void SetColumns(std::vector<std::string> const &columns);
+    void AddFrame(std::vector<double> const &values);
+
+    std::map<std::string, std::string> const &GetMetadata() const { return m_metadata; }
+    std::vector<std::string> const &          GetColumns() const { return m_columns; }
+    std::vector<double> const &               GetSeries(size_t column) const { return m_series[column]; }
+    // Returns -1 if there is no such column.
+    int    FindColumn(std::string const &name) const;
+    size_t GetFrameCount() const { return m_series.empty() ? 0 : m_series[0].size(); }
+
+    void WriteCsvHeader(std::ostream &out) const;
+    void WriteCsvFrame(std::ostream &out, size_t frame) const;
+    void WriteSummaryJson(std::ostream &out) const;
+
+    // Returns false if the stream is not a frame log.
+    static bool ReadCsv(std::istream &in, BenchmarkLog &log);
+
+private:
+    std::map<std::string, std::string> m_metadata;
+    std::vector<std::string>           m_columns;
+    std::vector<std::vector<double>>   m_series;
+};
@@ -0,0 +1,158 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+bool CameraPath::Parse(std::istream &in, std::string *pError) {
+    m_keys.clear();
+    m_interpolation = Interpolation::CATMULL_ROM;
+    m_loopPeriod    = 0.0;
+
+    auto fail = [pError](int line, std::string const &message) {
+        if (pError) *pError = "line " + std::to_string(line) + ": " + message;
+        return false;
+    };
+
+    std::string text;
+    int         lineNumber = 0;
+    while (std::getline(in, text)) {
+        lineNumber++;
+        size_t comment = text.find('#');
+        if (comment != std::string::npos) text.resize(comment);
+        std::istringstream line(text);
+        line.imbue(std::locale::classic());
+        std::string directive;
+        if (!(line >> directive)) continue;
+
+        if (directive == "key") {
+            CameraPathKey key;
+            if (!(line >> key.time >> key.position[0] >> key.position[1] >> key.position[2] >> key.direction[0] >> key.direction[1] >> key.direction[2]))
+                return fail(lineNumber, "expected key <time> <px> <py> <pz> <dx> <dy> <dz>");
+            if (!m_keys.empty() && key.time <= m_keys.back().time) return fail(lineNumber, "key times must be increasing");
+            m_keys.push_back(key);
+        } else if (directive == "loop") {
+            if (!(line >> m_loopPeriod) || m_loopPeriod <= 0.0) return fail(lineNumber, "expected loop <period>");
+        } else if (directive == "interpolation") {
+            std::string mode;
+            line >> mode;
+            if (mode == "linear")
+                m_interpolation = Interpolation::LINEAR;
+            else if (mode == "catmull_rom")
+                m_interpolation = Interpolation::CATMULL_ROM;
+            else
+                return fail(lineNumber, "unknown interpolation '" + mode + "'");
+        } else {
+            return fail(lineNumber, "unknown directive '" + directive + "'");
+        }
+    }
+    if (m_keys.empty()) return fail(lineNumber, "no keys");
+    if (IsLooping() && m_loopPeriod <= m_keys.back().time) return fail(lineNumber, "loop period must be past the last key");
+    return true;
+}
+
+bool CameraPath::Load(std::string const &filename, std::string *pError) {
+    std::ifstream in(filename);
+    if (!in) {
+        if (pError) *pError = "can not open " + filename;
+        return false;
+    }
+    return Parse(in, pError);
+}
+
+double CameraPath::GetDuration() const {
+    if (IsLooping()) return m_loopPeriod;
+    return m_keys.empty() ? 0.0 : m_keys.back().time;
+}
+
+// Cubic Hermite segment between p1 at t1 and p2 at t2, tangents from the neighbours (Catmull-Rom for uneven spacing).
+static double CatmullRom(double p0, double p1, double p2, double p3, double t0, double t1, double t2, double t3, double t) {
+    double h  = t2 - t1;
+    double s  = (t - t1) / h;
+    double m1 = (p2 - p0) / (t2 - t0) * h;
+    double m2 = (p3 - p1) / (t3 - t1) * h;
+    double s2 = s * s;
+    double s3 = s2 * s;
+    return (2.0 * s3 - 3.0 * s2 + 1.0) * p1 + (s3 - 2.0 * s2 + s) * m1 + (-2.0 * s3 + 3.0 * s2) * p2 + (s3 - s2) * m2;
+}
+
+void CameraPath::Evaluate(double time, double position[3], double direction[3]) const {
+    for (int c = 0; c < 3; c++) position[c] = direction[c] = 0.0;
+    if (m_keys.empty()) return;
+
+    int    count = (int)m_keys.size();
+    double local = time;
+    if (IsLooping()) {
+        local = std::fmod(local, m_loopPeriod);
+        if (local < 0.0) local += m_loopPeriod;
+        // Before the first key we are still on the segment that wraps around from the last key.
+        if (local < m_keys.front().time) local += m_loopPeriod;
+    } else {
+        local = std::min(std::max(local, m_keys.front().time), GetDuration());
+    }
+
+    // Key and time of index i, extended periodically for loops and clamped at the ends otherwise.
+    auto key = [&](int i, double &t) -> CameraPathKey const & {
+        if (IsLooping()) {
+            int wraps = (i < 0 ? (i - count + 1) : i) / count;
+            int j     = i - wraps * count;
+            t         = m_keys[j].time + wraps * m_loopPeriod;
+            return m_keys[j];
+        }
+        int j = std::min(std::max(i, 0), count - 1);
+        // Mirror the spacing past the ends so the end tangents stay finite.
+        t = m_keys[j].time + (i - j) * (count > 1 ? (i < 0 ? m_keys[1].time - m_keys[0].time : m_keys[count - 1].time - m_keys[count - 2].time) : 1.0);
+        return m_keys[j];
+    };
+
+    int segment = 0;
+    while (segment + 1 < count && m_keys[segment + 1].time <= local) segment++;
+    if (!IsLooping() && segment == count - 1) {
+        double t;
+        CameraPathKey const &last = key(count - 1, t);
+        for (int c = 0; c < 3; c++) position[c] = last.position[c];
+        for (int c = 0; c < 3; c++) direction[c] = last.direction[c];
+    } else {
+        double               t0, t1, t2, t3;
+        CameraPathKey const &k0 = key(segment - 1, t0);
+        CameraPathKey const &k1 = key(segment, t1);
+        CameraPathKey const &k2 = key(segment + 1, t2);
+        CameraPathKey const &k3 = key(segment + 2, t3);
+        for (int c = 0; c < 3; c++) {
+            if (m_interpolation == Interpolation::LINEAR) {
+                double s     = (local - t1) / (t2 - t1);
+                position[c]  = k1.position[c] + (k2.position[c] - k1.position[c]) * s;
+                direction[c] = k1.direction[c] + (k2.direction[c] - k1.direction[c]) * s;
+            } else {
+                position[c]  = CatmullRom(k0.position[c], k1.position[c], k2.position[c], k3.position[c], t0, t1, t2, t3, local);
+                direction[c] = CatmullRom(k0.direction[c], k1.direction[c], k2.direction[c], k3.direction[c], t0, t1, t2, t3, local);
+            }
+        }
+    }
+
+    double length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+    if (length > 0.0)
+        for (int c = 0; c < 3; c++) direction[c] /= length;
+}
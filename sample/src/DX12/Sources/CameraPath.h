@@ -0,0 +1,69 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct CameraPathKey {
+    double time;
+    double position[3];
+    double direction[3];
+};
+
+/**
+        Keyframed camera path used by the benchmark.
+
+        Text format, one directive per line, '#' starts a comment:
+
+            interpolation catmull_rom     # or linear, default catmull_rom
+            loop 21                       # optional, the path wraps around to time 0 at this time
+            key <time> <px> <py> <pz> <dx> <dy> <dz>
+
+        Path time starts at 0, keys must be sorted by time. Positions use non-uniform Catmull-Rom splines so keys do not need to be evenly
+        spaced; directions are interpolated the same way and renormalized.
+*/
+class CameraPath {
+public:
+    enum class Interpolation { LINEAR, CATMULL_ROM };
+
+    bool Parse(std::istream &in, std::string *pError = nullptr);
+    bool Load(std::string const &filename, std::string *pError = nullptr);
+
+    void AddKey(CameraPathKey const &key) { m_keys.push_back(key); }
+    void SetInterpolation(Interpolation interpolation) { m_interpolation = interpolation; }
+    // A period <= 0 makes the path play once and hold the last key.
+    void SetLoop(double period) { m_loopPeriod = period; }
+
+    bool   IsLooping() const { return m_loopPeriod > 0.0; }
+    double GetDuration() const;
+    size_t GetKeyCount() const { return m_keys.size(); }
+
+    // Samples the path. Time wraps around for looping paths and is clamped otherwise.
+    void Evaluate(double time, double position[3], double direction[3]) const;
+
+private:
+    std::vector<CameraPathKey> m_keys;
+    Interpolation              m_interpolation = Interpolation::CATMULL_ROM;
+    double                     m_loopPeriod    = 0.0;
+};
@@ -0,0 +1,328 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "ClusteredLightsBuilder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define CLUSTERED_LIGHTS_SSE2 1
+#    include <emmintrin.h>
+#endif
+
+using namespace ClusteredLightsModel;
+using namespace LightGridModel;
+
+// How far the outer tiles extend past the screen, in normalized device coordinates.
+static float const kOuterTileExtent = 1.0e6f;
+
+static uint32_t AsUint(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float AsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static float Dot(float const a[3], float const b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static bool Influences(ClusteredLightsBuilder::Light const &light, float const p[3]) {
+    return LightGrid_Influences(light.type, light.range, light.outerConeCos, light.position[0], light.position[1], light.position[2], light.direction[0], light.direction[1],
+                                light.direction[2], p[0], p[1], p[2]);
+}
+
+// Sphere around the points the light reaches, the range sphere or the smaller sphere around the cone of a spot. See
+// "Bounding sphere of a cone" by Bart Wronski.
+static void BoundingSphere(ClusteredLightsBuilder::Light const &light, float center[3], float &radius) {
+    for (int axis = 0; axis < 3; axis++) center[axis] = light.position[axis];
+    radius = light.range;
+    float const cosAngle  = light.outerConeCos - LIGHT_GRID_CONE_MARGIN;
+    float const dirLength = sqrtf(Dot(light.direction, light.direction));
+    if (light.type == LIGHT_GRID_TYPE_SPOT && cosAngle > 0.0f && dirLength > 0.0f) {
+        // The cone points along -direction.
+        float const along = cosAngle > sqrtf(0.5f) ? light.range / (2.0f * cosAngle) : light.range * cosAngle;
+        radius            = cosAngle > sqrtf(0.5f) ? along : light.range * sqrtf(1.0f - cosAngle * cosAngle);
+        for (int axis = 0; axis < 3; axis++) center[axis] -= light.direction[axis] / dirLength * along;
+    }
+    // Rounding of the transform to view space.
+    radius *= 1.0f + 1.0e-4f;
+}
+
+// Depths where the slice begins and ends, the inverse of ClusteredLights_Slice.
+static void SliceDepths(uint32_t slice, uint32_t slices, float nearDepth, float sliceScale, float farDepth, float &begin, float &end) {
+    begin = slice == 0 ? 0.0f : nearDepth * expf(float(slice - 1) / sliceScale);
+    end   = slice + 1 == slices ? farDepth : (slice == 0 ? nearDepth : nearDepth * expf(float(slice) / sliceScale));
+}
+
+// Extent of tile 'tile' of 'tiles' along one lateral axis, at view depths 'begin' to 'end'.
+static void TileExtent(uint32_t tile, uint32_t tiles, float tanHalfFov, float begin, float end, float &extentMin, float &extentMax) {
+    float const ndcMin = tile == 0 ? -kOuterTileExtent : -1.0f + 2.0f * float(tile) / float(tiles);
+    float const ndcMax = tile + 1 == tiles ? kOuterTileExtent : -1.0f + 2.0f * float(tile + 1) / float(tiles);
+    // Points rounded into the tile by the shader are still inside.
+    float const margin = 1.0e-3f * 2.0f / float(tiles) * tanHalfFov * end;
+    extentMin          = std::min(ndcMin * begin, ndcMin * end) * tanHalfFov - margin;
+    extentMax          = std::max(ndcMax * begin, ndcMax * end) * tanHalfFov + margin;
+}
+
+void ClusteredLightsBuilder::Build(Light const *pLights, uint32_t count, View const &view, Config const &config, bool enabled, uint32_t maxWords) {
+    assert(CLUSTERED_LIGHTS_HEADER_WORDS + count <= maxWords);
+    m_lights.assign(pLights, pLights + count);
+
+    // The clusters only need to reach as deep as the lights do.
+    std::vector<uint32_t> bounded;
+    float                 farDepth = 2.0f * config.nearDepth;
+    m_viewLights.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        Light const &light     = pLights[i];
+        Light &      viewLight = m_viewLights[i];
+        float const  offset[3] = {light.position[0] - view.eye[0], light.position[1] - view.eye[1], light.position[2] - view.eye[2]};
+        viewLight              = light;
+        viewLight.position[0]  = Dot(offset, view.right);
+        viewLight.position[1]  = Dot(offset, view.up);
+        viewLight.position[2]  = Dot(offset, view.forward);
+        viewLight.direction[0] = Dot(light.direction, view.right);
+        viewLight.direction[1] = Dot(light.direction, view.up);
+        viewLight.direction[2] = Dot(light.direction, view.forward);
+        if (!enabled || !LightGrid_IsBounded(light.type, light.range)) continue;
+        bounded.push_back(i);
+        farDepth = std::max(farDepth, viewLight.position[2] + light.range);
+    }
+    if (!bounded.empty() && std::isfinite(farDepth) && config.nearDepth > 0.0f) {
+        uint32_t dims[3] = {std::max(config.tilesX, 1u), std::max(config.tilesY, 1u), std::max(config.slices, 1u)};
+        while (true) {
+            if (TryBuild(bounded, view, config, dims, farDepth, maxWords)) return;
+            if (dims[0] * dims[1] * dims[2] == 1) break;
+            for (uint32_t &dim : dims) dim = std::max(dim / 2, 1u);
+        }
+    }
+    BuildGlobal();
+}
+
+void ClusteredLightsBuilder::BuildGlobal() {
+    m_words.assign(CLUSTERED_LIGHTS_HEADER_WORDS, 0);
+    m_words[CLUSTERED_LIGHTS_GLOBAL_COUNT]  = uint32_t(m_lights.size());
+    m_words[CLUSTERED_LIGHTS_CLUSTER_TABLE] = uint32_t(CLUSTERED_LIGHTS_HEADER_WORDS + m_lights.size());
+    m_words[CLUSTERED_LIGHTS_LIGHT_COUNT]   = uint32_t(m_lights.size());
+    for (uint32_t i = 0; i < m_lights.size(); i++) m_words.push_back(i);
+
+    m_stats              = Stats();
+    m_stats.lights       = uint32_t(m_lights.size());
+    m_stats.globalLights = uint32_t(m_lights.size());
+    m_stats.words        = uint32_t(m_words.size());
+}
+
+bool ClusteredLightsBuilder::TryBuild(std::vector<uint32_t> const &bounded, View const &view, Config const &config, uint32_t const dims[3], float farDepth,
+                                      uint32_t maxWords) {
+    uint32_t const nx = dims[0], ny = dims[1], nz = dims[2];
+    uint32_t const clusterCount = nx * ny * nz;
+    float const    nearDepth    = config.nearDepth;
+    float const    sliceScale   = nz > 1 ? float(nz - 1) / logf(farDepth / nearDepth) : 0.0f;
+
+    // Cluster boxes in view space, in cluster order.
+    for (std::vector<float> &bounds : m_boxes) bounds.resize(clusterCount);
+    float *const pMinX = m_boxes[0].data(), *const pMinY = m_boxes[1].data(), *const pMinZ = m_boxes[2].data();
+    float *const pMaxX = m_boxes[3].data(), *const pMaxY = m_boxes[4].data(), *const pMaxZ = m_boxes[5].data();
+    for (uint32_t z = 0; z < nz; z++) {
+        float begin, end;
+        SliceDepths(z, nz, nearDepth, sliceScale, farDepth, begin, end);
+        float const depthMargin = 1.0e-3f * (end - begin);
+        for (uint32_t y = 0; y < ny; y++) {
+            float yMin, yMax;
+            TileExtent(y, ny, view.tanHalfFovY, begin, end, yMin, yMax);
+            for (uint32_t x = 0; x < nx; x++) {
+                uint32_t const cluster = (z * ny + y) * nx + x;
+                TileExtent(x, nx, view.tanHalfFovX, begin, end, pMinX[cluster], pMaxX[cluster]);
+                pMinY[cluster] = yMin;
+                pMaxY[cluster] = yMax;
+                pMinZ[cluster] = begin - depthMargin;
+                pMaxZ[cluster] = end + depthMargin;
+            }
+        }
+    }
+
+    m_globals.clear();
+    for (uint32_t i = 0, next = 0; i < m_lights.size(); i++) {
+        if (next < bounded.size() && bounded[next] == i)
+            next++;
+        else
+            m_globals.push_back(i);
+    }
+    m_pairs.clear();
+    for (uint32_t i : bounded) {
+        Light const &light = m_viewLights[i];
+        float        center[3], radius;
+        BoundingSphere(light, center, radius);
+        if (center[2] + radius < 0.0f) continue;
+        float const radius2   = radius * radius;
+        bool const  spot      = light.type == LIGHT_GRID_TYPE_SPOT;
+        size_t const first    = m_pairs.size();
+        auto const  addCluster = [&](uint32_t cluster) {
+            if (spot) {
+                // The cone against the sphere around the box.
+                float const boxCenter[3] = {0.5f * (pMinX[cluster] + pMaxX[cluster]), 0.5f * (pMinY[cluster] + pMaxY[cluster]), 0.5f * (pMinZ[cluster] + pMaxZ[cluster])};
+                float const halfSize[3]  = {0.5f * (pMaxX[cluster] - pMinX[cluster]), 0.5f * (pMaxY[cluster] - pMinY[cluster]), 0.5f * (pMaxZ[cluster] - pMinZ[cluster])};
+                if (SpotLightMissesSphere(light, boxCenter, sqrtf(Dot(halfSize, halfSize)))) return;
+            }
+            m_pairs.push_back(uint64_t(cluster) << 32 | i);
+        };
+
+        // Slices and tiles around the sphere, one more on every side for the rounding; the box tests decide.
+        uint32_t const firstSlice = ClusteredLights_Slice(center[2] - radius, nearDepth, sliceScale, nz);
+        uint32_t const lastSlice  = std::min(ClusteredLights_Slice(center[2] + radius, nearDepth, sliceScale, nz) + 1, nz - 1);
+        for (uint32_t z = firstSlice > 0 ? firstSlice - 1 : 0; z <= lastSlice; z++) {
+            float begin, end;
+            SliceDepths(z, nz, nearDepth, sliceScale, farDepth, begin, end);
+            float const nearest  = std::max(begin, center[2] - radius);
+            float const farthest = std::max(std::min(end, center[2] + radius), nearest);
+            uint32_t    tiles[2][2] = {{0, nx - 1}, {0, ny - 1}};
+            if (nearest > CLUSTERED_LIGHTS_MIN_DEPTH) {
+                float const tanHalfFov[2] = {view.tanHalfFovX, view.tanHalfFovY};
+                for (int axis = 0; axis < 2; axis++) {
+                    uint32_t const count  = axis == 0 ? nx : ny;
+                    float const    low    = std::min((center[axis] - radius) / nearest, (center[axis] - radius) / farthest) / tanHalfFov[axis];
+                    float const    high   = std::max((center[axis] + radius) / nearest, (center[axis] + radius) / farthest) / tanHalfFov[axis];
+                    uint32_t const tile   = ClusteredLights_Tile(low, count);
+                    tiles[axis][0]        = tile > 0 ? tile - 1 : 0;
+                    tiles[axis][1]        = std::min(ClusteredLights_Tile(high, count) + 1, count - 1);
+                }
+            }
+            // Every box of a row has the same y and z extents, so only x is tested per box, four at a time with SSE2.
+            for (uint32_t y = tiles[1][0]; y <= tiles[1][1]; y++) {
+                uint32_t const row = (z * ny + y) * nx;
+                float const    dy  = std::max(std::max(pMinY[row] - center[1], center[1] - pMaxY[row]), 0.0f);
+                float const    dz  = std::max(std::max(pMinZ[row] - center[2], center[2] - pMaxZ[row]), 0.0f);
+                float const    dyz = dy * dy + dz * dz;
+                if (dyz > radius2) continue;
+                uint32_t x = tiles[0][0];
+#if CLUSTERED_LIGHTS_SSE2
+                if (config.simd) {
+                    __m128 const zero = _mm_setzero_ps();
+                    __m128 const cx = _mm_set1_ps(center[0]), yz = _mm_set1_ps(dyz), r2 = _mm_set1_ps(radius2);
+                    for (; x + 3 <= tiles[0][1]; x += 4) {
+                        uint32_t const cluster = row + x;
+                        // Same order of operations as the scalar test below, so both paths assign the same clusters.
+                        __m128 const dx   = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(pMinX + cluster), cx), _mm_sub_ps(cx, _mm_loadu_ps(pMaxX + cluster))), zero);
+                        int const    mask = _mm_movemask_ps(_mm_cmple_ps(_mm_add_ps(_mm_mul_ps(dx, dx), yz), r2));
+                        if (mask == 0) continue;
+                        for (uint32_t lane = 0; lane < 4; lane++)
+                            if (mask & (1 << lane)) addCluster(cluster + lane);
+                    }
+                }
+#endif
+                for (; x <= tiles[0][1]; x++) {
+                    uint32_t const cluster = row + x;
+                    float const    dx      = std::max(std::max(pMinX[cluster] - center[0], center[0] - pMaxX[cluster]), 0.0f);
+                    if (dx * dx + dyz <= radius2) addCluster(cluster);
+                }
+            }
+        }
+        if ((m_pairs.size() - first) * 2 > clusterCount) {
+            m_pairs.resize(first);
+            m_globals.push_back(i);
+        }
+    }
+    std::sort(m_globals.begin(), m_globals.end());
+
+    uint32_t const clusterTable = uint32_t(CLUSTERED_LIGHTS_HEADER_WORDS + m_globals.size());
+    uint32_t const lists        = clusterTable + 2 * clusterCount;
+    if (uint64_t(lists) + m_pairs.size() > maxWords) return false;
+
+    m_words.assign(lists + m_pairs.size(), 0);
+    for (int axis = 0; axis < 3; axis++) {
+        m_words[CLUSTERED_LIGHTS_EYE + axis]        = AsUint(view.eye[axis]);
+        m_words[CLUSTERED_LIGHTS_X_AXIS + axis]     = AsUint(view.right[axis] / view.tanHalfFovX);
+        m_words[CLUSTERED_LIGHTS_Y_AXIS + axis]     = AsUint(view.up[axis] / view.tanHalfFovY);
+        m_words[CLUSTERED_LIGHTS_DEPTH_AXIS + axis] = AsUint(view.forward[axis]);
+        m_words[CLUSTERED_LIGHTS_DIMENSIONS + axis] = dims[axis];
+    }
+    m_words[CLUSTERED_LIGHTS_NEAR_DEPTH]    = AsUint(nearDepth);
+    m_words[CLUSTERED_LIGHTS_SLICE_SCALE]   = AsUint(sliceScale);
+    m_words[CLUSTERED_LIGHTS_GLOBAL_COUNT]  = uint32_t(m_globals.size());
+    m_words[CLUSTERED_LIGHTS_CLUSTER_TABLE] = clusterTable;
+    m_words[CLUSTERED_LIGHTS_LIGHT_COUNT]   = uint32_t(m_lights.size());
+    std::copy(m_globals.begin(), m_globals.end(), m_words.begin() + CLUSTERED_LIGHTS_HEADER_WORDS);
+
+    // Counting sort by cluster. The pairs were added light by light, so each list stays in light order.
+    uint32_t *pTable = m_words.data() + clusterTable;
+    for (uint64_t pair : m_pairs) pTable[2 * (pair >> 32) + 1]++;
+    uint32_t offset = lists;
+    m_stats         = Stats();
+    for (uint32_t cluster = 0; cluster < clusterCount; cluster++) {
+        uint32_t const clusterLights = pTable[2 * cluster + 1];
+        pTable[2 * cluster]          = offset;
+        offset += clusterLights;
+        m_stats.occupiedClusters += clusterLights ? 1 : 0;
+        m_stats.maxClusterLights = std::max(m_stats.maxClusterLights, clusterLights);
+    }
+    for (uint32_t cluster = 0; cluster < clusterCount; cluster++) pTable[2 * cluster + 1] = 0;
+    for (uint64_t pair : m_pairs) {
+        uint32_t *pCluster                   = pTable + 2 * (pair >> 32);
+        m_words[pCluster[0] + pCluster[1]++] = uint32_t(pair);
+    }
+
+    m_stats.lights       = uint32_t(m_lights.size());
+    m_stats.globalLights = uint32_t(m_globals.size());
+    m_stats.clusters     = clusterCount;
+    m_stats.listEntries  = m_pairs.size();
+    m_stats.words        = uint32_t(m_words.size());
+    m_stats.farDepth     = farDepth;
+    for (int axis = 0; axis < 3; axis++) m_stats.dimensions[axis] = dims[axis];
+    return true;
+}
+
+void ClusteredLightsBuilder::Query(float const p[3], std::vector<uint32_t> &lights, uint32_t *pCandidates) const {
+    lights.clear();
+    if (m_words.empty()) {
+        if (pCandidates) *pCandidates = 0;
+        return;
+    }
+    uint32_t const *pWords      = m_words.data();
+    uint32_t const  globalCount = pWords[CLUSTERED_LIGHTS_GLOBAL_COUNT];
+    uint32_t        candidates  = globalCount;
+    for (uint32_t i = 0; i < globalCount; i++)
+        if (Influences(m_lights[pWords[CLUSTERED_LIGHTS_HEADER_WORDS + i]], p)) lights.push_back(pWords[CLUSTERED_LIGHTS_HEADER_WORDS + i]);
+
+    // As doPbrLighting in GLTFPBRLighting.hlsl.
+    float offset[3], axes[3][3];
+    for (int axis = 0; axis < 3; axis++) {
+        offset[axis]  = p[axis] - AsFloat(pWords[CLUSTERED_LIGHTS_EYE + axis]);
+        axes[0][axis] = AsFloat(pWords[CLUSTERED_LIGHTS_X_AXIS + axis]);
+        axes[1][axis] = AsFloat(pWords[CLUSTERED_LIGHTS_Y_AXIS + axis]);
+        axes[2][axis] = AsFloat(pWords[CLUSTERED_LIGHTS_DEPTH_AXIS + axis]);
+    }
+    uint32_t const cluster = ClusteredLights_Cluster(Dot(offset, axes[0]), Dot(offset, axes[1]), Dot(offset, axes[2]), AsFloat(pWords[CLUSTERED_LIGHTS_NEAR_DEPTH]),
+                                                     AsFloat(pWords[CLUSTERED_LIGHTS_SLICE_SCALE]), pWords[CLUSTERED_LIGHTS_DIMENSIONS],
+                                                     pWords[CLUSTERED_LIGHTS_DIMENSIONS + 1], pWords[CLUSTERED_LIGHTS_DIMENSIONS + 2]);
+    if (cluster != CLUSTERED_LIGHTS_NO_CLUSTER) {
+        uint32_t const *pCluster = pWords + pWords[CLUSTERED_LIGHTS_CLUSTER_TABLE] + 2 * cluster;
+        candidates += pCluster[1];
+        for (uint32_t i = 0; i < pCluster[1]; i++)
+            if (Influences(m_lights[pWords[pCluster[0] + i]], p)) lights.push_back(pWords[pCluster[0] + i]);
+    }
+    if (pCandidates) *pCandidates = candidates;
+}
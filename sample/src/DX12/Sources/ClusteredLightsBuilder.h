@@ -0,0 +1,91 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include "../../Shaders/ClusteredLights.h"
+#include "LightGridBuilder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+        Assigns the lights to the view space clusters of Shaders/ClusteredLights.h on the CPU, flattened to the words
+        the GPU buffer holds, and answers the same queries as the shader for the tests. The cluster boxes are tested
+        against the light volumes four at a time with SSE2 where available.
+*/
+class ClusteredLightsBuilder {
+public:
+    typedef LightGridBuilder::Light Light;
+
+    struct View {
+        float eye[3];
+        float right[3];   // Unit vectors
+        float up[3];
+        float forward[3];
+        float tanHalfFovX;
+        float tanHalfFovY;
+    };
+    struct Config {
+        uint32_t tilesX    = 16;
+        uint32_t tilesY    = 9;
+        uint32_t slices    = 24;
+        float    nearDepth = 0.5f; // End of slice 0.
+        bool     simd      = true; // The scalar path assigns the same lights, for the tests.
+    };
+    struct Stats {
+        uint32_t lights           = 0;
+        uint32_t globalLights     = 0;
+        uint32_t clusters         = 0;
+        uint32_t occupiedClusters = 0;
+        uint32_t maxClusterLights = 0;
+        uint64_t listEntries      = 0; // Summed over the clusters.
+        uint32_t words            = 0;
+        uint32_t dimensions[3]    = {};
+        float    farDepth         = 0.0f;
+    };
+
+    /**
+        A light whose volume overlaps more than half of the clusters is kept global. The clusters are coarsened until
+        the buffer fits in 'maxWords'. With 'enabled' false every light is global.
+    */
+    void Build(Light const *pLights, uint32_t count, View const &view, Config const &config, bool enabled = true, uint32_t maxWords = CLUSTERED_LIGHTS_MAX_WORDS);
+
+    // Indices of the lights that reach 'p', in the order the shader shades them. 'pCandidates' gets the number of
+    // lights the shader tests for it. Only meant for points in front of the eye, as the rasterizer produces.
+    void Query(float const p[3], std::vector<uint32_t> &lights, uint32_t *pCandidates = NULL) const;
+
+    std::vector<uint32_t> const &GetWords() const { return m_words; }
+    Stats const &                GetStats() const { return m_stats; }
+
+private:
+    bool TryBuild(std::vector<uint32_t> const &bounded, View const &view, Config const &config, uint32_t const dims[3], float farDepth, uint32_t maxWords);
+    void BuildGlobal();
+
+    std::vector<Light>    m_lights;
+    std::vector<Light>    m_viewLights; // Scratch, the lights in view space: x right, y up and z forward.
+    std::vector<float>    m_boxes[6];   // Scratch, cluster boxes in view space as min x, y, z, max x, y, z.
+    std::vector<uint32_t> m_globals;    // Scratch
+    std::vector<uint64_t> m_pairs;      // Scratch, cluster << 32 | light
+    std::vector<uint32_t> m_words;
+    Stats                 m_stats;
+};
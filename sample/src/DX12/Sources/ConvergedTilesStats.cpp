@@ -0,0 +1,90 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include "ConvergedTilesStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ConvergedTilesModel;
+
+ConvergedTileStats ClassifyConvergedTiles(DenoiserCapture const &capture, float maxVariance, float luminanceTolerance, std::vector<uint8_t> *pConverged) {
+    DenoiserImage const &    planes    = capture.planes;
+    DenoiserConstants const &constants = capture.constants;
+    uint32_t const           tilesX    = (planes.width + 7) / 8;
+    uint32_t const           tilesY    = (planes.height + 7) / 8;
+    ConvergedTileStats       stats;
+    double                   errorSum = 0.0;
+    if (pConverged) pConverged->assign(size_t(tilesX) * tilesY, 0);
+
+    for (uint32_t tileY = 0; tileY < tilesY; tileY++) {
+        for (uint32_t tileX = 0; tileX < tilesX; tileX++) {
+            uint32_t const endX         = std::min(planes.width, tileX * 8 + 8);
+            uint32_t const endY         = std::min(planes.height, tileY * 8 + 8);
+            bool           denoised     = false;
+            bool           blocked      = false;
+            uint32_t       glossyPixels = 0;
+            float          luminance    = 0.0f;
+            float          historyLum   = 0.0f;
+            for (uint32_t y = tileY * 8; y < endY; y++) {
+                for (uint32_t x = tileX * 8; x < endX; x++) {
+                    denoised |= planes.At(DENOISER_CAPTURE_TILE_MASK, x, y) > 0.5f;
+                    float roughness = planes.At(DENOISER_CAPTURE_ROUGHNESS, x, y);
+                    if (!(roughness < constants.roughnessThreshold)) continue;
+                    glossyPixels++;
+                    blocked |= !FFX_Reflections_IsPixelConverged(planes.At(DENOISER_CAPTURE_MOTION_VECTOR + 0, x, y), planes.At(DENOISER_CAPTURE_MOTION_VECTOR + 1, x, y),
+                                                                 planes.At(DENOISER_CAPTURE_NUM_SAMPLES_HISTORY, x, y), planes.At(DENOISER_CAPTURE_VARIANCE_HISTORY, x, y),
+                                                                 roughness, constants.maxHistorySamples, maxVariance);
+                    luminance += FFX_Reflections_ConvergedLuminance(planes.At(DENOISER_CAPTURE_RADIANCE + 0, x, y), planes.At(DENOISER_CAPTURE_RADIANCE + 1, x, y),
+                                                                    planes.At(DENOISER_CAPTURE_RADIANCE + 2, x, y));
+                    historyLum += FFX_Reflections_ConvergedLuminance(planes.At(DENOISER_CAPTURE_RADIANCE_HISTORY + 0, x, y),
+                                                                     planes.At(DENOISER_CAPTURE_RADIANCE_HISTORY + 1, x, y),
+                                                                     planes.At(DENOISER_CAPTURE_RADIANCE_HISTORY + 2, x, y));
+                }
+            }
+            if (!denoised) continue;
+            stats.denoiseTiles++;
+            if (glossyPixels == 0 || blocked || !FFX_Reflections_IsTileLuminanceStable(luminance, historyLum, glossyPixels, luminanceTolerance)) continue;
+
+            stats.convergedTiles++;
+            uint32_t refreshes = 0;
+            for (uint32_t frame = 0; frame < FFX_REFLECTIONS_CONVERGED_REFRESH_PERIOD; frame++)
+                refreshes += FFX_Reflections_IsConvergedTileRefresh(tileX, tileY, frame) ? 1 : 0;
+            stats.skippedTiles += 1.0 - double(refreshes) / FFX_REFLECTIONS_CONVERGED_REFRESH_PERIOD;
+            if (pConverged) (*pConverged)[size_t(tileY) * tilesX + tileX] = 1;
+
+            for (uint32_t y = tileY * 8; y < endY; y++) {
+                for (uint32_t x = tileX * 8; x < endX; x++) {
+                    if (!(planes.At(DENOISER_CAPTURE_ROUGHNESS, x, y) < constants.roughnessThreshold)) continue;
+                    stats.keptPixels++;
+                    for (uint32_t c = 0; c < 3; c++) {
+                        double error      = std::fabs(double(planes.At(DENOISER_CAPTURE_RADIANCE_HISTORY + c, x, y)) - planes.At(DENOISER_CAPTURE_TEMPORAL_RADIANCE + c, x, y));
+                        stats.maxAbsError = std::max(stats.maxAbsError, error);
+                        errorSum += error;
+                    }
+                }
+            }
+        }
+    }
+    if (stats.keptPixels) stats.meanAbsError = errorSum / (3.0 * stats.keptPixels);
+    return stats;
+}
@@ -0,0 +1,51 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../../Shaders/ConvergedTiles.h"
+#include "DenoiserReference.h"
+
+/**
+        CPU model of the converged tile classification of HSR_CONVERGED_TILES (Shaders/ConvergedTiles.h), run on frames
+        captured with HSR::CaptureDenoiser to size the work the denoiser would skip. Take the captures with the option
+        off, with it on the tile mask only holds the tiles that were denoised.
+
+        A converged tile keeps its history instead of the temporal output of the capture, the difference between the
+        two over the glossy pixels of those tiles is the error the classification lets through in that frame.
+*/
+struct ConvergedTileStats {
+    uint32_t denoiseTiles   = 0; // Tiles of the denoise list, from DENOISER_CAPTURE_TILE_MASK.
+    uint32_t convergedTiles = 0; // Before the refresh of FFX_Reflections_IsConvergedTileRefresh.
+    double   skippedTiles   = 0; // Average over the refresh period of the converged tiles that are not refreshed.
+    uint64_t keptPixels     = 0; // Glossy pixels of the converged tiles.
+    double   maxAbsError    = 0.0; // Kept history against the captured temporal output, per channel.
+    double   meanAbsError   = 0.0;
+};
+
+/**
+        Classifies the denoise tiles of 'capture' like ClassifyConvergedTiles does, with the given variance and
+        luminance tolerance. 'pConverged' receives one value per 8x8 tile of the frame, 1 for converged tiles.
+*/
+ConvergedTileStats ClassifyConvergedTiles(DenoiserCapture const &capture, float maxVariance, float luminanceTolerance, std::vector<uint8_t> *pConverged = nullptr);
@@ -0,0 +1,261 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "DecalBinning.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+using namespace DecalBinsModel;
+
+// Clip w the box is clipped at, rasterized points are much further than this in front of the eye.
+static float const MinClipW = 1.0e-4f;
+
+static uint32_t AsUint(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float AsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void PackDecal(DecalBinning::Decal const &decal, uint32_t words[DECAL_BINS_DECAL_WORDS]) {
+    // u and v run from 0 to 1 across the box, w from -1 to 1
+    float const scales[3]  = {0.5f / decal.halfSize[0], 0.5f / decal.halfSize[1], 1.0f / decal.halfSize[2]};
+    float const offsets[3] = {0.5f, 0.5f, 0.0f};
+    int const   rows[3]    = {DECAL_BINS_DECAL_TO_U, DECAL_BINS_DECAL_TO_V, DECAL_BINS_DECAL_TO_W};
+    for (int i = 0; i < 3; i++) {
+        float row[3], constant = offsets[i];
+        for (int axis = 0; axis < 3; axis++) {
+            row[axis] = decal.axes[i][axis] * scales[i];
+            constant -= row[axis] * decal.center[axis];
+        }
+        for (int axis = 0; axis < 3; axis++) words[rows[i] + axis] = AsUint(row[axis]);
+        words[rows[i] + 3] = AsUint(constant);
+    }
+    words[DECAL_BINS_DECAL_INTENSITY] = AsUint(decal.intensity);
+    words[DECAL_BINS_DECAL_OPACITY]   = AsUint(decal.opacity);
+    words[14]                         = 0;
+    words[15]                         = 0;
+}
+
+bool GetDecalScreenRect(DecalBinning::Decal const &decal, float const viewProj[16], uint32_t width, uint32_t height, float margin, uint32_t rect[4]) {
+    // Clip x, y and w of the corners, bit i of the corner index picks the side along axis i
+    float clip[8][3];
+    for (int corner = 0; corner < 8; corner++) {
+        float p[3];
+        for (int axis = 0; axis < 3; axis++) {
+            p[axis] = decal.center[axis];
+            for (int i = 0; i < 3; i++) p[axis] += ((corner >> i) & 1 ? decal.halfSize[i] : -decal.halfSize[i]) * decal.axes[i][axis];
+        }
+        int const rows[3] = {0, 1, 3};
+        for (int j = 0; j < 3; j++) {
+            float const *row = viewProj + rows[j] * 4;
+            clip[corner][j]  = row[0] * p[0] + row[1] * p[1] + row[2] * p[2] + row[3];
+        }
+    }
+
+    // Frustum culling, the box is out if all of its corners are out of the same plane
+    uint32_t outside = 0xff;
+    for (int corner = 0; corner < 8; corner++) {
+        float const x = clip[corner][0], y = clip[corner][1], w = clip[corner][2];
+        outside &= (x > w ? 1 : 0) | (x < -w ? 2 : 0) | (y > w ? 4 : 0) | (y < -w ? 8 : 0) | (w < MinClipW ? 16 : 0);
+    }
+    if (outside) return false;
+
+    // Bounds of the box clipped at MinClipW: the corners in front and where the edges cross the plane
+    float points[8 + 12][2];
+    int   pointCount = 0;
+    for (int corner = 0; corner < 8; corner++) {
+        float const *a = clip[corner];
+        if (a[2] >= MinClipW) {
+            points[pointCount][0]   = a[0] / a[2];
+            points[pointCount++][1] = a[1] / a[2];
+        }
+        for (int i = 0; i < 3; i++) {
+            if ((corner >> i) & 1) continue;
+            float const *b = clip[corner | (1 << i)];
+            if ((a[2] >= MinClipW) == (b[2] >= MinClipW)) continue;
+            float const t           = (MinClipW - a[2]) / (b[2] - a[2]);
+            points[pointCount][0]   = (a[0] + (b[0] - a[0]) * t) / MinClipW;
+            points[pointCount++][1] = (a[1] + (b[1] - a[1]) * t) / MinClipW;
+        }
+    }
+    float minX = points[0][0], maxX = points[0][0], minY = points[0][1], maxY = points[0][1];
+    for (int i = 1; i < pointCount; i++) {
+        minX = std::min(minX, points[i][0]);
+        maxX = std::max(maxX, points[i][0]);
+        minY = std::min(minY, points[i][1]);
+        maxY = std::max(maxY, points[i][1]);
+    }
+
+    // Pixel (x, y) has its center at normalized device coordinates ((x + 0.5) / width * 2 - 1, 1 - (y + 0.5) / height * 2)
+    float const x0 = std::floor((minX * 0.5f + 0.5f) * float(width) - margin);
+    float const x1 = std::floor((maxX * 0.5f + 0.5f) * float(width) + margin);
+    float const y0 = std::floor((0.5f - maxY * 0.5f) * float(height) - margin);
+    float const y1 = std::floor((0.5f - minY * 0.5f) * float(height) + margin);
+    if (x1 < 0.0f || y1 < 0.0f || x0 >= float(width) || y0 >= float(height)) return false;
+    rect[0] = uint32_t(std::max(x0, 0.0f));
+    rect[1] = uint32_t(std::max(y0, 0.0f));
+    rect[2] = uint32_t(std::min(x1, float(width - 1)));
+    rect[3] = uint32_t(std::min(y1, float(height - 1)));
+    return true;
+}
+
+void QueryDecalsBruteForce(uint32_t const *pRecords, uint32_t count, float const p[3], std::vector<uint32_t> &decals) {
+    decals.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t const *words = pRecords + size_t(i) * DECAL_BINS_DECAL_WORDS;
+        float           uvw[3];
+        for (int j = 0; j < 3; j++) {
+            uint32_t const *row = words + DECAL_BINS_DECAL_TO_U + j * 4;
+            uvw[j]              = DecalBins_Coordinate(AsFloat(row[0]), AsFloat(row[1]), AsFloat(row[2]), AsFloat(row[3]), p[0], p[1], p[2]);
+        }
+        if (DecalBins_Covers(uvw[0], uvw[1], uvw[2])) decals.push_back(i);
+    }
+}
+
+void DecalBinning::Build(Decal const *pDecals, uint32_t count, float const viewProj[16], uint32_t width, uint32_t height, uint32_t maxWords) {
+    m_stats        = Stats();
+    m_stats.decals = count;
+    m_visible.clear();
+    m_rects.clear();
+    if (width && height) {
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t rect[4];
+            // A pixel of margin, the camera may be jittered by up to half a pixel
+            if (!GetDecalScreenRect(pDecals[i], viewProj, width, height, 1.0f, rect)) continue;
+            m_visible.push_back(i);
+            m_rects.insert(m_rects.end(), rect, rect + 4);
+        }
+    }
+    m_stats.visibleDecals = uint32_t(m_visible.size());
+
+    // The tiles coarsen down to a single one that lists every decal, which takes 3 words plus one per decal. Only
+    // when even that does not fit are the decals covering the fewest pixels dropped, the others keep their order.
+    uint32_t const fitting = maxWords > DECAL_BINS_HEADER_WORDS + 3 ? (maxWords - DECAL_BINS_HEADER_WORDS - 3) / (DECAL_BINS_DECAL_WORDS + 1) : 0;
+    if (m_visible.size() > fitting) {
+        std::vector<uint64_t> areas(m_visible.size());
+        for (size_t i = 0; i < m_visible.size(); i++) {
+            uint32_t const *rect = &m_rects[i * 4];
+            areas[i]             = uint64_t(rect[2] - rect[0] + 1) * (rect[3] - rect[1] + 1) << 32 | uint32_t(i);
+        }
+        std::nth_element(areas.begin(), areas.begin() + fitting, areas.end(), std::greater<uint64_t>());
+        std::vector<bool> keep(m_visible.size(), false);
+        for (uint32_t i = 0; i < fitting; i++) keep[uint32_t(areas[i])] = true;
+        size_t kept = 0;
+        for (size_t i = 0; i < m_visible.size(); i++) {
+            if (!keep[i]) continue;
+            m_visible[kept] = m_visible[i];
+            memmove(&m_rects[kept * 4], &m_rects[i * 4], 4 * sizeof(uint32_t));
+            kept++;
+        }
+        m_stats.droppedDecals = uint32_t(m_visible.size() - kept);
+        m_visible.resize(kept);
+        m_rects.resize(kept * 4);
+    }
+    uint32_t const visible = uint32_t(m_visible.size());
+
+    // Coarsen the tiles until the lists fit
+    uint32_t tileSize = DECAL_BINS_TILE_SIZE, tilesX = 0, tilesY = 0, occupied = 0;
+    uint64_t entries = 0, words = 0;
+    for (;;) {
+        tilesX = (width + tileSize - 1) / tileSize;
+        tilesY = (height + tileSize - 1) / tileSize;
+        m_tileLists.assign(size_t(tilesX) * tilesY, 0);
+        for (uint32_t i = 0; i < visible; i++) {
+            uint32_t const *rect = &m_rects[size_t(i) * 4];
+            for (uint32_t y = rect[1] / tileSize; y <= rect[3] / tileSize; y++)
+                for (uint32_t x = rect[0] / tileSize; x <= rect[2] / tileSize; x++) m_tileLists[size_t(y) * tilesX + x]++;
+        }
+        occupied = 0;
+        entries  = 0;
+        for (uint32_t tileCount : m_tileLists) {
+            occupied += tileCount ? 1 : 0;
+            entries += tileCount;
+        }
+        words = DECAL_BINS_HEADER_WORDS + uint64_t(visible) * DECAL_BINS_DECAL_WORDS + uint64_t(occupied) * 3 + entries;
+        if (words <= maxWords || tileSize >= std::max(width, height)) break;
+        tileSize *= 2;
+    }
+    assert(words <= maxWords || !visible);
+
+    m_words.assign(size_t(words), 0);
+    m_words[DECAL_BINS_TILE_SIZE_WORD] = tileSize;
+    m_words[DECAL_BINS_DECAL_COUNT]    = visible;
+    m_words[DECAL_BINS_OCCUPIED_COUNT] = occupied;
+    uint32_t const tileTable           = DECAL_BINS_HEADER_WORDS + visible * DECAL_BINS_DECAL_WORDS;
+    m_words[DECAL_BINS_OCCUPIED_TILES] = tileTable;
+    for (uint32_t i = 0; i < visible; i++) PackDecal(pDecals[m_visible[i]], &m_words[DECAL_BINS_HEADER_WORDS + size_t(i) * DECAL_BINS_DECAL_WORDS]);
+
+    // The occupied tiles in row order, each list starts with its count. m_tileLists turns into the list offsets.
+    uint32_t entry = 0, list = tileTable + occupied * 2;
+    for (uint32_t y = 0; y < tilesY; y++) {
+        for (uint32_t x = 0; x < tilesX; x++) {
+            uint32_t &tile      = m_tileLists[size_t(y) * tilesX + x];
+            uint32_t  tileCount = tile;
+            if (!tileCount) continue;
+            m_words[tileTable + entry * 2]     = DecalBins_PackTile(x, y);
+            m_words[tileTable + entry * 2 + 1] = list;
+            entry++;
+            tile          = list;
+            m_words[list] = 0;
+            list += 1 + tileCount;
+            m_stats.maxTileDecals = std::max(m_stats.maxTileDecals, tileCount);
+        }
+    }
+    assert(list == words);
+
+    // Filled in decal order, the lists come out sorted
+    for (uint32_t i = 0; i < visible; i++) {
+        uint32_t const *rect = &m_rects[size_t(i) * 4];
+        for (uint32_t y = rect[1] / tileSize; y <= rect[3] / tileSize; y++) {
+            for (uint32_t x = rect[0] / tileSize; x <= rect[2] / tileSize; x++) {
+                uint32_t const offset = m_tileLists[size_t(y) * tilesX + x];
+                uint32_t const slot   = offset + 1 + m_words[offset]++;
+                m_words[slot]         = i;
+            }
+        }
+    }
+
+    m_tilesX              = tilesX;
+    m_stats.tileSize      = tileSize;
+    m_stats.tiles         = tilesX * tilesY;
+    m_stats.occupiedTiles = occupied;
+    m_stats.listEntries   = entries;
+    m_stats.words         = uint32_t(words);
+}
+
+void DecalBinning::Query(uint32_t x, uint32_t y, std::vector<uint32_t> &decals) const {
+    decals.clear();
+    if (!m_stats.tileSize) return;
+    size_t const tile = size_t(y / m_stats.tileSize) * m_tilesX + x / m_stats.tileSize;
+    if (tile >= m_tileLists.size() || !m_tileLists[tile]) return;
+    uint32_t const offset = m_tileLists[tile];
+    for (uint32_t i = 0; i < m_words[offset]; i++) decals.push_back(m_visible[m_words[offset + 1 + i]]);
+}
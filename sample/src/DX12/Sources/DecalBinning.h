@@ -0,0 +1,92 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include "../../Shaders/DecalBins.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+        Culls the decal volumes against the view frustum and bins the visible ones into the screen tiles of
+        Shaders/DecalBins.h, flattened to the words the GPU buffer holds. Answers the same queries as the shader for
+        the tests.
+*/
+class DecalBinning {
+public:
+    struct Decal {
+        float center[3];
+        float axes[3][3];  // Unit vectors along which u, v and the depth w grow.
+        float halfSize[3]; // Along the axes.
+        float intensity;
+        float opacity;
+    };
+    struct Stats {
+        uint32_t decals        = 0;
+        uint32_t visibleDecals = 0;
+        uint32_t droppedDecals = 0; // Visible but past what the buffer holds.
+        uint32_t tileSize      = 0;
+        uint32_t tiles         = 0;
+        uint32_t occupiedTiles = 0;
+        uint32_t maxTileDecals = 0;
+        uint64_t listEntries   = 0; // Summed over the tiles.
+        uint32_t words         = 0;
+    };
+
+    /**
+        'viewProj' is row major, clip = viewProj * (x, y, z, 1), for a 'width' x 'height' pixels screen. The tiles
+        are DECAL_BINS_TILE_SIZE pixels wide and grow by powers of two until the bins fit in 'maxWords', up to one tile
+        for the screen. Decals are only dropped past (maxWords - DECAL_BINS_HEADER_WORDS - 3) / (DECAL_BINS_DECAL_WORDS + 1).
+    */
+    void Build(Decal const *pDecals, uint32_t count, float const viewProj[16], uint32_t width, uint32_t height, uint32_t maxWords = DECAL_BINS_MAX_WORDS);
+
+    // Indices into the decals given to Build of the decals the shader tests at pixel (x, y), in the order it applies
+    // them.
+    void Query(uint32_t x, uint32_t y, std::vector<uint32_t> &decals) const;
+
+    // Indices of the decals in the buffer, the visible ones that fit.
+    std::vector<uint32_t> const &GetVisible() const { return m_visible; }
+    std::vector<uint32_t> const &GetWords() const { return m_words; }
+    Stats const &                GetStats() const { return m_stats; }
+
+private:
+    std::vector<uint32_t> m_visible;   // Indices of the visible decals.
+    std::vector<uint32_t> m_rects;     // Pixels the visible decals may cover, 4 per decal: x0, y0, x1, y1 included.
+    std::vector<uint32_t> m_tileLists; // Word offset of the list of every tile, 0 without decals.
+    std::vector<uint32_t> m_words;
+    uint32_t              m_tilesX = 0;
+    Stats                 m_stats;
+};
+
+void PackDecal(DecalBinning::Decal const &decal, uint32_t words[DECAL_BINS_DECAL_WORDS]);
+
+/**
+        The pixels the decal may cover, x0, y0, x1, y1 included, with 'margin' pixels around them for jitter. False
+        when it is outside of the frustum or of the screen. The far plane is ignored, decals beyond it only cost
+        their tiles.
+*/
+bool GetDecalScreenRect(DecalBinning::Decal const &decal, float const viewProj[16], uint32_t width, uint32_t height, float margin, uint32_t rect[4]);
+
+// The decals whose box contains 'p', in index order, tested on their records, DECAL_BINS_DECAL_WORDS words each, like
+// the shader does. What Query has to find.
+void QueryDecalsBruteForce(uint32_t const *pRecords, uint32_t count, float const p[3], std::vector<uint32_t> &decals);
@@ -0,0 +1,729 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "DenoiserReference.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define DENOISER_REFERENCE_SSE2 1
+#    include <emmintrin.h>
+#endif
+
+namespace {
+
+// Constants of the FidelityFX reflection denoiser, in one place so they can be held against the library.
+const int   NEIGHBORHOOD_RADIUS                      = 4;
+const float GAUSSIAN_K                               = 3.0f;
+const float RADIANCE_WEIGHT_BIAS                     = 0.6f;
+const float RADIANCE_WEIGHT_VARIANCE_K               = 0.1f;
+const float AVG_RADIANCE_LUMINANCE_WEIGHT            = 0.3f;
+const float PREFILTER_VARIANCE_WEIGHT                = 4.4f;
+const float PREFILTER_VARIANCE_BIAS                  = 0.1f;
+const float PREFILTER_NORMAL_SIGMA                   = 512.0f;
+const float PREFILTER_DEPTH_SIGMA                    = 4.0f;
+const float DISOCCLUSION_NORMAL_WEIGHT               = 1.4f;
+const float DISOCCLUSION_DEPTH_WEIGHT                = 1.0f;
+const float DISOCCLUSION_THRESHOLD                   = 0.9f;
+const float REPROJECTION_NORMAL_SIMILARITY_THRESHOLD = 0.9999f;
+const float REPROJECT_RADIANCE_MIX                   = 0.3f; // Share of the history in the radiance averaged per tile.
+const float MIRROR_ROUGHNESS                         = 0.0001f;
+const float FLOAT_EPSILON                            = 1.0e-6f;
+
+// First 15 numbers of Halton(2, 3) stretched to [-3, 3], the prefilter taps besides the center.
+const int PREFILTER_OFFSETS[15][2] = {{0, 1}, {-2, 1}, {2, -3}, {-3, 0}, {1, 2}, {-1, -2}, {3, 0}, {-3, 3}, {0, -3}, {-1, -1}, {2, 1}, {-2, -2}, {1, 0}, {0, 2}, {3, -1}};
+
+struct Float3 {
+    float x, y, z;
+};
+
+Float3 operator+(Float3 a, Float3 b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+Float3 operator-(Float3 a, Float3 b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+Float3 operator*(Float3 a, float s) { return {a.x * s, a.y * s, a.z * s}; }
+Float3 operator/(Float3 a, float s) { return {a.x / s, a.y / s, a.z / s}; }
+Float3 Splat(float s) { return {s, s, s}; }
+float  Dot(Float3 a, Float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+float  Length(Float3 a) { return std::sqrt(Dot(a, a)); }
+Float3 Normalize(Float3 a) { return a / Length(a); }
+Float3 Lerp(Float3 a, Float3 b, float t) { return a + (b - a) * t; }
+float  Lerp(float a, float b, float t) { return a + (b - a) * t; }
+Float3 Sqrt(Float3 a) { return {std::sqrt(a.x), std::sqrt(a.y), std::sqrt(a.z)}; }
+bool   IsFinite(Float3 a) { return std::isfinite(a.x) && std::isfinite(a.y) && std::isfinite(a.z); }
+
+float Luminance(Float3 color) { return std::max(Dot(color, {0.299f, 0.587f, 0.114f}), 0.001f); }
+
+float ComputeTemporalVariance(Float3 history, Float3 radiance) {
+    float history_luminance = Luminance(history);
+    float luminance         = Luminance(radiance);
+    float diff              = std::abs(history_luminance - luminance) / std::max(std::max(history_luminance, luminance), 0.5f);
+    return diff * diff;
+}
+
+Float3 ClipAABB(Float3 aabb_min, Float3 aabb_max, Float3 prev_sample) {
+    Float3 center      = (aabb_max + aabb_min) * 0.5f;
+    Float3 extent_clip = (aabb_max - aabb_min) * 0.5f + Splat(0.001f);
+    Float3 color       = prev_sample - center;
+    float  max_abs     = std::max(std::max(std::abs(color.x / extent_clip.x), std::abs(color.y / extent_clip.y)), std::abs(color.z / extent_clip.z));
+    return max_abs > 1.0f ? center + color / max_abs : prev_sample;
+}
+
+// mul(float4(v, w), m) with m in the hlsl::float4x4 memory layout.
+void MulRow(float const (&v)[4], float const *m, float (&result)[4]) {
+    for (int j = 0; j < 4; j++) result[j] = v[0] * m[j * 4 + 0] + v[1] * m[j * 4 + 1] + v[2] * m[j * 4 + 2] + v[3] * m[j * 4 + 3];
+}
+
+// InvProjectPosition and ProjectPosition of Common.hlsl.
+Float3 InvProjectPosition(float u, float v, float depth, float const *m) {
+    float p[4] = {2.0f * u - 1.0f, 2.0f * (1.0f - v) - 1.0f, depth, 1.0f};
+    float r[4];
+    MulRow(p, m, r);
+    return {r[0] / r[3], r[1] / r[3], r[2] / r[3]};
+}
+
+Float3 ProjectPosition(Float3 position, float const *m) {
+    float p[4] = {position.x, position.y, position.z, 1.0f};
+    float r[4];
+    MulRow(p, m, r);
+    Float3 projected = {r[0] / r[3], r[1] / r[3], r[2] / r[3]};
+    projected.x      = 0.5f * projected.x + 0.5f;
+    projected.y      = 1.0f - (0.5f * projected.y + 0.5f);
+    return projected;
+}
+
+float GetLinearDepth(DenoiserConstants const &constants, float u, float v, float depth) { return std::abs(InvProjectPosition(u, v, depth, constants.invProj).z); }
+
+Float3 DecodeNormal(Float3 encoded) { return Normalize(encoded * 2.0f - Splat(1.0f)); }
+
+// Texture2D::Load, 0 outside of the texture.
+float Load(DenoiserImage const &image, uint32_t plane, int x, int y) {
+    if (x < 0 || y < 0 || x >= int(image.width) || y >= int(image.height)) return 0.0f;
+    return image.At(plane, uint32_t(x), uint32_t(y));
+}
+
+Float3 Load3(DenoiserImage const &image, uint32_t plane, int x, int y) { return {Load(image, plane, x, y), Load(image, plane + 1, x, y), Load(image, plane + 2, x, y)}; }
+
+// SampleLevel with a bilinear clamp sampler on the top left width x height corner of a plane.
+float Sample(DenoiserImage const &image, uint32_t plane, uint32_t width, uint32_t height, float u, float v) {
+    float fx = std::min(std::max(u * width - 0.5f, -1.0f), float(width));
+    float fy = std::min(std::max(v * height - 0.5f, -1.0f), float(height));
+    if (!(fx == fx)) fx = 0.0f;
+    if (!(fy == fy)) fy = 0.0f;
+    float x0 = std::floor(fx);
+    float y0 = std::floor(fy);
+    float tx = fx - x0;
+    float ty = fy - y0;
+    auto  tap = [&](int x, int y) {
+        x = std::min(std::max(x, 0), int(width) - 1);
+        y = std::min(std::max(y, 0), int(height) - 1);
+        return image.At(plane, uint32_t(x), uint32_t(y));
+    };
+    int ix = int(x0);
+    int iy = int(y0);
+    return Lerp(Lerp(tap(ix, iy), tap(ix + 1, iy), tx), Lerp(tap(ix, iy + 1), tap(ix + 1, iy + 1), tx), ty);
+}
+
+Float3 Sample3(DenoiserImage const &image, uint32_t plane, uint32_t width, uint32_t height, float u, float v) {
+    return {Sample(image, plane, width, height, u, v), Sample(image, plane + 1, width, height, u, v), Sample(image, plane + 2, width, height, u, v)};
+}
+
+Float3 SampleFull3(DenoiserImage const &image, uint32_t plane, float u, float v) { return Sample3(image, plane, image.width, image.height, u, v); }
+float  SampleFull(DenoiserImage const &image, uint32_t plane, float u, float v) { return Sample(image, plane, image.width, image.height, u, v); }
+
+uint32_t AverageWidth(DenoiserImage const &image) { return (image.width + 7) / 8; }
+uint32_t AverageHeight(DenoiserImage const &image) { return (image.height + 7) / 8; }
+
+Float3 SampleAverageRadiance(DenoiserImage const &image, uint32_t plane, float u, float v) { return Sample3(image, plane, AverageWidth(image), AverageHeight(image), u, v); }
+
+// Splits [0, rows) into one contiguous range per thread.
+template <typename FUNCTION> void ParallelRows(uint32_t rows, uint32_t threadCount, FUNCTION const &function) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::max(1u, std::min(threadCount, rows));
+    if (threadCount == 1) {
+        function(0u, rows);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        uint32_t begin = uint32_t(uint64_t(rows) * i / threadCount);
+        uint32_t end   = uint32_t(uint64_t(rows) * (i + 1) / threadCount);
+        workers.emplace_back([&function, begin, end]() { function(begin, end); });
+    }
+    for (auto &worker : workers) worker.join();
+}
+
+// result[i] = sum of weights[k] * rows[k][i], null rows count as 0. Both paths add in the same order, so the SIMD
+// and scalar results are identical.
+void WeightedRowSum(float const *const *rows, float const *weights, int rowCount, float *result, uint32_t count) {
+    uint32_t i = 0;
+#if DENOISER_REFERENCE_SSE2
+    for (; i + 4 <= count; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < rowCount; k++)
+            if (rows[k]) sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+        _mm_storeu_ps(result + i, sum);
+    }
+#endif
+    for (; i < count; i++) {
+        float sum = 0.0f;
+        for (int k = 0; k < rowCount; k++)
+            if (rows[k]) sum += weights[k] * rows[k][i];
+        result[i] = sum;
+    }
+}
+
+/**
+        Gaussian weighted mean and variance over the NEIGHBORHOOD_RADIUS neighborhood of each pixel, for the 3 planes
+        starting at firstPlane. Pixels outside of the image count as 0 with their full weight, as the out of bounds
+        loads into groupshared memory do on the GPU. The kernel is separable, so the sums of x and x^2 run as a
+        horizontal and a vertical pass.
+*/
+void EstimateLocalNeighborhood(DenoiserImage const &source, uint32_t firstPlane, DenoiserImage &mean, DenoiserImage &variance, uint32_t threadCount) {
+    int const taps = 2 * NEIGHBORHOOD_RADIUS + 1;
+    float     weights[taps];
+    float     weight_sum = 0.0f;
+    for (int k = 0; k < taps; k++) {
+        float i    = float(k - NEIGHBORHOOD_RADIUS);
+        weights[k] = std::exp(-GAUSSIAN_K * (i * i) / float((NEIGHBORHOOD_RADIUS + 1) * (NEIGHBORHOOD_RADIUS + 1)));
+        weight_sum += weights[k];
+    }
+    for (int k = 0; k < taps; k++) weights[k] /= weight_sum;
+
+    uint32_t const width  = source.width;
+    uint32_t const height = source.height;
+    // Channel c holds the horizontal sums of x, channel 3 + c the ones of x^2.
+    DenoiserImage horizontal;
+    horizontal.Resize(width, height, 6);
+    ParallelRows(height, threadCount, [&](uint32_t begin, uint32_t end) {
+        std::vector<float> padded(width + 2 * NEIGHBORHOOD_RADIUS, 0.0f);
+        std::vector<float> padded_squared(padded.size(), 0.0f);
+        float const *      rows[taps];
+        float const *      rows_squared[taps];
+        for (int k = 0; k < taps; k++) {
+            rows[k]         = padded.data() + k;
+            rows_squared[k] = padded_squared.data() + k;
+        }
+        for (uint32_t y = begin; y < end; y++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                float const *line = source.Plane(firstPlane + c) + size_t(y) * width;
+                for (uint32_t x = 0; x < width; x++) {
+                    padded[NEIGHBORHOOD_RADIUS + x]         = line[x];
+                    padded_squared[NEIGHBORHOOD_RADIUS + x] = line[x] * line[x];
+                }
+                WeightedRowSum(rows, weights, taps, horizontal.Plane(c) + size_t(y) * width, width);
+                WeightedRowSum(rows_squared, weights, taps, horizontal.Plane(3 + c) + size_t(y) * width, width);
+            }
+        }
+    });
+
+    mean.Resize(width, height, 3);
+    variance.Resize(width, height, 3);
+    ParallelRows(height, threadCount, [&](uint32_t begin, uint32_t end) {
+        std::vector<float> squared(width);
+        float const *      rows[taps];
+        for (uint32_t y = begin; y < end; y++) {
+            for (uint32_t c = 0; c < 3; c++) {
+                float *mean_line     = mean.Plane(c) + size_t(y) * width;
+                float *variance_line = variance.Plane(c) + size_t(y) * width;
+                for (int k = 0; k < taps; k++) {
+                    int row = int(y) + k - NEIGHBORHOOD_RADIUS;
+                    rows[k] = (row >= 0 && row < int(height)) ? horizontal.Plane(c) + size_t(row) * width : nullptr;
+                }
+                WeightedRowSum(rows, weights, taps, mean_line, width);
+                for (int k = 0; k < taps; k++)
+                    if (rows[k]) rows[k] += size_t(3) * width * height;
+                WeightedRowSum(rows, weights, taps, squared.data(), width);
+                for (uint32_t x = 0; x < width; x++) variance_line[x] = std::abs(squared[x] - mean_line[x] * mean_line[x]);
+            }
+        }
+    });
+}
+
+Float3 At3(DenoiserImage const &image, uint32_t plane, uint32_t x, uint32_t y) { return {image.At(plane, x, y), image.At(plane + 1, x, y), image.At(plane + 2, x, y)}; }
+
+void Store3(DenoiserImage &image, uint32_t plane, uint32_t x, uint32_t y, Float3 value) {
+    image.At(plane + 0, x, y) = value.x;
+    image.At(plane + 1, x, y) = value.y;
+    image.At(plane + 2, x, y) = value.z;
+}
+
+bool IsGlossy(DenoiserConstants const &constants, float roughness) { return roughness < constants.roughnessThreshold; }
+
+float GetDisocclusionFactor(Float3 normal, Float3 history_normal, float linear_depth, float history_linear_depth) {
+    return std::exp(-std::abs(1.0f - std::max(0.0f, Dot(normal, history_normal))) * DISOCCLUSION_NORMAL_WEIGHT) *
+           std::exp(-std::abs(history_linear_depth - linear_depth) / linear_depth * DISOCCLUSION_DEPTH_WEIGHT);
+}
+
+struct Reprojection {
+    float  u, v;
+    Float3 radiance;
+    float  disocclusion_factor;
+};
+
+// Picks between the surface and the hit point reprojection, then searches the vicinity and finally the bilinear
+// footprint for history that is not disoccluded.
+Reprojection PickReprojection(DenoiserCapture const &capture, uint32_t x, uint32_t y, float roughness, Float3 normal, float linear_depth) {
+    DenoiserImage const &    planes    = capture.planes;
+    DenoiserConstants const &constants = capture.constants;
+    float const              width     = float(planes.width);
+    float const              height    = float(planes.height);
+    float const              u         = (x + 0.5f) / width;
+    float const              v         = (y + 0.5f) / height;
+
+    float surface_u = u - planes.At(DENOISER_CAPTURE_MOTION_VECTOR + 0, x, y) * 0.5f;
+    float surface_v = v + planes.At(DENOISER_CAPTURE_MOTION_VECTOR + 1, x, y) * 0.5f;
+
+    // Parallax corrected reprojection of the hit point: extend the view ray through the surface by the reflected ray
+    // length and reproject the tip of it.
+    Float3 view_space_ray = InvProjectPosition(u, v, planes.At(DENOISER_CAPTURE_DEPTH, x, y), constants.invProj);
+    float  surface_depth  = Length(view_space_ray);
+    float  ray_length     = surface_depth + planes.At(DENOISER_CAPTURE_RAY_LENGTH, x, y);
+    view_space_ray        = view_space_ray / surface_depth * ray_length;
+    float view_space_hit[4] = {view_space_ray.x, view_space_ray.y, view_space_ray.z, 1.0f};
+    float world_space_hit[4];
+    MulRow(view_space_hit, constants.invView, world_space_hit);
+    Float3 hit_position = ProjectPosition({world_space_hit[0], world_space_hit[1], world_space_hit[2]}, constants.prevViewProj);
+    float  hit_u        = hit_position.x;
+    float  hit_v        = hit_position.y;
+
+    Float3 surface_normal       = DecodeNormal(SampleFull3(planes, DENOISER_CAPTURE_NORMAL_HISTORY, surface_u, surface_v));
+    Float3 hit_normal           = DecodeNormal(SampleFull3(planes, DENOISER_CAPTURE_NORMAL_HISTORY, hit_u, hit_v));
+    float  hit_similarity       = Dot(hit_normal, normal);
+    float  surface_similarity   = Dot(surface_normal, normal);
+    float  hit_roughness        = SampleFull(planes, DENOISER_CAPTURE_ROUGHNESS_HISTORY, hit_u, hit_v);
+    float  surface_roughness    = SampleFull(planes, DENOISER_CAPTURE_ROUGHNESS_HISTORY, surface_u, surface_v);
+
+    Reprojection result;
+    Float3       history_normal;
+    if (hit_similarity > REPROJECTION_NORMAL_SIMILARITY_THRESHOLD && hit_similarity + 1.0e-3f > surface_similarity &&
+        std::abs(hit_roughness - roughness) < std::abs(surface_roughness - roughness) + 1.0e-3f) {
+        history_normal = hit_normal;
+        result.u       = hit_u;
+        result.v       = hit_v;
+    } else {
+        history_normal = surface_normal;
+        result.u       = surface_u;
+        result.v       = surface_v;
+    }
+    float history_linear_depth = GetLinearDepth(constants, result.u, result.v, SampleFull(planes, DENOISER_CAPTURE_DEPTH_HISTORY, result.u, result.v));
+    result.radiance            = SampleFull3(planes, DENOISER_CAPTURE_RADIANCE_HISTORY, result.u, result.v);
+    result.disocclusion_factor = GetDisocclusionFactor(normal, history_normal, linear_depth, history_linear_depth);
+    if (result.disocclusion_factor > DISOCCLUSION_THRESHOLD) return result;
+
+    // Closest history sample in the 3x3 vicinity.
+    float center_u = result.u;
+    float center_v = result.v;
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            float  sample_u       = center_u + dx / width;
+            float  sample_v       = center_v + dy / height;
+            Float3 sample_normal  = DecodeNormal(SampleFull3(planes, DENOISER_CAPTURE_NORMAL_HISTORY, sample_u, sample_v));
+            float  sample_depth   = GetLinearDepth(constants, sample_u, sample_v, SampleFull(planes, DENOISER_CAPTURE_DEPTH_HISTORY, sample_u, sample_v));
+            float  sample_weight  = GetDisocclusionFactor(normal, sample_normal, linear_depth, sample_depth);
+            if (sample_weight > result.disocclusion_factor) {
+                result.disocclusion_factor = sample_weight;
+                result.u                   = sample_u;
+                result.v                   = sample_v;
+            }
+        }
+    }
+    result.radiance = SampleFull3(planes, DENOISER_CAPTURE_RADIANCE_HISTORY, result.u, result.v);
+
+    // Still disoccluded: rebuild the sample from the texels of its bilinear footprint that are not.
+    if (result.disocclusion_factor < DISOCCLUSION_THRESHOLD) {
+        float  fx = width * result.u + 0.5f;
+        float  fy = height * result.v + 0.5f;
+        float  tx = fx - std::floor(fx);
+        float  ty = fy - std::floor(fy);
+        int    x0 = int(width * result.u - 0.5f);
+        int    y0 = int(height * result.v - 0.5f);
+        float  w[4];
+        Float3 radiance[4];
+        Float3 normals[4];
+        float  depths[4];
+        for (int i = 0; i < 4; i++) {
+            int sx      = x0 + (i & 1);
+            int sy      = y0 + (i >> 1);
+            radiance[i] = Load3(planes, DENOISER_CAPTURE_RADIANCE_HISTORY, sx, sy);
+            normals[i]  = DecodeNormal(Load3(planes, DENOISER_CAPTURE_NORMAL_HISTORY, sx, sy));
+            depths[i]   = GetLinearDepth(constants, result.u, result.v, Load(planes, DENOISER_CAPTURE_DEPTH_HISTORY, sx, sy));
+            w[i]        = GetDisocclusionFactor(normal, normals[i], linear_depth, depths[i]) > DISOCCLUSION_THRESHOLD / 2.0f ? 1.0f : 0.0f;
+        }
+        w[0] *= (1.0f - tx) * (1.0f - ty);
+        w[1] *= tx * (1.0f - ty);
+        w[2] *= (1.0f - tx) * ty;
+        w[3] *= tx * ty;
+        float weight_sum = std::max(w[0] + w[1] + w[2] + w[3], 1.0e-3f);
+        result.radiance  = Splat(0.0f);
+        Float3 history_normal_sum = Splat(0.0f);
+        float  history_depth_sum  = 0.0f;
+        for (int i = 0; i < 4; i++) {
+            float weight = w[i] / weight_sum;
+            result.radiance    = result.radiance + radiance[i] * weight;
+            history_normal_sum = history_normal_sum + normals[i] * weight;
+            history_depth_sum += depths[i] * weight;
+        }
+        result.disocclusion_factor = GetDisocclusionFactor(normal, history_normal_sum, linear_depth, history_depth_sum);
+    }
+    if (result.disocclusion_factor < DISOCCLUSION_THRESHOLD) result.disocclusion_factor = 0.0f;
+    return result;
+}
+
+void Reproject(DenoiserCapture const &capture, DenoiserImage &result, uint32_t threadCount) {
+    DenoiserImage const &    planes    = capture.planes;
+    DenoiserConstants const &constants = capture.constants;
+    uint32_t const           width     = planes.width;
+    uint32_t const           height    = planes.height;
+
+    DenoiserImage mean, variance;
+    EstimateLocalNeighborhood(planes, DENOISER_CAPTURE_RADIANCE, mean, variance, threadCount);
+
+    // What each pixel contributes to the average radiance of its tile.
+    DenoiserImage tile_radiance;
+    tile_radiance.Resize(width, height, 3);
+
+    ParallelRows(height, threadCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                Float3 radiance    = At3(planes, DENOISER_CAPTURE_RADIANCE, x, y);
+                float  roughness   = planes.At(DENOISER_CAPTURE_ROUGHNESS, x, y);
+                Float3 reprojected = Splat(0.0f);
+                float  variance_0  = 1.0f;
+                float  num_samples = 0.0f;
+                if (IsGlossy(constants, roughness)) {
+                    float        u            = (x + 0.5f) / width;
+                    float        v            = (y + 0.5f) / height;
+                    Float3       normal       = DecodeNormal(At3(planes, DENOISER_CAPTURE_NORMAL, x, y));
+                    float        linear_depth = GetLinearDepth(constants, u, v, planes.At(DENOISER_CAPTURE_DEPTH, x, y));
+                    Reprojection reprojection = PickReprojection(capture, x, y, roughness, normal, linear_depth);
+                    num_samples               = 1.0f;
+                    if (reprojection.u > 0.0f && reprojection.v > 0.0f && reprojection.u < 1.0f && reprojection.v < 1.0f) {
+                        if (reprojection.disocclusion_factor < DISOCCLUSION_THRESHOLD) {
+                            reprojected = SampleAverageRadiance(planes, DENOISER_CAPTURE_AVG_RADIANCE_HISTORY, reprojection.u, reprojection.v);
+                        } else {
+                            float history_samples = SampleFull(planes, DENOISER_CAPTURE_NUM_SAMPLES_HISTORY, reprojection.u, reprojection.v);
+                            float max_samples     = std::max(8.0f, constants.maxHistorySamples * roughness);
+                            num_samples           = std::min(max_samples, history_samples * reprojection.disocclusion_factor + 1.0f);
+                            reprojected           = reprojection.radiance;
+                            if (roughness >= MIRROR_ROUGHNESS) {
+                                Float3 deviation = Sqrt(At3(variance, 0, x, y));
+                                Float3 center    = At3(mean, 0, x, y);
+                                reprojected      = ClipAABB(center - deviation, center + deviation, reprojected);
+                            }
+                            float history_variance = SampleFull(planes, DENOISER_CAPTURE_VARIANCE_HISTORY, reprojection.u, reprojection.v);
+                            variance_0             = Lerp(ComputeTemporalVariance(radiance, reprojected), history_variance, constants.temporalStabilityFactor);
+                            radiance               = Lerp(radiance, reprojected, REPROJECT_RADIANCE_MIX);
+                        }
+                    }
+                }
+                Store3(result, DENOISER_CAPTURE_REPROJECTED_RADIANCE, x, y, reprojected);
+                result.At(DENOISER_CAPTURE_REPROJECTED_VARIANCE, x, y) = variance_0;
+                result.At(DENOISER_CAPTURE_NUM_SAMPLES, x, y)          = num_samples;
+                Store3(tile_radiance, 0, x, y, radiance);
+            }
+        }
+    });
+
+    // Luminance weighted 8x8 average, fireflies get a small weight.
+    uint32_t const average_width  = AverageWidth(planes);
+    uint32_t const average_height = AverageHeight(planes);
+    ParallelRows(average_height, threadCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t ty = begin; ty < end; ty++) {
+            for (uint32_t tx = 0; tx < average_width; tx++) {
+                Float3 sum        = Splat(0.0f);
+                float  weight_sum = 0.0f;
+                for (uint32_t y = ty * 8; y < std::min(ty * 8 + 8, height); y++) {
+                    for (uint32_t x = tx * 8; x < std::min(tx * 8 + 8, width); x++) {
+                        Float3 radiance = At3(tile_radiance, 0, x, y);
+                        float  weight   = std::max(std::exp(-Luminance(radiance) * AVG_RADIANCE_LUMINANCE_WEIGHT), 1.0e-2f);
+                        radiance        = radiance * weight;
+                        if (!IsFinite(radiance) || weight > 1.0e3f) continue;
+                        sum = sum + radiance;
+                        weight_sum += weight;
+                    }
+                }
+                Store3(result, DENOISER_CAPTURE_AVG_RADIANCE, tx, ty, sum / std::max(weight_sum, FLOAT_EPSILON));
+            }
+        }
+    });
+}
+
+void Prefilter(DenoiserCapture const &capture, DenoiserImage &result, uint32_t threadCount) {
+    DenoiserImage const &    planes    = capture.planes;
+    DenoiserConstants const &constants = capture.constants;
+    uint32_t const           width     = planes.width;
+    uint32_t const           height    = planes.height;
+
+    // Decoded normals and linear depth of every pixel, what the prefilter keeps in groupshared memory.
+    DenoiserImage surface;
+    surface.Resize(width, height, 4);
+    ParallelRows(height, threadCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                Store3(surface, 0, x, y, DecodeNormal(At3(planes, DENOISER_CAPTURE_NORMAL, x, y)));
+                surface.At(3, x, y) = GetLinearDepth(constants, (x + 0.5f) / width, (y + 0.5f) / height, planes.At(DENOISER_CAPTURE_DEPTH, x, y));
+            }
+        }
+    });
+    Float3 const outside_normal = DecodeNormal(Splat(0.0f));
+
+    ParallelRows(height, threadCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                Float3 center_radiance = At3(planes, DENOISER_CAPTURE_RADIANCE, x, y);
+                float  center_variance = planes.At(DENOISER_CAPTURE_REPROJECTED_VARIANCE, x, y);
+                Float3 radiance        = center_radiance;
+                float  variance        = center_variance;
+                if (IsGlossy(constants, planes.At(DENOISER_CAPTURE_ROUGHNESS, x, y))) {
+                    Float3 center_normal = At3(surface, 0, x, y);
+                    float  center_depth  = surface.At(3, x, y);
+                    Float3 avg_radiance  = SampleAverageRadiance(planes, DENOISER_CAPTURE_AVG_RADIANCE, (x + 0.5f) / (8 * AverageWidth(planes)),
+                                                                (y + 0.5f) / (8 * AverageHeight(planes)));
+                    auto   radiance_weight = [&](Float3 neighbor_radiance) {
+                        return std::max(std::exp(-(RADIANCE_WEIGHT_BIAS + center_variance * RADIANCE_WEIGHT_VARIANCE_K) * Length(avg_radiance - neighbor_radiance)), 1.0e-2f);
+                    };
+
+                    // The weight of the center against the average removes fireflies.
+                    float  weight_sum      = radiance_weight(center_radiance);
+                    Float3 radiance_sum    = center_radiance * weight_sum;
+                    float  variance_sum    = center_variance * weight_sum * weight_sum;
+                    float  variance_weight = std::max(PREFILTER_VARIANCE_BIAS, 1.0f - std::exp(-(center_variance * PREFILTER_VARIANCE_WEIGHT)));
+                    for (auto const &offset : PREFILTER_OFFSETS) {
+                        int    nx                = int(x) + offset[0];
+                        int    ny                = int(y) + offset[1];
+                        bool   inside            = nx >= 0 && ny >= 0 && nx < int(width) && ny < int(height);
+                        Float3 neighbor_radiance = Load3(planes, DENOISER_CAPTURE_RADIANCE, nx, ny);
+                        float  neighbor_variance = Load(planes, DENOISER_CAPTURE_REPROJECTED_VARIANCE, nx, ny);
+                        Float3 neighbor_normal   = inside ? At3(surface, 0, nx, ny) : outside_normal;
+                        float  neighbor_depth    = inside ? surface.At(3, nx, ny) : GetLinearDepth(constants, (nx + 0.5f) / width, (ny + 0.5f) / height, 0.0f);
+
+                        float weight = std::pow(std::max(Dot(center_normal, neighbor_normal), 0.0f), PREFILTER_NORMAL_SIGMA);
+                        weight *= std::exp(-std::abs(center_depth - neighbor_depth) * center_depth * PREFILTER_DEPTH_SIGMA);
+                        weight *= radiance_weight(neighbor_radiance);
+                        weight *= variance_weight;
+                        weight_sum += weight;
+                        radiance_sum = radiance_sum + neighbor_radiance * weight;
+                        variance_sum += weight * weight * neighbor_variance;
+                    }
+                    radiance = radiance_sum / weight_sum;
+                    variance = variance_sum / (weight_sum * weight_sum);
+                }
+                Store3(result, DENOISER_CAPTURE_PREFILTERED_RADIANCE, x, y, radiance);
+                result.At(DENOISER_CAPTURE_PREFILTERED_VARIANCE, x, y) = variance;
+            }
+        }
+    });
+}
+
+void ResolveTemporal(DenoiserCapture const &capture, DenoiserImage &result, uint32_t threadCount) {
+    DenoiserImage const &    planes    = capture.planes;
+    DenoiserConstants const &constants = capture.constants;
+    uint32_t const           width     = planes.width;
+    uint32_t const           height    = planes.height;
+
+    DenoiserImage mean, variance;
+    EstimateLocalNeighborhood(planes, DENOISER_CAPTURE_PREFILTERED_RADIANCE, mean, variance, threadCount);
+
+    ParallelRows(height, threadCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t y = begin; y < end; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                Float3 new_signal   = At3(planes, DENOISER_CAPTURE_PREFILTERED_RADIANCE, x, y);
+                float  new_variance = planes.At(DENOISER_CAPTURE_PREFILTERED_VARIANCE, x, y);
+                if (IsGlossy(constants, planes.At(DENOISER_CAPTURE_ROUGHNESS, x, y))) {
+                    float  num_samples  = planes.At(DENOISER_CAPTURE_NUM_SAMPLES, x, y);
+                    Float3 avg_radiance = SampleAverageRadiance(planes, DENOISER_CAPTURE_AVG_RADIANCE, (x + 0.5f) / (8 * AverageWidth(planes)),
+                                                                (y + 0.5f) / (8 * AverageHeight(planes)));
+                    Float3 old_signal   = At3(planes, DENOISER_CAPTURE_REPROJECTED_RADIANCE, x, y);
+
+                    // Clip the history to the local statistics, pulled towards the tile average.
+                    Float3 local_mean = At3(mean, 0, x, y);
+                    Float3 color_std  = (Sqrt(At3(variance, 0, x, y)) + Splat(Length(local_mean - avg_radiance))) * (constants.historyClipWeight * 1.4f);
+                    local_mean        = Lerp(local_mean, avg_radiance, 0.2f);
+                    Float3 clipped_old_signal = ClipAABB(local_mean - color_std, local_mean + color_std, old_signal);
+
+                    float weight = 1.0f - 1.0f / std::max(num_samples, 1.0f);
+                    // Lean on the average while there are few samples, and clip outliers.
+                    new_signal   = Lerp(new_signal, avg_radiance, 1.0f / std::max(num_samples + 1.0f, 1.0f));
+                    new_signal   = ClipAABB(avg_radiance - color_std, avg_radiance + color_std, new_signal);
+                    new_signal   = Lerp(new_signal, clipped_old_signal, weight);
+                    new_variance = Lerp(ComputeTemporalVariance(new_signal, clipped_old_signal), new_variance, weight);
+                    if (!IsFinite(new_signal) || !std::isfinite(new_variance)) {
+                        new_signal   = Splat(0.0f);
+                        new_variance = 0.0f;
+                    }
+                }
+                Store3(result, DENOISER_CAPTURE_TEMPORAL_RADIANCE, x, y, new_signal);
+                result.At(DENOISER_CAPTURE_TEMPORAL_VARIANCE, x, y) = new_variance;
+            }
+        }
+    });
+}
+
+struct StagePlanes {
+    uint32_t first;
+    uint32_t count;
+};
+
+StagePlanes GetStagePlanes(DenoiserStage stage) {
+    switch (stage) {
+    case DenoiserStage::Reproject:
+        return {DENOISER_CAPTURE_REPROJECTED_RADIANCE, 5};
+    case DenoiserStage::Prefilter:
+        return {DENOISER_CAPTURE_PREFILTERED_RADIANCE, 4};
+    default:
+        return {DENOISER_CAPTURE_TEMPORAL_RADIANCE, 4};
+    }
+}
+
+} // namespace
+
+char const *GetDenoiserStageName(DenoiserStage stage) {
+    switch (stage) {
+    case DenoiserStage::Reproject:
+        return "Reproject";
+    case DenoiserStage::Prefilter:
+        return "Prefilter";
+    default:
+        return "Temporal";
+    }
+}
+
+void RunDenoiserStage(DenoiserStage stage, DenoiserCapture const &capture, DenoiserImage &result, uint32_t threadCount) {
+    switch (stage) {
+    case DenoiserStage::Reproject:
+        Reproject(capture, result, threadCount);
+        break;
+    case DenoiserStage::Prefilter:
+        Prefilter(capture, result, threadCount);
+        break;
+    case DenoiserStage::ResolveTemporal:
+        ResolveTemporal(capture, result, threadCount);
+        break;
+    }
+}
+
+DenoiserComparison CompareDenoiserStage(DenoiserStage stage, DenoiserCapture const &capture, DenoiserImage const &reference, float absTolerance, float relTolerance) {
+    DenoiserImage const &planes = capture.planes;
+    DenoiserComparison   comparison;
+    double               squared_error_sum = 0.0;
+    uint64_t             value_count       = 0;
+
+    auto compare = [&](uint32_t firstPlane, uint32_t planeCount, uint32_t x, uint32_t y) {
+        bool over_tolerance = false;
+        for (uint32_t plane = firstPlane; plane < firstPlane + planeCount; plane++) {
+            float  expected = planes.At(plane, x, y);
+            float  actual   = reference.At(plane, x, y);
+            double error;
+            if (std::isfinite(expected) && std::isfinite(actual))
+                error = std::abs(double(actual) - double(expected));
+            else
+                error = (expected == actual || (std::isnan(expected) && std::isnan(actual))) ? 0.0 : INFINITY;
+            if (std::isfinite(error)) {
+                squared_error_sum += error * error;
+                value_count++;
+            }
+            if (error > absTolerance + relTolerance * std::abs(expected)) over_tolerance = true;
+            if (error > comparison.maxAbsError) {
+                comparison.maxAbsError = error;
+                comparison.worstX      = x;
+                comparison.worstY      = y;
+                comparison.worstPlane  = plane;
+            }
+        }
+        comparison.pixels++;
+        if (over_tolerance) comparison.pixelsOverTolerance++;
+    };
+
+    auto is_compared = [&](uint32_t x, uint32_t y) {
+        return planes.At(DENOISER_CAPTURE_TILE_MASK, x, y) > 0.5f && IsGlossy(capture.constants, planes.At(DENOISER_CAPTURE_ROUGHNESS, x, y));
+    };
+
+    StagePlanes stage_planes = GetStagePlanes(stage);
+    for (uint32_t y = 0; y < planes.height; y++)
+        for (uint32_t x = 0; x < planes.width; x++)
+            if (is_compared(x, y)) compare(stage_planes.first, stage_planes.count, x, y);
+
+    if (stage == DenoiserStage::Reproject) {
+        for (uint32_t ty = 0; ty < AverageHeight(planes); ty++) {
+            for (uint32_t tx = 0; tx < AverageWidth(planes); tx++) {
+                bool any = false;
+                for (uint32_t y = ty * 8; y < std::min(ty * 8 + 8, planes.height) && !any; y++)
+                    for (uint32_t x = tx * 8; x < std::min(tx * 8 + 8, planes.width) && !any; x++) any = is_compared(x, y);
+                if (any) compare(DENOISER_CAPTURE_AVG_RADIANCE, 3, tx, ty);
+            }
+        }
+    }
+    comparison.rmse = value_count ? std::sqrt(squared_error_sum / double(value_count)) : 0.0;
+    return comparison;
+}
+
+bool SaveDenoiserCapture(std::string const &filename, DenoiserCapture const &capture, std::string *pError) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        if (pError) *pError = "can not create " + filename;
+        return false;
+    }
+    DenoiserConstants const &constants = capture.constants;
+    DenoiserCaptureHeader    header    = {DENOISER_CAPTURE_MAGIC, DENOISER_CAPTURE_VERSION, capture.planes.width, capture.planes.height, capture.planes.channels};
+    out.write((char const *)&header, sizeof(header));
+    out.write((char const *)constants.invProj, sizeof(constants.invProj));
+    out.write((char const *)constants.invView, sizeof(constants.invView));
+    out.write((char const *)constants.prevViewProj, sizeof(constants.prevViewProj));
+    out.write((char const *)&constants.roughnessThreshold, sizeof(float));
+    out.write((char const *)&constants.temporalStabilityFactor, sizeof(float));
+    out.write((char const *)&constants.historyClipWeight, sizeof(float));
+    out.write((char const *)&constants.maxHistorySamples, sizeof(uint32_t));
+    out.write((char const *)capture.planes.data.data(), std::streamsize(capture.planes.data.size() * sizeof(float)));
+    if (!out) {
+        if (pError) *pError = "can not write " + filename;
+        return false;
+    }
+    return true;
+}
+
+bool LoadDenoiserCapture(std::string const &filename, DenoiserCapture &capture, std::string *pError) {
+    auto fail = [pError](std::string const &message) {
+        if (pError) *pError = message;
+        return false;
+    };
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) return fail("can not open " + filename);
+
+    DenoiserCaptureHeader header = {};
+    if (!in.read((char *)&header, sizeof(header)) || header.magic != DENOISER_CAPTURE_MAGIC) return fail(filename + " is not a denoiser capture");
+    if (header.version != DENOISER_CAPTURE_VERSION) return fail(filename + " has unsupported version " + std::to_string(header.version));
+    if (header.planeCount != DENOISER_CAPTURE_PLANE_COUNT) return fail(filename + " has " + std::to_string(header.planeCount) + " planes instead of " + std::to_string(DENOISER_CAPTURE_PLANE_COUNT));
+    if (header.width == 0 || header.height == 0 || header.width > 16384 || header.height > 16384) return fail(filename + " has an invalid size");
+
+    DenoiserConstants &constants = capture.constants;
+    in.read((char *)constants.invProj, sizeof(constants.invProj));
+    in.read((char *)constants.invView, sizeof(constants.invView));
+    in.read((char *)constants.prevViewProj, sizeof(constants.prevViewProj));
+    in.read((char *)&constants.roughnessThreshold, sizeof(float));
+    in.read((char *)&constants.temporalStabilityFactor, sizeof(float));
+    in.read((char *)&constants.historyClipWeight, sizeof(float));
+    in.read((char *)&constants.maxHistorySamples, sizeof(uint32_t));
+    capture.planes.Resize(header.width, header.height, header.planeCount);
+    if (!in.read((char *)capture.planes.data.data(), std::streamsize(capture.planes.data.size() * sizeof(float)))) return fail(filename + " is truncated");
+    return true;
+}
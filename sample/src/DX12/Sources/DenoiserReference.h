@@ -0,0 +1,129 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../../Shaders/DenoiserCapture.h"
+
+/**
+        CPU reference of the reflection denoiser passes (Reproject.hlsl, Prefilter.hlsl, TemporalAccumulation.hlsl),
+        so frames captured with HSR::CaptureDenoiser can be checked offline pass by pass.
+
+        The math follows the FidelityFX reflection denoiser as these shaders drive it: the same 9x9 Gaussian
+        neighborhood moments, 15 tap edge aware prefilter and clipped temporal blend, in fp32. The GPU keeps its
+        intermediates in fp16, so results only match within a tolerance.
+*/
+
+// Planar fp32 image, 'channels' planes of width x height, row major.
+struct DenoiserImage {
+    uint32_t           width    = 0;
+    uint32_t           height   = 0;
+    uint32_t           channels = 0;
+    std::vector<float> data;
+
+    void Resize(uint32_t newWidth, uint32_t newHeight, uint32_t newChannels) {
+        width    = newWidth;
+        height   = newHeight;
+        channels = newChannels;
+        data.assign(size_t(width) * height * channels, 0.0f);
+    }
+    float *      Plane(uint32_t channel) { return data.data() + size_t(channel) * width * height; }
+    float const *Plane(uint32_t channel) const { return data.data() + size_t(channel) * width * height; }
+    float &      At(uint32_t channel, uint32_t x, uint32_t y) { return Plane(channel)[size_t(y) * width + x]; }
+    float        At(uint32_t channel, uint32_t x, uint32_t y) const { return Plane(channel)[size_t(y) * width + x]; }
+};
+
+// The FrameInfo values the denoiser passes read. Matrices are in the memory layout of hlsl::FrameInfo and are applied
+// as in the shaders, mul(row vector, matrix).
+struct DenoiserConstants {
+    float    invProj[16]             = {};
+    float    invView[16]             = {};
+    float    prevViewProj[16]        = {};
+    float    roughnessThreshold      = 0.0f;
+    float    temporalStabilityFactor = 0.0f;
+    float    historyClipWeight       = 0.0f;
+    uint32_t maxHistorySamples       = 0;
+};
+
+// One captured frame, 'planes' has DENOISER_CAPTURE_PLANE_COUNT channels laid out as in Shaders/DenoiserCapture.h.
+struct DenoiserCapture {
+    DenoiserConstants constants;
+    DenoiserImage     planes;
+};
+
+enum class DenoiserStage {
+    Reproject,
+    Prefilter,
+    ResolveTemporal,
+};
+
+char const *GetDenoiserStageName(DenoiserStage stage);
+
+/**
+        Runs one pass on the captured planes and writes its output planes (DENOISER_CAPTURE_REPROJECTED_* and
+        DENOISER_CAPTURE_AVG_RADIANCE, DENOISER_CAPTURE_PREFILTERED_* or DENOISER_CAPTURE_TEMPORAL_*) to 'result',
+        which must have the layout of capture.planes. Every stage reads the GPU outputs of the previous ones from the
+        capture, so an error in one stage does not show up in the next.
+
+        Work is split by rows over 'threadCount' threads, 0 picks the hardware concurrency.
+*/
+void RunDenoiserStage(DenoiserStage stage, DenoiserCapture const &capture, DenoiserImage &result, uint32_t threadCount = 0);
+
+struct DenoiserComparison {
+    uint32_t pixels              = 0; // Compared pixels.
+    uint32_t pixelsOverTolerance = 0; // Pixels with at least one channel off by more than absTolerance + relTolerance * |gpu|.
+    double   maxAbsError         = 0.0;
+    double   rmse                = 0.0; // Over all compared channel values.
+    uint32_t worstX              = 0;
+    uint32_t worstY              = 0;
+    uint32_t worstPlane          = 0;
+};
+
+/**
+        Compares the output planes of 'stage' in 'reference' with the GPU ones in capture.planes. Only glossy pixels of
+        the tiles the denoiser ran on are compared, the passes leave everything else alone. The average radiance
+        planes are compared per 8x8 tile that has at least one such pixel.
+*/
+DenoiserComparison CompareDenoiserStage(DenoiserStage stage, DenoiserCapture const &capture, DenoiserImage const &reference, float absTolerance,
+                                        float relTolerance);
+
+/**
+        Denoiser capture file: a DenoiserCaptureHeader, the constants as 48 floats for the matrices followed by
+        roughnessThreshold, temporalStabilityFactor, historyClipWeight (floats) and maxHistorySamples (uint32), then
+        planeCount planes of width x height floats. Little endian.
+*/
+struct DenoiserCaptureHeader {
+    uint32_t magic;   // DENOISER_CAPTURE_MAGIC
+    uint32_t version; // DENOISER_CAPTURE_VERSION
+    uint32_t width;
+    uint32_t height;
+    uint32_t planeCount;
+};
+
+static const uint32_t DENOISER_CAPTURE_MAGIC   = 0x52534E44; // "DNSR"
+static const uint32_t DENOISER_CAPTURE_VERSION = 1;
+
+bool SaveDenoiserCapture(std::string const &filename, DenoiserCapture const &capture, std::string *pError = nullptr);
+bool LoadDenoiserCapture(std::string const &filename, DenoiserCapture &capture, std::string *pError = nullptr);
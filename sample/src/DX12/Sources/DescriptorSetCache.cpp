@@ -0,0 +1,55 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "DescriptorSetCache.h"
+
+bool DescriptorSetCache::Acquire(uint64_t table, uint32_t set, std::vector<void const *> const *pResources) {
+    Entry *pEntry = nullptr;
+    for (Entry &entry : m_entries)
+        if (entry.table == table) pEntry = &entry;
+    if (!pEntry) {
+        m_entries.push_back(Entry{table, 0, 0, {}});
+        pEntry = &m_entries.back();
+    }
+    if (pEntry->version == m_version && pEntry->set == set) {
+        m_hits++;
+        return false;
+    }
+    pEntry->set     = set;
+    pEntry->version = m_version;
+    if (pResources)
+        pEntry->resources = *pResources;
+    else
+        pEntry->resources.clear();
+    m_misses++;
+    return true;
+}
+
+int DescriptorSetCache::FindStale(uint64_t table, std::vector<void const *> const &resources) const {
+    for (Entry const &entry : m_entries) {
+        if (entry.table != table || entry.resources.empty()) continue;
+        size_t count = entry.resources.size() < resources.size() ? entry.resources.size() : resources.size();
+        for (size_t i = 0; i < count; i++)
+            if (entry.resources[i] != resources[i]) return int(i);
+        if (entry.resources.size() != resources.size()) return int(count);
+    }
+    return -1;
+}
@@ -0,0 +1,68 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+        Remembers which descriptor tables already hold a ping-pong descriptor set, so the views are only created again
+        when a table is first used with a set or the resources the sets view change.
+
+        A table is any key that identifies a range of descriptors, e.g. its GPU handle. Acquire returns true when the
+        caller has to write set 'set' into 'table', and from then on false for that table and set until Invalidate
+        bumps the version. A table used with alternating sets is rewritten each time it switches, so the tables should
+        rotate with a period that is a multiple of the number of sets.
+
+        With the resources the set views passed to Acquire, FindStale reports a cached set whose resources were
+        replaced without an Invalidate, which debug builds check on every hit.
+*/
+class DescriptorSetCache {
+public:
+    // Every table needs to be written again. Call when a resource the sets view is created or destroyed.
+    void     Invalidate() { m_version++; }
+    uint64_t GetVersion() const { return m_version; }
+
+    // True when 'table' does not hold set 'set' of the current version, then it is recorded as holding it and the
+    // caller writes the set. 'pResources' are the resources the set views, only kept for FindStale.
+    bool Acquire(uint64_t table, uint32_t set, std::vector<void const *> const *pResources = nullptr);
+    // Index of the first of 'resources' that differs from the ones the cached set of 'table' was written with, -1 if
+    // none do or nothing was recorded.
+    int FindStale(uint64_t table, std::vector<void const *> const &resources) const;
+
+    uint64_t GetHits() const { return m_hits; }
+    uint64_t GetMisses() const { return m_misses; }
+
+private:
+    struct Entry {
+        uint64_t                  table;
+        uint32_t                  set;
+        uint64_t                  version;
+        std::vector<void const *> resources;
+    };
+
+    std::vector<Entry> m_entries; // One per table seen, a handful.
+    uint64_t           m_version = 1;
+    uint64_t           m_hits    = 0;
+    uint64_t           m_misses  = 0;
+};
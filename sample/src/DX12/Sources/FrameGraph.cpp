@@ -0,0 +1,248 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include "FrameGraph.h"
+
+#include <algorithm>
+#include <cassert>
+
+char const *GetFrameGraphAccessName(FrameGraphAccess access) {
+    switch (access) {
+    case FrameGraphAccess::Common:
+        return "common";
+    case FrameGraphAccess::ShaderRead:
+        return "shader read";
+    case FrameGraphAccess::UnorderedAccess:
+        return "unordered access";
+    case FrameGraphAccess::IndirectArgument:
+        return "indirect argument";
+    case FrameGraphAccess::CopySource:
+        return "copy source";
+    case FrameGraphAccess::CopyDest:
+        return "copy dest";
+    }
+    return "?";
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+static bool LifetimesOverlap(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB) { return firstA <= lastB && firstB <= lastA; }
+
+uint32_t FrameGraph::AddResource(FrameGraphResourceDesc const &desc) {
+    assert(desc.alignment && (desc.alignment & (desc.alignment - 1)) == 0);
+    Resource resource;
+    resource.desc = desc;
+    m_resources.push_back(resource);
+    return uint32_t(m_resources.size() - 1);
+}
+
+uint32_t FrameGraph::AddPass(std::string const &name) {
+    Pass pass;
+    pass.name = name;
+    m_passes.push_back(pass);
+    return uint32_t(m_passes.size() - 1);
+}
+
+void FrameGraph::AddUse(uint32_t pass, uint32_t resource, FrameGraphAccess access, bool write) {
+    assert(pass < m_passes.size() && resource < m_resources.size());
+    for (ResourceUse &use : m_passes[pass].uses) {
+        if (use.resource == resource) {
+            use.access = access;
+            use.write |= write;
+            return;
+        }
+    }
+    m_passes[pass].uses.push_back({resource, access, write});
+}
+
+void FrameGraph::Read(uint32_t pass, uint32_t resource, FrameGraphAccess access) { AddUse(pass, resource, access, false); }
+
+void FrameGraph::Write(uint32_t pass, uint32_t resource, FrameGraphAccess access) { AddUse(pass, resource, access, true); }
+
+bool FrameGraph::Compile(std::string *pError) {
+    CullPasses();
+
+    for (Resource &resource : m_resources) {
+        resource.firstPass = FRAME_GRAPH_INVALID;
+        resource.lastPass  = FRAME_GRAPH_INVALID;
+    }
+    for (uint32_t p = 0; p < m_passes.size(); p++) {
+        if (m_passes[p].culled) continue;
+        for (ResourceUse const &use : m_passes[p].uses) {
+            Resource &resource = m_resources[use.resource];
+            if (resource.firstPass == FRAME_GRAPH_INVALID) {
+                if (!resource.desc.imported && !use.write) {
+                    if (pError) *pError = "pass '" + m_passes[p].name + "' reads '" + resource.desc.name + "' before any pass writes it";
+                    return false;
+                }
+                resource.firstPass = p;
+            }
+            resource.lastPass = p;
+        }
+    }
+
+    PlaceTransients();
+    DeriveBarriers();
+    return true;
+}
+
+// Walks the passes backwards: a pass stays if it writes an imported resource or a transient one a later pass reads.
+void FrameGraph::CullPasses() {
+    std::vector<bool> needed(m_resources.size(), false);
+    for (uint32_t p = uint32_t(m_passes.size()); p-- > 0;) {
+        Pass &pass = m_passes[p];
+        pass.culled = true;
+        for (ResourceUse const &use : pass.uses)
+            if (use.write && (m_resources[use.resource].desc.imported || needed[use.resource])) pass.culled = false;
+        if (pass.culled) continue;
+        for (ResourceUse const &use : pass.uses)
+            needed[use.resource] = true;
+    }
+}
+
+// Largest first, each at the lowest offset that does not overlap a placed resource whose lifetime overlaps its own.
+void FrameGraph::PlaceTransients() {
+    uint32_t groupCount = 0;
+    for (Resource const &resource : m_resources)
+        if (!resource.desc.imported) groupCount = std::max(groupCount, resource.desc.heapGroup + 1);
+    m_heapSizes.assign(groupCount, 0);
+    m_unaliasedSizes.assign(groupCount, 0);
+
+    std::vector<uint32_t> order;
+    for (uint32_t r = 0; r < m_resources.size(); r++)
+        if (!m_resources[r].desc.imported && m_resources[r].firstPass != FRAME_GRAPH_INVALID) order.push_back(r);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (m_resources[a].desc.size != m_resources[b].desc.size) return m_resources[a].desc.size > m_resources[b].desc.size;
+        return m_resources[a].firstPass < m_resources[b].firstPass;
+    });
+
+    std::vector<uint32_t> placed;
+    for (uint32_t r : order) {
+        Resource &resource = m_resources[r];
+        std::vector<uint32_t> conflicts;
+        for (uint32_t other : placed) {
+            Resource const &o = m_resources[other];
+            if (o.desc.heapGroup == resource.desc.heapGroup && LifetimesOverlap(resource.firstPass, resource.lastPass, o.firstPass, o.lastPass)) conflicts.push_back(other);
+        }
+        std::sort(conflicts.begin(), conflicts.end(), [&](uint32_t a, uint32_t b) { return m_resources[a].offset < m_resources[b].offset; });
+
+        uint64_t offset = 0;
+        for (uint32_t other : conflicts) {
+            Resource const &o = m_resources[other];
+            offset            = AlignUp(offset, resource.desc.alignment);
+            if (offset + resource.desc.size <= o.offset) break;
+            offset = std::max(offset, o.offset + o.desc.size);
+        }
+        resource.offset = AlignUp(offset, resource.desc.alignment);
+        placed.push_back(r);
+
+        uint32_t group      = resource.desc.heapGroup;
+        m_heapSizes[group]  = std::max(m_heapSizes[group], resource.offset + resource.desc.size);
+        m_unaliasedSizes[group] += resource.desc.size;
+    }
+}
+
+void FrameGraph::DeriveBarriers() {
+    auto sharesMemory = [&](uint32_t a, uint32_t b) {
+        Resource const &ra = m_resources[a];
+        Resource const &rb = m_resources[b];
+        return a != b && !ra.desc.imported && !rb.desc.imported && ra.firstPass != FRAME_GRAPH_INVALID && rb.firstPass != FRAME_GRAPH_INVALID &&
+               ra.desc.heapGroup == rb.desc.heapGroup && ra.offset < rb.offset + rb.desc.size && rb.offset < ra.offset + ra.desc.size;
+    };
+
+    std::vector<FrameGraphAccess> state(m_resources.size(), FrameGraphAccess::Common);
+    std::vector<bool>             written(m_resources.size(), false);
+    for (uint32_t p = 0; p < m_passes.size(); p++) {
+        Pass &pass = m_passes[p];
+        pass.barriers.clear();
+        if (pass.culled) continue;
+
+        std::vector<FrameGraphBarrier> aliasing;
+        for (ResourceUse const &use : pass.uses) {
+            Resource const &resource = m_resources[use.resource];
+            if (!resource.desc.imported && resource.firstPass == p) {
+                // The last user of the memory in this frame goes before, any user of the previous frame when nothing
+                // used it yet or when several resources did.
+                bool     aliased  = false;
+                uint32_t before   = FRAME_GRAPH_INVALID;
+                uint32_t lastPass = 0;
+                uint32_t lastUses = 0;
+                for (uint32_t other = 0; other < m_resources.size(); other++) {
+                    if (!sharesMemory(use.resource, other)) continue;
+                    aliased = true;
+                    uint32_t otherLast = m_resources[other].lastPass;
+                    if (otherLast >= p) continue;
+                    if (lastUses == 0 || otherLast > lastPass) {
+                        before   = other;
+                        lastPass = otherLast;
+                        lastUses = 1;
+                    } else if (otherLast == lastPass) {
+                        lastUses++;
+                    }
+                }
+                if (aliased) {
+                    FrameGraphBarrier barrier;
+                    barrier.type     = FrameGraphBarrierType::Aliasing;
+                    barrier.resource = use.resource;
+                    barrier.before   = lastUses == 1 ? before : FRAME_GRAPH_INVALID;
+                    aliasing.push_back(barrier);
+                }
+            }
+
+            FrameGraphBarrier barrier;
+            barrier.resource = use.resource;
+            barrier.from     = state[use.resource];
+            barrier.to       = use.access;
+            if (state[use.resource] != use.access) {
+                barrier.type = FrameGraphBarrierType::Transition;
+                pass.barriers.push_back(barrier);
+            } else if (use.access == FrameGraphAccess::UnorderedAccess && written[use.resource]) {
+                barrier.type = FrameGraphBarrierType::UnorderedAccess;
+                pass.barriers.push_back(barrier);
+            }
+            state[use.resource]   = use.access;
+            written[use.resource] = use.write;
+        }
+        pass.barriers.insert(pass.barriers.begin(), aliasing.begin(), aliasing.end());
+    }
+}
+
+bool FrameGraph::ValidatePlacement(std::string *pError) const {
+    for (uint32_t a = 0; a < m_resources.size(); a++) {
+        Resource const &ra = m_resources[a];
+        if (ra.desc.imported || ra.firstPass == FRAME_GRAPH_INVALID) continue;
+        if (ra.offset % ra.desc.alignment != 0 || ra.offset + ra.desc.size > m_heapSizes[ra.desc.heapGroup]) {
+            if (pError) *pError = "'" + ra.desc.name + "' is misaligned or does not fit its heap";
+            return false;
+        }
+        for (uint32_t b = a + 1; b < m_resources.size(); b++) {
+            Resource const &rb = m_resources[b];
+            if (rb.desc.imported || rb.firstPass == FRAME_GRAPH_INVALID || rb.desc.heapGroup != ra.desc.heapGroup) continue;
+            bool memory = ra.offset < rb.offset + rb.desc.size && rb.offset < ra.offset + ra.desc.size;
+            if (memory && LifetimesOverlap(ra.firstPass, ra.lastPass, rb.firstPass, rb.lastPass)) {
+                if (pError) *pError = "'" + ra.desc.name + "' and '" + rb.desc.name + "' are alive at the same time in overlapping memory";
+                return false;
+            }
+        }
+    }
+    return true;
+}
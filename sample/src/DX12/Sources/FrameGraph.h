@@ -0,0 +1,138 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+        Frame graph of the passes of one frame, independent of the graphics API.
+
+        Passes are declared in execution order with the resources they read and write. Compile culls the passes
+        nothing depends on, computes the lifetime of every transient resource, places the transient resources of each
+        heap group in a shared heap so that resources with disjoint lifetimes share memory, and derives the barriers
+        each pass needs before it runs.
+
+        Imported resources live outside of the graph (histories, counters, outputs): they are never aliased, and a pass
+        that writes one is never culled. Transient resources only live within the frame, their contents are undefined
+        before their first pass.
+*/
+
+static const uint32_t FRAME_GRAPH_INVALID = 0xffffffffu;
+
+// How a pass accesses a resource, the backend maps it to its own states.
+enum class FrameGraphAccess {
+    Common, // State of every resource before its first pass in the frame.
+    ShaderRead,
+    UnorderedAccess,
+    IndirectArgument,
+    CopySource,
+    CopyDest,
+};
+
+char const *GetFrameGraphAccessName(FrameGraphAccess access);
+
+struct FrameGraphResourceDesc {
+    std::string name;
+    uint64_t    size      = 0; // Bytes the resource takes in a heap, from the backend.
+    uint64_t    alignment = 1; // Power of two.
+    uint32_t    heapGroup = 0; // Transient resources only share heaps within a group, e.g. buffers and textures on D3D12 resource heap tier 1.
+    bool        imported  = false;
+};
+
+enum class FrameGraphBarrierType {
+    Aliasing,   // 'resource' takes over memory 'before' used last, FRAME_GRAPH_INVALID when it was unused so far.
+    Transition, // 'resource' goes from 'from' to 'to'.
+    UnorderedAccess,
+};
+
+struct FrameGraphBarrier {
+    FrameGraphBarrierType type     = FrameGraphBarrierType::Transition;
+    uint32_t              resource = FRAME_GRAPH_INVALID;
+    uint32_t              before   = FRAME_GRAPH_INVALID;
+    FrameGraphAccess      from     = FrameGraphAccess::Common;
+    FrameGraphAccess      to       = FrameGraphAccess::Common;
+};
+
+class FrameGraph {
+public:
+    uint32_t AddResource(FrameGraphResourceDesc const &desc);
+    uint32_t AddPass(std::string const &name);
+
+    // A pass uses a resource in one way, the last Read/Write of the same resource wins.
+    void Read(uint32_t pass, uint32_t resource, FrameGraphAccess access = FrameGraphAccess::ShaderRead);
+    void Write(uint32_t pass, uint32_t resource, FrameGraphAccess access = FrameGraphAccess::UnorderedAccess);
+
+    // Returns false with a message if a transient resource is read before any pass writes it.
+    bool Compile(std::string *pError = nullptr);
+
+    uint32_t                      GetResourceCount() const { return uint32_t(m_resources.size()); }
+    uint32_t                      GetPassCount() const { return uint32_t(m_passes.size()); }
+    FrameGraphResourceDesc const &GetResource(uint32_t resource) const { return m_resources[resource].desc; }
+    std::string const &           GetPassName(uint32_t pass) const { return m_passes[pass].name; }
+
+    // Results of Compile.
+    bool     IsPassCulled(uint32_t pass) const { return m_passes[pass].culled; }
+    uint32_t GetFirstPass(uint32_t resource) const { return m_resources[resource].firstPass; } // FRAME_GRAPH_INVALID when unused.
+    uint32_t GetLastPass(uint32_t resource) const { return m_resources[resource].lastPass; }
+    uint64_t GetHeapOffset(uint32_t resource) const { return m_resources[resource].offset; } // Transient resources only.
+    uint32_t GetHeapGroupCount() const { return uint32_t(m_heapSizes.size()); }
+    uint64_t GetHeapSize(uint32_t heapGroup) const { return m_heapSizes[heapGroup]; }
+    // Size of the used transient resources of a group without aliasing.
+    uint64_t GetUnaliasedSize(uint32_t heapGroup) const { return m_unaliasedSizes[heapGroup]; }
+    // Barriers to issue before the pass, aliasing barriers first.
+    std::vector<FrameGraphBarrier> const &GetBarriers(uint32_t pass) const { return m_passes[pass].barriers; }
+
+    // Checks the placement: transient resources of a group whose lifetimes overlap never overlap in memory, and every
+    // resource fits its heap at its alignment.
+    bool ValidatePlacement(std::string *pError = nullptr) const;
+
+private:
+    struct ResourceUse {
+        uint32_t         resource;
+        FrameGraphAccess access;
+        bool             write;
+    };
+    struct Pass {
+        std::string                    name;
+        std::vector<ResourceUse>       uses;
+        bool                           culled = false;
+        std::vector<FrameGraphBarrier> barriers;
+    };
+    struct Resource {
+        FrameGraphResourceDesc desc;
+        uint32_t               firstPass = FRAME_GRAPH_INVALID;
+        uint32_t               lastPass  = FRAME_GRAPH_INVALID;
+        uint64_t               offset    = 0;
+    };
+
+    void AddUse(uint32_t pass, uint32_t resource, FrameGraphAccess access, bool write);
+    void CullPasses();
+    void PlaceTransients();
+    void DeriveBarriers();
+
+    std::vector<Pass>     m_passes;
+    std::vector<Resource> m_resources;
+    std::vector<uint64_t> m_heapSizes;
+    std::vector<uint64_t> m_unaliasedSizes;
+};
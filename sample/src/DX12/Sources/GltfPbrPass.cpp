@@ -545,6 +545,8 @@ void RTGltfPbrPass::CreateDescriptorTableForMaterialTextures(PBRMaterial *tfmat,
         tfmat->m_pbrMaterialParameters.m_defines["ID_shadowMap"] = std::to_string(9);
         CreateSamplerForShadowMap(9, &tfmat->m_samplers[cnt]);
     }
+    // the light lists follow the shadows in the same table, see ClusteredLights.h
+    tfmat->m_pbrMaterialParameters.m_defines["ID_clusteredLights"] = std::to_string(10);
 }
 
 //--------------------------------------------------------------------------------------
@@ -612,7 +614,7 @@ void RTGltfPbrPass::CreateRootSignature(bool bUsingSkinning, DefineList &defines
 
     // shadow buffer (only if we are doing lighting, for example in the forward pass)
     if (m_doLighting) {
-        descRange[desccRangeCnt].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, MaxShadowInstances, 9); // shadow buffer
+        descRange[desccRangeCnt].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 9); // shadow atlas and clustered lights
         rootParameter[rootParamCnt].InitAsDescriptorTable(1, &descRange[desccRangeCnt], D3D12_SHADER_VISIBILITY_PIXEL);
         desccRangeCnt++;
         rootParamCnt++;
@@ -0,0 +1,264 @@
+// AMD Cauldron code
+//
+// Copyright(c) 2021 Advanced Micro Devices, Inc.All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "stdafx.h"
+
+#include "Base/ShaderCompilerHelper.h"
+#include "GLTF/GltfHelpers.h"
+#include "GltfShadowDepthPass.h"
+
+namespace RTCAULDRON_DX12 {
+//--------------------------------------------------------------------------------------
+//
+// OnCreate
+//
+//--------------------------------------------------------------------------------------
+void GltfShadowDepthPass::OnCreate(Device *pDevice, UploadHeap *pUploadHeap, ResourceViewHeaps *pHeaps, DynamicBufferRing *pDynamicBufferRing,
+                                   StaticBufferPool *pStaticBufferPool, GLTFTexturesAndBuffers *pGLTFTexturesAndBuffers, AsyncPool *pAsyncPool) {
+    m_pDevice                 = pDevice;
+    m_pResourceViewHeaps      = pHeaps;
+    m_pDynamicBufferRing      = pDynamicBufferRing;
+    m_pGLTFTexturesAndBuffers = pGLTFTexturesAndBuffers;
+
+    const json &j3 = m_pGLTFTexturesAndBuffers->m_pGLTFCommon->j3;
+
+    // Materials only matter for the alpha test and the culling mode
+    //
+    if (j3.find("materials") != j3.end()) {
+        const json &materials = j3["materials"];
+        m_materialsData.resize(materials.size());
+        for (uint32_t i = 0; i < materials.size(); i++) {
+            const json &         material = materials[i];
+            ShadowDepthMaterial *tfmat    = &m_materialsData[i];
+
+            tfmat->m_doubleSided = GetElementBoolean(material, "doubleSided", false);
+            if (GetElementString(material, "alphaMode", "OPAQUE") != "MASK") continue;
+
+            int id = GetElementInt(material, "pbrMetallicRoughness/baseColorTexture/index", -1);
+            if (id < 0) continue;
+            tfmat->m_textureCount = 1;
+            m_pResourceViewHeaps->AllocCBV_SRV_UAVDescriptor(tfmat->m_textureCount, &tfmat->m_texturesTable);
+            m_pGLTFTexturesAndBuffers->GetTextureViewByID(id)->CreateSRV(0, &tfmat->m_texturesTable);
+            CreateSamplerForPBR(0, &tfmat->m_sampler);
+            tfmat->m_defines["ID_baseColorTexture"] = "0";
+            tfmat->m_defines["ID_baseTexCoord"]     = std::to_string(GetElementInt(material, "pbrMetallicRoughness/baseColorTexture/texCoord", 0));
+            tfmat->m_defines["DEF_alphaCutoff"]     = std::to_string(GetElementFloat(material, "alphaCutoff", 0.5f));
+        }
+    }
+
+    // Load Meshes, only the attributes the depth needs
+    //
+    if (j3.find("meshes") != j3.end()) {
+        const json &meshes = j3["meshes"];
+        m_meshes.resize(meshes.size());
+        for (uint32_t i = 0; i < meshes.size(); i++) {
+            const json &primitives = meshes[i]["primitives"];
+
+            ShadowDepthMesh *tfmesh = &m_meshes[i];
+            tfmesh->m_pPrimitives.resize(primitives.size());
+            for (uint32_t p = 0; p < primitives.size(); p++) {
+                const json &           primitive  = primitives[p];
+                ShadowDepthPrimitives *pPrimitive = &tfmesh->m_pPrimitives[p];
+
+                auto mat                = primitive.find("material");
+                pPrimitive->m_pMaterial = (mat != primitive.end()) ? &m_materialsData[mat.value()] : &m_defaultMaterial;
+
+                // The alpha test needs the texture coordinates of the base color texture, without them the primitive is opaque
+                DefineList  defines = pPrimitive->m_pMaterial->m_defines;
+                std::string texCoord;
+                if (pPrimitive->m_pMaterial->m_textureCount > 0) texCoord = "TEXCOORD_" + defines["ID_baseTexCoord"];
+                bool const bAlphaTested    = !texCoord.empty() && primitive["attributes"].find(texCoord) != primitive["attributes"].end();
+                pPrimitive->m_bAlphaTested = bAlphaTested;
+                if (!bAlphaTested) defines = DefineList();
+
+                std::vector<std::string> requiredAttributes;
+                for (auto const &it : primitive["attributes"].items()) {
+                    const std::string semanticName = it.key();
+                    if (semanticName == "POSITION" || semanticName.substr(0, 7) == "WEIGHTS" || semanticName.substr(0, 6) == "JOINTS" || (bAlphaTested && semanticName == texCoord))
+                        requiredAttributes.push_back(semanticName);
+                }
+
+                std::vector<std::string>              semanticNames;
+                std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
+                m_pGLTFTexturesAndBuffers->CreateGeometry(primitive, requiredAttributes, semanticNames, inputLayout, defines, &pPrimitive->m_geometry);
+
+                bool bUsingSkinning = m_pGLTFTexturesAndBuffers->m_pGLTFCommon->FindMeshSkinId(i) != -1;
+                CreateRootSignature(bUsingSkinning, bAlphaTested, defines, pPrimitive);
+                CreatePipeline(inputLayout, defines, bAlphaTested, pPrimitive);
+            }
+        }
+    }
+
+    // The casters in scene order, the same enumeration as the world boxes SampleRenderer culls
+    //
+    std::vector<tfNode> const &nodes = m_pGLTFTexturesAndBuffers->m_pGLTFCommon->m_nodes;
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].meshIndex < 0) continue;
+        for (uint32_t p = 0; p < m_meshes[nodes[i].meshIndex].m_pPrimitives.size(); p++) m_casters.push_back({i, p});
+    }
+}
+
+//--------------------------------------------------------------------------------------
+//
+// OnDestroy
+//
+//--------------------------------------------------------------------------------------
+void GltfShadowDepthPass::OnDestroy() {
+    for (ShadowDepthMesh &mesh : m_meshes) {
+        for (ShadowDepthPrimitives &primitive : mesh.m_pPrimitives) {
+            if (primitive.m_PipelineRender) primitive.m_PipelineRender->Release();
+            if (primitive.m_RootSignature) primitive.m_RootSignature->Release();
+        }
+    }
+    m_meshes.clear();
+    m_casters.clear();
+}
+
+//--------------------------------------------------------------------------------------
+//
+// CreateRootSignature
+//
+//--------------------------------------------------------------------------------------
+void GltfShadowDepthPass::CreateRootSignature(bool bUsingSkinning, bool bAlphaTested, DefineList &defines, ShadowDepthPrimitives *pPrimitive) {
+    int                      rootParamCnt = 0;
+    CD3DX12_ROOT_PARAMETER   rootParameter[4];
+    CD3DX12_DESCRIPTOR_RANGE descRange[1];
+
+    // b0 <- Constant buffer 'per frame', the light's view projection
+    rootParameter[rootParamCnt++].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+
+    // b1 <- Constant buffer 'per object'
+    rootParameter[rootParamCnt++].InitAsConstantBufferView(1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+
+    // b2 <- Constant buffer holding the skinning matrices
+    if (bUsingSkinning) {
+        rootParameter[rootParamCnt++].InitAsConstantBufferView(2, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+        defines["ID_SKINNING_MATRICES"] = std::to_string(2);
+    }
+
+    // t0 <- base color texture of the alpha test
+    if (bAlphaTested) {
+        descRange[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+        rootParameter[rootParamCnt++].InitAsDescriptorTable(1, &descRange[0], D3D12_SHADER_VISIBILITY_PIXEL);
+    }
+
+    CD3DX12_ROOT_SIGNATURE_DESC descRootSignature = CD3DX12_ROOT_SIGNATURE_DESC();
+    descRootSignature.pParameters                 = rootParameter;
+    descRootSignature.NumParameters               = rootParamCnt;
+    descRootSignature.pStaticSamplers             = bAlphaTested ? &pPrimitive->m_pMaterial->m_sampler : NULL;
+    descRootSignature.NumStaticSamplers           = bAlphaTested ? 1 : 0;
+
+    // deny uneccessary access to certain pipeline stages
+    descRootSignature.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE | D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+                              D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS | D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+                              D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+    ID3DBlob *pOutBlob, *pErrorBlob = NULL;
+    ThrowIfFailed(D3D12SerializeRootSignature(&descRootSignature, D3D_ROOT_SIGNATURE_VERSION_1, &pOutBlob, &pErrorBlob));
+    ThrowIfFailed(m_pDevice->GetDevice()->CreateRootSignature(0, pOutBlob->GetBufferPointer(), pOutBlob->GetBufferSize(), IID_PPV_ARGS(&pPrimitive->m_RootSignature)));
+    SetName(pPrimitive->m_RootSignature, "GltfShadowDepthPass::m_RootSignature");
+
+    pOutBlob->Release();
+    if (pErrorBlob) pErrorBlob->Release();
+}
+
+//--------------------------------------------------------------------------------------
+//
+// CreatePipeline
+//
+//--------------------------------------------------------------------------------------
+void GltfShadowDepthPass::CreatePipeline(std::vector<D3D12_INPUT_ELEMENT_DESC> layout, const DefineList &defines, bool bAlphaTested, ShadowDepthPrimitives *pPrimitive) {
+    D3D12_SHADER_BYTECODE shaderVert = {}, shaderPixel = {};
+    CompileShaderFromFile("GLTFShadowDepthPass.hlsl", &defines, "mainVS", "-T vs_6_0 -Zi -Od", &shaderVert);
+    if (bAlphaTested) CompileShaderFromFile("GLTFShadowDepthPass.hlsl", &defines, "mainPS", "-T ps_6_0 -Zi -Od", &shaderPixel);
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC descPso = {};
+    descPso.InputLayout                        = {layout.data(), (UINT)layout.size()};
+    descPso.pRootSignature                     = pPrimitive->m_RootSignature;
+    descPso.VS                                 = shaderVert;
+    descPso.PS                                 = shaderPixel;
+    descPso.RasterizerState                    = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+    descPso.RasterizerState.CullMode           = pPrimitive->m_pMaterial->m_doubleSided ? D3D12_CULL_MODE_NONE : D3D12_CULL_MODE_FRONT;
+    descPso.BlendState                         = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+    descPso.DepthStencilState                  = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+    descPso.DepthStencilState.DepthFunc        = D3D12_COMPARISON_FUNC_LESS_EQUAL;
+    descPso.SampleMask                         = UINT_MAX;
+    descPso.PrimitiveTopologyType              = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    descPso.NumRenderTargets                   = 0;
+    descPso.DSVFormat                          = DXGI_FORMAT_D32_FLOAT;
+    descPso.SampleDesc.Count                   = 1;
+    descPso.NodeMask                           = 0;
+
+    ThrowIfFailed(m_pDevice->GetDevice()->CreateGraphicsPipelineState(&descPso, IID_PPV_ARGS(&pPrimitive->m_PipelineRender)));
+    SetName(pPrimitive->m_PipelineRender, "GltfShadowDepthPass::m_PipelineRender");
+}
+
+//--------------------------------------------------------------------------------------
+//
+// DrawCasters
+//
+//--------------------------------------------------------------------------------------
+void GltfShadowDepthPass::DrawCasters(ID3D12GraphicsCommandList *pCommandList, math::Matrix4 const &lightViewProj, std::vector<uint32_t> const &casters) {
+    UserMarker marker(pCommandList, "GltfShadowDepthPass::DrawCasters");
+
+    pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12DescriptorHeap *pDescriptorHeaps[] = {m_pResourceViewHeaps->GetCBV_SRV_UAVHeap(), m_pResourceViewHeaps->GetSamplerHeap()};
+    pCommandList->SetDescriptorHeaps(2, pDescriptorHeaps);
+
+    per_frame cbPerFrame;
+    cbPerFrame.mLightViewProj              = lightViewProj;
+    D3D12_GPU_VIRTUAL_ADDRESS perFrameDesc = m_pDynamicBufferRing->AllocConstantBuffer(sizeof(per_frame), &cbPerFrame);
+
+    std::vector<tfNode> const &nodes          = m_pGLTFTexturesAndBuffers->m_pGLTFCommon->m_nodes;
+    Matrix2 *                  pNodesMatrices = m_pGLTFTexturesAndBuffers->m_pGLTFCommon->m_worldSpaceMats.data();
+    ID3D12PipelineState *      pCurBoundPSO   = NULL;
+    for (uint32_t index : casters) {
+        Caster const &         caster     = m_casters[index];
+        tfNode const &         node       = nodes[caster.node];
+        ShadowDepthPrimitives *pPrimitive = &m_meshes[node.meshIndex].m_pPrimitives[caster.primitive];
+        if (pPrimitive->m_PipelineRender == NULL) continue;
+
+        per_object cbPerObject;
+        cbPerObject.mWorld                      = pNodesMatrices[caster.node].GetCurrent();
+        D3D12_GPU_VIRTUAL_ADDRESS perObjectDesc = m_pDynamicBufferRing->AllocConstantBuffer(sizeof(per_object), &cbPerObject);
+
+        if (pPrimitive->m_PipelineRender != pCurBoundPSO) {
+            pCommandList->SetPipelineState(pPrimitive->m_PipelineRender);
+            pCurBoundPSO = pPrimitive->m_PipelineRender;
+        }
+        pPrimitive->DrawPrimitive(pCommandList, perFrameDesc, perObjectDesc, m_pGLTFTexturesAndBuffers->GetSkinningMatricesBuffer(node.skinIndex));
+    }
+}
+
+void ShadowDepthPrimitives::DrawPrimitive(ID3D12GraphicsCommandList *pCommandList, D3D12_GPU_VIRTUAL_ADDRESS perFrameDesc, D3D12_GPU_VIRTUAL_ADDRESS perObjectDesc,
+                                          D3D12_GPU_VIRTUAL_ADDRESS pPerSkeleton) {
+    pCommandList->IASetIndexBuffer(&m_geometry.m_IBV);
+    pCommandList->IASetVertexBuffers(0, (UINT)m_geometry.m_VBV.size(), m_geometry.m_VBV.data());
+
+    // Same order as CreateRootSignature
+    pCommandList->SetGraphicsRootSignature(m_RootSignature);
+    int paramIndex = 0;
+    pCommandList->SetGraphicsRootConstantBufferView(paramIndex++, perFrameDesc);
+    pCommandList->SetGraphicsRootConstantBufferView(paramIndex++, perObjectDesc);
+    if (pPerSkeleton != 0) pCommandList->SetGraphicsRootConstantBufferView(paramIndex++, pPerSkeleton);
+    if (m_bAlphaTested) pCommandList->SetGraphicsRootDescriptorTable(paramIndex++, m_pMaterial->m_texturesTable.GetGPU());
+
+    pCommandList->DrawIndexedInstanced(m_geometry.m_NumIndices, 1, 0, 0, 0);
+}
+} // namespace RTCAULDRON_DX12
@@ -0,0 +1,99 @@
+// AMD Cauldron code
+//
+// Copyright(c) 2021 Advanced Micro Devices, Inc.All rights reserved.
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+#include "GLTF/GLTFTexturesAndBuffers.h"
+
+#include <vector>
+
+namespace RTCAULDRON_DX12 {
+
+/**
+        Depth only pass of the shadow atlas that draws a given list of casters instead of the whole scene, as Cauldron's
+        GltfDepthPass does. A caster is one primitive of a node with a mesh, numbered node by node in scene order, which
+        is the order of GetCasters. SampleRenderer culls the casters of each light against its frustum and only draws
+        the ones that are left (ShadowCulling.h).
+
+        Alpha masked materials test the alpha of their base color texture, everything else only writes depth.
+*/
+struct ShadowDepthMaterial {
+    bool        m_doubleSided  = false;
+    int         m_textureCount = 0; // 1 with the base color texture of an alpha masked material
+    CBV_SRV_UAV m_texturesTable;
+    DefineList  m_defines;
+
+    D3D12_STATIC_SAMPLER_DESC m_sampler;
+};
+
+struct ShadowDepthPrimitives {
+    Geometry m_geometry;
+
+    ShadowDepthMaterial *m_pMaterial    = NULL;
+    bool                 m_bAlphaTested = false; // the material masks and the primitive has the texture coordinates to test
+
+    ID3D12RootSignature *m_RootSignature  = NULL;
+    ID3D12PipelineState *m_PipelineRender = NULL;
+
+    void DrawPrimitive(ID3D12GraphicsCommandList *pCommandList, D3D12_GPU_VIRTUAL_ADDRESS perFrameDesc, D3D12_GPU_VIRTUAL_ADDRESS perObjectDesc,
+                       D3D12_GPU_VIRTUAL_ADDRESS pPerSkeleton);
+};
+
+struct ShadowDepthMesh {
+    std::vector<ShadowDepthPrimitives> m_pPrimitives;
+};
+
+class GltfShadowDepthPass {
+public:
+    struct per_frame {
+        math::Matrix4 mLightViewProj;
+    };
+
+    struct per_object {
+        math::Matrix4 mWorld;
+    };
+
+    struct Caster {
+        uint32_t node;
+        uint32_t primitive;
+    };
+
+    void OnCreate(Device *pDevice, UploadHeap *pUploadHeap, ResourceViewHeaps *pHeaps, DynamicBufferRing *pDynamicBufferRing, StaticBufferPool *pStaticBufferPool,
+                  GLTFTexturesAndBuffers *pGLTFTexturesAndBuffers, AsyncPool *pAsyncPool = NULL);
+    void OnDestroy();
+
+    std::vector<Caster> const &GetCasters() const { return m_casters; }
+
+    // Draws the casters listed by their index in GetCasters into the bound depth target, seen from 'lightViewProj'.
+    void DrawCasters(ID3D12GraphicsCommandList *pCommandList, math::Matrix4 const &lightViewProj, std::vector<uint32_t> const &casters);
+
+private:
+    Device *                m_pDevice                 = NULL;
+    ResourceViewHeaps *     m_pResourceViewHeaps      = NULL;
+    DynamicBufferRing *     m_pDynamicBufferRing      = NULL;
+    GLTFTexturesAndBuffers *m_pGLTFTexturesAndBuffers = NULL;
+
+    std::vector<ShadowDepthMesh>     m_meshes;
+    std::vector<ShadowDepthMaterial> m_materialsData;
+    ShadowDepthMaterial              m_defaultMaterial;
+    std::vector<Caster>              m_casters;
+
+    void CreateRootSignature(bool bUsingSkinning, bool bAlphaTested, DefineList &defines, ShadowDepthPrimitives *pPrimitive);
+    void CreatePipeline(std::vector<D3D12_INPUT_ELEMENT_DESC> layout, const DefineList &defines, bool bAlphaTested, ShadowDepthPrimitives *pPrimitive);
+};
+} // namespace RTCAULDRON_DX12
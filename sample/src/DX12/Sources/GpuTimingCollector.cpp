@@ -0,0 +1,192 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "GpuTimingCollector.h"
+
+#include <algorithm>
+#include <cassert>
+
+void GpuTimingCollector::OnCreate(GpuTimestampSource *pSource, uint32_t frameLatency, uint32_t maxQueriesPerFrame, uint32_t statsWindow) {
+    m_pSource            = pSource;
+    m_maxQueriesPerFrame = maxQueriesPerFrame;
+    m_statsWindow        = std::max(statsWindow, 1u);
+    m_slots.assign(std::max(frameLatency, 1u), Slot());
+    m_currentSlot = 0;
+    m_inFrame     = false;
+    m_ticks.resize(maxQueriesPerFrame);
+}
+
+void GpuTimingCollector::OnDestroy() {
+    m_pSource = nullptr;
+    m_slots.clear();
+    m_openRecords.clear();
+    m_scopes.clear();
+    m_windows.clear();
+    m_scopeIds.clear();
+    m_frameUs     = 0.0;
+    m_resultFrame = -1;
+}
+
+void GpuTimingCollector::BeginFrame(uint64_t frame) {
+    assert(!m_inFrame);
+    if (!m_pSource) return;
+
+    m_currentSlot = uint32_t(frame % m_slots.size());
+    Slot &slot    = m_slots[m_currentSlot];
+    if (slot.resolved) ReadBack(slot, m_currentSlot);
+
+    slot.frame      = int64_t(frame);
+    slot.resolved   = false;
+    slot.queryCount = 0;
+    slot.records.clear();
+    m_openRecords.clear();
+    m_inFrame = true;
+}
+
+void GpuTimingCollector::EndFrame() {
+    if (!m_inFrame) return;
+    assert(m_openRecords.empty());
+    Slot &slot = m_slots[m_currentSlot];
+    if (slot.queryCount > 0) {
+        m_pSource->ResolveTimestamps(m_currentSlot, slot.queryCount);
+        slot.resolved = true;
+    }
+    m_inFrame = false;
+}
+
+int GpuTimingCollector::BeginScope(char const *name) {
+    if (!m_inFrame) return -1;
+    Slot &slot = m_slots[m_currentSlot];
+    if (slot.queryCount + 2 > m_maxQueriesPerFrame) {
+        m_openRecords.push_back(-1);
+        return -1;
+    }
+
+    int parent = -1;
+    for (auto it = m_openRecords.rbegin(); it != m_openRecords.rend() && parent < 0; ++it)
+        if (*it >= 0) parent = slot.records[*it].scope;
+
+    auto key = std::make_pair(parent, std::string(name));
+    auto it  = m_scopeIds.find(key);
+    int  scope;
+    if (it == m_scopeIds.end()) {
+        scope = (int)m_scopes.size();
+        m_scopes.push_back({name, parent, parent < 0 ? 0 : m_scopes[parent].depth + 1, GpuTimingStats()});
+        m_windows.push_back(Window());
+        m_scopeIds[key] = scope;
+    } else {
+        scope = it->second;
+    }
+
+    m_pSource->WriteTimestamp(m_currentSlot, slot.queryCount);
+    slot.records.push_back({scope, slot.queryCount, 0});
+    slot.queryCount += 2; // The end query is reserved up front so nested scopes can not starve it.
+    m_openRecords.push_back((int)slot.records.size() - 1);
+    return scope;
+}
+
+void GpuTimingCollector::EndScope() {
+    if (!m_inFrame || m_openRecords.empty()) return;
+    int record = m_openRecords.back();
+    m_openRecords.pop_back();
+    if (record < 0) return;
+    Slot &slot               = m_slots[m_currentSlot];
+    slot.records[record].end = slot.records[record].begin + 1;
+    m_pSource->WriteTimestamp(m_currentSlot, slot.records[record].end);
+}
+
+void GpuTimingCollector::ReadBack(Slot &slot, uint32_t slotIndex) {
+    if (!m_pSource->ReadTimestamps(slotIndex, slot.queryCount, m_ticks.data())) return;
+
+    double usPerTick = 1000000.0 / double(m_pSource->GetFrequency());
+    for (auto &scope : m_scopes) scope.stats.lastUs = 0.0;
+
+    uint64_t first = UINT64_MAX, last = 0;
+    for (auto const &record : slot.records) {
+        uint64_t begin = m_ticks[record.begin];
+        uint64_t end   = m_ticks[record.end];
+        // A scope can be recorded several times a frame, its durations add up.
+        double us = end > begin ? double(end - begin) * usPerTick : 0.0;
+        m_scopes[record.scope].stats.lastUs += us;
+        first = std::min(first, begin);
+        last  = std::max(last, end);
+    }
+    std::vector<bool> seen(m_scopes.size(), false);
+    for (auto const &record : slot.records) {
+        if (seen[record.scope]) continue;
+        seen[record.scope] = true;
+        AddSample(record.scope, m_scopes[record.scope].stats.lastUs);
+    }
+    m_frameUs     = last > first ? double(last - first) * usPerTick : 0.0;
+    m_resultFrame = slot.frame;
+    slot.resolved = false;
+}
+
+void GpuTimingCollector::AddSample(int scope, double us) {
+    Window &window = m_windows[scope];
+    if (window.samples.size() < m_statsWindow)
+        window.samples.push_back(us);
+    else
+        window.samples[window.next] = us;
+    window.next = (window.next + 1) % m_statsWindow;
+
+    GpuTimingStats &stats = m_scopes[scope].stats;
+    stats.samples         = (uint32_t)window.samples.size();
+    stats.minUs           = *std::min_element(window.samples.begin(), window.samples.end());
+    stats.maxUs           = *std::max_element(window.samples.begin(), window.samples.end());
+    double sum            = 0.0;
+    for (double sample : window.samples) sum += sample;
+    stats.avgUs = sum / double(window.samples.size());
+}
+
+std::vector<int> GpuTimingCollector::GetScopeOrder() const {
+    std::vector<int> order;
+    std::vector<int> stack;
+    for (int scope = (int)m_scopes.size() - 1; scope >= 0; scope--)
+        if (m_scopes[scope].parent < 0) stack.push_back(scope);
+    while (!stack.empty()) {
+        int scope = stack.back();
+        stack.pop_back();
+        order.push_back(scope);
+        for (int child = (int)m_scopes.size() - 1; child > scope; child--)
+            if (m_scopes[child].parent == scope) stack.push_back(child);
+    }
+    return order;
+}
+
+int GpuTimingCollector::FindScope(std::string const &path) const {
+    int    scope = -1;
+    size_t begin = 0;
+    while (begin <= path.size()) {
+        size_t end = path.find('/', begin);
+        if (end == std::string::npos) end = path.size();
+        auto it = m_scopeIds.find(std::make_pair(scope, path.substr(begin, end - begin)));
+        if (it == m_scopeIds.end()) return -1;
+        scope = it->second;
+        begin = end + 1;
+    }
+    return scope;
+}
+
+double GpuTimingCollector::GetLastUs(std::string const &path) const {
+    int scope = FindScope(path);
+    return scope < 0 ? 0.0 : m_scopes[scope].stats.lastUs;
+}
@@ -0,0 +1,146 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+        Where the timestamps come from. The collector owns one query range per ring slot and only talks to the GPU
+        through this interface, the D3D12 implementation writes EndQuery into a query heap and resolves into a
+        readback buffer.
+*/
+class GpuTimestampSource {
+public:
+    virtual ~GpuTimestampSource() {}
+
+    // Clock rate of the timestamps in ticks per second.
+    virtual uint64_t GetFrequency() const = 0;
+    // Records the current GPU time into query 'index' of ring slot 'slot'.
+    virtual void WriteTimestamp(uint32_t slot, uint32_t index) = 0;
+    // Copies the first 'count' queries of 'slot' to where ReadTimestamps can see them once the GPU is done.
+    virtual void ResolveTimestamps(uint32_t slot, uint32_t count) = 0;
+    // Reads back resolved queries. Only called for slots whose frame the GPU has finished.
+    virtual bool ReadTimestamps(uint32_t slot, uint32_t count, uint64_t *pTicks) = 0;
+};
+
+struct GpuTimingStats {
+    double   lastUs  = 0.0; // Duration in the most recently read back frame, 0 if the scope was not recorded there.
+    double   minUs   = 0.0; // Rolling statistics over the frames the scope was recorded in.
+    double   avgUs   = 0.0;
+    double   maxUs   = 0.0;
+    uint32_t samples = 0;
+};
+
+struct GpuTimingScope {
+    std::string    name;
+    int            parent; // -1 for top level scopes.
+    int            depth;
+    GpuTimingStats stats;
+};
+
+/**
+        Hierarchical GPU timing. Scopes nest, each one is measured with its own begin and end timestamp, and are
+        identified by their path so "Intersection/HW" keeps its statistics between frames.
+
+        Queries of a frame go to ring slot frame % frameLatency. BeginFrame reads back the slot it is about to reuse,
+        i.e. the frame recorded frameLatency frames ago, which the caller guarantees the GPU has finished (the same
+        rule as for any other per frame resource). Results therefore lag by frameLatency frames and
+        GetResultFrame() tells which frame they belong to.
+*/
+class GpuTimingCollector {
+public:
+    void OnCreate(GpuTimestampSource *pSource, uint32_t frameLatency, uint32_t maxQueriesPerFrame, uint32_t statsWindow = 64);
+    void OnDestroy();
+
+    void BeginFrame(uint64_t frame);
+    void EndFrame();
+    // Scopes opened while another one is open become its children. Returns the scope id, or -1 when the frame
+    // ran out of queries.
+    int  BeginScope(char const *name);
+    void EndScope();
+
+    std::vector<GpuTimingScope> const &GetScopes() const { return m_scopes; }
+    // Scope ids parents first, children in the order they were first recorded, for printing the tree.
+    std::vector<int> GetScopeOrder() const;
+    // Path of names separated by '/', e.g. "Intersection/HW". Returns -1 if the scope was never recorded.
+    int    FindScope(std::string const &path) const;
+    double GetLastUs(std::string const &path) const;
+    // Begin of the first to end of the last scope of the frame that was read back last.
+    double GetFrameUs() const { return m_frameUs; }
+    // Frame number passed to BeginFrame for the current results, or -1 before the first readback.
+    int64_t GetResultFrame() const { return m_resultFrame; }
+
+private:
+    struct Record {
+        int      scope;
+        uint32_t begin;
+        uint32_t end;
+    };
+    struct Slot {
+        int64_t             frame      = -1;
+        bool                resolved   = false;
+        uint32_t            queryCount = 0;
+        std::vector<Record> records;
+    };
+    struct Window {
+        std::vector<double> samples;
+        size_t              next = 0;
+    };
+
+    void ReadBack(Slot &slot, uint32_t slotIndex);
+    void AddSample(int scope, double us);
+
+    GpuTimestampSource *                       m_pSource            = nullptr;
+    uint32_t                                   m_maxQueriesPerFrame = 0;
+    uint32_t                                   m_statsWindow        = 64;
+    std::vector<Slot>                          m_slots;
+    uint32_t                                   m_currentSlot = 0;
+    bool                                       m_inFrame     = false;
+    std::vector<int>                           m_openRecords;
+    std::vector<GpuTimingScope>                m_scopes;
+    std::vector<Window>                        m_windows;
+    std::map<std::pair<int, std::string>, int> m_scopeIds;
+    std::vector<uint64_t>                      m_ticks;
+    double                                     m_frameUs     = 0.0;
+    int64_t                                    m_resultFrame = -1;
+};
+
+// Opens a timing scope for the lifetime of the object, like UserMarker does for PIX markers.
+class GpuTimingScopeGuard {
+public:
+    GpuTimingScopeGuard(GpuTimingCollector *pCollector, char const *name)
+        : m_pCollector(pCollector) {
+        if (m_pCollector) m_pCollector->BeginScope(name);
+    }
+    ~GpuTimingScopeGuard() {
+        if (m_pCollector) m_pCollector->EndScope();
+    }
+    GpuTimingScopeGuard(GpuTimingScopeGuard const &) = delete;
+    GpuTimingScopeGuard &operator=(GpuTimingScopeGuard const &) = delete;
+
+private:
+    GpuTimingCollector *m_pCollector;
+};
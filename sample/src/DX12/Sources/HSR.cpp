@@ -23,8 +23,11 @@ THE SOFTWARE.
 
 #include "Base\ShaderCompilerHelper.h"
 #include "HSR.h"
+#include "MaterialBinning.h"
 #include "Utils.h"
 
+#include "../../Shaders/RayGbuffer.h"
+
 #define A_CPU
 #include "../../../../ffx-fsr/ffx-fsr/ffx_a.h"
 
@@ -58,10 +61,6 @@ HSR::HSR() {
     m_bufferIndex                  = 0;
     m_frameCountBeforeReuse        = 0;
     m_isPerformanceCountersEnabled = false;
-    m_timestampFrameIndex          = 0;
-
-    m_pTimestampQueryBuffer = nullptr;
-    m_pTimestampQueryHeap   = nullptr;
 }
 
 void HSR::OnCreate(Device *pDevice, ID3D12RootSignature *pGlobalRootSignature, StaticResourceViewHeap &cpuVisibleHeap, ResourceViewHeaps &resourceHeap, UploadHeap &uploadHeap,
@@ -76,8 +75,10 @@ void HSR::OnCreate(Device *pDevice, ID3D12RootSignature *pGlobalRootSignature, S
     m_isPerformanceCountersEnabled = enablePerformanceCounters;
 
     m_uploadHeapBuffers.OnCreate(pDevice, 1024 * 1024);
+    m_retiredPSOs.OnCreate(frameCountBeforeReuse);
+    m_transientHeap.OnCreate(pDevice);
     CreateResources();
-    SetupPSOTable(0);
+    SetupPSOTables();
     SetupPerformanceCounters();
 }
 
@@ -91,8 +92,8 @@ void HSR::OnCreateWindowSizeDependentResources(const HSRCreationInfo &input) {
 void HSR::OnDestroy() {
     m_uploadHeapBuffers.OnDestroy();
 
-    for (auto &item : m_psoTables) item.second.OnDestroy();
-    m_psoTables.clear();
+    m_psoTables.Clear();
+    m_retiredPSOs.OnDestroy();
 
     m_rayCounter.OnDestroy();
     m_randomNumberImage.OnDestroy();
@@ -105,21 +106,13 @@ void HSR::OnDestroy() {
         m_pCommandSignature->Release();
         m_pCommandSignature = NULL;
     }
-    if (m_pTimestampQueryHeap) {
-        m_pTimestampQueryHeap->Release();
-        m_pTimestampQueryHeap = NULL;
-    }
-    if (m_pTimestampQueryBuffer) {
-        m_pTimestampQueryBuffer->Release();
-        m_pTimestampQueryBuffer = NULL;
-    }
+    m_timing.OnDestroy();
+    m_timestampSource.OnDestroy();
 }
 
 void HSR::OnDestroyWindowSizeDependentResources() {
-    m_rayList.OnDestroy();
-    m_hwRayList.OnDestroy();
-    m_GBufferList.OnDestroy();
-    m_denoiseTileList.OnDestroy();
+    m_transientHeap.OnDestroy();
+    m_materialBins.OnDestroy();
     m_roughnessTexture[0].OnDestroy();
     m_roughnessTexture[1].OnDestroy();
     m_debugImage.OnDestroy();
@@ -131,65 +124,81 @@ void HSR::OnDestroyWindowSizeDependentResources() {
         m_pMetricsUploadBuffer->Release();
         m_pMetricsUploadBuffer = NULL;
     }
-    for (int i = 0; i < 3; i++) m_radianceBuffer[i].OnDestroy();
+    if (m_pRayHitsReadback) {
+        m_pRayHitsReadback->Release();
+        m_pRayHitsReadback = NULL;
+    }
+    if (m_pDenoiserReadback) {
+        m_pDenoiserReadback->Release();
+        m_pDenoiserReadback = NULL;
+    }
+    m_denoiserCapture.OnDestroy();
+    m_denoiserCaptureRecorded = false;
+    for (int i = 0; i < 2; i++) m_radianceBuffer[i].OnDestroy();
     for (int i = 0; i < 4; i++) m_radianceAux[i].OnDestroy();
     m_metricsUAVBuffer.OnDestroy();
 }
 
-static void Barriers(ID3D12GraphicsCommandList *pCmdLst, const std::vector<D3D12_RESOURCE_BARRIER> &barriers) {
-    pCmdLst->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
-}
-
 void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, ReflectionGBuffer *pLowResGbuffer, CBV_SRV_UAV *pGlobalTable, SAMPLER *pGlobalSamplers, State *pState) {
     UserMarker marker(pCommandList, "FidelityFX HSR");
 
-    std::unordered_map<ID3D12Resource *, D3D12_RESOURCE_STATES> default_states = {
-        {m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE},
-        {m_radianceBuffer[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE},
-        {m_rayCounter.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS},
-        {m_GBufferList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS},
-        {pHDROut->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE},
-    };
-
-    std::unordered_map<ID3D12Resource *, D3D12_RESOURCE_STATES> current_states = {};
-
-    auto barrier = [&](ID3D12Resource *pRes, D3D12_RESOURCE_STATES new_state) {
-        D3D12_RESOURCE_STATES old_state = {};
-        if (current_states.find(pRes) != current_states.end()) {
-            old_state = current_states.find(pRes)->second;
-        } else if (default_states.find(pRes) != default_states.end()) {
-            old_state = default_states.find(pRes)->second;
-        } else {
-            old_state = D3D12_RESOURCE_STATE_COMMON;
-        }
-        if (old_state == new_state) {
-            Barriers(pCommandList, {
-                                       CD3DX12_RESOURCE_BARRIER::UAV(pRes),
-                                   });
+    m_retiredPSOs.OnBeginFrame();
+    WriteCapturedRayHits();
+    WriteCapturedDenoiser();
+    bool const showDebug = (pState->frameInfo.hsr_mask & HSR_FLAGS_SHOW_DEBUG_TARGET) != 0;
+    UpdateDebugResources(showDebug);
+
+    // A pending CaptureDenoiser is recorded by the next frame that runs the denoiser.
+    if (!m_denoiserCapturePath.empty() && !m_pDenoiserReadback) {
+        UINT64 captureSize  = UINT64(m_input.outputWidth) * m_input.outputHeight * DENOISER_CAPTURE_PLANE_COUNT * sizeof(float);
+        m_pDenoiserReadback = AllocCPUVisible(m_pDevice->GetDevice(), size_t(captureSize));
+        if (m_pDenoiserReadback) {
+            m_denoiserCapture.InitBuffer(m_pDevice, "HSR - Denoiser Capture", &CD3DX12_RESOURCE_DESC::Buffer(captureSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), 4,
+                                         D3D12_RESOURCE_STATE_COMMON);
+            m_denoiserCaptureRecorded = false;
         } else {
-            Barriers(pCommandList, {
-                                       CD3DX12_RESOURCE_BARRIER::Transition(pRes, old_state, new_state),
-                                   });
+            Trace("HSR: could not allocate the denoiser capture buffer\n");
+            m_denoiserCapturePath.clear();
         }
-        current_states[pRes] = new_state;
-    };
-
-    auto resetStates = [&]() {
-        for (auto item : current_states)
-            if (default_states.find(item.first) != default_states.end())
-                barrier(item.first, default_states.find(item.first)->second);
-            else
-                barrier(item.first, D3D12_RESOURCE_STATE_COMMON);
-    };
-
-    QueryTimestamps(pCommandList);
-
-    PSOTable psoTable = m_psoTables[                                                                           //
-        ((pState->frameInfo.hsr_mask & HSR_FLAGS_SHOW_DEBUG_TARGET) ? 1 : 0)                                   //
-        | ((pState->frameInfo.hsr_mask & HSR_FLAGS_RESOLVE_TRANSPARENT) ? 2 : 0)                               //
-        | ((pState->frameInfo.hsr_mask & HSR_FLAGS_SHADING_USE_SCREEN) ? 4 : 0)                                //
-        | ((m_input.inputWidth != m_input.outputWidth || m_input.inputHeight != m_input.outputHeight) ? 8 : 0) //
-    ];
+    }
+    bool const captureDenoiser = m_pDenoiserReadback && !m_denoiserCaptureRecorded;
+
+    // Barriers are queued and flush() submits them in one batch before each dispatch, copy or indirect execute.
+    std::string barrierLog;
+    m_barrierSink.SetCommandList(pCommandList);
+    m_stateTracker.BeginFrame(m_barrierCapturePath.empty() ? nullptr : &barrierLog);
+    m_stateTracker.SetDefaultState(m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    m_stateTracker.SetDefaultState(m_radianceBuffer[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    m_stateTracker.SetDefaultState(m_rayCounter.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    m_stateTracker.SetDefaultState(m_GBufferList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    m_stateTracker.SetDefaultState(pHDROut->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+    auto barrier = [&](ID3D12Resource *pRes, D3D12_RESOURCE_STATES new_state) { m_stateTracker.Transition(pRes, new_state); };
+    // For resources no pass uses until the barrier() that ends the transition, lets the GPU overlap it with that work.
+    auto beginBarrier = [&](ID3D12Resource *pRes, D3D12_RESOURCE_STATES new_state) { m_stateTracker.BeginTransition(pRes, new_state); };
+    auto flush        = [&]() { m_stateTracker.Flush(m_barrierSink); };
+
+    // Aliasing barriers of the transient resources whose lifetime starts with the pass, see HsrFrameGraph.h.
+    auto beginPass = [&](HsrPass pass) { m_transientHeap.BeginPass(m_stateTracker, m_frameGraph.graph, m_frameGraph.passes[pass]); };
+
+    // Reads back the timings of the frame that last used this ring slot before recording new ones.
+    GpuTimingCollector *pTiming = m_isPerformanceCountersEnabled ? &m_timing : nullptr;
+    if (pTiming) {
+        m_timestampSource.SetCommandList(pCommandList);
+        m_timing.BeginFrame(m_timingFrame++);
+    }
+    pState->pHsrTiming = pTiming;
+
+    HSRPermutationOptions permutation;
+    permutation.debug             = showDebug;
+    permutation.transparentQuery  = (pState->frameInfo.hsr_mask & HSR_FLAGS_RESOLVE_TRANSPARENT) != 0;
+    permutation.shadingUseScreen  = (pState->frameInfo.hsr_mask & HSR_FLAGS_SHADING_USE_SCREEN) != 0;
+    permutation.upscale           = m_input.inputWidth != m_input.outputWidth || m_input.inputHeight != m_input.outputHeight;
+    permutation.compactRayGbuffer = m_input.compactRayGbuffer;
+    permutation.materialBinning   = m_input.materialBinning;
+    permutation.packedRadiance    = m_input.packedRadiance;
+    permutation.convergedTiles    = m_input.convergedTiles;
+    PSOTable psoTable             = m_psoTables.Acquire(GetPermutationMask(permutation));
 
     struct PushConstants {
         uint32_t flags;
@@ -197,58 +206,33 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
     } pc{};
     if (pState->bOptimizedDownsample) pc.depth_mip_bias = 1;
 
-    auto putTimestamp = [this](ID3D12GraphicsCommandList *pCommandList, HSRTimestampQuery slot) {
-        if (m_isPerformanceCountersEnabled) {
-            auto &timestamp_queries = m_timestampQueries[m_timestampFrameIndex];
-            pCommandList->EndQuery(m_pTimestampQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, GetTimestampQueryIndex());
-            timestamp_queries.push_back(slot);
-        }
-    };
-    // Set up global descriptor table
+    // Set up global descriptor table. The HSR set only changes with m_bufferIndex and the window size dependent
+    // resources, so a table that already holds it is left alone, see DescriptorSetCache.h.
     {
-        BlueNoiseSamplerD3D12 &sampler = m_blueNoiseSampler;
-
-        m_roughnessTexture[m_bufferIndex].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_EXTRACTED_ROUGHNESS_SLOT, pGlobalTable);
-        m_roughnessTexture[(m_bufferIndex + 1) % 2].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_EXTRACTED_ROUGHNESS_HISTORY_SLOT, pGlobalTable);
-        m_roughnessTexture[m_bufferIndex].CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_EXTRACTED_ROUGHNESS_SLOT, pGlobalTable);
-        sampler.sobolBuffer.CreateRawUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_SOBOL_SLOT, pGlobalTable);
-        sampler.rankingTileBuffer.CreateRawUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_RANKING_TILE_SLOT, pGlobalTable);
-        sampler.scramblingTileBuffer.CreateRawUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_SCRAMBLING_TILE_SLOT, pGlobalTable);
-        m_rayList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_RAY_LIST_SLOT, NULL, pGlobalTable);
-        m_hwRayList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_HW_RAY_LIST_SLOT, NULL, pGlobalTable);
-        m_denoiseTileList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_DENOISE_TILE_LIST_SLOT, NULL, pGlobalTable);
-        m_GBufferList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_RAY_GBUFFER_LIST_SLOT, NULL, pGlobalTable);
-        m_counterImage[(m_bufferIndex + 0) % 2].CreateUAV(GDT_RW_UTEXTURES_HEAP_OFFSET + GDT_RW_UTEXTURES_HIT_COUNTER_SLOT, pGlobalTable);
-        m_counterImage[(m_bufferIndex + 1) % 2].CreateSRV(GDT_UTEXTURES_HEAP_OFFSET + GDT_UTEXTURES_HIT_COUNTER_HISTORY_SLOT, pGlobalTable);
-        m_radianceAvg[(m_bufferIndex + 0) % 2].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_RADIANCE_MIP_SLOT, pGlobalTable);
-        m_radianceAvg[(m_bufferIndex + 1) % 2].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_RADIANCE_MIP_PREV_SLOT, pGlobalTable);
-        m_radianceAvg[(m_bufferIndex + 0) % 2].CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_RADIANCE_AVG_SLOT, pGlobalTable);
-
-        m_debugImage.CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_DEBUG_SLOT, pGlobalTable);
-        m_debugImage.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_DEBUG_SLOT, pGlobalTable);
-        m_rayCounter.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_RAY_COUNTER_SLOT, NULL, pGlobalTable);
-        m_metricsUAVBuffer.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_METRICS_SLOT, NULL, pGlobalTable);
-        m_intersectionPassIndirectArgs.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_INDIRECT_ARGS_SLOT, NULL, pGlobalTable);
-
-        m_radianceBuffer[(m_bufferIndex + 0) % 2].CreateUAV(GDT_RW_TEXTURESFP16X3_HEAP_OFFSET + GDT_RW_TEXTURESFP16X3_RADIANCE_0_SLOT + 0, pGlobalTable);
-        m_radianceBuffer[(m_bufferIndex + 0) % 2].CreateSRV(GDT_TEXTURESFP16X3_HEAP_OFFSET + GDT_TEXTURESFP16X3_RADIANCE_0_SLOT, pGlobalTable);
-        m_radianceBuffer[(m_bufferIndex + 1) % 2].CreateUAV(GDT_RW_TEXTURESFP16X3_HEAP_OFFSET + GDT_RW_TEXTURESFP16X3_RADIANCE_1_SLOT, pGlobalTable);
-        m_radianceBuffer[(m_bufferIndex + 1) % 2].CreateSRV(GDT_TEXTURESFP16X3_HEAP_OFFSET + GDT_TEXTURESFP16X3_RADIANCE_1_SLOT, pGlobalTable);
-        m_randomNumberImage.CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_RANDOM_NUMBER_IMAGE_SLOT, pGlobalTable);
-        m_randomNumberImage.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_RANDOM_NUMBER_IMAGE_SLOT, pGlobalTable);
-
-        m_radianceAux[(m_bufferIndex + 0) % 2].CreateUAV(GDT_RW_TEXTURESFP16_HEAP_OFFSET + GDT_RW_TEXTURESFP16_RADIANCE_VARIANCE_0_SLOT, pGlobalTable);
-        m_radianceAux[(m_bufferIndex + 1) % 2].CreateUAV(GDT_RW_TEXTURESFP16_HEAP_OFFSET + GDT_RW_TEXTURESFP16_RADIANCE_VARIANCE_1_SLOT, pGlobalTable);
-        m_radianceAux[(m_bufferIndex + 0) % 2].CreateSRV(GDT_TEXTURESFP16_HEAP_OFFSET + GDT_TEXTURESFP16_RADIANCE_VARIANCE_0_SLOT, pGlobalTable);
-        m_radianceAux[(m_bufferIndex + 1) % 2].CreateSRV(GDT_TEXTURESFP16_HEAP_OFFSET + GDT_TEXTURESFP16_RADIANCE_VARIANCE_1_SLOT, pGlobalTable);
-
-        m_radianceAux[2 + (m_bufferIndex + 0) % 2].CreateUAV(GDT_RW_TEXTURESFP16_HEAP_OFFSET + GDT_RW_TEXTURESFP16_RADIANCE_NUM_SAMPLES_0_SLOT, pGlobalTable);
-        m_radianceAux[2 + (m_bufferIndex + 1) % 2].CreateUAV(GDT_RW_TEXTURESFP16_HEAP_OFFSET + GDT_RW_TEXTURESFP16_RADIANCE_NUM_SAMPLES_1_SLOT, pGlobalTable);
-        m_radianceAux[2 + (m_bufferIndex + 0) % 2].CreateSRV(GDT_TEXTURESFP16_HEAP_OFFSET + GDT_TEXTURESFP16_RADIANCE_NUM_SAMPLES_0_SLOT, pGlobalTable);
-        m_radianceAux[2 + (m_bufferIndex + 1) % 2].CreateSRV(GDT_TEXTURESFP16_HEAP_OFFSET + GDT_TEXTURESFP16_RADIANCE_NUM_SAMPLES_1_SLOT, pGlobalTable);
-
-        m_radianceBuffer[2].CreateUAV(GDT_RW_TEXTURESFP16X3_HEAP_OFFSET + GDT_RW_TEXTURESFP16X3_RADIANCE_REPROJECTED_SLOT, pGlobalTable);
-        m_radianceBuffer[2].CreateSRV(GDT_TEXTURESFP16X3_HEAP_OFFSET + GDT_TEXTURESFP16X3_RADIANCE_REPROJECTED_SLOT, pGlobalTable);
+        uint64_t const             table      = pGlobalTable->GetGPU().ptr;
+        std::vector<void const *> *pResources = nullptr;
+#ifdef _DEBUG
+        std::vector<void const *> resources;
+        GetDescriptorSetResources(resources);
+        pResources = &resources;
+#endif
+        if (m_descriptorCache.Acquire(table, m_bufferIndex, pResources)) {
+            WriteDescriptorSet(pGlobalTable);
+        }
+#ifdef _DEBUG
+        else {
+            int stale = m_descriptorCache.FindStale(table, resources);
+            if (stale >= 0) Trace(format("HSR: resource %d of the cached descriptor set was replaced without invalidating the cache\n", stale));
+            assert(stale < 0);
+        }
+#endif
+        // Only alive while a capture is pending, so not part of the cached set.
+        if (captureDenoiser) m_denoiserCapture.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_DENOISER_CAPTURE_SLOT, NULL, pGlobalTable);
+        // Same for the debug target, only the HSR_DEBUG permutations and the Accumulate pass of the debug view use it.
+        if (m_debugImage.GetResource()) {
+            m_debugImage.CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_DEBUG_SLOT, pGlobalTable);
+            m_debugImage.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_DEBUG_SLOT, pGlobalTable);
+        }
     }
 
     // Render
@@ -266,11 +250,13 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
         barrier(pLowResGbuffer->pNormals->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
         barrier(pLowResGbuffer->pMotionVectors->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
         barrier(pLowResGbuffer->pSpecularRoughness->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-        UserMarker marker(pCommandList, "Downsample GBuffer");
+        UserMarker          marker(pCommandList, "Downsample GBuffer");
+        GpuTimingScopeGuard timing(pTiming, "Downsample GBuffer");
 
         pCommandList->SetPipelineState(psoTable.m_pDownsampleGbuffer);
         uint32_t dim_x = RoundedDivide(m_input.outputWidth, 8u);
         uint32_t dim_y = RoundedDivide(m_input.outputHeight, 8u);
+        flush();
         pCommandList->Dispatch(dim_x, dim_y, 1);
         barrier(pHDROut->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
         barrier(pLowResGbuffer->pAlbedo->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
@@ -278,12 +264,15 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
         barrier(pLowResGbuffer->pNormals->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
         barrier(pLowResGbuffer->pMotionVectors->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
         barrier(pLowResGbuffer->pSpecularRoughness->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-        putTimestamp(pCommandList, HSRTimestampQuery::TIMESTAMP_QUERY_DOWNSAMPLE_GBUFFER);
     }
+    if (pLowResGbuffer->pDepthHistory) barrier(pLowResGbuffer->pDepthHistory->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    if (pLowResGbuffer->pNormalsHistory) barrier(pLowResGbuffer->pNormalsHistory->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
-    bool render_primary = (pState->frameInfo.hsr_mask & HSR_FLAGS_VISUALIZE_PRIMARY_RAYS) && (pState->frameInfo.hsr_mask & HSR_FLAGS_SHOW_DEBUG_TARGET);
+    bool render_primary = (pState->frameInfo.hsr_mask & HSR_FLAGS_VISUALIZE_PRIMARY_RAYS) && showDebug;
     if (render_primary) {
+        GpuTimingScopeGuard timing(pTiming, "Primary rays");
         pCommandList->SetPipelineState(m_pPrimaryRayTracingPSO);
+        flush();
         pCommandList->Dispatch(DivideRoundingUp(m_input.inputWidth, 8u), DivideRoundingUp(m_input.inputHeight, 8u), 1);
     } else {
 
@@ -291,15 +280,16 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
         barrier(m_counterImage[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
         barrier(m_counterImage[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
         barrier(m_roughnessTexture[m_bufferIndex].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-        barrier(m_radianceBuffer[2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
         {
+            beginPass(HSR_PASS_CLASSIFY_TILES);
             // For clear
             barrier(m_radianceBuffer[0].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
             barrier(m_radianceBuffer[1].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
             barrier(m_randomNumberImage.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
             barrier(pHDROut->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-            UserMarker marker(pCommandList, "ClassifyTiles");
+            UserMarker          marker(pCommandList, "ClassifyTiles");
+            GpuTimingScopeGuard timing(pTiming, "Classify tiles");
 
             pCommandList->SetPipelineState(psoTable.m_pClassifyTiles);
             uint32_t dim_x = RoundedDivide(m_input.outputWidth, 8u);
@@ -307,9 +297,12 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
             uint32_t dim_y = RoundedDivide(m_input.outputHeight, 8u);
 
             barrier(m_radianceAux[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            flush();
             pCommandList->Dispatch(dim_x, dim_y, 1);
             barrier(pHDROut->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-            putTimestamp(pCommandList, HSRTimestampQuery::TIMESTAMP_QUERY_TILE_CLASSIFICATION);
+            // Only read again by the intersection pass.
+            beginBarrier(m_roughnessTexture[m_bufferIndex].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            beginBarrier(m_randomNumberImage.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
         }
 
         // Ensure that the tile classification pass finished
@@ -318,8 +311,11 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
         barrier(m_intersectionPassIndirectArgs.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
         {
-            UserMarker marker(pCommandList, "PrepareIndirectArgs");
+            UserMarker          marker(pCommandList, "PrepareIndirectArgs");
+            GpuTimingScopeGuard timing(pTiming, "Prepare indirect args");
+            beginPass(HSR_PASS_PREPARE_INDIRECT_ARGS);
             pCommandList->SetPipelineState(psoTable.m_pPrepareIndirectSW);
+            flush();
             pCommandList->Dispatch(1, 1, 1);
         }
         barrier(m_roughnessTexture[m_bufferIndex].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
@@ -329,53 +325,157 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
         barrier(m_randomNumberImage.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
         {
-            UserMarker marker(pCommandList, "Intersection pass");
+            UserMarker          marker(pCommandList, "Intersection pass");
+            GpuTimingScopeGuard timing(pTiming, "Intersection");
             barrier(m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
             barrier(m_radianceAux[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
             if (pState->frameInfo.hsr_mask & HSR_FLAGS_USE_SCREEN_SPACE) {
+                GpuTimingScopeGuard sw_timing(pTiming, "SW");
+                beginPass(HSR_PASS_INTERSECT);
                 pCommandList->SetPipelineState(psoTable.m_pHybridPSODeferred);
+                flush();
                 pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_SW_OFFSET, nullptr, 0);
-                putTimestamp(pCommandList, HSRTimestampQuery::TIMESTAMP_QUERY_INTERSECTION_SW);
             }
             if (pState->frameInfo.hsr_mask & HSR_FLAGS_USE_RAY_TRACING) {
+                GpuTimingScopeGuard hw_timing(pTiming, "HW");
                 barrier(m_rayCounter.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
                 barrier(m_intersectionPassIndirectArgs.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-                pCommandList->SetPipelineState(psoTable.m_pPrepareIndirect);
-                pCommandList->Dispatch(1, 1, 1);
-
-                barrier(m_intersectionPassIndirectArgs.GetResource(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
-
-                pCommandList->SetPipelineState(psoTable.m_pRTPSODeferred);
-                pCommandList->SetComputeRoot32BitConstants(2, sizeof(pc) / 4, &pc, 0);
-                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_HW_OFFSET, nullptr, 0);
-                barrier(m_GBufferList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-                pCommandList->SetPipelineState(psoTable.m_pDeferredShadeRays);
-                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_HW_OFFSET, nullptr, 0);
-                putTimestamp(pCommandList, HSRTimestampQuery::TIMESTAMP_QUERY_INTERSECTION_HW);
+                {
+                    GpuTimingScopeGuard timing(pTiming, "Prepare");
+                    pCommandList->SetPipelineState(psoTable.m_pPrepareIndirect);
+                    flush();
+                    pCommandList->Dispatch(1, 1, 1);
+                    barrier(m_intersectionPassIndirectArgs.GetResource(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+                }
+                {
+                    GpuTimingScopeGuard timing(pTiming, "Trace");
+                    beginPass(HSR_PASS_TRACE);
+                    pCommandList->SetPipelineState(psoTable.m_pRTPSODeferred);
+                    pCommandList->SetComputeRoot32BitConstants(2, sizeof(pc) / 4, &pc, 0);
+                    flush();
+                    pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_HW_OFFSET, nullptr, 0);
+                    barrier(m_GBufferList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                }
+                if (psoTable.m_pScatterMaterialBins) {
+                    GpuTimingScopeGuard timing(pTiming, "Material binning");
+                    beginPass(HSR_PASS_MATERIAL_BINNING);
+                    barrier(m_materialBins.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                    barrier(m_binnedHwRayList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                    pCommandList->SetPipelineState(psoTable.m_pCountMaterialBins);
+                    flush();
+                    pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_HW_OFFSET, nullptr, 0);
+                    barrier(m_materialBins.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                    pCommandList->SetPipelineState(psoTable.m_pScanMaterialBins);
+                    flush();
+                    pCommandList->Dispatch(1, 1, 1);
+                    barrier(m_materialBins.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                    pCommandList->SetPipelineState(psoTable.m_pScatterMaterialBins);
+                    flush();
+                    pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_HW_OFFSET, nullptr, 0);
+                    barrier(m_binnedHwRayList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                }
+                {
+                    GpuTimingScopeGuard timing(pTiming, "Deferred shade");
+                    beginPass(HSR_PASS_DEFERRED_SHADE);
+                    pCommandList->SetPipelineState(psoTable.m_pDeferredShadeRays);
+                    flush();
+                    pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_HW_OFFSET, nullptr, 0);
+                }
+                if (!m_rayHitsCapturePath.empty() && !m_pRayHitsReadback) {
+                    // The hit count goes first, the entries start at 16 bytes.
+                    UINT64 gbufferSize = m_GBufferList.GetResource()->GetDesc().Width;
+                    m_pRayHitsReadback = AllocCPUVisible(m_pDevice->GetDevice(), size_t(16 + gbufferSize));
+                    if (m_pRayHitsReadback) {
+                        barrier(m_rayCounter.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE);
+                        barrier(m_GBufferList.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE);
+                        flush();
+                        pCommandList->CopyBufferRegion(m_pRayHitsReadback, 0, m_rayCounter.GetResource(), RAY_COUNTER_HW_HISTORY_OFFSET, 4);
+                        flush();
+                        pCommandList->CopyBufferRegion(m_pRayHitsReadback, 16, m_GBufferList.GetResource(), 0, gbufferSize);
+                        barrier(m_rayCounter.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                        barrier(m_GBufferList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                        m_rayHitsFramesLeft = m_frameCountBeforeReuse;
+                    } else {
+                        Trace("HSR: could not allocate the ray hit capture buffer\n");
+                        m_rayHitsCapturePath.clear();
+                    }
+                }
             }
         }
-        if (pState->frameInfo.hsr_mask & HSR_FLAGS_SHOW_INTERSECTION) {
+        // The visualizer flags stay set while the debug view is off, Accumulate writes to the debug target.
+        if ((pState->frameInfo.hsr_mask & HSR_FLAGS_SHOW_INTERSECTION) && showDebug) {
             barrier(pHDROut->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
             if (pState->bClearAccumulator) pc.flags = 1;
             pState->bClearAccumulator = false;
             barrier(m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
-            UserMarker marker(pCommandList, "Accumulate");
+            UserMarker          marker(pCommandList, "Accumulate");
+            GpuTimingScopeGuard timing(pTiming, "Accumulate");
             pCommandList->SetPipelineState(psoTable.m_pAccumulate);
             uint32_t dim_x = RoundedDivide(m_input.outputWidth, 8u);
             uint32_t dim_y = RoundedDivide(m_input.outputHeight, 8u);
+            flush();
             pCommandList->Dispatch(dim_x, dim_y, 1);
             barrier(pHDROut->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
         } else {
+            GpuTimingScopeGuard denoise_timing(pTiming, "Denoise");
+            uint32_t const      capture_dim_x = RoundedDivide(m_input.outputWidth, 8u);
+            uint32_t const      capture_dim_y = RoundedDivide(m_input.outputHeight, 8u);
+            // The denoiser passes run on the tiles that are not converged, when converged tiles are split off.
+            UINT64 denoise_args_offset = INDIRECT_ARGS_DENOISE_OFFSET;
+            if (psoTable.m_pClassifyConvergedTiles) {
+                UserMarker          marker(pCommandList, "Classify converged tiles");
+                GpuTimingScopeGuard timing(pTiming, "Classify converged");
+                beginPass(HSR_PASS_CLASSIFY_CONVERGED);
+                barrier(m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceBuffer[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceAux[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceAux[2 + (m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_activeDenoiseTileList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                barrier(m_convergedTileList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                barrier(m_rayCounter.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                pCommandList->SetPipelineState(psoTable.m_pClassifyConvergedTiles);
+                flush();
+                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_DENOISE_OFFSET, nullptr, 0);
+                barrier(m_rayCounter.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                barrier(m_intersectionPassIndirectArgs.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                pCommandList->SetPipelineState(psoTable.m_pPrepareConvergedTileArgs);
+                flush();
+                pCommandList->Dispatch(1, 1, 1);
+                barrier(m_rayCounter.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                barrier(m_intersectionPassIndirectArgs.GetResource(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+                barrier(m_activeDenoiseTileList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                barrier(m_convergedTileList.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                denoise_args_offset = INDIRECT_ARGS_ACTIVE_DENOISE_OFFSET;
+            }
+            if (captureDenoiser) {
+                UserMarker marker(pCommandList, "Capture denoiser inputs");
+                barrier(m_denoiserCapture.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                barrier(m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceBuffer[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceAux[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceAux[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceAux[2 + (m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceAvg[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                pCommandList->SetPipelineState(psoTable.m_pCaptureDenoiserInputs);
+                flush();
+                pCommandList->Dispatch(capture_dim_x, capture_dim_y, 1);
+                barrier(m_denoiserCapture.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                pCommandList->SetPipelineState(psoTable.m_pCaptureDenoiserTileMask);
+                flush();
+                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), denoise_args_offset, nullptr, 0);
+            }
             {
-                UserMarker marker(pCommandList, "FFX DNSR Reproject pass");
+                UserMarker          marker(pCommandList, "FFX DNSR Reproject pass");
+                GpuTimingScopeGuard timing(pTiming, "Reproject");
+                beginPass(HSR_PASS_REPROJECT);
 
                 barrier(m_radianceAvg[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
                 barrier(m_radianceAvg[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
-                barrier(m_radianceBuffer[2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                barrier(m_radianceReprojected.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
                 barrier(m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
                 barrier(m_radianceBuffer[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
@@ -386,13 +486,28 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
                 barrier(m_radianceAux[2 + (m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
                 pCommandList->SetPipelineState(psoTable.m_pReproject);
-                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_DENOISE_OFFSET, nullptr, 0);
-                putTimestamp(pCommandList, HSRTimestampQuery::TIMESTAMP_QUERY_DENOISING_REPROJECT);
+                flush();
+                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), denoise_args_offset, nullptr, 0);
             }
             barrier(m_radianceAvg[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            // Only read again by the temporal pass.
+            beginBarrier(m_radianceReprojected.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            beginBarrier(m_radianceAux[2 + (m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            if (captureDenoiser) {
+                UserMarker marker(pCommandList, "Capture reprojected");
+                barrier(m_radianceReprojected.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceAux[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceAux[2 + (m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_denoiserCapture.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                pCommandList->SetPipelineState(psoTable.m_pCaptureDenoiserReprojected);
+                flush();
+                pCommandList->Dispatch(capture_dim_x, capture_dim_y, 1);
+            }
             {
 
-                UserMarker marker(pCommandList, "FFX DNSR Prefiltering");
+                UserMarker          marker(pCommandList, "FFX DNSR Prefiltering");
+                GpuTimingScopeGuard timing(pTiming, "Prefilter");
+                beginPass(HSR_PASS_PREFILTER);
                 barrier(m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
                 barrier(m_radianceBuffer[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
@@ -400,13 +515,24 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
                 barrier(m_radianceAux[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
                 pCommandList->SetPipelineState(psoTable.m_pPrefilter);
-                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_DENOISE_OFFSET, nullptr, 0);
-                putTimestamp(pCommandList, HSRTimestampQuery::TIMESTAMP_QUERY_DENOISING_NEIGHBOR_X16);
+                flush();
+                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), denoise_args_offset, nullptr, 0);
+            }
+            if (captureDenoiser) {
+                UserMarker marker(pCommandList, "Capture prefiltered");
+                barrier(m_radianceBuffer[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceAux[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_denoiserCapture.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                pCommandList->SetPipelineState(psoTable.m_pCaptureDenoiserPrefiltered);
+                flush();
+                pCommandList->Dispatch(capture_dim_x, capture_dim_y, 1);
             }
 
             {
-                UserMarker marker(pCommandList, "FFX DNSR Temporal");
-                barrier(m_radianceBuffer[2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                UserMarker          marker(pCommandList, "FFX DNSR Temporal");
+                GpuTimingScopeGuard timing(pTiming, "Temporal");
+                beginPass(HSR_PASS_TEMPORAL);
+                barrier(m_radianceReprojected.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
                 barrier(m_radianceBuffer[(m_bufferIndex + 1) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
                 barrier(m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
@@ -416,13 +542,51 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
                 barrier(m_radianceAux[2 + (m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
                 pCommandList->SetPipelineState(psoTable.m_pResolveTemporal);
-                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_DENOISE_OFFSET, nullptr, 0);
-                putTimestamp(pCommandList, HSRTimestampQuery::TIMESTAMP_QUERY_DENOISING_TEMPORAL);
+                flush();
+                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), denoise_args_offset, nullptr, 0);
+            }
+            if (psoTable.m_pKeepConvergedHistory) {
+                UserMarker          marker(pCommandList, "Keep converged history");
+                GpuTimingScopeGuard timing(pTiming, "Keep converged");
+                beginPass(HSR_PASS_KEEP_CONVERGED);
+                barrier(m_radianceAux[2 + (m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                barrier(m_radianceAvg[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                pCommandList->SetPipelineState(psoTable.m_pKeepConvergedHistory);
+                flush();
+                pCommandList->ExecuteIndirect(m_pCommandSignature, 1, m_intersectionPassIndirectArgs.GetResource(), INDIRECT_ARGS_CONVERGED_TILES_OFFSET, nullptr, 0);
+                barrier(m_radianceAvg[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            }
+            if (captureDenoiser) {
+                UserMarker marker(pCommandList, "Capture temporal");
+                barrier(m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_radianceAux[(m_bufferIndex + 0) % 2].GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+                barrier(m_denoiserCapture.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+                pCommandList->SetPipelineState(psoTable.m_pCaptureDenoiserTemporal);
+                flush();
+                pCommandList->Dispatch(capture_dim_x, capture_dim_y, 1);
+
+                barrier(m_denoiserCapture.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE);
+                flush();
+                pCommandList->CopyBufferRegion(m_pDenoiserReadback, 0, m_denoiserCapture.GetResource(), 0, m_denoiserCapture.GetResource()->GetDesc().Width);
+                barrier(m_denoiserCapture.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+                hlsl::FrameInfo const &frameInfo = pState->frameInfo;
+                memcpy(m_denoiserConstants.invProj, frameInfo.inv_proj.m, sizeof(m_denoiserConstants.invProj));
+                memcpy(m_denoiserConstants.invView, frameInfo.inv_view.m, sizeof(m_denoiserConstants.invView));
+                memcpy(m_denoiserConstants.prevViewProj, frameInfo.prev_view_proj.m, sizeof(m_denoiserConstants.prevViewProj));
+                m_denoiserConstants.roughnessThreshold      = frameInfo.roughness_threshold;
+                m_denoiserConstants.temporalStabilityFactor = frameInfo.temporal_stability_factor;
+                m_denoiserConstants.historyClipWeight       = frameInfo.history_clip_weight;
+                m_denoiserConstants.maxHistorySamples       = frameInfo.max_history_samples;
+                m_denoiserCaptureRecorded                   = true;
+                m_denoiserFramesLeft                        = m_frameCountBeforeReuse;
             }
         }
     }
     {
-        UserMarker marker(pCommandList, "FFX Apply Reflections");
+        UserMarker          marker(pCommandList, "FFX Apply Reflections");
+        GpuTimingScopeGuard timing(pTiming, "Apply reflections");
+        beginPass(HSR_PASS_APPLY_REFLECTIONS);
         struct PushConstants {
             hlsl::uint easu_const0[4];
             hlsl::uint easu_const1[4];
@@ -437,45 +601,168 @@ void HSR::Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, Reflec
         barrier(pHDROut->GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
         pCommandList->SetPipelineState(psoTable.m_pApplyReflections);
         pCommandList->SetComputeRoot32BitConstants(2, sizeof(pc) / 4, &pc, 0);
+        flush();
         pCommandList->Dispatch(DivideRoundingUp(m_input.inputWidth, 8u), DivideRoundingUp(m_input.inputHeight, 8u), 1);
-        putTimestamp(pCommandList, HSRTimestampQuery::TIMESTAMP_QUERY_DENOISING_APPLY);
         barrier(pHDROut->GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     }
 
     {
         pCommandList->SetPipelineState(psoTable.m_pResetDownsampleCounter);
+        flush();
         pCommandList->Dispatch(1, 1, 1);
     }
-    barrier(m_metricsUAVBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE);
-    pCommandList->CopyResource(m_pMetricsUploadBuffer, m_metricsUAVBuffer.GetResource());
-    barrier(m_metricsUAVBuffer.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-
     {
-        int32_t numSWRays = m_pMetricsMap[0];
-        int32_t numHWRays = m_pMetricsMap[2];
-        int32_t numHYRays = m_pMetricsMap[2] - m_pMetricsMap[1];
-        pState->m_numSWRays += (double(numSWRays) - pState->m_numSWRays) * 0.1;
-        pState->m_numHWRays += (double(numHWRays) - pState->m_numHWRays) * 0.1;
-        pState->m_numHYRays += (double(numHYRays) - pState->m_numHYRays) * 0.1;
+        // The slot about to be reused holds the block of the frame that retired m_frameCountBeforeReuse frames ago.
+        uint32_t    slot = m_metricsReadback.GetSlot();
+        HsrMetrics  metrics;
+        int64_t     metricsFrame = -1;
+        std::string error;
+        if (m_metricsReadback.ReadRetired(m_pMetricsMap, metrics, metricsFrame, &error)) {
+            pState->hsrMetrics      = metrics;
+            pState->hsrMetricsFrame = metricsFrame;
+            pState->m_numSWRays += (double(metrics.swRays) - pState->m_numSWRays) * 0.1;
+            pState->m_numHWRays += (double(metrics.hwRays) - pState->m_numHWRays) * 0.1;
+            pState->m_numHYRays += (double(metrics.hybridRays) - pState->m_numHYRays) * 0.1;
+            pState->m_lastSWRays = double(metrics.swRays);
+            pState->m_lastHWRays = double(metrics.hwRays);
+            pState->m_lastHYRays = double(metrics.hybridRays);
+        } else if (!error.empty()) {
+            Trace(format("HSR: dropping metrics block, %s\n", error.c_str()));
+        }
+
+        barrier(m_metricsUAVBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE);
+        flush();
+        pCommandList->CopyBufferRegion(m_pMetricsUploadBuffer, slot * HSR_METRICS_WORD_COUNT * sizeof(uint32_t), m_metricsUAVBuffer.GetResource(), 0,
+                                       HSR_METRICS_WORD_COUNT * sizeof(uint32_t));
+        barrier(m_metricsUAVBuffer.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        m_metricsReadback.EndFrame();
     }
 
-    resetStates();
+    m_stateTracker.EndFrame(m_barrierSink);
+    m_barrierSink.SetCommandList(NULL);
+    pState->hsrBarrierStats = m_stateTracker.GetStats();
+    pState->hsrMemory                   = m_memoryReport;
+    pState->hsrMemory.debugPermutations = m_psoTables.GetReadyCount(HSR_PERMUTATION_DEBUG);
+    if (!m_barrierCapturePath.empty()) {
+        FILE *pFile = fopen(m_barrierCapturePath.c_str(), "w");
+        if (pFile && fwrite(barrierLog.data(), 1, barrierLog.size(), pFile) == barrierLog.size())
+            Trace(format("HSR: wrote the barrier requests of the frame to %s\n", m_barrierCapturePath.c_str()));
+        else
+            Trace(format("HSR: could not write %s\n", m_barrierCapturePath.c_str()));
+        if (pFile) fclose(pFile);
+        m_barrierCapturePath.clear();
+    }
 
-    // Resolve the timestamp query data
-    if (m_isPerformanceCountersEnabled) {
-        auto const start_index = m_timestampFrameIndex * (int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT;
+    if (pTiming) {
+        m_timing.EndFrame();
+        m_timestampSource.SetCommandList(NULL);
+    }
+    m_bufferIndex = (m_bufferIndex + 1) % 2;
+}
 
-        pCommandList->ResolveQueryData(m_pTimestampQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, start_index, static_cast<UINT>(m_timestampQueries[m_timestampFrameIndex].size()),
-                                       m_pTimestampQueryBuffer, start_index * sizeof(std::uint64_t));
+void HSR::WriteDescriptorSet(CBV_SRV_UAV *pGlobalTable) {
+    BlueNoiseSamplerD3D12 &sampler = m_blueNoiseSampler;
+
+    m_roughnessTexture[m_bufferIndex].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_EXTRACTED_ROUGHNESS_SLOT, pGlobalTable);
+    m_roughnessTexture[(m_bufferIndex + 1) % 2].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_EXTRACTED_ROUGHNESS_HISTORY_SLOT, pGlobalTable);
+    m_roughnessTexture[m_bufferIndex].CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_EXTRACTED_ROUGHNESS_SLOT, pGlobalTable);
+    sampler.sobolBuffer.CreateRawUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_SOBOL_SLOT, pGlobalTable);
+    sampler.rankingTileBuffer.CreateRawUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_RANKING_TILE_SLOT, pGlobalTable);
+    sampler.scramblingTileBuffer.CreateRawUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_SCRAMBLING_TILE_SLOT, pGlobalTable);
+    m_rayList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_RAY_LIST_SLOT, pGlobalTable);
+    m_hwRayList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_HW_RAY_LIST_SLOT, pGlobalTable);
+    m_denoiseTileList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_DENOISE_TILE_LIST_SLOT, pGlobalTable);
+    m_GBufferList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_RAY_GBUFFER_LIST_SLOT, pGlobalTable);
+    if (m_input.materialBinning) {
+        m_materialBins.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_MATERIAL_BINS_SLOT, NULL, pGlobalTable);
+        m_binnedHwRayList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_BINNED_HW_RAY_LIST_SLOT, pGlobalTable);
+    }
+    if (m_input.convergedTiles) {
+        m_activeDenoiseTileList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_ACTIVE_DENOISE_TILE_LIST_SLOT, pGlobalTable);
+        m_convergedTileList.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_CONVERGED_TILE_LIST_SLOT, pGlobalTable);
+    }
+    m_counterImage[(m_bufferIndex + 0) % 2].CreateUAV(GDT_RW_UTEXTURES_HEAP_OFFSET + GDT_RW_UTEXTURES_HIT_COUNTER_SLOT, pGlobalTable);
+    m_counterImage[(m_bufferIndex + 1) % 2].CreateSRV(GDT_UTEXTURES_HEAP_OFFSET + GDT_UTEXTURES_HIT_COUNTER_HISTORY_SLOT, pGlobalTable);
+    m_radianceAvg[(m_bufferIndex + 0) % 2].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_RADIANCE_MIP_SLOT, pGlobalTable);
+    m_radianceAvg[(m_bufferIndex + 1) % 2].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_RADIANCE_MIP_PREV_SLOT, pGlobalTable);
+    m_radianceAvg[(m_bufferIndex + 0) % 2].CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_RADIANCE_AVG_SLOT, pGlobalTable);
+
+    m_rayCounter.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_RAY_COUNTER_SLOT, NULL, pGlobalTable);
+    m_metricsUAVBuffer.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_METRICS_SLOT, NULL, pGlobalTable);
+    m_intersectionPassIndirectArgs.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_INDIRECT_ARGS_SLOT, NULL, pGlobalTable);
+
+    m_radianceBuffer[(m_bufferIndex + 0) % 2].CreateUAV(GDT_RW_TEXTURESFP16X3_HEAP_OFFSET + GDT_RW_TEXTURESFP16X3_RADIANCE_0_SLOT + 0, pGlobalTable);
+    m_radianceBuffer[(m_bufferIndex + 0) % 2].CreateSRV(GDT_TEXTURESFP16X3_HEAP_OFFSET + GDT_TEXTURESFP16X3_RADIANCE_0_SLOT, pGlobalTable);
+    m_radianceBuffer[(m_bufferIndex + 1) % 2].CreateUAV(GDT_RW_TEXTURESFP16X3_HEAP_OFFSET + GDT_RW_TEXTURESFP16X3_RADIANCE_1_SLOT, pGlobalTable);
+    m_radianceBuffer[(m_bufferIndex + 1) % 2].CreateSRV(GDT_TEXTURESFP16X3_HEAP_OFFSET + GDT_TEXTURESFP16X3_RADIANCE_1_SLOT, pGlobalTable);
+    m_randomNumberImage.CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_RANDOM_NUMBER_IMAGE_SLOT, pGlobalTable);
+    m_randomNumberImage.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_RANDOM_NUMBER_IMAGE_SLOT, pGlobalTable);
+
+    m_radianceAux[(m_bufferIndex + 0) % 2].CreateUAV(GDT_RW_TEXTURESFP16_HEAP_OFFSET + GDT_RW_TEXTURESFP16_RADIANCE_VARIANCE_0_SLOT, pGlobalTable);
+    m_radianceAux[(m_bufferIndex + 1) % 2].CreateUAV(GDT_RW_TEXTURESFP16_HEAP_OFFSET + GDT_RW_TEXTURESFP16_RADIANCE_VARIANCE_1_SLOT, pGlobalTable);
+    m_radianceAux[(m_bufferIndex + 0) % 2].CreateSRV(GDT_TEXTURESFP16_HEAP_OFFSET + GDT_TEXTURESFP16_RADIANCE_VARIANCE_0_SLOT, pGlobalTable);
+    m_radianceAux[(m_bufferIndex + 1) % 2].CreateSRV(GDT_TEXTURESFP16_HEAP_OFFSET + GDT_TEXTURESFP16_RADIANCE_VARIANCE_1_SLOT, pGlobalTable);
+
+    m_radianceAux[2 + (m_bufferIndex + 0) % 2].CreateUAV(GDT_RW_TEXTURESFP16_HEAP_OFFSET + GDT_RW_TEXTURESFP16_RADIANCE_NUM_SAMPLES_0_SLOT, pGlobalTable);
+    m_radianceAux[2 + (m_bufferIndex + 1) % 2].CreateUAV(GDT_RW_TEXTURESFP16_HEAP_OFFSET + GDT_RW_TEXTURESFP16_RADIANCE_NUM_SAMPLES_1_SLOT, pGlobalTable);
+    m_radianceAux[2 + (m_bufferIndex + 0) % 2].CreateSRV(GDT_TEXTURESFP16_HEAP_OFFSET + GDT_TEXTURESFP16_RADIANCE_NUM_SAMPLES_0_SLOT, pGlobalTable);
+    m_radianceAux[2 + (m_bufferIndex + 1) % 2].CreateSRV(GDT_TEXTURESFP16_HEAP_OFFSET + GDT_TEXTURESFP16_RADIANCE_NUM_SAMPLES_1_SLOT, pGlobalTable);
+
+    m_radianceReprojected.CreateUAV(GDT_RW_TEXTURESFP16X3_HEAP_OFFSET + GDT_RW_TEXTURESFP16X3_RADIANCE_REPROJECTED_SLOT, pGlobalTable);
+    m_radianceReprojected.CreateSRV(GDT_TEXTURESFP16X3_HEAP_OFFSET + GDT_TEXTURESFP16X3_RADIANCE_REPROJECTED_SLOT, pGlobalTable);
+}
 
-        m_timestampFrameIndex = (m_timestampFrameIndex + 1u) % m_frameCountBeforeReuse;
+void HSR::GetDescriptorSetResources(std::vector<void const *> &resources) {
+    // The blue noise sampler buffers live as long as HSR and are left out.
+    resources = {
+        m_roughnessTexture[m_bufferIndex].GetResource(),
+        m_roughnessTexture[(m_bufferIndex + 1) % 2].GetResource(),
+        m_rayList.GetResource(),
+        m_hwRayList.GetResource(),
+        m_denoiseTileList.GetResource(),
+        m_GBufferList.GetResource(),
+        m_counterImage[(m_bufferIndex + 0) % 2].GetResource(),
+        m_counterImage[(m_bufferIndex + 1) % 2].GetResource(),
+        m_radianceAvg[(m_bufferIndex + 0) % 2].GetResource(),
+        m_radianceAvg[(m_bufferIndex + 1) % 2].GetResource(),
+        m_rayCounter.GetResource(),
+        m_metricsUAVBuffer.GetResource(),
+        m_intersectionPassIndirectArgs.GetResource(),
+        m_radianceBuffer[(m_bufferIndex + 0) % 2].GetResource(),
+        m_radianceBuffer[(m_bufferIndex + 1) % 2].GetResource(),
+        m_randomNumberImage.GetResource(),
+        m_radianceAux[(m_bufferIndex + 0) % 2].GetResource(),
+        m_radianceAux[(m_bufferIndex + 1) % 2].GetResource(),
+        m_radianceAux[2 + (m_bufferIndex + 0) % 2].GetResource(),
+        m_radianceAux[2 + (m_bufferIndex + 1) % 2].GetResource(),
+        m_radianceReprojected.GetResource(),
+    };
+    if (m_input.materialBinning) {
+        resources.push_back(m_materialBins.GetResource());
+        resources.push_back(m_binnedHwRayList.GetResource());
+    }
+    if (m_input.convergedTiles) {
+        resources.push_back(m_activeDenoiseTileList.GetResource());
+        resources.push_back(m_convergedTileList.GetResource());
     }
-    m_bufferIndex = (m_bufferIndex + 1) % 2;
 }
 
 void HSR::Recompile() {
-    m_pDevice->GPUFlush();
-    SetupPSOTable(0);
+    CreatePrimaryRayTracingPSO();
+    m_psoTables.Rebuild();
+}
+
+void HSR::Reload(std::set<std::string> const &changedShaders) {
+    if (changedShaders.count("PrimaryRayTracing.hlsl")) CreatePrimaryRayTracingPSO();
+    m_psoTables.Rebuild([this, &changedShaders](uint32_t mask, PSOTable const *pPrevious) { return CreatePSOTable(mask, pPrevious, &changedShaders); });
+}
+
+std::vector<std::string> HSR::GetShaderFiles() {
+    return {
+        "PrimaryRayTracing.hlsl", "Accumulate.hlsl", "ClassifyTiles.hlsl",        "Intersect.hlsl",       "PrepareIndirectArgs.hlsl",
+        "Reproject.hlsl",         "Prefilter.hlsl",  "TemporalAccumulation.hlsl", "ApplyReflections.hlsl", "HalfResGbuffer.hlsl",
+        "DenoiserCapture.hlsl",   "ConvergedTiles.hlsl",
+    };
 }
 
 void HSR::CreateResources() {
@@ -488,7 +775,7 @@ void HSR::CreateResources() {
     //==============================Create PrepareIndirectArgs-related buffers============================================
     {
         m_intersectionPassIndirectArgs.InitBuffer(m_pDevice, "HSR - Intersect Indirect Args",
-                                                  &CD3DX12_RESOURCE_DESC::Buffer(3 * 4 * (3 + 1), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), elementSize,
+                                                  &CD3DX12_RESOURCE_DESC::Buffer(3 * 4 * (3 + 1 + 2), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), elementSize,
                                                   D3D12_RESOURCE_STATE_COMMON);
     }
     //==============================Command Signature==========================================
@@ -519,6 +806,9 @@ void HSR::CreateResources() {
 }
 
 void HSR::CreateWindowSizeDependentResources() {
+    // The tables still view the resources this replaces.
+    m_descriptorCache.Invalidate();
+
     int    width     = m_input.outputWidth;
     int    height    = m_input.outputHeight;
     int    width8    = RoundedDivide(m_input.outputWidth, 8u);
@@ -526,11 +816,12 @@ void HSR::CreateWindowSizeDependentResources() {
     UINT64 num_tiles = (UINT64)(width8 * height8);
     //===================================Create Output Buffer============================================
     {
-        CD3DX12_RESOURCE_DESC reflDesc = // DXGI_FORMAT_R11G11B10_FLOAT or DXGI_FORMAT_R16G16B16A16_FLOAT
-            CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16G16B16A16_FLOAT, m_input.outputWidth, m_input.outputHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        // Half the bandwidth of the radiance reads and writes of the denoiser, the stores dither onto the R11G11B10 grid.
+        DXGI_FORMAT           format   = m_input.packedRadiance ? DXGI_FORMAT_R11G11B10_FLOAT : DXGI_FORMAT_R16G16B16A16_FLOAT;
+        CD3DX12_RESOURCE_DESC reflDesc =
+            CD3DX12_RESOURCE_DESC::Tex2D(format, m_input.outputWidth, m_input.outputHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
         m_radianceBuffer[0].Init(m_pDevice, "Radiance Result 0", &reflDesc, D3D12_RESOURCE_STATE_COMMON, nullptr);
         m_radianceBuffer[1].Init(m_pDevice, "Radiance Result 1", &reflDesc, D3D12_RESOURCE_STATE_COMMON, nullptr);
-        m_radianceBuffer[2].Init(m_pDevice, "Radiance Result Reprojected", &reflDesc, D3D12_RESOURCE_STATE_COMMON, nullptr);
     }
     {
         CD3DX12_RESOURCE_DESC reflDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8_UNORM, 128, 128, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
@@ -550,17 +841,53 @@ void HSR::CreateWindowSizeDependentResources() {
 
     uint32_t elementSize = 4;
     //==============================Create Tile Classification-related buffers============================================
+    if (m_input.materialBinning) {
+        // Counters and offsets. Committed resources start zeroed and ScanMaterialBins clears the counters after use.
+        m_materialBins.InitBuffer(m_pDevice, "HSR - Material Bins",
+                                  &CD3DX12_RESOURCE_DESC::Buffer(2 * FFX_REFLECTIONS_MATERIAL_BIN_COUNT * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), elementSize,
+                                  D3D12_RESOURCE_STATE_COMMON);
+    }
+    //==============================Transient resources============================================
     {
-        UINT64 num_pixels = (UINT64)m_input.outputWidth * m_input.outputHeight;
-        m_rayList.InitBuffer(m_pDevice, "HSR - Ray List", &CD3DX12_RESOURCE_DESC::Buffer(num_pixels * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), elementSize,
-                             D3D12_RESOURCE_STATE_COMMON);
-        m_hwRayList.InitBuffer(m_pDevice, "HSR - HW Ray List", &CD3DX12_RESOURCE_DESC::Buffer(num_pixels * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), elementSize,
-                               D3D12_RESOURCE_STATE_COMMON);
-        m_denoiseTileList.InitBuffer(m_pDevice, "HSR - Denoise Tile List", &CD3DX12_RESOURCE_DESC::Buffer(num_tiles * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
-                                     elementSize, D3D12_RESOURCE_STATE_COMMON);
-        size_t gbuffer_size = 12;
-        m_GBufferList.InitBuffer(m_pDevice, "HSR - Ray GBuffer List", &CD3DX12_RESOURCE_DESC::Buffer(width * height * gbuffer_size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
-                                 elementSize, D3D12_RESOURCE_STATE_COMMON);
+        // Placed in the heaps of the frame graph, resources with disjoint lifetimes within the frame share memory.
+        UINT64              num_pixels   = (UINT64)m_input.outputWidth * m_input.outputHeight;
+        size_t              gbuffer_size = m_input.compactRayGbuffer ? FFX_REFLECTIONS_COMPACT_RAY_GBUFFER_SIZE : FFX_REFLECTIONS_RAY_GBUFFER_SIZE;
+        DXGI_FORMAT         format       = m_input.packedRadiance ? DXGI_FORMAT_R11G11B10_FLOAT : DXGI_FORMAT_R16G16B16A16_FLOAT;
+        D3D12_RESOURCE_DESC descs[HSR_TRANSIENT_COUNT];
+        descs[HSR_TRANSIENT_RAY_LIST]                 = CD3DX12_RESOURCE_DESC::Buffer(num_pixels * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        descs[HSR_TRANSIENT_HW_RAY_LIST]              = CD3DX12_RESOURCE_DESC::Buffer(num_pixels * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        descs[HSR_TRANSIENT_BINNED_HW_RAY_LIST]       = CD3DX12_RESOURCE_DESC::Buffer(num_pixels * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        descs[HSR_TRANSIENT_RAY_GBUFFER]              = CD3DX12_RESOURCE_DESC::Buffer(num_pixels * gbuffer_size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        descs[HSR_TRANSIENT_DENOISE_TILE_LIST]        = CD3DX12_RESOURCE_DESC::Buffer(num_tiles * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        descs[HSR_TRANSIENT_ACTIVE_DENOISE_TILE_LIST] = CD3DX12_RESOURCE_DESC::Buffer(num_tiles * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        descs[HSR_TRANSIENT_CONVERGED_TILE_LIST]      = CD3DX12_RESOURCE_DESC::Buffer(num_tiles * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        descs[HSR_TRANSIENT_RADIANCE_REPROJECTED] =
+            CD3DX12_RESOURCE_DESC::Tex2D(format, m_input.outputWidth, m_input.outputHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        wchar_t const *names[HSR_TRANSIENT_COUNT] = {L"HSR - Ray List",           L"HSR - HW Ray List",
+                                                     L"HSR - Binned HW Ray List", L"HSR - Ray GBuffer List",
+                                                     L"HSR - Denoise Tile List", L"HSR - Active Denoise Tile List",
+                                                     L"HSR - Converged Tile List", L"Radiance Result Reprojected"};
+        TransientResourceDX12 *handles[HSR_TRANSIENT_COUNT] = {&m_rayList,         &m_hwRayList,             &m_binnedHwRayList,   &m_GBufferList,
+                                                               &m_denoiseTileList, &m_activeDenoiseTileList, &m_convergedTileList, &m_radianceReprojected};
+
+        HsrFrameGraphConfig config;
+        config.materialBinning = m_input.materialBinning;
+        config.convergedTiles  = m_input.convergedTiles;
+        for (uint32_t t = 0; t < HSR_TRANSIENT_COUNT; t++) m_transientHeap.Describe(descs[t], config.transients[t]);
+        std::string error;
+        bool        built = BuildHsrFrameGraph(m_frameGraph, config, &error);
+        if (!built) Trace(format("HSR: frame graph: %s\n", error.c_str()));
+        assert(built);
+
+        ThrowIfFailed(m_transientHeap.CreateHeaps(m_frameGraph.graph));
+        uint64_t heaps = 0, unaliased = 0;
+        for (uint32_t group = 0; group < m_frameGraph.graph.GetHeapGroupCount(); group++) {
+            heaps += m_frameGraph.graph.GetHeapSize(group);
+            unaliased += m_frameGraph.graph.GetUnaliasedSize(group);
+        }
+        for (uint32_t t = 0; t < HSR_TRANSIENT_COUNT; t++)
+            if (m_frameGraph.transients[t] != FRAME_GRAPH_INVALID) ThrowIfFailed(m_transientHeap.Place(m_frameGraph.graph, m_frameGraph.transients[t], descs[t], names[t], *handles[t]));
+        Trace(format("HSR: %.1f MB of transient resources in %.1f MB of heaps\n", unaliased / (1024.0 * 1024.0), heaps / (1024.0 * 1024.0)));
     }
     {
         CD3DX12_RESOURCE_DESC reflDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16_FLOAT, width, height, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
@@ -578,209 +905,264 @@ void HSR::CreateWindowSizeDependentResources() {
         m_roughnessTexture[1].Init(m_pDevice, "Reflection Denoiser - Extracted Roughness Texture 1", &roughnessTexture_Desc, D3D12_RESOURCE_STATE_COMMON, nullptr);
     }
     {
-        m_metricsUAVBuffer.InitBuffer(m_pDevice, "HSR - Metrics", &CD3DX12_RESOURCE_DESC::Buffer(16 * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), elementSize,
-                                      D3D12_RESOURCE_STATE_COMMON);
-        m_pMetricsUploadBuffer = AllocCPUVisible(m_pDevice->GetDevice(), 16 * elementSize);
+        m_metricsUAVBuffer.InitBuffer(m_pDevice, "HSR - Metrics", &CD3DX12_RESOURCE_DESC::Buffer(HSR_METRICS_WORD_COUNT * elementSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+                                      elementSize, D3D12_RESOURCE_STATE_COMMON);
+        m_pMetricsUploadBuffer = AllocCPUVisible(m_pDevice->GetDevice(), m_frameCountBeforeReuse * HSR_METRICS_WORD_COUNT * elementSize);
+        m_metricsReadback.OnCreate(m_frameCountBeforeReuse);
         m_pMetricsUploadBuffer->Map(0, NULL, (void **)&m_pMetricsMap);
     }
 
-    {
-        CD3DX12_RESOURCE_DESC Desc =
-            CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT, m_input.outputWidth, m_input.outputHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-        m_debugImage.Init(m_pDevice, "HSR Debug Image", &Desc, D3D12_RESOURCE_STATE_COMMON, nullptr);
-    }
+    // The debug target is allocated by the first Draw with the debug view on.
+    UpdateMemoryReport();
     m_bufferIndex = 0;
 }
 
-void HSR::SetupPSOTable(int mask) {
-    auto createPSOTable = [this](int mask, std::map<const std::string, std::string> const &extra_defines) {
-        PSOTable &old_psoTable  = m_psoTables[mask];
-        PSOTable  copy_psoTable = old_psoTable;
-        auto      createPSO     = [this](std::string const &filename, std::map<const std::string, std::string> const &_defines, std::string const &entry,
-                                std::map<const std::string, std::string> const &extra_defines = {}) {
-            D3D12_SHADER_BYTECODE shaderByteCode = {};
-            DefineList            defines;
-            for (auto &item : _defines) defines[item.first] = item.second;
-            for (auto &item : extra_defines) defines[item.first] = item.second;
-            CompileShaderFromFile(filename.c_str(), &defines, entry.c_str(), "-T cs_6_5 /Zi /Zss", &shaderByteCode);
-            {
-                D3D12_COMPUTE_PIPELINE_STATE_DESC descPso = {};
-                descPso.CS                                = shaderByteCode;
-                descPso.Flags                             = D3D12_PIPELINE_STATE_FLAG_NONE;
-                descPso.pRootSignature                    = m_pGlobalRootSignature;
-                descPso.NodeMask                          = 0;
-                ID3D12PipelineState *pPSO                 = NULL;
-                HRESULT              hr                   = m_pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&pPSO));
-                if (SUCCEEDED(hr))
-                    return pPSO;
-                else
-                    return (ID3D12PipelineState *)NULL;
-            }
-        };
-        if (extra_defines.size() == 0) {
-            if (m_pPrimaryRayTracingPSO) m_pPrimaryRayTracingPSO->Release();
-            m_pPrimaryRayTracingPSO = createPSO("PrimaryRayTracing.hlsl", {}, "main", {});
-        }
-        PSOTable new_psoTable{};
-        new_psoTable.m_pAccumulate             = createPSO("Accumulate.hlsl", {}, "main", extra_defines);
-        new_psoTable.m_pClassifyTiles          = createPSO("ClassifyTiles.hlsl", {}, "main", extra_defines);
-        new_psoTable.m_pHybridPSODeferred      = createPSO("Intersect.hlsl",
-                                                      {
-                                                          {"USE_SSR", "1"},
-                                                          {"USE_DEFERRED_SSR", "1"},
-                                                      },
-                                                      "main", extra_defines);
-        new_psoTable.m_pPrepareIndirectSW      = createPSO("PrepareIndirectArgs.hlsl", {}, "main", extra_defines);
-        new_psoTable.m_pReproject              = createPSO("Reproject.hlsl", {}, "main", extra_defines);
-        new_psoTable.m_pPrepareIndirect        = createPSO("Intersect.hlsl", {}, "PrepareIndirect", extra_defines);
-        new_psoTable.m_pResetDownsampleCounter = createPSO("Intersect.hlsl", {}, "ClearDownsampleCounter", extra_defines);
-        new_psoTable.m_pPrefilter              = createPSO("Prefilter.hlsl", {}, "main", extra_defines);
-        new_psoTable.m_pResolveTemporal        = createPSO("TemporalAccumulation.hlsl", {}, "main", extra_defines);
-        new_psoTable.m_pRTPSODeferred          = createPSO("Intersect.hlsl", {{"USE_INLINE_RAYTRACING", "1"}, {"USE_DEFERRED_RAYTRACING", "1"}}, "main", extra_defines);
-        new_psoTable.m_pDeferredShadeRays      = createPSO("Intersect.hlsl", {}, "DeferredShade", extra_defines);
-        new_psoTable.m_pApplyReflections       = createPSO("ApplyReflections.hlsl", {}, "main", extra_defines);
-        new_psoTable.m_pDownsampleGbuffer      = createPSO("HalfResGbuffer.hlsl", {}, "main", extra_defines);
-        old_psoTable.m_pAccumulate             = new_psoTable.m_pAccumulate ? new_psoTable.m_pAccumulate : old_psoTable.m_pAccumulate;
-        old_psoTable.m_pClassifyTiles          = new_psoTable.m_pClassifyTiles ? new_psoTable.m_pClassifyTiles : old_psoTable.m_pClassifyTiles;
-        old_psoTable.m_pHybridPSODeferred      = new_psoTable.m_pHybridPSODeferred ? new_psoTable.m_pHybridPSODeferred : old_psoTable.m_pHybridPSODeferred;
-        old_psoTable.m_pPrepareIndirectSW      = new_psoTable.m_pPrepareIndirectSW ? new_psoTable.m_pPrepareIndirectSW : old_psoTable.m_pPrepareIndirectSW;
-        old_psoTable.m_pReproject              = new_psoTable.m_pReproject ? new_psoTable.m_pReproject : old_psoTable.m_pReproject;
-        old_psoTable.m_pPrepareIndirect        = new_psoTable.m_pPrepareIndirect ? new_psoTable.m_pPrepareIndirect : old_psoTable.m_pPrepareIndirect;
-        old_psoTable.m_pResetDownsampleCounter = new_psoTable.m_pResetDownsampleCounter ? new_psoTable.m_pResetDownsampleCounter : old_psoTable.m_pResetDownsampleCounter;
-        old_psoTable.m_pPrefilter              = new_psoTable.m_pPrefilter ? new_psoTable.m_pPrefilter : old_psoTable.m_pPrefilter;
-        old_psoTable.m_pResolveTemporal        = new_psoTable.m_pResolveTemporal ? new_psoTable.m_pResolveTemporal : old_psoTable.m_pResolveTemporal;
-        old_psoTable.m_pRTPSODeferred          = new_psoTable.m_pRTPSODeferred ? new_psoTable.m_pRTPSODeferred : old_psoTable.m_pRTPSODeferred;
-        old_psoTable.m_pDeferredShadeRays      = new_psoTable.m_pDeferredShadeRays ? new_psoTable.m_pDeferredShadeRays : old_psoTable.m_pDeferredShadeRays;
-        old_psoTable.m_pApplyReflections       = new_psoTable.m_pApplyReflections ? new_psoTable.m_pApplyReflections : old_psoTable.m_pApplyReflections;
-        old_psoTable.m_pDownsampleGbuffer      = new_psoTable.m_pDownsampleGbuffer ? new_psoTable.m_pDownsampleGbuffer : old_psoTable.m_pDownsampleGbuffer;
-
-        if (!old_psoTable.m_pAccumulate) throw 1;
-        if (!old_psoTable.m_pClassifyTiles) throw 1;
-        if (!old_psoTable.m_pHybridPSODeferred) throw 1;
-        if (!old_psoTable.m_pReproject) throw 1;
-        if (!old_psoTable.m_pPrepareIndirectSW) throw 1;
-        if (!old_psoTable.m_pPrepareIndirect) throw 1;
-        if (!old_psoTable.m_pResetDownsampleCounter) throw 1;
-        if (!old_psoTable.m_pPrefilter) throw 1;
-        if (!old_psoTable.m_pResolveTemporal) throw 1;
-        if (!old_psoTable.m_pRTPSODeferred) throw 1;
-        if (!old_psoTable.m_pDeferredShadeRays) throw 1;
-        if (!old_psoTable.m_pApplyReflections) throw 1;
-        if (!old_psoTable.m_pDownsampleGbuffer) throw 1;
-
-        // Release old ones
-        if (copy_psoTable.m_pAccumulate && copy_psoTable.m_pAccumulate != old_psoTable.m_pAccumulate) copy_psoTable.m_pAccumulate->Release();
-        if (copy_psoTable.m_pClassifyTiles && copy_psoTable.m_pClassifyTiles != old_psoTable.m_pClassifyTiles) copy_psoTable.m_pClassifyTiles->Release();
-        if (copy_psoTable.m_pHybridPSODeferred && copy_psoTable.m_pHybridPSODeferred != old_psoTable.m_pHybridPSODeferred) copy_psoTable.m_pHybridPSODeferred->Release();
-        if (copy_psoTable.m_pPrepareIndirectSW && copy_psoTable.m_pPrepareIndirectSW != old_psoTable.m_pPrepareIndirectSW) copy_psoTable.m_pPrepareIndirectSW->Release();
-        if (copy_psoTable.m_pReproject && copy_psoTable.m_pReproject != old_psoTable.m_pReproject) copy_psoTable.m_pReproject->Release();
-        if (copy_psoTable.m_pPrepareIndirect && copy_psoTable.m_pPrepareIndirect != old_psoTable.m_pPrepareIndirect) copy_psoTable.m_pPrepareIndirect->Release();
-        if (copy_psoTable.m_pResetDownsampleCounter && copy_psoTable.m_pResetDownsampleCounter != old_psoTable.m_pResetDownsampleCounter)
-            copy_psoTable.m_pResetDownsampleCounter->Release();
-        if (copy_psoTable.m_pPrefilter && copy_psoTable.m_pPrefilter != old_psoTable.m_pPrefilter) copy_psoTable.m_pPrefilter->Release();
-        if (copy_psoTable.m_pResolveTemporal && copy_psoTable.m_pResolveTemporal != old_psoTable.m_pResolveTemporal) copy_psoTable.m_pResolveTemporal->Release();
-        if (copy_psoTable.m_pRTPSODeferred && copy_psoTable.m_pRTPSODeferred != old_psoTable.m_pRTPSODeferred) copy_psoTable.m_pRTPSODeferred->Release();
-        if (copy_psoTable.m_pDeferredShadeRays && copy_psoTable.m_pDeferredShadeRays != old_psoTable.m_pDeferredShadeRays) copy_psoTable.m_pDeferredShadeRays->Release();
-        if (copy_psoTable.m_pApplyReflections && copy_psoTable.m_pApplyReflections != old_psoTable.m_pApplyReflections) copy_psoTable.m_pApplyReflections->Release();
-        if (copy_psoTable.m_pDownsampleGbuffer && copy_psoTable.m_pDownsampleGbuffer != old_psoTable.m_pDownsampleGbuffer) copy_psoTable.m_pDownsampleGbuffer->Release();
-    };
-    createPSOTable(0 | 0 | 0 | 0, {});
-    createPSOTable(1 | 0 | 0 | 0, {{"HSR_DEBUG", "1"}});
-    createPSOTable(0 | 2 | 0 | 0, {{"HSR_TRANSPARENT_QUERY", "1"}});
-    createPSOTable(1 | 2 | 0 | 0, {{"HSR_TRANSPARENT_QUERY", "1"}, {"HSR_DEBUG", "1"}});
-
-    createPSOTable(0 | 0 | 0 | 8, {{"UPSCALE", "1"}});
-    createPSOTable(1 | 0 | 0 | 8, {{"UPSCALE", "1"}, {"HSR_DEBUG", "1"}});
-    createPSOTable(0 | 2 | 0 | 8, {{"UPSCALE", "1"}, {"HSR_TRANSPARENT_QUERY", "1"}});
-    createPSOTable(1 | 2 | 0 | 8, {{"UPSCALE", "1"}, {"HSR_TRANSPARENT_QUERY", "1"}, {"HSR_DEBUG", "1"}});
-
-    createPSOTable(0 | 0 | 4 | 0, {{"HSR_SHADING_USE_SCREEN", "1"}});
-    createPSOTable(1 | 0 | 4 | 0, {{"HSR_DEBUG", "1"}, {"HSR_SHADING_USE_SCREEN", "1"}});
-    createPSOTable(0 | 2 | 4 | 0, {{"HSR_TRANSPARENT_QUERY", "1"}, {"HSR_SHADING_USE_SCREEN", "1"}});
-    createPSOTable(1 | 2 | 4 | 0, {{"HSR_TRANSPARENT_QUERY", "1"}, {"HSR_DEBUG", "1"}, {"HSR_SHADING_USE_SCREEN", "1"}});
-
-    createPSOTable(0 | 0 | 4 | 8, {{"UPSCALE", "1"}, {"HSR_SHADING_USE_SCREEN", "1"}});
-    createPSOTable(1 | 0 | 4 | 8, {{"UPSCALE", "1"}, {"HSR_DEBUG", "1"}, {"HSR_SHADING_USE_SCREEN", "1"}});
-    createPSOTable(0 | 2 | 4 | 8, {{"UPSCALE", "1"}, {"HSR_TRANSPARENT_QUERY", "1"}, {"HSR_SHADING_USE_SCREEN", "1"}});
-    createPSOTable(1 | 2 | 4 | 8, {{"UPSCALE", "1"}, {"HSR_TRANSPARENT_QUERY", "1"}, {"HSR_DEBUG", "1"}, {"HSR_SHADING_USE_SCREEN", "1"}});
+void HSR::PrewarmPSOs(std::vector<uint32_t> const &masks) {
+    std::vector<uint32_t> shipping;
+    for (uint32_t mask : masks)
+        if (!(mask & HSR_PERMUTATION_DEBUG)) shipping.push_back(mask);
+    m_psoTables.Prewarm(shipping);
 }
 
-void HSR::SetupPerformanceCounters() {
-    // Create timestamp querying resources if enabled
-    if (m_isPerformanceCountersEnabled) {
-        ID3D12Device *device = m_pDevice->GetDevice();
-
-        auto const query_heap_size = (int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT * m_frameCountBeforeReuse * sizeof(std::uint64_t);
-
-        D3D12_QUERY_HEAP_DESC query_heap_desc = {};
-        query_heap_desc.Type                  = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
-        query_heap_desc.Count                 = static_cast<UINT>(query_heap_size);
-
-        ThrowIfFailed(device->CreateQueryHeap(&query_heap_desc, IID_PPV_ARGS(&m_pTimestampQueryHeap)));
-
-        D3D12_HEAP_PROPERTIES heap_properties = {};
-        heap_properties.Type                  = D3D12_HEAP_TYPE_READBACK;
-        heap_properties.CreationNodeMask      = 1u;
-        heap_properties.VisibleNodeMask       = 1u;
-
-        D3D12_RESOURCE_DESC resource_desc = {};
-        resource_desc.Dimension           = D3D12_RESOURCE_DIMENSION_BUFFER;
-        resource_desc.Width               = static_cast<UINT64>(query_heap_size);
-        resource_desc.Height              = 1u;
-        resource_desc.DepthOrArraySize    = 1u;
-        resource_desc.MipLevels           = 1u;
-        resource_desc.SampleDesc.Count    = 1u;
-        resource_desc.Layout              = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-
-        ThrowIfFailed(device->CreateCommittedResource(&heap_properties, D3D12_HEAP_FLAG_NONE, &resource_desc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-                                                      IID_PPV_ARGS(&m_pTimestampQueryBuffer)));
-
-        m_pTimestampQueryBuffer->SetName(L"TimestampQueryBuffer");
-        m_timestampQueries.resize(m_frameCountBeforeReuse);
-        for (auto &timestamp_queries : m_timestampQueries) {
-            timestamp_queries.reserve((int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT);
+void HSR::UpdateDebugResources(bool active) {
+    if (active) {
+        m_debugFramesLeft = m_frameCountBeforeReuse;
+        if (!m_debugImage.GetResource()) {
+            CD3DX12_RESOURCE_DESC desc = GetDebugImageDesc();
+            m_debugImage.Init(m_pDevice, "HSR Debug Image", &desc, D3D12_RESOURCE_STATE_COMMON, nullptr);
+            UpdateMemoryReport();
+            Trace(format("HSR: allocated the %.1f MB debug target\n", m_memoryReport.debug / (1024.0 * 1024.0)));
         }
+        return;
+    }
+    if (!m_debugImage.GetResource()) return;
+    // No HSR_DEBUG permutation is recorded from the first frame with the debug view off, neither as a fallback. Their
+    // PSOs and the target are released once the frames in flight have retired.
+    if (m_debugFramesLeft == m_frameCountBeforeReuse)
+        m_psoTables.Evict(HSR_PERMUTATION_DEBUG, [this](PSOTable &table) { table.ForEach([this](ID3D12PipelineState *pPSO) { m_retiredPSOs.Retire(pPSO); }); });
+    if (m_debugFramesLeft > 0) {
+        m_debugFramesLeft--;
+        return;
     }
+    m_debugImage.OnDestroy();
+    UpdateMemoryReport();
+    Trace(format("HSR: released the %.1f MB debug target\n", m_memoryReport.debugOnDemand / (1024.0 * 1024.0)));
 }
 
-void HSR::QueryTimestamps(ID3D12GraphicsCommandList *pCommandList) {
-    // Query timestamp value prior to resolving the reflection view
-    if (m_isPerformanceCountersEnabled) {
-        auto &timestamp_queries = m_timestampQueries[m_timestampFrameIndex];
-
-        if (!timestamp_queries.empty()) {
-            std::uint64_t *data;
+CD3DX12_RESOURCE_DESC HSR::GetDebugImageDesc() const {
+    return CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT, m_input.outputWidth, m_input.outputHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+}
 
-            // Reset performance counters
-            for (int i = 0; i < (int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT; i++) m_GpuTicks[i] = 0;
+void HSR::UpdateMemoryReport() {
+    ID3D12Device *pDevice     = m_pDevice->GetDevice();
+    auto          descSize    = [pDevice](D3D12_RESOURCE_DESC const &desc) { return (uint64_t)pDevice->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes; };
+    auto          textureSize = [&](Texture &texture) { return texture.GetResource() ? descSize(texture.GetResource()->GetDesc()) : (uint64_t)0; };
+
+    HSRMemoryReport &report = m_memoryReport;
+    report.persistent       = 0;
+    for (Texture *pTexture : {&m_radianceBuffer[0], &m_radianceBuffer[1], &m_radianceAux[0], &m_radianceAux[1], &m_radianceAux[2], &m_radianceAux[3],
+                              &m_roughnessTexture[0], &m_roughnessTexture[1], &m_counterImage[0], &m_counterImage[1], &m_radianceAvg[0], &m_radianceAvg[1],
+                              &m_randomNumberImage, &m_materialBins, &m_metricsUAVBuffer})
+        report.persistent += textureSize(*pTexture);
+    report.transientHeaps = 0;
+    for (uint32_t group = 0; group < m_frameGraph.graph.GetHeapGroupCount(); group++) report.transientHeaps += m_frameGraph.graph.GetHeapSize(group);
+    report.debug         = textureSize(m_debugImage);
+    report.debugOnDemand = descSize(GetDebugImageDesc());
+}
 
-            auto const start_index = m_timestampFrameIndex * (int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT;
+ID3D12PipelineState *HSR::CreateComputePSO(std::string const &filename, std::map<const std::string, std::string> const &defines, std::string const &entry) {
+    D3D12_SHADER_BYTECODE shaderByteCode = {};
+    DefineList            defineList;
+    for (auto &item : defines) defineList[item.first] = item.second;
+    CompileShaderFromFile(filename.c_str(), &defineList, entry.c_str(), "-T cs_6_5 /Zi /Zss", &shaderByteCode);
+    {
+        D3D12_COMPUTE_PIPELINE_STATE_DESC descPso = {};
+        descPso.CS                                = shaderByteCode;
+        descPso.Flags                             = D3D12_PIPELINE_STATE_FLAG_NONE;
+        descPso.pRootSignature                    = m_pGlobalRootSignature;
+        descPso.NodeMask                          = 0;
+        ID3D12PipelineState *pPSO                 = NULL;
+        HRESULT              hr                   = m_pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&pPSO));
+        if (SUCCEEDED(hr))
+            return pPSO;
+        else
+            return (ID3D12PipelineState *)NULL;
+    }
+}
 
-            D3D12_RANGE read_range = {};
-            read_range.Begin       = start_index * sizeof(std::uint64_t);
-            read_range.End         = (start_index + timestamp_queries.size()) * sizeof(std::uint64_t);
+void HSR::CreatePrimaryRayTracingPSO() {
+    ID3D12PipelineState *pPSO = CreateComputePSO("PrimaryRayTracing.hlsl", {}, "main");
+    if (!pPSO) {
+        if (!m_pPrimaryRayTracingPSO) throw 1;
+        return;
+    }
+    m_retiredPSOs.Retire(m_pPrimaryRayTracingPSO);
+    m_pPrimaryRayTracingPSO = pPSO;
+}
 
-            m_pTimestampQueryBuffer->Map(0u, &read_range, reinterpret_cast<void **>(&data));
+HSR::PSOTable HSR::CreatePSOTable(uint32_t mask, PSOTable const *pPrevious, std::set<std::string> const *pChangedShaders) {
+    std::map<const std::string, std::string> extra_defines;
+    GetPermutationDefines(mask, extra_defines);
 
-            for (auto i = 0u, j = 1u; j < timestamp_queries.size(); ++i, ++j) {
-                auto const elapsed_time               = (data[j] - data[i]);
-                m_GpuTicks[(int)timestamp_queries[j]] = elapsed_time;
-            }
+    auto createPSO = [&](std::string const &filename, std::map<const std::string, std::string> const &_defines, std::string const &entry) {
+        // Unaffected by the reload, the previous PSO is kept by the merge below.
+        if (pPrevious && pChangedShaders && !pChangedShaders->count(filename)) return (ID3D12PipelineState *)NULL;
+        std::map<const std::string, std::string> defines = _defines;
+        for (auto &item : extra_defines) defines[item.first] = item.second;
+        return CreateComputePSO(filename, defines, entry);
+    };
 
-            m_pTimestampQueryBuffer->Unmap(0u, nullptr);
-            m_TotalTime = data[timestamp_queries.size() - 1] - data[0];
-        }
+    PSOTable new_psoTable{};
+    new_psoTable.m_pAccumulate             = createPSO("Accumulate.hlsl", {}, "main");
+    new_psoTable.m_pClassifyTiles          = createPSO("ClassifyTiles.hlsl", {}, "main");
+    new_psoTable.m_pHybridPSODeferred      = createPSO("Intersect.hlsl",
+                                              {
+                                                  {"USE_SSR", "1"},
+                                                  {"USE_DEFERRED_SSR", "1"},
+                                              },
+                                              "main");
+    new_psoTable.m_pPrepareIndirectSW      = createPSO("PrepareIndirectArgs.hlsl", {}, "main");
+    new_psoTable.m_pReproject              = createPSO("Reproject.hlsl", {}, "main");
+    new_psoTable.m_pPrepareIndirect        = createPSO("Intersect.hlsl", {}, "PrepareIndirect");
+    new_psoTable.m_pResetDownsampleCounter = createPSO("Intersect.hlsl", {}, "ClearDownsampleCounter");
+    new_psoTable.m_pPrefilter              = createPSO("Prefilter.hlsl", {}, "main");
+    new_psoTable.m_pResolveTemporal        = createPSO("TemporalAccumulation.hlsl", {}, "main");
+    new_psoTable.m_pRTPSODeferred          = createPSO("Intersect.hlsl", {{"USE_INLINE_RAYTRACING", "1"}, {"USE_DEFERRED_RAYTRACING", "1"}}, "main");
+    new_psoTable.m_pDeferredShadeRays      = createPSO("Intersect.hlsl", {}, "DeferredShade");
+    new_psoTable.m_pApplyReflections       = createPSO("ApplyReflections.hlsl", {}, "main");
+    new_psoTable.m_pDownsampleGbuffer      = createPSO("HalfResGbuffer.hlsl", {}, "main");
+    if (mask & HSR_PERMUTATION_MATERIAL_BINNING) {
+        new_psoTable.m_pCountMaterialBins   = createPSO("Intersect.hlsl", {}, "CountMaterialBins");
+        new_psoTable.m_pScanMaterialBins    = createPSO("Intersect.hlsl", {}, "ScanMaterialBins");
+        new_psoTable.m_pScatterMaterialBins = createPSO("Intersect.hlsl", {}, "ScatterMaterialBins");
+    }
+    if (mask & HSR_PERMUTATION_CONVERGED_TILES) {
+        new_psoTable.m_pClassifyConvergedTiles   = createPSO("ConvergedTiles.hlsl", {}, "ClassifyConvergedTiles");
+        new_psoTable.m_pPrepareConvergedTileArgs = createPSO("ConvergedTiles.hlsl", {}, "PrepareConvergedTileArgs");
+        new_psoTable.m_pKeepConvergedHistory     = createPSO("ConvergedTiles.hlsl", {}, "KeepConvergedHistory");
+    }
+    new_psoTable.m_pCaptureDenoiserInputs      = createPSO("DenoiserCapture.hlsl", {}, "CaptureInputs");
+    new_psoTable.m_pCaptureDenoiserTileMask    = createPSO("DenoiserCapture.hlsl", {}, "CaptureTileMask");
+    new_psoTable.m_pCaptureDenoiserReprojected = createPSO("DenoiserCapture.hlsl", {}, "CaptureReprojected");
+    new_psoTable.m_pCaptureDenoiserPrefiltered = createPSO("DenoiserCapture.hlsl", {}, "CapturePrefiltered");
+    new_psoTable.m_pCaptureDenoiserTemporal    = createPSO("DenoiserCapture.hlsl", {}, "CaptureTemporal");
+
+    // Keep the previous PSO for any shader that failed to compile, retire the ones that were replaced.
+    PSOTable old_psoTable = pPrevious ? *pPrevious : PSOTable{};
+    bool     complete     = true;
+    auto     merge        = [this, &complete](ID3D12PipelineState *&pNew, ID3D12PipelineState *pOld) {
+        if (!pNew)
+            pNew = pOld;
+        else
+            m_retiredPSOs.Retire(pOld);
+        if (!pNew) complete = false;
+    };
+    merge(new_psoTable.m_pAccumulate, old_psoTable.m_pAccumulate);
+    merge(new_psoTable.m_pClassifyTiles, old_psoTable.m_pClassifyTiles);
+    merge(new_psoTable.m_pHybridPSODeferred, old_psoTable.m_pHybridPSODeferred);
+    merge(new_psoTable.m_pPrepareIndirectSW, old_psoTable.m_pPrepareIndirectSW);
+    merge(new_psoTable.m_pReproject, old_psoTable.m_pReproject);
+    merge(new_psoTable.m_pPrepareIndirect, old_psoTable.m_pPrepareIndirect);
+    merge(new_psoTable.m_pResetDownsampleCounter, old_psoTable.m_pResetDownsampleCounter);
+    merge(new_psoTable.m_pPrefilter, old_psoTable.m_pPrefilter);
+    merge(new_psoTable.m_pResolveTemporal, old_psoTable.m_pResolveTemporal);
+    merge(new_psoTable.m_pRTPSODeferred, old_psoTable.m_pRTPSODeferred);
+    merge(new_psoTable.m_pDeferredShadeRays, old_psoTable.m_pDeferredShadeRays);
+    merge(new_psoTable.m_pApplyReflections, old_psoTable.m_pApplyReflections);
+    merge(new_psoTable.m_pDownsampleGbuffer, old_psoTable.m_pDownsampleGbuffer);
+    if (mask & HSR_PERMUTATION_MATERIAL_BINNING) {
+        merge(new_psoTable.m_pCountMaterialBins, old_psoTable.m_pCountMaterialBins);
+        merge(new_psoTable.m_pScanMaterialBins, old_psoTable.m_pScanMaterialBins);
+        merge(new_psoTable.m_pScatterMaterialBins, old_psoTable.m_pScatterMaterialBins);
+    }
+    if (mask & HSR_PERMUTATION_CONVERGED_TILES) {
+        merge(new_psoTable.m_pClassifyConvergedTiles, old_psoTable.m_pClassifyConvergedTiles);
+        merge(new_psoTable.m_pPrepareConvergedTileArgs, old_psoTable.m_pPrepareConvergedTileArgs);
+        merge(new_psoTable.m_pKeepConvergedHistory, old_psoTable.m_pKeepConvergedHistory);
+    }
+    merge(new_psoTable.m_pCaptureDenoiserInputs, old_psoTable.m_pCaptureDenoiserInputs);
+    merge(new_psoTable.m_pCaptureDenoiserTileMask, old_psoTable.m_pCaptureDenoiserTileMask);
+    merge(new_psoTable.m_pCaptureDenoiserReprojected, old_psoTable.m_pCaptureDenoiserReprojected);
+    merge(new_psoTable.m_pCaptureDenoiserPrefiltered, old_psoTable.m_pCaptureDenoiserPrefiltered);
+    merge(new_psoTable.m_pCaptureDenoiserTemporal, old_psoTable.m_pCaptureDenoiserTemporal);
+    // Only a first build has nothing to keep. Its PSOs were never used, release them and let the cache serve another
+    // permutation.
+    if (!complete) {
+        new_psoTable.OnDestroy();
+        throw 1;
+    }
+    return new_psoTable;
+}
 
-        timestamp_queries.clear();
+void HSR::SetupPSOTables() {
+    CreatePrimaryRayTracingPSO();
+    // Permutations are compiled the first time Draw asks for them. While one is compiling the closest ready
+    // permutation is used instead, but never one with different HSR_PERMUTATION_REQUIRED_BITS.
+    m_psoTables.Init([this](uint32_t mask, PSOTable const *pPrevious) { return CreatePSOTable(mask, pPrevious); }, //
+                     [](PSOTable &table) { table.OnDestroy(); },                                                    //
+                     HSR_PERMUTATION_REQUIRED_BITS);
+}
 
-        pCommandList->EndQuery(m_pTimestampQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, GetTimestampQueryIndex());
+void HSR::WriteCapturedRayHits() {
+    if (!m_pRayHitsReadback) return;
+    if (m_rayHitsFramesLeft > 0) {
+        m_rayHitsFramesLeft--;
+        return;
+    }
+    uint8_t *pData = NULL;
+    if (SUCCEEDED(m_pRayHitsReadback->Map(0, NULL, (void **)&pData))) {
+        uint32_t    stride = m_input.compactRayGbuffer ? FFX_REFLECTIONS_COMPACT_RAY_GBUFFER_SIZE : FFX_REFLECTIONS_RAY_GBUFFER_SIZE;
+        uint32_t    count  = *(uint32_t *)pData;
+        std::string error;
+        if (SaveRecordedRayHits(m_rayHitsCapturePath, stride, count, pData + 16, &error))
+            Trace(format("HSR: wrote %u ray hits to %s\n", count, m_rayHitsCapturePath.c_str()));
+        else
+            Trace(format("HSR: %s\n", error.c_str()));
+        m_pRayHitsReadback->Unmap(0, NULL);
+    }
+    m_pRayHitsReadback->Release();
+    m_pRayHitsReadback = NULL;
+    m_rayHitsCapturePath.clear();
+}
 
-        timestamp_queries.push_back(HSRTimestampQuery::TIMESTAMP_QUERY_INIT);
+void HSR::WriteCapturedDenoiser() {
+    if (!m_pDenoiserReadback || !m_denoiserCaptureRecorded) return;
+    if (m_denoiserFramesLeft > 0) {
+        m_denoiserFramesLeft--;
+        return;
     }
+    float *pData = NULL;
+    if (SUCCEEDED(m_pDenoiserReadback->Map(0, NULL, (void **)&pData))) {
+        DenoiserCapture capture;
+        capture.constants = m_denoiserConstants;
+        capture.planes.Resize(m_input.outputWidth, m_input.outputHeight, DENOISER_CAPTURE_PLANE_COUNT);
+        memcpy(capture.planes.data.data(), pData, capture.planes.data.size() * sizeof(float));
+        m_pDenoiserReadback->Unmap(0, NULL);
+        std::string error;
+        if (SaveDenoiserCapture(m_denoiserCapturePath, capture, &error))
+            Trace(format("HSR: wrote the denoiser capture to %s\n", m_denoiserCapturePath.c_str()));
+        else
+            Trace(format("HSR: %s\n", error.c_str()));
+    }
+    m_pDenoiserReadback->Release();
+    m_pDenoiserReadback = NULL;
+    m_denoiserCapture.OnDestroy();
+    m_denoiserCaptureRecorded = false;
+    m_denoiserCapturePath.clear();
 }
 
-uint32_t HSR::GetTimestampQueryIndex() const {
-    return m_timestampFrameIndex * (int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT + static_cast<uint32_t>(m_timestampQueries[m_timestampFrameIndex].size());
+void HSR::SetupPerformanceCounters() {
+    // Create timestamp querying resources if enabled
+    if (m_isPerformanceCountersEnabled) {
+        // Two queries per scope, HSR records about 20 scopes a frame.
+        uint32_t const queries_per_frame = 64;
+        if (!m_timestampSource.OnCreate(m_pDevice->GetDevice(), m_pDevice->GetGraphicsQueue(), m_frameCountBeforeReuse, queries_per_frame)) {
+            Trace("HSR: could not create the timestamp query heap, pass timings are disabled\n");
+            m_isPerformanceCountersEnabled = false;
+            return;
+        }
+        m_timing.OnCreate(&m_timestampSource, m_frameCountBeforeReuse, queries_per_frame);
+    }
 }
 
 } // namespace HSR_SAMPLE_DX12
\ No newline at end of file
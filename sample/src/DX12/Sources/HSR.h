@@ -25,8 +25,22 @@ THE SOFTWARE.
 #include "Base/Texture.h"
 #include "BlueNoiseSampler.h"
 #include "BufferDX12.h"
+#include "DenoiserReference.h"
+#include "DescriptorSetCache.h"
 #include "GltfPbrPass.h"
+#include "HsrFrameGraph.h"
+#include "HsrMetrics.h"
+#include "HsrPermutations.h"
+#include "ClusteredLightsBuilder.h"
+#include "DecalBinning.h"
+#include "LightGridBuilder.h"
+#include "LightListBuilder.h"
+#include "PermutationCache.h"
 #include "PostProc/MagnifierPS.h"
+#include "ReflectionGbufferReference.h"
+#include "ShaderDependencyGraph.h"
+#include "TransientHeapDX12.h"
+#include "Utils.h"
 
 namespace hlsl {
 
@@ -74,6 +88,32 @@ static char const *GetTimestampName(int slot) {
     return TimestampQueryNames[slot];
 }
 
+// Path of the GPU timing scope each legacy slot reports, see GpuTimingCollector.
+static char const *GetTimestampScope(int slot) {
+    static char const *const TimestampQueryScopes[] = {
+        "",
+        "Downsample GBuffer",
+        "Classify tiles",
+        "Intersection/SW",
+        "Intersection/HW",
+        "Denoise/Reproject",
+        "Denoise/Prefilter",
+        "Denoise/Temporal",
+        "Apply reflections",
+    };
+    return TimestampQueryScopes[slot];
+}
+
+// Video memory of the window size dependent HSR resources, in bytes.
+struct HSRMemoryReport {
+    uint64_t persistent     = 0; // Committed resources that are kept across frames.
+    uint64_t transientHeaps = 0; // Heaps of the frame graph.
+    uint64_t debug          = 0; // Debug target, only allocated while the debug view is on.
+    uint64_t debugOnDemand  = 0; // Size of the debug target at the current resolution, saved while it is not allocated.
+    // Ready PSO tables built with HSR_DEBUG.
+    uint32_t debugPermutations = 0;
+};
+
 struct State {
     float  time;
     float  deltaTime;
@@ -129,20 +169,72 @@ struct State {
     bool            bWeapon             = false;
     bool            isBenchmarking      = false;
     std::string     screenshotName;
+    // Consumed by the next frame, see HSR::CaptureRayHits.
+    std::string     rayHitsCaptureName;
+    // Consumed by the next frame, see HSR::CaptureDenoiser.
+    std::string     denoiserCaptureName;
+    // Consumed by the next frame, see HSR::CaptureBarriers.
+    std::string     barrierCaptureName;
+    // Consumed by the next frame that draws reflections, see ReflectionGbufferReference.h.
+    std::string     gbufferCaptureName;
     hlsl::FrameInfo frameInfo            = {};
     bool            bTAA                 = false;
     bool            bTAAJitter           = false;
     bool            bOptimizedDownsample = false;
     bool            bRenderDecals        = true;
+    bool            bCompactRayGbuffer   = false;
+    bool            bMaterialBinning     = false;
+    bool            bPackedRadiance      = false;
+    bool            bConvergedTiles      = false;
+    bool            bCacheShadowMaps     = true;
+    // Derive the reflection resolution G-buffer from the render resolution one instead of drawing the scene again
+    // when it is not the optimized half resolution, with the REFLECTION_GBUFFER_FOOTPRINT_* policy below.
+    bool            bReconstructReflectionGbuffer = false;
+    uint32_t        reflectionGbufferFootprint    = REFLECTION_GBUFFER_FOOTPRINT_CENTER;
+    // Shade reflection hits with the lights of their cell of the light grid only, see LightGrid.h.
+    bool            bLightGrid                    = true;
+    // Light pixels of the raster pass with the lights of their view space cluster only, see ClusteredLights.h.
+    bool            bClusteredLights              = true;
     float           SunLightIntensity    = 10.0f;
     // In microseconds
     double hsr_timestamps[(int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT] = {};
+    // Unsmoothed values of the last resolved frame, for the benchmark log. In microseconds.
+    double hsr_timestamps_last[(int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT] = {};
+    double hsr_total_time_last                                                = 0.0;
+    // Hierarchical HSR pass timings with rolling min/avg/max, null when performance counters are disabled.
+    GpuTimingCollector const *pHsrTiming = nullptr;
 
     float m_ReflectionResolutionMultiplier = 0.5f;
+    // HSR PSO permutations to build in the background before their first use, see HSR_PERMUTATION_*.
+    std::vector<uint32_t> psoPrewarmMasks;
 
     double m_numSWRays = 0.0;
     double m_numHWRays = 0.0;
     double m_numHYRays = 0.0;
+    // Unsmoothed ray counts of the last frame.
+    double m_lastSWRays = 0.0;
+    double m_lastHWRays = 0.0;
+    double m_lastHYRays = 0.0;
+    // Full metrics block of frame hsrMetricsFrame, read back once that frame has retired. -1 before the first one.
+    HsrMetrics hsrMetrics;
+    int64_t    hsrMetricsFrame = -1;
+    // Barriers HSR::Draw recorded in the last frame.
+    ResourceStateTrackerStats hsrBarrierStats;
+    HSRMemoryReport           hsrMemory;
+    // Shadow maps rendered and kept from the previous frame.
+    uint32_t shadowMapsRendered = 0;
+    uint32_t shadowMapsCached   = 0;
+    // Casters in the frustums of the rendered shadow maps, summed over them, and in the scene.
+    uint32_t shadowCastersDrawn = 0;
+    uint32_t shadowCastersScene = 0;
+    // Light grid of the last frame.
+    LightGridBuilder::Stats lightGridStats;
+    // Clustered lights of the last frame.
+    ClusteredLightsBuilder::Stats clusteredLightsStats;
+    // Light list upload of the last frame.
+    LightListBuilder::Stats lightListStats;
+    // Decal bins of the last frame.
+    DecalBinning::Stats decalStats;
 
     bool                        bUseMagnifier = false;
     bool                        bLockMagnifierPosition;
@@ -158,6 +250,14 @@ struct HSRCreationInfo {
     uint32_t inputHeight;
     uint32_t outputWidth;
     uint32_t outputHeight;
+    // 8 instead of 12 bytes per ray in the deferred shading GBuffer, see Shaders/RayGbuffer.h.
+    bool compactRayGbuffer = false;
+    // Sort the HW hits by material before deferred shading, see MaterialBinning.h.
+    bool materialBinning = false;
+    // R11G11B10 instead of RGBA16 radiance targets with a dithered quantizer, see Shaders/PackedRadiance.h.
+    bool packedRadiance = false;
+    // Converged denoise tiles keep their history instead of going through the denoiser, see Shaders/ConvergedTiles.h.
+    bool convergedTiles = false;
 };
 
 class HSR {
@@ -168,6 +268,9 @@ public:
         Texture *pNormals;
         Texture *pSpecularRoughness;
         Texture *pMotionVectors;
+        // The previous frame's depth and normals when they rest in COMMON like the above, null when the caller keeps them readable.
+        Texture *pDepthHistory;
+        Texture *pNormalsHistory;
     };
     HSR();
     void OnCreate(Device *pDevice, ID3D12RootSignature *pGlobalRootSignature, StaticResourceViewHeap &cpuVisibleHeap, ResourceViewHeaps &resourceHeap, UploadHeap &uploadHeap,
@@ -178,20 +281,48 @@ public:
     void OnDestroyWindowSizeDependentResources();
 
     void     Draw(ID3D12GraphicsCommandList *pCommandList, Texture *pHDROut, ReflectionGBuffer *pLowResGbuffer, CBV_SRV_UAV *pGlobalTable, SAMPLER *pGlobalSamplers, State *pState);
-    Texture *GetDebugTexture() { return &m_debugImage; }
+    // Null while the debug view is off, see UpdateDebugResources.
+    Texture *GetDebugTexture() { return m_debugImage.GetResource() ? &m_debugImage : nullptr; }
 
-    std::uint64_t GetTimestamp(int slot) const { return m_GpuTicks[slot]; }
-    std::uint64_t GetTotalTime() const { return m_TotalTime; }
+    // In microseconds, for the frame GetTiming().GetResultFrame() which lags a few frames behind.
+    double                    GetTimestamp(int slot) const { return slot == 0 ? 0.0 : m_timing.GetLastUs(GetTimestampScope(slot)); }
+    double                    GetTotalTime() const { return m_timing.GetFrameUs(); }
+    GpuTimingCollector const &GetTiming() const { return m_timing; }
     void          Recompile();
+    // Rebuilds only the PSOs compiled from the listed root shaders, old PSOs are released once no frame uses them.
+    void Reload(std::set<std::string> const &changedShaders);
+    // Root shader files of every HSR PSO, for the shader change detector.
+    static std::vector<std::string> GetShaderFiles();
+    // Queue background builds of PSO permutations that are expected to be used, see HSR_PERMUTATION_*. HSR_DEBUG
+    // permutations are left out, they are built when the debug view is turned on.
+    void PrewarmPSOs(std::vector<uint32_t> const &masks);
+    // Writes the ray GBuffer of the next frame with HW rays to 'filename' once the GPU is done with it, see
+    // LoadRecordedRayHits.
+    void CaptureRayHits(std::string const &filename) { m_rayHitsCapturePath = filename; }
+    // Writes the inputs and the pass outputs of the next frame that runs the denoiser to 'filename' once the GPU is
+    // done with them, see LoadDenoiserCapture.
+    void CaptureDenoiser(std::string const &filename) { m_denoiserCapturePath = filename; }
+    // Writes the barrier requests of the next frame to 'filename', see ReplayResourceStateLog.
+    void CaptureBarriers(std::string const &filename) { m_barrierCapturePath = filename; }
 
 private:
     void CreateResources();
     void CreateWindowSizeDependentResources();
 
-    void     SetupPSOTable(int mask);
-    void     SetupPerformanceCounters();
-    void     QueryTimestamps(ID3D12GraphicsCommandList *pCommandList);
-    uint32_t GetTimestampQueryIndex() const;
+    void                 SetupPSOTables();
+    void                 CreatePrimaryRayTracingPSO();
+    ID3D12PipelineState *CreateComputePSO(std::string const &filename, std::map<const std::string, std::string> const &defines, std::string const &entry);
+    void                 SetupPerformanceCounters();
+    void                 WriteCapturedRayHits();
+    // The HSR descriptors of the global table for the current m_bufferIndex, and the resources they view.
+    void                 WriteDescriptorSet(CBV_SRV_UAV *pGlobalTable);
+    void                 GetDescriptorSetResources(std::vector<void const *> &resources);
+    void                 WriteCapturedDenoiser();
+    // Allocates the debug target while the debug view is on. Once it is off, evicts the HSR_DEBUG permutations and
+    // releases the target when the frames in flight are done with it.
+    void                 UpdateDebugResources(bool active);
+    CD3DX12_RESOURCE_DESC GetDebugImageDesc() const;
+    void                 UpdateMemoryReport();
 
     Device *                m_pDevice;
     DynamicBufferRing *     m_pConstantBufferRing;
@@ -202,14 +333,36 @@ private:
 
     HSRCreationInfo m_input;
 
+    // Passes and transient resources of a frame. The transient resources only live within a frame and share the
+    // heaps of m_transientHeap, see HsrFrameGraph.h.
+    HsrFrameGraph     m_frameGraph;
+    TransientHeapDX12 m_transientHeap;
+
+    // Global tables that already hold the HSR descriptors of one m_bufferIndex. Invalidated with the window size
+    // dependent resources.
+    DescriptorSetCache m_descriptorCache;
+
+    // Barriers of Draw, batched per pass boundary, see ResourceStateTracker.h.
+    ResourceStateTracker m_stateTracker;
+    D3D12BarrierSink     m_barrierSink;
+    std::string          m_barrierCapturePath;
+
     // Containing SW rays that need to be traced.
-    Texture m_rayList;
+    TransientResourceDX12 m_rayList;
     // List of HW rays
-    Texture m_hwRayList;
+    TransientResourceDX12 m_hwRayList;
     // Buffer for deferred ray traced shading
-    Texture m_GBufferList;
+    TransientResourceDX12 m_GBufferList;
+    // Per material bin counters followed by the bin offsets, and the HW ray indices sorted by bin. Only created with
+    // materialBinning.
+    Texture               m_materialBins;
+    TransientResourceDX12 m_binnedHwRayList;
     // List of tiles for denoiser
-    Texture m_denoiseTileList;
+    TransientResourceDX12 m_denoiseTileList;
+    // The denoise tiles split into the ones the denoiser passes run on and the converged ones. Only created with
+    // convergedTiles.
+    TransientResourceDX12 m_activeDenoiseTileList;
+    TransientResourceDX12 m_convergedTileList;
     // Contains the number of rays that we trace and tiles for denoiser.
     Texture m_rayCounter;
     Texture m_intersectionPassIndirectArgs;
@@ -219,20 +372,41 @@ private:
     /////////////////////////
     // GPU Visible buffer
     Texture m_metricsUAVBuffer;
-    // CPU Visible buffer
+    // CPU Visible buffer, one HSR_METRICS_WORD_COUNT slot per frame in flight
     ID3D12Resource *m_pMetricsUploadBuffer = NULL;
     // CPU Visible pointer
-    int32_t *m_pMetricsMap = NULL;
+    uint32_t *m_pMetricsMap = NULL;
+    // Slot of each frame in m_pMetricsUploadBuffer, one per frame in flight.
+    HsrMetricsReadback m_metricsReadback;
     /////////////////////////
 
-    // For visualization purposes
-    Texture m_debugImage;
+    // Ray GBuffer copy for CaptureRayHits, written to disk once the frame has retired.
+    ID3D12Resource *m_pRayHitsReadback = NULL;
+    std::string     m_rayHitsCapturePath;
+    uint32_t        m_rayHitsFramesLeft = 0;
+
+    // DENOISER_CAPTURE_PLANE_COUNT fp32 planes for CaptureDenoiser and their readback copy, only alive while a capture
+    // is pending. m_denoiserConstants is the FrameInfo of the recorded frame.
+    Texture           m_denoiserCapture;
+    ID3D12Resource *  m_pDenoiserReadback = NULL;
+    std::string       m_denoiserCapturePath;
+    bool              m_denoiserCaptureRecorded = false;
+    uint32_t          m_denoiserFramesLeft      = 0;
+    DenoiserConstants m_denoiserConstants;
+
+    // For visualization purposes, only allocated while the debug view is on. m_debugFramesLeft counts down the frames
+    // after it was last used.
+    Texture  m_debugImage;
+    uint32_t m_debugFramesLeft = 0;
+    // Updated whenever a resource of the report is allocated or released.
+    HSRMemoryReport m_memoryReport;
     // Extracted roughness values, also double buffered to keep the history.
     Texture m_roughnessTexture[2];
 
-    // 0, 1 - ping-pong, 2 - for reprojection
-    Texture m_radianceBuffer[3]; // rgba16 or r11g11b10
-    Texture m_radianceAux[4];    // r16
+    // Ping-pong and the reprojected radiance, rgba16, r11g11b10 with packedRadiance
+    Texture               m_radianceBuffer[2];
+    TransientResourceDX12 m_radianceReprojected;
+    Texture               m_radianceAux[4]; // r16
 
     ///////////////////////////////////////////
     // Per Tile Images : 1/8th of resolution //
@@ -270,26 +444,48 @@ private:
         ID3D12PipelineState *m_pPrefilter       = nullptr;
         ID3D12PipelineState *m_pResolveTemporal = nullptr;
 
+        // Only in HSR_PERMUTATION_MATERIAL_BINNING tables.
+        ID3D12PipelineState *m_pCountMaterialBins   = nullptr;
+        ID3D12PipelineState *m_pScanMaterialBins    = nullptr;
+        ID3D12PipelineState *m_pScatterMaterialBins = nullptr;
+
+        // Only in HSR_PERMUTATION_CONVERGED_TILES tables.
+        ID3D12PipelineState *m_pClassifyConvergedTiles   = nullptr;
+        ID3D12PipelineState *m_pPrepareConvergedTileArgs = nullptr;
+        ID3D12PipelineState *m_pKeepConvergedHistory     = nullptr;
+
+        // DenoiserCapture.hlsl, see CaptureDenoiser.
+        ID3D12PipelineState *m_pCaptureDenoiserInputs      = nullptr;
+        ID3D12PipelineState *m_pCaptureDenoiserTileMask    = nullptr;
+        ID3D12PipelineState *m_pCaptureDenoiserReprojected = nullptr;
+        ID3D12PipelineState *m_pCaptureDenoiserPrefiltered = nullptr;
+        ID3D12PipelineState *m_pCaptureDenoiserTemporal    = nullptr;
+
+        // Calls f for every PSO of the table that was built.
+        template <typename F> void ForEach(F f) const {
+            ID3D12PipelineState *psos[] = {
+                m_pAccumulate, m_pDeferredShadeRays, m_pDownsampleGbuffer, m_pReproject, m_pPrefilter, m_pPrepareIndirectSW,
+                m_pClassifyTiles, m_pRTPSODeferred, m_pHybridPSODeferred, m_pPrepareIndirect, m_pResolveTemporal,
+                m_pResetDownsampleCounter, m_pApplyReflections, m_pCountMaterialBins, m_pScanMaterialBins, m_pScatterMaterialBins,
+                m_pClassifyConvergedTiles, m_pPrepareConvergedTileArgs, m_pKeepConvergedHistory, m_pCaptureDenoiserInputs,
+                m_pCaptureDenoiserTileMask, m_pCaptureDenoiserReprojected, m_pCaptureDenoiserPrefiltered, m_pCaptureDenoiserTemporal,
+            };
+            for (ID3D12PipelineState *pPSO : psos)
+                if (pPSO) f(pPSO);
+        }
+
         void OnDestroy() {
-            if (m_pAccumulate) m_pAccumulate->Release();
-            if (m_pDeferredShadeRays) m_pDeferredShadeRays->Release();
-            if (m_pDownsampleGbuffer) m_pDownsampleGbuffer->Release();
-            if (m_pReproject) m_pReproject->Release();
-            if (m_pPrefilter) m_pPrefilter->Release();
-            if (m_pPrepareIndirectSW) m_pPrepareIndirectSW->Release();
-            if (m_pClassifyTiles) m_pClassifyTiles->Release();
-            if (m_pRTPSODeferred) m_pRTPSODeferred->Release();
-            if (m_pHybridPSODeferred) m_pHybridPSODeferred->Release();
-            if (m_pPrepareIndirect) m_pPrepareIndirect->Release();
-            if (m_pResolveTemporal) m_pResolveTemporal->Release();
-            if (m_pResetDownsampleCounter) m_pResetDownsampleCounter->Release();
-            if (m_pApplyReflections) m_pApplyReflections->Release();
+            ForEach([](ID3D12PipelineState *pPSO) { pPSO->Release(); });
             *this = {};
         }
     };
 
-    // Flags -> pso
-    std::unordered_map<uint32_t, PSOTable> m_psoTables;
+    PSOTable CreatePSOTable(uint32_t mask, PSOTable const *pPrevious, std::set<std::string> const *pChangedShaders = nullptr);
+
+    // Flags -> pso, permutations are built on first use.
+    PermutationCache<PSOTable> m_psoTables;
+    // PSOs replaced by a reload, waiting for the frames in flight to retire.
+    RetiredPSOQueue m_retiredPSOs;
 
     // The command signature for the indirect dispatches.
     ID3D12CommandSignature *m_pCommandSignature;
@@ -297,20 +493,10 @@ private:
     uint32_t m_frameCountBeforeReuse;
     uint32_t m_bufferIndex;
 
-    // The type definition for an array of timestamp queries.
-    using TimestampQueries = std::vector<HSRTimestampQuery>;
-
-    // The query heap for the recorded timestamps.
-    ID3D12QueryHeap *m_pTimestampQueryHeap = NULL;
-    // The buffer for reading the timestamp queries.
-    ID3D12Resource *m_pTimestampQueryBuffer = NULL;
-    // The number of GPU ticks spent in the tile classification pass.
-    std::uint64_t m_GpuTicks[(int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT]{};
-    std::uint64_t m_TotalTime = 0;
-    // The array of timestamp that were queried.
-    std::vector<TimestampQueries> m_timestampQueries;
-    // The index of the active set of timestamp queries.
-    uint32_t m_timestampFrameIndex;
-    bool     m_isPerformanceCountersEnabled;
+    // Timestamp queries of the frames in flight and the pass timings read back from them.
+    D3D12TimestampSource m_timestampSource;
+    GpuTimingCollector   m_timing;
+    uint64_t             m_timingFrame = 0;
+    bool                 m_isPerformanceCountersEnabled;
 };
 } // namespace HSR_SAMPLE_DX12
\ No newline at end of file
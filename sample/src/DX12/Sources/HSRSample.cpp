@@ -24,6 +24,7 @@ THE SOFTWARE.
 
 #include "HSRSample.h"
 #include "base/ShaderCompilerCache.h"
+#include <ctime>
 #include <iomanip>
 #include <sstream>
 
@@ -397,10 +398,107 @@ void HSRSample::BuildUI() {
                                                                m_State.hsr_timestamps[(int)HSRTimestampQuery::TIMESTAMP_QUERY_INTERSECTION_HW]) *
                                                        100.0f);
             ImGui::Value("Total Rays", (float)(m_State.m_numHWRays + m_State.m_numSWRays));
+            if (ImGui::CollapsingHeader("Ray budget") && m_State.hsrMetricsFrame >= 0) {
+                const HsrMetrics &metrics = m_State.hsrMetrics;
+                ImGui::Text("Frame %lld, metrics version %u", (long long)m_State.hsrMetricsFrame, metrics.version);
+                ImGui::Text("SS rejected by confidence  %8llu (%.1f%%)", (unsigned long long)metrics.swConfidenceRejected, 100.0 * metrics.SwRejectRate());
+                ImGui::Text("  of which too rough for HW %8llu", (unsigned long long)metrics.swRoughFallback);
+                ImGui::Text("SS misses                  %8llu (%.1f%%)", (unsigned long long)metrics.swMisses, 100.0 * metrics.SwMissRate());
+                ImGui::Text("HW misses                  %8llu (%.1f%%)", (unsigned long long)metrics.hwMisses, 100.0 * metrics.HwMissRate());
+                ImGui::Text("HW transparent hits        %8llu", (unsigned long long)metrics.hwTransparentHits);
+                ImGui::Text("Deferred shade skips       %8llu (%.1f%%)", (unsigned long long)metrics.deferredShadeSkips, 100.0 * metrics.DeferredShadeSkipRate());
+                ImGui::Text("Denoiser tiles             %8llu", (unsigned long long)metrics.denoiseTiles);
+
+                float rayLengths[HSR_METRICS_HISTOGRAM_BINS], marches[HSR_METRICS_HISTOGRAM_BINS];
+                for (int i = 0; i < HSR_METRICS_HISTOGRAM_BINS; i++) {
+                    rayLengths[i] = (float)metrics.rayLengthHistogram[i];
+                    marches[i]    = (float)metrics.marchHistogram[i];
+                }
+                int rayLengthMedian = HsrMetricsPercentileBin(metrics.rayLengthHistogram, 50.0);
+                int marchMedian     = HsrMetricsPercentileBin(metrics.marchHistogram, 50.0);
+                ImGui::PlotHistogram("Ray length (log2)", rayLengths, HSR_METRICS_HISTOGRAM_BINS, 0,
+                                     rayLengthMedian < 0 ? "" : format("median >= %g", HsrRayLengthBinLowerBound(rayLengthMedian)).c_str(), 0.0f, FLT_MAX, ImVec2(0, 60));
+                ImGui::PlotHistogram("SS march px (log2)", marches, HSR_METRICS_HISTOGRAM_BINS, 0,
+                                     marchMedian < 0 ? "" : format("median >= %g", HsrMarchBinLowerBound(marchMedian)).c_str(), 0.0f, FLT_MAX, ImVec2(0, 60));
+            }
+            if (ImGui::CollapsingHeader("Memory")) {
+                const HSRMemoryReport &memory = m_State.hsrMemory;
+                auto const             mb     = [](uint64_t bytes) { return bytes / (1024.0 * 1024.0); };
+                ImGui::Text("Persistent        %8.1f MB", mb(memory.persistent));
+                ImGui::Text("Transient heaps   %8.1f MB", mb(memory.transientHeaps));
+                ImGui::Text("Debug target      %8.1f MB", mb(memory.debug));
+                if (!memory.debug) ImGui::Text("  saved           %8.1f MB", mb(memory.debugOnDemand));
+                ImGui::Text("Debug PSO tables  %8u", memory.debugPermutations);
+            }
+            if (ImGui::CollapsingHeader("Shadow maps")) {
+                ImGui::Checkbox("Cache shadow maps", &m_State.bCacheShadowMaps);
+                ImGui::Text("Rendered          %6u", m_State.shadowMapsRendered);
+                ImGui::Text("Kept              %6u", m_State.shadowMapsCached);
+                ImGui::Text("Casters in view   %6u of %u per map", m_State.shadowMapsRendered ? m_State.shadowCastersDrawn / m_State.shadowMapsRendered : 0,
+                            m_State.shadowCastersScene);
+            }
+            if (ImGui::CollapsingHeader("Light grid")) {
+                const LightGridBuilder::Stats &grid = m_State.lightGridStats;
+                ImGui::Checkbox("Shade hits with the lights of their cell", &m_State.bLightGrid);
+                ImGui::Text("Lights            %6u, %u global", grid.lights, grid.globalLights);
+                ImGui::Text("Cells             %6u, %u with lights", grid.cells, grid.occupiedCells);
+                ImGui::Text("Cell size         %.2f x %.2f x %.2f", grid.cellSize[0], grid.cellSize[1], grid.cellSize[2]);
+                ImGui::Text("Lights per cell   %6.2f, at most %u", grid.occupiedCells ? double(grid.listEntries) / grid.occupiedCells : 0.0, grid.maxCellLights);
+                ImGui::Text("Buffer            %6.1f KB", grid.words * 4 / 1024.0);
+            }
+            if (ImGui::CollapsingHeader("Clustered lights")) {
+                const ClusteredLightsBuilder::Stats &clusters = m_State.clusteredLightsStats;
+                ImGui::Checkbox("Light pixels with the lights of their cluster", &m_State.bClusteredLights);
+                ImGui::Text("Lights            %6u, %u global", clusters.lights, clusters.globalLights);
+                ImGui::Text("Clusters          %6u, %u with lights", clusters.clusters, clusters.occupiedClusters);
+                ImGui::Text("Tiles x slices    %u x %u x %u", clusters.dimensions[0], clusters.dimensions[1], clusters.dimensions[2]);
+                ImGui::Text("Deepest light     %6.1f", clusters.farDepth);
+                ImGui::Text("Lights per cluster %5.2f, at most %u", clusters.occupiedClusters ? double(clusters.listEntries) / clusters.occupiedClusters : 0.0,
+                            clusters.maxClusterLights);
+                ImGui::Text("Buffer            %6.1f KB", clusters.words * 4 / 1024.0);
+            }
+            if (ImGui::CollapsingHeader("Light list")) {
+                const LightListBuilder::Stats &list = m_State.lightListStats;
+                ImGui::Text("Lights            %6u, %u uploaded", list.lights, list.dirtyLights);
+                ImGui::Text("Uploaded          %6u B, frame info %u B", list.uploadedBytes, uint32_t(sizeof(FrameInfo)));
+                ImGui::Text("Frames unchanged  %6.1f %%", list.uploads + list.skippedUploads ? 100.0 * list.skippedUploads / (list.uploads + list.skippedUploads) : 0.0);
+            }
+            if (ImGui::CollapsingHeader("Decals")) {
+                ImGui::Checkbox("Render decals", &m_State.bRenderDecals);
+                const DecalBinning::Stats &decals = m_State.decalStats;
+                ImGui::Text("Decals            %6u, %u visible, %u dropped", decals.decals, decals.visibleDecals, decals.droppedDecals);
+                ImGui::Text("Tiles             %6u of %u, %u px", decals.occupiedTiles, decals.tiles, decals.tileSize);
+                ImGui::Text("Decals per tile   %6.1f, max %u", decals.occupiedTiles ? double(decals.listEntries) / decals.occupiedTiles : 0.0, decals.maxTileDecals);
+                ImGui::Text("Uploaded          %6u B", decals.words * 4);
+            }
+            if (ImGui::CollapsingHeader("Barriers")) {
+                const ResourceStateTrackerStats &barriers = m_State.hsrBarrierStats;
+                ImGui::Text("Requests          %6u", barriers.requests);
+                ImGui::Text("ResourceBarrier   %6u", barriers.batches);
+                ImGui::Text("Transitions       %6u", barriers.transitions);
+                ImGui::Text("  of which split  %6u", barriers.splits);
+                ImGui::Text("  merged          %6u", barriers.merged);
+                ImGui::Text("UAV barriers      %6u", barriers.uavBarriers);
+                ImGui::Text("  dropped         %6u", barriers.droppedUAV);
+                ImGui::Text("Aliasing barriers %6u", barriers.aliasing);
+                if (ImGui::Button("Capture Barriers")) {
+                    static int g_barriers_cnt = 0;
+                    m_State.barrierCaptureName = std::string("barriers_") + std::to_string(g_barriers_cnt++) + std::string(".txt");
+                }
+            }
             if (ImGui::CollapsingHeader("Detailed timings")) {
                 for (int i = 0; i < (int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT; i++) {
                     ImGui::Value(GetTimestampName(i), (float)m_State.hsr_timestamps[i], "%.1f us");
                 }
+                if (m_State.pHsrTiming) {
+                    ImGui::Separator();
+                    ImGui::Text("%-28s %8s %8s %8s", "GPU scope (us)", "min", "avg", "max");
+                    const auto &scopes = m_State.pHsrTiming->GetScopes();
+                    for (int id : m_State.pHsrTiming->GetScopeOrder()) {
+                        const GpuTimingScope &scope = scopes[id];
+                        ImGui::Text("%*s%-*s %8.1f %8.1f %8.1f", 2 * scope.depth, "", 28 - 2 * scope.depth, scope.name.c_str(), scope.stats.minUs, scope.stats.avgUs, scope.stats.maxUs);
+                    }
+                }
             }
 
         }
@@ -571,6 +669,30 @@ void HSRSample::BuildUI() {
             if (update_size && !m_State.bOptimizedDownsample) m_State.m_ReflectionResolutionMultiplier = 1.0f;
             if (!m_State.bOptimizedDownsample) {
                 wrap_imgui("Reflection Resolution(Each dimension):", "", [&] { update_size |= ImGui::SliderFloat("", &m_State.m_ReflectionResolutionMultiplier, 0.1f, 1.0f); });
+                update_size |= ImGui::Checkbox("Reconstruct Reflection GBuffer(compute instead of second raster)", &m_State.bReconstructReflectionGbuffer);
+                if (m_State.bReconstructReflectionGbuffer) {
+                    char const *footprint_items[] = {"Center", "Closest", "Glossiest"};
+                    wrap_imgui("Reflection GBuffer Footprint:", "Which render resolution sample a reflection pixel keeps, see ReflectionGbuffer.h",
+                               [&] { ImGui::Combo("", (int *)&m_State.reflectionGbufferFootprint, footprint_items, REFLECTION_GBUFFER_FOOTPRINT_COUNT); });
+                }
+            }
+            update_size |= ImGui::Checkbox("Compact Ray GBuffer(8 bytes per ray)", &m_State.bCompactRayGbuffer);
+            update_size |= ImGui::Checkbox("Material Binning(sort HW hits before shading)", &m_State.bMaterialBinning);
+            update_size |= ImGui::Checkbox("Packed Radiance(R11G11B10 denoiser targets)", &m_State.bPackedRadiance);
+            update_size |= ImGui::Checkbox("Converged Tiles(keep history of converged denoise tiles)", &m_State.bConvergedTiles);
+            if (ImGui::Button("Capture HW Ray Hits")) {
+                static int g_ray_hits_cnt = 0;
+                m_State.rayHitsCaptureName = std::string("ray_hits_") + std::to_string(g_ray_hits_cnt++) + std::string(".bin");
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Capture Denoiser")) {
+                static int g_denoiser_cnt = 0;
+                m_State.denoiserCaptureName = std::string("denoiser_") + std::to_string(g_denoiser_cnt++) + std::string(".dnsr");
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Capture GBuffer")) {
+                static int g_gbuffer_cnt = 0;
+                m_State.gbufferCaptureName = std::string("gbuffer_") + std::to_string(g_gbuffer_cnt++) + std::string(".gbuf");
             }
             if (update_size) {
                 UpdateReflectionResolution();
@@ -831,6 +953,118 @@ void HSRSample::LoadScene(int sceneIndex) {
 //--------------------------------------------------------------------------------------
 void HSRSample::OnUpdateDisplay() {}
 
+//--------------------------------------------------------------------------------------
+//
+// StartBenchmarkLog
+//
+//--------------------------------------------------------------------------------------
+void HSRSample::StartBenchmarkLog(std::string const &baseName) {
+    std::string deviceName, driverVersion;
+    m_device.GetDeviceInfo(&deviceName, &driverVersion);
+    std::time_t now = std::time(nullptr);
+    char        date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    m_benchBaseName = baseName;
+    m_BenchLog      = BenchmarkLog();
+    m_BenchLog.SetMetadata("date", date);
+    m_BenchLog.SetMetadata("device", deviceName);
+    m_BenchLog.SetMetadata("driver", driverVersion);
+    m_BenchLog.SetMetadata("scene", m_SceneNames.empty() ? "" : m_SceneNames[m_selectedScene]);
+    m_BenchLog.SetMetadata("width", std::to_string(m_Node->getWidth()));
+    m_BenchLog.SetMetadata("height", std::to_string(m_Node->getHeight()));
+    m_BenchLog.SetMetadata("reflection_width", std::to_string(m_ReflectionWidth));
+    m_BenchLog.SetMetadata("reflection_height", std::to_string(m_ReflectionHeight));
+    m_BenchLog.SetMetadata("reflection_optimized_half_resolution", m_State.bOptimizedDownsample ? "1" : "0");
+    m_BenchLog.SetMetadata("reconstruct_reflection_gbuffer", m_State.bReconstructReflectionGbuffer ? "1" : "0");
+    m_BenchLog.SetMetadata("reflection_gbuffer_footprint", GetReflectionGbufferFootprintName(m_State.reflectionGbufferFootprint));
+    m_BenchLog.SetMetadata("compact_ray_gbuffer", m_State.bCompactRayGbuffer ? "1" : "0");
+    m_BenchLog.SetMetadata("material_binning", m_State.bMaterialBinning ? "1" : "0");
+    m_BenchLog.SetMetadata("packed_radiance", m_State.bPackedRadiance ? "1" : "0");
+    m_BenchLog.SetMetadata("converged_tiles", m_State.bConvergedTiles ? "1" : "0");
+    m_BenchLog.SetMetadata("cache_shadow_maps", m_State.bCacheShadowMaps ? "1" : "0");
+    m_BenchLog.SetMetadata("light_grid", m_State.bLightGrid ? "1" : "0");
+    m_BenchLog.SetMetadata("clustered_lights", m_State.bClusteredLights ? "1" : "0");
+    m_BenchLog.SetMetadata("hsr_mask", std::to_string(m_State.frameInfo.hsr_mask));
+    m_BenchLog.SetMetadata("benchmark_num_loops", std::to_string(m_BenchNumLoops));
+    m_BenchLog.SetMetadata("benchmark_camera_path", m_BenchCameraPathName);
+    m_BenchLog.SetMetadata("benchmark_fixed_timestep", std::to_string(m_BenchFixedTimestep));
+    m_BenchMetrics      = HsrMetrics();
+    m_BenchMetricsFrame = m_State.hsrMetricsFrame;
+#ifdef _DEBUG
+    m_BenchLog.SetMetadata("build", "debug");
+#else
+    m_BenchLog.SetMetadata("build", "release");
+#endif
+
+    std::vector<std::string> columns = {"frame", "animation_time"};
+    for (int i = 1; i < (int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT; i++) columns.push_back(std::string(GetTimestampName(i)) + "_us");
+    columns.push_back("FFX_HSR_TOTAL_us");
+    columns.push_back("sw_rays");
+    columns.push_back("hw_rays");
+    columns.push_back("hybrid_rays");
+    columns.push_back("sw_confidence_rejected");
+    columns.push_back("sw_rough_fallback");
+    columns.push_back("sw_misses");
+    columns.push_back("hw_misses");
+    columns.push_back("hw_transparent_hits");
+    columns.push_back("deferred_shade_skips");
+    columns.push_back("denoise_tiles");
+    m_BenchLog.SetColumns(columns);
+
+    m_BenchFrameDump.open(m_benchBaseName + "_frames.csv", std::ofstream::out);
+    m_BenchLog.WriteCsvHeader(m_BenchFrameDump);
+}
+
+//--------------------------------------------------------------------------------------
+//
+// FinishBenchmarkLog
+//
+//--------------------------------------------------------------------------------------
+void HSRSample::FinishBenchmarkLog() {
+    if (m_BenchFrameDump.is_open()) m_BenchFrameDump.close();
+
+    auto histogram = [](uint64_t const(&bins)[HSR_METRICS_HISTOGRAM_BINS]) {
+        std::string text;
+        for (int i = 0; i < HSR_METRICS_HISTOGRAM_BINS; i++) text += (i ? " " : "") + std::to_string(bins[i]);
+        return text;
+    };
+    m_BenchLog.SetMetadata("metrics_version", std::to_string(m_BenchMetrics.version));
+    m_BenchLog.SetMetadata("metrics_frames", std::to_string(m_BenchMetrics.frameCount));
+    m_BenchLog.SetMetadata("ray_length_histogram", histogram(m_BenchMetrics.rayLengthHistogram));
+    m_BenchLog.SetMetadata("march_histogram", histogram(m_BenchMetrics.marchHistogram));
+    m_BenchLog.SetMetadata("sw_reject_rate", std::to_string(m_BenchMetrics.SwRejectRate()));
+    m_BenchLog.SetMetadata("hw_miss_rate", std::to_string(m_BenchMetrics.HwMissRate()));
+    m_BenchLog.SetMetadata("deferred_shade_skip_rate", std::to_string(m_BenchMetrics.DeferredShadeSkipRate()));
+    // Video memory of the HSR resources at the end of the run, the debug target only counts with the debug view on.
+    HSRMemoryReport const &memory = m_State.hsrMemory;
+    m_BenchLog.SetMetadata("hsr_memory_bytes", std::to_string(memory.persistent + memory.transientHeaps + memory.debug));
+    m_BenchLog.SetMetadata("hsr_debug_memory_bytes", std::to_string(memory.debug));
+
+    std::ofstream summary(m_benchBaseName + "_summary.json", std::ofstream::out);
+    m_BenchLog.WriteSummaryJson(summary);
+}
+
+//--------------------------------------------------------------------------------------
+//
+// LoadBenchmarkCameraPath, the scene entry can override the path given at the top level of the config
+//
+//--------------------------------------------------------------------------------------
+void HSRSample::LoadBenchmarkCameraPath() {
+    const json &scene     = m_JsonConfigFile["scenes"][m_selectedScene];
+    m_BenchCameraPathName = scene.value("benchmark_camera_path", m_JsonConfigFile.value("benchmark_camera_path", std::string("../media/BistroInterior.campath")));
+
+    std::string error;
+    if (!m_BenchCameraPath.Load(m_BenchCameraPathName, &error)) {
+        static wchar_t msg[0x200];
+        std::string    text = m_BenchCameraPathName + ": " + error;
+        std::wstring   wstr(text.c_str(), text.c_str() + text.size());
+        wsprintfW(msg, L"Couldn't load benchmark camera path %s", wstr.c_str());
+        ShowErrorMessageBox(msg);
+        exit(1);
+    }
+}
+
 //--------------------------------------------------------------------------------------
 //
 // OnResize
@@ -903,11 +1137,36 @@ void HSRSample::OnParseCommandLine(LPSTR lpCmdLine, uint32_t *pWidth, uint32_t *
         m_State.frameInfo.hsr_mask &= ~HSR_FLAGS_USE_RAY_TRACING;
     }
     m_BenchNumLoops                          = m_JsonConfigFile.value("benchmark_num_loops", 2);
+    m_BenchFixedTimestep                     = m_JsonConfigFile.value("benchmark_fixed_timestep", 0.0);
     m_selectedScene                          = m_JsonConfigFile.value("scene", 0);
     m_State.m_ReflectionResolutionMultiplier = (float)m_JsonConfigFile.value("reflection_resolution_multiplier", 1.0);
     m_State.bOptimizedDownsample             = m_JsonConfigFile.value("reflection_optimized_half_resolution", false);
+    m_State.bReconstructReflectionGbuffer    = m_JsonConfigFile.value("reconstruct_reflection_gbuffer", false);
+    m_State.reflectionGbufferFootprint       = min(m_JsonConfigFile.value("reflection_gbuffer_footprint", 0u), REFLECTION_GBUFFER_FOOTPRINT_COUNT - 1);
     m_State.bWeapon                          = m_JsonConfigFile.value("spoon", false);
     m_State.bFlashLight                      = m_JsonConfigFile.value("flashlight", true);
+    m_State.bCompactRayGbuffer               = m_JsonConfigFile.value("compact_ray_gbuffer", false);
+    m_State.bMaterialBinning                 = m_JsonConfigFile.value("material_binning", false);
+    m_State.bPackedRadiance                  = m_JsonConfigFile.value("packed_radiance", false);
+    m_State.bConvergedTiles                  = m_JsonConfigFile.value("converged_tiles", false);
+    m_State.bCacheShadowMaps                 = m_JsonConfigFile.value("cache_shadow_maps", true);
+    m_State.bLightGrid                       = m_JsonConfigFile.value("light_grid", true);
+    m_State.bClusteredLights                 = m_JsonConfigFile.value("clustered_lights", true);
+
+    // Each entry is either a permutation mask or a list of the defines it enables, e.g. ["UPSCALE", "HSR_DEBUG"].
+    m_State.psoPrewarmMasks.clear();
+    for (const auto &item : m_JsonConfigFile.value("pso_prewarm", json::array())) {
+        if (item.is_number()) {
+            m_State.psoPrewarmMasks.push_back(item.get<uint32_t>());
+            continue;
+        }
+        uint32_t mask = 0;
+        for (const auto &define : item) {
+            std::string name = define;
+            mask |= GetPermutationBit(name);
+        }
+        m_State.psoPrewarmMasks.push_back(mask);
+    }
     UpdateReflectionResolution();
 }
 
@@ -980,6 +1239,7 @@ void HSRSample::OnRender() {
             m_BenchLoopCounter = 0;
             m_BenchLoopPercent = 0;
             m_BenchLoopTime    = 0;
+            LoadBenchmarkCameraPath();
             {
                 std::stringstream ss;
                 ss << "HSR_Bench_";
@@ -1023,54 +1283,26 @@ void HSRSample::OnRender() {
                << "; ";
             ss << "\n";
             m_BenchFileDump << ss.str();
+
+            StartBenchmarkLog(m_benchName.substr(0, m_benchName.size() - 4));
         }
-        // Animate camera
-        m_BenchCameraTime                     = m_Time;
-        static double s_bench_camera_states[] = {
-            -0.61501,     3.49278,    -1.83146,   -0.945744,   0.17903,     -0.271138,  -0.366512, 3.43335,     -1.45999,   -0.971418, 0.159318,    -0.17597,   0.536377,
-            3.3815,       -0.700243,  -0.999908,  -0.00999981, -0.00920395, 1.34733,    3.43615,   -0.291151,   -0.990216,  -0.139543, 0.000787652, 2.22732,    3.5694,
-            -0.105629,    -0.987045,  -0.159318,  -0.0189581,  2.68974,     3.65475,    0.326454,  -0.979855,   -0.198669,  0.0203794, 3.30232,     3.74163,    0.956051,
-            -0.991379,    -0.129634,  -0.0190413, 4.53209,     3.80273,     2.00967,    -0.999118, -0.00999982, 0.040782,   6.38764,   3.68364,     2.2196,     -0.945312,
-            0.179029,     0.272643,   8.06598,    3.4788,      2.40337,     -0.22542,   0.149438,  0.962733,    9.86858,    3.46339,   1.71658,     0.763716,   -0.0399894,
-            0.644313,     10.0783,    3.45569,    1.62152,     0.983258,    -0.0299956, 0.179735,  10.5847,     3.46215,    0.53695,   0.983189,    0.139543,   -0.117755,
-            10.3324,      3.45851,    -0.564236,  0.980737,    0.188859,    0.0498638,  9.18135,   2.95263,     -1.56681,   0.292327,  0.522687,    0.800839,   8.95334,
-            2.32781,      -2.41488,   -0.559828,  0.659384,    0.501802,    9.00976,    2.14132,   -2.86396,    -0.868315,  0.488177,  0.0878194,   9.90266,    1.79922,
-            -2.88696,     -0.958074,  0.227978,   -0.173553,   9.84712,     1.78656,    -2.99189,  -0.87457,    0.169182,   -0.454427, 8.83349,     2.00996,    -3.26717,
-            -0.914024,    0.198669,   -0.35368,   7.55797,     2.14737,     -3.65629,   -0.92349,  0.139543,    -0.357343,  6.16599,   2.38609,     -4.1975,    -0.916997,
-            0.21823,      -0.333904,  4.65209,    2.95359,     -4.38887,    -0.909287,  0.398609,  0.119613,    4.03584,    3.30187,   -4.09329,    -0.470963,  0.488177,
-            0.734764,     4.92252,    2.87831,    -4.48996,    -0.321894,   0.49688,    0.805912,  4.96962,     2.33481,    -5.62967,  -0.355576,   0.40776,    0.84101,
-            4.86523,      1.8264,     -7.02659,   -0.574146,   0.40776,     0.709992,   5.8171,    1.26159,     -8.45272,   -0.596973, 0.227977,    0.769188,   6.22904,
-            1.10287,      -8.99722,   -0.577403,  0.198669,    0.791919,    6.65415,    1.02648,   -9.78676,    -0.960301,  0.17903,   -0.21394,    7.6406,     0.966826,
-            -9.83864,     0.280325,   0.169182,   -0.944878,   6.67937,     0.843547,   -9.30629,  0.546663,    0.00999972, -0.837293, 6.48158,     0.840352,   -9.016,
-            0.486689,     -0.0199988, -0.873347,  5.87092,     0.900982,    -7.81815,   0.579013,  -0.0499793,  -0.813785,  5.35436,   0.920755,    -6.37948,   0.975375,
-            -9.17005e-08, -0.220552,  4.29538,    0.896606,    -4.83539,    0.936307,   0.0299954, 0.349898,    3.96143,    0.894815,  -4.16748,    0.978474,   0.00999971,
-            0.206129,     3.24283,    1.01444,    -3.91378,    0.652186,    -0.247404,  -0.716551, 1.74549,     1.19733,    -3.00822,  -0.716704,   -0.0699429, -0.693861,
-            0.0850243,    1.17471,    -1.973,     -0.967961,   -0.109778,   -0.225831,  -0.415511, 1.12537,     -1.63756,   -0.966844, -0.119712,   -0.22557,   0.372078,
-            1.50253,      -1.84572,   -0.750903,  -0.597195,   -0.281961,   1.12339,    2.10404,   -1.54045,    -0.76646,   -0.597195, -0.236427,   1.86501,    2.70353,
-            -0.276091,    -0.928096,  -0.352274,  -0.120587,   1.9705,      2.79296,    -0.433438, -0.983949,   -0.0998335, -0.14791,  1.32905,     2.7194,     -1.09846,
-            -0.983949,    -0.0998336, -0.14791,   -0.29935,    2.55265,     -1.52865,   -0.964267, -0.0998336,  -0.245402,  -1.2094,   2.45927,     -1.72634,   -0.964267,
-            -0.0998336,   -0.245402,
-        };
-        int num_pnts       = ARRAYSIZE(s_bench_camera_states) / 6;
-        m_BenchLoopCounter = int(m_BenchCameraTime) / num_pnts;
+        // Animate camera. In fixed timestep mode frame N is rendered at path time N * dt regardless of the frame rate.
+        if (m_BenchFixedTimestep > 0.0) m_Time = float(m_frame_index * m_BenchFixedTimestep);
+        m_BenchCameraTime  = m_Time;
+        double duration    = m_BenchCameraPath.GetDuration();
+        m_BenchLoopCounter = duration > 0.0 ? int(m_BenchCameraTime / duration) : m_BenchNumLoops;
         if (m_BenchLoopCounter >= m_BenchNumLoops) {
             if (m_BenchFileDump.is_open()) m_BenchFileDump.close();
+            FinishBenchmarkLog();
             exit(0);
         }
-        int p0          = (int(m_BenchCameraTime) % num_pnts) * 6;
-        int p1          = (int(m_BenchCameraTime + 1.0f) % num_pnts) * 6;
-        m_BenchLoopTime = m_Time;
-        while (m_BenchLoopTime > num_pnts) m_BenchLoopTime -= float(num_pnts);
-        m_BenchLoopPercent = int(100.0f * m_BenchLoopTime / float(num_pnts));
-
-        // Simple linear interpolation of position and direction.
-        float               t0 = m_BenchCameraTime - int(m_BenchCameraTime);
-        Vectormath::Vector4 pos0{(float)s_bench_camera_states[p0 + 0], (float)s_bench_camera_states[p0 + 1], (float)s_bench_camera_states[p0 + 2], 0.0f};
-        Vectormath::Vector4 dir0{(float)s_bench_camera_states[p0 + 3], (float)s_bench_camera_states[p0 + 4], (float)s_bench_camera_states[p0 + 5], 0.0f};
-        Vectormath::Vector4 pos1{(float)s_bench_camera_states[p1 + 0], (float)s_bench_camera_states[p1 + 1], (float)s_bench_camera_states[p1 + 2], 0.0f};
-        Vectormath::Vector4 dir1{(float)s_bench_camera_states[p1 + 3], (float)s_bench_camera_states[p1 + 4], (float)s_bench_camera_states[p1 + 5], 0.0f};
-        Vectormath::Vector4 pos = Vectormath::SSE::lerp(t0, pos0, pos1);
-        Vectormath::Vector4 dir = Vectormath::SSE::normalize(Vectormath::SSE::lerp(t0, dir0, dir1));
+        m_BenchLoopTime    = m_BenchCameraTime - m_BenchLoopCounter * duration;
+        m_BenchLoopPercent = int(100.0 * m_BenchLoopTime / duration);
+
+        double position[3], direction[3];
+        m_BenchCameraPath.Evaluate(m_BenchLoopTime, position, direction);
+        Vectormath::Vector4 pos{(float)position[0], (float)position[1], (float)position[2], 0.0f};
+        Vectormath::Vector4 dir{(float)direction[0], (float)direction[1], (float)direction[2], 0.0f};
         m_State.camera.LookAt(pos, pos - dir * 10.0f);
 
         std::stringstream ss;
@@ -1088,6 +1320,27 @@ void HSRSample::OnRender() {
         for (auto &c : str)
             if (c == '.') c = ',';
         m_BenchFileDump << str;
+
+        std::vector<double> values = {(double)m_frame_index, m_BenchLoopTime};
+        for (int i = 1; i < (int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT; i++) values.push_back(m_State.hsr_timestamps_last[i]);
+        values.push_back(m_State.hsr_total_time_last);
+        values.push_back(m_State.m_lastSWRays);
+        values.push_back(m_State.m_lastHWRays);
+        values.push_back(m_State.m_lastHYRays);
+        const HsrMetrics &metrics = m_State.hsrMetrics;
+        values.push_back((double)metrics.swConfidenceRejected);
+        values.push_back((double)metrics.swRoughFallback);
+        values.push_back((double)metrics.swMisses);
+        values.push_back((double)metrics.hwMisses);
+        values.push_back((double)metrics.hwTransparentHits);
+        values.push_back((double)metrics.deferredShadeSkips);
+        values.push_back((double)metrics.denoiseTiles);
+        if (m_State.hsrMetricsFrame != m_BenchMetricsFrame) {
+            m_BenchMetrics.Accumulate(metrics);
+            m_BenchMetricsFrame = m_State.hsrMetricsFrame;
+        }
+        m_BenchLog.AddFrame(values);
+        m_BenchLog.WriteCsvFrame(m_BenchFrameDump, m_BenchLog.GetFrameCount() - 1);
     }
 
     // Animate and transform the scene
@@ -21,6 +21,8 @@ THE SOFTWARE.
 ********************************************************************/
 
 #pragma once
+#include "BenchmarkStats.h"
+#include "CameraPath.h"
 #include "SampleRenderer.h"
 
 //
@@ -98,4 +100,19 @@ private:
 	double m_BenchLoopTime = 0;
 	std::string m_benchName;
 	std::ofstream m_BenchFileDump;
+	// Structured output: per frame log with run metadata (<name>_frames.csv) and percentile summary (<name>_summary.json)
+	void StartBenchmarkLog(std::string const &baseName);
+	void FinishBenchmarkLog();
+	BenchmarkLog m_BenchLog;
+	std::ofstream m_BenchFrameDump;
+	std::string m_benchBaseName;
+	// Metrics blocks summed over the run, the histograms go into the summary
+	HsrMetrics m_BenchMetrics;
+	int64_t m_BenchMetricsFrame = -1;
+	// Fly-through loaded from the file named by "benchmark_camera_path", played back in seconds of m_Time
+	void LoadBenchmarkCameraPath();
+	CameraPath m_BenchCameraPath;
+	std::string m_BenchCameraPathName;
+	// Seconds of path time per frame, 0 follows the wall clock
+	double m_BenchFixedTimestep = 0.0;
 };
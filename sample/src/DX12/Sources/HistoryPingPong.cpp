@@ -0,0 +1,35 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "HistoryPingPong.h"
+
+void HistoryPingPong::Reset() {
+    m_write   = HISTORY_SURFACE_NONE;
+    m_history = HISTORY_SURFACE_NONE;
+}
+
+void HistoryPingPong::BeginFrame(bool pingPong) {
+    m_history = m_write;
+    if (!pingPong)
+        m_write = HISTORY_SURFACE_COPY;
+    else
+        m_write = m_history == HISTORY_SURFACE_SLOT_0 ? HISTORY_SURFACE_SLOT_1 : HISTORY_SURFACE_SLOT_0;
+}
@@ -0,0 +1,59 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+
+/**
+        Decides which surface a frame writes a history to and which one holds the previous frame, so a history the
+        frame renders into a surface of its own alternates between two of them instead of being copied.
+
+        A frame either ping-pongs, then it writes the slot the previous frame did not write, or copies, then it
+        renders into a surface it does not own and copies that into the copy surface once it is done reading. Either
+        way it reads the previous frame from wherever that frame left it, so switching between the two loses nothing.
+        There is no history after Reset, e.g. when the surfaces were recreated or a frame did not write the history.
+*/
+class HistoryPingPong {
+public:
+    enum Surface : uint32_t {
+        HISTORY_SURFACE_SLOT_0 = 0,
+        HISTORY_SURFACE_SLOT_1 = 1,
+        HISTORY_SURFACE_COPY   = 2,
+        HISTORY_SURFACE_NONE   = 3,
+    };
+
+    static bool IsSlot(Surface surface) { return surface <= HISTORY_SURFACE_SLOT_1; }
+
+    // Forgets the history.
+    void Reset();
+    // Starts a frame that writes a slot when 'pingPong' is set and the copy surface otherwise.
+    void BeginFrame(bool pingPong);
+
+    // Surface the frame writes, never the one GetHistory returns unless both are the copy surface.
+    Surface GetWrite() const { return m_write; }
+    // Surface that holds the previous frame, HISTORY_SURFACE_NONE when there is none.
+    Surface GetHistory() const { return m_history; }
+
+private:
+    Surface m_write   = HISTORY_SURFACE_NONE;
+    Surface m_history = HISTORY_SURFACE_NONE;
+};
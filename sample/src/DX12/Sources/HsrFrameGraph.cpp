@@ -0,0 +1,180 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include "HsrFrameGraph.h"
+
+#include "../../Shaders/RayGbuffer.h"
+
+char const *GetHsrTransientName(HsrTransient transient) {
+    switch (transient) {
+    case HSR_TRANSIENT_RAY_LIST:
+        return "ray list";
+    case HSR_TRANSIENT_HW_RAY_LIST:
+        return "hw ray list";
+    case HSR_TRANSIENT_BINNED_HW_RAY_LIST:
+        return "binned hw ray list";
+    case HSR_TRANSIENT_RAY_GBUFFER:
+        return "ray gbuffer";
+    case HSR_TRANSIENT_DENOISE_TILE_LIST:
+        return "denoise tile list";
+    case HSR_TRANSIENT_ACTIVE_DENOISE_TILE_LIST:
+        return "active denoise tile list";
+    case HSR_TRANSIENT_CONVERGED_TILE_LIST:
+        return "converged tile list";
+    case HSR_TRANSIENT_RADIANCE_REPROJECTED:
+        return "radiance reprojected";
+    default:
+        return "?";
+    }
+}
+
+bool BuildHsrFrameGraph(HsrFrameGraph &frameGraph, HsrFrameGraphConfig const &config, std::string *pError) {
+    frameGraph.graph = FrameGraph();
+    FrameGraph &graph = frameGraph.graph;
+
+    for (uint32_t t = 0; t < HSR_TRANSIENT_COUNT; t++) {
+        frameGraph.transients[t] = FRAME_GRAPH_INVALID;
+        if (t == HSR_TRANSIENT_BINNED_HW_RAY_LIST && !config.materialBinning) continue;
+        if ((t == HSR_TRANSIENT_ACTIVE_DENOISE_TILE_LIST || t == HSR_TRANSIENT_CONVERGED_TILE_LIST) && !config.convergedTiles) continue;
+        FrameGraphResourceDesc desc = config.transients[t];
+        desc.name                   = GetHsrTransientName(HsrTransient(t));
+        desc.imported               = false;
+        frameGraph.transients[t]    = graph.AddResource(desc);
+    }
+    auto imported = [&](char const *name) {
+        FrameGraphResourceDesc desc;
+        desc.name     = name;
+        desc.imported = true;
+        return graph.AddResource(desc);
+    };
+    // The ray counter and the metrics are written by most passes and left out, they never change a lifetime.
+    uint32_t const radiance     = imported("radiance");         // Intersection results, then the temporal output.
+    uint32_t const history      = imported("denoiser history"); // Radiance, variance and sample count of the last frame, the prefilter targets.
+    uint32_t const indirectArgs = imported("indirect args");
+    uint32_t const output       = imported("output");
+
+    uint32_t const *t = frameGraph.transients;
+    for (uint32_t p = 0; p < HSR_PASS_COUNT; p++) frameGraph.passes[p] = FRAME_GRAPH_INVALID;
+    auto pass = [&](HsrPass id, char const *name) { return frameGraph.passes[id] = graph.AddPass(name); };
+
+    uint32_t p = pass(HSR_PASS_CLASSIFY_TILES, "classify tiles");
+    graph.Write(p, t[HSR_TRANSIENT_RAY_LIST]);
+    graph.Write(p, t[HSR_TRANSIENT_HW_RAY_LIST]);
+    graph.Write(p, t[HSR_TRANSIENT_DENOISE_TILE_LIST]);
+    graph.Write(p, radiance);
+
+    p = pass(HSR_PASS_PREPARE_INDIRECT_ARGS, "prepare indirect args");
+    graph.Write(p, indirectArgs);
+
+    p = pass(HSR_PASS_INTERSECT, "intersect");
+    graph.Read(p, indirectArgs, FrameGraphAccess::IndirectArgument);
+    graph.Read(p, t[HSR_TRANSIENT_RAY_LIST], FrameGraphAccess::UnorderedAccess);
+    graph.Write(p, t[HSR_TRANSIENT_HW_RAY_LIST]); // Screen space misses go on to HW.
+    graph.Write(p, radiance);
+
+    p = pass(HSR_PASS_TRACE, "trace");
+    graph.Read(p, indirectArgs, FrameGraphAccess::IndirectArgument);
+    graph.Read(p, t[HSR_TRANSIENT_HW_RAY_LIST], FrameGraphAccess::UnorderedAccess);
+    graph.Write(p, t[HSR_TRANSIENT_RAY_GBUFFER]);
+
+    if (config.materialBinning) {
+        p = pass(HSR_PASS_MATERIAL_BINNING, "material binning");
+        graph.Read(p, indirectArgs, FrameGraphAccess::IndirectArgument);
+        graph.Read(p, t[HSR_TRANSIENT_HW_RAY_LIST], FrameGraphAccess::UnorderedAccess);
+        graph.Read(p, t[HSR_TRANSIENT_RAY_GBUFFER], FrameGraphAccess::UnorderedAccess);
+        graph.Write(p, t[HSR_TRANSIENT_BINNED_HW_RAY_LIST]);
+    }
+
+    p = pass(HSR_PASS_DEFERRED_SHADE, "deferred shade");
+    graph.Read(p, indirectArgs, FrameGraphAccess::IndirectArgument);
+    graph.Read(p, t[config.materialBinning ? HSR_TRANSIENT_BINNED_HW_RAY_LIST : HSR_TRANSIENT_HW_RAY_LIST], FrameGraphAccess::UnorderedAccess);
+    graph.Read(p, t[HSR_TRANSIENT_RAY_GBUFFER], FrameGraphAccess::UnorderedAccess);
+    graph.Write(p, radiance);
+
+    uint32_t denoiseTiles = t[HSR_TRANSIENT_DENOISE_TILE_LIST];
+    if (config.convergedTiles) {
+        p = pass(HSR_PASS_CLASSIFY_CONVERGED, "classify converged");
+        graph.Read(p, indirectArgs, FrameGraphAccess::IndirectArgument);
+        graph.Read(p, t[HSR_TRANSIENT_DENOISE_TILE_LIST], FrameGraphAccess::UnorderedAccess);
+        graph.Read(p, radiance);
+        graph.Read(p, history);
+        graph.Write(p, t[HSR_TRANSIENT_ACTIVE_DENOISE_TILE_LIST]);
+        graph.Write(p, t[HSR_TRANSIENT_CONVERGED_TILE_LIST]);
+        denoiseTiles = t[HSR_TRANSIENT_ACTIVE_DENOISE_TILE_LIST];
+    }
+
+    p = pass(HSR_PASS_REPROJECT, "reproject");
+    graph.Read(p, indirectArgs, FrameGraphAccess::IndirectArgument);
+    graph.Read(p, denoiseTiles, FrameGraphAccess::UnorderedAccess);
+    graph.Read(p, radiance);
+    graph.Read(p, history);
+    graph.Write(p, t[HSR_TRANSIENT_RADIANCE_REPROJECTED]);
+
+    p = pass(HSR_PASS_PREFILTER, "prefilter");
+    graph.Read(p, indirectArgs, FrameGraphAccess::IndirectArgument);
+    graph.Read(p, denoiseTiles, FrameGraphAccess::UnorderedAccess);
+    graph.Read(p, radiance);
+    graph.Write(p, history);
+
+    p = pass(HSR_PASS_TEMPORAL, "temporal");
+    graph.Read(p, indirectArgs, FrameGraphAccess::IndirectArgument);
+    graph.Read(p, denoiseTiles, FrameGraphAccess::UnorderedAccess);
+    graph.Read(p, t[HSR_TRANSIENT_RADIANCE_REPROJECTED]);
+    graph.Read(p, history);
+    graph.Write(p, radiance);
+
+    if (config.convergedTiles) {
+        p = pass(HSR_PASS_KEEP_CONVERGED, "keep converged");
+        graph.Read(p, indirectArgs, FrameGraphAccess::IndirectArgument);
+        graph.Read(p, t[HSR_TRANSIENT_CONVERGED_TILE_LIST], FrameGraphAccess::UnorderedAccess);
+        graph.Read(p, history);
+        graph.Write(p, radiance);
+    }
+
+    p = pass(HSR_PASS_APPLY_REFLECTIONS, "apply reflections");
+    graph.Read(p, radiance);
+    graph.Write(p, output);
+
+    if (!graph.Compile(pError)) return false;
+    return graph.ValidatePlacement(pError);
+}
+
+void EstimateHsrTransients(HsrFrameGraphConfig &config, uint32_t width, uint32_t height, bool compactRayGbuffer, bool packedRadiance, bool texturesInOwnGroup) {
+    uint64_t const alignment = 64 * 1024;
+    uint64_t const pixels    = uint64_t(width) * height;
+    uint64_t const tiles     = uint64_t((width + 7) / 8) * ((height + 7) / 8);
+    uint64_t const sizes[HSR_TRANSIENT_COUNT] = {
+        4 * pixels,                                                                                     // HSR_TRANSIENT_RAY_LIST
+        4 * pixels,                                                                                     // HSR_TRANSIENT_HW_RAY_LIST
+        4 * pixels,                                                                                     // HSR_TRANSIENT_BINNED_HW_RAY_LIST
+        (compactRayGbuffer ? FFX_REFLECTIONS_COMPACT_RAY_GBUFFER_SIZE : FFX_REFLECTIONS_RAY_GBUFFER_SIZE) * pixels, // HSR_TRANSIENT_RAY_GBUFFER
+        4 * tiles,                                                                                      // HSR_TRANSIENT_DENOISE_TILE_LIST
+        4 * tiles,                                                                                      // HSR_TRANSIENT_ACTIVE_DENOISE_TILE_LIST
+        4 * tiles,                                                                                      // HSR_TRANSIENT_CONVERGED_TILE_LIST
+        (packedRadiance ? 4 : 8) * pixels,                                                              // HSR_TRANSIENT_RADIANCE_REPROJECTED
+    };
+    for (uint32_t t = 0; t < HSR_TRANSIENT_COUNT; t++) {
+        config.transients[t].size      = (sizes[t] + alignment - 1) / alignment * alignment;
+        config.transients[t].alignment = alignment;
+        config.transients[t].heapGroup = (texturesInOwnGroup && t == HSR_TRANSIENT_RADIANCE_REPROJECTED) ? 1 : 0;
+    }
+}
@@ -0,0 +1,89 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "FrameGraph.h"
+
+/**
+        The passes of HSR::Draw and the transient resources they use, declared as a FrameGraph so the transient
+        resources can share memory. Shared by HSR.cpp and sample/tools/HSRFrameGraph, which checks the plan and
+        prints what it saves without a GPU.
+
+        Passes are the superset of what Draw records with the options of the configuration, in recording order.
+        Screen space and ray traced intersections, the denoiser and the debug views switch at runtime, every path
+        through Draw runs a subsequence of these passes, so the placement holds for all of them.
+*/
+
+enum HsrPass {
+    HSR_PASS_CLASSIFY_TILES,
+    HSR_PASS_PREPARE_INDIRECT_ARGS,
+    HSR_PASS_INTERSECT,          // Screen space.
+    HSR_PASS_TRACE,              // Ray traced, fills the ray GBuffer.
+    HSR_PASS_MATERIAL_BINNING,   // With materialBinning.
+    HSR_PASS_DEFERRED_SHADE,
+    HSR_PASS_CLASSIFY_CONVERGED, // With convergedTiles.
+    HSR_PASS_REPROJECT,
+    HSR_PASS_PREFILTER,
+    HSR_PASS_TEMPORAL,
+    HSR_PASS_KEEP_CONVERGED,     // With convergedTiles.
+    HSR_PASS_APPLY_REFLECTIONS,
+    HSR_PASS_COUNT,
+};
+
+// Resources that only live within a frame.
+enum HsrTransient {
+    HSR_TRANSIENT_RAY_LIST,
+    HSR_TRANSIENT_HW_RAY_LIST,
+    HSR_TRANSIENT_BINNED_HW_RAY_LIST,   // With materialBinning.
+    HSR_TRANSIENT_RAY_GBUFFER,
+    HSR_TRANSIENT_DENOISE_TILE_LIST,
+    HSR_TRANSIENT_ACTIVE_DENOISE_TILE_LIST, // With convergedTiles.
+    HSR_TRANSIENT_CONVERGED_TILE_LIST,  // With convergedTiles.
+    HSR_TRANSIENT_RADIANCE_REPROJECTED, // Texture, all others are buffers.
+    HSR_TRANSIENT_COUNT,
+};
+
+char const *GetHsrTransientName(HsrTransient transient);
+
+struct HsrFrameGraphConfig {
+    bool materialBinning = false;
+    bool convergedTiles  = false;
+    // size, alignment and heapGroup of each transient from the backend, the names and imported flags are set here.
+    FrameGraphResourceDesc transients[HSR_TRANSIENT_COUNT];
+};
+
+struct HsrFrameGraph {
+    FrameGraph graph;
+    uint32_t   passes[HSR_PASS_COUNT];          // Graph pass of each HsrPass, FRAME_GRAPH_INVALID without the option.
+    uint32_t   transients[HSR_TRANSIENT_COUNT]; // Graph resource of each HsrTransient, FRAME_GRAPH_INVALID without the option.
+};
+
+// Declares and compiles the graph, returns false with a message if it does not compile or the placement is broken.
+bool BuildHsrFrameGraph(HsrFrameGraph &frameGraph, HsrFrameGraphConfig const &config, std::string *pError = nullptr);
+
+// Allocation sizes of the transients for width x height reflections, as committed resources get them on D3D12: 64KB
+// aligned, the reprojected radiance at 8 bytes per pixel or 4 with packedRadiance. The tool uses it in place of the
+// sizes from the device. With texturesInOwnGroup the texture goes to heap group 1, as resource heap tier 1 requires.
+void EstimateHsrTransients(HsrFrameGraphConfig &config, uint32_t width, uint32_t height, bool compactRayGbuffer, bool packedRadiance, bool texturesInOwnGroup);
@@ -0,0 +1,108 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "HsrMetrics.h"
+
+#include <cmath>
+
+void HsrMetrics::Accumulate(HsrMetrics const &other) {
+    if (frameCount == 0) version = other.version;
+    frameCount += other.frameCount;
+    swRays += other.swRays;
+    hwRays += other.hwRays;
+    hybridRays += other.hybridRays;
+    swConfidenceRejected += other.swConfidenceRejected;
+    swRoughFallback += other.swRoughFallback;
+    swMisses += other.swMisses;
+    hwMisses += other.hwMisses;
+    hwTransparentHits += other.hwTransparentHits;
+    deferredShadeSkips += other.deferredShadeSkips;
+    denoiseTiles += other.denoiseTiles;
+    for (int i = 0; i < HSR_METRICS_HISTOGRAM_BINS; i++) {
+        rayLengthHistogram[i] += other.rayLengthHistogram[i];
+        marchHistogram[i] += other.marchHistogram[i];
+    }
+}
+
+bool DecodeHsrMetrics(uint32_t const *pWords, size_t wordCount, HsrMetrics &metrics, std::string *pError) {
+    auto fail = [&](std::string const &error) {
+        if (pError) *pError = error;
+        return false;
+    };
+    if (!pWords || wordCount <= HSR_METRICS_VERSION_WORD) return fail("metrics block too short");
+
+    uint32_t version = pWords[HSR_METRICS_VERSION_WORD];
+    if (version == 0) version = 1;
+    if (version != 1 && version != HSR_METRICS_VERSION) return fail("unknown metrics version " + std::to_string(version));
+    if (version == HSR_METRICS_VERSION && wordCount < HSR_METRICS_WORD_COUNT) return fail("metrics block too short for version " + std::to_string(version));
+
+    metrics            = HsrMetrics();
+    metrics.version    = version;
+    metrics.frameCount = 1;
+    metrics.swRays     = pWords[HSR_METRICS_SW_RAYS];
+    metrics.hwRays     = pWords[HSR_METRICS_DEFERRED_HW_RAYS];
+    // The classified HW rays are a subset of the final ones, guard against a torn or cleared block anyway.
+    metrics.hybridRays = pWords[HSR_METRICS_DEFERRED_HW_RAYS] > pWords[HSR_METRICS_HW_RAYS] ? pWords[HSR_METRICS_DEFERRED_HW_RAYS] - pWords[HSR_METRICS_HW_RAYS] : 0;
+    if (version == 1) return true;
+
+    metrics.swConfidenceRejected = pWords[HSR_METRICS_SW_CONFIDENCE_REJECTED];
+    metrics.swRoughFallback      = pWords[HSR_METRICS_SW_ROUGH_FALLBACK];
+    metrics.swMisses             = pWords[HSR_METRICS_SW_MISSES];
+    metrics.hwMisses             = pWords[HSR_METRICS_HW_MISSES];
+    metrics.hwTransparentHits    = pWords[HSR_METRICS_HW_TRANSPARENT_HITS];
+    metrics.deferredShadeSkips   = pWords[HSR_METRICS_DEFERRED_SHADE_SKIPS];
+    metrics.denoiseTiles         = pWords[HSR_METRICS_DENOISE_TILES];
+    for (int i = 0; i < HSR_METRICS_HISTOGRAM_BINS; i++) {
+        metrics.rayLengthHistogram[i] = pWords[HSR_METRICS_RAY_LENGTH_HISTOGRAM + i];
+        metrics.marchHistogram[i]     = pWords[HSR_METRICS_MARCH_HISTOGRAM + i];
+    }
+    return true;
+}
+
+int HsrMetricsPercentileBin(uint64_t const (&histogram)[HSR_METRICS_HISTOGRAM_BINS], double p) {
+    uint64_t total = 0;
+    for (uint64_t count : histogram) total += count;
+    if (total == 0) return -1;
+
+    // Smallest bin whose cumulative count reaches the rank, nearest rank definition.
+    double   rank       = std::ceil(p / 100.0 * double(total));
+    uint64_t cumulative = 0;
+    for (int i = 0; i < HSR_METRICS_HISTOGRAM_BINS; i++) {
+        cumulative += histogram[i];
+        if (double(cumulative) >= rank && cumulative > 0) return i;
+    }
+    return HSR_METRICS_HISTOGRAM_BINS - 1;
+}
+
+double HsrRayLengthBinLowerBound(int bin) { return bin <= 0 ? 0.0 : std::ldexp(1.0, bin - 4); }
+double HsrMarchBinLowerBound(int bin) { return bin <= 0 ? 0.0 : std::ldexp(1.0, bin); }
+
+void HsrMetricsReadback::OnCreate(uint32_t slotCount) {
+    m_slotCount = slotCount ? slotCount : 1;
+    m_frame     = 0;
+}
+
+bool HsrMetricsReadback::ReadRetired(uint32_t const *pSlots, HsrMetrics &metrics, int64_t &frame, std::string *pError) const {
+    if (m_frame < m_slotCount) return false;
+    if (!DecodeHsrMetrics(pSlots + size_t(GetSlot()) * HSR_METRICS_WORD_COUNT, HSR_METRICS_WORD_COUNT, metrics, pError)) return false;
+    frame = int64_t(m_frame - m_slotCount);
+    return true;
+}
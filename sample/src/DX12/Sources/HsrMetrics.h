@@ -0,0 +1,97 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "../../Shaders/Metrics.h"
+
+/**
+        Decoded HSR metrics block, see Shaders/Metrics.h for the layout and what each counter means. A decoded frame
+        and a sum over frames (Accumulate) use the same struct, frameCount tells them apart.
+*/
+struct HsrMetrics {
+    uint32_t version    = 0; // Layout version of the decoded block, 1 for blocks from before the version word.
+    uint64_t frameCount = 0; // Number of frames summed up, 1 for a decoded block.
+
+    uint64_t swRays               = 0;
+    uint64_t hwRays               = 0; // Including the hybrid rays.
+    uint64_t hybridRays           = 0; // Screen space rays handed to HW.
+    uint64_t swConfidenceRejected = 0;
+    uint64_t swRoughFallback      = 0;
+    uint64_t swMisses             = 0;
+    uint64_t hwMisses             = 0;
+    uint64_t hwTransparentHits    = 0;
+    uint64_t deferredShadeSkips   = 0;
+    uint64_t denoiseTiles         = 0;
+
+    uint64_t rayLengthHistogram[HSR_METRICS_HISTOGRAM_BINS] = {};
+    uint64_t marchHistogram[HSR_METRICS_HISTOGRAM_BINS]     = {};
+
+    void Accumulate(HsrMetrics const &other);
+
+    // Per frame averages and rates over the summed frames, 0 when there is nothing to divide by.
+    double PerFrame(uint64_t value) const { return frameCount ? double(value) / double(frameCount) : 0.0; }
+    double SwRejectRate() const { return Ratio(swConfidenceRejected, swRays); }
+    double SwMissRate() const { return Ratio(swMisses, swRays); }
+    double HwMissRate() const { return Ratio(hwMisses, hwRays); }
+    double DeferredShadeSkipRate() const { return Ratio(deferredShadeSkips, hwRays); }
+
+    static double Ratio(uint64_t part, uint64_t whole) { return whole ? double(part) / double(whole) : 0.0; }
+};
+
+/**
+        Decodes a metrics block as read back from the GPU. Accepts the current layout and the legacy one that only
+        has the three ray counts. Fails on short buffers and unknown versions.
+*/
+bool DecodeHsrMetrics(uint32_t const *pWords, size_t wordCount, HsrMetrics &metrics, std::string *pError = nullptr);
+
+// Bin holding the p-th percentile (p in [0, 100]) of the histogram samples, -1 for an empty histogram.
+int HsrMetricsPercentileBin(uint64_t const (&histogram)[HSR_METRICS_HISTOGRAM_BINS], double p);
+
+// Value range covered by a bin, the first bin starts at 0 and the last one is open ended.
+double HsrRayLengthBinLowerBound(int bin);
+double HsrMarchBinLowerBound(int bin);
+
+/**
+        Readback of the metrics block with one slot per frame in flight. Frame n copies its block to slot
+        n % slotCount of a CPU visible buffer. Until that copy is recorded, the slot still holds the block of frame
+        n - slotCount, which has retired by then, so the results lag by slotCount frames, like the GPU timings.
+*/
+class HsrMetricsReadback {
+public:
+    void OnCreate(uint32_t slotCount);
+
+    // Slot the current frame copies its block to, in blocks of HSR_METRICS_WORD_COUNT words.
+    uint32_t GetSlot() const { return uint32_t(m_frame % m_slotCount); }
+    // Decodes the retired block the slot of the current frame holds, pSlots is the mapped buffer. Returns false before
+    // the first frame has retired, and with pError set when the block does not decode.
+    bool ReadRetired(uint32_t const *pSlots, HsrMetrics &metrics, int64_t &frame, std::string *pError = nullptr) const;
+    // Call once the copy of the current frame is recorded.
+    void EndFrame() { m_frame++; }
+
+private:
+    uint32_t m_slotCount = 1;
+    uint64_t m_frame     = 0;
+};
@@ -0,0 +1,93 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Bits of the PSO permutation mask, each one maps to a shader define.
+enum HSRPermutationBits : uint32_t {
+    HSR_PERMUTATION_DEBUG               = 1,   // HSR_DEBUG
+    HSR_PERMUTATION_TRANSPARENT_QUERY   = 2,   // HSR_TRANSPARENT_QUERY
+    HSR_PERMUTATION_SHADING_USE_SCREEN  = 4,   // HSR_SHADING_USE_SCREEN
+    HSR_PERMUTATION_UPSCALE             = 8,   // UPSCALE
+    HSR_PERMUTATION_COMPACT_RAY_GBUFFER = 16,  // HSR_COMPACT_RAY_GBUFFER
+    HSR_PERMUTATION_MATERIAL_BINNING    = 32,  // HSR_MATERIAL_BINNING
+    HSR_PERMUTATION_PACKED_RADIANCE     = 64,  // HSR_PACKED_RADIANCE
+    HSR_PERMUTATION_CONVERGED_TILES     = 128, // HSR_CONVERGED_TILES
+    HSR_PERMUTATION_COUNT               = 256, // Number of masks.
+};
+
+// A fallback permutation must agree on these bits, they change the size, the set and the format of the window size
+// dependent buffers.
+static uint32_t const HSR_PERMUTATION_REQUIRED_BITS = HSR_PERMUTATION_UPSCALE | HSR_PERMUTATION_COMPACT_RAY_GBUFFER | HSR_PERMUTATION_MATERIAL_BINNING |
+                                                      HSR_PERMUTATION_PACKED_RADIANCE | HSR_PERMUTATION_CONVERGED_TILES;
+
+// What a frame asks of the HSR passes, packed into a permutation mask by GetPermutationMask.
+struct HSRPermutationOptions {
+    bool debug             = false;
+    bool transparentQuery  = false;
+    bool shadingUseScreen  = false;
+    bool upscale           = false;
+    bool compactRayGbuffer = false;
+    bool materialBinning   = false;
+    bool packedRadiance    = false;
+    bool convergedTiles    = false;
+};
+
+static inline uint32_t GetPermutationMask(HSRPermutationOptions const &options) {
+    return (options.debug ? uint32_t(HSR_PERMUTATION_DEBUG) : 0u)                             //
+           | (options.transparentQuery ? uint32_t(HSR_PERMUTATION_TRANSPARENT_QUERY) : 0u)    //
+           | (options.shadingUseScreen ? uint32_t(HSR_PERMUTATION_SHADING_USE_SCREEN) : 0u)   //
+           | (options.upscale ? uint32_t(HSR_PERMUTATION_UPSCALE) : 0u)                       //
+           | (options.compactRayGbuffer ? uint32_t(HSR_PERMUTATION_COMPACT_RAY_GBUFFER) : 0u) //
+           | (options.materialBinning ? uint32_t(HSR_PERMUTATION_MATERIAL_BINNING) : 0u)      //
+           | (options.packedRadiance ? uint32_t(HSR_PERMUTATION_PACKED_RADIANCE) : 0u)        //
+           | (options.convergedTiles ? uint32_t(HSR_PERMUTATION_CONVERGED_TILES) : 0u);
+}
+
+// The shader define of each bit of the mask, lowest bit first.
+static char const *const HSR_PERMUTATION_DEFINES[] = {
+    "HSR_DEBUG",               //
+    "HSR_TRANSPARENT_QUERY",   //
+    "HSR_SHADING_USE_SCREEN",  //
+    "UPSCALE",                 //
+    "HSR_COMPACT_RAY_GBUFFER", //
+    "HSR_MATERIAL_BINNING",    //
+    "HSR_PACKED_RADIANCE",     //
+    "HSR_CONVERGED_TILES",     //
+};
+static_assert(1u << (sizeof(HSR_PERMUTATION_DEFINES) / sizeof(HSR_PERMUTATION_DEFINES[0])) == HSR_PERMUTATION_COUNT, "One define per permutation bit");
+
+// Adds the shader defines of the permutation to 'defines'.
+static inline void GetPermutationDefines(uint32_t mask, std::map<const std::string, std::string> &defines) {
+    for (uint32_t bit = 0; (1u << bit) < HSR_PERMUTATION_COUNT; bit++)
+        if (mask & (1u << bit)) defines[HSR_PERMUTATION_DEFINES[bit]] = "1";
+}
+
+// The bit of the mask that enables 'define', 0 if no permutation has it.
+static inline uint32_t GetPermutationBit(std::string const &define) {
+    for (uint32_t bit = 0; (1u << bit) < HSR_PERMUTATION_COUNT; bit++)
+        if (define == HSR_PERMUTATION_DEFINES[bit]) return 1u << bit;
+    return 0;
+}
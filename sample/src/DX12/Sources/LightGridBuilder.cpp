@@ -0,0 +1,232 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "LightGridBuilder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+using namespace LightGridModel;
+
+static uint32_t AsUint(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float AsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static bool Influences(LightGridBuilder::Light const &light, float const p[3]) {
+    return LightGrid_Influences(light.type, light.range, light.outerConeCos, light.position[0], light.position[1], light.position[2], light.direction[0], light.direction[1],
+                                light.direction[2], p[0], p[1], p[2]);
+}
+
+// See "Cull that cone!" by Bart Wronski.
+bool SpotLightMissesSphere(LightGridBuilder::Light const &light, float const center[3], float radius) {
+    float const cosAngle = light.outerConeCos - LIGHT_GRID_CONE_MARGIN;
+    // Cones of 90 degrees and more are left to the range test.
+    if (cosAngle <= 0.0f) return false;
+    float const dirLength = sqrtf(light.direction[0] * light.direction[0] + light.direction[1] * light.direction[1] + light.direction[2] * light.direction[2]);
+    if (dirLength == 0.0f) return false;
+    float const sinAngle = sqrtf(std::max(1.0f - cosAngle * cosAngle, 0.0f));
+    float       v[3], v2 = 0.0f, along = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        v[axis] = center[axis] - light.position[axis];
+        v2 += v[axis] * v[axis];
+        along -= v[axis] * light.direction[axis] / dirLength;
+    }
+    float const closest = cosAngle * sqrtf(std::max(v2 - along * along, 0.0f)) - along * sinAngle;
+    return closest > radius || along < -radius;
+}
+
+void LightGridBuilder::Build(Light const *pLights, uint32_t count, bool enabled, uint32_t targetCells, uint32_t maxWords) {
+    assert(LIGHT_GRID_HEADER_WORDS + count <= maxWords);
+    m_lights.assign(pLights, pLights + count);
+
+    std::vector<uint32_t> bounded;
+    float                 boundsMin[3] = {INFINITY, INFINITY, INFINITY};
+    float                 boundsMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t i = 0; enabled && i < count; i++) {
+        Light const &light = pLights[i];
+        if (!LightGrid_IsBounded(light.type, light.range)) continue;
+        bounded.push_back(i);
+        for (int axis = 0; axis < 3; axis++) {
+            boundsMin[axis] = std::min(boundsMin[axis], light.position[axis] - light.range);
+            boundsMax[axis] = std::max(boundsMax[axis], light.position[axis] + light.range);
+        }
+    }
+    if (!bounded.empty() && std::isfinite(boundsMin[0] + boundsMin[1] + boundsMin[2] + boundsMax[0] + boundsMax[1] + boundsMax[2])) {
+        for (uint32_t target = std::max(targetCells, 1u); target >= 1; target /= 2)
+            if (TryBuild(bounded, boundsMin, boundsMax, target, maxWords)) return;
+    }
+    BuildGlobal();
+}
+
+void LightGridBuilder::BuildGlobal() {
+    m_words.assign(LIGHT_GRID_HEADER_WORDS, 0);
+    m_words[LIGHT_GRID_GLOBAL_COUNT] = uint32_t(m_lights.size());
+    m_words[LIGHT_GRID_CELL_TABLE]   = uint32_t(LIGHT_GRID_HEADER_WORDS + m_lights.size());
+    m_words[LIGHT_GRID_LIGHT_COUNT]  = uint32_t(m_lights.size());
+    for (uint32_t i = 0; i < m_lights.size(); i++) m_words.push_back(i);
+
+    m_stats              = Stats();
+    m_stats.lights       = uint32_t(m_lights.size());
+    m_stats.globalLights = uint32_t(m_lights.size());
+    m_stats.words        = uint32_t(m_words.size());
+}
+
+bool LightGridBuilder::TryBuild(std::vector<uint32_t> const &bounded, float const boundsMin[3], float const boundsMax[3], uint32_t targetCells, uint32_t maxWords) {
+    // A little larger than the volumes so rounding never puts a point of a volume outside of the grid.
+    float origin[3], extent[3];
+    for (int axis = 0; axis < 3; axis++) {
+        float const margin = std::max(1.0e-3f * (boundsMax[axis] - boundsMin[axis]), 1.0e-3f);
+        origin[axis]       = boundsMin[axis] - margin;
+        extent[axis]       = boundsMax[axis] - boundsMin[axis] + 2.0f * margin;
+    }
+    float const cellSize = std::cbrt(extent[0] * extent[1] * extent[2] / float(targetCells));
+    uint32_t    dims[3];
+    float       invCellSize[3], size[3];
+    for (int axis = 0; axis < 3; axis++) {
+        dims[axis]        = uint32_t(std::min(std::max(std::ceil(extent[axis] / cellSize), 1.0f), float(LIGHT_GRID_MAX_DIMENSION)));
+        invCellSize[axis] = float(dims[axis]) / extent[axis];
+        size[axis]        = extent[axis] / float(dims[axis]);
+    }
+    uint32_t const cellCount = dims[0] * dims[1] * dims[2];
+
+    m_globals.clear();
+    for (uint32_t i = 0; i < m_lights.size(); i++)
+        if (!LightGrid_IsBounded(m_lights[i].type, m_lights[i].range)) m_globals.push_back(i);
+    m_pairs.clear();
+    for (uint32_t i : bounded) {
+        Light const &light = m_lights[i];
+        uint32_t     lo[3], hi[3];
+        for (int axis = 0; axis < 3; axis++) {
+            float const first = std::floor((light.position[axis] - light.range - origin[axis]) * invCellSize[axis]);
+            float const last  = std::floor((light.position[axis] + light.range - origin[axis]) * invCellSize[axis]);
+            lo[axis]          = uint32_t(std::min(std::max(first, 0.0f), float(dims[axis] - 1)));
+            hi[axis]          = uint32_t(std::min(std::max(last, 0.0f), float(dims[axis] - 1)));
+        }
+        if (uint64_t(hi[0] - lo[0] + 1) * (hi[1] - lo[1] + 1) * (hi[2] - lo[2] + 1) * 2 > cellCount) {
+            m_globals.push_back(i);
+            continue;
+        }
+        float const range2 = light.range * light.range;
+        for (uint32_t z = lo[2]; z <= hi[2]; z++)
+            for (uint32_t y = lo[1]; y <= hi[1]; y++)
+                for (uint32_t x = lo[0]; x <= hi[0]; x++) {
+                    // Cell boxes grow by a small margin so points rounded into the cell are still inside its box.
+                    uint32_t const cell[3] = {x, y, z};
+                    float          d2 = 0.0f, center[3], radius2 = 0.0f;
+                    for (int axis = 0; axis < 3; axis++) {
+                        float const margin = 1.0e-3f * size[axis];
+                        float const cMin   = origin[axis] + float(cell[axis]) * size[axis] - margin;
+                        float const cMax   = origin[axis] + float(cell[axis] + 1) * size[axis] + margin;
+                        float const p      = light.position[axis];
+                        float const d      = p < cMin ? cMin - p : (p > cMax ? p - cMax : 0.0f);
+                        d2 += d * d;
+                        center[axis] = 0.5f * (cMin + cMax);
+                        radius2 += 0.25f * (cMax - cMin) * (cMax - cMin);
+                    }
+                    if (d2 > range2) continue;
+                    if (light.type == LIGHT_GRID_TYPE_SPOT && SpotLightMissesSphere(light, center, sqrtf(radius2))) continue;
+                    m_pairs.push_back(uint64_t((z * dims[1] + y) * dims[0] + x) << 32 | i);
+                }
+    }
+    std::sort(m_globals.begin(), m_globals.end());
+
+    uint32_t const cellTable = uint32_t(LIGHT_GRID_HEADER_WORDS + m_globals.size());
+    uint32_t const lists     = cellTable + 2 * cellCount;
+    if (uint64_t(lists) + m_pairs.size() > maxWords) return false;
+
+    m_words.assign(lists + m_pairs.size(), 0);
+    for (int axis = 0; axis < 3; axis++) {
+        m_words[LIGHT_GRID_ORIGIN + axis]        = AsUint(origin[axis]);
+        m_words[LIGHT_GRID_INV_CELL_SIZE + axis] = AsUint(invCellSize[axis]);
+        m_words[LIGHT_GRID_DIMENSIONS + axis]    = dims[axis];
+    }
+    m_words[LIGHT_GRID_GLOBAL_COUNT] = uint32_t(m_globals.size());
+    m_words[LIGHT_GRID_CELL_TABLE]   = cellTable;
+    m_words[LIGHT_GRID_LIGHT_COUNT]  = uint32_t(m_lights.size());
+    std::copy(m_globals.begin(), m_globals.end(), m_words.begin() + LIGHT_GRID_HEADER_WORDS);
+
+    // Counting sort by cell. The pairs were added light by light, so each list stays in light order.
+    uint32_t *pTable = m_words.data() + cellTable;
+    for (uint64_t pair : m_pairs) pTable[2 * (pair >> 32) + 1]++;
+    uint32_t offset = lists;
+    m_stats         = Stats();
+    for (uint32_t cell = 0; cell < cellCount; cell++) {
+        uint32_t const cellLights = pTable[2 * cell + 1];
+        pTable[2 * cell]          = offset;
+        offset += cellLights;
+        m_stats.occupiedCells += cellLights ? 1 : 0;
+        m_stats.maxCellLights = std::max(m_stats.maxCellLights, cellLights);
+    }
+    for (uint32_t cell = 0; cell < cellCount; cell++) pTable[2 * cell + 1] = 0;
+    for (uint64_t pair : m_pairs) {
+        uint32_t *pCell                = pTable + 2 * (pair >> 32);
+        m_words[pCell[0] + pCell[1]++] = uint32_t(pair);
+    }
+
+    m_stats.lights       = uint32_t(m_lights.size());
+    m_stats.globalLights = uint32_t(m_globals.size());
+    m_stats.cells        = cellCount;
+    m_stats.listEntries  = m_pairs.size();
+    m_stats.words        = uint32_t(m_words.size());
+    for (int axis = 0; axis < 3; axis++) m_stats.cellSize[axis] = size[axis];
+    return true;
+}
+
+void LightGridBuilder::Query(float const p[3], std::vector<uint32_t> &lights, uint32_t *pCandidates) const {
+    lights.clear();
+    if (m_words.empty()) {
+        if (pCandidates) *pCandidates = 0;
+        return;
+    }
+    uint32_t const *pWords      = m_words.data();
+    uint32_t const  globalCount = pWords[LIGHT_GRID_GLOBAL_COUNT];
+    uint32_t        candidates  = globalCount;
+    for (uint32_t i = 0; i < globalCount; i++)
+        if (Influences(m_lights[pWords[LIGHT_GRID_HEADER_WORDS + i]], p)) lights.push_back(pWords[LIGHT_GRID_HEADER_WORDS + i]);
+
+    uint32_t const cell = LightGrid_Cell(p[0], p[1], p[2], AsFloat(pWords[LIGHT_GRID_ORIGIN]), AsFloat(pWords[LIGHT_GRID_ORIGIN + 1]), AsFloat(pWords[LIGHT_GRID_ORIGIN + 2]),
+                                         AsFloat(pWords[LIGHT_GRID_INV_CELL_SIZE]), AsFloat(pWords[LIGHT_GRID_INV_CELL_SIZE + 1]),
+                                         AsFloat(pWords[LIGHT_GRID_INV_CELL_SIZE + 2]), pWords[LIGHT_GRID_DIMENSIONS], pWords[LIGHT_GRID_DIMENSIONS + 1],
+                                         pWords[LIGHT_GRID_DIMENSIONS + 2]);
+    if (cell != LIGHT_GRID_NO_CELL) {
+        uint32_t const *pCell = pWords + pWords[LIGHT_GRID_CELL_TABLE] + 2 * cell;
+        candidates += pCell[1];
+        for (uint32_t i = 0; i < pCell[1]; i++)
+            if (Influences(m_lights[pWords[pCell[0] + i]], p)) lights.push_back(pWords[pCell[0] + i]);
+    }
+    if (pCandidates) *pCandidates = candidates;
+}
+
+void QueryLightsBruteForce(LightGridBuilder::Light const *pLights, uint32_t count, float const p[3], std::vector<uint32_t> &lights) {
+    lights.clear();
+    for (uint32_t i = 0; i < count; i++)
+        if (Influences(pLights[i], p)) lights.push_back(i);
+}
@@ -0,0 +1,84 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include "../../Shaders/LightGrid.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+        Builds the light grid of Shaders/LightGrid.h on the CPU, flattened to the words the GPU buffer holds, and
+        answers the same queries as the shader for the tests.
+*/
+class LightGridBuilder {
+public:
+    struct Light {
+        float position[3];
+        float direction[3]; // Spot lights point along -direction, as in RTShading.h.
+        float range;        // Negative is unlimited.
+        float outerConeCos;
+        int   type;         // LIGHT_GRID_TYPE_*
+    };
+    struct Stats {
+        uint32_t lights        = 0;
+        uint32_t globalLights  = 0;
+        uint32_t cells         = 0;
+        uint32_t occupiedCells = 0;
+        uint32_t maxCellLights = 0;
+        uint64_t listEntries   = 0; // Summed over the cells.
+        uint32_t words         = 0;
+        float    cellSize[3]   = {};
+    };
+
+    /**
+        The grid aims at 'targetCells' cells over the box of the bounded influence volumes and is coarsened until it
+        fits in 'maxWords'. A light whose volume overlaps more than half of the cells is kept global. With 'enabled'
+        false every light is global.
+    */
+    void Build(Light const *pLights, uint32_t count, bool enabled = true, uint32_t targetCells = 4096, uint32_t maxWords = LIGHT_GRID_MAX_WORDS);
+
+    // Indices of the lights that reach 'p', in the order the shader shades them. 'pCandidates' gets the number of
+    // lights the shader tests for it.
+    void Query(float const p[3], std::vector<uint32_t> &lights, uint32_t *pCandidates = NULL) const;
+
+    std::vector<uint32_t> const &GetWords() const { return m_words; }
+    Stats const &                GetStats() const { return m_stats; }
+
+private:
+    bool TryBuild(std::vector<uint32_t> const &bounded, float const boundsMin[3], float const boundsMax[3], uint32_t targetCells, uint32_t maxWords);
+    void BuildGlobal();
+
+    std::vector<Light>    m_lights;
+    std::vector<uint32_t> m_globals; // Scratch
+    std::vector<uint64_t> m_pairs;   // Scratch, cell << 32 | light
+    std::vector<uint32_t> m_words;
+    Stats                 m_stats;
+};
+
+// The lights whose influence volume contains 'p', in index order. What Query has to find, with every light tested.
+void QueryLightsBruteForce(LightGridBuilder::Light const *pLights, uint32_t count, float const p[3], std::vector<uint32_t> &lights);
+
+// Conservative: true only if no point of the sphere is within the cone of the spot, widened by LIGHT_GRID_CONE_MARGIN
+// like LightGrid_Influences.
+bool SpotLightMissesSphere(LightGridBuilder::Light const &light, float const center[3], float radius);
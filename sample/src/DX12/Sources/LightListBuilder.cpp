@@ -0,0 +1,104 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "LightListBuilder.h"
+
+#include <algorithm>
+#include <cstring>
+
+static uint32_t AsUint(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float AsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void PackLight(LightListBuilder::Light const &light, uint32_t words[LIGHT_LIST_LIGHT_WORDS]) {
+    for (int i = 0; i < 16; i++) words[LIGHT_LIST_VIEW_PROJ + i] = AsUint(light.viewProj[i]);
+    for (int axis = 0; axis < 3; axis++) {
+        words[LIGHT_LIST_DIRECTION + axis] = AsUint(light.direction[axis]);
+        words[LIGHT_LIST_COLOR + axis]     = AsUint(light.color[axis]);
+        words[LIGHT_LIST_POSITION + axis]  = AsUint(light.position[axis]);
+    }
+    words[LIGHT_LIST_RANGE]            = AsUint(light.range);
+    words[LIGHT_LIST_INTENSITY]        = AsUint(light.intensity);
+    words[LIGHT_LIST_INNER_CONE_COS]   = AsUint(light.innerConeCos);
+    words[LIGHT_LIST_OUTER_CONE_COS]   = AsUint(light.outerConeCos);
+    words[LIGHT_LIST_TYPE]             = uint32_t(light.type);
+    words[LIGHT_LIST_DEPTH_BIAS]       = AsUint(light.depthBias);
+    words[LIGHT_LIST_SHADOW_MAP_INDEX] = uint32_t(light.shadowMapIndex);
+}
+
+void UnpackLight(uint32_t const words[LIGHT_LIST_LIGHT_WORDS], LightListBuilder::Light &light) {
+    for (int i = 0; i < 16; i++) light.viewProj[i] = AsFloat(words[LIGHT_LIST_VIEW_PROJ + i]);
+    for (int axis = 0; axis < 3; axis++) {
+        light.direction[axis] = AsFloat(words[LIGHT_LIST_DIRECTION + axis]);
+        light.color[axis]     = AsFloat(words[LIGHT_LIST_COLOR + axis]);
+        light.position[axis]  = AsFloat(words[LIGHT_LIST_POSITION + axis]);
+    }
+    light.range          = AsFloat(words[LIGHT_LIST_RANGE]);
+    light.intensity      = AsFloat(words[LIGHT_LIST_INTENSITY]);
+    light.innerConeCos   = AsFloat(words[LIGHT_LIST_INNER_CONE_COS]);
+    light.outerConeCos   = AsFloat(words[LIGHT_LIST_OUTER_CONE_COS]);
+    light.type           = int(words[LIGHT_LIST_TYPE]);
+    light.depthBias      = AsFloat(words[LIGHT_LIST_DEPTH_BIAS]);
+    light.shadowMapIndex = int(words[LIGHT_LIST_SHADOW_MAP_INDEX]);
+}
+
+bool LightListBuilder::Build(Light const *pLights, uint32_t count, uint32_t maxLights) {
+    count = std::min(count, maxLights);
+    m_packed.resize(size_t(count) * LIGHT_LIST_LIGHT_WORDS);
+    for (uint32_t i = 0; i < count; i++) PackLight(pLights[i], &m_packed[size_t(i) * LIGHT_LIST_LIGHT_WORDS]);
+
+    // The lights the GPU buffer holds are compared bit for bit, the ones past them are new. The upload is the one
+    // range from the first to the last light that differs.
+    uint32_t const kept  = std::min(count, m_uploaded);
+    uint32_t       first = count;
+    uint32_t       end   = 0;
+    for (uint32_t i = 0; i < kept; i++) {
+        size_t const offset = size_t(i) * LIGHT_LIST_LIGHT_WORDS;
+        if (memcmp(&m_packed[offset], &m_words[offset], LIGHT_LIST_LIGHT_WORDS * sizeof(uint32_t)) == 0) continue;
+        first = std::min(first, i);
+        end   = i + 1;
+    }
+    if (count > kept) {
+        first = std::min(first, kept);
+        end   = count;
+    }
+    m_dirtyFirst = first < end ? first : 0;
+    m_dirtyCount = first < end ? end - first : 0;
+    m_words.swap(m_packed);
+    m_uploaded = count;
+
+    m_stats.lights        = count;
+    m_stats.dirtyLights   = m_dirtyCount;
+    m_stats.uploadedBytes = m_dirtyCount * LIGHT_LIST_LIGHT_WORDS * uint32_t(sizeof(uint32_t));
+    if (m_dirtyCount)
+        m_stats.uploads++;
+    else
+        m_stats.skippedUploads++;
+    return m_dirtyCount != 0;
+}
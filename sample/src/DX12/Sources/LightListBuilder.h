@@ -0,0 +1,83 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include "../../Shaders/LightList.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+        Packs the lights of the frame into the words of Shaders/LightList.h and diffs them against the previous
+        frame, so only the lights that changed get uploaded.
+*/
+class LightListBuilder {
+public:
+    struct Light {
+        float viewProj[16]; // mLightViewProj, in the layout of the constant buffer.
+        float direction[3];
+        float range;
+        float color[3];
+        float intensity;
+        float position[3];
+        float innerConeCos;
+        float outerConeCos;
+        int   type;
+        float depthBias;
+        int   shadowMapIndex;
+    };
+    struct Stats {
+        uint32_t lights         = 0;
+        uint32_t dirtyLights    = 0; // Uploaded this frame.
+        uint32_t uploadedBytes  = 0; // This frame.
+        uint64_t uploads        = 0; // Frames that uploaded something.
+        uint64_t skippedUploads = 0; // Frames that found the lights unchanged.
+    };
+
+    /**
+        Packs 'count' lights, at most 'maxLights'. Returns whether any light differs from the previous Build, the
+        caller then uploads GetDirtyCount() lights from GetDirtyFirst(). Lights dropped from the end are not
+        uploaded, nothing reads past the light count.
+    */
+    bool Build(Light const *pLights, uint32_t count, uint32_t maxLights = LIGHT_LIST_MAX_LIGHTS);
+
+    // The next Build uploads all the lights, for a GPU buffer that lost its content.
+    void Invalidate() { m_uploaded = 0; }
+
+    uint32_t                     GetDirtyFirst() const { return m_dirtyFirst; }
+    uint32_t                     GetDirtyCount() const { return m_dirtyCount; }
+    std::vector<uint32_t> const &GetWords() const { return m_words; }
+    Stats const &                GetStats() const { return m_stats; }
+
+private:
+    std::vector<uint32_t> m_words;
+    std::vector<uint32_t> m_packed;         // Scratch
+    uint32_t              m_uploaded   = 0; // Lights of m_words the GPU buffer holds.
+    uint32_t              m_dirtyFirst = 0;
+    uint32_t              m_dirtyCount = 0;
+    Stats                 m_stats;
+};
+
+void PackLight(LightListBuilder::Light const &light, uint32_t words[LIGHT_LIST_LIGHT_WORDS]);
+// What LoadLight in RTShading.h reads back.
+void UnpackLight(uint32_t const words[LIGHT_LIST_LIGHT_WORDS], LightListBuilder::Light &light);
@@ -0,0 +1,128 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "MaterialBinning.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "../../Shaders/RayGbuffer.h"
+
+using RayGbufferCodec::FFX_Reflections_RayGbufferMaterialBin;
+
+void BinRayHitsByMaterial(std::vector<uint32_t> const &normalMaterialWords, std::vector<uint32_t> &binOffsets, std::vector<uint32_t> &order) {
+    binOffsets.assign(FFX_REFLECTIONS_MATERIAL_BIN_COUNT + 1, 0);
+    for (uint32_t word : normalMaterialWords) binOffsets[FFX_Reflections_RayGbufferMaterialBin(word) + 1]++;
+    for (size_t bin = 1; bin < binOffsets.size(); bin++) binOffsets[bin] += binOffsets[bin - 1];
+
+    std::vector<uint32_t> next(binOffsets.begin(), binOffsets.end() - 1);
+    order.resize(normalMaterialWords.size());
+    for (size_t hit = 0; hit < normalMaterialWords.size(); hit++) order[next[FFX_Reflections_RayGbufferMaterialBin(normalMaterialWords[hit])]++] = uint32_t(hit);
+}
+
+bool ValidateMaterialBinning(std::vector<uint32_t> const &normalMaterialWords, std::vector<uint32_t> const &order, std::string *pError) {
+    auto fail = [pError](std::string const &message) {
+        if (pError) *pError = message;
+        return false;
+    };
+    if (order.size() != normalMaterialWords.size()) return fail("binned list has " + std::to_string(order.size()) + " hits, expected " + std::to_string(normalMaterialWords.size()));
+
+    std::vector<bool> seen(order.size(), false);
+    uint32_t          previousBin = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        uint32_t hit = order[i];
+        if (hit >= order.size() || seen[hit]) return fail("hit " + std::to_string(hit) + " at position " + std::to_string(i) + " is out of range or repeated");
+        seen[hit] = true;
+
+        uint32_t bin = FFX_Reflections_RayGbufferMaterialBin(normalMaterialWords[hit]);
+        if (bin < previousBin) return fail("bin " + std::to_string(bin) + " at position " + std::to_string(i) + " follows bin " + std::to_string(previousBin));
+        previousBin = bin;
+    }
+    return true;
+}
+
+ShadingDivergence EstimateShadingDivergence(std::vector<uint32_t> const &normalMaterialWords, std::vector<uint32_t> const &order, uint32_t waveSize) {
+    ShadingDivergence result;
+    size_t            count = normalMaterialWords.size();
+    if (count == 0 || waveSize == 0) return result;
+
+    std::vector<uint32_t> bins;
+    uint64_t              totalBins = 0;
+    uint64_t              slots     = 0;
+    for (size_t first = 0; first < count; first += waveSize) {
+        size_t lanes = std::min<size_t>(waveSize, count - first);
+        bins.clear();
+        for (size_t lane = 0; lane < lanes; lane++) {
+            size_t hit = order.empty() ? first + lane : order[first + lane];
+            bins.push_back(FFX_Reflections_RayGbufferMaterialBin(normalMaterialWords[hit]));
+        }
+        std::sort(bins.begin(), bins.end());
+        uint32_t distinct = uint32_t(std::unique(bins.begin(), bins.end()) - bins.begin());
+
+        result.waves++;
+        result.maxBinsPerWave = std::max(result.maxBinsPerWave, distinct);
+        totalBins += distinct;
+        slots += uint64_t(distinct) * waveSize;
+    }
+    result.avgBinsPerWave  = double(totalBins) / double(result.waves);
+    result.laneUtilization = double(count) / double(slots);
+    return result;
+}
+
+bool SaveRecordedRayHits(std::string const &filename, uint32_t stride, uint32_t count, void const *pRayGbuffer, std::string *pError) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        if (pError) *pError = "can not create " + filename;
+        return false;
+    }
+    RecordedRayHitsHeader header = {RECORDED_RAY_HITS_MAGIC, RECORDED_RAY_HITS_VERSION, stride, count};
+    out.write((char const *)&header, sizeof(header));
+    out.write((char const *)pRayGbuffer, std::streamsize(size_t(stride) * count));
+    if (!out) {
+        if (pError) *pError = "can not write " + filename;
+        return false;
+    }
+    return true;
+}
+
+bool LoadRecordedRayHits(std::string const &filename, std::vector<uint32_t> &normalMaterialWords, std::string *pError) {
+    auto fail = [pError](std::string const &message) {
+        if (pError) *pError = message;
+        return false;
+    };
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) return fail("can not open " + filename);
+
+    RecordedRayHitsHeader header = {};
+    if (!in.read((char *)&header, sizeof(header)) || header.magic != RECORDED_RAY_HITS_MAGIC) return fail(filename + " is not a recorded hit list");
+    if (header.version != RECORDED_RAY_HITS_VERSION) return fail(filename + " has unsupported version " + std::to_string(header.version));
+    if (header.stride != FFX_REFLECTIONS_RAY_GBUFFER_SIZE && header.stride != FFX_REFLECTIONS_COMPACT_RAY_GBUFFER_SIZE)
+        return fail(filename + " has unknown stride " + std::to_string(header.stride));
+
+    std::vector<uint8_t> entries(size_t(header.stride) * header.count);
+    if (!in.read((char *)entries.data(), std::streamsize(entries.size()))) return fail(filename + " is truncated");
+
+    // Both layouts keep the normal/material word at byte 4.
+    normalMaterialWords.resize(header.count);
+    for (uint32_t hit = 0; hit < header.count; hit++) memcpy(&normalMaterialWords[hit], &entries[size_t(hit) * header.stride + 4], sizeof(uint32_t));
+    return true;
+}
@@ -0,0 +1,73 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+        CPU reference of the material binning that runs before DeferredShade with HSR_MATERIAL_BINNING, and a model of
+        how divergent the shading waves are, so hit lists recorded with HSR::CaptureRayHits can be checked offline.
+
+        Hits are given by the normal/material word of their ray GBuffer entry, the bin of a hit is
+        FFX_Reflections_RayGbufferMaterialBin in Shaders/RayGbuffer.h.
+*/
+
+// Counting sort of the hits by bin, the same counters, exclusive prefix sum and scatter as the GPU passes. Hits keep
+// their relative order within a bin, which the GPU version does not guarantee.
+// binOffsets gets FFX_REFLECTIONS_MATERIAL_BIN_COUNT + 1 entries, bin b is order[binOffsets[b] .. binOffsets[b + 1]).
+void BinRayHitsByMaterial(std::vector<uint32_t> const &normalMaterialWords, std::vector<uint32_t> &binOffsets, std::vector<uint32_t> &order);
+
+// Checks that 'order' is a permutation of the hits that visits the bins in increasing order, which is all the GPU
+// passes promise.
+bool ValidateMaterialBinning(std::vector<uint32_t> const &normalMaterialWords, std::vector<uint32_t> const &order, std::string *pError = nullptr);
+
+struct ShadingDivergence {
+    uint32_t waves          = 0;
+    uint32_t maxBinsPerWave = 0;
+    double   avgBinsPerWave = 0.0;
+    // Share of the lanes doing useful work when a wave runs the material fetches once per distinct bin, as the
+    // NonUniformResourceIndex texture reads of DeferredShade do.
+    double laneUtilization = 0.0;
+};
+
+// Shading waves of 'waveSize' consecutive hits in 'order', an empty order is the unbinned ray list order.
+ShadingDivergence EstimateShadingDivergence(std::vector<uint32_t> const &normalMaterialWords, std::vector<uint32_t> const &order, uint32_t waveSize = 32);
+
+/**
+        Recorded hit list file: a RecordedRayHitsHeader followed by 'count' ray GBuffer entries of 'stride' bytes, as
+        laid out on the GPU (see Shaders/RayGbuffer.h). Little endian.
+*/
+struct RecordedRayHitsHeader {
+    uint32_t magic;   // RECORDED_RAY_HITS_MAGIC
+    uint32_t version; // RECORDED_RAY_HITS_VERSION
+    uint32_t stride;
+    uint32_t count;
+};
+
+static const uint32_t RECORDED_RAY_HITS_MAGIC   = 0x53544948; // "HITS"
+static const uint32_t RECORDED_RAY_HITS_VERSION = 1;
+
+bool SaveRecordedRayHits(std::string const &filename, uint32_t stride, uint32_t count, void const *pRayGbuffer, std::string *pError = nullptr);
+// Returns the normal/material word of every recorded hit.
+bool LoadRecordedRayHits(std::string const &filename, std::vector<uint32_t> &normalMaterialWords, std::string *pError = nullptr);
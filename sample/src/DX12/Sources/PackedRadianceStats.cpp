@@ -0,0 +1,122 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include "PackedRadianceStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace PackedRadianceCodec;
+
+namespace {
+
+const uint32_t MANTISSA_BITS[3] = {FFX_REFLECTIONS_PACKED_RADIANCE_RG_MANTISSA_BITS, FFX_REFLECTIONS_PACKED_RADIANCE_RG_MANTISSA_BITS,
+                                   FFX_REFLECTIONS_PACKED_RADIANCE_B_MANTISSA_BITS};
+const float    MAX_VALUES[3]    = {FFX_REFLECTIONS_PACKED_RADIANCE_RG_MAX, FFX_REFLECTIONS_PACKED_RADIANCE_RG_MAX, FFX_REFLECTIONS_PACKED_RADIANCE_B_MAX};
+const float    MIN_NORMAL       = 1.0f / 16384.0f;
+
+float Quantize(float x, uint32_t channel, float noise) { return FFX_Reflections_QuantizeRadianceChannel(x, MANTISSA_BITS[channel], MAX_VALUES[channel], noise); }
+
+float Noise(bool dither, uint32_t x, uint32_t y, uint32_t seed, uint32_t channel) { return dither ? FFX_Reflections_RadianceDitherNoise(x, y, seed, channel) : 0.5f; }
+
+struct ErrorAccumulator {
+    PackedRadianceError error;
+    double              relSum       = 0.0;
+    double              biasSum      = 0.0;
+    uint64_t            normalValues = 0;
+
+    // 'reference' is what 'quantized' approximates, 'value' the input of the last quantization that bounds the error.
+    void Add(float reference, float value, float quantized, uint32_t channel, bool dither) {
+        error.values++;
+        float clamped = value > 0.0f ? (value < MAX_VALUES[channel] ? value : MAX_VALUES[channel]) : 0.0f;
+        float ulp     = std::ldexp(1.0f, std::ilogb(std::max(clamped, MIN_NORMAL)) - int(MANTISSA_BITS[channel]));
+        if (std::abs(double(quantized) - double(clamped)) > (dither ? ulp : 0.5 * ulp)) error.boundFails++;
+
+        double abs_error  = std::abs(double(quantized) - double(reference));
+        error.maxAbsError = std::max(error.maxAbsError, abs_error);
+        if (reference >= MIN_NORMAL && reference <= MAX_VALUES[channel]) {
+            double rel        = abs_error / reference;
+            error.maxRelError = std::max(error.maxRelError, rel);
+            relSum += rel;
+            biasSum += (double(quantized) - double(reference)) / reference;
+            normalValues++;
+        }
+    }
+
+    void AddRoundTrip(float r, float g, float b) {
+        uint pack = FFX_Reflections_PackR11G11B10(r, g, b);
+        if (FFX_Reflections_UnpackR11G11B10(pack, 0u) != r || FFX_Reflections_UnpackR11G11B10(pack, 1u) != g || FFX_Reflections_UnpackR11G11B10(pack, 2u) != b)
+            error.roundTripFails++;
+    }
+
+    PackedRadianceError Finish() {
+        if (normalValues) {
+            error.meanRelError = relSum / double(normalValues);
+            error.meanRelBias  = biasSum / double(normalValues);
+        }
+        return error;
+    }
+};
+
+} // namespace
+
+PackedRadianceError MeasurePackedRadiance(DenoiserImage const &image, uint32_t firstPlane, bool dither, uint32_t frameIndex, uint32_t stream) {
+    ErrorAccumulator accumulator;
+    uint32_t         seed = frameIndex * FFX_REFLECTIONS_RADIANCE_DITHER_STREAMS + stream;
+    for (uint32_t y = 0; y < image.height; y++) {
+        for (uint32_t x = 0; x < image.width; x++) {
+            float quantized[3];
+            for (uint32_t channel = 0; channel < 3; channel++) {
+                float value        = image.At(firstPlane + channel, x, y);
+                quantized[channel] = Quantize(value, channel, Noise(dither, x, y, seed, channel));
+                if (std::isfinite(value)) accumulator.Add(value, value, quantized[channel], channel, dither);
+            }
+            accumulator.AddRoundTrip(quantized[0], quantized[1], quantized[2]);
+        }
+    }
+    return accumulator.Finish();
+}
+
+PackedRadianceError SimulatePackedRadianceHistory(DenoiserImage const &image, uint32_t historyPlane, uint32_t targetPlane, float blend, uint32_t frames, bool dither,
+                                                  uint32_t stride) {
+    ErrorAccumulator accumulator;
+    for (uint32_t y = 0; y < image.height; y += stride) {
+        for (uint32_t x = 0; x < image.width; x += stride) {
+            for (uint32_t channel = 0; channel < 3; channel++) {
+                float target = image.At(targetPlane + channel, x, y);
+                float start  = image.At(historyPlane + channel, x, y);
+                if (!std::isfinite(target) || !std::isfinite(start)) continue;
+                float exact     = start;
+                float quantized = Quantize(start, channel, 0.5f);
+                float value     = quantized;
+                for (uint32_t frame = 0; frame < frames; frame++) {
+                    uint32_t seed = frame * FFX_REFLECTIONS_RADIANCE_DITHER_STREAMS + FFX_REFLECTIONS_RADIANCE_DITHER_TEMPORAL;
+                    exact += (target - exact) * blend;
+                    value     = quantized + (target - quantized) * blend;
+                    quantized = Quantize(value, channel, Noise(dither, x, y, seed, channel));
+                }
+                accumulator.Add(exact, value, quantized, channel, dither);
+            }
+        }
+    }
+    return accumulator.Finish();
+}
@@ -0,0 +1,59 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+
+#include "../../Shaders/PackedRadiance.h"
+#include "DenoiserReference.h"
+
+/**
+        Error statistics of the R11G11B10 radiance quantizer of HSR_PACKED_RADIANCE (Shaders/PackedRadiance.h) on
+        captured radiance, so the bandwidth saving can be weighed against what it costs in precision.
+
+        Relative errors only count values in the normal range of the small floats, [2^-14, 64512], smaller ones are
+        covered by maxAbsError.
+*/
+struct PackedRadianceError {
+    uint64_t values         = 0; // Measured channel values.
+    uint64_t roundTripFails = 0; // Quantized values that do not survive PackR11G11B10 / UnpackR11G11B10 unchanged.
+    uint64_t boundFails     = 0; // Values with an error above one ULP (dithered) or half an ULP (nearest).
+    double   maxAbsError    = 0.0;
+    double   maxRelError    = 0.0;
+    double   meanRelError   = 0.0;
+    double   meanRelBias    = 0.0; // Signed, (quantized - value) / value.
+};
+
+/**
+        Quantizes the 3 planes starting at firstPlane like the radiance stores do, rounding to the nearest value or with
+        the dither of frame 'frameIndex' and the pass 'stream' (FFX_REFLECTIONS_RADIANCE_DITHER_*).
+*/
+PackedRadianceError MeasurePackedRadiance(DenoiserImage const &image, uint32_t firstPlane, bool dither, uint32_t frameIndex, uint32_t stream);
+
+/**
+        Runs 'frames' frames of the temporal loop on every 'stride'-th pixel in x and y: the history starts at the
+        historyPlane radiance and moves by 'blend' towards the targetPlane radiance each frame, once in fp32 and once
+        quantized after every blend. The error is the one of the quantized history against the fp32 one after the
+        last frame. With rounding to the nearest value the history stops short of the target, which shows as bias.
+*/
+PackedRadianceError SimulatePackedRadianceHistory(DenoiserImage const &image, uint32_t historyPlane, uint32_t targetPlane, float blend, uint32_t frames, bool dither,
+                                                  uint32_t stride);
@@ -0,0 +1,231 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <exception>
+#include <map>
+#include <vector>
+
+/**
+        Lazily populated cache of pipeline permutations keyed by a define mask.
+
+        Nothing is built up front. The first Acquire() of a mask builds it; if another permutation that agrees on the
+        required bits is already available the build is moved to a worker thread and that permutation is returned in
+        the meantime. Masks listed with Prewarm() are built in the background ahead of their first use.
+
+        The backend is a plain function so the policy does not depend on D3D12: BuildFn receives the mask and the
+        previously built table (nullptr for a first build) and returns the new table; DestroyFn releases a table.
+        BuildFn throws when it cannot build the mask, after releasing what it created. The mask is then left unbuilt
+        and not retried until the next Rebuild(), and Acquire() keeps returning the closest ready permutation.
+*/
+template <typename TABLE> class PermutationCache {
+public:
+    using BuildFn   = std::function<TABLE(uint32_t mask, TABLE const *pPrevious)>;
+    using DestroyFn = std::function<void(TABLE &table)>;
+
+    /**
+            \param build Builds the table for a mask.
+            \param destroy Releases a table.
+            \param requiredBits Bits a fallback permutation must share with the requested mask, for permutations
+                                that are not interchangeable (e.g. a different output resolution).
+            \param allowAsync Build on worker threads. When false every build happens inline in Acquire()/Prewarm().
+    */
+    void Init(BuildFn build, DestroyFn destroy, uint32_t requiredBits, bool allowAsync = true) {
+        m_build        = build;
+        m_destroy      = destroy;
+        m_requiredBits = requiredBits;
+        m_allowAsync   = allowAsync;
+    }
+
+    /**
+            Returns the table for the mask, or the closest ready permutation while it is still being built or after
+            its build failed. Blocks only when nothing compatible is ready yet, and rethrows the failure of the build
+            then as there is nothing to return.
+    */
+    TABLE const &Acquire(uint32_t mask) {
+        Update();
+        auto it = m_ready.find(mask);
+        if (it != m_ready.end()) return it->second;
+
+        TABLE const *pFallback = FindFallback(mask);
+        if (!pFallback) {
+            if (!Wait(mask)) std::rethrow_exception(m_failed[mask]);
+            return m_ready.find(mask)->second;
+        }
+        Request(mask);
+        return *pFallback;
+    }
+
+    /**
+            Queues background builds for the listed masks.
+    */
+    void Prewarm(std::vector<uint32_t> const &masks) {
+        for (uint32_t mask : masks)
+            if (m_ready.find(mask) == m_ready.end()) Request(mask);
+    }
+
+    /**
+            Moves finished background builds into the ready set. Never blocks.
+    */
+    void Update() {
+        for (auto it = m_pending.begin(); it != m_pending.end();) {
+            if (it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                Finish(it->first, [&it]() { return it->second.get(); });
+                it = m_pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    /**
+            Rebuilds every ready permutation in place, passing the current table as previous so the backend can keep
+            entries that failed to compile or were not affected. The backend is responsible for the GPU no longer
+            using the entries it replaces. The overload builds with a different backend for this one pass. Masks whose
+            build failed are tried again on their next use.
+    */
+    void Rebuild() { Rebuild(m_build); }
+    void Rebuild(BuildFn const &build) {
+        WaitAll();
+        m_failed.clear();
+        for (auto &item : m_ready) item.second = build(item.first, &item.second);
+    }
+
+    /**
+            Waits for the builds of the masks with any of 'bits' and releases those tables, for permutations that are
+            only used while a feature is on. The overload releases them with a different backend for this one call,
+            e.g. to defer the release until the GPU is done with them.
+    */
+    void Evict(uint32_t bits) { Evict(bits, m_destroy); }
+    void Evict(uint32_t bits, DestroyFn const &destroy) {
+        for (auto it = m_pending.begin(); it != m_pending.end();) {
+            uint32_t mask = it->first;
+            ++it;
+            if (mask & bits) Wait(mask);
+        }
+        for (auto it = m_failed.begin(); it != m_failed.end();) {
+            if (it->first & bits)
+                it = m_failed.erase(it);
+            else
+                ++it;
+        }
+        for (auto it = m_ready.begin(); it != m_ready.end();) {
+            if (it->first & bits) {
+                destroy(it->second);
+                it = m_ready.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    /**
+            Waits for outstanding builds and releases every table.
+    */
+    void Clear() {
+        WaitAll();
+        for (auto &item : m_ready) m_destroy(item.second);
+        m_ready.clear();
+        m_failed.clear();
+    }
+
+    bool     IsReady(uint32_t mask) const { return m_ready.find(mask) != m_ready.end(); }
+    bool     IsPending(uint32_t mask) const { return m_pending.find(mask) != m_pending.end(); }
+    bool     IsFailed(uint32_t mask) const { return m_failed.find(mask) != m_failed.end(); }
+    uint32_t GetReadyCount() const { return (uint32_t)m_ready.size(); }
+    // Ready tables whose mask has any of 'bits'.
+    uint32_t GetReadyCount(uint32_t bits) const {
+        uint32_t count = 0;
+        for (auto const &item : m_ready)
+            if (item.first & bits) count++;
+        return count;
+    }
+    uint32_t GetPendingCount() const { return (uint32_t)m_pending.size(); }
+
+private:
+    void Request(uint32_t mask) {
+        if (IsReady(mask) || IsPending(mask) || IsFailed(mask)) return;
+        if (m_allowAsync) {
+            BuildFn build    = m_build;
+            m_pending[mask] = std::async(std::launch::async, [build, mask]() { return build(mask, nullptr); });
+        } else {
+            Finish(mask, [this, mask]() { return m_build(mask, nullptr); });
+        }
+    }
+
+    // Builds the mask or waits for its pending build, false if the build failed.
+    bool Wait(uint32_t mask) {
+        auto it = m_pending.find(mask);
+        if (it == m_pending.end()) return IsFailed(mask) ? false : Finish(mask, [this, mask]() { return m_build(mask, nullptr); });
+        bool const built = Finish(mask, [&it]() { return it->second.get(); });
+        m_pending.erase(it);
+        return built;
+    }
+
+    // Moves the table 'get' returns into the ready set, or records why it could not be built.
+    template <typename GET> bool Finish(uint32_t mask, GET const &get) {
+        try {
+            // Built before the entry is added, so a failed build leaves no entry behind.
+            TABLE table   = get();
+            m_ready[mask] = table;
+            return true;
+        } catch (...) {
+            m_failed[mask] = std::current_exception();
+            return false;
+        }
+    }
+
+    void WaitAll() {
+        while (!m_pending.empty()) Wait(m_pending.begin()->first);
+    }
+
+    // The ready permutation sharing the required bits and the most other bits with the mask, lowest mask on ties.
+    TABLE const *FindFallback(uint32_t mask) const {
+        TABLE const *pBest    = nullptr;
+        uint32_t     bestDist = ~0u;
+        for (auto const &item : m_ready) {
+            uint32_t diff = item.first ^ mask;
+            if (diff & m_requiredBits) continue;
+            uint32_t dist = 0;
+            for (; diff; diff &= diff - 1) dist++;
+            if (dist < bestDist) {
+                bestDist = dist;
+                pBest    = &item.second;
+            }
+        }
+        return pBest;
+    }
+
+    BuildFn   m_build;
+    DestroyFn m_destroy;
+    uint32_t  m_requiredBits = 0;
+    bool      m_allowAsync   = true;
+
+    // Ordered so that fallback ties resolve to the lowest mask deterministically.
+    std::map<uint32_t, TABLE>              m_ready;
+    std::map<uint32_t, std::future<TABLE>> m_pending;
+    std::map<uint32_t, std::exception_ptr> m_failed;
+};
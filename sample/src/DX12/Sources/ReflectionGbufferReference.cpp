@@ -0,0 +1,202 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include "ReflectionGbufferReference.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace ReflectionGbufferModel;
+
+static float Depth(DenoiserImage const &image, uint32_t x, uint32_t y) { return image.At(REFLECTION_GBUFFER_CAPTURE_DEPTH, x, y); }
+static float Roughness(DenoiserImage const &image, uint32_t x, uint32_t y) { return image.At(REFLECTION_GBUFFER_CAPTURE_ROUGHNESS, x, y); }
+
+// Angle between the encoded normals of two pixels, in degrees.
+static double NormalAngle(DenoiserImage const &a, uint32_t ax, uint32_t ay, DenoiserImage const &b, uint32_t bx, uint32_t by) {
+    double na[3], nb[3], la = 0.0, lb = 0.0, d = 0.0;
+    for (uint32_t i = 0; i < 3; i++) {
+        na[i] = a.At(REFLECTION_GBUFFER_CAPTURE_NORMAL + i, ax, ay) * 2.0 - 1.0;
+        nb[i] = b.At(REFLECTION_GBUFFER_CAPTURE_NORMAL + i, bx, by) * 2.0 - 1.0;
+        la += na[i] * na[i];
+        lb += nb[i] * nb[i];
+        d += na[i] * nb[i];
+    }
+    if (la == 0.0 || lb == 0.0) return la == lb ? 0.0 : 180.0;
+    return std::acos(std::max(-1.0, std::min(1.0, d / std::sqrt(la * lb)))) * (180.0 / 3.14159265358979323846);
+}
+
+void ReconstructReflectionGbuffer(DenoiserImage const &full, uint32_t width, uint32_t height, uint32_t footprint, DenoiserImage &result) {
+    result.Resize(width, height, REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT);
+    for (uint32_t y = 0; y < height; y++) {
+        uint32_t const y0 = ReflectionGbuffer_FootprintBegin(y, full.height, height);
+        uint32_t const y1 = ReflectionGbuffer_FootprintEnd(y, full.height, height);
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t const x0 = ReflectionGbuffer_FootprintBegin(x, full.width, width);
+            uint32_t const x1 = ReflectionGbuffer_FootprintEnd(x, full.width, width);
+            // Same walk as ReconstructGbuffer.hlsl.
+            uint32_t best_x = ReflectionGbuffer_FootprintCenter(x, full.width, width);
+            uint32_t best_y = ReflectionGbuffer_FootprintCenter(y, full.height, height);
+            if (footprint != REFLECTION_GBUFFER_FOOTPRINT_CENTER) {
+                float best_depth     = Depth(full, best_x, best_y);
+                float best_roughness = Roughness(full, best_x, best_y);
+                for (uint32_t sy = y0; sy < y1; sy++) {
+                    for (uint32_t sx = x0; sx < x1; sx++) {
+                        float depth     = Depth(full, sx, sy);
+                        float roughness = Roughness(full, sx, sy);
+                        if (ReflectionGbuffer_IsBetter(footprint, depth, roughness, best_depth, best_roughness)) {
+                            best_x         = sx;
+                            best_y         = sy;
+                            best_depth     = depth;
+                            best_roughness = roughness;
+                        }
+                    }
+                }
+            }
+            for (uint32_t plane = 0; plane < REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT; plane++) result.At(plane, x, y) = full.At(plane, best_x, best_y);
+        }
+    }
+}
+
+uint32_t CountUnmatchedReflectionGbufferPixels(DenoiserImage const &full, DenoiserImage const &reflection, float tolerance, uint32_t *pFirstX, uint32_t *pFirstY) {
+    uint32_t unmatched = 0;
+    for (uint32_t y = 0; y < reflection.height; y++) {
+        uint32_t const y0 = ReflectionGbuffer_FootprintBegin(y, full.height, reflection.height);
+        uint32_t const y1 = ReflectionGbuffer_FootprintEnd(y, full.height, reflection.height);
+        for (uint32_t x = 0; x < reflection.width; x++) {
+            uint32_t const x0      = ReflectionGbuffer_FootprintBegin(x, full.width, reflection.width);
+            uint32_t const x1      = ReflectionGbuffer_FootprintEnd(x, full.width, reflection.width);
+            bool           matched = false;
+            for (uint32_t sy = y0; sy < y1 && !matched; sy++) {
+                for (uint32_t sx = x0; sx < x1 && !matched; sx++) {
+                    matched = Depth(full, sx, sy) == Depth(reflection, x, y);
+                    for (uint32_t plane = REFLECTION_GBUFFER_CAPTURE_NORMAL; plane < REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT && matched; plane++)
+                        matched = std::abs(full.At(plane, sx, sy) - reflection.At(plane, x, y)) <= tolerance;
+                }
+            }
+            if (matched) continue;
+            if (!unmatched) {
+                if (pFirstX) *pFirstX = x;
+                if (pFirstY) *pFirstY = y;
+            }
+            unmatched++;
+        }
+    }
+    return unmatched;
+}
+
+ReflectionGbufferComparison CompareReflectionGbuffer(DenoiserImage const &reference, DenoiserImage const &result) {
+    ReflectionGbufferComparison comparison;
+    uint32_t const              width  = std::min(reference.width, result.width);
+    uint32_t const              height = std::min(reference.height, result.height);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            bool reference_background = ReflectionGbuffer_IsBackground(Depth(reference, x, y));
+            bool result_background    = ReflectionGbuffer_IsBackground(Depth(result, x, y));
+            if (reference_background != result_background) comparison.coverageMismatches++;
+            if (reference_background || result_background) continue;
+
+            double depth_error     = std::abs(double(Depth(reference, x, y)) - double(Depth(result, x, y)));
+            double normal_angle    = NormalAngle(reference, x, y, result, x, y);
+            double roughness_error = std::abs(double(Roughness(reference, x, y)) - double(Roughness(result, x, y)));
+            if (depth_error != 0.0) comparison.depthMismatches++;
+            comparison.maxDepthError     = std::max(comparison.maxDepthError, depth_error);
+            comparison.maxNormalAngle    = std::max(comparison.maxNormalAngle, normal_angle);
+            comparison.maxRoughnessError = std::max(comparison.maxRoughnessError, roughness_error);
+            comparison.meanDepthError += depth_error;
+            comparison.meanNormalAngle += normal_angle;
+            comparison.meanRoughnessError += roughness_error;
+            comparison.pixels++;
+        }
+    }
+    if (comparison.pixels) {
+        comparison.meanDepthError /= comparison.pixels;
+        comparison.meanNormalAngle /= comparison.pixels;
+        comparison.meanRoughnessError /= comparison.pixels;
+    }
+    return comparison;
+}
+
+char const *GetReflectionGbufferFootprintName(uint32_t footprint) {
+    switch (footprint) {
+    case REFLECTION_GBUFFER_FOOTPRINT_CENTER:
+        return "center";
+    case REFLECTION_GBUFFER_FOOTPRINT_CLOSEST:
+        return "closest";
+    case REFLECTION_GBUFFER_FOOTPRINT_GLOSSIEST:
+        return "glossiest";
+    }
+    return "unknown";
+}
+
+bool SaveReflectionGbufferCapture(std::string const &filename, ReflectionGbufferCapture const &capture, std::string *pError) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        if (pError) *pError = "can not create " + filename;
+        return false;
+    }
+    ReflectionGbufferCaptureHeader header = {REFLECTION_GBUFFER_CAPTURE_MAGIC,
+                                             REFLECTION_GBUFFER_CAPTURE_VERSION,
+                                             capture.full.width,
+                                             capture.full.height,
+                                             capture.reflection.width,
+                                             capture.reflection.height,
+                                             REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT,
+                                             capture.source,
+                                             capture.footprint};
+    out.write((char const *)&header, sizeof(header));
+    out.write((char const *)capture.full.data.data(), std::streamsize(capture.full.data.size() * sizeof(float)));
+    out.write((char const *)capture.reflection.data.data(), std::streamsize(capture.reflection.data.size() * sizeof(float)));
+    if (!out) {
+        if (pError) *pError = "can not write " + filename;
+        return false;
+    }
+    return true;
+}
+
+bool LoadReflectionGbufferCapture(std::string const &filename, ReflectionGbufferCapture &capture, std::string *pError) {
+    auto fail = [pError](std::string const &message) {
+        if (pError) *pError = message;
+        return false;
+    };
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) return fail("can not open " + filename);
+
+    ReflectionGbufferCaptureHeader header = {};
+    if (!in.read((char *)&header, sizeof(header)) || header.magic != REFLECTION_GBUFFER_CAPTURE_MAGIC) return fail(filename + " is not a GBuffer capture");
+    if (header.version != REFLECTION_GBUFFER_CAPTURE_VERSION) return fail(filename + " has unsupported version " + std::to_string(header.version));
+    if (header.planeCount != REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT)
+        return fail(filename + " has " + std::to_string(header.planeCount) + " planes instead of " + std::to_string(REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT));
+    if (header.fullWidth == 0 || header.fullHeight == 0 || header.fullWidth > 16384 || header.fullHeight > 16384) return fail(filename + " has an invalid size");
+    if (header.width == 0 || header.height == 0 || header.width > 16384 || header.height > 16384)
+        return fail(filename + " has an invalid reflection size");
+    if (header.source > REFLECTION_GBUFFER_SOURCE_RECONSTRUCT || header.footprint >= REFLECTION_GBUFFER_FOOTPRINT_COUNT) return fail(filename + " has an invalid source");
+
+    capture.source    = header.source;
+    capture.footprint = header.footprint;
+    capture.full.Resize(header.fullWidth, header.fullHeight, header.planeCount);
+    capture.reflection.Resize(header.width, header.height, header.planeCount);
+    if (!in.read((char *)capture.full.data.data(), std::streamsize(capture.full.data.size() * sizeof(float))) ||
+        !in.read((char *)capture.reflection.data.data(), std::streamsize(capture.reflection.data.size() * sizeof(float))))
+        return fail(filename + " is truncated");
+    return true;
+}
@@ -0,0 +1,103 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "../../Shaders/ReflectionGbuffer.h"
+#include "DenoiserReference.h"
+
+/**
+        CPU reference of ReconstructGbuffer.hlsl, which builds the reflection resolution GBuffer from the render
+        resolution one instead of rasterizing the scene a second time, so its footprint policies can be measured
+        against the raster pass on frames captured with SampleRenderer's GBuffer capture.
+
+        Images have the REFLECTION_GBUFFER_CAPTURE_* planes of Shaders/ReflectionGbuffer.h. The reconstruction takes
+        every plane of an output pixel from the same input sample, the GPU pass copies the fields the capture leaves
+        out (albedo, motion vectors) from that sample as well.
+*/
+
+// Builds a width x height reflection GBuffer from 'full' with the REFLECTION_GBUFFER_FOOTPRINT_* policy 'footprint'.
+void ReconstructReflectionGbuffer(DenoiserImage const &full, uint32_t width, uint32_t height, uint32_t footprint, DenoiserImage &result);
+
+/**
+        Checks that every pixel of 'reflection' is one sample of its footprint in 'full', depth bit for bit and the
+        normal and roughness within 'tolerance', the rounding of the GBuffer formats. This is what the raster pass
+        guarantees up to the offset between the pixel grids, and what a reconstruction must keep: exact depth and no
+        filtering of normals or roughness. Returns the number of pixels that are not.
+*/
+uint32_t CountUnmatchedReflectionGbufferPixels(DenoiserImage const &full, DenoiserImage const &reflection, float tolerance, uint32_t *pFirstX = nullptr,
+                                               uint32_t *pFirstY = nullptr);
+
+struct ReflectionGbufferComparison {
+    uint32_t pixels             = 0; // Pixels that are surface in both images.
+    uint32_t coverageMismatches = 0; // Pixels that are surface in one image and background in the other.
+    uint32_t depthMismatches    = 0; // Surface pixels whose depth is not bit for bit the same.
+    double   maxDepthError      = 0.0;
+    double   meanDepthError     = 0.0;
+    double   maxNormalAngle     = 0.0; // Degrees.
+    double   meanNormalAngle    = 0.0;
+    double   maxRoughnessError  = 0.0;
+    double   meanRoughnessError = 0.0;
+};
+
+// Compares 'result' with 'reference', both at the same resolution, e.g. a reconstruction with the raster pass.
+ReflectionGbufferComparison CompareReflectionGbuffer(DenoiserImage const &reference, DenoiserImage const &result);
+
+enum ReflectionGbufferSource : uint32_t {
+    REFLECTION_GBUFFER_SOURCE_RASTER      = 0, // The scene rasterized at the reflection resolution.
+    REFLECTION_GBUFFER_SOURCE_RECONSTRUCT = 1, // ReconstructGbuffer.hlsl with the captured footprint.
+};
+
+// One captured frame, the GBuffer at render resolution and the reflection GBuffer the frame used.
+struct ReflectionGbufferCapture {
+    uint32_t      source    = REFLECTION_GBUFFER_SOURCE_RASTER;
+    uint32_t      footprint = REFLECTION_GBUFFER_FOOTPRINT_CENTER; // Only meaningful for REFLECTION_GBUFFER_SOURCE_RECONSTRUCT.
+    DenoiserImage full;
+    DenoiserImage reflection;
+};
+
+char const *GetReflectionGbufferFootprintName(uint32_t footprint);
+
+/**
+        GBuffer capture file: a ReflectionGbufferCaptureHeader, then planeCount planes of fullWidth x fullHeight
+        floats and planeCount planes of width x height floats. Little endian.
+*/
+struct ReflectionGbufferCaptureHeader {
+    uint32_t magic;   // REFLECTION_GBUFFER_CAPTURE_MAGIC
+    uint32_t version; // REFLECTION_GBUFFER_CAPTURE_VERSION
+    uint32_t fullWidth;
+    uint32_t fullHeight;
+    uint32_t width;
+    uint32_t height;
+    uint32_t planeCount;
+    uint32_t source;
+    uint32_t footprint;
+};
+
+static const uint32_t REFLECTION_GBUFFER_CAPTURE_MAGIC   = 0x46554247; // "GBUF"
+static const uint32_t REFLECTION_GBUFFER_CAPTURE_VERSION = 1;
+
+bool SaveReflectionGbufferCapture(std::string const &filename, ReflectionGbufferCapture const &capture, std::string *pError = nullptr);
+bool LoadReflectionGbufferCapture(std::string const &filename, ReflectionGbufferCapture &capture, std::string *pError = nullptr);
@@ -0,0 +1,303 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "ResourceStateTracker.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+static const uint64_t NO_BATCH = ~uint64_t(0);
+
+void ResourceStateTracker::BeginFrame(std::string *pLog) {
+    m_entries.clear();
+    m_queue.clear();
+    m_dead.clear();
+    m_batch = 0;
+    m_stats = ResourceStateTrackerStats();
+    m_pLog  = pLog;
+}
+
+ResourceStateTracker::Entry &ResourceStateTracker::GetEntry(TrackedResource resource) {
+    for (Entry &entry : m_entries)
+        if (entry.resource == resource) return entry;
+    Entry entry;
+    entry.resource     = resource;
+    entry.defaultState = TRACKED_STATE_COMMON;
+    entry.state        = TRACKED_STATE_COMMON;
+    entry.splitBefore  = TRACKED_STATE_COMMON;
+    entry.splitPending = false;
+    entry.splitBatch   = NO_BATCH;
+    entry.syncBatch    = NO_BATCH;
+    entry.queuedBatch  = NO_BATCH;
+    entry.queuedIndex  = 0;
+    m_entries.push_back(entry);
+    return m_entries.back();
+}
+
+void ResourceStateTracker::Log(char const *pOp, Entry const &entry, uint32_t state) {
+    if (!m_pLog) return;
+    char line[64];
+    snprintf(line, sizeof(line), "%s %u 0x%x\n", pOp, uint32_t(&entry - m_entries.data()), state);
+    *m_pLog += line;
+}
+
+void ResourceStateTracker::SetDefaultState(TrackedResource resource, uint32_t state) {
+    Entry &entry = GetEntry(resource);
+    assert(entry.syncBatch == NO_BATCH && "set the default state before the first barrier of the resource");
+    entry.defaultState = state;
+    entry.state        = state;
+    Log("default", entry, state);
+}
+
+uint32_t ResourceStateTracker::GetState(TrackedResource resource) const {
+    for (Entry const &entry : m_entries)
+        if (entry.resource == resource) return entry.state;
+    return TRACKED_STATE_COMMON;
+}
+
+void ResourceStateTracker::Push(Entry &entry, TrackedBarrier const &barrier, bool mergeable) {
+    m_queue.push_back(barrier);
+    m_dead.push_back(false);
+    entry.syncBatch   = m_batch;
+    entry.queuedBatch = mergeable ? m_batch : NO_BATCH;
+    entry.queuedIndex = m_queue.size() - 1;
+}
+
+void ResourceStateTracker::Require(Entry &entry, uint32_t state, bool uavBarrier) {
+    if (entry.splitPending) {
+        entry.splitPending = false;
+        if (entry.splitBatch == m_batch) {
+            // Requested again before the begin was flushed, nothing ran in between to hide the transition behind.
+            m_queue[entry.queuedIndex].split = TrackedBarrierSplit::None;
+        } else {
+            TrackedBarrier end;
+            end.split    = TrackedBarrierSplit::End;
+            end.resource = entry.resource;
+            end.before   = entry.splitBefore;
+            end.after    = entry.state;
+            Push(entry, end, false);
+            m_stats.splits++;
+        }
+        if (entry.state == state) return;
+    }
+
+    if (entry.state == state) {
+        if (!uavBarrier) return;
+        // A barrier of the resource in this batch already waits for the last work, and only UAV writes need one.
+        if (!(state & TRACKED_STATE_UNORDERED_ACCESS) || entry.syncBatch == m_batch) {
+            m_stats.droppedUAV++;
+            return;
+        }
+        TrackedBarrier uav;
+        uav.type     = TrackedBarrierType::UnorderedAccess;
+        uav.resource = entry.resource;
+        Push(entry, uav, true);
+        return;
+    }
+
+    if (entry.queuedBatch == m_batch) {
+        TrackedBarrier &queued = m_queue[entry.queuedIndex];
+        if (queued.type == TrackedBarrierType::UnorderedAccess) {
+            // The transition waits for the writes as well.
+            m_dead[entry.queuedIndex] = true;
+            m_stats.droppedUAV++;
+        } else {
+            queued.after = state;
+            entry.state  = state;
+            m_stats.merged++;
+            if (queued.before == state && (state & TRACKED_STATE_UNORDERED_ACCESS)) {
+                // Back where it started, the round trip still had to wait for the writes of the last work.
+                queued.type = TrackedBarrierType::UnorderedAccess;
+            } else if (queued.before == state) {
+                m_dead[entry.queuedIndex] = true;
+                entry.queuedBatch         = NO_BATCH;
+            }
+            return;
+        }
+    }
+
+    TrackedBarrier transition;
+    transition.resource = entry.resource;
+    transition.before   = entry.state;
+    transition.after    = state;
+    Push(entry, transition, true);
+    entry.state = state;
+}
+
+void ResourceStateTracker::Transition(TrackedResource resource, uint32_t state) {
+    Entry &entry = GetEntry(resource);
+    Log("transition", entry, state);
+    m_stats.requests++;
+    Require(entry, state, true);
+}
+
+void ResourceStateTracker::BeginTransition(TrackedResource resource, uint32_t state) {
+    Entry &entry = GetEntry(resource);
+    Log("begin", entry, state);
+    m_stats.requests++;
+    if (entry.splitPending || entry.state == state) {
+        Require(entry, state, false);
+        return;
+    }
+    if (entry.queuedBatch == m_batch) {
+        if (m_queue[entry.queuedIndex].type != TrackedBarrierType::UnorderedAccess) {
+            Require(entry, state, false);
+            return;
+        }
+        m_dead[entry.queuedIndex] = true;
+        m_stats.droppedUAV++;
+    }
+    TrackedBarrier begin;
+    begin.split    = TrackedBarrierSplit::Begin;
+    begin.resource = resource;
+    begin.before   = entry.state;
+    begin.after    = state;
+    Push(entry, begin, true);
+    entry.splitPending = true;
+    entry.splitBefore  = entry.state;
+    entry.splitBatch   = m_batch;
+    entry.state        = state;
+}
+
+void ResourceStateTracker::Alias(TrackedResource resource) {
+    Entry &entry = GetEntry(resource);
+    Log("alias", entry, 0);
+    TrackedBarrier aliasing;
+    aliasing.type     = TrackedBarrierType::Aliasing;
+    aliasing.resource = resource;
+    m_queue.push_back(aliasing);
+    m_dead.push_back(false);
+    // Later barriers of the resource go after the activation.
+    entry.queuedBatch = NO_BATCH;
+}
+
+void ResourceStateTracker::Submit(ResourceBarrierSink &sink) {
+    size_t count = 0;
+    for (size_t i = 0; i < m_queue.size(); i++) {
+        if (m_dead[i]) continue;
+        TrackedBarrier const &barrier = m_queue[i];
+        switch (barrier.type) {
+        case TrackedBarrierType::Transition:
+            if (barrier.split != TrackedBarrierSplit::End) m_stats.transitions++;
+            break;
+        case TrackedBarrierType::UnorderedAccess:
+            m_stats.uavBarriers++;
+            break;
+        case TrackedBarrierType::Aliasing:
+            m_stats.aliasing++;
+            break;
+        }
+        m_queue[count++] = barrier;
+    }
+    if (count) {
+        sink.ResourceBarriers(m_queue.data(), uint32_t(count));
+        m_stats.batches++;
+    }
+    m_queue.clear();
+    m_dead.clear();
+    m_batch++;
+}
+
+void ResourceStateTracker::Flush(ResourceBarrierSink &sink) {
+    if (m_pLog) *m_pLog += "flush\n";
+    Submit(sink);
+}
+
+void ResourceStateTracker::EndFrame(ResourceBarrierSink &sink) {
+    if (m_pLog) *m_pLog += "end\n";
+    for (Entry &entry : m_entries) Require(entry, entry.defaultState, false);
+    Submit(sink);
+    m_pLog = nullptr;
+}
+
+bool ReplayResourceStateLog(std::string const &log, ResourceStateTracker &tracker, ResourceBarrierSink &sink, std::string *pError) {
+    std::istringstream stream(log);
+    std::string        line;
+    uint32_t           lineNumber = 0;
+    while (std::getline(stream, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') continue;
+        char     op[16] = {};
+        uint32_t id     = 0;
+        uint32_t state  = 0;
+        int      fields = sscanf(line.c_str(), "%15s %u %x", op, &id, &state);
+        // Handle 0 would be a null resource.
+        TrackedResource resource = reinterpret_cast<TrackedResource>(uintptr_t(id) + 1);
+        if (fields == 1 && !strcmp(op, "flush")) {
+            tracker.Flush(sink);
+        } else if (fields == 1 && !strcmp(op, "end")) {
+            tracker.EndFrame(sink);
+        } else if (fields == 3 && !strcmp(op, "default")) {
+            tracker.SetDefaultState(resource, state);
+        } else if (fields == 3 && !strcmp(op, "transition")) {
+            tracker.Transition(resource, state);
+        } else if (fields == 3 && !strcmp(op, "begin")) {
+            tracker.BeginTransition(resource, state);
+        } else if (fields >= 2 && !strcmp(op, "alias")) {
+            tracker.Alias(resource);
+        } else {
+            if (pError) *pError = "line " + std::to_string(lineNumber) + ": unexpected '" + line + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string FormatTrackedState(uint32_t state) {
+    static struct {
+        uint32_t    bit;
+        char const *pName;
+    } const names[] = {
+        {0x1, "VERTEX_AND_CONSTANT_BUFFER"},
+        {0x2, "INDEX_BUFFER"},
+        {0x4, "RENDER_TARGET"},
+        {0x8, "UNORDERED_ACCESS"},
+        {0x10, "DEPTH_WRITE"},
+        {0x20, "DEPTH_READ"},
+        {0x40, "NON_PIXEL_SHADER_RESOURCE"},
+        {0x80, "PIXEL_SHADER_RESOURCE"},
+        {0x100, "STREAM_OUT"},
+        {0x200, "INDIRECT_ARGUMENT"},
+        {0x400, "COPY_DEST"},
+        {0x800, "COPY_SOURCE"},
+        {0x1000, "RESOLVE_DEST"},
+        {0x2000, "RESOLVE_SOURCE"},
+        {0x400000, "RAYTRACING_ACCELERATION_STRUCTURE"},
+        {0x1000000, "SHADING_RATE_SOURCE"},
+    };
+    if (state == TRACKED_STATE_COMMON) return "COMMON";
+    std::string result;
+    for (auto const &name : names) {
+        if (!(state & name.bit)) continue;
+        if (!result.empty()) result += "|";
+        result += name.pName;
+        state &= ~name.bit;
+    }
+    if (state) {
+        char rest[16];
+        snprintf(rest, sizeof(rest), "0x%x", state);
+        if (!result.empty()) result += "|";
+        result += rest;
+    }
+    return result;
+}
@@ -0,0 +1,152 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+        Resource state tracker of one command list, independent of the graphics API.
+
+        Transitions are not recorded when they are requested: they are queued and Flush submits the queue as one
+        batch, so the caller flushes right before each dispatch, copy or indirect execute. While queued:
+          - a transition of a resource that already has one in the batch is merged into it, and dropped when the
+            resource ends up back in its state, or turned into a UAV barrier when that state is unordered access,
+          - a UAV barrier is dropped when no work ran since the last barrier of the resource, or when the resource is
+            not in the unordered access state, where the caller only asks for one to say "done writing",
+          - a transition started with BeginTransition is submitted as a split barrier, its end goes into the batch of
+            the next request of the resource. When that request comes before the begin was flushed the resource was
+            not idle and the pair collapses into a plain transition.
+
+        States are the D3D12_RESOURCE_STATES bits and resources are opaque handles, the D3D12 sink passes them through.
+*/
+
+typedef void const *TrackedResource;
+
+// The D3D12_RESOURCE_STATES the tracker needs to know, spelled out so it builds without the D3D12 headers.
+static const uint32_t TRACKED_STATE_COMMON           = 0x0;
+static const uint32_t TRACKED_STATE_UNORDERED_ACCESS = 0x8;
+
+enum class TrackedBarrierType {
+    Transition,
+    UnorderedAccess,
+    Aliasing, // Activates 'resource' in a placed heap, 'before' and 'after' are unused.
+};
+
+enum class TrackedBarrierSplit {
+    None,
+    Begin,
+    End,
+};
+
+struct TrackedBarrier {
+    TrackedBarrierType  type     = TrackedBarrierType::Transition;
+    TrackedBarrierSplit split    = TrackedBarrierSplit::None;
+    TrackedResource     resource = nullptr;
+    uint32_t            before   = 0;
+    uint32_t            after    = 0;
+};
+
+/**
+        Where the batches go. The D3D12 implementation records one ResourceBarrier call per batch.
+*/
+class ResourceBarrierSink {
+public:
+    virtual ~ResourceBarrierSink() {}
+
+    virtual void ResourceBarriers(TrackedBarrier const *pBarriers, uint32_t count) = 0;
+};
+
+// Counters of the current frame.
+struct ResourceStateTrackerStats {
+    uint32_t requests    = 0; // Transition and BeginTransition calls.
+    uint32_t batches     = 0; // Non empty flushes, one ResourceBarrier call each.
+    uint32_t transitions = 0; // Transition barriers submitted, a split barrier counts once.
+    uint32_t splits      = 0; // Transitions submitted as a begin/end pair.
+    uint32_t uavBarriers = 0;
+    uint32_t aliasing    = 0;
+    uint32_t merged      = 0; // Transitions folded into one of the same batch.
+    uint32_t droppedUAV  = 0; // UAV barriers not submitted.
+};
+
+class ResourceStateTracker {
+public:
+    // Forgets the states of the previous frame, every resource starts in its default state. When 'pLog' is set the
+    // requests of the frame are appended to it, see ReplayResourceStateLog.
+    void BeginFrame(std::string *pLog = nullptr);
+    // State 'resource' is in at the start of the frame and returns to in EndFrame, TRACKED_STATE_COMMON otherwise.
+    void SetDefaultState(TrackedResource resource, uint32_t state);
+
+    // The next work after the flush uses 'resource' in 'state'. Asking for the state the resource is already in
+    // requests a UAV barrier.
+    void Transition(TrackedResource resource, uint32_t state);
+    // 'resource' is not used until it is next requested, in 'state'. Starts a split barrier at the next flush.
+    void BeginTransition(TrackedResource resource, uint32_t state);
+    // Placed resource 'resource' starts its lifetime with the next work.
+    void Alias(TrackedResource resource);
+
+    // Submits the queued barriers in one batch, call before each dispatch, copy or indirect execute.
+    void Flush(ResourceBarrierSink &sink);
+    // Returns every resource the frame used to its default state and flushes.
+    void EndFrame(ResourceBarrierSink &sink);
+
+    // State after the queued barriers.
+    uint32_t                         GetState(TrackedResource resource) const;
+    ResourceStateTrackerStats const &GetStats() const { return m_stats; }
+
+private:
+    struct Entry {
+        TrackedResource resource;
+        uint32_t        defaultState;
+        uint32_t        state;       // After the queued barriers, the target of a pending split.
+        uint32_t        splitBefore; // State a pending split started from.
+        bool            splitPending;
+        uint64_t        splitBatch;  // Batch the begin of the pending split went into.
+        uint64_t        syncBatch;   // Batch of the last barrier of the resource, ~0 for none.
+        uint64_t        queuedBatch; // Batch of m_queue[queuedIndex].
+        size_t          queuedIndex; // Last mergeable barrier of the resource in m_queue.
+    };
+
+    Entry &GetEntry(TrackedResource resource);
+    void   Require(Entry &entry, uint32_t state, bool uavBarrier);
+    void   Push(Entry &entry, TrackedBarrier const &barrier, bool mergeable);
+    void   Log(char const *pOp, Entry const &entry, uint32_t state);
+    void   Submit(ResourceBarrierSink &sink);
+
+    std::vector<Entry>          m_entries; // Few enough for a linear search, in first use order.
+    std::vector<TrackedBarrier> m_queue;
+    std::vector<bool>           m_dead; // Per m_queue entry, merged away.
+    uint64_t                    m_batch = 0;
+    ResourceStateTrackerStats   m_stats;
+    std::string *               m_pLog = nullptr;
+};
+
+/**
+        Replays lines of a request log written by ResourceStateTracker::BeginFrame, call tracker.BeginFrame before the
+        first one. Resources are named by their first use index in the frame, the sink sees handles 1, 2, ... cast to
+        TrackedResource. Returns false with 'pError' set on a malformed line.
+*/
+bool ReplayResourceStateLog(std::string const &log, ResourceStateTracker &tracker, ResourceBarrierSink &sink, std::string *pError = nullptr);
+
+// D3D12 state bits by name, e.g. "UNORDERED_ACCESS" or "NON_PIXEL_SHADER_RESOURCE|PIXEL_SHADER_RESOURCE".
+std::string FormatTrackedState(uint32_t state);
@@ -102,6 +102,19 @@ void SampleRenderer::OnCreate(Device *pDevice, SwapChain *pSwapChain) {
     m_CpuVisibleHeap.OnCreate(m_pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 20, true);
     m_downsampleCounter.InitBuffer(m_pDevice, "HSR - Downsample Counter", &CD3DX12_RESOURCE_DESC::Buffer(12 * 4, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), 4,
                                    D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    m_lightGridBuffer.InitBuffer(m_pDevice, "Light Grid", &CD3DX12_RESOURCE_DESC::Buffer(LIGHT_GRID_MAX_WORDS * 4, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), 4,
+                                 D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    m_pLightGridUpload = AllocUpload(m_pDevice->GetDevice(), size_t(backBufferCount) * LIGHT_GRID_MAX_WORDS * 4);
+    ThrowIfFailed(m_pLightGridUpload->Map(0, NULL, (void **)&m_pLightGridUploadMap));
+    m_clusteredLightsBuffer.InitBuffer(m_pDevice, "Clustered Lights", &CD3DX12_RESOURCE_DESC::Buffer(CLUSTERED_LIGHTS_MAX_WORDS * 4), 4,
+                                       D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    m_pClusteredLightsUpload = AllocUpload(m_pDevice->GetDevice(), size_t(backBufferCount) * CLUSTERED_LIGHTS_MAX_WORDS * 4);
+    ThrowIfFailed(m_pClusteredLightsUpload->Map(0, NULL, (void **)&m_pClusteredLightsUploadMap));
+    m_lightListBuffer.InitBuffer(m_pDevice, "Light List", &CD3DX12_RESOURCE_DESC::Buffer(LIGHT_LIST_MAX_LIGHTS * LIGHT_LIST_LIGHT_WORDS * 4, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+                                 4, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    m_pLightListUpload = AllocUpload(m_pDevice->GetDevice(), size_t(backBufferCount) * LIGHT_LIST_MAX_LIGHTS * LIGHT_LIST_LIGHT_WORDS * 4);
+    ThrowIfFailed(m_pLightListUpload->Map(0, NULL, (void **)&m_pLightListUploadMap));
+    m_lightList.Invalidate();
     // Create a commandlist ring for the Direct queue
     uint32_t commandListsPerBackBuffer = 8;
     m_CommandListRing.OnCreate(pDevice, backBufferCount, commandListsPerBackBuffer, pDevice->GetGraphicsQueue()->GetDesc());
@@ -151,22 +164,39 @@ void SampleRenderer::OnCreate(Device *pDevice, SwapChain *pSwapChain) {
     const uint32_t uploadHeapMemSize = 1000 * 1024 * 1024;
     m_UploadHeap.OnCreate(pDevice, uploadHeapMemSize); // initialize an upload heap (uses suballocation for faster results)
 
-    for (uint32_t i = 0; i < 32; i++) {
-        static char namebuf[0x100];
-        sprintf_s(namebuf, sizeof(namebuf), "m_pShadowMap_%i", i);
-        m_shadowmaps[i].m_ShadowMap.InitDepthStencil(pDevice, namebuf,
-                                                     &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, 4096, 4096, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL));
-        m_ResourceViewHeaps.AllocDSVDescriptor(1, &m_shadowmaps[i].m_ShadowMapDSV);
-        m_ResourceViewHeaps.AllocCBV_SRV_UAVDescriptor(1, &m_shadowmaps[i].m_ShadowMapSRV);
-        m_shadowmaps[i].m_ShadowMap.CreateDSV(0, &m_shadowmaps[i].m_ShadowMapDSV);
-        m_shadowmaps[i].m_ShadowMap.CreateSRV(0, &m_shadowmaps[i].m_ShadowMapSRV);
+    ShadowAtlas::Config shadowAtlasConfig;
+    m_shadowAtlas.Init(shadowAtlasConfig);
+    m_ShadowAtlasTexture.InitDepthStencil(pDevice, "m_ShadowAtlasTexture",
+                                          &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, shadowAtlasConfig.atlasSize, shadowAtlasConfig.atlasSize, 1, 1, 1, 0,
+                                                                        D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL));
+    m_ResourceViewHeaps.AllocDSVDescriptor(1, &m_ShadowAtlasDSV);
+    m_ResourceViewHeaps.AllocCBV_SRV_UAVDescriptor(2, &m_ForwardLightingTable);
+    m_ShadowAtlasTexture.CreateDSV(0, &m_ShadowAtlasDSV);
+    m_ShadowAtlasTexture.CreateSRV(0, &m_ForwardLightingTable);
+    {
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+        srvDesc.Format                          = DXGI_FORMAT_R32_TYPELESS;
+        srvDesc.ViewDimension                   = D3D12_SRV_DIMENSION_BUFFER;
+        srvDesc.Shader4ComponentMapping         = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srvDesc.Buffer.NumElements              = CLUSTERED_LIGHTS_MAX_WORDS;
+        srvDesc.Buffer.Flags                    = D3D12_BUFFER_SRV_FLAG_RAW;
+        pDevice->GetDevice()->CreateShaderResourceView(m_clusteredLightsBuffer.GetResource(), &srvDesc, m_ForwardLightingTable.GetCPU(1));
     }
+    m_shadowAtlasState = D3D12_RESOURCE_STATE_DEPTH_WRITE;
     m_Wireframe.OnCreate(pDevice, &m_ResourceViewHeaps, &m_ConstantBufferRing, &m_VidMemBufferPool, DXGI_FORMAT_R16G16B16A16_FLOAT, 1);
     m_WireframeBox.OnCreate(pDevice, &m_ResourceViewHeaps, &m_ConstantBufferRing, &m_VidMemBufferPool);
     m_DownSample.OnCreate(pDevice, &m_ResourceViewHeaps, &m_ConstantBufferRing, &m_VidMemBufferPool, DXGI_FORMAT_R16G16B16A16_FLOAT);
     m_Bloom.OnCreate(pDevice, &m_ResourceViewHeaps, &m_ConstantBufferRing, &m_VidMemBufferPool, DXGI_FORMAT_R16G16B16A16_FLOAT);
     m_AtmosphereRenderer.OnCreate(pDevice, m_pGlobalRootSignature, 1024);
     m_DecalRenderer.OnCreate(pDevice, &m_UploadHeap, m_pGlobalRootSignature);
+    m_ReflectionGbufferRenderer.OnCreate(pDevice, m_pGlobalRootSignature);
+    m_RetiredPSOs.OnCreate(backBufferCount);
+    // Shaders are compiled from the flattened copy in ShaderLibDX, watch that one.
+    m_ShaderGraph.AddSearchPath("ShaderLibDX");
+    for (auto const &file : HSR::GetShaderFiles()) m_ShaderWatcher.Track(file);
+    for (auto const &file : AtmosphereRenderer::GetShaderFiles()) m_ShaderWatcher.Track(file);
+    for (auto const &file : DecalRenderer::GetShaderFiles()) m_ShaderWatcher.Track(file);
+    for (auto const &file : ReflectionGbufferRenderer::GetShaderFiles()) m_ShaderWatcher.Track(file);
     m_BrdfLut.InitFromFile(pDevice, &m_UploadHeap, "BrdfLut.dds", false); // LUT images are stored as linear
 
     // Create tonemapping pass
@@ -192,9 +222,7 @@ void SampleRenderer::OnCreate(Device *pDevice, SwapChain *pSwapChain) {
     ID3D12GraphicsCommandList *cl;
     ThrowIfFailed(m_pDevice->GetDevice()->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, ca, nullptr, IID_PPV_ARGS(&cl)));
 
-    m_ResourceViewHeaps.AllocCBV_SRV_UAVDescriptor(GDT_CBV_SRV_UAV_SIZE, &m_globalDescriptorTables[0]);
-    m_ResourceViewHeaps.AllocCBV_SRV_UAVDescriptor(GDT_CBV_SRV_UAV_SIZE, &m_globalDescriptorTables[1]);
-    m_ResourceViewHeaps.AllocCBV_SRV_UAVDescriptor(GDT_CBV_SRV_UAV_SIZE, &m_globalDescriptorTables[2]);
+    for (CBV_SRV_UAV &table : m_globalDescriptorTables) m_ResourceViewHeaps.AllocCBV_SRV_UAVDescriptor(GDT_CBV_SRV_UAV_SIZE, &table);
 
     m_ResourceViewHeaps.AllocSamplerDescriptor(GDT_SAMPLERS_SIZE, &m_globalSamplerTables[0]);
     m_ResourceViewHeaps.AllocSamplerDescriptor(GDT_SAMPLERS_SIZE, &m_globalSamplerTables[1]);
@@ -215,9 +243,7 @@ void SampleRenderer::OnCreate(Device *pDevice, SwapChain *pSwapChain) {
     m_UploadHeap.FlushAndFinish();
 #endif
 
-    m_AtmosphereRenderer.Bind(&m_globalDescriptorTables[0]);
-    m_AtmosphereRenderer.Bind(&m_globalDescriptorTables[1]);
-    m_AtmosphereRenderer.Bind(&m_globalDescriptorTables[2]);
+    for (CBV_SRV_UAV &table : m_globalDescriptorTables) m_AtmosphereRenderer.Bind(&table);
 }
 
 //--------------------------------------------------------------------------------------
@@ -235,13 +261,31 @@ void SampleRenderer::OnDestroy() {
     m_Bloom.OnDestroy();
     m_AtmosphereRenderer.OnDestroy();
     m_DecalRenderer.OnDestroy();
+    m_ReflectionGbufferRenderer.OnDestroy();
+    m_RetiredPSOs.OnDestroy();
     m_DownSample.OnDestroy();
     m_WireframeBox.OnDestroy();
     m_Wireframe.OnDestroy();
     m_downsampleCounter.OnDestroy();
-    for (uint32_t i = 0; i < 32; i++) {
-        m_shadowmaps[i].m_ShadowMap.OnDestroy();
+    m_lightGridBuffer.OnDestroy();
+    if (m_pLightGridUpload) {
+        m_pLightGridUpload->Release();
+        m_pLightGridUpload    = NULL;
+        m_pLightGridUploadMap = NULL;
+    }
+    m_clusteredLightsBuffer.OnDestroy();
+    if (m_pClusteredLightsUpload) {
+        m_pClusteredLightsUpload->Release();
+        m_pClusteredLightsUpload    = NULL;
+        m_pClusteredLightsUploadMap = NULL;
+    }
+    m_lightListBuffer.OnDestroy();
+    if (m_pLightListUpload) {
+        m_pLightListUpload->Release();
+        m_pLightListUpload    = NULL;
+        m_pLightListUploadMap = NULL;
     }
+    m_ShadowAtlasTexture.OnDestroy();
     m_BrdfLut.OnDestroy();
 
     if (m_DownsamplePipelineState != nullptr) m_DownsamplePipelineState->Release();
@@ -257,6 +301,16 @@ void SampleRenderer::OnDestroy() {
     m_hsr.OnDestroy();
 }
 
+// The reflection G-buffer is drawn a second time unless it is the render resolution one, the optimized downsample builds
+// it inside HSR or it is reconstructed from the render resolution one, see ReconstructGbuffer.hlsl.
+static bool ReconstructsReflectionGBuffer(State const *pState) {
+    return pState->bReconstructReflectionGbuffer && !pState->bOptimizedDownsample && pState->m_ReflectionResolutionMultiplier != 1.0f;
+}
+
+static bool RastersReflectionGBuffer(State const *pState) {
+    return !pState->bReconstructReflectionGbuffer && !pState->bOptimizedDownsample && pState->m_ReflectionResolutionMultiplier != 1.0f;
+}
+
 //--------------------------------------------------------------------------------------
 //
 // OnCreateWindowSizeDependentResources
@@ -268,22 +322,26 @@ void SampleRenderer::OnCreateWindowSizeDependentResources(SwapChain *pSwapChain,
     m_Height           = Height;
     m_ReflectionWidth  = ReflectionWidth;
     m_ReflectionHeight = ReflectionHeight;
-    m_ReflectionGBuffer.OnCreateWindowSizeDependentResources(m_pSwapChain, m_ReflectionWidth, m_ReflectionHeight);
+    // Every option that changes whether it is rasterized recreates these, see HSRSample::UpdateReflectionResolution
+    m_rastersReflectionGBuffer = RastersReflectionGBuffer(pState);
+    if (m_rastersReflectionGBuffer) m_ReflectionGBuffer.OnCreateWindowSizeDependentResources(m_pSwapChain, m_ReflectionWidth, m_ReflectionHeight);
     m_GBuffer.OnCreateWindowSizeDependentResources(m_pSwapChain, m_Width, m_Height);
     // UAV Buffers for optimized downsampling
     {
-        m_ReflectionUAVGbuffer.Depth.Init(
-            m_pDevice, "UAV GBuffer Depth",
-            &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT, m_ReflectionWidth, m_ReflectionHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
-            D3D12_RESOURCE_STATE_COMMON, NULL);
+        for (int i = 0; i < 2; i++) {
+            m_ReflectionUAVGbuffer.Depth[i].Init(
+                m_pDevice, i ? "UAV GBuffer Depth 1" : "UAV GBuffer Depth 0",
+                &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT, m_ReflectionWidth, m_ReflectionHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+                D3D12_RESOURCE_STATE_COMMON, NULL);
+            m_ReflectionUAVGbuffer.Normals[i].Init(
+                m_pDevice, i ? "UAV GBuffer Normals 1" : "UAV GBuffer Normals 0",
+                &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R10G10B10A2_UNORM, m_ReflectionWidth, m_ReflectionHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+                D3D12_RESOURCE_STATE_COMMON, NULL);
+        }
         m_ReflectionUAVGbuffer.MotionVectors.Init(
             m_pDevice, "UAV GBuffer Motion Vectors",
             &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R16G16_FLOAT, m_ReflectionWidth, m_ReflectionHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
             D3D12_RESOURCE_STATE_COMMON, NULL);
-        m_ReflectionUAVGbuffer.Normals.Init(
-            m_pDevice, "UAV GBuffer Normals",
-            &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R10G10B10A2_UNORM, m_ReflectionWidth, m_ReflectionHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
-            D3D12_RESOURCE_STATE_COMMON, NULL);
         m_ReflectionUAVGbuffer.Albedo.Init(
             m_pDevice, "UAV GBuffer Albedo",
             &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, m_ReflectionWidth, m_ReflectionHeight, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
@@ -303,6 +361,7 @@ void SampleRenderer::OnCreateWindowSizeDependentResources(SwapChain *pSwapChain,
 
     m_DepthHistoryBuffer.Init(m_pDevice, "Depth History", &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT, m_ReflectionWidth, m_ReflectionHeight, 1, 1, 1, 0),
                               D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, nullptr);
+    m_gbufferHistory.Reset();
     m_Viewport           = {0.0f, 0.0f, static_cast<float>(m_Width), static_cast<float>(m_Height), 0.0f, 1.0f};
     m_ReflectionViewport = {0.0f, 0.0f, static_cast<float>(m_ReflectionWidth), static_cast<float>(m_ReflectionHeight), 0.0f, 1.0f};
 
@@ -349,11 +408,16 @@ void SampleRenderer::OnCreateWindowSizeDependentResources(SwapChain *pSwapChain,
     }
 
     HSRCreationInfo sssr_input_textures;
-    sssr_input_textures.inputHeight  = m_Height;
-    sssr_input_textures.inputWidth   = m_Width;
-    sssr_input_textures.outputWidth  = m_ReflectionWidth;
-    sssr_input_textures.outputHeight = m_ReflectionHeight;
+    sssr_input_textures.inputHeight       = m_Height;
+    sssr_input_textures.inputWidth        = m_Width;
+    sssr_input_textures.outputWidth       = m_ReflectionWidth;
+    sssr_input_textures.outputHeight      = m_ReflectionHeight;
+    sssr_input_textures.compactRayGbuffer = pState->bCompactRayGbuffer;
+    sssr_input_textures.materialBinning   = pState->bMaterialBinning;
+    sssr_input_textures.packedRadiance    = pState->bPackedRadiance;
+    sssr_input_textures.convergedTiles    = pState->bConvergedTiles;
     m_hsr.OnCreateWindowSizeDependentResources(sssr_input_textures);
+    m_hsr.PrewarmPSOs(pState->psoPrewarmMasks);
 }
 
 //--------------------------------------------------------------------------------------
@@ -377,10 +441,12 @@ void SampleRenderer::OnDestroyWindowSizeDependentResources() {
 
     m_taa.OnDestroyWindowSizeDependentResources();
     m_Magnifier.OnDestroyWindowSizeDependentResources();
-    m_ReflectionUAVGbuffer.Depth.OnDestroy();
+    for (int i = 0; i < 2; i++) {
+        m_ReflectionUAVGbuffer.Depth[i].OnDestroy();
+        m_ReflectionUAVGbuffer.Normals[i].OnDestroy();
+    }
     m_ReflectionUAVGbuffer.Albedo.OnDestroy();
     m_ReflectionUAVGbuffer.MotionVectors.OnDestroy();
-    m_ReflectionUAVGbuffer.Normals.OnDestroy();
     m_ReflectionUAVGbuffer.SpecularRoughness.OnDestroy();
 }
 
@@ -420,7 +486,7 @@ int SampleRenderer::LoadScene(GLTFCommon *pGLTFCommon, int stage) {
             Profile p("m_gltfDepth->OnCreate");
 
             // create the glTF's textures, VBs, IBs, shaders and descriptors for this particular pass
-            m_gltfDepth = new GltfDepthPass();
+            m_gltfDepth = new GltfShadowDepthPass();
             m_gltfDepth->OnCreate(m_pDevice, &m_UploadHeap, &m_ResourceViewHeaps, &m_ConstantBufferRing, &m_VidMemBufferPool, m_pGLTFTexturesAndBuffers, pAsyncPool);
         }
 
@@ -454,13 +520,9 @@ int SampleRenderer::LoadScene(GLTFCommon *pGLTFCommon, int stage) {
         m_gltfPBR->InitializeAccelerationStructures(GetCurrentUAVHeap());
 
         // Initialize static geometry buffers and textures
-        m_gltfPBR->BindMaterialResources(&m_globalDescriptorTables[0]);
-        m_gltfPBR->BindMaterialResources(&m_globalDescriptorTables[1]);
-        m_gltfPBR->BindMaterialResources(&m_globalDescriptorTables[2]);
+        for (CBV_SRV_UAV &table : m_globalDescriptorTables) m_gltfPBR->BindMaterialResources(&table);
 
-        m_AtmosphereRenderer.Bind(&m_globalDescriptorTables[0]);
-        m_AtmosphereRenderer.Bind(&m_globalDescriptorTables[1]);
-        m_AtmosphereRenderer.Bind(&m_globalDescriptorTables[2]);
+        for (CBV_SRV_UAV &table : m_globalDescriptorTables) m_AtmosphereRenderer.Bind(&table);
 
         m_ready = true;
         // tell caller that we are done loading the map
@@ -484,6 +546,9 @@ void SampleRenderer::UnloadScene() {
         m_gltfPBR = NULL;
     }
 
+    // Forget the casters of the old scene
+    m_shadowCache.Invalidate();
+
     if (m_gltfDepth) {
         m_gltfDepth->OnDestroy();
         delete m_gltfDepth;
@@ -618,19 +683,47 @@ per_frame *SampleRenderer::FillFrameConstants(State *pState) {
             }
         }
 
-        uint32_t shadowMapIndex = 0;
+        // Size the shadow tiles by how much of the screen each light can reach and how bright it is against the other
+        // spots, the sun always asks for the largest tile.
+        float maxSpotIntensity = 0.0f;
+        for (uint32_t i = 0; i < pPerFrame->lightCount; i++)
+            if (pPerFrame->lights[i].type == LightType_Spot) maxSpotIntensity = std::max(maxSpotIntensity, pPerFrame->lights[i].intensity);
+
+        Vectormath::Vector4 const         cameraPosition = pState->camera.GetPosition();
+        float const                       tanHalfFovY    = tanf(pState->camera.GetFovV() * 0.5f);
+        float const                       aspect         = float(m_Width) / float(std::max(m_Height, 1u));
+        std::vector<ShadowAtlas::Request> shadowRequests;
+        for (uint32_t i = 0; i < pPerFrame->lightCount; i++) {
+            Light const &light = pPerFrame->lights[i];
+            if (light.type == LightType_Directional) {
+                shadowRequests.push_back({i, 1.0f, 1.0f});
+            } else if (light.type == LightType_Spot) {
+                float dx         = light.position[0] - cameraPosition.getX();
+                float dy         = light.position[1] - cameraPosition.getY();
+                float dz         = light.position[2] - cameraPosition.getZ();
+                float coverage   = light.range > 0.0f ? EstimateShadowScreenCoverage(sqrtf(dx * dx + dy * dy + dz * dz), light.range, tanHalfFovY, aspect) : 1.0f;
+                float importance = maxSpotIntensity > 0.0f ? std::max(light.intensity / maxSpotIntensity, 0.25f) : 1.0f;
+                shadowRequests.push_back({i, coverage, importance});
+            }
+        }
+        m_shadowAtlas.Update(shadowRequests.data(), shadowRequests.size());
+
         for (uint32_t i = 0; i < pPerFrame->lightCount; i++) {
+            // Where the color pass finds the light's shadow map, see ShadowAtlasTile.h
+            ShadowAtlas::Tile const *pTile      = m_shadowAtlas.Find(i);
+            pPerFrame->lights[i].shadowMapIndex = pTile ? pTile->Pack() : -1;
             if ((pPerFrame->lights[i].type == LightType_Spot)) {
-                pPerFrame->lights[i].shadowMapIndex = shadowMapIndex++; // set the shadowmap index so the color pass knows which shadow map to use
-                pPerFrame->lights[i].depthBias      = 20.0f / 100000.0f;
+                pPerFrame->lights[i].depthBias = 20.0f / 100000.0f;
             } else if ((pPerFrame->lights[i].type == LightType_Directional)) {
-                pPerFrame->lights[i].shadowMapIndex = shadowMapIndex++; // same as above
-                pPerFrame->lights[i].depthBias      = 1.0f / 100000.0f;
-            } else {
-                pPerFrame->lights[i].shadowMapIndex = -1; // no shadow for this light
+                pPerFrame->lights[i].depthBias = 1.0f / 100000.0f;
             }
         }
 
+        UpdateShadowCasters(pPerFrame, pState);
+        UpdateLightGrid(pPerFrame, pState);
+        UpdateClusteredLights(pPerFrame, pState);
+        UpdateLightList(pPerFrame, pState);
+
         m_pGLTFTexturesAndBuffers->SetPerFrameConstants();
 
         m_pGLTFTexturesAndBuffers->SetSkinningMatricesForSkeletons();
@@ -639,21 +732,205 @@ per_frame *SampleRenderer::FillFrameConstants(State *pState) {
     return pPerFrame;
 }
 
-void SampleRenderer::RenderSpotLights(ID3D12GraphicsCommandList *pCmdLst1, per_frame *pPerFrame) {
-    UserMarker marker(pCmdLst1, "Shadow Map");
+// Row major copy of a column major matrix, clip = out * (x, y, z, 1).
+static void ToRowMajor(math::Matrix4 const &m, float out[16]) {
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++) out[row * 4 + col] = m.getElem(col, row);
+}
+
+// World space box around a primitive's object space box.
+static void GetWorldBounds(math::Matrix4 const &world, math::Vector4 const &center, math::Vector4 const &radius, float boundsMin[3], float boundsMax[3]) {
+    math::Vector4 const c = world * center;
+    for (int axis = 0; axis < 3; axis++) {
+        float extent = 0.0f;
+        for (int j = 0; j < 3; j++) extent += fabsf(world.getElem(j, axis)) * radius.getElem(j);
+        boundsMin[axis] = c.getElem(axis) - extent;
+        boundsMax[axis] = c.getElem(axis) + extent;
+    }
+}
+
+void SampleRenderer::UpdateShadowCasters(per_frame *pPerFrame, State *pState) {
+    // Nothing gets rendered without the depth pass, so nothing can be kept either.
+    if (!m_gltfDepth || !pState->bCacheShadowMaps) m_shadowCache.Invalidate();
+    m_shadowCasterLists.clear();
+    if (!m_gltfDepth) return;
 
+    std::vector<ShadowCache::Light> lights;
     for (uint32_t i = 0; i < pPerFrame->lightCount; i++) {
         if (pPerFrame->lights[i].type == LightType_Point || pPerFrame->lights[i].shadowMapIndex < 0) continue;
-        // Set the RT's quadrant where to render the shadomap (these viewport offsets need to match the ones in shadowFiltering.h)
-        uint32_t viewportWidth  = m_shadowmaps[pPerFrame->lights[i].shadowMapIndex].m_ShadowMap.GetWidth();
-        uint32_t viewportHeight = m_shadowmaps[pPerFrame->lights[i].shadowMapIndex].m_ShadowMap.GetHeight();
-        SetViewportAndScissor(pCmdLst1, 0, 0, viewportWidth, viewportHeight);
-        pCmdLst1->OMSetRenderTargets(0, NULL, false, &m_shadowmaps[i].m_ShadowMapDSV.GetCPU());
+        ShadowCache::Light light;
+        light.id   = i;
+        light.tile = pPerFrame->lights[i].shadowMapIndex;
+        ToRowMajor(pPerFrame->lights[i].mLightViewProj, light.viewProj);
+        lights.push_back(light);
+    }
+
+    // Skinned meshes move without their node moving, they count as moved whenever the animation advanced.
+    bool const                       animationAdvanced = pState->time != m_shadowCacheTime;
+    GLTFCommon *                     pGLTFCommon       = m_pGLTFTexturesAndBuffers->m_pGLTFCommon;
+    std::vector<ShadowCache::Caster> casters;
+    uint32_t                         casterId = 0;
+    m_shadowCullBoxes.Clear();
+    // The ids are the caster indices of the depth pass, the lists below go straight to its DrawCasters
+    for (GltfShadowDepthPass::Caster const &depthCaster : m_gltfDepth->GetCasters()) {
+        tfNode &            node      = pGLTFCommon->m_nodes[depthCaster.node];
+        tfPrimitives const &primitive = pGLTFCommon->m_meshes[node.meshIndex].m_pPrimitives[depthCaster.primitive];
+        ShadowCache::Caster caster;
+        caster.id       = casterId++;
+        caster.animated = node.skinIndex >= 0 && animationAdvanced;
+        GetWorldBounds(pGLTFCommon->m_worldSpaceMats[depthCaster.node].GetCurrent(), primitive.m_center, primitive.m_radius, caster.boundsMin, caster.boundsMax);
+        casters.push_back(caster);
+        m_shadowCullBoxes.Add(caster.boundsMin, caster.boundsMax);
+    }
+    m_shadowCacheTime = pState->time;
+
+    m_shadowCache.Update(lights.data(), lights.size(), casters.data(), casters.size());
+    pState->shadowMapsRendered = uint32_t(m_shadowCache.GetDirty().size());
+    pState->shadowMapsCached   = m_shadowCache.GetCached();
+
+    // The casters in the frustum of each light that gets rendered, the lights are split over threads
+    std::vector<float> viewProjs;
+    for (ShadowCache::Light const &light : lights)
+        if (m_shadowCache.IsDirty(light.id)) viewProjs.insert(viewProjs.end(), light.viewProj, light.viewProj + 16);
+    std::vector<std::vector<uint32_t>> visible;
+    CullShadowCastersForLights(m_shadowCullBoxes, viewProjs.data(), uint32_t(viewProjs.size() / 16), visible);
+
+    m_shadowCasterLists.resize(pPerFrame->lightCount);
+    pState->shadowCastersDrawn = 0;
+    pState->shadowCastersScene = casterId;
+    size_t rendered            = 0;
+    for (ShadowCache::Light const &light : lights) {
+        if (!m_shadowCache.IsDirty(light.id)) continue;
+        pState->shadowCastersDrawn += uint32_t(visible[rendered].size());
+        m_shadowCasterLists[light.id].swap(visible[rendered++]);
+    }
+}
+
+// What the light grid and the clustered lights need to know of the lights of the frame.
+static void GetInfluenceVolumes(per_frame const *pPerFrame, std::vector<LightGridBuilder::Light> &lights) {
+    lights.resize(pPerFrame->lightCount);
+    for (uint32_t i = 0; i < pPerFrame->lightCount; i++) {
+        Light const &light = pPerFrame->lights[i];
+        for (int axis = 0; axis < 3; axis++) {
+            lights[i].position[axis]  = light.position[axis];
+            lights[i].direction[axis] = light.direction[axis];
+        }
+        lights[i].range        = light.range;
+        lights[i].outerConeCos = light.outerConeCos;
+        lights[i].type         = light.type;
+    }
+}
+
+void SampleRenderer::UpdateLightGrid(per_frame *pPerFrame, State *pState) {
+    std::vector<LightGridBuilder::Light> lights;
+    GetInfluenceVolumes(pPerFrame, lights);
+    m_lightGrid.Build(lights.data(), uint32_t(lights.size()), pState->bLightGrid);
+    pState->lightGridStats = m_lightGrid.GetStats();
+}
+
+void SampleRenderer::UploadLightGrid(ID3D12GraphicsCommandList *pCmdLst1) {
+    std::vector<uint32_t> const &words  = m_lightGrid.GetWords();
+    UINT64 const                 offset = UINT64(m_lightGridUploadSlot) * LIGHT_GRID_MAX_WORDS * 4;
+    memcpy(m_pLightGridUploadMap + m_lightGridUploadSlot * LIGHT_GRID_MAX_WORDS, words.data(), words.size() * 4);
+    m_lightGridUploadSlot = (m_lightGridUploadSlot + 1) % backBufferCount;
+
+    UserMarker marker(pCmdLst1, "Upload Light Grid");
+    Barriers(pCmdLst1, {CD3DX12_RESOURCE_BARRIER::Transition(m_lightGridBuffer.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST)});
+    pCmdLst1->CopyBufferRegion(m_lightGridBuffer.GetResource(), 0, m_pLightGridUpload, offset, words.size() * 4);
+    Barriers(pCmdLst1, {CD3DX12_RESOURCE_BARRIER::Transition(m_lightGridBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)});
+}
+
+void SampleRenderer::UpdateClusteredLights(per_frame *pPerFrame, State *pState) {
+    std::vector<ClusteredLightsBuilder::Light> lights;
+    GetInfluenceVolumes(pPerFrame, lights);
+
+    // The camera looks along -GetDirection(), the rows of its view matrix are its right and up vectors.
+    ClusteredLightsBuilder::View view;
+    Vectormath::Vector4 const    eye     = pState->camera.GetPosition();
+    Vectormath::Vector4 const    right   = pState->camera.GetView().getRow(0);
+    Vectormath::Vector4 const    up      = pState->camera.GetView().getRow(1);
+    Vectormath::Vector4 const    forward = -pState->camera.GetDirection();
+    for (int axis = 0; axis < 3; axis++) {
+        view.eye[axis]     = eye.getElem(axis);
+        view.right[axis]   = right.getElem(axis);
+        view.up[axis]      = up.getElem(axis);
+        view.forward[axis] = forward.getElem(axis);
+    }
+    view.tanHalfFovY = tanf(pState->camera.GetFovV() * 0.5f);
+    view.tanHalfFovX = view.tanHalfFovY * float(m_Width) / float(std::max(m_Height, 1u));
+
+    m_clusteredLights.Build(lights.data(), uint32_t(lights.size()), view, ClusteredLightsBuilder::Config(), pState->bClusteredLights);
+    pState->clusteredLightsStats = m_clusteredLights.GetStats();
+}
+
+void SampleRenderer::UploadClusteredLights(ID3D12GraphicsCommandList *pCmdLst1) {
+    std::vector<uint32_t> const &words  = m_clusteredLights.GetWords();
+    UINT64 const                 offset = UINT64(m_clusteredLightsUploadSlot) * CLUSTERED_LIGHTS_MAX_WORDS * 4;
+    memcpy(m_pClusteredLightsUploadMap + m_clusteredLightsUploadSlot * CLUSTERED_LIGHTS_MAX_WORDS, words.data(), words.size() * 4);
+    m_clusteredLightsUploadSlot = (m_clusteredLightsUploadSlot + 1) % backBufferCount;
+
+    UserMarker marker(pCmdLst1, "Upload Clustered Lights");
+    Barriers(pCmdLst1,
+             {CD3DX12_RESOURCE_BARRIER::Transition(m_clusteredLightsBuffer.GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST)});
+    pCmdLst1->CopyBufferRegion(m_clusteredLightsBuffer.GetResource(), 0, m_pClusteredLightsUpload, offset, words.size() * 4);
+    Barriers(pCmdLst1,
+             {CD3DX12_RESOURCE_BARRIER::Transition(m_clusteredLightsBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)});
+}
+
+void SampleRenderer::UpdateLightList(per_frame *pPerFrame, State *pState) {
+    static_assert(sizeof(Vectormath::Matrix4) == sizeof(LightListBuilder::Light::viewProj), "mLightViewProj is copied as is");
+    std::vector<LightListBuilder::Light> lights(pPerFrame->lightCount);
+    for (uint32_t i = 0; i < pPerFrame->lightCount; i++) {
+        Light const &light = pPerFrame->lights[i];
+        memcpy(lights[i].viewProj, &light.mLightViewProj, sizeof(lights[i].viewProj));
+        for (int axis = 0; axis < 3; axis++) {
+            lights[i].direction[axis] = light.direction[axis];
+            lights[i].color[axis]     = light.color[axis];
+            lights[i].position[axis]  = light.position[axis];
+        }
+        lights[i].range          = light.range;
+        lights[i].intensity      = light.intensity;
+        lights[i].innerConeCos   = light.innerConeCos;
+        lights[i].outerConeCos   = light.outerConeCos;
+        lights[i].type           = light.type;
+        lights[i].depthBias      = light.depthBias;
+        lights[i].shadowMapIndex = light.shadowMapIndex;
+    }
+    m_lightList.Build(lights.data(), uint32_t(lights.size()));
+    pState->lightListStats = m_lightList.GetStats();
+}
 
-        per_frame *cbDepthPerFrame           = m_gltfDepth->SetPerFrameConstants();
-        cbDepthPerFrame->mCameraCurrViewProj = pPerFrame->lights[i].mLightViewProj;
+void SampleRenderer::UploadLightList(ID3D12GraphicsCommandList *pCmdLst1) {
+    // The buffer still holds the lights, see LightListBuilder::Build
+    if (!m_lightList.GetDirtyCount()) return;
+    size_t const first = size_t(m_lightList.GetDirtyFirst()) * LIGHT_LIST_LIGHT_WORDS;
+    size_t const words = size_t(m_lightList.GetDirtyCount()) * LIGHT_LIST_LIGHT_WORDS;
+    size_t const slot  = size_t(m_lightListUploadSlot) * LIGHT_LIST_MAX_LIGHTS * LIGHT_LIST_LIGHT_WORDS;
+    memcpy(m_pLightListUploadMap + slot + first, m_lightList.GetWords().data() + first, words * 4);
+    m_lightListUploadSlot = (m_lightListUploadSlot + 1) % backBufferCount;
+
+    UserMarker marker(pCmdLst1, "Upload Light List");
+    Barriers(pCmdLst1, {CD3DX12_RESOURCE_BARRIER::Transition(m_lightListBuffer.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST)});
+    pCmdLst1->CopyBufferRegion(m_lightListBuffer.GetResource(), first * 4, m_pLightListUpload, (slot + first) * 4, words * 4);
+    Barriers(pCmdLst1, {CD3DX12_RESOURCE_BARRIER::Transition(m_lightListBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)});
+}
 
-        m_gltfDepth->Draw(pCmdLst1);
+void SampleRenderer::RenderSpotLights(ID3D12GraphicsCommandList *pCmdLst1, per_frame *pPerFrame) {
+    UserMarker marker(pCmdLst1, "Shadow Map");
+
+    for (uint32_t i = 0; i < pPerFrame->lightCount; i++) {
+        if (pPerFrame->lights[i].type == LightType_Point || pPerFrame->lights[i].shadowMapIndex < 0) continue;
+        // The tile still holds what the light sees, see UpdateShadowCasters
+        if (!m_shadowCache.IsDirty(i)) continue;
+        // Nothing in the frustum, the cleared tile is all there is to it
+        if (i >= m_shadowCasterLists.size() || m_shadowCasterLists[i].empty()) continue;
+        // Render into the light's tile of the atlas, shadowFiltering.h finds it from the packed shadowMapIndex
+        ShadowAtlas::Tile const *pTile = m_shadowAtlas.Find(i);
+        SetViewportAndScissor(pCmdLst1, pTile->x, pTile->y, pTile->size, pTile->size);
+        pCmdLst1->OMSetRenderTargets(0, NULL, false, &m_ShadowAtlasDSV.GetCPU());
+
+        // Only the casters in the light's frustum
+        m_gltfDepth->DrawCasters(pCmdLst1, pPerFrame->lights[i].mLightViewProj, m_shadowCasterLists[i]);
 
         m_GPUTimer.GetTimeStamp(pCmdLst1, "Shadow Map");
     }
@@ -674,10 +951,39 @@ void SampleRenderer::RenderLightFrustums(ID3D12GraphicsCommandList *pCmdLst1, pe
     m_GPUTimer.GetTimeStamp(pCmdLst1, "Light frustums");
 }
 
+void SampleRenderer::TransitionReflectionUAVGbuffer(ID3D12GraphicsCommandList *pCmdLst1, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after) {
+    HistoryPingPong::Surface const write     = m_gbufferHistory.GetWrite();
+    uint32_t const                 slot      = HistoryPingPong::IsSlot(write) ? write : 0;
+    ID3D12Resource *               targets[] = {m_ReflectionUAVGbuffer.Depth[slot].GetResource(), m_ReflectionUAVGbuffer.Normals[slot].GetResource(),
+                                  m_ReflectionUAVGbuffer.SpecularRoughness.GetResource(), m_ReflectionUAVGbuffer.Albedo.GetResource(),
+                                  m_ReflectionUAVGbuffer.MotionVectors.GetResource()};
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    for (ID3D12Resource *pTarget : targets) barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pTarget, before, after));
+    Barriers(pCmdLst1, barriers);
+}
+
+void SampleRenderer::ReconstructReflectionGBuffer(ID3D12GraphicsCommandList *pCmdLst1, State *pState) {
+    UserMarker marker(pCmdLst1, "Reconstruct Reflection GBuffer");
+    // The targets rest in COMMON between frames like the ones of the optimized downsample, they stay readable until
+    // the reflections are done.
+    TransitionReflectionUAVGbuffer(pCmdLst1, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    ID3D12DescriptorHeap *descriptorHeaps[] = {m_ResourceViewHeaps.GetCBV_SRV_UAVHeap(), m_ResourceViewHeaps.GetSamplerHeap()};
+    pCmdLst1->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+    pCmdLst1->SetComputeRootSignature(m_pGlobalRootSignature);
+    pCmdLst1->SetComputeRootDescriptorTable(1, GetCurrentSamplerHeap()->GetGPU());
+    pCmdLst1->SetComputeRootDescriptorTable(0, GetCurrentUAVHeap()->GetGPU());
+    m_ReflectionGbufferRenderer.Reconstruct(pCmdLst1, m_ReflectionWidth, m_ReflectionHeight, pState->reflectionGbufferFootprint);
+    TransitionReflectionUAVGbuffer(pCmdLst1, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    m_GPUTimer.GetTimeStamp(pCmdLst1, "Reconstruct Reflection GBuffer");
+}
+
 void SampleRenderer::DownsampleDepthBuffer(ID3D12GraphicsCommandList *pCmdLst1, State *pState) {
-    UserMarker marker(pCmdLst1, "Downsample Depth");
+    UserMarker                     marker(pCmdLst1, "Downsample Depth");
+    HistoryPingPong::Surface const write = m_gbufferHistory.GetWrite();
     if (pState->bOptimizedDownsample || pState->m_ReflectionResolutionMultiplier == 1.0f)
         m_GBuffer.m_DepthBuffer.CreateSRV(0, &m_DepthBufferDescriptor);
+    else if (HistoryPingPong::IsSlot(write)) // Reconstructed
+        m_ReflectionUAVGbuffer.Depth[write].CreateSRV(0, &m_DepthBufferDescriptor);
     else
         m_ReflectionGBuffer.m_DepthBuffer.CreateSRV(0, &m_DepthBufferDescriptor);
 
@@ -697,27 +1003,62 @@ void SampleRenderer::DownsampleDepthBuffer(ID3D12GraphicsCommandList *pCmdLst1,
 }
 
 void SampleRenderer::RenderScreenSpaceReflections(ID3D12GraphicsCommandList *pCmdLst1, per_frame *pPerFrame, State *pState) {
-    HSR::ReflectionGBuffer rgbuffer{};
-    rgbuffer.pDepth             = &m_ReflectionUAVGbuffer.Depth;
+    HistoryPingPong::Surface const write   = m_gbufferHistory.GetWrite();
+    HistoryPingPong::Surface const history = m_gbufferHistory.GetHistory();
+    uint32_t const                 slot    = HistoryPingPong::IsSlot(write) ? write : 0;
+    HSR::ReflectionGBuffer         rgbuffer{};
+    rgbuffer.pDepth             = &m_ReflectionUAVGbuffer.Depth[slot];
     rgbuffer.pAlbedo            = &m_ReflectionUAVGbuffer.Albedo;
     rgbuffer.pMotionVectors     = &m_ReflectionUAVGbuffer.MotionVectors;
-    rgbuffer.pNormals           = &m_ReflectionUAVGbuffer.Normals;
+    rgbuffer.pNormals           = &m_ReflectionUAVGbuffer.Normals[slot];
     rgbuffer.pSpecularRoughness = &m_ReflectionUAVGbuffer.SpecularRoughness;
+    if (HistoryPingPong::IsSlot(history)) {
+        rgbuffer.pDepthHistory   = &m_ReflectionUAVGbuffer.Depth[history];
+        rgbuffer.pNormalsHistory = &m_ReflectionUAVGbuffer.Normals[history];
+    }
+    if (pState->rayHitsCaptureName.size()) {
+        m_hsr.CaptureRayHits(pState->rayHitsCaptureName);
+        pState->rayHitsCaptureName = "";
+    }
+    if (pState->denoiserCaptureName.size()) {
+        m_hsr.CaptureDenoiser(pState->denoiserCaptureName);
+        pState->denoiserCaptureName = "";
+    }
+    if (pState->barrierCaptureName.size()) {
+        m_hsr.CaptureBarriers(pState->barrierCaptureName);
+        pState->barrierCaptureName = "";
+    }
+    if (pState->gbufferCaptureName.size()) {
+        if (pState->bOptimizedDownsample) {
+            Trace("The optimized downsample writes the reflection G-buffer inside HSR, turn it off to capture the G-buffers\n");
+        } else {
+            ID3D12DescriptorHeap *descriptorHeaps[] = {m_ResourceViewHeaps.GetCBV_SRV_UAVHeap(), m_ResourceViewHeaps.GetSamplerHeap()};
+            pCmdLst1->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+            pCmdLst1->SetComputeRootSignature(m_pGlobalRootSignature);
+            pCmdLst1->SetComputeRootDescriptorTable(1, GetCurrentSamplerHeap()->GetGPU());
+            pCmdLst1->SetComputeRootDescriptorTable(0, GetCurrentUAVHeap()->GetGPU());
+            uint32_t source = HistoryPingPong::IsSlot(write) ? REFLECTION_GBUFFER_SOURCE_RECONSTRUCT : REFLECTION_GBUFFER_SOURCE_RASTER;
+            m_ReflectionGbufferRenderer.Capture(pCmdLst1, GetCurrentUAVHeap(), pState->gbufferCaptureName, m_Width, m_Height, m_ReflectionWidth, m_ReflectionHeight, source,
+                                                pState->reflectionGbufferFootprint);
+        }
+        pState->gbufferCaptureName = "";
+    }
     m_hsr.Draw(pCmdLst1, &m_GBuffer.m_HDR, &rgbuffer, GetCurrentUAVHeap(), GetCurrentSamplerHeap(), pState);
     for (int i = 0; i < (int)HSRTimestampQuery::TIMESTAMP_QUERY_COUNT; i++) {
-        pState->hsr_timestamps[i] += (1000000.0 * static_cast<double>(m_hsr.GetTimestamp(i)) / m_GpuTicksPerSecond - pState->hsr_timestamps[i]) * 0.5;
+        pState->hsr_timestamps_last[i] = m_hsr.GetTimestamp(i);
+        pState->hsr_timestamps[i] += (pState->hsr_timestamps_last[i] - pState->hsr_timestamps[i]) * 0.5;
     }
+    pState->hsr_total_time_last = m_hsr.GetTotalTime();
 
     m_GPUTimer.GetTimeStamp(pCmdLst1, "Hybrid Reflections");
 }
 
 void SampleRenderer::CopyHistorySurfaces(ID3D12GraphicsCommandList *pCmdLst1, State *pState) {
     UserMarker marker(pCmdLst1, "Copy History Normals and Roughness");
-    // Keep copy of normal roughness buffer for next frame
-    if (pState->bOptimizedDownsample) {
-        CopyToTexture(pCmdLst1, m_ReflectionUAVGbuffer.Depth.GetResource(), m_DepthHistoryBuffer.GetResource(), m_ReflectionWidth, m_ReflectionHeight);
-        CopyToTexture(pCmdLst1, m_ReflectionUAVGbuffer.Normals.GetResource(), m_NormalHistoryBuffer.GetResource(), m_ReflectionWidth, m_ReflectionHeight);
-    } else {
+    // Keep copy of normal roughness buffer for next frame, the optimized downsample and the reconstruction leave their slot
+    // to the next frame instead. The rasterized G-buffers are Cauldron's: the render resolution one is TAA's input and the
+    // history of either would rest as a render target, which HSR does not expect of the history it reads.
+    if (m_gbufferHistory.GetWrite() == HistoryPingPong::HISTORY_SURFACE_COPY) {
         if (pState->m_ReflectionResolutionMultiplier != 1.0f) {
             CopyToTexture(pCmdLst1, m_ReflectionGBuffer.m_DepthBuffer.GetResource(), m_DepthHistoryBuffer.GetResource(), m_ReflectionWidth, m_ReflectionHeight);
             CopyToTexture(pCmdLst1, m_ReflectionGBuffer.m_NormalBuffer.GetResource(), m_NormalHistoryBuffer.GetResource(), m_ReflectionWidth, m_ReflectionHeight);
@@ -727,6 +1068,8 @@ void SampleRenderer::CopyHistorySurfaces(ID3D12GraphicsCommandList *pCmdLst1, St
         }
     }
 
+    // The lit scene history is the scene before the bloom composites into m_HDR, so it is a snapshot rather than a slot
+    // to alternate with. m_HDR itself stays put, TAA, the downsample, the bloom and the magnifier hold on to it.
     CopyToTexture(pCmdLst1, m_GBuffer.m_HDR.GetResource(), m_PrevHDR.GetResource(), m_Width, m_Height);
 }
 
@@ -786,6 +1129,14 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
     StallFrame(pState->targetFrametime);
     BeginFrame();
 
+    m_RetiredPSOs.OnBeginFrame();
+    m_ReflectionGbufferRenderer.WriteCapture();
+    // Polling the shader sources every half a second or so is cheap enough to leave on.
+    if (m_frameID % 30 == 0) {
+        std::vector<std::string> changed = m_ShaderWatcher.Poll();
+        if (!changed.empty()) ReloadShaders(std::set<std::string>(changed.begin(), changed.end()));
+    }
+
     per_frame *pPerFrame = FillFrameConstants(pState);
 
     // command buffer calls
@@ -807,9 +1158,8 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
         if (pCommandList5) {
             m_gltfPBR->UpdateAccelerationStructures(pCommandList5, GetCurrentUAVHeap());
         }
-        for (uint32_t i = 0; i < 32; i++) {
-            m_shadowmaps[i].m_ShadowMap.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT + i, GetCurrentUAVHeap());
-        }
+        // The atlas takes the first slot of the shadow map range
+        m_ShadowAtlasTexture.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT, GetCurrentUAVHeap());
         m_GPUTimer.GetTimeStamp(pCmdLst1, "UpdateAccelerationStructures");
     }
 
@@ -890,7 +1240,9 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
             pState->frameInfo.inv_view_proj  = Vectormath::transpose(pPerFrame->mInverseCameraCurrViewProj);
             pState->frameInfo.prev_view_proj = Vectormath::transpose(pPerFrame->mCameraPrevViewProj);
             pState->frameInfo.prev_view      = Vectormath::transpose(prev_view);
-            memcpy(&pState->frameInfo.perFrame, pPerFrame, sizeof(*pPerFrame));
+            // Everything but the lights, they go to their own buffer, see UpdateLightList
+            static_assert(sizeof(pState->frameInfo.perFrame) == offsetof(per_frame, lights), "PerFrame of Declarations.h is per_frame up to the lights");
+            memcpy(&pState->frameInfo.perFrame, pPerFrame, sizeof(pState->frameInfo.perFrame));
         }
         pState->frameInfo.frame_index                              = m_frame_index;
         pState->frameInfo.simulation_time                          = pState->bUpdateSimulation ? pState->time : pState->frameInfo.simulation_time;
@@ -908,22 +1260,31 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
         pState->frameInfo.y_to_v_factor = 1.0f / float(height8);
     }
     D3D12_GPU_VIRTUAL_ADDRESS frame_info_cb = m_ConstantBufferRing.AllocConstantBuffer(sizeof(pState->frameInfo), &pState->frameInfo);
+
+    // The reflection G-buffer history is only written by frames that draw reflections, see below.
+    if (m_gltfPBR && pPerFrame != NULL)
+        m_gbufferHistory.BeginFrame(pState->bOptimizedDownsample || ReconstructsReflectionGBuffer(pState));
+    else
+        m_gbufferHistory.Reset();
     {
+        HistoryPingPong::Surface const write   = m_gbufferHistory.GetWrite();
+        HistoryPingPong::Surface const history = m_gbufferHistory.GetHistory();
+        uint32_t const                 slot    = HistoryPingPong::IsSlot(write) ? write : 0;
 
         m_GBuffer.m_HDR.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_LIT_SCREEN_SLOT, GetCurrentUAVHeap());
         m_GBuffer.m_HDR.CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_FULL_LIT_SCENE_SLOT, GetCurrentUAVHeap());
 
         m_DepthHierarchy.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_HIZ_SLOT, GetCurrentUAVHeap());
-        if (pState->bOptimizedDownsample) {
-            m_ReflectionUAVGbuffer.Depth.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_DEPTH_SLOT, GetCurrentUAVHeap());
+        if (pState->bOptimizedDownsample || ReconstructsReflectionGBuffer(pState)) {
+            m_ReflectionUAVGbuffer.Depth[slot].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_DEPTH_SLOT, GetCurrentUAVHeap());
             m_ReflectionUAVGbuffer.Albedo.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_ALBEDO_SLOT, GetCurrentUAVHeap());
             m_ReflectionUAVGbuffer.SpecularRoughness.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_ROUGHNESS_SLOT, GetCurrentUAVHeap());
-            m_ReflectionUAVGbuffer.Normals.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_NORMAL_SLOT, GetCurrentUAVHeap());
+            m_ReflectionUAVGbuffer.Normals[slot].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_NORMAL_SLOT, GetCurrentUAVHeap());
             m_ReflectionUAVGbuffer.MotionVectors.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_MOTION_VECTOR_SLOT, GetCurrentUAVHeap());
-            m_ReflectionUAVGbuffer.Depth.CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_GBUFFER_DEPTH_SLOT, GetCurrentUAVHeap());
+            m_ReflectionUAVGbuffer.Depth[slot].CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_GBUFFER_DEPTH_SLOT, GetCurrentUAVHeap());
             m_ReflectionUAVGbuffer.Albedo.CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_GBUFFER_ALBEDO_SLOT, GetCurrentUAVHeap());
             m_ReflectionUAVGbuffer.SpecularRoughness.CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_GBUFFER_ROUGHNESS_SLOT, GetCurrentUAVHeap());
-            m_ReflectionUAVGbuffer.Normals.CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_GBUFFER_NORMAL_SLOT, GetCurrentUAVHeap());
+            m_ReflectionUAVGbuffer.Normals[slot].CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_GBUFFER_NORMAL_SLOT, GetCurrentUAVHeap());
             m_ReflectionUAVGbuffer.MotionVectors.CreateUAV(GDT_RW_TEXTURES_HEAP_OFFSET + GDT_RW_TEXTURES_MOTION_VECTOR_SLOT, GetCurrentUAVHeap());
         } else {
             if (pState->m_ReflectionResolutionMultiplier != 1.0f) {
@@ -945,10 +1306,17 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
         m_GBuffer.m_NormalBuffer.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_FULL_NORMAL_SLOT, GetCurrentUAVHeap());
         m_GBuffer.m_Diffuse.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_FULL_ALBEDO_SLOT, GetCurrentUAVHeap());
         m_GBuffer.m_MotionVectors.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_FULL_MOTION_VECTOR_SLOT, GetCurrentUAVHeap());
-        m_NormalHistoryBuffer.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_NORMAL_HISTORY_SLOT, GetCurrentUAVHeap());
+        if (HistoryPingPong::IsSlot(history)) {
+            m_ReflectionUAVGbuffer.Normals[history].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_NORMAL_HISTORY_SLOT, GetCurrentUAVHeap());
+            m_ReflectionUAVGbuffer.Depth[history].CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_DEPTH_HISTORY_SLOT, GetCurrentUAVHeap());
+        } else {
+            m_NormalHistoryBuffer.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_NORMAL_HISTORY_SLOT, GetCurrentUAVHeap());
+            m_DepthHistoryBuffer.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_DEPTH_HISTORY_SLOT, GetCurrentUAVHeap());
+        }
         m_PrevHDR.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_LIT_SCENE_HISTORY_SLOT, GetCurrentUAVHeap());
-        m_DepthHistoryBuffer.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_GBUFFER_DEPTH_HISTORY_SLOT, GetCurrentUAVHeap());
         m_downsampleCounter.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_DOWNSAMPLE_COUNTER_SLOT, NULL, GetCurrentUAVHeap());
+        m_lightGridBuffer.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_LIGHT_GRID_SLOT, NULL, GetCurrentUAVHeap());
+        m_lightListBuffer.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_LIGHTS_SLOT, NULL, GetCurrentUAVHeap());
         m_BrdfLut.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_BRDF_LUT_SLOT, GetCurrentUAVHeap());
         D3D12_CONSTANT_BUFFER_VIEW_DESC cbdesc{};
         cbdesc.BufferLocation = frame_info_cb;
@@ -956,6 +1324,19 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
         m_pDevice->GetDevice()->CreateConstantBufferView(&cbdesc, GetCurrentUAVHeap()->GetCPU(GDT_FRAME_INFO_HEAP_OFFSET));
     }
     m_DecalRenderer.Bind(GetCurrentUAVHeap());
+    // Read by the hit shading of the reflections, see RTShading.h, and the forward lighting, see GLTFPBRLighting.hlsl
+    if (pPerFrame) {
+        UploadLightGrid(pCmdLst1);
+        UploadClusteredLights(pCmdLst1);
+        UploadLightList(pCmdLst1);
+    }
+    if (pPerFrame && pState->bRenderDecals) {
+        float viewProj[16];
+        ToRowMajor(pPerFrame->mCameraCurrViewProj, viewProj);
+        m_DecalRenderer.Update(viewProj, m_Width, m_Height, pState->frameInfo.simulation_time);
+        m_DecalRenderer.Upload(pCmdLst1);
+        pState->decalStats = m_DecalRenderer.GetStats();
+    }
     if (pPerFrame) {
         UserMarker            marker(pCmdLst1, "Update Atmosphere");
         ID3D12DescriptorHeap *descriptorHeaps[] = {m_ResourceViewHeaps.GetCBV_SRV_UAVHeap(), m_ResourceViewHeaps.GetSamplerHeap()};
@@ -971,11 +1352,24 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
 
     // Clears -----------------------------------------------------------------------
     //
+    // The atlas rests in a shader resource state and only goes to DEPTH_WRITE on frames that clear or render a tile
+    ID3D12Resource *pShadowAtlas = m_ShadowAtlasTexture.GetResource();
+    m_shadowBarrierSink.SetCommandList(pCmdLst1);
+    m_shadowStates.BeginFrame();
+    m_shadowStates.SetDefaultState(pShadowAtlas, m_shadowAtlasState);
     {
         UserMarker marker(pCmdLst1, "Clear shadow maps");
         if (m_gltfDepth && pPerFrame != NULL) {
-            for (uint32_t i = 0; i < pPerFrame->lightCount; i++) {
-                pCmdLst1->ClearDepthStencilView(m_shadowmaps[i].m_ShadowMapDSV.GetCPU(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+            // Only the tiles rendered this frame, the others are kept
+            std::vector<D3D12_RECT> rects;
+            for (uint32_t id : m_shadowCache.GetDirty()) {
+                ShadowAtlas::Tile const *pTile = m_shadowAtlas.Find(id);
+                rects.push_back({LONG(pTile->x), LONG(pTile->y), LONG(pTile->x + pTile->size), LONG(pTile->y + pTile->size)});
+            }
+            if (!rects.empty()) {
+                m_shadowStates.Transition(pShadowAtlas, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+                m_shadowStates.Flush(m_shadowBarrierSink);
+                pCmdLst1->ClearDepthStencilView(m_ShadowAtlasDSV.GetCPU(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, UINT(rects.size()), rects.data());
             }
         }
         m_GPUTimer.GetTimeStamp(pCmdLst1, "Clear shadow map");
@@ -983,21 +1377,23 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
     {
         UserMarker marker(pCmdLst1, "Clear render targets");
         float      clearValuesFloat[] = {0.0f, 0.0f, 0.0f, 0.0f};
-        pCmdLst1->ClearRenderTargetView(m_ReflectionGBuffer.m_HDRRTV.GetCPU(), clearValuesFloat, 0, nullptr);
+        float      clearColor[]       = {0.0f, 0.0f, 0.0f, 0.0f};
+        float      clearColorOne[]    = {1.0f, 1.0f, 1.0f, 1.0f};
         pCmdLst1->ClearRenderTargetView(m_GBuffer.m_DiffuseRTV.GetCPU(), clearValuesFloat, 0, nullptr);
         pCmdLst1->ClearRenderTargetView(m_GBuffer.m_HDRRTV.GetCPU(), clearValuesFloat, 0, nullptr);
-        float clearColor[]    = {0.0f, 0.0f, 0.0f, 0.0f};
-        float clearColorOne[] = {1.0f, 1.0f, 1.0f, 1.0f};
-        pCmdLst1->ClearRenderTargetView(m_ReflectionGBuffer.m_SpecularRoughnessRTV.GetCPU(), clearColorOne, 0, nullptr);
         pCmdLst1->ClearRenderTargetView(m_GBuffer.m_MotionVectorsRTV.GetCPU(), clearColor, 0, nullptr);
         pCmdLst1->ClearRenderTargetView(m_GBuffer.m_NormalBufferRTV.GetCPU(), clearColor, 0, nullptr);
         pCmdLst1->ClearRenderTargetView(m_GBuffer.m_SpecularRoughnessRTV.GetCPU(), clearColorOne, 0, nullptr);
-        pCmdLst1->ClearRenderTargetView(m_ReflectionGBuffer.m_MotionVectorsRTV.GetCPU(), clearColor, 0, nullptr);
-        pCmdLst1->ClearRenderTargetView(m_ReflectionGBuffer.m_NormalBufferRTV.GetCPU(), clearColor, 0, nullptr);
+        if (m_rastersReflectionGBuffer) {
+            pCmdLst1->ClearRenderTargetView(m_ReflectionGBuffer.m_HDRRTV.GetCPU(), clearValuesFloat, 0, nullptr);
+            pCmdLst1->ClearRenderTargetView(m_ReflectionGBuffer.m_SpecularRoughnessRTV.GetCPU(), clearColorOne, 0, nullptr);
+            pCmdLst1->ClearRenderTargetView(m_ReflectionGBuffer.m_MotionVectorsRTV.GetCPU(), clearColor, 0, nullptr);
+            pCmdLst1->ClearRenderTargetView(m_ReflectionGBuffer.m_NormalBufferRTV.GetCPU(), clearColor, 0, nullptr);
+        }
 
         m_GPUTimer.GetTimeStamp(pCmdLst1, "Clear HDR");
 
-        pCmdLst1->ClearDepthStencilView(m_ReflectionGBuffer.m_DepthBufferDSV.GetCPU(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+        if (m_rastersReflectionGBuffer) pCmdLst1->ClearDepthStencilView(m_ReflectionGBuffer.m_DepthBufferDSV.GetCPU(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
         pCmdLst1->ClearDepthStencilView(m_GBuffer.m_DepthBufferDSV.GetCPU(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
         m_GPUTimer.GetTimeStamp(pCmdLst1, "Clear depth");
     }
@@ -1014,11 +1410,12 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
         RenderSpotLights(pCmdLst1, pPerFrame);
     }
     {
+        // Readable by the forward passes, the reflections and HSR for the rest of the frame, no barrier when nothing was rendered
         UserMarker marker(pCmdLst1, "Shadow map barriers (WRITE->READ)");
-        for (uint32_t i = 0; i < 32; i++) {
-            Barriers(pCmdLst1, {CD3DX12_RESOURCE_BARRIER::Transition(m_shadowmaps[i].m_ShadowMap.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE,
-                                                                     D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)});
-        }
+        m_shadowStates.Transition(pShadowAtlas, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        m_shadowStates.Flush(m_shadowBarrierSink);
+        m_shadowAtlasState = m_shadowStates.GetState(pShadowAtlas);
+        m_shadowBarrierSink.SetCommandList(NULL);
     }
 
     // Render Scene to the HDR RT ------------------------------------------------
@@ -1036,8 +1433,8 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
             if (m_gltfPBR) {
                 UserMarker marker(pCmdLst1, "RTGltfPbrPass");
                 m_AtmosphereRenderer.BarriersForPixelResource(pCmdLst1);
-                m_gltfPBR->DrawBatchList(pCmdLst1, &m_shadowmaps[0].m_ShadowMapSRV, &OpaqueBatchList);
-                m_gltfPBR->DrawBatchList(pCmdLst1, &m_shadowmaps[0].m_ShadowMapSRV, &TransparentBatchList);
+                m_gltfPBR->DrawBatchList(pCmdLst1, &m_ForwardLightingTable, &OpaqueBatchList);
+                m_gltfPBR->DrawBatchList(pCmdLst1, &m_ForwardLightingTable, &TransparentBatchList);
             }
             // Draw object bounding boxes
             if (m_gltfBBox) {
@@ -1083,7 +1480,7 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
                                    CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE,
                                                                         D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
                                });
-            m_DecalRenderer.Apply(pCmdLst1, m_Width, m_Height);
+            m_DecalRenderer.Apply(pCmdLst1);
             Barriers(pCmdLst1, {
                                    CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_RENDER_TARGET),
                                    CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
@@ -1091,8 +1488,8 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
                                });
         }
         m_GPUTimer.GetTimeStamp(pCmdLst1, "Rendering decals");
-        // Render the same version in reflections resolution
-        if (!pState->bOptimizedDownsample && pState->m_ReflectionResolutionMultiplier != 1.0f) {
+        // Render the same version in reflections resolution, unless it is reconstructed from the render resolution one
+        if (m_rastersReflectionGBuffer) {
             pCmdLst1->RSSetViewports(1, &m_ReflectionViewport);
             pCmdLst1->RSSetScissorRects(1, &m_ReflectionScissor);
 
@@ -1103,36 +1500,35 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
             // Render scene to color buffer
             if (m_gltfPBR) {
                 UserMarker marker(pCmdLst1, "RTGltfPbrPass");
-                m_gltfPBR->DrawBatchList(pCmdLst1, &m_shadowmaps[0].m_ShadowMapSRV, &OpaqueBatchList);
-                m_gltfPBR->DrawBatchList(pCmdLst1, &m_shadowmaps[0].m_ShadowMapSRV, &TransparentBatchList);
+                m_gltfPBR->DrawBatchList(pCmdLst1, &m_ForwardLightingTable, &OpaqueBatchList);
+                m_gltfPBR->DrawBatchList(pCmdLst1, &m_ForwardLightingTable, &TransparentBatchList);
             }
         }
         m_GPUTimer.GetTimeStamp(pCmdLst1, "Rendering scene in low res");
     }
 
     {
-        UserMarker marker(pCmdLst1, "Shadow map Barriers (READ->WRITE)");
-        for (uint32_t i = 0; i < 32; i++) {
-            Barriers(pCmdLst1, {
-                                   CD3DX12_RESOURCE_BARRIER::Transition(m_shadowmaps[i].m_ShadowMap.GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                                                                        D3D12_RESOURCE_STATE_DEPTH_WRITE),
-                               });
-        }
-    }
-
-    {
-        UserMarker marker(pCmdLst1, "Depth buffer Barriers (WRITE->READ)");
-        Barriers(pCmdLst1,
-                 {
-                     CD3DX12_RESOURCE_BARRIER::UAV(m_AtomicCounter.GetResource()),
-                     CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE,
-                                                          D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
-                     CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
-                 });
+        // The render resolution G-buffer is readable from here on, the reconstruction reads it before the depth downsample
+        UserMarker marker(pCmdLst1, "GBuffer Barriers (WRITE->READ)");
+        Barriers(
+            pCmdLst1,
+            {
+                CD3DX12_RESOURCE_BARRIER::UAV(m_AtomicCounter.GetResource()),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE,
+                                                     D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, 0),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, 0),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_SpecularRoughness.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET,
+                                                     D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, 0),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_MotionVectors.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+                                                     0),
+            });
     }
 
     // Downsample depth buffer
     if (pPerFrame != NULL) {
+        if (m_gltfPBR && ReconstructsReflectionGBuffer(pState)) ReconstructReflectionGBuffer(pCmdLst1, pState);
         DownsampleDepthBuffer(pCmdLst1, pState);
     }
 
@@ -1145,12 +1541,6 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
                 CD3DX12_RESOURCE_BARRIER::Transition(m_DepthHierarchy.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
                 CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE),
                 CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, 0),
-                CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, 0),
-                CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, 0),
-                CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_SpecularRoughness.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET,
-                                                     D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, 0),
-                CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_MotionVectors.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
-                                                     0),
                 CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
                                                      D3D12_RESOURCE_STATE_DEPTH_WRITE),
                 CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
@@ -1170,15 +1560,6 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
     if (m_gltfPBR && pPerFrame != NULL) // Only draw reflections if we draw objects
     {
         m_AtmosphereRenderer.BarriersForNonPixelResource(pCmdLst1);
-        {
-            UserMarker marker(pCmdLst1, "Shadow map barriers (WRITE->READ)");
-            for (uint32_t i = 0; i < 32; i++) {
-                Barriers(pCmdLst1, {
-                                       CD3DX12_RESOURCE_BARRIER::Transition(m_shadowmaps[i].m_ShadowMap.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE,
-                                                                            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
-                                   });
-            }
-        }
         Barriers(pCmdLst1,
                  {
                      CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE,
@@ -1202,21 +1583,18 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
                                                           D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER |
                                                               D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
                  });
-        {
-            UserMarker marker(pCmdLst1, "Shadow map barriers (READ->WRITE)");
-            for (uint32_t i = 0; i < 32; i++) {
-                Barriers(pCmdLst1, {
-                                       CD3DX12_RESOURCE_BARRIER::Transition(m_shadowmaps[i].m_ShadowMap.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
-                                                                            D3D12_RESOURCE_STATE_DEPTH_WRITE),
-                                   });
-            }
-        }
+        if (ReconstructsReflectionGBuffer(pState)) TransitionReflectionUAVGbuffer(pCmdLst1, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COMMON);
     }
 
+    // Only allocated while the debug view is on.
+    Texture *pDebugTexture = m_hsr.GetDebugTexture();
+    if (pDebugTexture)
+        Barriers(pCmdLst1, {
+                               CD3DX12_RESOURCE_BARRIER::Transition(pDebugTexture->GetResource(), D3D12_RESOURCE_STATE_COMMON,
+                                                                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE), // Wait for reflection target to be written
+                           });
     Barriers(pCmdLst1,
              {
-                 CD3DX12_RESOURCE_BARRIER::Transition(m_hsr.GetDebugTexture()->GetResource(), D3D12_RESOURCE_STATE_COMMON,
-                                                      D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE), // Wait for reflection target to be written
                  CD3DX12_RESOURCE_BARRIER::Transition(m_DepthHierarchy.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
              });
 
@@ -1230,42 +1608,37 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
             CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_MotionVectors.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
         });
 
-    Barriers(
-        pCmdLst1,
-        {
-            CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
-                                                 D3D12_RESOURCE_STATE_COPY_SOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionUAVGbuffer.Depth.GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_SOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionUAVGbuffer.Normals.GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_SOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_SOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_SOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_NormalHistoryBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_PrevHDR.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_DepthHistoryBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST),
-        });
+    std::vector<D3D12_RESOURCE_BARRIER> toCopy = {
+        CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_PrevHDR.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST),
+    };
+    std::vector<D3D12_RESOURCE_BARRIER> fromCopy = {
+        CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_PrevHDR.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+    };
+    // A ping-ponged reflection G-buffer leaves its slot in place, only a copied one needs its history surfaces
+    if (m_gbufferHistory.GetWrite() == HistoryPingPong::HISTORY_SURFACE_COPY) {
+        toCopy.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_NormalHistoryBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+        toCopy.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_DepthHistoryBuffer.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+        fromCopy.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_NormalHistoryBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+        fromCopy.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_DepthHistoryBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+    }
 
+    Barriers(pCmdLst1, toCopy);
     CopyHistorySurfaces(pCmdLst1, pState); // Keep this frames results for next frame
-
-    Barriers(
-        pCmdLst1,
-        {
-            CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionUAVGbuffer.Depth.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionUAVGbuffer.Normals.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_DepthBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_NormalHistoryBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_PrevHDR.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_DepthHistoryBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
-        });
+    Barriers(pCmdLst1, fromCopy);
 
     // Bloom, takes HDR as input and applies bloom to it.
     Barriers(
@@ -1273,7 +1646,6 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
         {
             CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
             CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_HDR.GetResource(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_hsr.GetDebugTexture()->GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COMMON),
             CD3DX12_RESOURCE_BARRIER::Transition(m_ReflectionGBuffer.m_SpecularRoughness.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
                                                  D3D12_RESOURCE_STATE_RENDER_TARGET),
             CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_SpecularRoughness.GetResource(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
@@ -1282,6 +1654,10 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
             CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_NormalBuffer.GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
             CD3DX12_RESOURCE_BARRIER::Transition(m_GBuffer.m_Diffuse.GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET),
         });
+    if (pDebugTexture)
+        Barriers(pCmdLst1, {
+                               CD3DX12_RESOURCE_BARRIER::Transition(pDebugTexture->GetResource(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COMMON),
+                           });
 
     if (pState->bDrawBloom) {
         DownsampleScene(pCmdLst1);
@@ -1353,7 +1729,24 @@ void SampleRenderer::OnRender(State *pState, SwapChain *pSwapChain) {
     m_frame_index++;
 }
 
-void SampleRenderer::Recompile() { m_hsr.Recompile(); }
+void SampleRenderer::Recompile() {
+    std::set<std::string> allShaders;
+    for (auto const &file : AtmosphereRenderer::GetShaderFiles()) allShaders.insert(file);
+    for (auto const &file : DecalRenderer::GetShaderFiles()) allShaders.insert(file);
+    for (auto const &file : ReflectionGbufferRenderer::GetShaderFiles()) allShaders.insert(file);
+    m_hsr.Recompile();
+    m_AtmosphereRenderer.Reload(m_pDevice, m_pGlobalRootSignature, allShaders, &m_RetiredPSOs);
+    m_DecalRenderer.Reload(m_pDevice, m_pGlobalRootSignature, allShaders, &m_RetiredPSOs);
+    m_ReflectionGbufferRenderer.Reload(m_pDevice, m_pGlobalRootSignature, allShaders, &m_RetiredPSOs);
+}
+
+void SampleRenderer::ReloadShaders(std::set<std::string> const &changedShaders) {
+    for (auto const &file : changedShaders) Trace(format("Reloading %s\n", file.c_str()));
+    m_hsr.Reload(changedShaders);
+    m_AtmosphereRenderer.Reload(m_pDevice, m_pGlobalRootSignature, changedShaders, &m_RetiredPSOs);
+    m_DecalRenderer.Reload(m_pDevice, m_pGlobalRootSignature, changedShaders, &m_RetiredPSOs);
+    m_ReflectionGbufferRenderer.Reload(m_pDevice, m_pGlobalRootSignature, changedShaders, &m_RetiredPSOs);
+}
 
 void SampleRenderer::CreateDepthDownsamplePipeline() {
     HRESULT hr;
@@ -25,8 +25,18 @@ THE SOFTWARE.
 #include <memory>
 
 #include "GltfPbrPass.h"
+#include "GltfShadowDepthPass.h"
 #include "HSR.h"
+#include "HistoryPingPong.h"
+#include "ClusteredLightsBuilder.h"
+#include "DecalBinning.h"
+#include "LightGridBuilder.h"
+#include "LightListBuilder.h"
 #include "PostProc/MagnifierPS.h"
+#include "ReflectionGbufferReference.h"
+#include "ShadowAtlas.h"
+#include "ShadowCache.h"
+#include "ShadowCulling.h"
 #include "base/SaveTexture.h"
 
 // We are queuing (backBufferCount + 0.5) frames, so we need to triple buffer the resources that get modified each frame
@@ -38,10 +48,39 @@ using namespace CAULDRON_DX12;
 using namespace RTCAULDRON_DX12;
 using namespace HSR_SAMPLE_DX12;
 
+// Transitions of targets that are not allocated, like the rasterized reflection G-buffer while it is reconstructed, are dropped.
 inline void Barriers(ID3D12GraphicsCommandList *pCmdLst, const std::vector<D3D12_RESOURCE_BARRIER> &barriers) {
-    pCmdLst->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+    std::vector<D3D12_RESOURCE_BARRIER> allocated;
+    allocated.reserve(barriers.size());
+    for (D3D12_RESOURCE_BARRIER const &barrier : barriers)
+        if (barrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION || barrier.Transition.pResource) allocated.push_back(barrier);
+    if (!allocated.empty()) pCmdLst->ResourceBarrier(static_cast<UINT>(allocated.size()), allocated.data());
 }
 
+// Recompiles a compute PSO on the global root signature if its shader is in the changed set. The previous PSO is kept
+// when compilation fails, otherwise it is retired as frames in flight may still reference it.
+inline void ReloadComputePSO(Device *pDevice, ID3D12RootSignature *pGlobalRootSignature, std::set<std::string> const &changedShaders, const char *pFilename,
+                             const char *pEntry, ID3D12PipelineState **ppPSO, RetiredPSOQueue *pRetiredPSOs) {
+    if (!changedShaders.count(pFilename)) return;
+    D3D12_SHADER_BYTECODE shaderByteCode = {};
+    DefineList            defines;
+    CompileShaderFromFile(pFilename, &defines, pEntry, "-T cs_6_5 /Zi /Zss", &shaderByteCode);
+    D3D12_COMPUTE_PIPELINE_STATE_DESC descPso = {};
+    descPso.CS                                = shaderByteCode;
+    descPso.Flags                             = D3D12_PIPELINE_STATE_FLAG_NONE;
+    descPso.pRootSignature                    = pGlobalRootSignature;
+    descPso.NodeMask                          = 0;
+    ID3D12PipelineState *pPSO                 = NULL;
+    if (FAILED(pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&pPSO)))) {
+        Trace(format("Failed to reload %s, keeping the previous pipeline\n", pFilename));
+        return;
+    }
+    pRetiredPSOs->Retire(*ppPSO);
+    *ppPSO = pPSO;
+}
+
+// Projects decal volumes onto the lit scene (ApplyDecals.hlsl). The visible decals are binned into screen tiles on the
+// CPU, see DecalBinning, and the shader runs one group per tile that has some.
 class DecalRenderer {
 public:
     void OnCreate(Device *pDevice, UploadHeap *pUploadHeap, ID3D12RootSignature *pGlobalRootSignature) {
@@ -57,20 +96,203 @@ public:
             descPso.NodeMask                          = 0;
             ThrowIfFailed(pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&m_pApplyDecalPSO)));
         }
+        m_binsBuffer.InitBuffer(pDevice, "Decal Bins", &CD3DX12_RESOURCE_DESC::Buffer(DECAL_BINS_MAX_WORDS * 4, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), 4,
+                                D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        m_pBinsUpload = AllocUpload(pDevice->GetDevice(), size_t(backBufferCount) * DECAL_BINS_MAX_WORDS * 4);
+        ThrowIfFailed(m_pBinsUpload->Map(0, NULL, (void **)&m_pBinsUploadMap));
+    }
+    void Reload(Device *pDevice, ID3D12RootSignature *pGlobalRootSignature, std::set<std::string> const &changedShaders, RetiredPSOQueue *pRetiredPSOs) {
+        ReloadComputePSO(pDevice, pGlobalRootSignature, changedShaders, "ApplyDecals.hlsl", "main", &m_pApplyDecalPSO, pRetiredPSOs);
+    }
+    static std::vector<std::string> GetShaderFiles() { return {"ApplyDecals.hlsl"}; }
+    void Bind(CBV_SRV_UAV *pGlobalTable) {
+        m_DecalAlbedo.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_DECAL_ALBEDO_SLOT, pGlobalTable);
+        m_binsBuffer.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_DECAL_BINS_SLOT, NULL, pGlobalTable);
+    }
+    // Bins the decals for this frame's camera, 'viewProj' is row major, clip = viewProj * (x, y, z, 1). The scene has
+    // no decals of its own, this is the strip of dashes along the sponza gallery scrolling with 'time'.
+    void Update(float const viewProj[16], uint32_t width, uint32_t height, float time) {
+        float const ratio = float(m_DecalAlbedo.GetWidth()) / float(m_DecalAlbedo.GetHeight());
+        m_decals.clear();
+        for (int k = -50; k < 50; k++) {
+            DecalBinning::Decal decal = {};
+            decal.center[0]           = 1.45f;
+            decal.center[1]           = 0.2f - 0.5f / ratio;
+            decal.center[2]           = 2.0f * k + fmodf(0.1f * time, 2.0f);
+            decal.axes[0][2]          = 1.0f;
+            decal.axes[1][1]          = -1.0f;
+            decal.axes[2][0]          = 1.0f;
+            decal.halfSize[0]         = 0.5f;
+            decal.halfSize[1]         = 0.5f / ratio;
+            decal.halfSize[2]         = 0.55f;
+            decal.intensity           = 10.0f;
+            decal.opacity             = 1.0f;
+            m_decals.push_back(decal);
+        }
+        m_bins.Build(m_decals.data(), uint32_t(m_decals.size()), viewProj, width, height);
+    }
+    void Upload(ID3D12GraphicsCommandList *pCommandList) {
+        size_t const words = m_bins.GetWords().size();
+        size_t const slot  = size_t(m_binsUploadSlot) * DECAL_BINS_MAX_WORDS;
+        memcpy(m_pBinsUploadMap + slot, m_bins.GetWords().data(), words * 4);
+        m_binsUploadSlot = (m_binsUploadSlot + 1) % backBufferCount;
+
+        UserMarker marker(pCommandList, "Upload Decal Bins");
+        Barriers(pCommandList, {CD3DX12_RESOURCE_BARRIER::Transition(m_binsBuffer.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST)});
+        pCommandList->CopyBufferRegion(m_binsBuffer.GetResource(), 0, m_pBinsUpload, slot * 4, words * 4);
+        Barriers(pCommandList, {CD3DX12_RESOURCE_BARRIER::Transition(m_binsBuffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)});
     }
-    void Bind(CBV_SRV_UAV *pGlobalTable) { m_DecalAlbedo.CreateSRV(GDT_TEXTURES_HEAP_OFFSET + GDT_TEXTURES_DECAL_ALBEDO_SLOT, pGlobalTable); }
-    void Apply(ID3D12GraphicsCommandList *pCommandList, int width, int height) {
+    DecalBinning::Stats const &GetStats() const { return m_bins.GetStats(); }
+    // The bins of the last Update must have been uploaded.
+    void Apply(ID3D12GraphicsCommandList *pCommandList) {
+        if (!m_bins.GetStats().occupiedTiles) return;
         pCommandList->SetPipelineState(m_pApplyDecalPSO);
-        pCommandList->Dispatch((width + 7) / 8, (height + 7) / 8, 1);
+        pCommandList->Dispatch(m_bins.GetStats().occupiedTiles, 1, 1);
     }
     void OnDestroy() {
         m_DecalAlbedo.OnDestroy();
         if (m_pApplyDecalPSO) m_pApplyDecalPSO->Release();
+        m_binsBuffer.OnDestroy();
+        if (m_pBinsUpload) {
+            m_pBinsUpload->Release();
+            m_pBinsUpload    = NULL;
+            m_pBinsUploadMap = NULL;
+        }
     }
 
 private:
-    Texture              m_DecalAlbedo;
-    ID3D12PipelineState *m_pApplyDecalPSO = NULL;
+    Texture                          m_DecalAlbedo;
+    ID3D12PipelineState *            m_pApplyDecalPSO = NULL;
+    std::vector<DecalBinning::Decal> m_decals;
+    DecalBinning                     m_bins;
+    Texture                          m_binsBuffer;
+    ID3D12Resource *                 m_pBinsUpload    = NULL;
+    uint32_t *                       m_pBinsUploadMap = NULL;
+    uint32_t                         m_binsUploadSlot = 0;
+};
+// Builds the reflection resolution G-buffer from the render resolution one instead of drawing the scene a second time
+// (ReconstructGbuffer.hlsl), and captures both G-buffers for sample/tools/HSRGbufferReconstruct.
+class ReflectionGbufferRenderer {
+public:
+    void OnCreate(Device *pDevice, ID3D12RootSignature *pGlobalRootSignature) {
+        m_pDevice = pDevice;
+        auto createPSO = [&](const char *pEntry, ID3D12PipelineState **ppPSO) {
+            D3D12_SHADER_BYTECODE shaderByteCode = {};
+            DefineList            defines;
+            CompileShaderFromFile("ReconstructGbuffer.hlsl", &defines, pEntry, "-T cs_6_5 /Zi /Zss", &shaderByteCode);
+            D3D12_COMPUTE_PIPELINE_STATE_DESC descPso = {};
+            descPso.CS                                = shaderByteCode;
+            descPso.Flags                             = D3D12_PIPELINE_STATE_FLAG_NONE;
+            descPso.pRootSignature                    = pGlobalRootSignature;
+            descPso.NodeMask                          = 0;
+            ThrowIfFailed(pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(ppPSO)));
+        };
+        createPSO("main", &m_pReconstructPSO);
+        createPSO("CaptureFull", &m_pCaptureFullPSO);
+        createPSO("CaptureReflection", &m_pCaptureReflectionPSO);
+    }
+    void Reload(Device *pDevice, ID3D12RootSignature *pGlobalRootSignature, std::set<std::string> const &changedShaders, RetiredPSOQueue *pRetiredPSOs) {
+        ReloadComputePSO(pDevice, pGlobalRootSignature, changedShaders, "ReconstructGbuffer.hlsl", "main", &m_pReconstructPSO, pRetiredPSOs);
+        ReloadComputePSO(pDevice, pGlobalRootSignature, changedShaders, "ReconstructGbuffer.hlsl", "CaptureFull", &m_pCaptureFullPSO, pRetiredPSOs);
+        ReloadComputePSO(pDevice, pGlobalRootSignature, changedShaders, "ReconstructGbuffer.hlsl", "CaptureReflection", &m_pCaptureReflectionPSO, pRetiredPSOs);
+    }
+    static std::vector<std::string> GetShaderFiles() { return {"ReconstructGbuffer.hlsl"}; }
+    // The global root signature and table must be bound, the render resolution G-buffer readable and the reflection
+    // one in UNORDERED_ACCESS.
+    void Reconstruct(ID3D12GraphicsCommandList *pCommandList, uint32_t reflectionWidth, uint32_t reflectionHeight, uint32_t footprint) {
+        struct PushConstants {
+            hlsl::uint footprint;
+            hlsl::uint pad0;
+        } pc{};
+        pc.footprint = footprint;
+        pCommandList->SetComputeRoot32BitConstants(2, sizeof(pc) / 4, &pc, 0);
+        pCommandList->SetPipelineState(m_pReconstructPSO);
+        pCommandList->Dispatch((reflectionWidth + 7) / 8, (reflectionHeight + 7) / 8, 1);
+    }
+    // Records both G-buffers of this frame, WriteCapture saves them to 'filename' once the frame has retired. Same
+    // bindings and states as Reconstruct, except the reflection G-buffer has to be readable. One capture at a time.
+    void Capture(ID3D12GraphicsCommandList *pCommandList, CBV_SRV_UAV *pGlobalTable, std::string const &filename, uint32_t width, uint32_t height,
+                 uint32_t reflectionWidth, uint32_t reflectionHeight, uint32_t source, uint32_t footprint) {
+        if (m_pReadback) {
+            Trace(format("Skipping the G-buffer capture %s, %s is still pending\n", filename.c_str(), m_capturePath.c_str()));
+            return;
+        }
+        UINT64 captureSize = (UINT64(width) * height + UINT64(reflectionWidth) * reflectionHeight) * REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT * sizeof(float);
+        m_pReadback        = AllocCPUVisible(m_pDevice->GetDevice(), size_t(captureSize));
+        if (!m_pReadback) {
+            Trace("Could not allocate the G-buffer capture buffer\n");
+            return;
+        }
+        m_capture.InitBuffer(m_pDevice, "Reflection GBuffer Capture", &CD3DX12_RESOURCE_DESC::Buffer(captureSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), 4,
+                             D3D12_RESOURCE_STATE_COMMON);
+        m_capture.CreateRawBufferUAV(GDT_BUFFERS_HEAP_OFFSET + GDT_BUFFERS_GBUFFER_CAPTURE_SLOT, NULL, pGlobalTable);
+        Barriers(pCommandList, {CD3DX12_RESOURCE_BARRIER::Transition(m_capture.GetResource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)});
+        pCommandList->SetPipelineState(m_pCaptureFullPSO);
+        pCommandList->Dispatch((width + 7) / 8, (height + 7) / 8, 1);
+        pCommandList->SetPipelineState(m_pCaptureReflectionPSO);
+        pCommandList->Dispatch((reflectionWidth + 7) / 8, (reflectionHeight + 7) / 8, 1);
+        Barriers(pCommandList, {CD3DX12_RESOURCE_BARRIER::Transition(m_capture.GetResource(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE)});
+        pCommandList->CopyBufferRegion(m_pReadback, 0, m_capture.GetResource(), 0, captureSize);
+
+        m_capturePath              = filename;
+        m_captureHeader            = {};
+        m_captureHeader.fullWidth  = width;
+        m_captureHeader.fullHeight = height;
+        m_captureHeader.width      = reflectionWidth;
+        m_captureHeader.height     = reflectionHeight;
+        m_captureHeader.source     = source;
+        m_captureHeader.footprint  = footprint;
+        m_captureFramesLeft        = backBufferCount;
+    }
+    // Call once per frame, saves a recorded capture once its frame has retired.
+    void WriteCapture() {
+        if (!m_pReadback) return;
+        if (m_captureFramesLeft > 0) {
+            m_captureFramesLeft--;
+            return;
+        }
+        float *pData = NULL;
+        if (SUCCEEDED(m_pReadback->Map(0, NULL, (void **)&pData))) {
+            ReflectionGbufferCapture capture;
+            capture.source    = m_captureHeader.source;
+            capture.footprint = m_captureHeader.footprint;
+            capture.full.Resize(m_captureHeader.fullWidth, m_captureHeader.fullHeight, REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT);
+            capture.reflection.Resize(m_captureHeader.width, m_captureHeader.height, REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT);
+            memcpy(capture.full.data.data(), pData, capture.full.data.size() * sizeof(float));
+            memcpy(capture.reflection.data.data(), pData + capture.full.data.size(), capture.reflection.data.size() * sizeof(float));
+            m_pReadback->Unmap(0, NULL);
+            std::string error;
+            if (SaveReflectionGbufferCapture(m_capturePath, capture, &error))
+                Trace(format("Wrote the G-buffer capture to %s\n", m_capturePath.c_str()));
+            else
+                Trace(format("%s\n", error.c_str()));
+        }
+        ReleaseCapture();
+    }
+    void OnDestroy() {
+        ReleaseCapture();
+        if (m_pReconstructPSO) m_pReconstructPSO->Release();
+        if (m_pCaptureFullPSO) m_pCaptureFullPSO->Release();
+        if (m_pCaptureReflectionPSO) m_pCaptureReflectionPSO->Release();
+    }
+
+private:
+    void ReleaseCapture() {
+        if (m_pReadback) m_pReadback->Release();
+        m_pReadback = NULL;
+        m_capture.OnDestroy();
+        m_capturePath.clear();
+    }
+
+    Device *                       m_pDevice               = NULL;
+    ID3D12PipelineState *          m_pReconstructPSO       = NULL;
+    ID3D12PipelineState *          m_pCaptureFullPSO       = NULL;
+    ID3D12PipelineState *          m_pCaptureReflectionPSO = NULL;
+    Texture                        m_capture;
+    ID3D12Resource *               m_pReadback             = NULL;
+    std::string                    m_capturePath;
+    ReflectionGbufferCaptureHeader m_captureHeader         = {};
+    int                            m_captureFramesLeft     = 0;
 };
 // Generates atmoshpere LUT for specular and diffuse image based lightning
 class AtmosphereRenderer {
@@ -137,6 +359,15 @@ public:
             ThrowIfFailed(pDevice->GetDevice()->CreateComputePipelineState(&descPso, IID_PPV_ARGS(&m_pDrawPSO)));
         }
     }
+    void Reload(Device *pDevice, ID3D12RootSignature *pGlobalRootSignature, std::set<std::string> const &changedShaders, RetiredPSOQueue *pRetiredPSOs) {
+        ReloadComputePSO(pDevice, pGlobalRootSignature, changedShaders, "GenerateAtmosphereLUT.hlsl", "mainSpecular", &m_pUpdateLUTPSO, pRetiredPSOs);
+        ReloadComputePSO(pDevice, pGlobalRootSignature, changedShaders, "GenerateAtmosphereLUT.hlsl", "mainDiffuse", &m_pUpdateDiffPSO, pRetiredPSOs);
+        ReloadComputePSO(pDevice, pGlobalRootSignature, changedShaders, "DownsampleAtmosphere.hlsl", "main", &m_pUpdateMIPPSO, pRetiredPSOs);
+        ReloadComputePSO(pDevice, pGlobalRootSignature, changedShaders, "DrawAtmosphere.hlsl", "main", &m_pDrawPSO, pRetiredPSOs);
+        // The LUTs are only regenerated when the sun or the view moves, force it so the new shaders show up.
+        m_bDirty = true;
+    }
+    static std::vector<std::string> GetShaderFiles() { return {"GenerateAtmosphereLUT.hlsl", "DownsampleAtmosphere.hlsl", "DrawAtmosphere.hlsl"}; }
     void Bind(CBV_SRV_UAV *pGlobalTable) {
         m_CubeLUT.CreateCubeSRV(GDT_CTEXTURES_HEAP_OFFSET + GDT_CTEXTURES_ATMOSPHERE_LUT_SLOT, pGlobalTable);
         m_CubeMIP.CreateCubeSRV(GDT_CTEXTURES_HEAP_OFFSET + GDT_CTEXTURES_ATMOSPHERE_MIP_SLOT, pGlobalTable);
@@ -197,9 +428,10 @@ public:
         m_CubeDiff_State = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
     }
     void Update(ID3D12GraphicsCommandList *pCommandList, Vectormath::Vector3 viewPos, Vectormath::Vector3 sunDirection, Vectormath::Vector3 sunIntensity) {
-        if (Vectormath::SSE::length(m_PrevViewPos - viewPos) < 1.0e-3f && Vectormath::SSE::length(m_PrevSunDirection - sunDirection) < 1.0e-3f &&
+        if (!m_bDirty && Vectormath::SSE::length(m_PrevViewPos - viewPos) < 1.0e-3f && Vectormath::SSE::length(m_PrevSunDirection - sunDirection) < 1.0e-3f &&
             Vectormath::SSE::length(m_PrevSunIntensity - sunIntensity) < 1.0e-3f)
             return;
+        m_bDirty           = false;
         m_PrevViewPos      = viewPos;
         m_PrevSunDirection = sunDirection;
         m_PrevSunIntensity = sunIntensity;
@@ -331,6 +563,7 @@ private:
     Vectormath::Vector3  m_PrevViewPos;
     Vectormath::Vector3  m_PrevSunDirection;
     Vectormath::Vector3  m_PrevSunIntensity;
+    bool                 m_bDirty = true;
     Texture              m_CubeMIP;
     Texture              m_CubeLUT;
     Texture              m_CubeDiff;
@@ -361,6 +594,7 @@ public:
     const std::vector<TimeStamp> &GetTimingValues() { return m_TimeStamps; }
 
     void OnRender(State *pState, SwapChain *pSwapChain);
+    // Rebuilds every compute PSO.
     void Recompile();
 
     uint32_t getWidth() { return m_Width; }
@@ -369,12 +603,22 @@ public:
 
 private:
     void CreateDepthDownsamplePipeline();
+    void ReloadShaders(std::set<std::string> const &changedShaders);
     void StallFrame(float targetFrametime);
     void BeginFrame();
 
     per_frame *FillFrameConstants(State *pState);
+    void       UpdateShadowCasters(per_frame *pPerFrame, State *pState);
+    void       UpdateLightGrid(per_frame *pPerFrame, State *pState);
+    void       UploadLightGrid(ID3D12GraphicsCommandList *pCmdLst1);
+    void       UpdateClusteredLights(per_frame *pPerFrame, State *pState);
+    void       UploadClusteredLights(ID3D12GraphicsCommandList *pCmdLst1);
+    void       UpdateLightList(per_frame *pPerFrame, State *pState);
+    void       UploadLightList(ID3D12GraphicsCommandList *pCmdLst1);
     void       RenderSpotLights(ID3D12GraphicsCommandList *pCmdLst1, per_frame *pPerFrame);
     void       RenderLightFrustums(ID3D12GraphicsCommandList *pCmdLst1, per_frame *pPerFrame, State *pState);
+    void       TransitionReflectionUAVGbuffer(ID3D12GraphicsCommandList *pCmdLst1, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+    void       ReconstructReflectionGBuffer(ID3D12GraphicsCommandList *pCmdLst1, State *pState);
     void       DownsampleDepthBuffer(ID3D12GraphicsCommandList *pCmdLst1, State *pState);
     void       RenderScreenSpaceReflections(ID3D12GraphicsCommandList *pCmdLst1, per_frame *pPerFrame, State *pState);
     void       CopyHistorySurfaces(ID3D12GraphicsCommandList *pCmdLst1, State *pState);
@@ -392,9 +636,10 @@ private:
     GBufferRenderPass m_GBufferRenderPass;
     Texture           m_PrevHDR;
 
+    // Depth and normals alternate between two slots, the one the frame does not write is the history, see m_gbufferHistory.
     struct ReflectionGBuffer {
-        Texture Depth;
-        Texture Normals;
+        Texture Depth[2];
+        Texture Normals[2];
         Texture SpecularRoughness;
         Texture Albedo;
         Texture MotionVectors;
@@ -402,6 +647,8 @@ private:
 
     GBuffer           m_ReflectionGBuffer;
     GBufferRenderPass m_ReflectionGBufferRenderPass;
+    // Whether the reflection resolution G-buffer is rasterized, its targets are only allocated then
+    bool m_rastersReflectionGBuffer = false;
 
     MagnifierPS m_Magnifier;
 
@@ -429,7 +676,7 @@ private:
     // gltf passes
     RTGltfPbrPass *         m_gltfPBR;
     GltfBBoxPass *          m_gltfBBox;
-    GltfDepthPass *         m_gltfDepth;
+    GltfShadowDepthPass *   m_gltfDepth;
     GLTFTexturesAndBuffers *m_pGLTFTexturesAndBuffers;
 
     // effects
@@ -438,7 +685,13 @@ private:
     DownSamplePS       m_DownSample;
     ToneMapping        m_ToneMapping;
 
-    DecalRenderer m_DecalRenderer;
+    DecalRenderer             m_DecalRenderer;
+    ReflectionGbufferRenderer m_ReflectionGbufferRenderer;
+
+    // Shader hot reload, only the PSOs whose shaders or includes changed are rebuilt.
+    ShaderDependencyGraph m_ShaderGraph;
+    ShaderChangeDetector  m_ShaderWatcher{m_ShaderGraph};
+    RetiredPSOQueue       m_RetiredPSOs;
 
     // SSSR
     HSR                 m_hsr;
@@ -452,15 +705,47 @@ private:
     ImGUI m_ImGUI;
 
     TAA     m_taa;
-    Texture m_NormalHistoryBuffer;
-    Texture m_DepthHistoryBuffer;
-
-    // shadowmaps
-    struct ShadowMap {
-        Texture     m_ShadowMap;
-        DSV         m_ShadowMapDSV;
-        CBV_SRV_UAV m_ShadowMapSRV;
-    } m_shadowmaps[32];
+    // Only written when the reflection G-buffer comes from Cauldron, the optimized downsample ping-pongs its own.
+    Texture         m_NormalHistoryBuffer;
+    Texture         m_DepthHistoryBuffer;
+    HistoryPingPong m_gbufferHistory;
+
+    // Shadow maps of the spot lights and the sun, tiles of one atlas handed out by m_shadowAtlas
+    Texture     m_ShadowAtlasTexture;
+    DSV         m_ShadowAtlasDSV;
+    CBV_SRV_UAV m_ForwardLightingTable; // The atlas and the clustered lights, the SRVs of the forward lighting
+    ShadowAtlas m_shadowAtlas;
+    // Which tiles to render again, the others keep last frame's depth
+    ShadowCache m_shadowCache;
+    float       m_shadowCacheTime = -1.0f;
+    // Casters in the frustum of each light rendered this frame, indexed by light and empty for the others
+    ShadowCullBoxes                    m_shadowCullBoxes;
+    std::vector<std::vector<uint32_t>> m_shadowCasterLists;
+    // State of the atlas between frames, it only leaves it on frames that render a tile
+    ResourceStateTracker m_shadowStates;
+    D3D12BarrierSink     m_shadowBarrierSink;
+    uint32_t             m_shadowAtlasState = 0;
+
+    // Lights of the reflection hit shading, built each frame and copied through one upload slot per frame in flight
+    LightGridBuilder m_lightGrid;
+    Texture          m_lightGridBuffer;
+    ID3D12Resource * m_pLightGridUpload    = NULL;
+    uint32_t *       m_pLightGridUploadMap = NULL;
+    uint32_t         m_lightGridUploadSlot = 0;
+
+    // Lights of the forward lighting of the raster pass, per view space cluster, uploaded the same way
+    ClusteredLightsBuilder m_clusteredLights;
+    Texture                m_clusteredLightsBuffer;
+    ID3D12Resource *       m_pClusteredLightsUpload    = NULL;
+    uint32_t *             m_pClusteredLightsUploadMap = NULL;
+    uint32_t               m_clusteredLightsUploadSlot = 0;
+
+    // The lights themselves, for the hit shading, uploaded the same way but only the range that changed
+    LightListBuilder m_lightList;
+    Texture          m_lightListBuffer;
+    ID3D12Resource * m_pLightListUpload    = NULL;
+    uint32_t *       m_pLightListUploadMap = NULL;
+    uint32_t         m_lightListUploadSlot = 0;
 
     // widgets
     Wireframe    m_Wireframe;
@@ -488,11 +773,14 @@ private:
     AsyncPool m_AsyncPool;
 
     ID3D12RootSignature *m_pGlobalRootSignature = nullptr;
-    CBV_SRV_UAV          m_globalDescriptorTables[3]{};
+    // Twice the frames in flight, so each table is always used with the same HSR ping-pong index and keeps its HSR
+    // descriptors from frame to frame, see DescriptorSetCache.h.
+    static const int     GLOBAL_DESCRIPTOR_TABLE_COUNT = 6;
+    CBV_SRV_UAV          m_globalDescriptorTables[GLOBAL_DESCRIPTOR_TABLE_COUNT]{};
     SAMPLER              m_globalSamplerTables[3]{};
     int                  m_frameID = 0;
 
-    CBV_SRV_UAV *GetCurrentUAVHeap() { return &m_globalDescriptorTables[m_frameID % 3]; }
+    CBV_SRV_UAV *GetCurrentUAVHeap() { return &m_globalDescriptorTables[m_frameID % GLOBAL_DESCRIPTOR_TABLE_COUNT]; }
 
     SAMPLER *GetCurrentSamplerHeap() { return &m_globalSamplerTables[m_frameID % 3]; }
 };
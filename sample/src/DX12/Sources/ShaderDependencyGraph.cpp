@@ -0,0 +1,173 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "ShaderDependencyGraph.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static std::string NormalizePath(fs::path const &path) { return path.lexically_normal().generic_string(); }
+
+ShaderFileSystem ShaderFileSystem::Disk() {
+    ShaderFileSystem disk;
+    disk.read = [](std::string const &path, std::string &contents) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+        std::stringstream ss;
+        ss << file.rdbuf();
+        contents = ss.str();
+        return true;
+    };
+    disk.stamp = [](std::string const &path) -> uint64_t {
+        std::error_code ec;
+        auto            time = fs::last_write_time(path, ec);
+        if (ec) return 0;
+        // Offset by one so that a valid stamp is never 0.
+        return (uint64_t)time.time_since_epoch().count() + 1;
+    };
+    return disk;
+}
+
+std::vector<std::string> ShaderDependencyGraph::ParseIncludes(std::string const &source) {
+    std::vector<std::string> includes;
+    bool                     inBlockComment = false;
+    std::istringstream       lines(source);
+    std::string              line;
+    while (std::getline(lines, line)) {
+        // Strip comments, block comments may span several lines.
+        std::string code;
+        for (size_t i = 0; i < line.size(); i++) {
+            if (inBlockComment) {
+                if (line.compare(i, 2, "*/") == 0) {
+                    inBlockComment = false;
+                    i++;
+                }
+                continue;
+            }
+            if (line.compare(i, 2, "//") == 0) break;
+            if (line.compare(i, 2, "/*") == 0) {
+                inBlockComment = true;
+                i++;
+                continue;
+            }
+            code += line[i];
+        }
+
+        size_t pos = code.find_first_not_of(" \t");
+        if (pos == std::string::npos || code[pos] != '#') continue;
+        pos = code.find_first_not_of(" \t", pos + 1);
+        if (pos == std::string::npos || code.compare(pos, 7, "include") != 0) continue;
+        pos = code.find_first_not_of(" \t", pos + 7);
+        if (pos == std::string::npos) continue;
+        char   close = code[pos] == '"' ? '"' : code[pos] == '<' ? '>' : 0;
+        size_t end   = close ? code.find(close, pos + 1) : std::string::npos;
+        if (end == std::string::npos) continue;
+        includes.push_back(code.substr(pos + 1, end - pos - 1));
+    }
+    return includes;
+}
+
+std::string ShaderDependencyGraph::Resolve(std::string const &name, std::string const &includerDir) const {
+    if (!includerDir.empty()) {
+        std::string path = NormalizePath(fs::path(includerDir) / name);
+        if (m_fs.stamp(path)) return path;
+    }
+    for (auto const &searchPath : m_searchPaths) {
+        std::string path = NormalizePath(fs::path(searchPath) / name);
+        if (m_fs.stamp(path)) return path;
+    }
+    std::string path = NormalizePath(name);
+    return m_fs.stamp(path) ? path : std::string();
+}
+
+std::vector<std::string> const &ShaderDependencyGraph::GetIncludes(std::string const &path) {
+    auto it = m_includes.find(path);
+    if (it != m_includes.end()) return it->second;
+
+    std::vector<std::string> &resolved = m_includes[path];
+    std::string               source;
+    if (!m_fs.read(path, source)) return resolved;
+    std::string dir = fs::path(path).parent_path().generic_string();
+    for (auto const &name : ParseIncludes(source)) {
+        // Includes that can not be found are left to the compiler to report.
+        std::string include = Resolve(name, dir);
+        if (!include.empty()) resolved.push_back(include);
+    }
+    return resolved;
+}
+
+std::set<std::string> const &ShaderDependencyGraph::GetDependencies(std::string const &root) {
+    auto it = m_closures.find(root);
+    if (it != m_closures.end()) return it->second;
+
+    std::set<std::string> &closure = m_closures[root];
+    std::string            path    = Resolve(root);
+    if (path.empty()) return closure;
+    std::vector<std::string> stack = {path};
+    while (!stack.empty()) {
+        std::string file = stack.back();
+        stack.pop_back();
+        if (!closure.insert(file).second) continue;
+        for (auto const &include : GetIncludes(file)) stack.push_back(include);
+    }
+    return closure;
+}
+
+void ShaderChangeDetector::Track(std::string const &root) {
+    for (auto const &item : m_roots)
+        if (item == root) return;
+    m_roots.push_back(root);
+    for (auto const &file : m_graph.GetDependencies(root))
+        if (m_stamps.find(file) == m_stamps.end()) m_stamps[file] = m_graph.GetFileSystem().stamp(file);
+}
+
+void ShaderChangeDetector::Snapshot() {
+    m_stamps.clear();
+    for (auto const &root : m_roots)
+        for (auto const &file : m_graph.GetDependencies(root)) m_stamps[file] = m_graph.GetFileSystem().stamp(file);
+}
+
+std::vector<std::string> ShaderChangeDetector::Poll() {
+    std::set<std::string> changed;
+    for (auto const &item : m_stamps)
+        if (m_graph.GetFileSystem().stamp(item.first) != item.second) changed.insert(item.first);
+
+    std::vector<std::string> roots;
+    if (changed.empty()) return roots;
+
+    // Matched against the graph the stamps were taken from, a file that was deleted no longer resolves. A changed
+    // file may have gained or lost includes, the graph is rebuilt before the next snapshot.
+    for (auto const &root : m_roots) {
+        std::set<std::string> const &dependencies = m_graph.GetDependencies(root);
+        for (auto const &file : changed) {
+            if (dependencies.find(file) != dependencies.end()) {
+                roots.push_back(root);
+                break;
+            }
+        }
+    }
+    m_graph.Invalidate();
+    Snapshot();
+    return roots;
+}
@@ -0,0 +1,102 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+        File access used by the shader dependency graph, replaceable for testing.
+*/
+struct ShaderFileSystem {
+    // Reads the whole file, returns false if it does not exist.
+    std::function<bool(std::string const &path, std::string &contents)> read;
+    // Returns a stamp that changes whenever the file changes (last write time), 0 if the file does not exist.
+    std::function<uint64_t(std::string const &path)> stamp;
+
+    static ShaderFileSystem Disk();
+};
+
+/**
+        Include graph of the shader sources.
+
+        Files are identified by the path they resolve to: an include is looked up next to the including file first and
+        then in each search path, the same way the shader compiler resolves them.
+*/
+class ShaderDependencyGraph {
+public:
+    ShaderDependencyGraph(ShaderFileSystem fs = ShaderFileSystem::Disk()) : m_fs(fs) {}
+
+    void AddSearchPath(std::string const &path) { m_searchPaths.push_back(path); }
+
+    // Returns the names of the #include directives of a source, in order. Commented out lines are skipped.
+    static std::vector<std::string> ParseIncludes(std::string const &source);
+
+    // Resolves a file name to an existing path, empty if it can not be found.
+    std::string Resolve(std::string const &name, std::string const &includerDir = "") const;
+
+    // Transitive set of files the root file depends on, the root included.
+    std::set<std::string> const &GetDependencies(std::string const &root);
+
+    // Drops the parsed includes so the next query rescans the files.
+    void Invalidate() {
+        m_includes.clear();
+        m_closures.clear();
+    }
+
+    ShaderFileSystem const &GetFileSystem() const { return m_fs; }
+
+private:
+    std::vector<std::string> const &GetIncludes(std::string const &path);
+
+    ShaderFileSystem         m_fs;
+    std::vector<std::string> m_searchPaths;
+    // Resolved path -> resolved paths of its direct includes.
+    std::map<std::string, std::vector<std::string>> m_includes;
+    // Root name -> transitive dependencies.
+    std::map<std::string, std::set<std::string>> m_closures;
+};
+
+/**
+        Polls the stamps of every file the tracked roots depend on and reports which roots need recompiling.
+*/
+class ShaderChangeDetector {
+public:
+    ShaderChangeDetector(ShaderDependencyGraph &graph) : m_graph(graph) {}
+
+    // Starts watching a root shader and everything it includes.
+    void Track(std::string const &root);
+
+    // Returns the tracked roots with at least one changed input since the previous call, in tracking order.
+    std::vector<std::string> Poll();
+
+private:
+    void Snapshot();
+
+    ShaderDependencyGraph &         m_graph;
+    std::vector<std::string>        m_roots;
+    std::map<std::string, uint64_t> m_stamps;
+};
@@ -0,0 +1,157 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+// Every other bit of 'code', the inverse of interleaving x and y.
+uint32_t CompactBits(uint32_t code) {
+    code &= 0x55555555u;
+    code = (code | (code >> 1)) & 0x33333333u;
+    code = (code | (code >> 2)) & 0x0f0f0f0fu;
+    code = (code | (code >> 4)) & 0x00ff00ffu;
+    code = (code | (code >> 8)) & 0x0000ffffu;
+    return code;
+}
+
+uint32_t Log2(uint32_t value) {
+    uint32_t log = 0;
+    while (value > 1) {
+        value >>= 1;
+        log++;
+    }
+    return log;
+}
+
+struct Sizing {
+    uint32_t id;
+    float    priority;
+    uint32_t size;
+};
+
+} // namespace
+
+void ShadowAtlas::Init(Config const &config) {
+    assert(config.minTileSize && (config.minTileSize & (config.minTileSize - 1)) == 0);
+    assert(config.maxTileSize >= config.minTileSize && (config.maxTileSize & (config.maxTileSize - 1)) == 0);
+    assert(config.atlasSize >= config.maxTileSize && (config.atlasSize & (config.atlasSize - 1)) == 0);
+    assert(Log2(config.atlasSize / config.minTileSize) <= SHADOW_ATLAS_MAX_LEVEL);
+    m_config  = config;
+    m_tiles   = {};
+    m_wanted  = {};
+    m_dropped = 0;
+    m_repacks = 0;
+}
+
+bool ShadowAtlas::Update(Request const *pRequests, size_t count) {
+    float const minLog = float(Log2(m_config.minTileSize));
+    float const maxLog = float(Log2(m_config.maxTileSize));
+
+    std::vector<Sizing> sizing;
+    sizing.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        Request const &request    = pRequests[i];
+        float const    coverage   = std::min(std::max(request.coverage, 0.0f), 1.0f);
+        float const    importance = std::min(std::max(request.importance, 0.0f), 1.0f);
+        float const    ideal      = float(m_config.maxTileSize) * std::sqrt(coverage) * importance;
+        float const    idealLog   = ideal > 0.0f ? std::min(std::max(std::log2(ideal), minLog), maxLog) : minLog;
+
+        // Against the size asked for last time rather than the tile, which may have been shrunk to fit.
+        uint32_t sizeLog = uint32_t(std::floor(idealLog + 0.5f));
+        for (Wanted const &wanted : m_wanted) {
+            if (wanted.id != request.id) continue;
+            float const wantedLog = float(Log2(wanted.size));
+            if (std::fabs(idealLog - wantedLog) < 0.5f + m_config.hysteresis) sizeLog = uint32_t(wantedLog);
+        }
+        sizing.push_back({request.id, coverage * importance, 1u << sizeLog});
+    }
+    m_wanted.clear();
+    for (Sizing const &s : sizing) m_wanted.push_back({s.id, s.size});
+
+    // Least important first, ties broken by id so the outcome does not depend on the request order.
+    std::sort(sizing.begin(), sizing.end(), [](Sizing const &a, Sizing const &b) { return a.priority != b.priority ? a.priority < b.priority : a.id > b.id; });
+
+    uint64_t const capacity = uint64_t(m_config.atlasSize) * m_config.atlasSize;
+    uint64_t       used     = 0;
+    for (Sizing const &s : sizing) used += uint64_t(s.size) * s.size;
+    while (used > capacity) {
+        // Halve the least important tile that can still shrink, drop the least important light when none can.
+        auto shrink = std::find_if(sizing.begin(), sizing.end(), [&](Sizing const &s) { return s.size > m_config.minTileSize; });
+        if (shrink != sizing.end()) {
+            used -= uint64_t(shrink->size) * shrink->size * 3 / 4;
+            shrink->size /= 2;
+        } else {
+            used -= uint64_t(sizing.front().size) * sizing.front().size;
+            sizing.erase(sizing.begin());
+        }
+    }
+    m_dropped = uint32_t(count - sizing.size());
+
+    std::sort(sizing.begin(), sizing.end(), [](Sizing const &a, Sizing const &b) { return a.size != b.size ? a.size > b.size : a.id < b.id; });
+
+    bool changed = sizing.size() != m_tiles.size();
+    for (size_t i = 0; !changed && i < sizing.size(); i++) changed = sizing[i].id != m_tiles[i].id || sizing[i].size != m_tiles[i].size;
+    if (!changed) return false;
+
+    // Largest first along the Morton curve, in units of the smallest tile: every tile starts at a multiple of its own
+    // area, which lands it on a position aligned to its size.
+    uint32_t const unitArea = m_config.minTileSize * m_config.minTileSize;
+    uint64_t       cursor   = 0;
+    m_tiles.clear();
+    for (Sizing const &s : sizing) {
+        uint32_t const code = uint32_t(cursor);
+        Tile           tile;
+        tile.id    = s.id;
+        tile.x     = CompactBits(code) * m_config.minTileSize;
+        tile.y     = CompactBits(code >> 1) * m_config.minTileSize;
+        tile.size  = s.size;
+        tile.level = Log2(m_config.atlasSize / s.size);
+        m_tiles.push_back(tile);
+        cursor += uint64_t(s.size) * s.size / unitArea;
+    }
+    m_repacks++;
+    return true;
+}
+
+ShadowAtlas::Tile const *ShadowAtlas::Find(uint32_t id) const {
+    for (Tile const &tile : m_tiles)
+        if (tile.id == id) return &tile;
+    return nullptr;
+}
+
+uint64_t ShadowAtlas::GetUsedTexels() const {
+    uint64_t used = 0;
+    for (Tile const &tile : m_tiles) used += uint64_t(tile.size) * tile.size;
+    return used;
+}
+
+float EstimateShadowScreenCoverage(float distance, float radius, float tanHalfFovY, float aspect) {
+    if (radius <= 0.0f || distance <= radius) return 1.0f;
+    // Radius of the projected sphere in NDC y, the ellipse it covers is narrower by 'aspect' in NDC x.
+    float const ndcRadius = radius / (std::sqrt(distance * distance - radius * radius) * tanHalfFovY);
+    float const coverage  = 3.14159265f * ndcRadius * ndcRadius / (4.0f * aspect);
+    return std::min(coverage, 1.0f);
+}
@@ -0,0 +1,97 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../../Shaders/ShadowAtlasTile.h"
+
+/**
+        Hands out the shadow maps of the lights as power of two tiles of one depth atlas.
+
+        Each light asks for a tile of maxTileSize * sqrt(coverage) * importance texels, where coverage is the part of the
+        screen its volume covers (see EstimateShadowScreenCoverage) and importance weights it against the other lights.
+        The size is rounded to a power of two and only changes once the request moves 'hysteresis' octaves past the
+        rounding point, so a light that hovers around a boundary does not flip between two sizes. When the tiles do not
+        fit, the least important one is halved until they do, down to minTileSize, then the least important lights are
+        dropped and get no shadow.
+
+        Tiles are placed largest first along a Morton curve, which packs power of two squares without holes and keeps
+        every tile aligned to its size. The layout only changes when the set of lights or a tile size does, Update
+        returns true then and every tile has to be rendered again.
+*/
+class ShadowAtlas {
+public:
+    struct Config {
+        uint32_t atlasSize   = 8192;
+        uint32_t minTileSize = 256;
+        uint32_t maxTileSize = 4096;
+        float    hysteresis  = 0.25f; // In octaves past the rounding point.
+    };
+
+    struct Request {
+        uint32_t id;         // Caller's key, e.g. the light index.
+        float    coverage;   // 0..1 of the screen.
+        float    importance; // 0..1, scales the tile.
+    };
+
+    struct Tile {
+        uint32_t id;
+        uint32_t x, y;  // Texels.
+        uint32_t size;  // Texels, a power of two.
+        uint32_t level; // size == atlasSize >> level
+
+        // What goes to Light::shadowMapIndex, see ShadowAtlasTile.h.
+        int Pack() const { return ShadowAtlasModel::ShadowAtlas_PackTile(x / size, y / size, level); }
+    };
+
+    void Init(Config const &config);
+    // Sizes and places a tile for every request. True when the layout changed.
+    bool Update(Request const *pRequests, size_t count);
+
+    Tile const *Find(uint32_t id) const;
+    // Sorted by size, largest first.
+    std::vector<Tile> const &GetTiles() const { return m_tiles; }
+    Config const &           GetConfig() const { return m_config; }
+    // Requests that got no tile on the last Update.
+    uint32_t GetDropped() const { return m_dropped; }
+    uint64_t GetRepacks() const { return m_repacks; }
+    // Texels covered by tiles, out of atlasSize * atlasSize.
+    uint64_t GetUsedTexels() const;
+
+private:
+    struct Wanted {
+        uint32_t id;
+        uint32_t size; // Before shrinking to fit, what the hysteresis compares against.
+    };
+
+    Config              m_config;
+    std::vector<Tile>   m_tiles;
+    std::vector<Wanted> m_wanted;
+    uint32_t            m_dropped = 0;
+    uint64_t            m_repacks = 0;
+};
+
+// Part of the screen covered by a sphere of 'radius' at 'distance' from the camera, 1 when the camera is inside it.
+float EstimateShadowScreenCoverage(float distance, float radius, float tanHalfFovY, float aspect);
@@ -0,0 +1,105 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "ShadowCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+void ShadowCache::Update(Light const *pLights, size_t lightCount, Caster const *pCasters, size_t casterCount) {
+    m_frame++;
+
+    // Where the moved casters were and are: a caster leaving a frustum uncovers shadow just as one entering adds it.
+    std::vector<Bounds> moved;
+    auto const          addMoved = [&](float const boundsMin[3], float const boundsMax[3]) {
+        Bounds bounds;
+        memcpy(bounds.boundsMin, boundsMin, sizeof(bounds.boundsMin));
+        memcpy(bounds.boundsMax, boundsMax, sizeof(bounds.boundsMax));
+        moved.push_back(bounds);
+    };
+    for (size_t i = 0; i < casterCount; i++) {
+        Caster const &caster = pCasters[i];
+        if (caster.id >= m_casters.size()) m_casters.resize(caster.id + 1, CasterState{{0, 0, 0}, {0, 0, 0}, 0});
+        CasterState &state   = m_casters[caster.id];
+        bool const   seen    = state.frame != 0 && state.frame + 1 == m_frame;
+        bool const   changed = memcmp(state.boundsMin, caster.boundsMin, sizeof(state.boundsMin)) || memcmp(state.boundsMax, caster.boundsMax, sizeof(state.boundsMax));
+        if (seen && (changed || caster.animated)) addMoved(state.boundsMin, state.boundsMax);
+        if (!seen || changed || caster.animated) addMoved(caster.boundsMin, caster.boundsMax);
+        memcpy(state.boundsMin, caster.boundsMin, sizeof(state.boundsMin));
+        memcpy(state.boundsMax, caster.boundsMax, sizeof(state.boundsMax));
+        state.frame = m_frame;
+    }
+    for (CasterState &state : m_casters) {
+        if (state.frame == 0 || state.frame == m_frame) continue;
+        // Gone since the last frame, the lights that saw it have to drop its shadow.
+        if (state.frame + 1 == m_frame) addMoved(state.boundsMin, state.boundsMax);
+        state.frame = 0;
+    }
+
+    std::vector<LightState> lights;
+    lights.reserve(lightCount);
+    m_dirty.clear();
+    m_cached = 0;
+    for (size_t i = 0; i < lightCount; i++) {
+        Light const &light = pLights[i];
+        LightState   state;
+        state.id   = light.id;
+        state.tile = light.tile;
+        memcpy(state.viewProj, light.viewProj, sizeof(state.viewProj));
+        lights.push_back(state);
+
+        auto previous = std::find_if(m_lights.begin(), m_lights.end(), [&](LightState const &s) { return s.id == light.id; });
+        bool dirty    = previous == m_lights.end() || previous->tile != light.tile || memcmp(previous->viewProj, light.viewProj, sizeof(light.viewProj));
+        for (size_t j = 0; !dirty && j < moved.size(); j++) dirty = ShadowFrustumOverlapsBox(light.viewProj, moved[j].boundsMin, moved[j].boundsMax);
+        if (dirty)
+            m_dirty.push_back(light.id);
+        else
+            m_cached++;
+    }
+    m_lights.swap(lights);
+}
+
+void ShadowCache::Invalidate() {
+    m_lights.clear();
+    m_casters.clear();
+}
+
+bool ShadowCache::IsDirty(uint32_t id) const { return std::find(m_dirty.begin(), m_dirty.end(), id) != m_dirty.end(); }
+
+bool ShadowFrustumOverlapsBox(float const viewProj[16], float const boundsMin[3], float const boundsMax[3]) {
+    float const *r0 = viewProj;
+    float const *r1 = viewProj + 4;
+    float const *r2 = viewProj + 8;
+    float const *r3 = viewProj + 12;
+    // Inward facing planes of the clip volume: -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+    float const planes[6][4] = {
+        {r3[0] + r0[0], r3[1] + r0[1], r3[2] + r0[2], r3[3] + r0[3]}, {r3[0] - r0[0], r3[1] - r0[1], r3[2] - r0[2], r3[3] - r0[3]},
+        {r3[0] + r1[0], r3[1] + r1[1], r3[2] + r1[2], r3[3] + r1[3]}, {r3[0] - r1[0], r3[1] - r1[1], r3[2] - r1[2], r3[3] - r1[3]},
+        {r2[0], r2[1], r2[2], r2[3]},                                 {r3[0] - r2[0], r3[1] - r2[1], r3[2] - r2[2], r3[3] - r2[3]},
+    };
+    for (float const *plane : planes) {
+        // The corner furthest along the plane normal, the box is outside if even that one is behind the plane.
+        float distance = plane[3];
+        for (int axis = 0; axis < 3; axis++) distance += plane[axis] * (plane[axis] >= 0.0f ? boundsMax[axis] : boundsMin[axis]);
+        if (distance < 0.0f) return false;
+    }
+    return true;
+}
@@ -0,0 +1,88 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+        Decides which shadow maps have to be rendered again, so a light keeps its atlas tile across frames while
+        nothing it sees changes.
+
+        A light is dirty when it is new, its tile or view projection changed, or a shadow caster that moved since the
+        last frame overlaps its frustum before or after the move. Casters move when their world bounds change, when they
+        are flagged animated (skinned meshes, whose bounds do not follow the skin) and when they appear or disappear.
+        Lights missing from an Update are forgotten and dirty again when they come back.
+
+        Everything that is not described to Update, e.g. a material change, needs an Invalidate.
+*/
+class ShadowCache {
+public:
+    struct Light {
+        uint32_t id;
+        int      tile;         // Where the map lives, e.g. the packed shadowMapIndex. Any change re-renders.
+        float    viewProj[16]; // Row major, clip = viewProj * (x, y, z, 1) with 0 <= z <= w.
+    };
+
+    struct Caster {
+        uint32_t id; // Dense and stable while the scene is loaded, e.g. a running index over the primitives.
+        float    boundsMin[3];
+        float    boundsMax[3];
+        bool     animated; // Moved even if the bounds did not.
+    };
+
+    // Classifies the lights of this frame, see IsDirty.
+    void Update(Light const *pLights, size_t lightCount, Caster const *pCasters, size_t casterCount);
+    // Every light is rendered on the next Update, and the casters are forgotten. Call when the scene changes.
+    void Invalidate();
+
+    // Whether the light has to be cleared and rendered this frame.
+    bool IsDirty(uint32_t id) const;
+    std::vector<uint32_t> const &GetDirty() const { return m_dirty; }
+    uint32_t                     GetCached() const { return m_cached; }
+
+private:
+    struct LightState {
+        uint32_t id;
+        int      tile;
+        float    viewProj[16];
+    };
+    struct CasterState {
+        float    boundsMin[3];
+        float    boundsMax[3];
+        uint64_t frame; // Of the last Update that saw the caster, 0 for never.
+    };
+    struct Bounds {
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+
+    std::vector<LightState>  m_lights;
+    std::vector<CasterState> m_casters; // Indexed by caster id.
+    std::vector<uint32_t>    m_dirty;
+    uint32_t                 m_cached = 0;
+    uint64_t                 m_frame  = 0;
+};
+
+// Whether an axis aligned box is at least partly inside the clip volume of a row major view projection.
+bool ShadowFrustumOverlapsBox(float const viewProj[16], float const boundsMin[3], float const boundsMax[3]);
@@ -0,0 +1,120 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "ShadowCulling.h"
+#include "ShadowCache.h"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define SHADOW_CULLING_SSE2 1
+#    include <emmintrin.h>
+#endif
+
+void ShadowCullBoxes::Clear() {
+    minX.clear();
+    minY.clear();
+    minZ.clear();
+    maxX.clear();
+    maxY.clear();
+    maxZ.clear();
+}
+
+void ShadowCullBoxes::Add(float const boundsMin[3], float const boundsMax[3]) {
+    minX.push_back(boundsMin[0]);
+    minY.push_back(boundsMin[1]);
+    minZ.push_back(boundsMin[2]);
+    maxX.push_back(boundsMax[0]);
+    maxY.push_back(boundsMax[1]);
+    maxZ.push_back(boundsMax[2]);
+}
+
+void CullShadowCasters(ShadowCullBoxes const &boxes, float const viewProj[16], std::vector<uint32_t> &visible) {
+    uint32_t const count = uint32_t(boxes.Size());
+    uint32_t       i     = 0;
+#if SHADOW_CULLING_SSE2
+    float const *r0 = viewProj;
+    float const *r1 = viewProj + 4;
+    float const *r2 = viewProj + 8;
+    float const *r3 = viewProj + 12;
+    // Same planes and the same order of operations as ShadowFrustumOverlapsBox, so both agree on every box.
+    float const planes[6][4] = {
+        {r3[0] + r0[0], r3[1] + r0[1], r3[2] + r0[2], r3[3] + r0[3]}, {r3[0] - r0[0], r3[1] - r0[1], r3[2] - r0[2], r3[3] - r0[3]},
+        {r3[0] + r1[0], r3[1] + r1[1], r3[2] + r1[2], r3[3] + r1[3]}, {r3[0] - r1[0], r3[1] - r1[1], r3[2] - r1[2], r3[3] - r1[3]},
+        {r2[0], r2[1], r2[2], r2[3]},                                 {r3[0] - r2[0], r3[1] - r2[1], r3[2] - r2[2], r3[3] - r2[3]},
+    };
+    // The corner furthest along each plane normal, picked once per plane as the normal is the same for all boxes.
+    float const *corners[6][3];
+    for (int p = 0; p < 6; p++) {
+        corners[p][0] = planes[p][0] >= 0.0f ? boxes.maxX.data() : boxes.minX.data();
+        corners[p][1] = planes[p][1] >= 0.0f ? boxes.maxY.data() : boxes.minY.data();
+        corners[p][2] = planes[p][2] >= 0.0f ? boxes.maxZ.data() : boxes.minZ.data();
+    }
+    __m128 const zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_set1_ps(planes[p][3]);
+            distance        = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes[p][0]), _mm_loadu_ps(corners[p][0] + i)));
+            distance        = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes[p][1]), _mm_loadu_ps(corners[p][1] + i)));
+            distance        = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes[p][2]), _mm_loadu_ps(corners[p][2] + i)));
+            outside         = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+        }
+        int const mask = _mm_movemask_ps(outside);
+        if (mask == 0xf) continue;
+        for (uint32_t lane = 0; lane < 4; lane++)
+            if (!(mask & (1 << lane))) visible.push_back(i + lane);
+    }
+#endif
+    for (; i < count; i++) {
+        float const boundsMin[3] = {boxes.minX[i], boxes.minY[i], boxes.minZ[i]};
+        float const boundsMax[3] = {boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]};
+        if (ShadowFrustumOverlapsBox(viewProj, boundsMin, boundsMax)) visible.push_back(i);
+    }
+}
+
+void CullShadowCastersForLights(ShadowCullBoxes const &boxes, float const *pViewProjs, uint32_t lightCount, std::vector<std::vector<uint32_t>> &visible,
+                                uint32_t threadCount, uint64_t minTestsPerThread) {
+    visible.resize(lightCount);
+    for (auto &list : visible) list.clear();
+    if (lightCount == 0) return;
+
+    uint64_t const tests = uint64_t(lightCount) * std::max<size_t>(boxes.Size(), 1);
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = uint32_t(std::min<uint64_t>(threadCount, std::max<uint64_t>(1, tests / std::max<uint64_t>(minTestsPerThread, 1))));
+    threadCount = std::min(threadCount, lightCount);
+
+    auto const cull = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t light = begin; light < end; light++) CullShadowCasters(boxes, pViewProjs + light * 16, visible[light]);
+    };
+    if (threadCount <= 1) {
+        cull(0, lightCount);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        uint32_t begin = uint32_t(uint64_t(lightCount) * i / threadCount);
+        uint32_t end   = uint32_t(uint64_t(lightCount) * (i + 1) / threadCount);
+        workers.emplace_back([&cull, begin, end]() { cull(begin, end); });
+    }
+    for (auto &worker : workers) worker.join();
+}
@@ -0,0 +1,51 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+        World space boxes of the shadow casters, kept as structure of arrays so the culling tests four boxes against a
+        frustum plane at once.
+*/
+struct ShadowCullBoxes {
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+
+    void   Clear();
+    void   Add(float const boundsMin[3], float const boundsMax[3]);
+    size_t Size() const { return minX.size(); }
+};
+
+// Appends the indices of the boxes that overlap the clip volume of the row major 'viewProj' (clip = viewProj * (x, y,
+// z, 1), 0 <= z <= w) to 'visible', in increasing order. Matches ShadowFrustumOverlapsBox box for box.
+void CullShadowCasters(ShadowCullBoxes const &boxes, float const viewProj[16], std::vector<uint32_t> &visible);
+
+/**
+        One list of visible boxes per light, 'pViewProjs' holds 16 floats per light. The lights are split over up to
+        'threadCount' threads, 0 picks the hardware concurrency, but each thread gets at least minTestsPerThread box
+        tests so small scenes do not pay for starting threads.
+*/
+void CullShadowCastersForLights(ShadowCullBoxes const &boxes, float const *pViewProjs, uint32_t lightCount, std::vector<std::vector<uint32_t>> &visible,
+                                uint32_t threadCount = 0, uint64_t minTestsPerThread = 1 << 16);
@@ -0,0 +1,121 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "stdafx.h"
+
+#include "TransientHeapDX12.h"
+
+namespace HSR_SAMPLE_DX12 {
+
+void TransientResourceDX12::CreateRawBufferUAV(uint32_t index, CBV_SRV_UAV *pRV) const {
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+    uavDesc.Format                           = DXGI_FORMAT_R32_TYPELESS;
+    uavDesc.ViewDimension                    = D3D12_UAV_DIMENSION_BUFFER;
+    uavDesc.Buffer.FirstElement              = 0;
+    uavDesc.Buffer.NumElements               = UINT(m_pResource->GetDesc().Width / 4);
+    uavDesc.Buffer.Flags                     = D3D12_BUFFER_UAV_FLAG_RAW;
+    m_pDevice->CreateUnorderedAccessView(m_pResource, NULL, &uavDesc, pRV->GetCPU(index));
+}
+
+void TransientResourceDX12::CreateUAV(uint32_t index, CBV_SRV_UAV *pRV) const {
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+    uavDesc.Format                           = m_pResource->GetDesc().Format;
+    uavDesc.ViewDimension                    = D3D12_UAV_DIMENSION_TEXTURE2D;
+    m_pDevice->CreateUnorderedAccessView(m_pResource, NULL, &uavDesc, pRV->GetCPU(index));
+}
+
+void TransientResourceDX12::CreateSRV(uint32_t index, CBV_SRV_UAV *pRV) const {
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format                          = m_pResource->GetDesc().Format;
+    srvDesc.ViewDimension                   = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Shader4ComponentMapping         = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Texture2D.MipLevels             = 1;
+    m_pDevice->CreateShaderResourceView(m_pResource, &srvDesc, pRV->GetCPU(index));
+}
+
+void TransientHeapDX12::OnCreate(Device *pDevice) {
+    m_pDevice                                 = pDevice;
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+    if (SUCCEEDED(pDevice->GetDevice()->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options))))
+        m_tier2 = options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2;
+}
+
+void TransientHeapDX12::OnDestroy() {
+    for (TransientResourceDX12 *pHandle : m_handles) pHandle->m_pResource = nullptr;
+    for (ID3D12Resource *pResource : m_resources)
+        if (pResource) pResource->Release();
+    for (ID3D12Heap *pHeap : m_heaps)
+        if (pHeap) pHeap->Release();
+    m_handles.clear();
+    m_resources.clear();
+    m_heaps.clear();
+}
+
+void TransientHeapDX12::Describe(D3D12_RESOURCE_DESC const &desc, FrameGraphResourceDesc &graphDesc) const {
+    D3D12_RESOURCE_ALLOCATION_INFO info = m_pDevice->GetDevice()->GetResourceAllocationInfo(0, 1, &desc);
+    graphDesc.size                      = info.SizeInBytes;
+    graphDesc.alignment                 = info.Alignment;
+    graphDesc.heapGroup                 = (!m_tier2 && desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER) ? 1 : 0;
+}
+
+HRESULT TransientHeapDX12::CreateHeaps(FrameGraph const &graph) {
+    OnDestroy();
+    m_heaps.assign(graph.GetHeapGroupCount(), nullptr);
+    m_resources.assign(graph.GetResourceCount(), nullptr);
+    for (uint32_t group = 0; group < graph.GetHeapGroupCount(); group++) {
+        if (!graph.GetHeapSize(group)) continue;
+        D3D12_HEAP_DESC heapDesc = {};
+        heapDesc.SizeInBytes     = graph.GetHeapSize(group);
+        heapDesc.Properties      = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+        heapDesc.Alignment       = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapDesc.Flags           = m_tier2 ? D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES
+                                           : (group == 0 ? D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES);
+        HRESULT hr = m_pDevice->GetDevice()->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_heaps[group]));
+        if (FAILED(hr)) return hr;
+        m_heaps[group]->SetName(group == 0 ? L"HSR - Transient Heap 0" : L"HSR - Transient Heap 1");
+    }
+    return S_OK;
+}
+
+HRESULT TransientHeapDX12::Place(FrameGraph const &graph, uint32_t resource, D3D12_RESOURCE_DESC const &desc, wchar_t const *pName, TransientResourceDX12 &out) {
+    FrameGraphResourceDesc const &graphDesc = graph.GetResource(resource);
+    if (graph.GetFirstPass(resource) == FRAME_GRAPH_INVALID) return E_INVALIDARG;
+    ID3D12Resource *pResource = nullptr;
+    HRESULT         hr        = m_pDevice->GetDevice()->CreatePlacedResource(m_heaps[graphDesc.heapGroup], graph.GetHeapOffset(resource), &desc, D3D12_RESOURCE_STATE_COMMON,
+                                                                    nullptr, IID_PPV_ARGS(&pResource));
+    if (FAILED(hr)) return hr;
+    pResource->SetName(pName);
+    m_resources[resource] = pResource;
+    out.m_pDevice         = m_pDevice->GetDevice();
+    out.m_pResource       = pResource;
+    m_handles.push_back(&out);
+    return S_OK;
+}
+
+void TransientHeapDX12::BeginPass(ResourceStateTracker &tracker, FrameGraph const &graph, uint32_t pass) const {
+    if (pass == FRAME_GRAPH_INVALID) return;
+    for (FrameGraphBarrier const &barrier : graph.GetBarriers(pass)) {
+        // Draw skips passes at runtime, the resource the graph expects before may not have been used this frame.
+        if (barrier.type == FrameGraphBarrierType::Aliasing && m_resources[barrier.resource]) tracker.Alias(m_resources[barrier.resource]);
+    }
+}
+
+} // namespace HSR_SAMPLE_DX12
@@ -0,0 +1,84 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include "Base/Device.h"
+#include "Base/ResourceViewHeaps.h"
+#include "FrameGraph.h"
+#include "ResourceStateTracker.h"
+
+#include <vector>
+
+using namespace CAULDRON_DX12;
+namespace HSR_SAMPLE_DX12 {
+
+/**
+        A transient resource of the frame graph, placed in a TransientHeapDX12. Owned by the heap, the handle only
+        goes stale when the heap is destroyed.
+*/
+class TransientResourceDX12 {
+public:
+    ID3D12Resource *GetResource() const { return m_pResource; }
+
+    void CreateRawBufferUAV(uint32_t index, CBV_SRV_UAV *pRV) const;
+    void CreateUAV(uint32_t index, CBV_SRV_UAV *pRV) const;
+    void CreateSRV(uint32_t index, CBV_SRV_UAV *pRV) const;
+
+private:
+    friend class TransientHeapDX12;
+    ID3D12Device *  m_pDevice   = nullptr;
+    ID3D12Resource *m_pResource = nullptr;
+};
+
+/**
+        D3D12 backend of the transient resources of a FrameGraph: one placed heap per heap group, sized by the
+        compiled graph, and the aliasing barriers the graph derives.
+
+        Describe fills the size, alignment and heap group of a resource before the graph is compiled. On resource
+        heap tier 2 all transients go to group 0, on tier 1 buffers and textures need separate heaps and textures go
+        to group 1. Resources that are not render targets or depth buffers need no initialization on activation, the
+        passes write everything they read.
+*/
+class TransientHeapDX12 {
+public:
+    void OnCreate(Device *pDevice);
+    void OnDestroy();
+
+    void Describe(D3D12_RESOURCE_DESC const &desc, FrameGraphResourceDesc &graphDesc) const;
+
+    // Creates the heaps for a compiled graph.
+    HRESULT CreateHeaps(FrameGraph const &graph);
+    // Places graph resource 'resource' at its offset, in the COMMON state. The resource must be used by a pass.
+    HRESULT Place(FrameGraph const &graph, uint32_t resource, D3D12_RESOURCE_DESC const &desc, wchar_t const *pName, TransientResourceDX12 &out);
+
+    // Queues the aliasing barriers of 'pass', before its first barrier.
+    void BeginPass(ResourceStateTracker &tracker, FrameGraph const &graph, uint32_t pass) const;
+
+private:
+    Device *                             m_pDevice = nullptr;
+    bool                                 m_tier2   = false;
+    std::vector<ID3D12Heap *>            m_heaps;     // Per heap group.
+    std::vector<ID3D12Resource *>        m_resources; // Per graph resource, null for the ones not placed.
+    std::vector<TransientResourceDX12 *> m_handles;
+};
+
+} // namespace HSR_SAMPLE_DX12
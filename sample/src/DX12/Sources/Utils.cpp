@@ -22,6 +22,8 @@ THE SOFTWARE.
 
 #include "Utils.h"
 
+#include <cstring>
+
 void CopyToTexture(ID3D12GraphicsCommandList* cl, ID3D12Resource* source, ID3D12Resource* target, UINT32 width, UINT32 height)
 {
 	D3D12_TEXTURE_COPY_LOCATION src = {};
@@ -70,4 +72,162 @@ ID3D12Resource* AllocCPUVisible(ID3D12Device* pDevice, size_t size) {
 		IID_PPV_ARGS(&pBuffer));
 
 	return pBuffer;
-}
\ No newline at end of file
+}
+
+ID3D12Resource* AllocUpload(ID3D12Device* pDevice, size_t size) {
+	D3D12_HEAP_PROPERTIES heap_properties = {};
+	heap_properties.Type = D3D12_HEAP_TYPE_UPLOAD;
+	heap_properties.CreationNodeMask = 1u;
+	heap_properties.VisibleNodeMask = 1u;
+
+	D3D12_RESOURCE_DESC resource_desc = {};
+	resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resource_desc.Width = size;
+	resource_desc.Height = 1u;
+	resource_desc.DepthOrArraySize = 1u;
+	resource_desc.MipLevels = 1u;
+	resource_desc.SampleDesc.Count = 1u;
+	resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	ID3D12Resource* pBuffer = NULL;
+
+	pDevice->CreateCommittedResource(&heap_properties,
+		D3D12_HEAP_FLAG_NONE,
+		&resource_desc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&pBuffer));
+
+	return pBuffer;
+}
+
+void RetiredPSOQueue::OnDestroy()
+{
+	for (auto& entry : m_entries)
+		entry.pPSO->Release();
+	m_entries.clear();
+}
+
+void RetiredPSOQueue::OnBeginFrame()
+{
+	for (size_t i = 0; i < m_entries.size();)
+	{
+		if (--m_entries[i].framesLeft == 0)
+		{
+			m_entries[i].pPSO->Release();
+			m_entries[i] = m_entries.back();
+			m_entries.pop_back();
+		}
+		else
+			i++;
+	}
+}
+
+void RetiredPSOQueue::Retire(ID3D12PipelineState* pPSO)
+{
+	if (pPSO)
+		m_entries.push_back({ pPSO, m_frameCountBeforeReuse });
+}
+
+bool D3D12TimestampSource::OnCreate(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue, uint32_t slotCount, uint32_t queriesPerSlot)
+{
+	m_queriesPerSlot = queriesPerSlot;
+	if (FAILED(pQueue->GetTimestampFrequency(&m_frequency)) || m_frequency == 0)
+		m_frequency = 1;
+
+	D3D12_QUERY_HEAP_DESC query_heap_desc = {};
+	query_heap_desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	query_heap_desc.Count = slotCount * queriesPerSlot;
+	if (FAILED(pDevice->CreateQueryHeap(&query_heap_desc, IID_PPV_ARGS(&m_pQueryHeap))))
+		return false;
+
+	m_pReadbackBuffer = AllocCPUVisible(pDevice, size_t(slotCount) * queriesPerSlot * sizeof(uint64_t));
+	if (!m_pReadbackBuffer)
+	{
+		OnDestroy();
+		return false;
+	}
+	m_pReadbackBuffer->SetName(L"TimestampQueryBuffer");
+	return true;
+}
+
+void D3D12TimestampSource::OnDestroy()
+{
+	if (m_pQueryHeap)
+	{
+		m_pQueryHeap->Release();
+		m_pQueryHeap = NULL;
+	}
+	if (m_pReadbackBuffer)
+	{
+		m_pReadbackBuffer->Release();
+		m_pReadbackBuffer = NULL;
+	}
+	m_pCommandList = NULL;
+}
+
+void D3D12TimestampSource::WriteTimestamp(uint32_t slot, uint32_t index)
+{
+	if (m_pQueryHeap && m_pCommandList)
+		m_pCommandList->EndQuery(m_pQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, slot * m_queriesPerSlot + index);
+}
+
+void D3D12TimestampSource::ResolveTimestamps(uint32_t slot, uint32_t count)
+{
+	if (m_pQueryHeap && m_pCommandList)
+		m_pCommandList->ResolveQueryData(m_pQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, slot * m_queriesPerSlot, count, m_pReadbackBuffer, slot * m_queriesPerSlot * sizeof(uint64_t));
+}
+
+bool D3D12TimestampSource::ReadTimestamps(uint32_t slot, uint32_t count, uint64_t* pTicks)
+{
+	if (!m_pReadbackBuffer)
+		return false;
+
+	D3D12_RANGE read_range = {};
+	read_range.Begin = slot * m_queriesPerSlot * sizeof(uint64_t);
+	read_range.End = read_range.Begin + count * sizeof(uint64_t);
+
+	uint8_t* pData = NULL;
+	if (FAILED(m_pReadbackBuffer->Map(0u, &read_range, reinterpret_cast<void**>(&pData))))
+		return false;
+	memcpy(pTicks, pData + read_range.Begin, count * sizeof(uint64_t));
+
+	D3D12_RANGE write_range = {};
+	m_pReadbackBuffer->Unmap(0u, &write_range);
+	return true;
+}
+
+void D3D12BarrierSink::ResourceBarriers(TrackedBarrier const* pBarriers, uint32_t count)
+{
+	m_barriers.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		TrackedBarrier const& barrier = pBarriers[i];
+		ID3D12Resource* pResource = const_cast<ID3D12Resource*>(static_cast<ID3D12Resource const*>(barrier.resource));
+		D3D12_RESOURCE_BARRIER& out = m_barriers[i];
+		out = {};
+		switch (barrier.type)
+		{
+		case TrackedBarrierType::Transition:
+			out.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			out.Flags = barrier.split == TrackedBarrierSplit::Begin ? D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY
+				: barrier.split == TrackedBarrierSplit::End ? D3D12_RESOURCE_BARRIER_FLAG_END_ONLY
+				: D3D12_RESOURCE_BARRIER_FLAG_NONE;
+			out.Transition.pResource = pResource;
+			out.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			out.Transition.StateBefore = D3D12_RESOURCE_STATES(barrier.before);
+			out.Transition.StateAfter = D3D12_RESOURCE_STATES(barrier.after);
+			break;
+		case TrackedBarrierType::UnorderedAccess:
+			out.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+			out.UAV.pResource = pResource;
+			break;
+		case TrackedBarrierType::Aliasing:
+			out.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+			out.Aliasing.pResourceAfter = pResource;
+			break;
+		}
+	}
+	if (m_pCommandList && count)
+		m_pCommandList->ResourceBarrier(count, m_barriers.data());
+}
@@ -22,6 +22,68 @@ THE SOFTWARE.
 
 #pragma once
 #include <d3d12.h>
+#include <vector>
+
+#include "GpuTimingCollector.h"
+#include "ResourceStateTracker.h"
 
 void CopyToTexture(ID3D12GraphicsCommandList* cl, ID3D12Resource* source, ID3D12Resource* target, UINT32 width, UINT32 height);
-ID3D12Resource* AllocCPUVisible(ID3D12Device *pDevice, size_t size);
\ No newline at end of file
+ID3D12Resource* AllocCPUVisible(ID3D12Device *pDevice, size_t size);
+// Upload heap buffer in GENERIC_READ, for data the CPU writes every frame and the GPU copies.
+ID3D12Resource* AllocUpload(ID3D12Device *pDevice, size_t size);
+
+// Pipeline states replaced by a shader reload. They are released once every frame that may still reference them has
+// retired, so swapping in a new PSO does not need a GPU flush.
+class RetiredPSOQueue
+{
+public:
+	void OnCreate(uint32_t frameCountBeforeReuse) { m_frameCountBeforeReuse = frameCountBeforeReuse; }
+	void OnDestroy();
+	// Call once per frame before recording.
+	void OnBeginFrame();
+	void Retire(ID3D12PipelineState* pPSO);
+
+private:
+	struct Entry
+	{
+		ID3D12PipelineState* pPSO;
+		uint32_t framesLeft;
+	};
+	std::vector<Entry> m_entries;
+	uint32_t m_frameCountBeforeReuse = 3;
+};
+
+// Timestamp queries on a D3D12 queue, one range of queriesPerSlot queries per ring slot of the GpuTimingCollector.
+class D3D12TimestampSource : public GpuTimestampSource
+{
+public:
+	bool OnCreate(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue, uint32_t slotCount, uint32_t queriesPerSlot);
+	void OnDestroy();
+	// Command list the queries of the current frame are recorded into.
+	void SetCommandList(ID3D12GraphicsCommandList* pCommandList) { m_pCommandList = pCommandList; }
+
+	uint64_t GetFrequency() const override { return m_frequency; }
+	void WriteTimestamp(uint32_t slot, uint32_t index) override;
+	void ResolveTimestamps(uint32_t slot, uint32_t count) override;
+	bool ReadTimestamps(uint32_t slot, uint32_t count, uint64_t* pTicks) override;
+
+private:
+	ID3D12QueryHeap* m_pQueryHeap = NULL;
+	ID3D12Resource* m_pReadbackBuffer = NULL;
+	ID3D12GraphicsCommandList* m_pCommandList = NULL;
+	uint64_t m_frequency = 1;
+	uint32_t m_queriesPerSlot = 0;
+};
+
+// Records the batches of a ResourceStateTracker into a D3D12 command list, one ResourceBarrier call per batch.
+class D3D12BarrierSink : public ResourceBarrierSink
+{
+public:
+	void SetCommandList(ID3D12GraphicsCommandList* pCommandList) { m_pCommandList = pCommandList; }
+
+	void ResourceBarriers(TrackedBarrier const* pBarriers, uint32_t count) override;
+
+private:
+	ID3D12GraphicsCommandList* m_pCommandList = NULL;
+	std::vector<D3D12_RESOURCE_BARRIER> m_barriers;
+};
@@ -39,6 +39,7 @@ Texture2D<float4> g_gbuffer_full_normal;
 Texture2D<float4> g_gbuffer_full_roughness;
 RWTexture2D<float4> g_rw_full_lit_scene;
 SamplerComparisonState g_cmp_sampler; 
+RWByteAddressBuffer g_rw_decal_bins;
 #endif
 
 // Declarations needed for shading and shadow filtering
@@ -47,8 +48,9 @@ SamplerComparisonState g_cmp_sampler;
 #define specularCube g_ctextures[GDT_CTEXTURES_ATMOSPHERE_LUT_SLOT]
 #define myPerFrame g_frame_info.perFrame
 #define ID_shadowMap_declared
-#define SAMPLE_SHADOW_MAP(shadowIndex, UV, Z, IJ)                                                                                                                                  \
-    (g_textures[NonUniformResourceIndex(GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT + shadowIndex)].SampleCmpLevelZero(g_cmp_sampler, (UV).xy, (Z), IJ.xy).r)
+// The shadow atlas takes the first slot of the shadow map range
+#define SAMPLE_SHADOW_MAP(UV, Z, IJ) (g_textures[GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT].SampleCmpLevelZero(g_cmp_sampler, (UV).xy, (Z), IJ.xy).r)
+#define SHADOW_ATLAS_DIMENSIONS(W, H) g_textures[GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT].GetDimensions(W, H)
 
 // Useful functions
 #include "functions.hlsl"
@@ -56,47 +58,60 @@ SamplerComparisonState g_cmp_sampler;
 #include "shadowFiltering.h"
 // Code for shading new fragments
 #include "RTShading.h"
+// Decal volumes and their screen tiles
+#include "DecalBins.h"
 
 float FFX_SSSR_LoadDepth(int2 pixel_coordinate) { return g_gbuffer_full_depth.Load(int3(pixel_coordinate, 0)); }
 
-[numthreads(8, 8, 1)] void main(uint3 dispatch_thread_id
-                                  : SV_DispatchThreadID) {
-
-    uint2  screen_size                     = uint2(g_frame_info.base_width, g_frame_info.base_height);
-    float2 uv                              = float2(dispatch_thread_id.xy + 0.5) / float2(screen_size);
-    float  z                               = FFX_SSSR_LoadDepth(dispatch_thread_id.xy);
+// Blends the decals of the tile's list that cover the pixel's surface into the lit scene, in list order.
+void ApplyDecals(uint2 pixel, uint list, uint count)
+{
+    uint2 screen_size = uint2(g_frame_info.base_width, g_frame_info.base_height);
+    if (any(pixel >= screen_size))
+        return;
+    float z = FFX_SSSR_LoadDepth(pixel);
     if (FFX_DNSR_Reflections_IsBackground(z))
         return;
-    float3 screen_uv_space_ray_origin      = float3(uv, z);
-    float3 view_space_point                = FFX_DNSR_Reflections_ScreenSpaceToViewSpace(screen_uv_space_ray_origin);
-    float3 view_space_ray_direction        = normalize(view_space_point);
-    float3 world_space_point               = mul(float4(view_space_point, 1), g_inv_view).xyz;
-    float3 world_space_direction           = normalize(mul(float4(view_space_ray_direction, 0), g_inv_view).xyz);
-    if (world_space_point.x < 2.0 && world_space_point.x > 0.9 && all(abs(world_space_point.xyz) < 100.0f))
+    float2 uv                = float2(pixel + 0.5) / float2(screen_size);
+    float3 view_space_point  = FFX_DNSR_Reflections_ScreenSpaceToViewSpace(float3(uv, z));
+    float3 world_space_point = mul(float4(view_space_point, 1), g_inv_view).xyz;
+
+    float4 color   = g_rw_full_lit_scene[pixel];
+    bool   covered = false;
+    for (uint i = 0; i < count; ++i)
     {
-        float2 uv = (world_space_point.zy + float2(0.5 - g_frame_info.simulation_time * 0.1f, -0.2)) * 1.0f * float2(1.0f, -1.0f);
-        uint2 size;
-        g_decal_albedo.GetDimensions(size.x, size.y);
-        float ratio = float(size.x) / float(size.y);
-        uv = uv * float2(1.0, ratio);
-        if (uv.y < 0.0 || uv.y > 1.0) return;
-        // uv. = saturate(uv.y);
-        if (frac(uv.x * 0.5) > 0.5) return;
-        float4 albedo = g_decal_albedo.SampleLevel(g_wrap_linear_sampler, uv, abs(view_space_point.z) * 0.1f);
-        float alpha = albedo.a;//max(albedo.x, max(albedo.y, albedo.z));
+        uint   record = DECAL_BINS_HEADER_WORDS + DECAL_BINS_DECAL_WORDS * g_rw_decal_bins.Load(4 * (list + 1 + i));
+        float4 to_u   = asfloat(g_rw_decal_bins.Load4(4 * (record + DECAL_BINS_DECAL_TO_U)));
+        float4 to_v   = asfloat(g_rw_decal_bins.Load4(4 * (record + DECAL_BINS_DECAL_TO_V)));
+        float4 to_w   = asfloat(g_rw_decal_bins.Load4(4 * (record + DECAL_BINS_DECAL_TO_W)));
+        float  u      = DecalBins_Coordinate(to_u.x, to_u.y, to_u.z, to_u.w, world_space_point.x, world_space_point.y, world_space_point.z);
+        float  v      = DecalBins_Coordinate(to_v.x, to_v.y, to_v.z, to_v.w, world_space_point.x, world_space_point.y, world_space_point.z);
+        float  w      = DecalBins_Coordinate(to_w.x, to_w.y, to_w.z, to_w.w, world_space_point.x, world_space_point.y, world_space_point.z);
+        if (!DecalBins_Covers(u, v, w))
+            continue;
+        float2 intensity_opacity = asfloat(g_rw_decal_bins.Load2(4 * (record + DECAL_BINS_DECAL_INTENSITY)));
+        float4 albedo            = g_decal_albedo.SampleLevel(g_wrap_linear_sampler, float2(u, v), abs(view_space_point.z) * 0.1f);
+        color                    = lerp(color, float4(albedo.xyz * intensity_opacity.x, 1.0f), albedo.a * intensity_opacity.y);
+        covered                  = true;
+    }
+    if (covered)
+        g_rw_full_lit_scene[pixel] = color;
+}
 
-        // float3 central_normal       = normalize(g_gbuffer_full_normal.Load(int3(dispatch_thread_id.xy, 0)).xyz * 2.0f - 1.0f);
-        // float4 central_roughness    = g_gbuffer_full_roughness.Load(int3(dispatch_thread_id.xy, 0));
-        // ShadingInfo local_basis;
-        // local_basis.WorldPos  = world_space_point;
-        // local_basis.Normal    = central_normal;
-        // local_basis.View      = -world_space_direction;
-        // local_basis.Albedo    = float3(0.0f, 0.0f, 0.0f);
-        // local_basis.Roughness = 1.0f;
-        // local_basis.Metalness = 0.0f;
-        // float3 radiance       = doPbrLighting(local_basis, myPerFrame) + float3(2.3, 4.0, 1.4);
+// One group per screen tile with decals, see DecalBins.h. Coarsened tiles take several passes of the group.
+[numthreads(DECAL_BINS_TILE_SIZE, DECAL_BINS_TILE_SIZE, 1)] void main(uint group_id
+                                                                       : SV_GroupID, uint2 group_thread_id
+                                                                       : SV_GroupThreadID) {
 
-        g_rw_full_lit_scene[dispatch_thread_id.xy] = lerp(g_rw_full_lit_scene[dispatch_thread_id.xy], float4(albedo.xyz * 10.0, 1.0f), alpha);
+    uint  tile_size = g_rw_decal_bins.Load(4 * DECAL_BINS_TILE_SIZE_WORD);
+    uint2 entry     = g_rw_decal_bins.Load2(4 * (g_rw_decal_bins.Load(4 * DECAL_BINS_OCCUPIED_TILES) + 2 * group_id));
+    uint2 corner    = uint2(DecalBins_TileX(entry.x), DecalBins_TileY(entry.x)) * tile_size;
+    uint  count     = g_rw_decal_bins.Load(4 * entry.y);
+    for (uint y = group_thread_id.y; y < tile_size; y += DECAL_BINS_TILE_SIZE)
+    {
+        for (uint x = group_thread_id.x; x < tile_size; x += DECAL_BINS_TILE_SIZE)
+        {
+            ApplyDecals(corner + uint2(x, y), entry.y, count);
+        }
     }
-    
-}
\ No newline at end of file
+}
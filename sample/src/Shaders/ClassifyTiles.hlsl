@@ -164,7 +164,7 @@ void FFX_DNSR_Reflections_FillEnvironment(uint2 ray_coord, float factor) {
     float3 world_space_ray_origin          = mul(float4(view_space_ray, 1), g_inv_view).xyz;
     float3 env_sample                      = (1.0 - roughness) * FFX_GetEnvironmentSample(world_space_ray_origin, normalize(world_space_reflected_direction), roughness);
 
-    g_rw_radiance_0[ray_coord]     = env_sample.xyzz * factor;
+    g_rw_radiance_0[ray_coord]     = FFX_Reflections_QuantizeRadiance(env_sample * factor, ray_coord, FFX_REFLECTIONS_RADIANCE_DITHER_INTERSECT);
 }
 void FFX_DNSR_Reflections_ZeroBuffers(uint2 dispatch_thread_id) {
     g_rw_radiance_0[dispatch_thread_id]          = (0.0f).xxx;
@@ -0,0 +1,111 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// View space clusters (froxels) of the lights for the forward lighting of the raster pass (doPbrLighting in
+// GLTFPBRLighting.hlsl). Shared by the shaders and the C++ builder (namespace ClusteredLightsModel, see
+// ClusteredLightsBuilder.h of the sample).
+//
+// The view frustum is split in screen tiles and depth slices. Slice 0 ends at the near depth, the others split the
+// depths up to the farthest point a bounded light reaches exponentially. A point finds its cluster from its offset to
+// the eye, so the raster passes of every resolution use the same clusters. The outer tiles extend past the screen
+// and the last slice past the farthest light, no bounded light reaches a point there that its cluster does not list.
+// As in LightGrid.h the global lights come first, then the cluster lists, both ordered by light index, and the shader
+// skips the candidates that fail LightGrid_Influences.
+//
+// The clusters are one buffer of uints:
+//   CLUSTERED_LIGHTS_HEADER_WORDS words of header, see below,
+//   the global light indices,
+//   the cluster table, two words per cluster: word offset and size of the cluster's list, clusters ordered by tile x,
+//   then tile y, then slice,
+//   the cluster lists.
+// Without clusters, dimensions 0, every light is global.
+
+#ifndef CLUSTERED_LIGHTS_H
+#define CLUSTERED_LIGHTS_H
+
+#include "LightGrid.h"
+
+#define CLUSTERED_LIGHTS_EYE 0          // 3 floats, world space.
+#define CLUSTERED_LIGHTS_X_AXIS 3       // 3 floats, camera right divided by the tangent of the horizontal half field of view.
+#define CLUSTERED_LIGHTS_Y_AXIS 6       // 3 floats, camera up divided by the tangent of the vertical half field of view.
+#define CLUSTERED_LIGHTS_DEPTH_AXIS 9   // 3 floats, unit vector the camera looks along.
+#define CLUSTERED_LIGHTS_NEAR_DEPTH 12  // float
+#define CLUSTERED_LIGHTS_SLICE_SCALE 13 // float, depth slices per unit of log(depth / near depth).
+#define CLUSTERED_LIGHTS_DIMENSIONS 14  // 3 uints, tiles along x and y and depth slices.
+#define CLUSTERED_LIGHTS_GLOBAL_COUNT 17
+#define CLUSTERED_LIGHTS_CLUSTER_TABLE 18 // Word offset of the cluster table.
+#define CLUSTERED_LIGHTS_LIGHT_COUNT 19
+#define CLUSTERED_LIGHTS_HEADER_WORDS 20
+
+#define CLUSTERED_LIGHTS_MAX_WORDS (1u << 19) // Size of the GPU buffer.
+#define CLUSTERED_LIGHTS_NO_CLUSTER 0xffffffffu
+
+// Depth that points at or behind the eye are projected with, they are never rasterized.
+#define CLUSTERED_LIGHTS_MIN_DEPTH 1.0e-6f
+
+#ifndef __HLSL_VERSION
+
+#    include <cmath>
+#    include <cstdint>
+
+namespace ClusteredLightsModel {
+
+typedef uint32_t uint;
+using std::floor;
+using std::log;
+
+#    define CLUSTERED_LIGHTS_INLINE static inline
+#else
+#    define CLUSTERED_LIGHTS_INLINE
+#endif
+
+// Tile of a normalized device coordinate along one axis, the first and the last tile extend past the screen.
+CLUSTERED_LIGHTS_INLINE uint ClusteredLights_Tile(float ndc, uint tiles) {
+    float tile = floor((ndc * 0.5f + 0.5f) * float(tiles));
+    tile       = tile < 0.0f ? 0.0f : tile;
+    return tile < float(tiles - 1) ? uint(tile) : tiles - 1;
+}
+
+// Depth slice, 0 up to the near depth.
+CLUSTERED_LIGHTS_INLINE uint ClusteredLights_Slice(float depth, float near_depth, float slice_scale, uint slices) {
+    if (!(depth > near_depth)) return 0;
+    float slice = 1.0f + floor(log(depth / near_depth) * slice_scale);
+    return slice < float(slices - 1) ? uint(slice) : slices - 1;
+}
+
+// Cluster of the point whose offset to the eye is (x, y) along the axes CLUSTERED_LIGHTS_X_AXIS and
+// CLUSTERED_LIGHTS_Y_AXIS and 'depth' along CLUSTERED_LIGHTS_DEPTH_AXIS. CLUSTERED_LIGHTS_NO_CLUSTER without clusters.
+CLUSTERED_LIGHTS_INLINE uint ClusteredLights_Cluster(float x, float y, float depth, float near_depth, float slice_scale, uint nx, uint ny, uint nz) {
+    if (nx * ny * nz == 0) return CLUSTERED_LIGHTS_NO_CLUSTER;
+    float inv_depth = 1.0f / (depth > CLUSTERED_LIGHTS_MIN_DEPTH ? depth : CLUSTERED_LIGHTS_MIN_DEPTH);
+    uint  tile_x    = ClusteredLights_Tile(x * inv_depth, nx);
+    uint  tile_y    = ClusteredLights_Tile(y * inv_depth, ny);
+    return (ClusteredLights_Slice(depth, near_depth, slice_scale, nz) * ny + tile_y) * nx + tile_x;
+}
+
+#undef CLUSTERED_LIGHTS_INLINE
+
+#ifndef __HLSL_VERSION
+} // namespace ClusteredLightsModel
+#endif
+
+#endif // CLUSTERED_LIGHTS_H
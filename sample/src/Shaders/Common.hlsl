@@ -20,6 +20,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 ********************************************************************/
 
+#include "PackedRadiance.h"
 
 #define GOLDEN_RATIO 1.61803398875f
 #define FFX_REFLECTIONS_SKY_DISTANCE 100.0f
@@ -249,6 +250,19 @@ float2 SampleRandomVector2D(uint2 pixel, int frame_offset = 0, int frame = g_fra
     return u;
 }
 
+// Radiance as stored in the radiance targets. With HSR_PACKED_RADIANCE they are R11G11B10 and the value is dithered
+// onto that grid, see PackedRadiance.h. stream is one of FFX_REFLECTIONS_RADIANCE_DITHER_*.
+float3 FFX_Reflections_QuantizeRadiance(float3 radiance, uint2 pixel_coordinate, uint stream) {
+#ifdef HSR_PACKED_RADIANCE
+    uint seed = g_frame_index * FFX_REFLECTIONS_RADIANCE_DITHER_STREAMS + stream;
+    return float3(FFX_Reflections_QuantizeRadianceRG(radiance.x, FFX_Reflections_RadianceDitherNoise(pixel_coordinate.x, pixel_coordinate.y, seed, 0u)),
+                  FFX_Reflections_QuantizeRadianceRG(radiance.y, FFX_Reflections_RadianceDitherNoise(pixel_coordinate.x, pixel_coordinate.y, seed, 1u)),
+                  FFX_Reflections_QuantizeRadianceB(radiance.z, FFX_Reflections_RadianceDitherNoise(pixel_coordinate.x, pixel_coordinate.y, seed, 2u)));
+#else
+    return radiance;
+#endif
+}
+
 float3 SampleReflectionVector(float3 view_direction, float3 normal, float roughness, int2 dispatch_thread_id) {
     if (roughness < 0.001f) {
         return reflect(view_direction, normal);
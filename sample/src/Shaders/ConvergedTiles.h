@@ -0,0 +1,88 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Classification of the denoise tiles that can keep last frame's result (HSR_CONVERGED_TILES).
+// Shared by ConvergedTiles.hlsl and the C++ model (namespace ConvergedTilesModel) that sizes the savings on captures.
+//
+// A tile of the denoise list is converged when, over its glossy pixels:
+//   - nothing moved, every motion vector is below FFX_REFLECTIONS_CONVERGED_MAX_MOTION,
+//   - the history is full, the sample count reached the cap of the temporal pass, max(8, max_history_samples * roughness),
+//   - the history is stable, the temporal variance is below FFX_REFLECTIONS_CONVERGED_MAX_VARIANCE,
+//   - and the new samples agree with it, the summed luminance of this frame's intersection results is within
+//     FFX_REFLECTIONS_CONVERGED_LUMINANCE_TOLERANCE of the summed history. This catches lights and materials that
+//     change without moving anything.
+// Converged tiles skip reproject, prefilter and temporal and copy their history to the outputs instead. Every
+// FFX_REFLECTIONS_CONVERGED_REFRESH_PERIOD frames each tile is denoised anyway, staggered over the tiles, so changes
+// below the tolerance still make it in.
+
+#ifndef CONVERGED_TILES_H
+#define CONVERGED_TILES_H
+
+#define FFX_REFLECTIONS_CONVERGED_MAX_MOTION 1.0e-5f          // Motion vector units, uv.
+#define FFX_REFLECTIONS_CONVERGED_MAX_VARIANCE 0.002f         // See ComputeTemporalVariance of the denoiser.
+#define FFX_REFLECTIONS_CONVERGED_LUMINANCE_TOLERANCE 0.25f   // Relative to the larger of the two sums.
+#define FFX_REFLECTIONS_CONVERGED_LUMINANCE_FLOOR 0.01f       // Per glossy pixel, keeps dark tiles from never converging.
+#define FFX_REFLECTIONS_CONVERGED_REFRESH_PERIOD 8u
+
+#ifndef __HLSL_VERSION
+
+#    include <cstdint>
+
+namespace ConvergedTilesModel {
+
+typedef uint32_t uint;
+
+#    define FFX_CONVERGED_TILES_INLINE static inline
+#else
+#    define FFX_CONVERGED_TILES_INLINE
+#endif
+
+FFX_CONVERGED_TILES_INLINE float FFX_Reflections_ConvergedLuminance(float r, float g, float b) { return 0.299f * r + 0.587f * g + 0.114f * b; }
+
+// Per glossy pixel, false if the pixel keeps its tile from converging. The sample count is stored as fp16, hence the margin.
+FFX_CONVERGED_TILES_INLINE bool FFX_Reflections_IsPixelConverged(float motion_x, float motion_y, float num_samples_history, float variance_history, float roughness,
+                                                                  uint max_history_samples, float max_variance) {
+    float max_samples = float(max_history_samples) * roughness;
+    max_samples       = max_samples > 8.0f ? max_samples : 8.0f;
+    bool  is_static   = motion_x * motion_x + motion_y * motion_y <= FFX_REFLECTIONS_CONVERGED_MAX_MOTION * FFX_REFLECTIONS_CONVERGED_MAX_MOTION;
+    return is_static && num_samples_history >= max_samples - 0.5f && variance_history <= max_variance;
+}
+
+// Summed luminance over the glossy pixels of a tile, of this frame's intersection results and of the history.
+FFX_CONVERGED_TILES_INLINE bool FFX_Reflections_IsTileLuminanceStable(float luminance, float history_luminance, uint glossy_pixels, float tolerance) {
+    float difference = luminance > history_luminance ? luminance - history_luminance : history_luminance - luminance;
+    float larger     = luminance > history_luminance ? luminance : history_luminance;
+    return difference <= tolerance * larger + FFX_REFLECTIONS_CONVERGED_LUMINANCE_FLOOR * float(glossy_pixels);
+}
+
+// tile_x/y in tiles. Spreads the refreshes evenly over the frames for any tile pattern wider than the period.
+FFX_CONVERGED_TILES_INLINE bool FFX_Reflections_IsConvergedTileRefresh(uint tile_x, uint tile_y, uint frame_index) {
+    return (tile_x + 3u * tile_y + frame_index) % FFX_REFLECTIONS_CONVERGED_REFRESH_PERIOD == 0u;
+}
+
+#undef FFX_CONVERGED_TILES_INLINE
+
+#ifndef __HLSL_VERSION
+} // namespace ConvergedTilesModel
+#endif
+
+#endif // CONVERGED_TILES_H
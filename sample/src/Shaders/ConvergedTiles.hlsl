@@ -0,0 +1,146 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include "Declarations.h"
+
+HLSL_INIT_GLOBAL_BINDING_TABLE(1)
+
+#include "Common.hlsl"
+#include "ConvergedTiles.h"
+
+/////////////////////////////////////////////////////
+// Used resources:                                 //
+// See aliases in Descriptors.h and Declarations.h // 
+/////////////////////////////////////////////////////
+
+#if 0
+Texture2D<min16float3> g_radiance_0; // Radiance target 0 - intersection results 
+Texture2D<min16float3> g_radiance_1; // Radiance target 1 - history radiance 
+Texture2D<min16float> g_radiance_variance_1; // Variance target 1 - history 
+Texture2D<min16float> g_radiance_num_samples_1; // Sample count target 1 - history 
+Texture2D<float4> g_radiance_mip_prev; // 8x8 average radiance history 
+Texture2D<float4> g_motion_vector; // Current GBuffer/motion_vectors in reflection target resolution 
+Texture2D<float4> g_extracted_roughness; // Current extracted GBuffer/roughness in reflection target resolution 
+RWTexture2D<min16float3> g_rw_radiance_0; // Radiance target 0 - intersection results 
+RWTexture2D<min16float> g_rw_radiance_variance_0; // Variance target 0 - current variance/ray length 
+RWTexture2D<min16float> g_rw_radiance_num_samples_0; // Sample counter target 0 - current 
+RWTexture2D<float4> g_rw_radiance_avg; // 8x8 average radiance 
+RWByteAddressBuffer g_rw_denoise_tile_list; 
+RWByteAddressBuffer g_rw_active_denoise_tile_list; // Denoise tiles that are not converged, see ConvergedTiles.h 
+RWByteAddressBuffer g_rw_converged_tile_list; // Denoise tiles that keep their history, see ConvergedTiles.h 
+RWByteAddressBuffer g_rw_ray_counter; 
+RWByteAddressBuffer g_rw_indirect_args; 
+#endif
+
+// Splits the denoise tile list into the tiles the denoiser passes run on and the converged ones, see ConvergedTiles.h.
+// Runs between the intersection and the reproject pass, KeepConvergedHistory after the temporal pass.
+
+groupshared float g_converged_luminance[64];
+groupshared float g_converged_history_luminance[64];
+groupshared uint  g_converged_glossy_pixels;
+groupshared uint  g_converged_blocked;
+
+// One group per entry of the denoise tile list, dispatched with INDIRECT_ARGS_DENOISE_OFFSET.
+[numthreads(8, 8, 1)]
+void ClassifyConvergedTiles(uint2 group_thread_id : SV_GroupThreadID, uint group_index : SV_GroupIndex, uint group_id : SV_GroupID) {
+    uint  packed_coords    = g_rw_denoise_tile_list.Load(4 * group_id);
+    uint2 tile_origin      = uint2(packed_coords & 0xffffu, (packed_coords >> 16) & 0xffffu);
+    uint2 pixel_coordinate = tile_origin + group_thread_id;
+    if (group_index == 0) {
+        g_converged_glossy_pixels = 0;
+        g_converged_blocked       = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    float luminance         = 0.0;
+    float history_luminance = 0.0;
+    float roughness         = g_extracted_roughness.Load(int3(pixel_coordinate, 0)).x;
+    if (all(pixel_coordinate < uint2(g_frame_info.reflection_width, g_frame_info.reflection_height)) && FFX_DNSR_Reflections_IsGlossyReflection(roughness)) {
+        float2 motion_vector = g_motion_vector.Load(int3(pixel_coordinate, 0)).xy;
+        float  num_samples   = g_radiance_num_samples_1.Load(int3(pixel_coordinate, 0)).x;
+        float  variance      = g_radiance_variance_1.Load(int3(pixel_coordinate, 0)).x;
+        if (!FFX_Reflections_IsPixelConverged(motion_vector.x, motion_vector.y, num_samples, variance, roughness, g_frame_info.max_history_samples, FFX_REFLECTIONS_CONVERGED_MAX_VARIANCE))
+            InterlockedOr(g_converged_blocked, 1u);
+        InterlockedAdd(g_converged_glossy_pixels, 1u);
+        float3 radiance         = g_radiance_0.Load(int3(pixel_coordinate, 0)).xyz;
+        float3 history_radiance = g_radiance_1.Load(int3(pixel_coordinate, 0)).xyz;
+        luminance               = FFX_Reflections_ConvergedLuminance(radiance.x, radiance.y, radiance.z);
+        history_luminance       = FFX_Reflections_ConvergedLuminance(history_radiance.x, history_radiance.y, history_radiance.z);
+    }
+    g_converged_luminance[group_index]         = luminance;
+    g_converged_history_luminance[group_index] = history_luminance;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint stride = 32; stride > 0; stride >>= 1) {
+        if (group_index < stride) {
+            g_converged_luminance[group_index] += g_converged_luminance[group_index + stride];
+            g_converged_history_luminance[group_index] += g_converged_history_luminance[group_index + stride];
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+    if (group_index != 0) return;
+
+    uint2 tile      = tile_origin / 8;
+    bool  converged = g_converged_glossy_pixels > 0 && g_converged_blocked == 0                                                                                          //
+                     && FFX_Reflections_IsTileLuminanceStable(g_converged_luminance[0], g_converged_history_luminance[0], g_converged_glossy_pixels, FFX_REFLECTIONS_CONVERGED_LUMINANCE_TOLERANCE) //
+                     && !FFX_Reflections_IsConvergedTileRefresh(tile.x, tile.y, g_frame_index);
+    uint index;
+    if (converged) {
+        g_rw_ray_counter.InterlockedAdd(RAY_COUNTER_CONVERGED_TILES_OFFSET, 1, index);
+        g_rw_converged_tile_list.Store(4 * index, packed_coords);
+    } else {
+        g_rw_ray_counter.InterlockedAdd(RAY_COUNTER_ACTIVE_DENOISE_OFFSET, 1, index);
+        g_rw_active_denoise_tile_list.Store(4 * index, packed_coords);
+    }
+}
+
+[numthreads(1, 1, 1)]
+void PrepareConvergedTileArgs() {
+    uint active_tile_count    = g_rw_ray_counter.Load(RAY_COUNTER_ACTIVE_DENOISE_OFFSET);
+    uint converged_tile_count = g_rw_ray_counter.Load(RAY_COUNTER_CONVERGED_TILES_OFFSET);
+
+    g_rw_indirect_args.Store(INDIRECT_ARGS_ACTIVE_DENOISE_OFFSET + 0, active_tile_count);
+    g_rw_indirect_args.Store(INDIRECT_ARGS_ACTIVE_DENOISE_OFFSET + 4, 1);
+    g_rw_indirect_args.Store(INDIRECT_ARGS_ACTIVE_DENOISE_OFFSET + 8, 1);
+
+    g_rw_indirect_args.Store(INDIRECT_ARGS_CONVERGED_TILES_OFFSET + 0, converged_tile_count);
+    g_rw_indirect_args.Store(INDIRECT_ARGS_CONVERGED_TILES_OFFSET + 4, 1);
+    g_rw_indirect_args.Store(INDIRECT_ARGS_CONVERGED_TILES_OFFSET + 8, 1);
+
+    g_rw_ray_counter.Store(RAY_COUNTER_ACTIVE_DENOISE_OFFSET, 0);
+    g_rw_ray_counter.Store(RAY_COUNTER_CONVERGED_TILES_OFFSET, 0);
+}
+
+// One group per converged tile, dispatched with INDIRECT_ARGS_CONVERGED_TILES_OFFSET. Writes what the temporal pass
+// would have, last frame's result, so the next frame finds the same history.
+[numthreads(8, 8, 1)]
+void KeepConvergedHistory(uint2 group_thread_id : SV_GroupThreadID, uint group_index : SV_GroupIndex, uint group_id : SV_GroupID) {
+    uint  packed_coords    = g_rw_converged_tile_list.Load(4 * group_id);
+    uint2 tile_origin      = uint2(packed_coords & 0xffffu, (packed_coords >> 16) & 0xffffu);
+    uint2 pixel_coordinate = tile_origin + group_thread_id;
+    if (group_index == 0) g_rw_radiance_avg[tile_origin / 8] = g_radiance_mip_prev.Load(int3(tile_origin / 8, 0));
+
+    float roughness = g_extracted_roughness.Load(int3(pixel_coordinate, 0)).x;
+    if (any(pixel_coordinate >= uint2(g_frame_info.reflection_width, g_frame_info.reflection_height)) || !FFX_DNSR_Reflections_IsGlossyReflection(roughness)) return;
+    g_rw_radiance_0[pixel_coordinate]             = g_radiance_1.Load(int3(pixel_coordinate, 0)).xyz;
+    g_rw_radiance_variance_0[pixel_coordinate]    = g_radiance_variance_1.Load(int3(pixel_coordinate, 0)).x;
+    g_rw_radiance_num_samples_0[pixel_coordinate] = g_radiance_num_samples_1.Load(int3(pixel_coordinate, 0)).x;
+}
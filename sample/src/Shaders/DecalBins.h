@@ -0,0 +1,87 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Screen tiles of the decal volumes for ApplyDecals.hlsl. Shared by the shader and the C++ binning (namespace
+// DecalBinsModel, see DecalBinning.h of the sample).
+//
+// A decal is an oriented box that projects its texture along its third axis. Its record maps a world space point to
+// decal coordinates (u, v, w): the texture coordinates, 0 to 1 across the box, and the depth into the box, -1 to 1.
+// The decals outside of the view frustum are culled on the CPU, the others listed in every tile of
+// DECAL_BINS_TILE_SIZE pixels (or a multiple, see DECAL_BINS_TILE_SIZE_WORD) their screen rectangle touches. Only those
+// tiles run a thread group, which applies the tile's decals in list order with DecalBins_Covers as the exact test.
+//
+// The bins are one buffer of uints:
+//   DECAL_BINS_HEADER_WORDS words of header, see below,
+//   the visible decals, DECAL_BINS_DECAL_WORDS words each, in the order they were given,
+//   the occupied tiles, two words each: the packed tile and the word offset of its list,
+//   the lists, each a count followed by indices into the visible decals, in increasing order.
+
+#ifndef DECAL_BINS_H
+#define DECAL_BINS_H
+
+#define DECAL_BINS_TILE_SIZE_WORD 0 // Pixels, a multiple of DECAL_BINS_TILE_SIZE.
+#define DECAL_BINS_DECAL_COUNT 1    // Visible decals.
+#define DECAL_BINS_OCCUPIED_COUNT 2 // Tiles with decals, thread groups of the dispatch.
+#define DECAL_BINS_OCCUPIED_TILES 3 // Word offset of the occupied tiles.
+#define DECAL_BINS_HEADER_WORDS 4
+
+// Decal record
+#define DECAL_BINS_DECAL_TO_U 0 // 4 floats, u = dot(this, (x, y, z, 1)).
+#define DECAL_BINS_DECAL_TO_V 4 // 4 floats.
+#define DECAL_BINS_DECAL_TO_W 8 // 4 floats.
+#define DECAL_BINS_DECAL_INTENSITY 12
+#define DECAL_BINS_DECAL_OPACITY 13
+#define DECAL_BINS_DECAL_WORDS 16
+
+#define DECAL_BINS_TILE_SIZE 16         // Thread group width and height.
+#define DECAL_BINS_MAX_WORDS (1u << 20) // Size of the GPU buffer.
+
+#ifndef __HLSL_VERSION
+
+#    include <cstdint>
+
+namespace DecalBinsModel {
+
+typedef uint32_t uint;
+
+#    define DECAL_BINS_INLINE static inline
+#else
+#    define DECAL_BINS_INLINE
+#endif
+
+DECAL_BINS_INLINE uint DecalBins_PackTile(uint x, uint y) { return x | (y << 16u); }
+DECAL_BINS_INLINE uint DecalBins_TileX(uint packed) { return packed & 0xffffu; }
+DECAL_BINS_INLINE uint DecalBins_TileY(uint packed) { return packed >> 16u; }
+
+// One decal coordinate of point (px, py, pz), 'r' being the row of the record.
+DECAL_BINS_INLINE float DecalBins_Coordinate(float rx, float ry, float rz, float rw, float px, float py, float pz) { return rx * px + ry * py + rz * pz + rw; }
+
+// Whether the point with decal coordinates (u, v, w) is inside of the box.
+DECAL_BINS_INLINE bool DecalBins_Covers(float u, float v, float w) { return u >= 0.0f && u <= 1.0f && v >= 0.0f && v <= 1.0f && w >= -1.0f && w <= 1.0f; }
+
+#undef DECAL_BINS_INLINE
+
+#ifndef __HLSL_VERSION
+} // namespace DecalBinsModel
+#endif
+
+#endif // DECAL_BINS_H
@@ -162,7 +162,7 @@ struct PerFrame {
     int3 u_padding;
     int  u_lightCount;
 
-    Light u_lights[MAX_LIGHT_INSTANCES];
+    // Cauldron's per_frame goes on with the lights, they are uploaded to g_rw_lights instead (see LightList.h).
 };
 
 struct FrameInfo {
@@ -266,14 +266,25 @@ struct FrameInfo {
 #define RAY_COUNTER_DENOISE_HISTORY_OFFSET 12
 #define RAY_COUNTER_HW_OFFSET 16
 #define RAY_COUNTER_HW_HISTORY_OFFSET 20
+#define RAY_COUNTER_ACTIVE_DENOISE_OFFSET 24
+#define RAY_COUNTER_CONVERGED_TILES_OFFSET 28
 
 #define INDIRECT_ARGS_SW_OFFSET 0
 #define INDIRECT_ARGS_DENOISE_OFFSET 12
 #define INDIRECT_ARGS_APPLY_OFFSET 24
 #define INDIRECT_ARGS_HW_OFFSET 36
+#define INDIRECT_ARGS_ACTIVE_DENOISE_OFFSET 48
+#define INDIRECT_ARGS_CONVERGED_TILES_OFFSET 60
 
 #include "Descriptors.h"
 
+// Tiles the reproject, prefilter and temporal passes run on. With HSR_CONVERGED_TILES the converged ones are left out.
+#ifdef HSR_CONVERGED_TILES
+#    define g_rw_denoise_pass_tile_list g_rw_active_denoise_tile_list
+#else
+#    define g_rw_denoise_pass_tile_list g_rw_denoise_tile_list
+#endif
+
 // Use hitcounter feedback
 #define HSR_FLAGS_USE_HIT_COUNTER (1 << 0)
 // Traverse in screen space
@@ -0,0 +1,61 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Plane layout of the denoiser capture buffer written by DenoiserCapture.hlsl and read by the CPU reference
+// (DenoiserReference.h). Every plane is reflection_width x reflection_height fp32 values, row major. Planes of the
+// 8x8 average radiance only use their top left RoundedDivide(width, 8) x RoundedDivide(height, 8) corner.
+// Values are stored as the denoiser reads them: normals still encoded to [0, 1], motion vectors before the
+// (0.5, -0.5) scale, depth as the non linear device depth.
+
+#ifndef DENOISER_CAPTURE_H
+#define DENOISER_CAPTURE_H
+
+// Frame inputs, captured right before the reproject pass.
+#define DENOISER_CAPTURE_RADIANCE 0               // 3 planes, intersection results
+#define DENOISER_CAPTURE_RAY_LENGTH 3
+#define DENOISER_CAPTURE_DEPTH 4
+#define DENOISER_CAPTURE_NORMAL 5                 // 3 planes
+#define DENOISER_CAPTURE_MOTION_VECTOR 8          // 2 planes
+#define DENOISER_CAPTURE_ROUGHNESS 10
+#define DENOISER_CAPTURE_ROUGHNESS_HISTORY 11
+#define DENOISER_CAPTURE_RADIANCE_HISTORY 12      // 3 planes
+#define DENOISER_CAPTURE_VARIANCE_HISTORY 15
+#define DENOISER_CAPTURE_NUM_SAMPLES_HISTORY 16
+#define DENOISER_CAPTURE_DEPTH_HISTORY 17
+#define DENOISER_CAPTURE_NORMAL_HISTORY 18        // 3 planes
+#define DENOISER_CAPTURE_AVG_RADIANCE_HISTORY 21  // 3 planes, 8x8 average
+// Reproject outputs.
+#define DENOISER_CAPTURE_REPROJECTED_RADIANCE 24  // 3 planes
+#define DENOISER_CAPTURE_REPROJECTED_VARIANCE 27
+#define DENOISER_CAPTURE_NUM_SAMPLES 28
+#define DENOISER_CAPTURE_AVG_RADIANCE 29          // 3 planes, 8x8 average
+// Prefilter outputs.
+#define DENOISER_CAPTURE_PREFILTERED_RADIANCE 32  // 3 planes
+#define DENOISER_CAPTURE_PREFILTERED_VARIANCE 35
+// Temporal accumulation outputs.
+#define DENOISER_CAPTURE_TEMPORAL_RADIANCE 36     // 3 planes
+#define DENOISER_CAPTURE_TEMPORAL_VARIANCE 39
+// 1 for the pixels of the tiles the denoiser ran on, 0 elsewhere. Outputs outside of them are stale.
+#define DENOISER_CAPTURE_TILE_MASK 40
+#define DENOISER_CAPTURE_PLANE_COUNT 41
+
+#endif // DENOISER_CAPTURE_H
@@ -0,0 +1,133 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include "Declarations.h"
+
+HLSL_INIT_GLOBAL_BINDING_TABLE(1)
+
+#include "Common.hlsl"
+#include "DenoiserCapture.h"
+
+/////////////////////////////////////////////////////
+// Used resources:                                 //
+// See aliases in Descriptors.h and Declarations.h // 
+/////////////////////////////////////////////////////
+
+#if 0
+Texture2D<min16float3> g_radiance_0; // Radiance target 0 - intersection results 
+Texture2D<min16float3> g_radiance_1; // Radiance target 1 - history radiance 
+Texture2D<min16float3> g_radiance_reprojected; // Radiance target 2 - reprojected results 
+Texture2D<min16float> g_radiance_variance_0; // Variance target 0 - current variance/ray length 
+Texture2D<min16float> g_radiance_variance_1; // Variance target 1 - history 
+Texture2D<min16float> g_radiance_num_samples_0; // Sample counter target 0 - current 
+Texture2D<min16float> g_radiance_num_samples_1; // Sample count target 1 - history 
+Texture2D<float4> g_radiance_mip; // 8x8 average radiance 
+Texture2D<float4> g_radiance_mip_prev; // 8x8 average radiance history 
+Texture2D<float4> g_gbuffer_depth; // Current GBuffer/depth in reflection target resolution 
+Texture2D<float4> g_gbuffer_normal; // Current GBuffer/normal in reflection target resolution 
+Texture2D<float4> g_motion_vector; // Current GBuffer/motion_vectors in reflection target resolution 
+Texture2D<float4> g_extracted_roughness; // Current extracted GBuffer/roughness in reflection target resolution 
+Texture2D<float4> g_extracted_roughness_history; // Previous extracted GBuffer/roughness in reflection target resolution 
+Texture2D<float4> g_gbuffer_depth_history; // Previous GBuffer/depth in reflection target resolution 
+Texture2D<float4> g_gbuffer_normal_history; // Previous GBuffer/normal in reflection target resolution 
+RWByteAddressBuffer g_rw_denoise_pass_tile_list; // g_rw_denoise_tile_list or g_rw_active_denoise_tile_list
+RWByteAddressBuffer g_rw_denoiser_capture; 
+#endif
+
+// Copies the denoiser inputs and the output of each denoiser pass into the fp32 planes of g_rw_denoiser_capture, see
+// DenoiserCapture.h and HSR::CaptureDenoiser. Every resource is read through the same binding the denoiser passes
+// use, so the capture sees what they saw whatever the GBuffer setup is.
+
+void StorePlane(uint plane, uint2 pixel_coordinate, float value) {
+    uint2 dimensions = uint2(g_frame_info.reflection_width, g_frame_info.reflection_height);
+    uint  index      = plane * dimensions.x * dimensions.y + pixel_coordinate.y * dimensions.x + pixel_coordinate.x;
+    g_rw_denoiser_capture.Store(4 * index, asuint(value));
+}
+
+void StorePlanes(uint first_plane, uint2 pixel_coordinate, float3 value) {
+    StorePlane(first_plane + 0, pixel_coordinate, value.x);
+    StorePlane(first_plane + 1, pixel_coordinate, value.y);
+    StorePlane(first_plane + 2, pixel_coordinate, value.z);
+}
+
+bool IsInsideAverageRadiance(uint2 pixel_coordinate) {
+    return all(pixel_coordinate < (uint2(g_frame_info.reflection_width, g_frame_info.reflection_height) + 7) / 8);
+}
+
+bool IsInsideReflectionTarget(uint2 pixel_coordinate) { return all(pixel_coordinate < uint2(g_frame_info.reflection_width, g_frame_info.reflection_height)); }
+
+// Before Reproject. Also clears the tile mask, CaptureTileMask fills it afterwards.
+[numthreads(8, 8, 1)]
+void CaptureInputs(uint2 dispatch_thread_id : SV_DispatchThreadID) {
+    if (!IsInsideReflectionTarget(dispatch_thread_id)) return;
+    int3 coord = int3(dispatch_thread_id, 0);
+    StorePlanes(DENOISER_CAPTURE_RADIANCE, dispatch_thread_id, g_radiance_0.Load(coord).xyz);
+    StorePlane(DENOISER_CAPTURE_RAY_LENGTH, dispatch_thread_id, g_radiance_variance_0.Load(coord).x);
+    StorePlane(DENOISER_CAPTURE_DEPTH, dispatch_thread_id, g_gbuffer_depth.Load(coord).x);
+    StorePlanes(DENOISER_CAPTURE_NORMAL, dispatch_thread_id, g_gbuffer_normal.Load(coord).xyz);
+    StorePlane(DENOISER_CAPTURE_MOTION_VECTOR + 0, dispatch_thread_id, g_motion_vector.Load(coord).x);
+    StorePlane(DENOISER_CAPTURE_MOTION_VECTOR + 1, dispatch_thread_id, g_motion_vector.Load(coord).y);
+    StorePlane(DENOISER_CAPTURE_ROUGHNESS, dispatch_thread_id, g_extracted_roughness.Load(coord).x);
+    StorePlane(DENOISER_CAPTURE_ROUGHNESS_HISTORY, dispatch_thread_id, g_extracted_roughness_history.Load(coord).x);
+    StorePlanes(DENOISER_CAPTURE_RADIANCE_HISTORY, dispatch_thread_id, g_radiance_1.Load(coord).xyz);
+    StorePlane(DENOISER_CAPTURE_VARIANCE_HISTORY, dispatch_thread_id, g_radiance_variance_1.Load(coord).x);
+    StorePlane(DENOISER_CAPTURE_NUM_SAMPLES_HISTORY, dispatch_thread_id, g_radiance_num_samples_1.Load(coord).x);
+    StorePlane(DENOISER_CAPTURE_DEPTH_HISTORY, dispatch_thread_id, g_gbuffer_depth_history.Load(coord).x);
+    StorePlanes(DENOISER_CAPTURE_NORMAL_HISTORY, dispatch_thread_id, g_gbuffer_normal_history.Load(coord).xyz);
+    StorePlanes(DENOISER_CAPTURE_AVG_RADIANCE_HISTORY, dispatch_thread_id, IsInsideAverageRadiance(dispatch_thread_id) ? g_radiance_mip_prev.Load(coord).xyz : (0.0).xxx);
+    StorePlane(DENOISER_CAPTURE_TILE_MASK, dispatch_thread_id, 0.0);
+}
+
+// One group per tile the denoiser passes run on, dispatched with the same indirect arguments as those passes.
+[numthreads(8, 8, 1)]
+void CaptureTileMask(uint2 group_thread_id : SV_GroupThreadID, uint group_id : SV_GroupID) {
+    uint  packed_coords      = g_rw_denoise_pass_tile_list.Load(4 * group_id);
+    uint2 dispatch_thread_id = uint2(packed_coords & 0xffffu, (packed_coords >> 16) & 0xffffu) + group_thread_id;
+    if (!IsInsideReflectionTarget(dispatch_thread_id)) return;
+    StorePlane(DENOISER_CAPTURE_TILE_MASK, dispatch_thread_id, 1.0);
+}
+
+[numthreads(8, 8, 1)]
+void CaptureReprojected(uint2 dispatch_thread_id : SV_DispatchThreadID) {
+    if (!IsInsideReflectionTarget(dispatch_thread_id)) return;
+    int3 coord = int3(dispatch_thread_id, 0);
+    StorePlanes(DENOISER_CAPTURE_REPROJECTED_RADIANCE, dispatch_thread_id, g_radiance_reprojected.Load(coord).xyz);
+    StorePlane(DENOISER_CAPTURE_REPROJECTED_VARIANCE, dispatch_thread_id, g_radiance_variance_0.Load(coord).x);
+    StorePlane(DENOISER_CAPTURE_NUM_SAMPLES, dispatch_thread_id, g_radiance_num_samples_0.Load(coord).x);
+    StorePlanes(DENOISER_CAPTURE_AVG_RADIANCE, dispatch_thread_id, IsInsideAverageRadiance(dispatch_thread_id) ? g_radiance_mip.Load(coord).xyz : (0.0).xxx);
+}
+
+[numthreads(8, 8, 1)]
+void CapturePrefiltered(uint2 dispatch_thread_id : SV_DispatchThreadID) {
+    if (!IsInsideReflectionTarget(dispatch_thread_id)) return;
+    int3 coord = int3(dispatch_thread_id, 0);
+    StorePlanes(DENOISER_CAPTURE_PREFILTERED_RADIANCE, dispatch_thread_id, g_radiance_1.Load(coord).xyz);
+    StorePlane(DENOISER_CAPTURE_PREFILTERED_VARIANCE, dispatch_thread_id, g_radiance_variance_1.Load(coord).x);
+}
+
+[numthreads(8, 8, 1)]
+void CaptureTemporal(uint2 dispatch_thread_id : SV_DispatchThreadID) {
+    if (!IsInsideReflectionTarget(dispatch_thread_id)) return;
+    int3 coord = int3(dispatch_thread_id, 0);
+    StorePlanes(DENOISER_CAPTURE_TEMPORAL_RADIANCE, dispatch_thread_id, g_radiance_0.Load(coord).xyz);
+    StorePlane(DENOISER_CAPTURE_TEMPORAL_VARIANCE, dispatch_thread_id, g_radiance_variance_0.Load(coord).x);
+}
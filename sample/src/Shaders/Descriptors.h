@@ -21,7 +21,7 @@
 [[vk::binding(8, SPACE_ID)]]  RWTexture2D<min16float3> g_rw_texturesfp16x3[3] : register(DX12REGISTER(u, 14), space##SPACE_ID); \
 [[vk::binding(9, SPACE_ID)]]  RWTexture2DArray<float4> g_rw_atextures[384] : register(DX12REGISTER(u, 17), space##SPACE_ID); \
 [[vk::binding(10, SPACE_ID)]]  RWTexture2D<uint> g_rw_utextures[1] : register(DX12REGISTER(u, 401), space##SPACE_ID); \
-[[vk::binding(11, SPACE_ID)]]  RWByteAddressBuffer g_rw_buffers[23] : register(DX12REGISTER(u, 402), space##SPACE_ID); \
+[[vk::binding(11, SPACE_ID)]]  RWByteAddressBuffer g_rw_buffers[25] : register(DX12REGISTER(u, 402), space##SPACE_ID); \
 [[vk::binding(12, SPACE_ID)]]  SamplerState g_samplers[3] : register(DX12REGISTER(s, 0), space##SPACE_ID); \
 [[vk::binding(13, SPACE_ID)]]  SamplerComparisonState g_cmp_samplers[1] : register(DX12REGISTER(s, 3), space##SPACE_ID); \
 [[vk::binding(14, SPACE_ID)]]  ConstantBuffer<FrameInfo> g_frame_info_cb[1] : register(DX12REGISTER(b, 0), space##SPACE_ID); \
@@ -38,7 +38,7 @@
 [[vk::binding(8, SPACE_ID)]]  globallycoherent RWTexture2D<min16float3> g_rw_texturesfp16x3[3] : register(DX12REGISTER(u, 14), space##SPACE_ID); \
 [[vk::binding(9, SPACE_ID)]]  globallycoherent RWTexture2DArray<float4> g_rw_atextures[384] : register(DX12REGISTER(u, 17), space##SPACE_ID); \
 [[vk::binding(10, SPACE_ID)]]  globallycoherent RWTexture2D<uint> g_rw_utextures[1] : register(DX12REGISTER(u, 401), space##SPACE_ID); \
-[[vk::binding(11, SPACE_ID)]]  globallycoherent RWByteAddressBuffer g_rw_buffers[23] : register(DX12REGISTER(u, 402), space##SPACE_ID); \
+[[vk::binding(11, SPACE_ID)]]  globallycoherent RWByteAddressBuffer g_rw_buffers[25] : register(DX12REGISTER(u, 402), space##SPACE_ID); \
 [[vk::binding(12, SPACE_ID)]]  SamplerState g_samplers[3] : register(DX12REGISTER(s, 0), space##SPACE_ID); \
 [[vk::binding(13, SPACE_ID)]]  SamplerComparisonState g_cmp_samplers[1] : register(DX12REGISTER(s, 3), space##SPACE_ID); \
 [[vk::binding(14, SPACE_ID)]]  ConstantBuffer<FrameInfo> g_frame_info_cb[1] : register(DX12REGISTER(b, 0), space##SPACE_ID); \
@@ -279,9 +279,36 @@
 #define GDT_BUFFERS_HW_RAY_LIST_SLOT 14
 // RWByteAddressBuffer g_rw_hw_ray_list; 
 #define g_rw_hw_ray_list g_rw_buffers[GDT_BUFFERS_HW_RAY_LIST_SLOT]
+#define GDT_BUFFERS_MATERIAL_BINS_SLOT 15
+// RWByteAddressBuffer g_rw_material_bins; // Per material bin counters followed by the bin offsets 
+#define g_rw_material_bins g_rw_buffers[GDT_BUFFERS_MATERIAL_BINS_SLOT]
+#define GDT_BUFFERS_BINNED_HW_RAY_LIST_SLOT 16
+// RWByteAddressBuffer g_rw_binned_hw_ray_list; // HW ray indices sorted by material bin 
+#define g_rw_binned_hw_ray_list g_rw_buffers[GDT_BUFFERS_BINNED_HW_RAY_LIST_SLOT]
+#define GDT_BUFFERS_DENOISER_CAPTURE_SLOT 17
+// RWByteAddressBuffer g_rw_denoiser_capture; // fp32 planes of the denoiser inputs and outputs, see DenoiserCapture.h 
+#define g_rw_denoiser_capture g_rw_buffers[GDT_BUFFERS_DENOISER_CAPTURE_SLOT]
+#define GDT_BUFFERS_ACTIVE_DENOISE_TILE_LIST_SLOT 18
+// RWByteAddressBuffer g_rw_active_denoise_tile_list; // Denoise tiles that are not converged, see ConvergedTiles.h 
+#define g_rw_active_denoise_tile_list g_rw_buffers[GDT_BUFFERS_ACTIVE_DENOISE_TILE_LIST_SLOT]
+#define GDT_BUFFERS_CONVERGED_TILE_LIST_SLOT 19
+// RWByteAddressBuffer g_rw_converged_tile_list; // Denoise tiles that keep their history, see ConvergedTiles.h 
+#define g_rw_converged_tile_list g_rw_buffers[GDT_BUFFERS_CONVERGED_TILE_LIST_SLOT]
+#define GDT_BUFFERS_GBUFFER_CAPTURE_SLOT 20
+// RWByteAddressBuffer g_rw_gbuffer_capture; // fp32 planes of the render and reflection resolution GBuffers, see ReflectionGbuffer.h 
+#define g_rw_gbuffer_capture g_rw_buffers[GDT_BUFFERS_GBUFFER_CAPTURE_SLOT]
+#define GDT_BUFFERS_LIGHT_GRID_SLOT 21
+// RWByteAddressBuffer g_rw_light_grid; // World space grid of the lights for hit shading, see LightGrid.h 
+#define g_rw_light_grid g_rw_buffers[GDT_BUFFERS_LIGHT_GRID_SLOT]
 #define GDT_BUFFERS_RAY_GBUFFER_LIST_SLOT 22
 // RWByteAddressBuffer g_rw_ray_gbuffer_list; // Array of RayGBuffer for deferred shading of ray traced results 
 #define g_rw_ray_gbuffer_list g_rw_buffers[GDT_BUFFERS_RAY_GBUFFER_LIST_SLOT]
+#define GDT_BUFFERS_LIGHTS_SLOT 23
+// RWByteAddressBuffer g_rw_lights; // Packed lights of the frame, see LightList.h 
+#define g_rw_lights g_rw_buffers[GDT_BUFFERS_LIGHTS_SLOT]
+#define GDT_BUFFERS_DECAL_BINS_SLOT 24
+// RWByteAddressBuffer g_rw_decal_bins; // Visible decals and their screen tiles, see DecalBins.h 
+#define g_rw_decal_bins g_rw_buffers[GDT_BUFFERS_DECAL_BINS_SLOT]
 #define GDT_SAMPLERS_LINEAR_SAMPLER_SLOT 0
 // SamplerState g_linear_sampler; 
 #define g_linear_sampler g_samplers[GDT_SAMPLERS_LINEAR_SAMPLER_SLOT]
@@ -311,14 +338,14 @@
  ADD_UAV_TEXTURE_RANGE(3, 14, SPACE_ID, 653); \
  ADD_UAV_TEXTURE_RANGE(384, 17, SPACE_ID, 656); \
  ADD_UAV_TEXTURE_RANGE(1, 401, SPACE_ID, 1040); \
- ADD_BUFFER_RANGE(23, 402, SPACE_ID, 1041); \
+ ADD_BUFFER_RANGE(25, 402, SPACE_ID, 1041); \
  ADD_SAMPLER_RANGE(3, 0, SPACE_ID, 0); \
  ADD_SAMPLER_RANGE(1, 3, SPACE_ID, 3); \
- ADD_UNIFORM_BUFFER_RANGE(1, 0, SPACE_ID, 1064); \
+ ADD_UNIFORM_BUFFER_RANGE(1, 0, SPACE_ID, 1066); \
 } while (0)
 
 #define GDT_CBV_SRV_UAV_NUM_RANGES 13
-#define GDT_CBV_SRV_UAV_SIZE 1065
+#define GDT_CBV_SRV_UAV_SIZE 1067
 #define GDT_SAMPLERS_SIZE 4
 #define GDT_SAMPLERS_NUM_RANGES 2
 #define GDT_TLAS_REGISTER_OFFSET 0
@@ -350,7 +377,7 @@
 #define GDT_BUFFERS_HEAP_OFFSET 1041
 #define GDT_SAMPLERS_HEAP_OFFSET 0
 #define GDT_CMP_SAMPLERS_HEAP_OFFSET 3
-#define GDT_FRAME_INFO_HEAP_OFFSET 1064
+#define GDT_FRAME_INFO_HEAP_OFFSET 1066
 #define GDT_TLAS_LOCATION 0
 #define GDT_TEXTURES_LOCATION 1
 #define GDT_TEXTURESFP16_LOCATION 2
@@ -205,6 +205,33 @@ float3 applySpotLight(Light light, MaterialInfo materialInfo, float3 normal, flo
     return rangeAttenuation * spotAttenuation * light.intensity * light.color * shade;
 }
 
+#ifdef ID_clusteredLights
+#include "ClusteredLights.h"
+
+float3 applyClusteredLight(uint light_index, VS_OUTPUT_SCENE Input, MaterialInfo materialInfo, float3 normal, float3 worldPos, float3 view)
+{
+    Light light = myPerFrame.u_lights[light_index];
+    if (!LightGrid_Influences(light.type, light.range, light.outerConeCos, light.position.x, light.position.y, light.position.z, light.direction.x, light.direction.y,
+                              light.direction.z, worldPos.x, worldPos.y, worldPos.z))
+    {
+        return (0.0f).xxx;
+    }
+    float shadowFactor = CalcShadows(Input.WorldPos.xyz + normal * 2.0e-2f, int2(Input.svPosition.xy), light);
+    if (light.type == LightType_Directional)
+    {
+        return applyDirectionalLight(light, materialInfo, normal, view) * shadowFactor;
+    }
+    else if (light.type == LightType_Point)
+    {
+        return applyPointLight(light, materialInfo, normal, worldPos, view) * shadowFactor;
+    }
+    else if (light.type == LightType_Spot)
+    {
+        return applySpotLight(light, materialInfo, normal, worldPos, view) * shadowFactor;
+    }
+    return (0.0f).xxx;
+}
+#endif
 
 float3 doPbrLighting(VS_OUTPUT_SCENE Input, in PerFrame perFrame, in float3 diffuseColor, in float3 specularColor, in float perceptualRoughness)
 {
@@ -245,7 +272,31 @@ float3 doPbrLighting(VS_OUTPUT_SCENE Input, in PerFrame perFrame, in float3 diff
     }
 #endif
 
-#ifdef USE_PUNCTUAL
+#if defined(USE_PUNCTUAL) && defined(ID_clusteredLights)
+    // The global lights, then the lights of the pixel's cluster, see ClusteredLights.h. Neighbouring pixels mostly
+    // share their cluster, so the lanes of a wave mostly walk the same list.
+    uint global_count = g_clustered_lights.Load(4 * CLUSTERED_LIGHTS_GLOBAL_COUNT);
+    for (uint i = 0; i < global_count; ++i)
+    {
+        color += applyClusteredLight(g_clustered_lights.Load(4 * (CLUSTERED_LIGHTS_HEADER_WORDS + i)), Input, materialInfo, normal, worldPos, view);
+    }
+
+    float3 offset = worldPos - asfloat(g_clustered_lights.Load3(4 * CLUSTERED_LIGHTS_EYE));
+    uint3 dims = g_clustered_lights.Load3(4 * CLUSTERED_LIGHTS_DIMENSIONS);
+    uint cluster = ClusteredLights_Cluster(dot(offset, asfloat(g_clustered_lights.Load3(4 * CLUSTERED_LIGHTS_X_AXIS))),
+                                           dot(offset, asfloat(g_clustered_lights.Load3(4 * CLUSTERED_LIGHTS_Y_AXIS))),
+                                           dot(offset, asfloat(g_clustered_lights.Load3(4 * CLUSTERED_LIGHTS_DEPTH_AXIS))),
+                                           asfloat(g_clustered_lights.Load(4 * CLUSTERED_LIGHTS_NEAR_DEPTH)), asfloat(g_clustered_lights.Load(4 * CLUSTERED_LIGHTS_SLICE_SCALE)),
+                                           dims.x, dims.y, dims.z);
+    if (cluster != CLUSTERED_LIGHTS_NO_CLUSTER)
+    {
+        uint2 list = g_clustered_lights.Load2(4 * (g_clustered_lights.Load(4 * CLUSTERED_LIGHTS_CLUSTER_TABLE) + 2 * cluster));
+        for (uint j = 0; j < list.y; ++j)
+        {
+            color += applyClusteredLight(g_clustered_lights.Load(4 * (list.x + j)), Input, materialInfo, normal, worldPos, view);
+        }
+    }
+#elif defined(USE_PUNCTUAL)
     for (int i = 0; i < perFrame.u_lightCount; ++i)
     {
         Light light = myPerFrame.u_lights[i];
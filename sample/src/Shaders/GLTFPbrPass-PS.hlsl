@@ -107,6 +107,14 @@ cbuffer cbPerObject : register(b1)
     PBRFactors    u_pbrParams;
 };
 
+//--------------------------------------------------------------------------------------
+// Light lists of the forward lighting, see ClusteredLights.h
+//--------------------------------------------------------------------------------------
+
+#ifdef ID_clusteredLights
+ByteAddressBuffer g_clustered_lights : register(TEX(ID_clusteredLights));
+#endif
+
 #include "functions.hlsl"
 #include "shadowFiltering.h"
 #include "GLTFPBRLighting.hlsl"
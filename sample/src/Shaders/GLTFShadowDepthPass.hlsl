@@ -0,0 +1,65 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Depth only draw of a shadow caster into its light's tile of the shadow atlas, see GltfShadowDepthPass.h.
+// The vertex path is the one of the PBR pass (GLTFVertexFactory.hlsl), with the light's view projection as the camera.
+// Only alpha masked materials with a base color texture get a pixel shader.
+
+struct VS_OUTPUT_SCENE {
+    float4 svPosition : SV_POSITION;
+    float3 WorldPos   : WORLDPOS;
+#ifdef HAS_TEXCOORD_0
+    float2 UV0 : TEXCOORD0;
+#endif
+#ifdef HAS_TEXCOORD_1
+    float2 UV1 : TEXCOORD1;
+#endif
+};
+
+cbuffer cbPerFrame : register(b0) {
+    matrix u_mLightViewProj;
+};
+
+cbuffer cbPerObject : register(b1) {
+    matrix u_mWorld;
+};
+
+matrix GetWorldMatrix() { return u_mWorld; }
+matrix GetCameraViewProj() { return u_mLightViewProj; }
+
+#include "GLTFVertexFactory.hlsl"
+
+VS_OUTPUT_SCENE mainVS(VS_INPUT_SCENE input) { return gltfVertexFactory(input); }
+
+#ifdef ID_baseColorTexture
+Texture2D    baseColorTexture : register(t0);
+SamplerState samBaseColor     : register(s0);
+
+void mainPS(VS_OUTPUT_SCENE input) {
+#    if ID_baseTexCoord == 1
+    float2 uv = input.UV1;
+#    else
+    float2 uv = input.UV0;
+#    endif
+    if (baseColorTexture.Sample(samBaseColor, uv).a < DEF_alphaCutoff) discard;
+}
+#endif
@@ -58,7 +58,10 @@ RWByteAddressBuffer g_rw_ray_gbuffer_list; // Array of RayGBuffer for deferred s
 RWTexture2D<min16float3> g_rw_radiance_0; // Radiance target 0 - intersection results 
 RWTexture2D<min16float> g_rw_radiance_variance_0; // Variance target 0 - current variance/ray length 
 RWByteAddressBuffer g_rw_hw_ray_list; 
+RWByteAddressBuffer g_rw_material_bins; // Per material bin counters followed by the bin offsets 
+RWByteAddressBuffer g_rw_binned_hw_ray_list; // HW ray indices sorted by material bin 
 RWByteAddressBuffer g_rw_ray_list; 
+RWByteAddressBuffer g_rw_light_grid; // World space grid of the lights for hit shading 
 Texture2D<float4> g_extracted_roughness; // Current extracted GBuffer/roughness in reflection target resolution 
 Texture2D<float4> g_lit_scene_history; // Previous render resolution color target 
 RWTexture2D<float4> g_rw_debug; // Debug target 
@@ -73,8 +76,9 @@ groupshared uint g_group_shared_counter;
 #define specularCube g_atmosphere_lut
 #define myPerFrame g_frame_info.perFrame
 #define ID_shadowMap_declared
-#define SAMPLE_SHADOW_MAP(shadowIndex, UV, Z, IJ)                                                                                                                                  \
-    (g_textures[NonUniformResourceIndex(GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT + shadowIndex)].SampleCmpLevelZero(g_cmp_sampler, (UV).xy, (Z), IJ.xy).r)
+// The shadow atlas takes the first slot of the shadow map range
+#define SAMPLE_SHADOW_MAP(UV, Z, IJ) (g_textures[GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT].SampleCmpLevelZero(g_cmp_sampler, (UV).xy, (Z), IJ.xy).r)
+#define SHADOW_ATLAS_DIMENSIONS(W, H) g_textures[GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT].GetDimensions(W, H)
 
 // Useful functions
 #include "functions.hlsl"
@@ -82,6 +86,8 @@ groupshared uint g_group_shared_counter;
 #include "shadowFiltering.h"
 // Code for shading new fragments
 #include "RTShading.h"
+// Metrics block layout and wave aggregated counters
+#include "Metrics.h"
 
 struct PushConstants {
     uint masks;
@@ -189,7 +195,7 @@ void PrepareIndirect(uint group_index : SV_GroupIndex,
     g_rw_indirect_args.Store(INDIRECT_ARGS_HW_OFFSET + 8, 1);
     // Feedback for metrics visualization
     {
-        g_rw_metrics.Store(8, cnt);
+        g_rw_metrics.Store(4 * HSR_METRICS_DEFERRED_HW_RAYS, cnt);
     }
 }
 
@@ -214,40 +220,64 @@ struct RayGbuffer {
     bool skip;
 };
 
+#include "RayGbuffer.h"
+
+#ifdef HSR_COMPACT_RAY_GBUFFER
+
+struct PackedRayGbuffer {
+    uint pack0;
+    uint pack1;
+};
+
+#    define FFX_REFLECTIONS_RAY_GBUFFER_STRIDE FFX_REFLECTIONS_COMPACT_RAY_GBUFFER_SIZE
+
+float FFX_Reflections_GbufferGetRayLength(PackedRayGbuffer gbuffer) { return FFX_Reflections_CompactRayGbufferLength(gbuffer.pack0); }
+
+PackedRayGbuffer FFX_Reflections_PackGbuffer(RayGbuffer gbuffer) {
+    float2           nuv   = OctahedronUV(gbuffer.normal);
+    uint             pack0 = FFX_Reflections_PackCompactRayGbufferUVLength(gbuffer.uv.x, gbuffer.uv.y, gbuffer.world_ray_length);
+    uint             pack1 = FFX_Reflections_PackRayGbufferNormalMaterial(nuv.x, nuv.y, gbuffer.material_id, gbuffer.skip);
+    PackedRayGbuffer pack  = {pack0, pack1};
+    return pack;
+}
+
+float2 FFX_Reflections_GbufferGetUV(PackedRayGbuffer gbuffer) {
+    return float2(FFX_Reflections_CompactRayGbufferU(gbuffer.pack0), FFX_Reflections_CompactRayGbufferV(gbuffer.pack0));
+}
+
+#else
+
 struct PackedRayGbuffer {
     uint pack0;
     uint pack1;
     uint pack2;
 };
 
-bool FFX_Reflections_GbufferIsSkip(PackedRayGbuffer gbuffer) { return (gbuffer.pack1 & (1u << 31u)) != 0; }
+#    define FFX_REFLECTIONS_RAY_GBUFFER_STRIDE FFX_REFLECTIONS_RAY_GBUFFER_SIZE
 
 float FFX_Reflections_GbufferGetRayLength(PackedRayGbuffer gbuffer) { return asfloat(gbuffer.pack2); }
 
 PackedRayGbuffer FFX_Reflections_PackGbuffer(RayGbuffer gbuffer) {
-    uint   pack0 = PackFloat16(gbuffer.uv);
-    uint   pack1;
-    float2 nuv  = OctahedronUV(gbuffer.normal);
-    uint   iuvx = uint(255.0 * nuv.x);
-    uint   iuvy = uint(255.0 * nuv.y);
-    pack1       =                                  //
-        ((gbuffer.material_id & 0x7fffu) << 16u) | //
-        (iuvx << 0u) |                             //
-        (iuvy << 8u);
-    if (gbuffer.skip) pack1 |= (1u << 31u);
-    uint             pack2 = asuint(gbuffer.world_ray_length); // PackFloat16(float2());
+    float2           nuv   = OctahedronUV(gbuffer.normal);
+    uint             pack0 = PackFloat16(gbuffer.uv);
+    uint             pack1 = FFX_Reflections_PackRayGbufferNormalMaterial(nuv.x, nuv.y, gbuffer.material_id, gbuffer.skip);
+    uint             pack2 = asuint(gbuffer.world_ray_length);
     PackedRayGbuffer pack  = {pack0, pack1, pack2};
     return pack;
 }
 
+float2 FFX_Reflections_GbufferGetUV(PackedRayGbuffer gbuffer) { return UnpackFloat16(gbuffer.pack0); }
+
+#endif
+
+bool FFX_Reflections_GbufferIsSkip(PackedRayGbuffer gbuffer) { return FFX_Reflections_RayGbufferIsSkip(gbuffer.pack1); }
+
 RayGbuffer FFX_Reflections_UnpackGbuffer(PackedRayGbuffer gbuffer) {
     RayGbuffer ogbuffer;
-    ogbuffer.uv               = UnpackFloat16(gbuffer.pack0);
-    uint   iuvx               = (gbuffer.pack1 >> 0u) & 0xffu;
-    uint   iuvy               = (gbuffer.pack1 >> 8u) & 0xffu;
-    float2 nuv                = float2(float(iuvx) / 255.0, float(iuvy) / 255.0);
+    ogbuffer.uv               = FFX_Reflections_GbufferGetUV(gbuffer);
+    float2 nuv                = float2(FFX_Reflections_RayGbufferOctahedralU(gbuffer.pack1), FFX_Reflections_RayGbufferOctahedralV(gbuffer.pack1));
     ogbuffer.normal           = UVtoOctahedron(nuv);
-    ogbuffer.material_id      = (gbuffer.pack1 >> 16u) & 0x7fffu;
+    ogbuffer.material_id      = FFX_Reflections_RayGbufferMaterialId(gbuffer.pack1);
     ogbuffer.skip             = FFX_Reflections_GbufferIsSkip(gbuffer);
     ogbuffer.world_ray_length = FFX_Reflections_GbufferGetRayLength(gbuffer);
     return ogbuffer;
@@ -255,20 +285,24 @@ RayGbuffer FFX_Reflections_UnpackGbuffer(PackedRayGbuffer gbuffer) {
 
 void FFX_Reflections_SkipRayGBuffer(uint ray_index) {
     uint pack1 = (1u << 31u);
-    g_rw_ray_gbuffer_list.Store<uint>(ray_index * 12 + 4, pack1);
+    g_rw_ray_gbuffer_list.Store<uint>(ray_index * FFX_REFLECTIONS_RAY_GBUFFER_STRIDE + 4, pack1);
 }
 
 void FFX_Reflections_StoreRayGBuffer(uint ray_index, in PackedRayGbuffer gbuffer) {
-    g_rw_ray_gbuffer_list.Store<uint>(ray_index * 12 + 0, gbuffer.pack0);
-    g_rw_ray_gbuffer_list.Store<uint>(ray_index * 12 + 4, gbuffer.pack1);
-    g_rw_ray_gbuffer_list.Store<uint>(ray_index * 12 + 8, gbuffer.pack2);
+    g_rw_ray_gbuffer_list.Store<uint>(ray_index * FFX_REFLECTIONS_RAY_GBUFFER_STRIDE + 0, gbuffer.pack0);
+    g_rw_ray_gbuffer_list.Store<uint>(ray_index * FFX_REFLECTIONS_RAY_GBUFFER_STRIDE + 4, gbuffer.pack1);
+#ifndef HSR_COMPACT_RAY_GBUFFER
+    g_rw_ray_gbuffer_list.Store<uint>(ray_index * FFX_REFLECTIONS_RAY_GBUFFER_STRIDE + 8, gbuffer.pack2);
+#endif
 }
 
 PackedRayGbuffer FFX_Reflections_LoadRayGBuffer(uint ray_index) {
-    uint             pack0 = g_rw_ray_gbuffer_list.Load<uint>(ray_index * 12 + 0);
-    uint             pack1 = g_rw_ray_gbuffer_list.Load<uint>(ray_index * 12 + 4);
-    uint             pack2 = g_rw_ray_gbuffer_list.Load<uint>(ray_index * 12 + 8);
-    PackedRayGbuffer pack  = {pack0, pack1, pack2};
+    PackedRayGbuffer pack;
+    pack.pack0 = g_rw_ray_gbuffer_list.Load<uint>(ray_index * FFX_REFLECTIONS_RAY_GBUFFER_STRIDE + 0);
+    pack.pack1 = g_rw_ray_gbuffer_list.Load<uint>(ray_index * FFX_REFLECTIONS_RAY_GBUFFER_STRIDE + 4);
+#ifndef HSR_COMPACT_RAY_GBUFFER
+    pack.pack2 = g_rw_ray_gbuffer_list.Load<uint>(ray_index * FFX_REFLECTIONS_RAY_GBUFFER_STRIDE + 8);
+#endif
     return pack;
 }
 
@@ -278,6 +312,7 @@ void FFX_Reflections_WriteRadiance(uint packed_coords, float4 radiance) {
     bool copy_vertical;
     bool copy_diagonal;
     UnpackRayCoords(packed_coords, coords, copy_horizontal, copy_vertical, copy_diagonal);
+    radiance.xyz                     = FFX_Reflections_QuantizeRadiance(radiance.xyz, coords, FFX_REFLECTIONS_RADIANCE_DITHER_INTERSECT);
     g_rw_radiance_0[coords]          = radiance.xyz;
     g_rw_radiance_variance_0[coords] = radiance.w;
     uint2 copy_target    = coords ^ 0b1; // Flip last bit to find the mirrored coords along the x and y axis within a quad.
@@ -461,6 +496,17 @@ void main(uint group_index : SV_GroupIndex,
     if (g_hsr_mask & HSR_FLAGS_VISUALIZE_TRANSPARENT_QUERY) debug_value = float4(0.0, 0.0, 0.0, 0.0);
 #    endif // HSR_DEBUG
 
+    // Feedback for metrics visualization
+    {
+        bool sw_rejected = valid_ray && do_hw;
+        bool sw_resolved = valid_ray && !do_hw && confidence >= 0.9;
+        FFX_Reflections_CountMetric(HSR_METRICS_SW_CONFIDENCE_REJECTED, sw_rejected);
+        FFX_Reflections_CountMetric(HSR_METRICS_SW_ROUGH_FALLBACK, sw_rejected && roughness > g_frame_info.rt_roughness_threshold);
+        FFX_Reflections_CountMetric(HSR_METRICS_SW_MISSES, valid_ray && !do_hw && !sw_resolved);
+        FFX_Reflections_AddMetricHistogram(HSR_METRICS_RAY_LENGTH_HISTOGRAM, FFX_Reflections_RayLengthMetricBin(world_ray_length), sw_resolved);
+        FFX_Reflections_AddMetricHistogram(HSR_METRICS_MARCH_HISTOGRAM, FFX_Reflections_MarchMetricBin(length((hit.xy - screen_uv_space_ray_origin.xy) * screen_size)), valid_ray);
+    }
+
     // Fall back to env probe in case of rough surfaces
     if (do_hw && roughness > g_frame_info.rt_roughness_threshold) {
         do_hw = false;
@@ -508,6 +554,9 @@ void main(uint group_index : SV_GroupIndex,
     if (g_hsr_mask & HSR_FLAGS_VISUALIZE_TRANSPARENT_QUERY) debug_value = float4(0.0, 0.0, 0.0, 0.0);
 #    endif // HSR_DEBUG
     PackedRayGbuffer packed_gbuffer;
+    float            opaque_ray_length = FFX_REFLECTIONS_SKY_DISTANCE; // Unquantized, the transparent query starts from it.
+    bool             opaque_hit        = false;
+    bool             transparent_hit   = false;
     {
         RayGbuffer default_gbuffer;
         default_gbuffer.normal           = float3(0.0, 0.0, 1.0);
@@ -530,6 +579,7 @@ void main(uint group_index : SV_GroupIndex,
         opaque_query.TraceRayInline(g_global, 0, 0xff, ray);
         opaque_query.Proceed();
         if (opaque_query.CommittedStatus() == COMMITTED_TRIANGLE_HIT) {
+            opaque_hit = true;
             uint          instance_id;
             uint          geometry_id;
             uint          surface_id;
@@ -587,6 +637,7 @@ void main(uint group_index : SV_GroupIndex,
             gbuffer.normal           = normal;
             gbuffer.uv               = uv;
             gbuffer.world_ray_length = opaque_query.CommittedRayT();
+            opaque_ray_length        = gbuffer.world_ray_length;
             #ifdef HSR_TRANSPARENT_QUERY
               gbuffer.skip             = albedo.w < 0.5;
             #else // HSR_TRANSPARENT_QUERY
@@ -604,7 +655,7 @@ void main(uint group_index : SV_GroupIndex,
         RayDesc                 ray;
         ray.Origin    = world_space_origin + world_space_normal * 3.0e-3 * length(view_space_ray);
         ray.Direction = world_space_reflected_direction;
-        ray.TMin      = FFX_Reflections_GbufferGetRayLength(packed_gbuffer) - 1.0e-2;
+        ray.TMin      = opaque_ray_length - 1.0e-2;
         ray.TMax      =  max_t - ray.TMin;
         transparent_query.TraceRayInline(g_transparent,
                                          0, // OR'd with flags above
@@ -660,6 +711,7 @@ void main(uint group_index : SV_GroupIndex,
                     gbuffer.world_ray_length = transparent_query.CandidateTriangleRayT();
                     gbuffer.skip             = false;
                     packed_gbuffer           = FFX_Reflections_PackGbuffer(gbuffer);
+                    transparent_hit          = true;
                     transparent_query.CommitNonOpaqueTriangleHit();
                 }
             }
@@ -667,6 +719,12 @@ void main(uint group_index : SV_GroupIndex,
     }
 #    endif // HSR_TRANSPARENT_QUERY
 
+    // Feedback for metrics visualization
+    {
+        FFX_Reflections_CountMetric(HSR_METRICS_HW_MISSES, !opaque_hit);
+        FFX_Reflections_CountMetric(HSR_METRICS_HW_TRANSPARENT_HITS, transparent_hit);
+    }
+
     FFX_Reflections_StoreRayGBuffer(ray_index, packed_gbuffer);
 
 #endif // USE_INLINE_RAYTRACING
@@ -711,6 +769,11 @@ void main(uint group_index : SV_GroupIndex,
 void DeferredShade(uint group_index : SV_GroupIndex,
                    uint group_id    : SV_GroupID) {
     uint ray_index     = group_id * 32 + group_index;
+    // The tail of the last wave would shade stale list entries and count them in the metrics
+    if (ray_index >= g_rw_ray_counter.Load(RAY_COUNTER_HW_HISTORY_OFFSET)) return;
+#ifdef HSR_MATERIAL_BINNING
+    ray_index = g_rw_binned_hw_ray_list.Load(sizeof(uint) * ray_index);
+#endif // HSR_MATERIAL_BINNING
     uint packed_coords = g_rw_hw_ray_list.Load(sizeof(uint) * ray_index);
     int2 coords;
     bool copy_horizontal;
@@ -735,6 +798,12 @@ void DeferredShade(uint group_index : SV_GroupIndex,
 
     RayGbuffer gbuffer = FFX_Reflections_UnpackGbuffer(FFX_Reflections_LoadRayGBuffer(ray_index));
 
+    // Feedback for metrics visualization
+    {
+        FFX_Reflections_CountMetric(HSR_METRICS_DEFERRED_SHADE_SKIPS, gbuffer.skip);
+        FFX_Reflections_AddMetricHistogram(HSR_METRICS_RAY_LENGTH_HISTOGRAM, FFX_Reflections_RayLengthMetricBin(gbuffer.world_ray_length), !gbuffer.skip);
+    }
+
     if (gbuffer.skip) {
         // Fall back to the pre-filtered sample or a stochastic one
         float3 reflection_radiance = FFX_GetEnvironmentSample(world_space_origin, world_space_reflected_direction, 0.0);
@@ -785,3 +854,80 @@ void DeferredShade(uint group_index : SV_GroupIndex,
 #endif // #ifdef HSR_SHADING_USE_SCREEN
     
 }
+
+// Material binning of the deferred hits for HSR_MATERIAL_BINNING. The hits are counted per bin, the counters are turned
+// into bin offsets with a prefix sum and the ray indices are scattered to g_rw_binned_hw_ray_list, so DeferredShade
+// walks them bin by bin and neighbouring lanes fetch the same Material_Info and textures.
+// g_rw_material_bins holds FFX_REFLECTIONS_MATERIAL_BIN_COUNT counters followed by as many offsets. The counters are
+// zeroed again by the prefix sum, ready for the next frame.
+#define FFX_REFLECTIONS_MATERIAL_BIN_OFFSETS (4 * FFX_REFLECTIONS_MATERIAL_BIN_COUNT)
+#define FFX_REFLECTIONS_MATERIAL_BIN_SCAN_THREADS 1024
+#define FFX_REFLECTIONS_MATERIAL_BINS_PER_THREAD ((FFX_REFLECTIONS_MATERIAL_BIN_COUNT + FFX_REFLECTIONS_MATERIAL_BIN_SCAN_THREADS - 1) / FFX_REFLECTIONS_MATERIAL_BIN_SCAN_THREADS)
+
+groupshared uint g_group_shared_bin_sums[FFX_REFLECTIONS_MATERIAL_BIN_SCAN_THREADS];
+
+uint FFX_Reflections_LoadMaterialBin(uint ray_index) {
+    return FFX_Reflections_RayGbufferMaterialBin(g_rw_ray_gbuffer_list.Load<uint>(ray_index * FFX_REFLECTIONS_RAY_GBUFFER_STRIDE + 4));
+}
+
+[numthreads(32, 1, 1)]
+void CountMaterialBins(uint group_index : SV_GroupIndex,
+                       uint group_id    : SV_GroupID) {
+    uint ray_index = group_id * 32 + group_index;
+    if (ray_index >= g_rw_ray_counter.Load(RAY_COUNTER_HW_HISTORY_OFFSET)) return;
+    uint bin = FFX_Reflections_LoadMaterialBin(ray_index);
+    // One atomic per distinct bin in the wave.
+    for (;;) {
+        if (bin == WaveReadLaneFirst(bin)) {
+            uint count = WaveActiveCountBits(true);
+            if (WaveIsFirstLane()) g_rw_material_bins.InterlockedAdd(4 * bin, count);
+            break;
+        }
+    }
+}
+
+[numthreads(FFX_REFLECTIONS_MATERIAL_BIN_SCAN_THREADS, 1, 1)]
+void ScanMaterialBins(uint group_index : SV_GroupIndex) {
+    uint first_bin = group_index * FFX_REFLECTIONS_MATERIAL_BINS_PER_THREAD;
+    uint sum       = 0;
+    for (uint i = 0; i < FFX_REFLECTIONS_MATERIAL_BINS_PER_THREAD; i++) {
+        uint bin = first_bin + i;
+        if (bin < FFX_REFLECTIONS_MATERIAL_BIN_COUNT) sum += g_rw_material_bins.Load(4 * bin);
+    }
+    g_group_shared_bin_sums[group_index] = sum;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint stride = 1; stride < FFX_REFLECTIONS_MATERIAL_BIN_SCAN_THREADS; stride *= 2) {
+        uint value = group_index >= stride ? g_group_shared_bin_sums[group_index - stride] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        g_group_shared_bin_sums[group_index] += value;
+        GroupMemoryBarrierWithGroupSync();
+    }
+    uint offset = g_group_shared_bin_sums[group_index] - sum;
+    for (uint j = 0; j < FFX_REFLECTIONS_MATERIAL_BINS_PER_THREAD; j++) {
+        uint bin = first_bin + j;
+        if (bin < FFX_REFLECTIONS_MATERIAL_BIN_COUNT) {
+            uint count = g_rw_material_bins.Load(4 * bin);
+            g_rw_material_bins.Store(FFX_REFLECTIONS_MATERIAL_BIN_OFFSETS + 4 * bin, offset);
+            g_rw_material_bins.Store(4 * bin, 0);
+            offset += count;
+        }
+    }
+}
+
+[numthreads(32, 1, 1)]
+void ScatterMaterialBins(uint group_index : SV_GroupIndex,
+                         uint group_id    : SV_GroupID) {
+    uint ray_index = group_id * 32 + group_index;
+    if (ray_index >= g_rw_ray_counter.Load(RAY_COUNTER_HW_HISTORY_OFFSET)) return;
+    uint bin = FFX_Reflections_LoadMaterialBin(ray_index);
+    for (;;) {
+        if (bin == WaveReadLaneFirst(bin)) {
+            uint count = WaveActiveCountBits(true);
+            uint base  = 0;
+            if (WaveIsFirstLane()) g_rw_material_bins.InterlockedAdd(FFX_REFLECTIONS_MATERIAL_BIN_OFFSETS + 4 * bin, count, base);
+            base = WaveReadLaneFirst(base);
+            g_rw_binned_hw_ray_list.Store(4 * (base + WavePrefixCountBits(true)), ray_index);
+            break;
+        }
+    }
+}
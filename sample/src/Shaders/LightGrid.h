@@ -0,0 +1,110 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// World space grid of the lights for the shading of reflection hits (doPbrLighting in RTShading.h). Shared by the
+// shaders and the C++ builder (namespace LightGridModel, see LightGrid.h of the sample).
+//
+// Point and spot lights with a range only light points closer than their range, spot lights also only within their
+// outer cone. The grid lists those lights in every cell their influence volume touches, so a hit only shades the
+// lights of its cell and the global ones: directional lights, lights without a range and lights too large to be
+// worth listing per cell. Hits outside the grid only get the global lights. LightGrid_Influences is the exact test,
+// both lists are ordered by light index and the shader skips candidates that fail it.
+//
+// The grid is one buffer of uints:
+//   LIGHT_GRID_HEADER_WORDS words of header, see below,
+//   the global light indices,
+//   the cell table, two words per cell: word offset and size of the cell's list, cells ordered x, then y, then z,
+//   the cell lists.
+// A grid without cells, dimensions 0, lists every light as global, which is the loop over all the lights.
+
+#ifndef LIGHT_GRID_H
+#define LIGHT_GRID_H
+
+#define LIGHT_GRID_ORIGIN 0        // 3 floats, world space corner of cell (0, 0, 0).
+#define LIGHT_GRID_INV_CELL_SIZE 3 // 3 floats.
+#define LIGHT_GRID_DIMENSIONS 6    // 3 uints, cells along x, y and z.
+#define LIGHT_GRID_GLOBAL_COUNT 9
+#define LIGHT_GRID_CELL_TABLE 10 // Word offset of the cell table.
+#define LIGHT_GRID_LIGHT_COUNT 11
+#define LIGHT_GRID_HEADER_WORDS 12
+
+#define LIGHT_GRID_MAX_WORDS (1u << 18) // Size of the GPU buffer.
+#define LIGHT_GRID_MAX_DIMENSION 128u
+#define LIGHT_GRID_NO_CELL 0xffffffffu
+
+// Cosine margin of the cone test, the spot attenuation is zero that close to the outer cone anyway.
+#define LIGHT_GRID_CONE_MARGIN 1.0e-4f
+
+// As the LightType_* of Declarations.h.
+#define LIGHT_GRID_TYPE_DIRECTIONAL 0
+#define LIGHT_GRID_TYPE_POINT 1
+#define LIGHT_GRID_TYPE_SPOT 2
+
+#ifndef __HLSL_VERSION
+
+#    include <cmath>
+#    include <cstdint>
+
+namespace LightGridModel {
+
+typedef uint32_t uint;
+using std::sqrt;
+
+#    define LIGHT_GRID_INLINE static inline
+#else
+#    define LIGHT_GRID_INLINE
+#endif
+
+// Whether the light has an influence volume at all, a negative range is unlimited as in getRangeAttenuation.
+LIGHT_GRID_INLINE bool LightGrid_IsBounded(int type, float range) { return type != LIGHT_GRID_TYPE_DIRECTIONAL && range >= 0.0f; }
+
+// Whether the light at (lx, ly, lz) reaches point (px, py, pz). False only where applyPointLight and applySpotLight
+// are zero: at or past the range, and for spots outside the outer cone around -direction.
+LIGHT_GRID_INLINE bool LightGrid_Influences(int type, float range, float outer_cone_cos, float lx, float ly, float lz, float dx, float dy, float dz, float px, float py,
+                                            float pz) {
+    if (!LightGrid_IsBounded(type, range)) return true;
+    float vx = px - lx;
+    float vy = py - ly;
+    float vz = pz - lz;
+    float d2 = vx * vx + vy * vy + vz * vz;
+    if (d2 >= range * range) return false;
+    if (type != LIGHT_GRID_TYPE_SPOT) return true;
+    float axis = -(vx * dx + vy * dy + vz * dz);
+    return axis > (outer_cone_cos - LIGHT_GRID_CONE_MARGIN) * sqrt(d2 * (dx * dx + dy * dy + dz * dz));
+}
+
+// Cell of the point, LIGHT_GRID_NO_CELL outside of the grid.
+LIGHT_GRID_INLINE uint LightGrid_Cell(float px, float py, float pz, float ox, float oy, float oz, float isx, float isy, float isz, uint nx, uint ny, uint nz) {
+    float fx = (px - ox) * isx;
+    float fy = (py - oy) * isy;
+    float fz = (pz - oz) * isz;
+    if (!(fx >= 0.0f && fy >= 0.0f && fz >= 0.0f && fx < float(nx) && fy < float(ny) && fz < float(nz))) return LIGHT_GRID_NO_CELL;
+    return (uint(fz) * ny + uint(fy)) * nx + uint(fx);
+}
+
+#undef LIGHT_GRID_INLINE
+
+#ifndef __HLSL_VERSION
+} // namespace LightGridModel
+#endif
+
+#endif // LIGHT_GRID_H
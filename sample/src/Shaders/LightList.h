@@ -0,0 +1,48 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// The lights of the frame as the hit shaders read them (LoadLight in RTShading.h), uploaded by the C++ builder
+// (LightListBuilder.h in the DX12 sources) into their own buffer instead of living in FrameInfo. Only the lights the
+// scene has are uploaded, and only when they change.
+//
+// Every light takes LIGHT_LIST_LIGHT_WORDS words, the fields of Light in Declarations.h without mLightView, which no
+// shader reads. mLightViewProj keeps its constant buffer layout: column k in words 4 * k to 4 * k + 3.
+
+#ifndef LIGHT_LIST_H
+#define LIGHT_LIST_H
+
+#define LIGHT_LIST_VIEW_PROJ 0  // 16 floats.
+#define LIGHT_LIST_DIRECTION 16 // 3 floats.
+#define LIGHT_LIST_RANGE 19
+#define LIGHT_LIST_COLOR 20 // 3 floats.
+#define LIGHT_LIST_INTENSITY 23
+#define LIGHT_LIST_POSITION 24 // 3 floats.
+#define LIGHT_LIST_INNER_CONE_COS 27
+#define LIGHT_LIST_OUTER_CONE_COS 28
+#define LIGHT_LIST_TYPE 29
+#define LIGHT_LIST_DEPTH_BIAS 30
+#define LIGHT_LIST_SHADOW_MAP_INDEX 31
+#define LIGHT_LIST_LIGHT_WORDS 32
+
+#define LIGHT_LIST_MAX_LIGHTS 80 // Size of the GPU buffer, as MAX_LIGHT_INSTANCES in Declarations.h.
+
+#endif
@@ -0,0 +1,110 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Layout of the metrics block g_rw_metrics that HSR reads back every frame, shared with the C++ decoder (HsrMetrics.h).
+// Words are uint32. Counters are zeroed by PrepareIndirectArgs and accumulated by the intersection and shading passes.
+// Bump HSR_METRICS_VERSION when the layout changes, the decoder keys on it. Blocks written before the version word
+// existed read 0 there and only have the three ray counts.
+
+#ifndef HSR_METRICS_H
+#define HSR_METRICS_H
+
+#define HSR_METRICS_VERSION 2
+#define HSR_METRICS_HISTOGRAM_BINS 16
+
+#define HSR_METRICS_SW_RAYS 0                // Rays classified for screen space tracing.
+#define HSR_METRICS_HW_RAYS 1                // Rays classified for HW tracing before the screen space pass.
+#define HSR_METRICS_DEFERRED_HW_RAYS 2       // HW rays after the screen space pass, includes the hybrid rays.
+#define HSR_METRICS_VERSION_WORD 3           // HSR_METRICS_VERSION
+#define HSR_METRICS_SW_CONFIDENCE_REJECTED 4 // Screen space hits below the confidence threshold, handed to HW.
+#define HSR_METRICS_SW_ROUGH_FALLBACK 5      // Rejected screen space rays too rough for HW, shaded from the environment.
+#define HSR_METRICS_SW_MISSES 6              // Screen space rays without a usable hit, shaded from the environment.
+#define HSR_METRICS_HW_MISSES 7              // HW rays that hit no opaque geometry.
+#define HSR_METRICS_HW_TRANSPARENT_HITS 8    // HW rays resolved by the transparent query.
+#define HSR_METRICS_DEFERRED_SHADE_SKIPS 9   // Deferred shading lanes that fall back to the environment.
+#define HSR_METRICS_DENOISE_TILES 10         // 8x8 tiles the denoiser runs on.
+#define HSR_METRICS_RAY_LENGTH_HISTOGRAM 16  // World space length of the resolved rays, see FFX_Reflections_RayLengthMetricBin.
+#define HSR_METRICS_MARCH_HISTOGRAM 32       // Screen space march distance, see FFX_Reflections_MarchMetricBin.
+#define HSR_METRICS_WORD_COUNT 48
+
+#ifndef __HLSL_VERSION
+
+#    include <cstdint>
+#    include <cstring>
+
+namespace HsrMetricsCodec {
+
+typedef uint32_t uint;
+
+static inline uint asuint(float x) {
+    uint u;
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+#    define FFX_METRICS_INLINE static inline
+#else
+#    define FFX_METRICS_INLINE
+#endif
+
+// log2 bins on the float exponent, bin b covers [2^(b + first_exponent), 2^(b + 1 + first_exponent)), the first and the
+// last bin also take everything below and above.
+FFX_METRICS_INLINE uint FFX_Reflections_Log2MetricBin(float value, int first_exponent) {
+    int exponent = int((asuint(value) >> 23u) & 0xffu) - 127 - first_exponent;
+    if (value <= 0.0f || exponent < 0) return 0u;
+    return exponent < int(HSR_METRICS_HISTOGRAM_BINS) ? uint(exponent) : HSR_METRICS_HISTOGRAM_BINS - 1u;
+}
+
+// Bin 0 is below 1/8, bin 15 from 2048 world units.
+FFX_METRICS_INLINE uint FFX_Reflections_RayLengthMetricBin(float world_ray_length) { return FFX_Reflections_Log2MetricBin(world_ray_length, -4); }
+
+// Screen space distance the hierarchical march covered, in pixels of the reflection target. Bin 0 is below 2 pixels.
+// Every HiZ iteration steps up or down one mip, so this follows the iteration count that ffx-sssr does not report.
+FFX_METRICS_INLINE uint FFX_Reflections_MarchMetricBin(float pixels) { return FFX_Reflections_Log2MetricBin(pixels, 0); }
+
+#undef FFX_METRICS_INLINE
+
+#ifndef __HLSL_VERSION
+} // namespace HsrMetricsCodec
+#else
+
+// One atomic per wave.
+void FFX_Reflections_CountMetric(uint word, bool condition) {
+    uint count = WaveActiveCountBits(condition);
+    if (WaveIsFirstLane() && count > 0) g_rw_metrics.InterlockedAdd(4 * word, count);
+}
+
+// One atomic per distinct bin in the wave.
+void FFX_Reflections_AddMetricHistogram(uint first_word, uint bin, bool condition) {
+    if (!condition) return;
+    for (;;) {
+        if (bin == WaveReadLaneFirst(bin)) {
+            uint count = WaveActiveCountBits(true);
+            if (WaveIsFirstLane()) g_rw_metrics.InterlockedAdd(4 * (first_word + bin), count);
+            break;
+        }
+    }
+}
+
+#endif
+
+#endif // HSR_METRICS_H
@@ -0,0 +1,152 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Quantizer of the reflection radiance for HSR_PACKED_RADIANCE, where the three radiance targets are R11G11B10_FLOAT.
+// Shared by the shaders and the C++ side (namespace PackedRadianceCodec) so the error can be measured on the CPU.
+//
+// R and G keep 6 mantissa bits, B keeps 5, all three 5 exponent bits and no sign. Rounding each store to the nearest
+// value is fine for a single frame, but the temporal loop blends a few percent of new signal into the history each
+// frame and gets stuck as soon as that step is below half a unit in the last place (ULP), which shows up as banding
+// and slow ghosting in dark areas. FFX_Reflections_QuantizeRadianceChannel rounds stochastically instead: it adds
+// uniform noise of one ULP and truncates, so the result is within one ULP of the input and unbiased on average.
+// The result is exactly representable, so the hardware conversion of the store does not round it again.
+//
+// Relative error for values in [2^-14, 65024]: below 2^-6 for R and G, 2^-5 for B. Smaller values have an absolute
+// error below 2^-20 (R, G) or 2^-19 (B). Negative values and NaN become 0, larger values are clamped.
+//
+// Everything below is integer math or exact float operations, so the C++ twin produces the same bits.
+
+#ifndef PACKED_RADIANCE_H
+#define PACKED_RADIANCE_H
+
+#define FFX_REFLECTIONS_PACKED_RADIANCE_RG_MANTISSA_BITS 6u
+#define FFX_REFLECTIONS_PACKED_RADIANCE_B_MANTISSA_BITS 5u
+#define FFX_REFLECTIONS_PACKED_RADIANCE_MIN_NORMAL_BITS (113u << 23u) // asuint(2^-14)
+#define FFX_REFLECTIONS_PACKED_RADIANCE_RG_MAX 65024.0f               // Largest finite float11
+#define FFX_REFLECTIONS_PACKED_RADIANCE_B_MAX 64512.0f                // Largest finite float10
+
+// Dither streams of the passes that write radiance, so the noise of one pass does not repeat in the next.
+#define FFX_REFLECTIONS_RADIANCE_DITHER_INTERSECT 0u
+#define FFX_REFLECTIONS_RADIANCE_DITHER_REPROJECT 1u
+#define FFX_REFLECTIONS_RADIANCE_DITHER_PREFILTER 2u
+#define FFX_REFLECTIONS_RADIANCE_DITHER_TEMPORAL 3u
+#define FFX_REFLECTIONS_RADIANCE_DITHER_STREAMS 4u
+
+#ifndef __HLSL_VERSION
+
+#    include <cmath>
+#    include <cstdint>
+#    include <cstring>
+
+namespace PackedRadianceCodec {
+
+typedef uint32_t uint;
+
+static inline uint asuint(float x) {
+    uint u;
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+static inline float asfloat(uint u) {
+    float x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+using std::floor;
+
+#    define FFX_PACKED_RADIANCE_INLINE static inline
+#    define FFX_PACKED_RADIANCE_PRECISE
+#else
+#    define FFX_PACKED_RADIANCE_INLINE
+#    define FFX_PACKED_RADIANCE_PRECISE precise
+#endif
+
+// PCG output permutation.
+FFX_PACKED_RADIANCE_INLINE uint FFX_Reflections_RadianceDitherHash(uint x) {
+    uint state = x * 747796405u + 2891336453u;
+    uint word  = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Uniform in [0, 1) with 24 bits, so scaling it by a ULP is exact. seed is frame_index * FFX_REFLECTIONS_RADIANCE_DITHER_STREAMS + stream.
+FFX_PACKED_RADIANCE_INLINE float FFX_Reflections_RadianceDitherNoise(uint pixel_x, uint pixel_y, uint seed, uint channel) {
+    uint hash = FFX_Reflections_RadianceDitherHash(pixel_x ^ FFX_Reflections_RadianceDitherHash(pixel_y ^ FFX_Reflections_RadianceDitherHash(seed * 3u + channel)));
+    return float(hash >> 8u) * (1.0f / 16777216.0f);
+}
+
+// Rounds x down (noise 0) or to the nearest (noise 0.5) value with mantissa_bits bits, or stochastically for uniform noise in [0, 1).
+FFX_PACKED_RADIANCE_INLINE float FFX_Reflections_QuantizeRadianceChannel(float x, uint mantissa_bits, float max_value, float noise) {
+    x = x > 0.0f ? (x < max_value ? x : max_value) : 0.0f;
+    uint exponent_bits = asuint(x) & 0x7f800000u;
+    uint ulp_bits      = (exponent_bits > FFX_REFLECTIONS_PACKED_RADIANCE_MIN_NORMAL_BITS ? exponent_bits : FFX_REFLECTIONS_PACKED_RADIANCE_MIN_NORMAL_BITS) - (mantissa_bits << 23u);
+    FFX_PACKED_RADIANCE_PRECISE float y = x + noise * asfloat(ulp_bits);
+    uint y_bits = asuint(y);
+    if (y_bits < FFX_REFLECTIONS_PACKED_RADIANCE_MIN_NORMAL_BITS) {
+        // Denormal range of the small float, fixed step. Scaling by a power of two is exact.
+        float step = asfloat(FFX_REFLECTIONS_PACKED_RADIANCE_MIN_NORMAL_BITS - (mantissa_bits << 23u));
+        return floor(y / step) * step;
+    }
+    // Crossing into the next binade still truncates onto its coarser grid, the next representable value.
+    y = asfloat(y_bits & ~((1u << (23u - mantissa_bits)) - 1u));
+    return y < max_value ? y : max_value;
+}
+
+FFX_PACKED_RADIANCE_INLINE float FFX_Reflections_QuantizeRadianceRG(float x, float noise) {
+    return FFX_Reflections_QuantizeRadianceChannel(x, FFX_REFLECTIONS_PACKED_RADIANCE_RG_MANTISSA_BITS, FFX_REFLECTIONS_PACKED_RADIANCE_RG_MAX, noise);
+}
+FFX_PACKED_RADIANCE_INLINE float FFX_Reflections_QuantizeRadianceB(float x, float noise) {
+    return FFX_Reflections_QuantizeRadianceChannel(x, FFX_REFLECTIONS_PACKED_RADIANCE_B_MANTISSA_BITS, FFX_REFLECTIONS_PACKED_RADIANCE_B_MAX, noise);
+}
+
+// Bit conversion of a quantized channel, what the R11G11B10_FLOAT store does. Exact for the output of FFX_Reflections_QuantizeRadianceChannel.
+FFX_PACKED_RADIANCE_INLINE uint FFX_Reflections_EncodeRadianceChannel(float x, uint mantissa_bits) {
+    uint bits = asuint(x);
+    if (bits < FFX_REFLECTIONS_PACKED_RADIANCE_MIN_NORMAL_BITS) return uint(x / asfloat(FFX_REFLECTIONS_PACKED_RADIANCE_MIN_NORMAL_BITS - (mantissa_bits << 23u)));
+    return (bits - (112u << 23u)) >> (23u - mantissa_bits);
+}
+
+FFX_PACKED_RADIANCE_INLINE float FFX_Reflections_DecodeRadianceChannel(uint code, uint mantissa_bits) {
+    if ((code >> mantissa_bits) == 0u) return float(code) * asfloat(FFX_REFLECTIONS_PACKED_RADIANCE_MIN_NORMAL_BITS - (mantissa_bits << 23u));
+    return asfloat((code << (23u - mantissa_bits)) + (112u << 23u));
+}
+
+// [0..10] r, [11..21] g, [22..31] b as in DXGI_FORMAT_R11G11B10_FLOAT.
+FFX_PACKED_RADIANCE_INLINE uint FFX_Reflections_PackR11G11B10(float r, float g, float b) {
+    return FFX_Reflections_EncodeRadianceChannel(r, FFX_REFLECTIONS_PACKED_RADIANCE_RG_MANTISSA_BITS)             //
+           | (FFX_Reflections_EncodeRadianceChannel(g, FFX_REFLECTIONS_PACKED_RADIANCE_RG_MANTISSA_BITS) << 11u) //
+           | (FFX_Reflections_EncodeRadianceChannel(b, FFX_REFLECTIONS_PACKED_RADIANCE_B_MANTISSA_BITS) << 22u);
+}
+
+FFX_PACKED_RADIANCE_INLINE float FFX_Reflections_UnpackR11G11B10(uint pack, uint channel) {
+    if (channel == 0u) return FFX_Reflections_DecodeRadianceChannel(pack & 0x7ffu, FFX_REFLECTIONS_PACKED_RADIANCE_RG_MANTISSA_BITS);
+    if (channel == 1u) return FFX_Reflections_DecodeRadianceChannel((pack >> 11u) & 0x7ffu, FFX_REFLECTIONS_PACKED_RADIANCE_RG_MANTISSA_BITS);
+    return FFX_Reflections_DecodeRadianceChannel(pack >> 22u, FFX_REFLECTIONS_PACKED_RADIANCE_B_MANTISSA_BITS);
+}
+
+#undef FFX_PACKED_RADIANCE_INLINE
+#undef FFX_PACKED_RADIANCE_PRECISE
+
+#ifndef __HLSL_VERSION
+} // namespace PackedRadianceCodec
+#endif
+
+#endif // PACKED_RADIANCE_H
@@ -41,7 +41,7 @@ Texture2D<float4> g_gbuffer_normal; // Current GBuffer/normal in reflection targ
 Texture2D<float4> g_gbuffer_depth_history; // Previous GBuffer/depth in reflection target resolution 
 RWTexture2D<min16float3> g_rw_radiance_1; // Radiance target 1 - history radiance 
 RWTexture2D<min16float> g_rw_radiance_variance_1; // Variance target 1 - history 
-RWByteAddressBuffer g_rw_denoise_tile_list; 
+RWByteAddressBuffer g_rw_denoise_pass_tile_list; // g_rw_denoise_tile_list or g_rw_active_denoise_tile_list
 SamplerState g_linear_sampler;
 #endif
 
@@ -73,7 +73,7 @@ void        FFX_DNSR_Reflections_LoadNeighborhood(int2 dispatch_thread_id, out m
 
 // Output
 void FFX_DNSR_Reflections_StorePrefilteredReflections(int2 pixel_coordinate, min16float3 radiance, min16float variance) {
-    g_rw_radiance_1[pixel_coordinate]          = radiance.xyz;
+    g_rw_radiance_1[pixel_coordinate]          = FFX_Reflections_QuantizeRadiance(radiance.xyz, pixel_coordinate, FFX_REFLECTIONS_RADIANCE_DITHER_PREFILTER);
     g_rw_radiance_variance_1[pixel_coordinate] = variance;
 }
 
@@ -87,7 +87,7 @@ void FFX_DNSR_Reflections_StorePrefilteredReflections(int2 pixel_coordinate, min
 void main(int2 group_thread_id : SV_GroupThreadID,
           uint group_index     : SV_GroupIndex,
           uint    group_id     : SV_GroupID) {
-    uint  packed_coords               = g_rw_denoise_tile_list.Load(4 * group_id);
+    uint  packed_coords               = g_rw_denoise_pass_tile_list.Load(4 * group_id);
     int2  dispatch_thread_id          = int2(packed_coords & 0xffffu, (packed_coords >> 16) & 0xffffu) + group_thread_id;
     int2  dispatch_group_id           = dispatch_thread_id / 8;
     uint2 screen_dimensions           = uint2(g_frame_info.reflection_width, g_frame_info.reflection_height);
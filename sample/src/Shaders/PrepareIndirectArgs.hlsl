@@ -25,6 +25,7 @@ THE SOFTWARE.
 HLSL_INIT_GLOBAL_BINDING_TABLE(1)
 
 #include "Common.hlsl"
+#include "Metrics.h"
 
 /////////////////////////////////////////////////////
 // Used resources:                                 //
@@ -59,10 +60,14 @@ void main() {
     g_rw_ray_counter.Store(RAY_COUNTER_DENOISE_OFFSET, 0);
     g_rw_ray_counter.Store(RAY_COUNTER_DENOISE_HISTORY_OFFSET, denoise_tile_count);
 
-    // Feedback for metrics visualization
+    // Feedback for metrics visualization. Runs before the passes that accumulate into the block, so the counters are
+    // reset here.
     {
-        g_rw_metrics.Store(0, sw_ray_count);
-        g_rw_metrics.Store(4, hw_ray_count);
+        for (uint word = HSR_METRICS_VERSION_WORD + 1; word < HSR_METRICS_WORD_COUNT; word++) g_rw_metrics.Store(4 * word, 0);
+        g_rw_metrics.Store(4 * HSR_METRICS_SW_RAYS, sw_ray_count);
+        g_rw_metrics.Store(4 * HSR_METRICS_HW_RAYS, hw_ray_count);
+        g_rw_metrics.Store(4 * HSR_METRICS_VERSION_WORD, HSR_METRICS_VERSION);
+        g_rw_metrics.Store(4 * HSR_METRICS_DENOISE_TILES, denoise_tile_count);
     }
 
     if (!(g_hsr_mask & HSR_FLAGS_USE_RAY_TRACING)) {
@@ -72,6 +77,6 @@ void main() {
         g_rw_indirect_args.Store(INDIRECT_ARGS_HW_OFFSET + 4, 0);
         g_rw_indirect_args.Store(INDIRECT_ARGS_HW_OFFSET + 8, 0);
         g_rw_downsample_counter.Store(0, 0);
-        g_rw_metrics.Store(8, 0);
+        g_rw_metrics.Store(4 * HSR_METRICS_DEFERRED_HW_RAYS, 0);
     }
 }
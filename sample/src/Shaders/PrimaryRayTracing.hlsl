@@ -41,8 +41,9 @@ HLSL_INIT_GLOBAL_BINDING_TABLE(1)
 #define specularCube g_atmosphere_lut
 #define myPerFrame g_frame_info.perFrame
 #define ID_shadowMap_declared
-#define SAMPLE_SHADOW_MAP(shadowIndex, UV, Z, IJ)                                                                                                                                  \
-    (g_textures[NonUniformResourceIndex(GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT + shadowIndex)].SampleCmpLevelZero(g_cmp_sampler, (UV).xy, (Z), IJ.xy).r)
+// The shadow atlas takes the first slot of the shadow map range
+#define SAMPLE_SHADOW_MAP(UV, Z, IJ) (g_textures[GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT].SampleCmpLevelZero(g_cmp_sampler, (UV).xy, (Z), IJ.xy).r)
+#define SHADOW_ATLAS_DIMENSIONS(W, H) g_textures[GDT_TEXTURES_SHADOW_MAP_BEGIN_SLOT].GetDimensions(W, H)
 
 // Useful functions
 #include "functions.hlsl"
@@ -17,6 +17,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include "LightGrid.h"
+#include "LightList.h"
+
 struct MaterialInfo
 {
     float perceptualRoughness; // roughness value, as authored by the model creator (input to shader)
@@ -172,6 +175,55 @@ float3 applySpotLight(Light light, MaterialInfo materialInfo, float3 normal, flo
     return rangeAttenuation * spotAttenuation * light.intensity * light.color * shade;
 }
 
+// Reads a light of the frame from g_rw_lights, mLightView is not uploaded.
+Light LoadLight(uint light_index)
+{
+    uint base = 4 * LIGHT_LIST_LIGHT_WORDS * light_index;
+    Light light;
+    // The columns of mLightViewProj, as in a constant buffer
+    light.mLightViewProj = transpose(float4x4(asfloat(g_rw_lights.Load4(base + 4 * (LIGHT_LIST_VIEW_PROJ + 0))),
+                                              asfloat(g_rw_lights.Load4(base + 4 * (LIGHT_LIST_VIEW_PROJ + 4))),
+                                              asfloat(g_rw_lights.Load4(base + 4 * (LIGHT_LIST_VIEW_PROJ + 8))),
+                                              asfloat(g_rw_lights.Load4(base + 4 * (LIGHT_LIST_VIEW_PROJ + 12)))));
+    light.mLightView = (float4x4)0;
+    light.direction = asfloat(g_rw_lights.Load3(base + 4 * LIGHT_LIST_DIRECTION));
+    light.range = asfloat(g_rw_lights.Load(base + 4 * LIGHT_LIST_RANGE));
+    light.color = asfloat(g_rw_lights.Load3(base + 4 * LIGHT_LIST_COLOR));
+    light.intensity = asfloat(g_rw_lights.Load(base + 4 * LIGHT_LIST_INTENSITY));
+    light.position = asfloat(g_rw_lights.Load3(base + 4 * LIGHT_LIST_POSITION));
+    light.innerConeCos = asfloat(g_rw_lights.Load(base + 4 * LIGHT_LIST_INNER_CONE_COS));
+    light.outerConeCos = asfloat(g_rw_lights.Load(base + 4 * LIGHT_LIST_OUTER_CONE_COS));
+    light.type = asint(g_rw_lights.Load(base + 4 * LIGHT_LIST_TYPE));
+    light.depthBias = asfloat(g_rw_lights.Load(base + 4 * LIGHT_LIST_DEPTH_BIAS));
+    light.shadowMapIndex = asint(g_rw_lights.Load(base + 4 * LIGHT_LIST_SHADOW_MAP_INDEX));
+    return light;
+}
+
+// Shades one light of the grid, skips it where LightGrid_Influences says it is zero.
+float3 applyGridLight(uint light_index, MaterialInfo materialInfo, float3 normal, float3 worldPos, float3 view)
+{
+    Light light = LoadLight(light_index);
+    if (!LightGrid_Influences(light.type, light.range, light.outerConeCos, light.position.x, light.position.y, light.position.z, light.direction.x, light.direction.y,
+                              light.direction.z, worldPos.x, worldPos.y, worldPos.z))
+    {
+        return (0.0f).xxx;
+    }
+    float shadowFactor = CalcShadows(worldPos + normal * 5.0e-3f, int2(0, 0), light);
+    if (light.type == LightType_Directional)
+    {
+        return applyDirectionalLight(light, materialInfo, normal, view) * shadowFactor;
+    }
+    else if (light.type == LightType_Point)
+    {
+        return applyPointLight(light, materialInfo, normal, worldPos, view) * shadowFactor;
+    }
+    else if (light.type == LightType_Spot)
+    {
+        return applySpotLight(light, materialInfo, normal, worldPos, view) * shadowFactor;
+    }
+    return (0.0f).xxx;
+}
+
 struct ShadingInfo
 {
     float3 WorldPos;      // vertex position
@@ -218,25 +270,42 @@ float3 doPbrLighting(ShadingInfo Input, in PerFrame perFrame, float sibl_factor)
         normal = -normal;
     }
     color += getIBLContribution(materialInfo, normal, view, perFrame.u_iblFactor, sibl_factor);
-    for (int i = 0; i < perFrame.u_lightCount; ++i)
+
+    // The global lights are the same for every hit
+    uint global_count = g_rw_light_grid.Load(4 * LIGHT_GRID_GLOBAL_COUNT);
+    for (uint i = 0; i < global_count; ++i)
     {
-        i = WaveReadLaneFirst(i); // Lights are all the same for each fragment
-        Light light = myPerFrame.u_lights[i];
-        float shadowFactor = CalcShadows(Input.WorldPos.xyz + normal.xyz * 5.0e-3f, int2(0, 0), light);
-        if (light.type == LightType_Directional)
-        {
-            color += applyDirectionalLight(light, materialInfo, normal, view) * shadowFactor;
-        }
-        else if (light.type == LightType_Point)
+        i = WaveReadLaneFirst(i);
+        color += applyGridLight(g_rw_light_grid.Load(4 * (LIGHT_GRID_HEADER_WORDS + i)), materialInfo, normal, worldPos, view);
+    }
+
+    // The lights of the hit's cell. Lanes of different cells walk their lists in step, in increasing light order, so
+    // the light stays the same for the whole wave as above.
+    uint3 grid_dims = g_rw_light_grid.Load3(4 * LIGHT_GRID_DIMENSIONS);
+    float3 grid_origin = asfloat(g_rw_light_grid.Load3(4 * LIGHT_GRID_ORIGIN));
+    float3 grid_inv_cell_size = asfloat(g_rw_light_grid.Load3(4 * LIGHT_GRID_INV_CELL_SIZE));
+    uint cell = LightGrid_Cell(worldPos.x, worldPos.y, worldPos.z, grid_origin.x, grid_origin.y, grid_origin.z, grid_inv_cell_size.x, grid_inv_cell_size.y,
+                               grid_inv_cell_size.z, grid_dims.x, grid_dims.y, grid_dims.z);
+    uint2 list = uint2(0, 0);
+    if (cell != LIGHT_GRID_NO_CELL)
+    {
+        list = g_rw_light_grid.Load2(4 * (g_rw_light_grid.Load(4 * LIGHT_GRID_CELL_TABLE) + 2 * cell));
+    }
+    uint cursor = 0;
+    while (true)
+    {
+        uint next = cursor < list.y ? g_rw_light_grid.Load(4 * (list.x + cursor)) : LIGHT_GRID_NO_CELL;
+        uint light_index = WaveActiveMin(next);
+        if (light_index == LIGHT_GRID_NO_CELL)
         {
-            color += applyPointLight(light, materialInfo, normal, worldPos, view) * shadowFactor;
+            break;
         }
-        else if (light.type == LightType_Spot)
+        if (next == light_index)
         {
-            color += applySpotLight(light, materialInfo, normal, worldPos, view) * shadowFactor;
+            color += applyGridLight(light_index, materialInfo, normal, worldPos, view);
+            ++cursor;
         }
     }
 
-
     return color;
 }
\ No newline at end of file
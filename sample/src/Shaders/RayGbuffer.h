@@ -0,0 +1,144 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Bit layout of the deferred ray GBuffer written by the inline ray tracing pass and read by DeferredShade.
+// Shared by the shaders and the C++ side (namespace RayGbufferCodec) so the encoding can be checked on the CPU.
+//
+// Both encodings share the normal/material word:
+//     [ 0.. 7] octahedral normal u, [ 8..15] octahedral normal v, [16..30] material id, [31] skip
+//     The octahedral coordinates are rounded to the nearest of the 256 steps. The default layout used to truncate
+//     them, which moved every normal towards the (0, 0) corner by up to a full step; the decoding is unchanged.
+// Default, 12 bytes: uv as 2 x fp16, normal/material word, ray length as fp32.
+// HSR_COMPACT_RAY_GBUFFER, 8 bytes:
+//     [ 0..10] frac(uv.x), [11..21] frac(uv.y), [22..31] ray length, then the normal/material word.
+//     The uv is only used with wrap samplers so the integer part is dropped. The ray length keeps 4 exponent and
+//     6 mantissa bits of the float, which is a piecewise linear log2 mapping of [2^-7, 2^9) with 0.8% relative error.
+//
+// Everything below is integer math or exact float operations, so the C++ twin produces the same bits.
+
+#ifndef RAY_GBUFFER_H
+#define RAY_GBUFFER_H
+
+#define FFX_REFLECTIONS_RAY_GBUFFER_SIZE 12
+#define FFX_REFLECTIONS_COMPACT_RAY_GBUFFER_SIZE 8
+
+#define FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS 11u
+#define FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_BITS 10u
+#define FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_MIN_BITS (120u << 23u) // asuint(2^-7)
+#define FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_SHIFT 17u              // 23 mantissa bits - 6 kept
+
+// Bins of the material binning pass (HSR_MATERIAL_BINNING), see FFX_Reflections_RayGbufferMaterialBin.
+#define FFX_REFLECTIONS_MATERIAL_BIN_COUNT (0x8000u + 1u)
+
+#ifndef __HLSL_VERSION
+
+#    include <cmath>
+#    include <cstdint>
+#    include <cstring>
+
+namespace RayGbufferCodec {
+
+typedef uint32_t uint;
+
+static inline uint asuint(float x) {
+    uint u;
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+static inline float asfloat(uint u) {
+    float x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+static inline float saturate(float x) { return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x); }
+static inline float frac(float x) { return x - std::floor(x); }
+
+#    define FFX_RAY_GBUFFER_INLINE static inline
+#    define FFX_RAY_GBUFFER_PRECISE
+#else
+#    define FFX_RAY_GBUFFER_INLINE
+#    define FFX_RAY_GBUFFER_PRECISE precise
+#endif
+
+// octahedral_u/v in [0, 1], see OctahedronUV.
+FFX_RAY_GBUFFER_INLINE uint FFX_Reflections_PackRayGbufferNormalMaterial(float octahedral_u, float octahedral_v, uint material_id, bool skip) {
+    FFX_RAY_GBUFFER_PRECISE float nu = saturate(octahedral_u) * 255.0f + 0.5f;
+    FFX_RAY_GBUFFER_PRECISE float nv = saturate(octahedral_v) * 255.0f + 0.5f;
+    uint pack = (uint(nu) << 0u) | (uint(nv) << 8u) | ((material_id & 0x7fffu) << 16u);
+    if (skip) pack |= (1u << 31u);
+    return pack;
+}
+
+FFX_RAY_GBUFFER_INLINE float FFX_Reflections_RayGbufferOctahedralU(uint pack) { return float((pack >> 0u) & 0xffu) / 255.0f; }
+FFX_RAY_GBUFFER_INLINE float FFX_Reflections_RayGbufferOctahedralV(uint pack) { return float((pack >> 8u) & 0xffu) / 255.0f; }
+FFX_RAY_GBUFFER_INLINE uint  FFX_Reflections_RayGbufferMaterialId(uint pack) { return (pack >> 16u) & 0x7fffu; }
+FFX_RAY_GBUFFER_INLINE bool  FFX_Reflections_RayGbufferIsSkip(uint pack) { return (pack & (1u << 31u)) != 0u; }
+
+// Deferred shading bin of a hit: 0 for rays that fall back to the environment, 1 + material id otherwise.
+FFX_RAY_GBUFFER_INLINE uint FFX_Reflections_RayGbufferMaterialBin(uint pack) {
+    return FFX_Reflections_RayGbufferIsSkip(pack) ? 0u : 1u + FFX_Reflections_RayGbufferMaterialId(pack);
+}
+
+FFX_RAY_GBUFFER_INLINE uint FFX_Reflections_EncodeRayGbufferUV(float uv) {
+    // frac and the power of two scale are exact, the rounding add is the only inexact step.
+    FFX_RAY_GBUFFER_PRECISE float scaled = frac(uv) * float(1u << FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS) + 0.5f;
+    return uint(scaled) & ((1u << FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS) - 1u);
+}
+
+FFX_RAY_GBUFFER_INLINE float FFX_Reflections_DecodeRayGbufferUV(uint code) { return float(code) / float(1u << FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS); }
+
+FFX_RAY_GBUFFER_INLINE uint FFX_Reflections_EncodeRayGbufferLength(float ray_length) {
+    uint bits = asuint(ray_length);
+    if ((bits & (1u << 31u)) != 0u || bits <= FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_MIN_BITS) return 0u;
+    uint code = (bits - FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_MIN_BITS + (1u << (FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_SHIFT - 1u))) >> FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_SHIFT;
+    uint max_code = (1u << FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_BITS) - 1u;
+    return code < max_code ? code : max_code;
+}
+
+FFX_RAY_GBUFFER_INLINE float FFX_Reflections_DecodeRayGbufferLength(uint code) {
+    return asfloat(FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_MIN_BITS + (code << FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_SHIFT));
+}
+
+FFX_RAY_GBUFFER_INLINE uint FFX_Reflections_PackCompactRayGbufferUVLength(float u, float v, float ray_length) {
+    return (FFX_Reflections_EncodeRayGbufferUV(u) << 0u)                                      //
+           | (FFX_Reflections_EncodeRayGbufferUV(v) << FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS) //
+           | (FFX_Reflections_EncodeRayGbufferLength(ray_length) << (2u * FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS));
+}
+
+FFX_RAY_GBUFFER_INLINE float FFX_Reflections_CompactRayGbufferU(uint pack) {
+    return FFX_Reflections_DecodeRayGbufferUV(pack & ((1u << FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS) - 1u));
+}
+FFX_RAY_GBUFFER_INLINE float FFX_Reflections_CompactRayGbufferV(uint pack) {
+    return FFX_Reflections_DecodeRayGbufferUV((pack >> FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS) & ((1u << FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS) - 1u));
+}
+FFX_RAY_GBUFFER_INLINE float FFX_Reflections_CompactRayGbufferLength(uint pack) {
+    return FFX_Reflections_DecodeRayGbufferLength(pack >> (2u * FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS));
+}
+
+#undef FFX_RAY_GBUFFER_INLINE
+#undef FFX_RAY_GBUFFER_PRECISE
+
+#ifndef __HLSL_VERSION
+} // namespace RayGbufferCodec
+#endif
+
+#endif // RAY_GBUFFER_H
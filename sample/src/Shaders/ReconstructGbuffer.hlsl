@@ -0,0 +1,130 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+
+#include "Declarations.h"
+
+HLSL_INIT_GLOBAL_BINDING_TABLE(1)
+
+#include "Common.hlsl"
+#include "ReflectionGbuffer.h"
+
+/////////////////////////////////////////////////////
+// Used resources:                                 //
+// See aliases in Descriptors.h and Declarations.h // 
+/////////////////////////////////////////////////////
+
+#if 0
+Texture2D<float4> g_gbuffer_full_depth; // Current GBuffer/depth in render resolution 
+Texture2D<float4> g_gbuffer_full_roughness; // Current GBuffer/specular_roughness in render resolution 
+Texture2D<float4> g_gbuffer_full_normal; // Current GBuffer/normal in render resolution 
+Texture2D<float4> g_gbuffer_full_albedo; // Current GBuffer/albedo in render resolution 
+Texture2D<float4> g_full_motion_vector; // Current GBuffer/motion_vectors in render resolution 
+Texture2D<float4> g_gbuffer_depth; // Current GBuffer/depth in reflection target resolution 
+Texture2D<float4> g_gbuffer_normal; // Current GBuffer/normal in reflection target resolution 
+Texture2D<float4> g_gbuffer_roughness; // Current GBuffer/specular_roughness in reflection target resolution 
+RWTexture2D<float4> g_rw_gbuffer_normal; // Current GBuffer/normal in reflection target resolution 
+RWTexture2D<float4> g_rw_gbuffer_roughness; // Current GBuffer/specular_roughness in reflection target resolution 
+RWTexture2D<float4> g_rw_gbuffer_depth; // Current GBuffer/depth in reflection target resolution 
+RWTexture2D<float4> g_rw_gbuffer_albedo; // Current GBuffer/albedo in reflection target resolution 
+RWTexture2D<float4> g_rw_motion_vector; // Current GBuffer/motion_vectors in reflection target resolution 
+RWByteAddressBuffer g_rw_gbuffer_capture; 
+#endif
+
+struct PushConstants {
+    uint footprint; // REFLECTION_GBUFFER_FOOTPRINT_*
+    uint pad0;
+};
+
+[[vk::push_constant]] ConstantBuffer<PushConstants> pc : DX12_PUSH_CONSTANTS;
+
+// Builds the reflection resolution GBuffer from the render resolution one, see ReflectionGbuffer.h. Every value is
+// copied from the picked sample, nothing is filtered.
+[numthreads(8, 8, 1)]
+void main(uint2 dispatch_thread_id : SV_DispatchThreadID) {
+    uint2 screen_size     = uint2(g_frame_info.base_width, g_frame_info.base_height);
+    uint2 reflection_size = uint2(g_frame_info.reflection_width, g_frame_info.reflection_height);
+    if (any(dispatch_thread_id >= reflection_size)) return;
+
+    uint2 best = uint2(ReflectionGbuffer_FootprintCenter(dispatch_thread_id.x, screen_size.x, reflection_size.x),
+                       ReflectionGbuffer_FootprintCenter(dispatch_thread_id.y, screen_size.y, reflection_size.y));
+    if (pc.footprint != REFLECTION_GBUFFER_FOOTPRINT_CENTER) {
+        uint2 begin = uint2(ReflectionGbuffer_FootprintBegin(dispatch_thread_id.x, screen_size.x, reflection_size.x),
+                            ReflectionGbuffer_FootprintBegin(dispatch_thread_id.y, screen_size.y, reflection_size.y));
+        uint2 end   = uint2(ReflectionGbuffer_FootprintEnd(dispatch_thread_id.x, screen_size.x, reflection_size.x),
+                            ReflectionGbuffer_FootprintEnd(dispatch_thread_id.y, screen_size.y, reflection_size.y));
+        float best_depth     = g_gbuffer_full_depth.Load(int3(best, 0)).x;
+        float best_roughness = g_gbuffer_full_roughness.Load(int3(best, 0)).w;
+        for (uint y = begin.y; y < end.y; y++) {
+            for (uint x = begin.x; x < end.x; x++) {
+                float depth     = g_gbuffer_full_depth.Load(int3(x, y, 0)).x;
+                float roughness = g_gbuffer_full_roughness.Load(int3(x, y, 0)).w;
+                if (ReflectionGbuffer_IsBetter(pc.footprint, depth, roughness, best_depth, best_roughness)) {
+                    best           = uint2(x, y);
+                    best_depth     = depth;
+                    best_roughness = roughness;
+                }
+            }
+        }
+    }
+    int3 coord = int3(best, 0);
+    g_rw_gbuffer_depth[dispatch_thread_id]     = g_gbuffer_full_depth.Load(coord);
+    g_rw_gbuffer_normal[dispatch_thread_id]    = g_gbuffer_full_normal.Load(coord);
+    g_rw_gbuffer_roughness[dispatch_thread_id] = g_gbuffer_full_roughness.Load(coord);
+    g_rw_gbuffer_albedo[dispatch_thread_id]    = g_gbuffer_full_albedo.Load(coord);
+    g_rw_motion_vector[dispatch_thread_id]     = g_full_motion_vector.Load(coord);
+}
+
+// GBuffer capture, the render resolution planes followed by the reflection resolution ones, see
+// ReflectionGbufferReference.h. The reflection GBuffer is read through the bindings HSR reads it from, so the capture
+// holds whatever the frame used, the raster pass or the reconstruction.
+
+void StorePlane(uint offset, uint2 size, uint plane, uint2 pixel_coordinate, float value) {
+    g_rw_gbuffer_capture.Store(4 * (offset + plane * size.x * size.y + pixel_coordinate.y * size.x + pixel_coordinate.x), asuint(value));
+}
+
+void StoreGbuffer(uint offset, uint2 size, uint2 pixel_coordinate, float depth, float3 normal, float roughness) {
+    StorePlane(offset, size, REFLECTION_GBUFFER_CAPTURE_DEPTH, pixel_coordinate, depth);
+    StorePlane(offset, size, REFLECTION_GBUFFER_CAPTURE_NORMAL + 0, pixel_coordinate, normal.x);
+    StorePlane(offset, size, REFLECTION_GBUFFER_CAPTURE_NORMAL + 1, pixel_coordinate, normal.y);
+    StorePlane(offset, size, REFLECTION_GBUFFER_CAPTURE_NORMAL + 2, pixel_coordinate, normal.z);
+    StorePlane(offset, size, REFLECTION_GBUFFER_CAPTURE_ROUGHNESS, pixel_coordinate, roughness);
+}
+
+[numthreads(8, 8, 1)]
+void CaptureFull(uint2 dispatch_thread_id : SV_DispatchThreadID) {
+    uint2 screen_size = uint2(g_frame_info.base_width, g_frame_info.base_height);
+    if (any(dispatch_thread_id >= screen_size)) return;
+    int3 coord = int3(dispatch_thread_id, 0);
+    StoreGbuffer(0, screen_size, dispatch_thread_id, g_gbuffer_full_depth.Load(coord).x, g_gbuffer_full_normal.Load(coord).xyz,
+                 g_gbuffer_full_roughness.Load(coord).w);
+}
+
+[numthreads(8, 8, 1)]
+void CaptureReflection(uint2 dispatch_thread_id : SV_DispatchThreadID) {
+    uint2 screen_size     = uint2(g_frame_info.base_width, g_frame_info.base_height);
+    uint2 reflection_size = uint2(g_frame_info.reflection_width, g_frame_info.reflection_height);
+    if (any(dispatch_thread_id >= reflection_size)) return;
+    int3 coord = int3(dispatch_thread_id, 0);
+    StoreGbuffer(REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT * screen_size.x * screen_size.y, reflection_size, dispatch_thread_id, g_gbuffer_depth.Load(coord).x,
+                 g_gbuffer_normal.Load(coord).xyz, g_gbuffer_roughness.Load(coord).w);
+}
@@ -0,0 +1,95 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Reconstruction of the reflection resolution GBuffer from the render resolution one, instead of rasterizing the scene a
+// second time at the reflection resolution. Shared by ReconstructGbuffer.hlsl and the C++ model (namespace
+// ReflectionGbufferModel) that checks it against captures of the raster path.
+//
+// Every reflection pixel takes all of its GBuffer values from one render resolution sample of its footprint, the
+// render pixels it overlaps. Depth stays exact and normals and roughness are never filtered across edges, as with the
+// raster pass. The footprint policy picks the sample:
+//   CENTER    the render pixel under the reflection pixel center, the one rasterizing at the lower resolution would
+//             have sampled up to the offset between the two pixel grids.
+//   CLOSEST   the closest surface of the footprint, like the half resolution downsample. Keeps thin foreground objects.
+//   GLOSSIEST the surface with the lowest roughness, ties go to the closer one. Keeps glossy pixels next to rough ones.
+// Every policy starts from the CENTER sample and only leaves it for a strictly better one, so the background only
+// wins when the whole footprint is background and ties go to the center, then to the first sample row by row.
+
+#ifndef REFLECTION_GBUFFER_H
+#define REFLECTION_GBUFFER_H
+
+#define REFLECTION_GBUFFER_FOOTPRINT_CENTER 0u
+#define REFLECTION_GBUFFER_FOOTPRINT_CLOSEST 1u
+#define REFLECTION_GBUFFER_FOOTPRINT_GLOSSIEST 2u
+#define REFLECTION_GBUFFER_FOOTPRINT_COUNT 3u
+
+#define REFLECTION_GBUFFER_BACKGROUND_DEPTH (1.0f - 1.e-6f) // As FFX_DNSR_Reflections_IsBackground.
+
+// fp32 planes of a GBuffer capture, each GBuffer is captured as these planes. Normals are stored encoded, as in the
+// GBuffer, roughness is the w channel of the specular roughness target.
+#define REFLECTION_GBUFFER_CAPTURE_DEPTH 0
+#define REFLECTION_GBUFFER_CAPTURE_NORMAL 1 // 3 planes
+#define REFLECTION_GBUFFER_CAPTURE_ROUGHNESS 4
+#define REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT 5
+
+#ifndef __HLSL_VERSION
+
+#    include <cstdint>
+
+namespace ReflectionGbufferModel {
+
+typedef uint32_t uint;
+
+#    define REFLECTION_GBUFFER_INLINE static inline
+#else
+#    define REFLECTION_GBUFFER_INLINE
+#endif
+
+// Render pixels [begin, end) of reflection pixel 'p' along one axis, 'size' render pixels for 'reflectionSize' ones.
+REFLECTION_GBUFFER_INLINE uint ReflectionGbuffer_FootprintBegin(uint p, uint size, uint reflectionSize) { return (p * size) / reflectionSize; }
+REFLECTION_GBUFFER_INLINE uint ReflectionGbuffer_FootprintEnd(uint p, uint size, uint reflectionSize) {
+    uint end = ((p + 1u) * size + reflectionSize - 1u) / reflectionSize;
+    return end < size ? end : size;
+}
+REFLECTION_GBUFFER_INLINE uint ReflectionGbuffer_FootprintCenter(uint p, uint size, uint reflectionSize) {
+    uint center = ((2u * p + 1u) * size) / (2u * reflectionSize);
+    return center < size ? center : size - 1u;
+}
+
+REFLECTION_GBUFFER_INLINE bool ReflectionGbuffer_IsBackground(float depth) { return depth >= REFLECTION_GBUFFER_BACKGROUND_DEPTH; }
+
+// Whether the sample (depth, roughness) replaces the best one so far under 'footprint', strictly so the CPU and the GPU
+// resolve ties alike.
+REFLECTION_GBUFFER_INLINE bool ReflectionGbuffer_IsBetter(uint footprint, float depth, float roughness, float bestDepth, float bestRoughness) {
+    if (ReflectionGbuffer_IsBackground(depth)) return false;
+    if (ReflectionGbuffer_IsBackground(bestDepth)) return true;
+    if (footprint == REFLECTION_GBUFFER_FOOTPRINT_GLOSSIEST && roughness != bestRoughness) return roughness < bestRoughness;
+    return depth < bestDepth;
+}
+
+#undef REFLECTION_GBUFFER_INLINE
+
+#ifndef __HLSL_VERSION
+} // namespace ReflectionGbufferModel
+#endif
+
+#endif // REFLECTION_GBUFFER_H
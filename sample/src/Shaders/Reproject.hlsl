@@ -49,7 +49,7 @@ RWTexture2D<min16float3> g_rw_radiance_reprojected; // Radiance target 2 - repro
 RWTexture2D<min16float> g_rw_radiance_variance_0; // Variance target 0 - current variance/ray length 
 RWTexture2D<min16float> g_rw_radiance_num_samples_0; // Sample counter target 0 - current 
 RWTexture2D<float4> g_rw_radiance_avg; // 8x8 average radiance 
-RWByteAddressBuffer g_rw_denoise_tile_list; 
+RWByteAddressBuffer g_rw_denoise_pass_tile_list; // g_rw_denoise_tile_list or g_rw_active_denoise_tile_list
 SamplerState g_linear_sampler; 
 #endif
 
@@ -85,7 +85,7 @@ float FFX_DNSR_Reflections_GetRandom(int2 dispatch_thread_id) {
 
 // Output
 void FFX_DNSR_Reflections_StoreRadianceReprojected(int2 pixel_coordinate, min16float3 value) {
-    g_rw_radiance_reprojected[pixel_coordinate] = value.xyz;
+    g_rw_radiance_reprojected[pixel_coordinate] = FFX_Reflections_QuantizeRadiance(value.xyz, pixel_coordinate, FFX_REFLECTIONS_RADIANCE_DITHER_REPROJECT);
 }
 void FFX_DNSR_Reflections_StoreVariance(int2 pixel_coordinate, min16float value) {
     g_rw_radiance_variance_0[pixel_coordinate] = value;
@@ -107,7 +107,7 @@ void FFX_DNSR_Reflections_StoreAverageRadiance(int2 pixel_coordinate, min16float
 void main(int2 group_thread_id      : SV_GroupThreadID,
                 uint group_index    : SV_GroupIndex,
                 uint    group_id    : SV_GroupID) {
-    uint  packed_coords      = g_rw_denoise_tile_list.Load(4 * group_id);
+    uint  packed_coords      = g_rw_denoise_pass_tile_list.Load(4 * group_id);
     int2  dispatch_thread_id = int2(packed_coords & 0xffffu, (packed_coords >> 16) & 0xffffu) + group_thread_id;
     int2  dispatch_group_id  = dispatch_thread_id / 8;
     uint2 g_buffer_dimensions = uint2(g_frame_info.reflection_width, g_frame_info.reflection_height);
@@ -0,0 +1,62 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Where a light's shadow map lives in the shadow atlas, packed into Light::shadowMapIndex so the light layout shared with
+// Cauldron stays the same. Shared by shadowFiltering.h and the C++ allocator (ShadowAtlas.h in the DX12 sources).
+//
+// Tiles are power of two squares aligned to their size. A negative index means no shadow, otherwise:
+//   bits  0-11  x of the tile, in tiles of its own size
+//   bits 12-23  y of the tile, in tiles of its own size
+//   bits 24-28  level, the tile is (atlas size >> level) texels wide
+
+#ifndef SHADOW_ATLAS_TILE_H
+#define SHADOW_ATLAS_TILE_H
+
+#define SHADOW_ATLAS_MAX_LEVEL 12u
+
+#ifndef __HLSL_VERSION
+
+#    include <cstdint>
+
+namespace ShadowAtlasModel {
+
+typedef uint32_t uint;
+
+#    define SHADOW_ATLAS_INLINE static inline
+#else
+#    define SHADOW_ATLAS_INLINE
+#endif
+
+SHADOW_ATLAS_INLINE int  ShadowAtlas_PackTile(uint x, uint y, uint level) { return int(x | (y << 12u) | (level << 24u)); }
+SHADOW_ATLAS_INLINE uint ShadowAtlas_TileX(int packed) { return uint(packed) & 0xfffu; }
+SHADOW_ATLAS_INLINE uint ShadowAtlas_TileY(int packed) { return (uint(packed) >> 12u) & 0xfffu; }
+SHADOW_ATLAS_INLINE uint ShadowAtlas_TileLevel(int packed) { return (uint(packed) >> 24u) & 0x1fu; }
+// Width of the tile in atlas uv, the corner is at (x, y) times this.
+SHADOW_ATLAS_INLINE float ShadowAtlas_TileScale(int packed) { return 1.0f / float(1u << ShadowAtlas_TileLevel(packed)); }
+
+#undef SHADOW_ATLAS_INLINE
+
+#ifndef __HLSL_VERSION
+} // namespace ShadowAtlasModel
+#endif
+
+#endif // SHADOW_ATLAS_TILE_H
@@ -40,7 +40,7 @@ Texture2D<min16float> g_radiance_variance_1; // Variance target 1 - history
 Texture2D<min16float> g_radiance_num_samples_0; // Sample counter target 0 - current 
 RWTexture2D<min16float3> g_rw_radiance_0; // Radiance target 0 - intersection results 
 RWTexture2D<min16float> g_rw_radiance_variance_0; // Variance target 0 - current variance/ray length 
-RWByteAddressBuffer g_rw_denoise_tile_list; 
+RWByteAddressBuffer g_rw_denoise_pass_tile_list; // g_rw_denoise_tile_list or g_rw_active_denoise_tile_list
 RWTexture2D<float4> g_rw_debug; // Debug target 
 SamplerState g_linear_sampler; 
 #endif
@@ -60,7 +60,7 @@ min16float  FFX_DNSR_Reflections_LoadNumSamples(int2 pixel_coordinate) { return
 
 // Output
 void FFX_DNSR_Reflections_StoreTemporalAccumulation(int2 pixel_coordinate, min16float3 radiance, min16float variance) {
-    g_rw_radiance_0[pixel_coordinate]          = radiance.xyz;
+    g_rw_radiance_0[pixel_coordinate]          = FFX_Reflections_QuantizeRadiance(radiance.xyz, pixel_coordinate, FFX_REFLECTIONS_RADIANCE_DITHER_TEMPORAL);
     g_rw_radiance_variance_0[pixel_coordinate] = variance;
 }
 //////////////////////////////////
@@ -73,7 +73,7 @@ void FFX_DNSR_Reflections_StoreTemporalAccumulation(int2 pixel_coordinate, min16
 void main(int2 group_thread_id : SV_GroupThreadID,
           uint group_index     : SV_GroupIndex,
           uint    group_id     : SV_GroupID) {
-    uint   packed_coords           = g_rw_denoise_tile_list.Load(4 * group_id);
+    uint   packed_coords           = g_rw_denoise_pass_tile_list.Load(4 * group_id);
     int2   dispatch_thread_id      = int2(packed_coords & 0xffffu, (packed_coords >> 16) & 0xffffu) + group_thread_id;
     int2   dispatch_group_id       = dispatch_thread_id / 8;
     uint2  g_buffer_dimensions     = uint2(g_frame_info.reflection_width, g_frame_info.reflection_height);
@@ -17,11 +17,17 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include "ShadowAtlasTile.h"
+
+// All shadow maps live in one atlas, light.shadowMapIndex holds the tile (see ShadowAtlasTile.h).
+// Users that bind the atlas themselves define ID_shadowMap_declared, SAMPLE_SHADOW_MAP(UV, Z, IJ) and
+// SHADOW_ATLAS_DIMENSIONS(W, H).
 #ifdef ID_shadowMap
-Texture2D                  shadowMaps[MAX_SHADOW_INSTANCES] : register(TEX(ID_shadowMap));
+Texture2D                  shadowAtlas  : register(TEX(ID_shadowMap));
 SamplerComparisonState     samShadow    : register(SMP(ID_shadowMap));
 #define ID_shadowMap_declared
-#define SAMPLE_SHADOW_MAP(shadowIndex, UV, Z, IJ) (shadowMaps[shadowIndex].SampleCmpLevelZero(samShadow, (UV).xy, (Z), IJ.xy).r)
+#define SAMPLE_SHADOW_MAP(UV, Z, IJ) (shadowAtlas.SampleCmpLevelZero(samShadow, (UV).xy, (Z), IJ.xy).r)
+#define SHADOW_ATLAS_DIMENSIONS(W, H) shadowAtlas.GetDimensions(W, H)
 #endif
  
 #ifdef ID_shadowBuffer
@@ -36,12 +42,21 @@ float FilterShadow(int shadowIndex, float3 uv)
     float shadow = 0.0;
 
     static const int kernelLevel = 1;
+
+    // Move into the light's tile, keeping the kernel from picking up texels of the neighbouring tiles
+    uint atlasWidth, atlasHeight;
+    SHADOW_ATLAS_DIMENSIONS(atlasWidth, atlasHeight);
+    const float  tileScale = ShadowAtlas_TileScale(shadowIndex);
+    const float2 tileMin   = float2(ShadowAtlas_TileX(shadowIndex), ShadowAtlas_TileY(shadowIndex)) * tileScale;
+    const float2 margin    = (kernelLevel + 0.5f) / float2(atlasWidth, atlasHeight);
+    uv.xy = clamp(tileMin + uv.xy * tileScale, tileMin + margin, tileMin + tileScale - margin);
+
     static const int kernelWidth = 2 * kernelLevel + 1;
     for (int i = -kernelLevel; i <= kernelLevel; i++)
     {
         for (int j = -kernelLevel; j <= kernelLevel; j++)
         {
-            shadow += SAMPLE_SHADOW_MAP(shadowIndex, uv.xy, uv.z, int2(i, j));
+            shadow += SAMPLE_SHADOW_MAP(uv.xy, uv.z, int2(i, j));
         }
     }
 
@@ -76,12 +91,6 @@ float DoSpotShadow(in float3 vPosition, Light light)
         if (shadowTexCoord.z > 1.0f) return 1.0f;
     }
 
-    // offsets of the center of the shadow map atlas
-    /*float offsetsX[4] = { 0.0, 1.0, 0.0, 1.0 };
-    float offsetsY[4] = { 0.0, 0.0, 1.0, 1.0 };
-    shadowTexCoord.x += offsetsX[light.shadowMapIndex] * .5;
-    shadowTexCoord.y += offsetsY[light.shadowMapIndex] * .5;*/
-
     shadowTexCoord.z -= light.depthBias;
     
     return FilterShadow(light.shadowMapIndex, shadowTexCoord.xyz);
@@ -0,0 +1,285 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Replays barrier request logs written by HSR::CaptureBarriers through the ResourceStateTracker
+// (ResourceStateTracker.h) into a command list mock that records the batches, and checks them against the requests:
+// every transition starts from the state the resource is in, a split barrier ends before the resource is used, each
+// resource is in the requested state when the work after a flush runs, UAV writes are waited for, and every resource
+// is back in its default state at the end of the frame.
+//
+// Usage: HSRBarrierReplay [--batches] <barriers.txt>...
+//        HSRBarrierReplay --self-check
+//
+// --batches lists the barriers of each ResourceBarrier call. --self-check runs small request sequences with known
+// results instead of captures. The exit code is 1 if a check fails, 2 on usage or file errors.
+
+#include "ResourceStateTracker.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRBarrierReplay [--batches] <barriers.txt>...\n       HSRBarrierReplay --self-check\n"); }
+
+static uint32_t ResourceId(TrackedResource resource) { return uint32_t(reinterpret_cast<uintptr_t>(resource) - 1); }
+
+// Command list mock: records each ResourceBarrier call and applies it to its own view of the resource states.
+class RecordingCommandList : public ResourceBarrierSink {
+public:
+    struct Split {
+        uint32_t before;
+        uint32_t after;
+    };
+
+    std::map<TrackedResource, uint32_t>      states;
+    std::map<TrackedResource, Split>         splits; // Begun and not ended.
+    std::set<TrackedResource>                synced; // Resources with a barrier in the last call.
+    std::vector<std::vector<TrackedBarrier>> calls;
+    std::string                              error;
+
+    void ResourceBarriers(TrackedBarrier const *pBarriers, uint32_t count) override {
+        calls.push_back(std::vector<TrackedBarrier>(pBarriers, pBarriers + count));
+        synced.clear();
+        for (uint32_t i = 0; i < count; i++) Apply(pBarriers[i]);
+    }
+
+private:
+    void Fail(TrackedBarrier const &barrier, char const *pWhat) {
+        if (!error.empty()) return;
+        char text[160];
+        snprintf(text, sizeof(text), "call %u: r%u %s", uint32_t(calls.size() - 1), ResourceId(barrier.resource), pWhat);
+        error = text;
+    }
+
+    void Apply(TrackedBarrier const &barrier) {
+        synced.insert(barrier.resource);
+        auto split = splits.find(barrier.resource);
+        if (barrier.type == TrackedBarrierType::Aliasing) return;
+        if (barrier.type == TrackedBarrierType::UnorderedAccess) {
+            if (split != splits.end()) Fail(barrier, "UAV barrier in the middle of a split barrier");
+            return;
+        }
+        if (barrier.split == TrackedBarrierSplit::End) {
+            if (split == splits.end() || split->second.before != barrier.before || split->second.after != barrier.after)
+                Fail(barrier, "split barrier ends without a matching begin");
+            else
+                splits.erase(split);
+            states[barrier.resource] = barrier.after;
+            return;
+        }
+        if (split != splits.end()) Fail(barrier, "transition in the middle of a split barrier");
+        if (states[barrier.resource] != barrier.before) Fail(barrier, "transition does not start from the current state");
+        if (barrier.before == barrier.after) Fail(barrier, "transition to the state the resource is in");
+        if (barrier.split == TrackedBarrierSplit::Begin)
+            splits[barrier.resource] = Split{barrier.before, barrier.after};
+        else
+            states[barrier.resource] = barrier.after;
+    }
+};
+
+static std::string FormatBarrier(TrackedBarrier const &barrier) {
+    char id[16];
+    snprintf(id, sizeof(id), "r%u ", ResourceId(barrier.resource));
+    switch (barrier.type) {
+    case TrackedBarrierType::UnorderedAccess:
+        return std::string(id) + "UAV";
+    case TrackedBarrierType::Aliasing:
+        return std::string(id) + "aliasing";
+    default:
+        break;
+    }
+    std::string text = std::string(id) + FormatTrackedState(barrier.before) + " -> " + FormatTrackedState(barrier.after);
+    if (barrier.split == TrackedBarrierSplit::Begin) text += " (begin)";
+    if (barrier.split == TrackedBarrierSplit::End) text += " (end)";
+    return text;
+}
+
+// Replays 'log' line by line and checks the calls of the mock against what the requests need at each flush.
+static bool Replay(std::string const &log, ResourceStateTracker &tracker, RecordingCommandList &commandList, std::string *pError) {
+    std::map<TrackedResource, uint32_t> requested; // State the requests left each resource in.
+    std::map<TrackedResource, uint32_t> defaults;
+    std::set<TrackedResource>           used;         // Requested since the last flush.
+    std::set<TrackedResource>           needsUAVSync; // Asked for a UAV barrier since the last flush.
+
+    tracker.BeginFrame();
+    std::istringstream stream(log);
+    std::string        line;
+    uint32_t           lineNumber = 0;
+    while (std::getline(stream, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') continue;
+        if (!ReplayResourceStateLog(line, tracker, commandList, pError)) {
+            *pError = "line " + std::to_string(lineNumber) + ": " + *pError;
+            return false;
+        }
+        if (!commandList.error.empty()) {
+            *pError = commandList.error;
+            return false;
+        }
+
+        char     op[16] = {};
+        uint32_t id     = 0;
+        uint32_t state  = 0;
+        sscanf(line.c_str(), "%15s %u %x", op, &id, &state);
+        TrackedResource resource = reinterpret_cast<TrackedResource>(uintptr_t(id) + 1);
+        if (!strcmp(op, "default")) {
+            defaults[resource]           = state;
+            requested[resource]          = state;
+            commandList.states[resource] = state;
+        } else if (!strcmp(op, "transition")) {
+            if (requested.count(resource) && requested[resource] == state && (state & TRACKED_STATE_UNORDERED_ACCESS)) needsUAVSync.insert(resource);
+            requested[resource] = state;
+            used.insert(resource);
+        } else if (!strcmp(op, "begin")) {
+            requested[resource] = state;
+        } else if (!strcmp(op, "flush") || !strcmp(op, "end")) {
+            bool const end = !strcmp(op, "end");
+            if (end) {
+                used.clear();
+                for (auto const &item : requested) used.insert(item.first);
+            }
+            for (TrackedResource r : used) {
+                uint32_t expected = end ? (defaults.count(r) ? defaults[r] : TRACKED_STATE_COMMON) : requested[r];
+                if (commandList.splits.count(r)) {
+                    *pError = "line " + std::to_string(lineNumber) + ": r" + std::to_string(ResourceId(r)) + " is used in the middle of a split barrier";
+                    return false;
+                }
+                if (commandList.states[r] != expected) {
+                    *pError = "line " + std::to_string(lineNumber) + ": r" + std::to_string(ResourceId(r)) + " is " + FormatTrackedState(commandList.states[r]) +
+                              ", requested " + FormatTrackedState(expected);
+                    return false;
+                }
+            }
+            for (TrackedResource r : needsUAVSync) {
+                if (!commandList.synced.count(r)) {
+                    *pError = "line " + std::to_string(lineNumber) + ": the writes to r" + std::to_string(ResourceId(r)) + " are not waited for";
+                    return false;
+                }
+            }
+            used.clear();
+            needsUAVSync.clear();
+            commandList.synced.clear();
+        }
+    }
+    return true;
+}
+
+static void PrintStats(ResourceStateTrackerStats const &stats) {
+    printf("%u requests, %u ResourceBarrier calls, %u transitions (%u split, %u merged), %u UAV barriers (%u dropped), %u aliasing\n", stats.requests,
+           stats.batches, stats.transitions, stats.splits, stats.merged, stats.uavBarriers, stats.droppedUAV, stats.aliasing);
+}
+
+// Request sequences with the barriers they should produce.
+static int SelfCheck() {
+    struct Scenario {
+        char const *pName;
+        char const *pLog;
+        uint32_t    batches, transitions, splits, merged, uavBarriers, droppedUAV, aliasing;
+    } const scenarios[] = {
+        {"split across an idle pass", "transition 0 0x8\nflush\nbegin 0 0x40\nflush\nflush\ntransition 0 0x40\nflush\nend\n", 4, 3, 1, 0, 0, 0, 0},
+        {"split without an idle pass", "transition 0 0x8\nflush\nbegin 0 0x40\ntransition 0 0x40\nflush\nend\n", 3, 3, 0, 0, 0, 0, 0},
+        {"redundant UAV barriers", "default 0 0x8\ntransition 0 0x8\nflush\ntransition 0 0x8\ntransition 0 0x8\nflush\nend\n", 2, 0, 0, 0, 2, 1, 0},
+        {"merged transitions", "default 0 0x40\ntransition 0 0x8\ntransition 0 0x200\nflush\ntransition 0 0x8\ntransition 0 0x200\nflush\nend\n", 2, 2, 0, 2, 0, 0, 0},
+        {"UAV round trip", "default 0 0x8\nflush\ntransition 0 0x40\ntransition 0 0x8\nflush\nend\n", 1, 0, 0, 1, 1, 0, 0},
+        {"aliasing order", "transition 0 0x8\nalias 0\ntransition 0 0x40\nflush\nend\n", 2, 3, 0, 0, 0, 0, 1},
+        {"UAV barrier replaced by a transition", "default 0 0x8\nflush\ntransition 0 0x8\ntransition 0 0x40\nflush\nend\n", 2, 2, 0, 0, 0, 1, 0},
+        // The shadow atlas of SampleRenderer rests in PIXEL|NON_PIXEL_SHADER_RESOURCE and is created in DEPTH_WRITE.
+        {"shadow atlas, tiles rendered", "default 0 0xc0\ntransition 0 0x10\nflush\ntransition 0 0xc0\nflush\n", 2, 2, 0, 0, 0, 0, 0},
+        {"shadow atlas, all tiles kept", "default 0 0xc0\ntransition 0 0xc0\nflush\n", 0, 0, 0, 0, 0, 1, 0},
+        {"shadow atlas, first frame", "default 0 0x10\ntransition 0 0x10\nflush\ntransition 0 0xc0\nflush\n", 1, 1, 0, 0, 0, 1, 0},
+    };
+
+    int failures = 0;
+    for (Scenario const &scenario : scenarios) {
+        ResourceStateTracker tracker;
+        RecordingCommandList commandList;
+        std::string          error;
+        bool                 ok    = Replay(scenario.pLog, tracker, commandList, &error);
+        auto const &         stats = tracker.GetStats();
+        if (ok && (stats.batches != scenario.batches || stats.transitions != scenario.transitions || stats.splits != scenario.splits ||
+                   stats.merged != scenario.merged || stats.uavBarriers != scenario.uavBarriers || stats.droppedUAV != scenario.droppedUAV ||
+                   stats.aliasing != scenario.aliasing)) {
+            ok    = false;
+            error = "unexpected barriers";
+        }
+        printf("%-40s %s\n", scenario.pName, ok ? "ok" : error.c_str());
+        if (!ok) {
+            PrintStats(stats);
+            failures++;
+        }
+    }
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    bool                     batches = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--self-check"))
+            return SelfCheck();
+        else if (!strcmp(argv[i], "--batches"))
+            batches = true;
+        else if (argv[i][0] == '-') {
+            PrintUsage();
+            return 2;
+        } else
+            files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        PrintUsage();
+        return 2;
+    }
+
+    int result = 0;
+    for (std::string const &file : files) {
+        std::ifstream stream(file);
+        if (!stream) {
+            fprintf(stderr, "error: could not read %s\n", file.c_str());
+            return 2;
+        }
+        std::stringstream log;
+        log << stream.rdbuf();
+
+        ResourceStateTracker tracker;
+        RecordingCommandList commandList;
+        std::string          error;
+        bool                 ok = Replay(log.str(), tracker, commandList, &error);
+        printf("%s: ", file.c_str());
+        PrintStats(tracker.GetStats());
+        if (batches) {
+            for (size_t call = 0; call < commandList.calls.size(); call++) {
+                printf("  call %u\n", uint32_t(call));
+                for (TrackedBarrier const &barrier : commandList.calls[call]) printf("    %s\n", FormatBarrier(barrier).c_str());
+            }
+        }
+        if (!ok) {
+            printf("  error: %s\n", error.c_str());
+            result = 1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,131 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Compares HSR benchmark frame logs (HSR_Bench_*_frames.csv) of a baseline and a candidate configuration.
+//
+// Usage: HSRBenchCompare [--alpha 0.01] [--threshold 2] [--skip 0] --baseline a.csv [b.csv ...] --candidate c.csv [d.csv ...]
+//
+// Frames of all the runs of a side are pooled per column. A timing column (suffix "_us") is flagged as a regression
+// when the candidate median is more than threshold percent above the baseline median and the Mann-Whitney U test
+// rejects equal distributions at the alpha level. The exit code is 1 if any column regressed, 2 on usage errors.
+
+#include "BenchmarkStats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static void PrintUsage() {
+    fprintf(stderr, "Usage: HSRBenchCompare [--alpha 0.01] [--threshold 2] [--skip 0] --baseline a.csv [b.csv ...] --candidate c.csv [d.csv ...]\n");
+}
+
+static bool LoadRuns(std::vector<std::string> const &files, std::vector<BenchmarkLog> &runs) {
+    for (auto const &file : files) {
+        std::ifstream in(file);
+        BenchmarkLog  log;
+        if (!in || !BenchmarkLog::ReadCsv(in, log)) {
+            fprintf(stderr, "error: %s is not a benchmark frame log\n", file.c_str());
+            return false;
+        }
+        runs.push_back(log);
+    }
+    return true;
+}
+
+static std::vector<double> Pool(std::vector<BenchmarkLog> const &runs, std::string const &column, size_t skip) {
+    std::vector<double> pooled;
+    for (auto const &run : runs) {
+        int index = run.FindColumn(column);
+        if (index < 0) continue;
+        auto const &series = run.GetSeries(index);
+        if (series.size() > skip) pooled.insert(pooled.end(), series.begin() + skip, series.end());
+    }
+    return pooled;
+}
+
+static void PrintMetadataDifferences(std::vector<BenchmarkLog> const &baseline, std::vector<BenchmarkLog> const &candidate) {
+    for (auto const &item : baseline[0].GetMetadata()) {
+        auto const &other = candidate[0].GetMetadata();
+        auto        it    = other.find(item.first);
+        if (it != other.end() && it->second != item.second) printf("note: %s differs: '%s' vs '%s'\n", item.first.c_str(), item.second.c_str(), it->second.c_str());
+    }
+}
+
+int main(int argc, char **argv) {
+    double                   alpha     = 0.01;
+    double                   threshold = 2.0;
+    size_t                   skip      = 0;
+    std::vector<std::string> baselineFiles, candidateFiles;
+    std::vector<std::string> *pList = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--alpha") && i + 1 < argc)
+            alpha = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--threshold") && i + 1 < argc)
+            threshold = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--skip") && i + 1 < argc)
+            skip = (size_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--baseline"))
+            pList = &baselineFiles;
+        else if (!strcmp(argv[i], "--candidate"))
+            pList = &candidateFiles;
+        else if (pList && argv[i][0] != '-')
+            pList->push_back(argv[i]);
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (baselineFiles.empty() || candidateFiles.empty()) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::vector<BenchmarkLog> baseline, candidate;
+    if (!LoadRuns(baselineFiles, baseline) || !LoadRuns(candidateFiles, candidate)) return 2;
+    PrintMetadataDifferences(baseline, candidate);
+
+    printf("%-34s %12s %12s %9s %12s %12s %10s\n", "column", "base p50", "cand p50", "delta", "base p99", "cand p99", "p-value");
+    int regressions = 0;
+    for (auto const &column : baseline[0].GetColumns()) {
+        std::vector<double> a = Pool(baseline, column, skip);
+        std::vector<double> b = Pool(candidate, column, skip);
+        if (a.empty() || b.empty()) continue;
+
+        BenchmarkSummary  sa    = SummarizeBenchmarkSeries(a);
+        BenchmarkSummary  sb    = SummarizeBenchmarkSeries(b);
+        MannWhitneyResult test  = MannWhitneyUTest(b, a);
+        double            delta = sa.p50 != 0.0 ? 100.0 * (sb.p50 - sa.p50) / sa.p50 : 0.0;
+
+        bool isTiming   = column.size() > 3 && column.compare(column.size() - 3, 3, "_us") == 0;
+        bool regression = isTiming && delta > threshold && test.z > 0.0 && test.pValue < alpha;
+        bool improved   = isTiming && delta < -threshold && test.z < 0.0 && test.pValue < alpha;
+        printf("%-34s %12.2f %12.2f %+8.2f%% %12.2f %12.2f %10.2g %s\n", column.c_str(), sa.p50, sb.p50, delta, sa.p99, sb.p99, test.pValue,
+               regression ? "REGRESSION" : improved ? "improved" : "");
+        if (regression) regressions++;
+    }
+    printf("%d regression(s), alpha %g, threshold %g%%\n", regressions, alpha, threshold);
+    return regressions ? 1 : 0;
+}
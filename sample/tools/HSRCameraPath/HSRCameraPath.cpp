@@ -0,0 +1,299 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Checks the benchmark camera paths (CameraPath.h) without the sample:
+// - malformed files are rejected with the line at fault;
+// - both interpolations pass through every key with a unit direction, Catmull-Rom reproduces a camera moving at
+//   constant speed over unevenly spaced keys and has no kinks at the keys, looping paths repeat and play through the
+//   wrap around segment without a jump, other paths hold their ends;
+// - in fixed timestep mode the camera of frame N only depends on N, the path time the sample derives from the
+//   timestep and the loop counter matches the path.
+// With --path, a path file is checked the same way. If it is linear with one key per second and loops after the last
+// one, like the shipped BistroInterior.campath, it also has to match the interpolation of the hard-coded benchmark
+// camera it replaced.
+//
+// Usage: HSRCameraPath [--path sample/media/BistroInterior.campath] [--timestep 0.0166667] [--loops 2]
+//
+// The exit code is 1 if a check fails, 2 on usage errors.
+
+#include "CameraPath.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRCameraPath [--path sample/media/BistroInterior.campath] [--timestep 0.0166667] [--loops 2]\n"); }
+
+static uint32_t s_failures = 0;
+
+static void Check(bool condition, char const *pWhat, double time) {
+    if (condition) return;
+    if (s_failures < 10) fprintf(stderr, "t = %g: %s\n", time, pWhat);
+    s_failures++;
+}
+
+static double Distance(double const a[3], double const b[3]) {
+    return std::sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+}
+
+static CameraPath Parse(std::string const &text, bool &parsed, std::string &error) {
+    CameraPath         path;
+    std::istringstream in(text);
+    parsed = path.Parse(in, &error);
+    return path;
+}
+
+static void CheckErrors() {
+    struct Case {
+        char const *pText;
+        char const *pError; // Start of the message.
+    } const cases[] = {
+        {"key 0 0 0 0 1 0 0\nkey 0 1 0 0 1 0 0\n", "line 2: key times must be increasing"},
+        {"key 0 0 0 0 1 0 0\nkey 1 1 0 0 1 0\n", "line 2: expected key"},
+        {"key 0 0 0 0 1 0 0\nturn 1\n", "line 2: unknown directive"},
+        {"interpolation cubic\nkey 0 0 0 0 1 0 0\n", "line 1: unknown interpolation"},
+        {"loop 0\nkey 0 0 0 0 1 0 0\n", "line 1: expected loop"},
+        {"loop 1\nkey 0 0 0 0 1 0 0\nkey 1 1 0 0 1 0 0\n", "line 3: loop period must be past the last key"},
+        {"# only a comment\n", "line 1: no keys"},
+    };
+    for (auto const &item : cases) {
+        bool        parsed;
+        std::string error;
+        Parse(item.pText, parsed, error);
+        Check(!parsed && error.compare(0, strlen(item.pError), item.pError) == 0, (std::string("expected '") + item.pError + "', got '" + error + "'").c_str(), 0.0);
+    }
+    bool        parsed;
+    std::string error;
+    CameraPath  path = Parse("interpolation linear # comment\n\n  key 0 0 0 0 1 0 0 # first\nkey 2.5 1 0 0 0 1 0\n", parsed, error);
+    Check(parsed && path.GetKeyCount() == 2 && !path.IsLooping() && path.GetDuration() == 2.5, ("valid path rejected: " + error).c_str(), 0.0);
+}
+
+// Checks what holds for every path: keys are hit, directions are unit vectors, loops repeat and have no jump, paths
+// that do not loop hold their ends.
+static void CheckPath(CameraPath const &path, std::vector<CameraPathKey> const &keys) {
+    double position[3], direction[3], other[3], otherDirection[3];
+    for (auto const &key : keys) {
+        path.Evaluate(key.time, position, direction);
+        double length = std::sqrt(key.direction[0] * key.direction[0] + key.direction[1] * key.direction[1] + key.direction[2] * key.direction[2]);
+        double unit[3] = {key.direction[0] / length, key.direction[1] / length, key.direction[2] / length};
+        Check(Distance(position, key.position) < 1e-9, "misses the key position", key.time);
+        Check(Distance(direction, unit) < 1e-9, "misses the key direction", key.time);
+    }
+
+    // Looping paths through the segment that wraps around from the last key to the first
+    double const duration = path.GetDuration();
+    double const first    = keys.front().time;
+    double const last     = path.IsLooping() ? first + duration : duration;
+    double const extent   = 1.0 + Distance(keys.front().position, keys.back().position);
+    for (int i = 0; i <= 1000; i++) {
+        double const time = first + (last - first) * i / 1000.0;
+        path.Evaluate(time, position, direction);
+        Check(std::fabs(std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]) - 1.0) < 1e-9, "direction is not a unit vector",
+              time);
+        // No jumps, a step much shorter than the ones between samples moves the camera by little
+        path.Evaluate(time - (last - first) * 1e-6, other, otherDirection);
+        Check(Distance(position, other) < 1e-3 * extent, "jumps", time);
+        if (path.IsLooping()) {
+            path.Evaluate(time + 3.0 * duration, other, otherDirection);
+            Check(Distance(position, other) < 1e-6 && Distance(direction, otherDirection) < 1e-6, "does not repeat after the loop period", time);
+        }
+    }
+    if (!path.IsLooping()) {
+        path.Evaluate(first - 10.0, position, direction);
+        Check(Distance(position, keys.front().position) < 1e-9, "does not hold the first key", first - 10.0);
+        path.Evaluate(duration + 10.0, position, direction);
+        Check(Distance(position, keys.back().position) < 1e-9, "does not hold the last key", duration + 10.0);
+    }
+}
+
+static void CheckInterpolation() {
+    // A camera moving at constant speed, keys unevenly spaced
+    std::vector<CameraPathKey> keys;
+    double const               times[] = {0.0, 0.5, 2.0, 2.25, 4.0, 7.0};
+    for (double time : times) {
+        CameraPathKey key = {time, {1.0 + 2.0 * time, -0.5 * time, 3.0}, {0.0, 0.0, 1.0}};
+        keys.push_back(key);
+    }
+    for (int linear = 0; linear < 2; linear++) {
+        CameraPath path;
+        path.SetInterpolation(linear ? CameraPath::Interpolation::LINEAR : CameraPath::Interpolation::CATMULL_ROM);
+        for (auto const &key : keys) path.AddKey(key);
+        CheckPath(path, keys);
+        // The end segments of Catmull-Rom paths that do not loop ease in and out
+        for (int i = 0; i <= 700; i++) {
+            double const time = i * 0.01;
+            if (!linear && (time < times[1] || time > times[4])) continue;
+            double       position[3], direction[3];
+            path.Evaluate(time, position, direction);
+            double const expected[3] = {1.0 + 2.0 * time, -0.5 * time, 3.0};
+            Check(Distance(position, expected) < 1e-9, linear ? "linear path is off the line" : "Catmull-Rom path is off the line", time);
+        }
+    }
+
+    // A curved loop, the velocity has to be continuous through the keys
+    CameraPath curve;
+    curve.SetLoop(10.0);
+    keys.clear();
+    double const curveTimes[] = {1.0, 2.5, 4.0, 6.0, 7.0, 9.0};
+    for (double time : curveTimes) {
+        double const  angle = time * 0.6283185307179586;
+        CameraPathKey key   = {time, {std::cos(angle), 0.3 * time, std::sin(angle)}, {-std::sin(angle), 0.1, std::cos(angle)}};
+        keys.push_back(key);
+        curve.AddKey(key);
+    }
+    CheckPath(curve, keys);
+    double const h = 1e-5;
+    for (auto const &key : keys) {
+        double before[3], at[3], after[3], direction[3];
+        curve.Evaluate(key.time - h, before, direction);
+        curve.Evaluate(key.time, at, direction);
+        curve.Evaluate(key.time + h, after, direction);
+        double kink = 0.0, speed = 0.0;
+        for (int c = 0; c < 3; c++) {
+            kink += std::fabs((after[c] - at[c]) - (at[c] - before[c])) / h;
+            speed += std::fabs(after[c] - before[c]) / (2.0 * h);
+        }
+        Check(kink < 1e-3 * (1.0 + speed), "Catmull-Rom velocity jumps at a key", key.time);
+    }
+}
+
+// The time the sample gives the path in fixed timestep mode, see HSRSample::OnRender.
+static double GetFixedTimestepTime(uint32_t frame, double timestep, double duration, int &loop) {
+    double const time = float(frame * timestep);
+    loop              = int(time / duration);
+    return time - loop * duration;
+}
+
+static void CheckFixedTimestep(CameraPath const &path, double timestep, int loops) {
+    double const duration = path.GetDuration();
+    uint32_t     frames   = 0;
+    for (uint32_t frame = 0;; frame++) {
+        int          loop;
+        double const time = GetFixedTimestepTime(frame, timestep, duration, loop);
+        if (loop >= loops) break;
+        frames++;
+        double position[3], direction[3], expected[3], expectedDirection[3];
+        path.Evaluate(time, position, direction);
+        path.Evaluate(double(float(frame * timestep)), expected, expectedDirection);
+        Check(time >= -1e-6 && time < duration + 1e-6, "fixed timestep time is outside of the loop", time);
+        if (path.IsLooping()) Check(Distance(position, expected) < 1e-4, "fixed timestep frame is off the path", time);
+        // Twice the same frame, as a run on another machine would render it
+        double again[3];
+        path.Evaluate(GetFixedTimestepTime(frame, timestep, duration, loop), again, direction);
+        Check(!memcmp(again, position, sizeof(again)), "fixed timestep frame differs between runs", time);
+    }
+    uint32_t const expectedFrames = uint32_t(std::ceil(loops * duration / timestep));
+    Check(frames + 1 >= expectedFrames && frames <= expectedFrames + 1, "wrong number of frames", duration);
+    printf("fixed timestep %g s: %u frames for %d loops of %g s\n", timestep, frames, loops, duration);
+}
+
+// The benchmark camera before the path files: key i at time i, linear, wrapping around from the last key to the first.
+static void CheckLegacy(CameraPath const &path, std::vector<CameraPathKey> const &keys) {
+    for (int i = 0; i < 100 * int(keys.size()); i++) {
+        double const         time = i * 0.01;
+        int const            p0   = int(time) % int(keys.size());
+        int const            p1   = int(time + 1.0) % int(keys.size());
+        double const         t0   = time - int(time);
+        CameraPathKey const &k0   = keys[p0];
+        CameraPathKey const &k1   = keys[p1];
+        double               expected[3], expectedDirection[3], position[3], direction[3];
+        for (int c = 0; c < 3; c++) {
+            expected[c]          = k0.position[c] + (k1.position[c] - k0.position[c]) * t0;
+            expectedDirection[c] = k0.direction[c] + (k1.direction[c] - k0.direction[c]) * t0;
+        }
+        double const length = std::sqrt(expectedDirection[0] * expectedDirection[0] + expectedDirection[1] * expectedDirection[1] + expectedDirection[2] * expectedDirection[2]);
+        for (int c = 0; c < 3; c++) expectedDirection[c] /= length;
+        path.Evaluate(time, position, direction);
+        Check(Distance(position, expected) < 1e-6 && Distance(direction, expectedDirection) < 1e-6, "differs from the legacy benchmark camera", time);
+    }
+}
+
+// The keys of a path file, CameraPath does not give them back.
+static std::vector<CameraPathKey> LoadKeys(std::string const &filename) {
+    std::vector<CameraPathKey> keys;
+    FILE *                     pFile = fopen(filename.c_str(), "r");
+    if (!pFile) return keys;
+    char line[512];
+    while (fgets(line, sizeof(line), pFile)) {
+        CameraPathKey key;
+        if (sscanf(line, " key %lf %lf %lf %lf %lf %lf %lf", &key.time, &key.position[0], &key.position[1], &key.position[2], &key.direction[0], &key.direction[1],
+                   &key.direction[2]) == 7)
+            keys.push_back(key);
+    }
+    fclose(pFile);
+    return keys;
+}
+
+int main(int argc, char **argv) {
+    std::string filename;
+    double      timestep = 1.0 / 60.0;
+    int         loops    = 2;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--path") && hasValue)
+            filename = argv[++i];
+        else if (!strcmp(argv[i], "--timestep") && hasValue)
+            timestep = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--loops") && hasValue)
+            loops = atoi(argv[++i]);
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (timestep <= 0.0 || loops <= 0) {
+        PrintUsage();
+        return 2;
+    }
+
+    CheckErrors();
+    CheckInterpolation();
+    if (filename.empty()) {
+        std::string      error;
+        bool             parsed;
+        CameraPath const path = Parse("loop 10\nkey 1 0 0 0 1 0 0\nkey 4 1 0 1 0 0 1\nkey 6 2 1 0 -1 0 0\n", parsed, error);
+        Check(parsed, "fixed timestep path rejected", 0.0);
+        CheckFixedTimestep(path, timestep, loops);
+    } else {
+        CameraPath  path;
+        std::string error;
+        if (!path.Load(filename, &error)) {
+            fprintf(stderr, "%s: %s\n", filename.c_str(), error.c_str());
+            return 1;
+        }
+        std::vector<CameraPathKey> const keys = LoadKeys(filename);
+        printf("%s: %zu keys, %g s%s\n", filename.c_str(), keys.size(), path.GetDuration(), path.IsLooping() ? ", looping" : "");
+        CheckPath(path, keys);
+        CheckFixedTimestep(path, timestep, loops);
+        bool legacy = path.IsLooping() && path.GetDuration() == double(keys.size());
+        for (size_t i = 0; i < keys.size(); i++) legacy = legacy && keys[i].time == double(i);
+        if (legacy) {
+            // Only linear paths can match, Catmull-Rom ones are reported as differing
+            CheckLegacy(path, keys);
+            printf("one key per second, checked against the legacy benchmark camera\n");
+        }
+    }
+    printf("%u failed checks\n", s_failures);
+    return s_failures ? 1 : 0;
+}
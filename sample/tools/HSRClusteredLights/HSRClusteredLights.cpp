@@ -0,0 +1,195 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Benchmarks the clustered lights of the raster forward lighting (ClusteredLightsBuilder.h) on random scenes: the
+// scenes of HSRLightGrid, one sun, and point and spot lights of 3 to 15 m range spread over a square that grows with
+// the light count, seen from a corner at eye height. For each light count it times the cluster assignment with SSE2
+// and with the scalar path, checks that both assign the same lights, and times the lights found for random visible
+// points, with the clusters and by testing every light like the pixel shader used to. It checks that both find the
+// same lights and prints how many lights a pixel tests with the clusters.
+//
+// Usage: HSRClusteredLights [--lights 80,500,2000,5000] [--points 200000] [--tiles 16x9x24] [--iterations 20]
+//
+// The exit code is 1 if the clusters miss or add a light for any point or the two paths disagree, 2 on usage errors.
+
+#include "ClusteredLightsBuilder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRClusteredLights [--lights 80,500,2000,5000] [--points 200000] [--tiles 16x9x24] [--iterations 20]\n"); }
+
+template <typename FUNCTION> static double MillisecondsPerIteration(uint32_t iterations, FUNCTION const &function) {
+    auto const begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / iterations;
+}
+
+static bool ParseCounts(char const *pList, std::vector<uint32_t> &counts) {
+    counts.clear();
+    for (char const *p = pList; *p;) {
+        char *pEnd  = NULL;
+        long  count = strtol(p, &pEnd, 10);
+        if (pEnd == p || count <= 0) return false;
+        counts.push_back(uint32_t(count));
+        p = *pEnd == ',' ? pEnd + 1 : pEnd;
+        if (*pEnd && *pEnd != ',') return false;
+    }
+    return !counts.empty();
+}
+
+static void Normalize(float v[3]) {
+    float const length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    for (int axis = 0; axis < 3; axis++) v[axis] /= length;
+}
+
+int main(int argc, char **argv) {
+    std::vector<uint32_t>          lightCounts = {80, 500, 2000, 5000};
+    uint32_t                       points = 200000, iterations = 20;
+    ClusteredLightsBuilder::Config config;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--lights") && hasValue) {
+            if (!ParseCounts(argv[++i], lightCounts)) {
+                PrintUsage();
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--points") && hasValue)
+            points = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--tiles") && hasValue) {
+            if (sscanf(argv[++i], "%ux%ux%u", &config.tilesX, &config.tilesY, &config.slices) != 3) {
+                PrintUsage();
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--iterations") && hasValue)
+            iterations = uint32_t(atoi(argv[++i]));
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (!points || !iterations || !config.tilesX || !config.tilesY || !config.slices) {
+        PrintUsage();
+        return 2;
+    }
+
+    printf("%u points, %ux%ux%u clusters\n", points, config.tilesX, config.tilesY, config.slices);
+    printf("%7s %10s %8s %7s %9s %9s %11s %11s %11s %9s %9s\n", "lights", "clusters", "occupied", "global", "entries", "sse2 ms", "scalar ms", "all ns/pt",
+           "list ns/pt", "tested", "lit by");
+    auto const random = [](float scale) { return float(rand()) / float(RAND_MAX) * scale; };
+    for (uint32_t lightCount : lightCounts) {
+        // One light per 15 m square, at 1 to 8 m high.
+        float const area = 15.0f * std::sqrt(float(lightCount));
+        srand(lightCount);
+        std::vector<ClusteredLightsBuilder::Light> lights(lightCount);
+        for (uint32_t i = 0; i < lightCount; i++) {
+            ClusteredLightsBuilder::Light &light = lights[i];
+            float const                    x = random(area), y = 1.0f + random(7.0f), z = random(area);
+            light.position[0] = x;
+            light.position[1] = y;
+            light.position[2] = z;
+            light.range       = 3.0f + random(12.0f);
+            if (i == 0) {
+                light.type  = LIGHT_GRID_TYPE_DIRECTIONAL;
+                light.range = 30.0f;
+            } else {
+                light.type = rand() % 10 < 7 ? LIGHT_GRID_TYPE_SPOT : LIGHT_GRID_TYPE_POINT;
+            }
+            // Mostly downwards, spots shine along -direction.
+            float const dx = random(2.0f) - 1.0f, dy = 0.5f + random(1.5f), dz = random(2.0f) - 1.0f;
+            float const length = std::sqrt(dx * dx + dy * dy + dz * dz);
+            light.direction[0] = dx / length;
+            light.direction[1] = dy / length;
+            light.direction[2] = dz / length;
+            light.outerConeCos = std::cos(0.35f + random(0.7f));
+        }
+
+        // From a corner of the square across it, 60 degrees vertical field of view at 16:9.
+        ClusteredLightsBuilder::View view = {{-2.0f, 1.7f, -2.0f}, {1.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, -0.05f, 1.0f}, 0.0f, std::tan(0.5236f)};
+        view.tanHalfFovX                  = view.tanHalfFovY * 16.0f / 9.0f;
+        Normalize(view.right);
+        Normalize(view.forward);
+        view.up[0] = view.forward[1] * view.right[2] - view.forward[2] * view.right[1];
+        view.up[1] = view.forward[2] * view.right[0] - view.forward[0] * view.right[2];
+        view.up[2] = view.forward[0] * view.right[1] - view.forward[1] * view.right[0];
+        Normalize(view.up);
+
+        // Visible points from 0.1 m to past the far side of the square, as many per octave of depth, a little past the
+        // edges of the screen like the guard band of the rasterizer.
+        std::vector<float> pixels(points * 3);
+        float const        maxDepth = 2.0f * area;
+        for (uint32_t i = 0; i < points; i++) {
+            float const depth = 0.1f * std::pow(maxDepth / 0.1f, random(1.0f));
+            float const x     = (random(2.04f) - 1.02f) * view.tanHalfFovX * depth;
+            float const y     = (random(2.04f) - 1.02f) * view.tanHalfFovY * depth;
+            for (int axis = 0; axis < 3; axis++) pixels[i * 3 + axis] = view.eye[axis] + view.right[axis] * x + view.up[axis] * y + view.forward[axis] * depth;
+        }
+
+        ClusteredLightsBuilder clusters, scalarClusters;
+        ClusteredLightsBuilder::Config scalarConfig = config;
+        scalarConfig.simd                           = false;
+        double const simdMs   = MillisecondsPerIteration(iterations, [&]() { clusters.Build(lights.data(), lightCount, view, config); });
+        double const scalarMs = MillisecondsPerIteration(iterations, [&]() { scalarClusters.Build(lights.data(), lightCount, view, scalarConfig); });
+        if (clusters.GetWords() != scalarClusters.GetWords()) {
+            fprintf(stderr, "%u lights: the SSE2 and the scalar cluster assignments differ\n", lightCount);
+            return 1;
+        }
+
+        std::vector<uint32_t> found;
+        uint64_t              lit = 0, tested = 0;
+        double const          allMs = MillisecondsPerIteration(1, [&]() {
+            for (uint32_t i = 0; i < points; i++) {
+                QueryLightsBruteForce(lights.data(), lightCount, &pixels[i * 3], found);
+                lit += found.size();
+            }
+        });
+        double const listMs = MillisecondsPerIteration(1, [&]() {
+            for (uint32_t i = 0; i < points; i++) {
+                uint32_t candidates = 0;
+                clusters.Query(&pixels[i * 3], found, &candidates);
+                tested += candidates;
+            }
+        });
+
+        std::vector<uint32_t> reference;
+        for (uint32_t i = 0; i < points; i++) {
+            QueryLightsBruteForce(lights.data(), lightCount, &pixels[i * 3], reference);
+            clusters.Query(&pixels[i * 3], found);
+            std::sort(found.begin(), found.end());
+            if (found != reference) {
+                fprintf(stderr, "%u lights, point %u (%g, %g, %g): the clusters find %zu lights, testing every light finds %zu\n", lightCount, i, pixels[i * 3],
+                        pixels[i * 3 + 1], pixels[i * 3 + 2], found.size(), reference.size());
+                return 1;
+            }
+        }
+
+        ClusteredLightsBuilder::Stats const &stats = clusters.GetStats();
+        printf("%7u %10u %8u %7u %9llu %9.3f %11.3f %11.1f %11.1f %9.2f %9.2f\n", lightCount, stats.clusters, stats.occupiedClusters, stats.globalLights,
+               (unsigned long long)stats.listEntries, simdMs, scalarMs, allMs * 1.0e6 / points, listMs * 1.0e6 / points, double(tested) / points, double(lit) / points);
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Sizes the denoiser work HSR_CONVERGED_TILES would skip on a sequence of frames captured with HSR::CaptureDenoiser,
+// taken with the option off.
+//
+// Usage: HSRConvergedTiles [--variance 0.002] [--tolerance 0.25] [--max-error 0] capture.dnsr [capture.dnsr ...]
+//
+// For every capture and for the whole sequence it prints the tiles of the denoise list, the ones the classification
+// of Shaders/ConvergedTiles.h finds converged and the share the denoiser passes skip once the staggered refresh is
+// taken out. The error columns compare the history the converged tiles keep with the temporal output the denoiser
+// produced for them. With --max-error the exit code is 1 if that error goes above it in any capture, 2 on usage errors.
+
+#include "ConvergedTilesStats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRConvergedTiles [--variance 0.002] [--tolerance 0.25] [--max-error 0] capture.dnsr [capture.dnsr ...]\n"); }
+
+static void PrintStats(char const *name, ConvergedTileStats const &stats) {
+    double converged = stats.denoiseTiles ? 100.0 * stats.convergedTiles / stats.denoiseTiles : 0.0;
+    double skipped   = stats.denoiseTiles ? 100.0 * stats.skippedTiles / stats.denoiseTiles : 0.0;
+    printf("%-32s %10u %10u %9.2f%% %9.2f%% %12.5g %12.5g\n", name, stats.denoiseTiles, stats.convergedTiles, converged, skipped, stats.maxAbsError, stats.meanAbsError);
+}
+
+int main(int argc, char **argv) {
+    float                    maxVariance = FFX_REFLECTIONS_CONVERGED_MAX_VARIANCE;
+    float                    tolerance   = FFX_REFLECTIONS_CONVERGED_LUMINANCE_TOLERANCE;
+    double                   maxError    = 0.0;
+    std::vector<std::string> filenames;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--variance") && i + 1 < argc)
+            maxVariance = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc)
+            tolerance = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--max-error") && i + 1 < argc)
+            maxError = atof(argv[++i]);
+        else if (argv[i][0] != '-')
+            filenames.push_back(argv[i]);
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (filenames.empty()) {
+        PrintUsage();
+        return 2;
+    }
+
+    printf("%-32s %10s %10s %10s %10s %12s %12s\n", "capture", "tiles", "converged", "", "skipped", "max error", "mean error");
+    ConvergedTileStats total;
+    double             errorSum = 0.0;
+    int                failures = 0;
+    for (std::string const &filename : filenames) {
+        DenoiserCapture capture;
+        std::string     error;
+        if (!LoadDenoiserCapture(filename, capture, &error)) {
+            fprintf(stderr, "error: %s\n", error.c_str());
+            return 2;
+        }
+        ConvergedTileStats stats = ClassifyConvergedTiles(capture, maxVariance, tolerance);
+        PrintStats(filename.c_str(), stats);
+        total.denoiseTiles += stats.denoiseTiles;
+        total.convergedTiles += stats.convergedTiles;
+        total.skippedTiles += stats.skippedTiles;
+        total.keptPixels += stats.keptPixels;
+        total.maxAbsError = std::max(total.maxAbsError, stats.maxAbsError);
+        errorSum += stats.meanAbsError * stats.keptPixels;
+        if (maxError > 0.0 && stats.maxAbsError > maxError) failures++;
+    }
+    if (total.keptPixels) total.meanAbsError = errorSum / total.keptPixels;
+    PrintStats("total", total);
+    printf("variance %g, tolerance %g, refresh period %u\n", maxVariance, tolerance, FFX_REFLECTIONS_CONVERGED_REFRESH_PERIOD);
+    if (failures) printf("%d capture(s) over max error %g\n", failures, maxError);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Benchmarks the decal binning of ApplyDecals.hlsl (DecalBinning.h) on random scenes: boxes of 0.5 to 4 m in random
+// orientations spread over a square that grows with the decal count, seen from a corner at eye height, plus one box
+// on the floor under the eye that crosses the near plane. For each decal count it times the culling and binning, then looks up
+// random visible points, half of them inside a decal, in the tile of their pixel. It checks that the tile lists, with
+// the exact box test of the shader, find the same decals in the same order as testing every decal, and prints how
+// much of the screen runs decal shading and how many decals a pixel tests. Every visible decal must fit in the buffer.
+//
+// Usage: HSRDecalBinning [--decals 100,1000,10000,50000] [--points 20000] [--size 1920x1080] [--iterations 10]
+//
+// The exit code is 1 if a visible decal is dropped or a tile misses a decal of any point, 2 on usage errors.
+
+#include "DecalBinning.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRDecalBinning [--decals 100,1000,10000,50000] [--points 20000] [--size 1920x1080] [--iterations 10]\n"); }
+
+template <typename FUNCTION> static double MillisecondsPerIteration(uint32_t iterations, FUNCTION const &function) {
+    auto const begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / iterations;
+}
+
+static bool ParseCounts(char const *pList, std::vector<uint32_t> &counts) {
+    counts.clear();
+    for (char const *p = pList; *p;) {
+        char *pEnd  = NULL;
+        long  count = strtol(p, &pEnd, 10);
+        if (pEnd == p || count <= 0) return false;
+        counts.push_back(uint32_t(count));
+        p = *pEnd == ',' ? pEnd + 1 : pEnd;
+        if (*pEnd && *pEnd != ',') return false;
+    }
+    return !counts.empty();
+}
+
+static void Normalize(float v[3]) {
+    float const length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    for (int axis = 0; axis < 3; axis++) v[axis] /= length;
+}
+
+static void Cross(float const a[3], float const b[3], float out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+int main(int argc, char **argv) {
+    std::vector<uint32_t> decalCounts = {100, 1000, 10000, 50000};
+    uint32_t              points = 20000, iterations = 10, width = 1920, height = 1080;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--decals") && hasValue) {
+            if (!ParseCounts(argv[++i], decalCounts)) {
+                PrintUsage();
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--points") && hasValue)
+            points = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--size") && hasValue) {
+            if (sscanf(argv[++i], "%ux%u", &width, &height) != 2) {
+                PrintUsage();
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--iterations") && hasValue)
+            iterations = uint32_t(atoi(argv[++i]));
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (!points || !iterations || !width || !height || width > 16384 || height > 16384) {
+        PrintUsage();
+        return 2;
+    }
+
+    // From a corner of the square across it, 60 degrees vertical field of view, depth 0 to 1 from 0.1 m to 1 km.
+    float const eye[3] = {-2.0f, 1.7f, -2.0f}, near = 0.1f, far = 1000.0f;
+    float       forward[3] = {1.0f, -0.05f, 1.0f}, right[3], up[3], worldUp[3] = {0.0f, 1.0f, 0.0f};
+    Normalize(forward);
+    Cross(worldUp, forward, right);
+    Normalize(right);
+    Cross(forward, right, up);
+    float const tanY = std::tan(0.5236f), tanX = tanY * float(width) / float(height);
+    float const rows[4][4] = {{right[0] / tanX, right[1] / tanX, right[2] / tanX, 0.0f},
+                              {up[0] / tanY, up[1] / tanY, up[2] / tanY, 0.0f},
+                              {forward[0] * far / (far - near), forward[1] * far / (far - near), forward[2] * far / (far - near), -far * near / (far - near)},
+                              {forward[0], forward[1], forward[2], 0.0f}};
+    float       viewProj[16];
+    for (int row = 0; row < 4; row++) {
+        float const offset = -(rows[row][0] * eye[0] + rows[row][1] * eye[1] + rows[row][2] * eye[2]);
+        for (int col = 0; col < 3; col++) viewProj[row * 4 + col] = rows[row][col];
+        viewProj[row * 4 + 3] = rows[row][3] + offset;
+    }
+
+    printf("%ux%u pixels\n", width, height);
+    printf("%7s %8s %8s %6s %9s %9s %10s %9s %9s %9s\n", "decals", "visible", "dropped", "tile", "occupied", "shaded %", "entries", "bin ms", "tested", "covered");
+    auto const random = [](float scale) { return float(rand()) / float(RAND_MAX) * scale; };
+    for (uint32_t decalCount : decalCounts) {
+        // One decal per 4 m square, up to 3 m high
+        float const area = 4.0f * std::sqrt(float(decalCount));
+        srand(decalCount);
+        std::vector<DecalBinning::Decal> decals(decalCount);
+        for (uint32_t i = 0; i < decalCount; i++) {
+            DecalBinning::Decal &decal = decals[i];
+            float                a[3]  = {random(2.0f) - 1.0f, random(2.0f) - 1.0f, random(2.0f) - 1.0f}, b[3] = {random(2.0f) - 1.0f, random(2.0f) - 1.0f, 0.5f};
+            Normalize(a);
+            Cross(a, b, decal.axes[1]);
+            Normalize(decal.axes[1]);
+            Cross(a, decal.axes[1], decal.axes[2]);
+            memcpy(decal.axes[0], a, sizeof(a));
+            for (int axis = 0; axis < 3; axis++) decal.halfSize[axis] = 0.25f + random(1.75f);
+            decal.center[0] = random(area);
+            decal.center[1] = random(3.0f);
+            decal.center[2] = random(area);
+            decal.intensity = 10.0f;
+            decal.opacity   = 1.0f;
+        }
+        // On the floor under the eye, across the near plane
+        for (int axis = 0; axis < 3; axis++) {
+            decals[0].center[axis] = eye[axis];
+            for (int j = 0; j < 3; j++) decals[0].axes[j][axis] = j == axis ? 1.0f : 0.0f;
+            decals[0].halfSize[axis] = 3.0f;
+        }
+        decals[0].center[1]   = 0.0f;
+        decals[0].halfSize[1] = 0.5f;
+        decals[0].halfSize[2] = 4.0f;
+
+        DecalBinning bins;
+        double const binMs = MillisecondsPerIteration(iterations, [&]() { bins.Build(decals.data(), decalCount, viewProj, width, height); });
+
+        std::vector<uint32_t> records(size_t(decalCount) * DECAL_BINS_DECAL_WORDS);
+        for (uint32_t i = 0; i < decalCount; i++) PackDecal(decals[i], &records[size_t(i) * DECAL_BINS_DECAL_WORDS]);
+        if (bins.GetStats().droppedDecals) {
+            fprintf(stderr, "%u decals: %u of the %u visible do not fit in the buffer\n", decalCount, bins.GetStats().droppedDecals, bins.GetStats().visibleDecals);
+            return 1;
+        }
+
+        std::vector<uint32_t> found, covered, reference, hit;
+        uint64_t              tested = 0, coveredCount = 0;
+        uint32_t              tries = 0;
+        for (uint32_t i = 0; i < points; tries++) {
+            // Half inside a decal, half anywhere in view up to the far side of the square
+            float p[3];
+            if (tries % 2) {
+                DecalBinning::Decal const &decal = decals[uint32_t(rand()) % decalCount];
+                float const                uvw[3] = {random(2.0f) - 1.0f, random(2.0f) - 1.0f, random(2.0f) - 1.0f};
+                for (int axis = 0; axis < 3; axis++) {
+                    p[axis] = decal.center[axis];
+                    for (int j = 0; j < 3; j++) p[axis] += uvw[j] * decal.halfSize[j] * decal.axes[j][axis];
+                }
+            } else {
+                float const depth = near * std::pow(2.0f * area / near, random(1.0f));
+                float const x = (random(2.0f) - 1.0f) * tanX * depth, y = (random(2.0f) - 1.0f) * tanY * depth;
+                for (int axis = 0; axis < 3; axis++) p[axis] = eye[axis] + right[axis] * x + up[axis] * y + forward[axis] * depth;
+            }
+            float clip[4];
+            for (int row = 0; row < 4; row++) clip[row] = viewProj[row * 4] * p[0] + viewProj[row * 4 + 1] * p[1] + viewProj[row * 4 + 2] * p[2] + viewProj[row * 4 + 3];
+            if (clip[3] < near || std::fabs(clip[0]) >= clip[3] || std::fabs(clip[1]) >= clip[3]) continue;
+            uint32_t const x = std::min(uint32_t((clip[0] / clip[3] * 0.5f + 0.5f) * float(width)), width - 1);
+            uint32_t const y = std::min(uint32_t((0.5f - clip[1] / clip[3] * 0.5f) * float(height)), height - 1);
+            i++;
+
+            QueryDecalsBruteForce(records.data(), decalCount, p, reference);
+            bins.Query(x, y, found);
+            covered.clear();
+            for (uint32_t decal : found) {
+                QueryDecalsBruteForce(&records[size_t(decal) * DECAL_BINS_DECAL_WORDS], 1, p, hit);
+                if (!hit.empty()) covered.push_back(decal);
+            }
+            if (covered != reference) {
+                fprintf(stderr, "%u decals, point (%g, %g, %g) at pixel (%u, %u): its tile finds %zu decals, testing every decal finds %zu\n", decalCount, p[0], p[1], p[2], x,
+                        y, covered.size(), reference.size());
+                return 1;
+            }
+            tested += found.size();
+            coveredCount += reference.size();
+        }
+
+        DecalBinning::Stats const &stats  = bins.GetStats();
+        double const               shaded = std::min(1.0, double(stats.occupiedTiles) * stats.tileSize * stats.tileSize / (double(width) * height));
+        printf("%7u %8u %8u %6u %9u %9.1f %10llu %9.3f %9.2f %9.2f\n", decalCount, stats.visibleDecals, stats.droppedDecals, stats.tileSize, stats.occupiedTiles, 100.0 * shaded,
+               (unsigned long long)stats.listEntries, binMs, double(tested) / points, double(coveredCount) / points);
+    }
+    return 0;
+}
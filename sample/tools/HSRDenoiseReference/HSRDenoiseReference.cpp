@@ -0,0 +1,149 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Runs the CPU reference of the reflection denoiser passes on a frame captured with HSR::CaptureDenoiser and
+// compares every pass with its GPU output.
+//
+// Usage: HSRDenoiseReference [--threads 0] [--abs 0.02] [--rel 0.05] [--outliers 1] [--repeat 1] [--packed-radiance] capture.dnsr
+//
+// Each pass reads the GPU results of the passes before it, so a mismatch points at a single pass. A value is off when
+// it differs by more than abs + rel * |gpu|, and a pass fails when more than 'outliers' percent of the compared pixels
+// have a value that is off. --repeat runs each pass several times and reports the fastest run. The exit code is 1 if
+// any pass failed, 2 on usage errors.
+//
+// --packed-radiance also reports the error of the R11G11B10 radiance quantizer (HSR_PACKED_RADIANCE) on the captured
+// intersection radiance and the fp32 CPU outputs of the passes, rounded to the nearest value and dithered, plus the
+// drift of a history that converges on the temporal output. It fails when a value is off by more than the bound of
+// the quantizer or does not survive the bit packing.
+
+#include "DenoiserReference.h"
+#include "PackedRadianceStats.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRDenoiseReference [--threads 0] [--abs 0.02] [--rel 0.05] [--outliers 1] [--repeat 1] [--packed-radiance] capture.dnsr\n"); }
+
+// Returns false if the quantizer broke its bound or the bit packing.
+static bool PrintPackedRadianceError(char const *name, char const *quantizer, PackedRadianceError const &error) {
+    bool failed = error.boundFails || error.roundTripFails;
+    printf("%-10s %-8s %10llu %12.5g %12.5g %12.4g %12.5g %s\n", name, quantizer, (unsigned long long)error.values, error.maxRelError, error.meanRelError, error.meanRelBias,
+           error.maxAbsError, failed ? "FAILED" : "");
+    return !failed;
+}
+
+int main(int argc, char **argv) {
+    uint32_t    threads  = 0;
+    float       absTol   = 0.02f;
+    float       relTol   = 0.05f;
+    double      outliers = 1.0;
+    int         repeat   = 1;
+    bool        packed   = false;
+    std::string filename;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--abs") && i + 1 < argc)
+            absTol = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--rel") && i + 1 < argc)
+            relTol = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--outliers") && i + 1 < argc)
+            outliers = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--repeat") && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--packed-radiance"))
+            packed = true;
+        else if (argv[i][0] != '-' && filename.empty())
+            filename = argv[i];
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (filename.empty() || repeat < 1) {
+        PrintUsage();
+        return 2;
+    }
+
+    DenoiserCapture capture;
+    std::string     error;
+    if (!LoadDenoiserCapture(filename, capture, &error)) {
+        fprintf(stderr, "error: %s\n", error.c_str());
+        return 2;
+    }
+    printf("%s: %ux%u, roughness threshold %g, max history samples %u\n", filename.c_str(), capture.planes.width, capture.planes.height,
+           capture.constants.roughnessThreshold, capture.constants.maxHistorySamples);
+
+    DenoiserImage result = capture.planes;
+    printf("%-10s %10s %10s %10s %12s %12s  %s\n", "pass", "cpu ms", "pixels", "off", "max error", "rmse", "worst (x, y, plane)");
+    int failures = 0;
+    for (DenoiserStage stage : {DenoiserStage::Reproject, DenoiserStage::Prefilter, DenoiserStage::ResolveTemporal}) {
+        double best_ms = 0.0;
+        for (int run = 0; run < repeat; run++) {
+            auto begin = std::chrono::steady_clock::now();
+            RunDenoiserStage(stage, capture, result, threads);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            if (run == 0 || ms < best_ms) best_ms = ms;
+        }
+
+        DenoiserComparison comparison = CompareDenoiserStage(stage, capture, result, absTol, relTol);
+        double             off        = comparison.pixels ? 100.0 * comparison.pixelsOverTolerance / comparison.pixels : 0.0;
+        bool               failed     = off > outliers;
+        printf("%-10s %10.2f %10u %9.3f%% %12.5g %12.5g  (%u, %u, %u) %s\n", GetDenoiserStageName(stage), best_ms, comparison.pixels, off, comparison.maxAbsError,
+               comparison.rmse, comparison.worstX, comparison.worstY, comparison.worstPlane, failed ? "FAILED" : "");
+        if (failed) failures++;
+    }
+    printf("%d pass(es) failed, abs %g, rel %g, outliers %g%%\n", failures, absTol, relTol, outliers);
+
+    if (packed) {
+        struct {
+            char const *         name;
+            DenoiserImage const &image;
+            uint32_t             plane;
+            uint32_t             stream;
+        } const planes[] = {
+            {"intersect", capture.planes, DENOISER_CAPTURE_RADIANCE, FFX_REFLECTIONS_RADIANCE_DITHER_INTERSECT},
+            {"reproject", result, DENOISER_CAPTURE_REPROJECTED_RADIANCE, FFX_REFLECTIONS_RADIANCE_DITHER_REPROJECT},
+            {"prefilter", result, DENOISER_CAPTURE_PREFILTERED_RADIANCE, FFX_REFLECTIONS_RADIANCE_DITHER_PREFILTER},
+            {"temporal", result, DENOISER_CAPTURE_TEMPORAL_RADIANCE, FFX_REFLECTIONS_RADIANCE_DITHER_TEMPORAL},
+        };
+        printf("\n%-10s %-8s %10s %12s %12s %12s %12s\n", "radiance", "rounding", "values", "max rel", "mean rel", "bias", "max abs");
+        bool ok = true;
+        for (auto const &plane : planes) {
+            ok &= PrintPackedRadianceError(plane.name, "nearest", MeasurePackedRadiance(plane.image, plane.plane, false, 0, plane.stream));
+            ok &= PrintPackedRadianceError(plane.name, "dither", MeasurePackedRadiance(plane.image, plane.plane, true, 0, plane.stream));
+        }
+
+        // The history moves by 1 / maxHistorySamples per frame once it is full, run it long enough to settle.
+        uint32_t samples = capture.constants.maxHistorySamples ? capture.constants.maxHistorySamples : 32;
+        float    blend   = 1.0f / float(samples);
+        ok &= PrintPackedRadianceError("history", "nearest",
+                                       SimulatePackedRadianceHistory(result, DENOISER_CAPTURE_RADIANCE_HISTORY, DENOISER_CAPTURE_TEMPORAL_RADIANCE, blend, 4 * samples, false, 2));
+        ok &= PrintPackedRadianceError("history", "dither",
+                                       SimulatePackedRadianceHistory(result, DENOISER_CAPTURE_RADIANCE_HISTORY, DENOISER_CAPTURE_TEMPORAL_RADIANCE, blend, 4 * samples, true, 2));
+        if (!ok) failures++;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,135 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Simulates the HSR descriptor set cache (DescriptorSetCache.h) over a run of frames: the renderer rotates through
+// its global descriptor tables, HSR::Draw flips its ping-pong index and writes its set only when the cache misses, and
+// resizes recreate the resources. Checks that every frame draws with the set of its ping-pong index and the current
+// resources, and prints how many descriptors were written.
+//
+// Usage: HSRDescriptorCache [--frames 600] [--tables 6] [--descriptors 44] [--skip-every 0] [--resize-at F[,F...]]
+//                           [--forget-invalidate-at F]
+//
+// --skip-every N leaves out HSR::Draw every N frames, which shifts the ping-pong index against the table rotation.
+// --forget-invalidate-at F replaces the resources at frame F without invalidating the cache, the run then passes only
+// if drawing with a stale set is detected. The exit code is 1 if a frame draws with the wrong set, 2 on usage errors.
+
+#include "DescriptorSetCache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+static void PrintUsage() {
+    fprintf(stderr, "Usage: HSRDescriptorCache [--frames 600] [--tables 6] [--descriptors 44] [--skip-every 0] [--resize-at F[,F...]] [--forget-invalidate-at F]\n");
+}
+
+int main(int argc, char **argv) {
+    uint32_t           frames            = 600;
+    uint32_t           tables            = 6;
+    uint32_t           descriptors       = 44;
+    uint32_t           skipEvery         = 0;
+    uint32_t           forgetInvalidate  = ~0u;
+    std::set<uint32_t> resizes;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && hasValue)
+            frames = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--tables") && hasValue)
+            tables = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--descriptors") && hasValue)
+            descriptors = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--skip-every") && hasValue)
+            skipEvery = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--forget-invalidate-at") && hasValue)
+            forgetInvalidate = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--resize-at") && hasValue) {
+            for (char *p = strtok(argv[++i], ","); p; p = strtok(nullptr, ",")) resizes.insert(uint32_t(atoi(p)));
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (!tables || !frames) {
+        PrintUsage();
+        return 2;
+    }
+
+    // What each table holds, as the GPU would see it.
+    struct TableContents {
+        bool     written;
+        uint32_t set;
+        uint32_t resource; // Generation of the resources the views were created for.
+    };
+    std::vector<TableContents> contents(tables, TableContents{false, 0, 0});
+
+    DescriptorSetCache cache;
+    uint32_t           bufferIndex = 0;
+    uint32_t           generation  = 1; // Bumped whenever the resources are recreated.
+    uint64_t           written     = 0;
+    int                staleFrame  = -1;
+    uint32_t           staleDraws  = 0;
+    int                errors      = 0;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        if (resizes.count(frame)) {
+            generation++;
+            cache.Invalidate();
+        }
+        if (frame == forgetInvalidate) generation++;
+        if (skipEvery && frame % skipEvery == skipEvery - 1) continue;
+
+        uint32_t const table = frame % tables;
+        // Two resources per ping-pong index, whose handles change with each recreation.
+        std::vector<void const *> resources = {reinterpret_cast<void const *>(uintptr_t(generation * 4 + bufferIndex)),
+                                               reinterpret_cast<void const *>(uintptr_t(generation * 4 + 2 + (bufferIndex ^ 1)))};
+        if (cache.Acquire(table, bufferIndex, &resources)) {
+            contents[table] = TableContents{true, bufferIndex, generation};
+            written += descriptors;
+        } else if (cache.FindStale(table, resources) >= 0 && staleFrame < 0) {
+            staleFrame = int(frame);
+        }
+
+        TableContents const &held = contents[table];
+        if (!held.written || held.set != bufferIndex || held.resource != generation) {
+            if (frame >= forgetInvalidate)
+                staleDraws++; // Expected once the invalidation is skipped, as long as the check catches it.
+            else if (errors++ < 10)
+                printf("frame %u: table %u holds set %u of generation %u, drawing set %u of generation %u\n", frame, table, held.set, held.resource, bufferIndex, generation);
+        }
+        bufferIndex ^= 1;
+    }
+
+    printf("%u frames, %u tables: %llu hits, %llu misses, %llu descriptors written (%.2f per frame)\n", frames, tables, (unsigned long long)cache.GetHits(),
+           (unsigned long long)cache.GetMisses(), (unsigned long long)written, double(written) / frames);
+    if (forgetInvalidate != ~0u) {
+        if (staleDraws && staleFrame < 0) {
+            printf("the resources replaced at frame %u without invalidating were not detected\n", forgetInvalidate);
+            errors++;
+        } else if (staleDraws) {
+            printf("stale set detected at frame %d\n", staleFrame);
+        } else {
+            printf("the resources replaced at frame %u were never drawn with a stale set\n", forgetInvalidate);
+        }
+    }
+    return errors ? 1 : 0;
+}
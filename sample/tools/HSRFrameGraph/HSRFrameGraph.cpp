@@ -0,0 +1,200 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Prints the transient resource plan of the HSR frame graph (HsrFrameGraph.h) for a reflection resolution and set of
+// options, with sizes estimated the way D3D12 allocates them, and checks it.
+//
+// Usage: HSRFrameGraph [--size 3840x2160] [--compact-ray-gbuffer] [--material-binning] [--packed-radiance]
+//                      [--converged-tiles] [--tier1] [--barriers] [--all]
+//
+// --tier1 keeps the texture in its own heap, as D3D12 resource heap tier 1 requires. --barriers lists the barriers the
+// graph derives for each pass. --all checks every combination of the options at the given size and both tiers and
+// only prints a line per combination. The exit code is 1 if a plan fails to compile or validate, or a lifetime is
+// not the expected one, 2 on usage errors.
+
+#include "HsrFrameGraph.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static void PrintUsage() {
+    fprintf(stderr, "Usage: HSRFrameGraph [--size 3840x2160] [--compact-ray-gbuffer] [--material-binning] [--packed-radiance] [--converged-tiles] [--tier1] "
+                    "[--barriers] [--all]\n");
+}
+
+struct Options {
+    uint32_t width             = 3840;
+    uint32_t height            = 2160;
+    bool     compactRayGbuffer = false;
+    bool     materialBinning   = false;
+    bool     packedRadiance    = false;
+    bool     convergedTiles    = false;
+    bool     tier1             = false;
+};
+
+static double MB(uint64_t bytes) { return double(bytes) / (1024.0 * 1024.0); }
+
+// The lifetimes the passes of Draw imply, so a change of the declarations that moves one shows up.
+static bool CheckLifetimes(HsrFrameGraph const &frameGraph, Options const &options, std::string *pError) {
+    struct Expected {
+        HsrTransient transient;
+        HsrPass      first;
+        HsrPass      last;
+    } const expected[] = {
+        {HSR_TRANSIENT_RAY_LIST, HSR_PASS_CLASSIFY_TILES, HSR_PASS_INTERSECT},
+        {HSR_TRANSIENT_HW_RAY_LIST, HSR_PASS_CLASSIFY_TILES, options.materialBinning ? HSR_PASS_MATERIAL_BINNING : HSR_PASS_DEFERRED_SHADE},
+        {HSR_TRANSIENT_BINNED_HW_RAY_LIST, HSR_PASS_MATERIAL_BINNING, HSR_PASS_DEFERRED_SHADE},
+        {HSR_TRANSIENT_RAY_GBUFFER, HSR_PASS_TRACE, HSR_PASS_DEFERRED_SHADE},
+        {HSR_TRANSIENT_DENOISE_TILE_LIST, HSR_PASS_CLASSIFY_TILES, options.convergedTiles ? HSR_PASS_CLASSIFY_CONVERGED : HSR_PASS_TEMPORAL},
+        {HSR_TRANSIENT_ACTIVE_DENOISE_TILE_LIST, HSR_PASS_CLASSIFY_CONVERGED, HSR_PASS_TEMPORAL},
+        {HSR_TRANSIENT_CONVERGED_TILE_LIST, HSR_PASS_CLASSIFY_CONVERGED, HSR_PASS_KEEP_CONVERGED},
+        {HSR_TRANSIENT_RADIANCE_REPROJECTED, HSR_PASS_REPROJECT, HSR_PASS_TEMPORAL},
+    };
+    FrameGraph const &graph = frameGraph.graph;
+    for (Expected const &e : expected) {
+        uint32_t resource = frameGraph.transients[e.transient];
+        if (resource == FRAME_GRAPH_INVALID) continue;
+        if (graph.GetFirstPass(resource) != frameGraph.passes[e.first] || graph.GetLastPass(resource) != frameGraph.passes[e.last]) {
+            *pError = std::string("unexpected lifetime of '") + GetHsrTransientName(e.transient) + "'";
+            return false;
+        }
+    }
+    for (uint32_t p = 0; p < graph.GetPassCount(); p++) {
+        if (graph.IsPassCulled(p)) {
+            *pError = "pass '" + graph.GetPassName(p) + "' was culled";
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool Build(HsrFrameGraph &frameGraph, Options const &options, std::string *pError) {
+    HsrFrameGraphConfig config;
+    config.materialBinning = options.materialBinning;
+    config.convergedTiles  = options.convergedTiles;
+    EstimateHsrTransients(config, options.width, options.height, options.compactRayGbuffer, options.packedRadiance, options.tier1);
+    return BuildHsrFrameGraph(frameGraph, config, pError) && CheckLifetimes(frameGraph, options, pError);
+}
+
+static void PrintPlan(HsrFrameGraph const &frameGraph, bool barriers) {
+    FrameGraph const &graph = frameGraph.graph;
+    printf("%-26s %6s %10s %10s  %-20s %-20s\n", "transient", "heap", "offset MB", "size MB", "first pass", "last pass");
+    for (uint32_t t = 0; t < HSR_TRANSIENT_COUNT; t++) {
+        uint32_t resource = frameGraph.transients[t];
+        if (resource == FRAME_GRAPH_INVALID) continue;
+        FrameGraphResourceDesc const &desc = graph.GetResource(resource);
+        printf("%-26s %6u %10.2f %10.2f  %-20s %-20s\n", desc.name.c_str(), desc.heapGroup, MB(graph.GetHeapOffset(resource)), MB(desc.size),
+               graph.GetPassName(graph.GetFirstPass(resource)).c_str(), graph.GetPassName(graph.GetLastPass(resource)).c_str());
+    }
+    for (uint32_t group = 0; group < graph.GetHeapGroupCount(); group++)
+        printf("heap %u: %.2f MB for %.2f MB of resources\n", group, MB(graph.GetHeapSize(group)), MB(graph.GetUnaliasedSize(group)));
+    if (!barriers) return;
+
+    for (uint32_t p = 0; p < graph.GetPassCount(); p++) {
+        printf("%s\n", graph.GetPassName(p).c_str());
+        for (FrameGraphBarrier const &barrier : graph.GetBarriers(p)) {
+            char const *name = graph.GetResource(barrier.resource).name.c_str();
+            if (barrier.type == FrameGraphBarrierType::Aliasing)
+                printf("    aliasing    %s after %s\n", name, barrier.before == FRAME_GRAPH_INVALID ? "any" : graph.GetResource(barrier.before).name.c_str());
+            else if (barrier.type == FrameGraphBarrierType::Transition)
+                printf("    transition  %s: %s -> %s\n", name, GetFrameGraphAccessName(barrier.from), GetFrameGraphAccessName(barrier.to));
+            else
+                printf("    uav         %s\n", name);
+        }
+    }
+}
+
+static void Totals(HsrFrameGraph const &frameGraph, uint64_t &heaps, uint64_t &unaliased) {
+    heaps     = 0;
+    unaliased = 0;
+    for (uint32_t group = 0; group < frameGraph.graph.GetHeapGroupCount(); group++) {
+        heaps += frameGraph.graph.GetHeapSize(group);
+        unaliased += frameGraph.graph.GetUnaliasedSize(group);
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    bool    barriers = false;
+    bool    all      = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--size") && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2 || !options.width || !options.height) {
+                PrintUsage();
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--compact-ray-gbuffer"))
+            options.compactRayGbuffer = true;
+        else if (!strcmp(argv[i], "--material-binning"))
+            options.materialBinning = true;
+        else if (!strcmp(argv[i], "--packed-radiance"))
+            options.packedRadiance = true;
+        else if (!strcmp(argv[i], "--converged-tiles"))
+            options.convergedTiles = true;
+        else if (!strcmp(argv[i], "--tier1"))
+            options.tier1 = true;
+        else if (!strcmp(argv[i], "--barriers"))
+            barriers = true;
+        else if (!strcmp(argv[i], "--all"))
+            all = true;
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    std::string error;
+    if (!all) {
+        HsrFrameGraph frameGraph;
+        if (!Build(frameGraph, options, &error)) {
+            fprintf(stderr, "error: %s\n", error.c_str());
+            return 1;
+        }
+        printf("%ux%u reflections\n", options.width, options.height);
+        PrintPlan(frameGraph, barriers);
+        uint64_t heaps, unaliased;
+        Totals(frameGraph, heaps, unaliased);
+        printf("saves %.2f MB\n", MB(unaliased - heaps));
+        return 0;
+    }
+
+    int failures = 0;
+    printf("%-8s %-8s %-8s %-9s %-6s %12s %12s\n", "compact", "binning", "packed", "converged", "tier", "heaps MB", "saved MB");
+    for (uint32_t combination = 0; combination < 32; combination++) {
+        Options o           = options;
+        o.compactRayGbuffer = (combination & 1) != 0;
+        o.materialBinning   = (combination & 2) != 0;
+        o.packedRadiance    = (combination & 4) != 0;
+        o.convergedTiles    = (combination & 8) != 0;
+        o.tier1             = (combination & 16) != 0;
+        HsrFrameGraph frameGraph;
+        bool          ok = Build(frameGraph, o, &error);
+        uint64_t      heaps = 0, unaliased = 0;
+        if (ok) Totals(frameGraph, heaps, unaliased);
+        printf("%-8d %-8d %-8d %-9d %-6d %12.2f %12.2f %s\n", o.compactRayGbuffer, o.materialBinning, o.packedRadiance, o.convergedTiles, o.tier1 ? 1 : 2, MB(heaps),
+               MB(unaliased - heaps), ok ? "" : error.c_str());
+        if (!ok) failures++;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+// Measures the footprint policies of the reflection GBuffer reconstruction (ReconstructGbuffer.hlsl) against the
+// scene rasterized at the reflection resolution, on a frame captured with the GBuffer capture of the sample or on a
+// synthetic scene ray cast at both resolutions. Every reconstruction is checked to take each pixel from one sample
+// of its footprint, with exact depth and unfiltered normals and roughness.
+//
+// Usage: HSRGbufferReconstruct [--tolerance 0.002] (capture.gbuf | --synthetic 1920x1080 [--multiplier 0.5])
+//
+// A capture taken with the reconstruction on holds the GPU result instead of the raster pass, it is checked against
+// the CPU reconstruction with the same policy, which has to match it pixel for pixel. The exit code is 1 if a
+// reconstruction breaks the footprint property or the GPU result differs from the CPU one, 2 on usage errors.
+
+#include "ReflectionGbufferReference.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace ReflectionGbufferModel;
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRGbufferReconstruct [--tolerance 0.002] (capture.gbuf | --synthetic 1920x1080 [--multiplier 0.5])\n"); }
+
+// A floor with a checker of two roughnesses, a glossy and a rough sphere and a thin one that only covers a few pixels
+// at the reflection resolution, seen by a 60 degree camera at the origin looking down -z. Each pixel samples its
+// center, as the rasterizer does.
+static void RenderSyntheticGbuffer(uint32_t width, uint32_t height, DenoiserImage &image) {
+    struct Sphere {
+        float center[3];
+        float radius;
+        float roughness;
+    } const spheres[] = {
+        {{0.0f, 0.0f, -5.0f}, 1.0f, 0.05f},
+        {{1.6f, -0.5f, -3.5f}, 0.5f, 0.45f},
+        {{-1.2f, 0.2f, -3.0f}, 0.03f, 0.1f},
+    };
+    float const near_z = 0.1f, far_z = 100.0f, tan_half_fov = 0.57735f;
+    float const aspect = float(width) / float(height);
+
+    image.Resize(width, height, REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            float dir[3] = {((x + 0.5f) / width * 2.0f - 1.0f) * aspect * tan_half_fov, (1.0f - (y + 0.5f) / height * 2.0f) * tan_half_fov, -1.0f};
+            float t = INFINITY, normal[3] = {0.0f, 0.0f, 0.0f}, roughness = 1.0f;
+            if (dir[1] < 0.0f) { // Floor at y = -1
+                float tf  = -1.0f / dir[1];
+                t         = tf;
+                normal[1] = 1.0f;
+                bool odd  = (int(std::floor(dir[0] * tf)) + int(std::floor(dir[2] * tf))) & 1;
+                roughness = odd ? 0.6f : 0.15f;
+            }
+            for (Sphere const &s : spheres) {
+                float b = dir[0] * s.center[0] + dir[1] * s.center[1] + dir[2] * s.center[2];
+                float c = s.center[0] * s.center[0] + s.center[1] * s.center[1] + s.center[2] * s.center[2] - s.radius * s.radius;
+                float a = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+                float d = b * b - a * c;
+                if (d < 0.0f) continue;
+                float ts = (b - std::sqrt(d)) / a;
+                if (ts <= 0.0f || ts >= t) continue;
+                t = ts;
+                for (int i = 0; i < 3; i++) normal[i] = (dir[i] * ts - s.center[i]) / s.radius;
+                roughness = s.roughness;
+            }
+            // Device depth of the view space distance along -z, t is in units of it.
+            float depth = std::isinf(t) ? 1.0f : far_z / (far_z - near_z) * (1.0f - near_z / t);
+            image.At(REFLECTION_GBUFFER_CAPTURE_DEPTH, x, y) = depth;
+            for (uint32_t i = 0; i < 3; i++) image.At(REFLECTION_GBUFFER_CAPTURE_NORMAL + i, x, y) = std::isinf(t) ? 0.0f : normal[i] * 0.5f + 0.5f;
+            image.At(REFLECTION_GBUFFER_CAPTURE_ROUGHNESS, x, y) = roughness;
+        }
+    }
+}
+
+static void PrintComparison(char const *name, double ms, ReflectionGbufferComparison const &c, uint32_t pixels, uint32_t unmatched) {
+    printf("%-10s %8.2f %9.3f%% %9.3f%% %12.4g %12.4g %9.3f %9.3f %9.4f %9.4f %9u %s\n", name, ms, 100.0 * c.coverageMismatches / pixels,
+           c.pixels ? 100.0 * c.depthMismatches / c.pixels : 0.0, c.meanDepthError, c.maxDepthError, c.meanNormalAngle, c.maxNormalAngle, c.meanRoughnessError,
+           c.maxRoughnessError, unmatched, unmatched ? "FAILED" : "");
+}
+
+int main(int argc, char **argv) {
+    float       tolerance    = 0.002f;
+    float       multiplier   = 0.5f;
+    uint32_t    synthetic[2] = {0, 0};
+    std::string filename;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--tolerance") && hasValue)
+            tolerance = float(atof(argv[++i]));
+        else if (!strcmp(argv[i], "--multiplier") && hasValue)
+            multiplier = float(atof(argv[++i]));
+        else if (!strcmp(argv[i], "--synthetic") && hasValue) {
+            if (sscanf(argv[++i], "%ux%u", &synthetic[0], &synthetic[1]) != 2) {
+                PrintUsage();
+                return 2;
+            }
+        } else if (argv[i][0] != '-' && filename.empty())
+            filename = argv[i];
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    bool const use_synthetic = synthetic[0] && synthetic[1];
+    if (use_synthetic == !filename.empty() || !(multiplier > 0.0f && multiplier <= 1.0f)) {
+        PrintUsage();
+        return 2;
+    }
+
+    ReflectionGbufferCapture capture;
+    if (use_synthetic) {
+        // Same reflection size as the sample picks for the multiplier.
+        RenderSyntheticGbuffer(synthetic[0], synthetic[1], capture.full);
+        RenderSyntheticGbuffer(std::max(128u, uint32_t(synthetic[0] * multiplier)), std::max(128u, uint32_t(synthetic[1] * multiplier)), capture.reflection);
+        printf("synthetic: %ux%u -> %ux%u\n", capture.full.width, capture.full.height, capture.reflection.width, capture.reflection.height);
+    } else {
+        std::string error;
+        if (!LoadReflectionGbufferCapture(filename, capture, &error)) {
+            fprintf(stderr, "error: %s\n", error.c_str());
+            return 2;
+        }
+        printf("%s: %ux%u -> %ux%u, %s\n", filename.c_str(), capture.full.width, capture.full.height, capture.reflection.width, capture.reflection.height,
+               capture.source == REFLECTION_GBUFFER_SOURCE_RASTER ? "raster" : GetReflectionGbufferFootprintName(capture.footprint));
+    }
+    uint32_t const width  = capture.reflection.width;
+    uint32_t const height = capture.reflection.height;
+    uint32_t const pixels = width * height;
+
+    int failures = 0;
+    if (capture.source == REFLECTION_GBUFFER_SOURCE_RECONSTRUCT) {
+        uint32_t x = 0, y = 0;
+        uint32_t unmatched = CountUnmatchedReflectionGbufferPixels(capture.full, capture.reflection, tolerance, &x, &y);
+        DenoiserImage cpu;
+        ReconstructReflectionGbuffer(capture.full, width, height, capture.footprint, cpu);
+        uint32_t differing = 0;
+        for (uint32_t i = 0; i < pixels; i++)
+            for (uint32_t plane = 0; plane < REFLECTION_GBUFFER_CAPTURE_PLANE_COUNT; plane++)
+                if (cpu.Plane(plane)[i] != capture.reflection.Plane(plane)[i]) {
+                    differing++;
+                    break;
+                }
+        printf("gpu %s: %u pixels outside of their footprint (first at %u, %u), %u pixels differ from the cpu\n", GetReflectionGbufferFootprintName(capture.footprint),
+               unmatched, x, y, differing);
+        if (unmatched || differing) failures++;
+        printf("%d check(s) failed\n", failures);
+        return failures ? 1 : 0;
+    }
+
+    // How far the raster pass itself is from taking single samples of the render resolution.
+    printf("raster: %u of %u pixels are not a sample of their footprint, the pixel grids do not line up\n",
+           CountUnmatchedReflectionGbufferPixels(capture.full, capture.reflection, tolerance), pixels);
+    printf("%-10s %8s %10s %10s %12s %12s %9s %9s %9s %9s %9s\n", "footprint", "cpu ms", "coverage", "depth", "mean depth", "max depth", "mean deg", "max deg",
+           "mean r", "max r", "unmatched");
+    for (uint32_t footprint = 0; footprint < REFLECTION_GBUFFER_FOOTPRINT_COUNT; footprint++) {
+        DenoiserImage result;
+        auto          begin = std::chrono::steady_clock::now();
+        ReconstructReflectionGbuffer(capture.full, width, height, footprint, result);
+        double   ms        = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        uint32_t unmatched = CountUnmatchedReflectionGbufferPixels(capture.full, result, tolerance);
+        PrintComparison(GetReflectionGbufferFootprintName(footprint), ms, CompareReflectionGbuffer(capture.reflection, result), pixels, unmatched);
+        if (unmatched) failures++;
+    }
+    printf("%d footprint(s) failed, tolerance %g\n", failures, tolerance);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,297 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Feeds the GPU timing collector (GpuTimingCollector.h) a run of frames from a mock timestamp source with a synthetic
+// clock. Each frame records the scope tree of HSR::Draw, with the HW branch every other frame and a scope recorded
+// twice, and the duration of each scope depends on the frame. The mock GPU finishes a frame 'latency' frames after it
+// was recorded and fails any readback before that. Checks that:
+// - the results of a frame come back exactly 'latency' frames later, tagged with that frame;
+// - every scope reports the summed duration of its records in that frame, 0 if it was not recorded, and the frame
+//   time spans the first to the last scope;
+// - the rolling min/avg/max are those of the last 'window' frames the scope was recorded in;
+// - scopes keep their ids and paths between frames and are ordered parents first;
+// - scopes past the query budget are dropped without unbalancing the tree.
+//
+// Usage: HSRGpuTiming [--frames 500] [--latency 3] [--queries 64] [--window 16]
+//
+// The exit code is 1 if a check fails, 2 on usage errors.
+
+#include "GpuTimingCollector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRGpuTiming [--frames 500] [--latency 3] [--queries 64] [--window 16]\n"); }
+
+static uint32_t s_failures = 0;
+
+static void Check(bool condition, char const *pWhat, uint64_t frame, std::string const &detail = "") {
+    if (condition) return;
+    if (s_failures < 10) fprintf(stderr, "frame %llu: %s %s\n", (unsigned long long)frame, pWhat, detail.c_str());
+    s_failures++;
+}
+
+static uint64_t const Frequency = 25000000; // 25 MHz, 0.04 us per tick
+
+// Query heap, resolve and readback of one query range per slot, and a clock that only moves when told to.
+class MockTimestamps : public GpuTimestampSource {
+public:
+    MockTimestamps(uint32_t slots, uint32_t queries, uint32_t latency)
+        : m_written(slots, std::vector<uint64_t>(queries, 0)), m_resolved(slots, std::vector<uint64_t>(queries, 0)), m_resolvedCount(slots, 0),
+          m_resolvedFrame(slots, -1), m_latency(latency) {}
+
+    uint64_t GetFrequency() const override { return Frequency; }
+    void     WriteTimestamp(uint32_t slot, uint32_t index) override {
+        Check(index < m_written[slot].size(), "query past the slot's range", m_frame);
+        if (index < m_written[slot].size()) m_written[slot][index] = m_now;
+    }
+    void ResolveTimestamps(uint32_t slot, uint32_t count) override {
+        std::copy(m_written[slot].begin(), m_written[slot].begin() + count, m_resolved[slot].begin());
+        m_resolvedCount[slot] = count;
+        m_resolvedFrame[slot] = int64_t(m_frame);
+    }
+    bool ReadTimestamps(uint32_t slot, uint32_t count, uint64_t *pTicks) override {
+        Check(m_resolvedFrame[slot] >= 0 && int64_t(m_frame) - m_resolvedFrame[slot] >= int64_t(m_latency), "read back before the GPU finished the frame", m_frame);
+        Check(count <= m_resolvedCount[slot], "read back more queries than resolved", m_frame);
+        std::copy(m_resolved[slot].begin(), m_resolved[slot].begin() + std::min(count, m_resolvedCount[slot]), pTicks);
+        m_reads++;
+        return true;
+    }
+
+    void     SetFrame(uint64_t frame) { m_frame = frame; }
+    void     Advance(uint64_t ticks) { m_now += ticks; }
+    uint64_t Now() const { return m_now; }
+    uint32_t GetReads() const { return m_reads; }
+
+private:
+    std::vector<std::vector<uint64_t>> m_written;
+    std::vector<std::vector<uint64_t>> m_resolved;
+    std::vector<uint32_t>              m_resolvedCount;
+    std::vector<int64_t>               m_resolvedFrame;
+    uint32_t                           m_latency;
+    uint64_t                           m_frame = 0;
+    uint64_t                           m_now   = 1000;
+    uint32_t                           m_reads = 0;
+};
+
+// What a frame recorded, to compare with the collector once it is read back.
+struct FrameRecord {
+    std::map<std::string, uint64_t> ticks; // Summed over the records of each path.
+    uint64_t                        first = UINT64_MAX, last = 0;
+};
+
+// Records one frame of scopes into the collector and, for those that fit in the query budget, what it has to report.
+class FrameDriver {
+public:
+    FrameDriver(GpuTimingCollector &collector, MockTimestamps &gpu, uint32_t queries) : m_collector(collector), m_gpu(gpu), m_queries(queries) {}
+
+    void Begin(uint64_t frame) {
+        m_frame      = frame;
+        m_used       = 0;
+        m_record     = FrameRecord();
+        m_open.clear();
+        m_gpu.SetFrame(frame);
+        m_collector.BeginFrame(frame);
+    }
+    void BeginScope(std::string const &name) {
+        Open open;
+        open.path     = m_open.empty() ? name : m_open.back().path + "/" + name;
+        open.recorded = m_used + 2 <= m_queries;
+        open.begin    = m_gpu.Now();
+        if (open.recorded) m_used += 2;
+        m_open.push_back(open);
+        m_collector.BeginScope(name.c_str());
+    }
+    void EndScope() {
+        Open const open = m_open.back();
+        m_open.pop_back();
+        m_collector.EndScope();
+        if (!open.recorded) return;
+        m_record.ticks[open.path] += m_gpu.Now() - open.begin;
+        m_record.first = std::min(m_record.first, open.begin);
+        m_record.last  = std::max(m_record.last, m_gpu.Now());
+    }
+    // Work inside the innermost scope, depends on the frame and the scope.
+    void Work(uint32_t salt) { m_gpu.Advance(200 + (m_frame * 7919 + salt * 104729) % 5000); }
+    FrameRecord const &End() {
+        m_collector.EndFrame();
+        return m_record;
+    }
+
+private:
+    struct Open {
+        std::string path;
+        bool        recorded;
+        uint64_t    begin;
+    };
+    GpuTimingCollector &m_collector;
+    MockTimestamps &    m_gpu;
+    uint32_t            m_queries;
+    uint64_t            m_frame = 0;
+    uint32_t            m_used  = 0;
+    FrameRecord         m_record;
+    std::vector<Open>   m_open;
+};
+
+// The scopes of HSR::Draw, give or take.
+static void RecordFrame(FrameDriver &driver, uint64_t frame) {
+    driver.BeginScope("Init");
+    driver.Work(1);
+    driver.EndScope();
+    driver.Work(2); // Between the scopes, outside of any of them
+    driver.BeginScope("Intersection");
+    {
+        driver.BeginScope("SW");
+        driver.Work(3);
+        driver.EndScope();
+        if (frame % 2) {
+            driver.BeginScope("HW");
+            driver.BeginScope("Trace");
+            driver.Work(4);
+            driver.EndScope();
+            driver.BeginScope("DeferredShade");
+            driver.Work(5);
+            driver.EndScope();
+            driver.EndScope();
+        }
+        driver.Work(6);
+    }
+    driver.EndScope();
+    driver.BeginScope("Denoise");
+    for (int pass = 0; pass < 2; pass++) {
+        // Recorded twice, the durations add up
+        driver.BeginScope("Reproject");
+        driver.Work(7 + pass);
+        driver.EndScope();
+        driver.BeginScope("Prefilter");
+        driver.Work(9 + pass);
+        driver.EndScope();
+    }
+    driver.EndScope();
+    driver.BeginScope("Apply");
+    driver.Work(11);
+    driver.EndScope();
+}
+
+static std::vector<std::string> const s_paths = {"Init", "Intersection", "Intersection/SW", "Intersection/HW", "Intersection/HW/Trace", "Intersection/HW/DeferredShade",
+                                                 "Denoise", "Denoise/Reproject", "Denoise/Prefilter", "Apply"};
+
+int main(int argc, char **argv) {
+    uint32_t frames = 500, latency = 3, queries = 64, window = 16;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && hasValue)
+            frames = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--latency") && hasValue)
+            latency = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--queries") && hasValue)
+            queries = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--window") && hasValue)
+            window = uint32_t(atoi(argv[++i]));
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (!frames || !latency || queries < 2 || !window) {
+        PrintUsage();
+        return 2;
+    }
+
+    MockTimestamps     gpu(latency, queries, latency);
+    GpuTimingCollector collector;
+    collector.OnCreate(&gpu, latency, queries, window);
+    FrameDriver driver(collector, gpu, queries);
+
+    double const                                usPerTick = 1000000.0 / double(Frequency);
+    std::vector<FrameRecord>                    records;
+    std::map<std::string, std::vector<double>> samples; // Per path, the durations of the frames read back so far.
+    std::map<std::string, int>                  ids;
+    uint32_t                                    checked = 0;
+    for (uint64_t frame = 0; frame < frames; frame++) {
+        driver.Begin(frame);
+
+        // BeginFrame has read back the frame that last used the slot
+        if (frame >= latency) {
+            FrameRecord const &expected = records[frame - latency];
+            Check(collector.GetResultFrame() == int64_t(frame - latency), "results of the wrong frame", frame, std::to_string(collector.GetResultFrame()));
+            for (auto const &path : s_paths) {
+                auto const   it = expected.ticks.find(path);
+                double const us = it == expected.ticks.end() ? 0.0 : double(it->second) * usPerTick;
+                if (it != expected.ticks.end()) samples[path].push_back(us);
+                Check(std::fabs(collector.GetLastUs(path) - us) < 1e-6, "wrong duration of", frame, path);
+
+                // Ids stay, statistics over the last frames the scope was recorded in
+                int const scope = collector.FindScope(path);
+                if (scope < 0) {
+                    Check(samples[path].empty(), "lost scope", frame, path);
+                    continue;
+                }
+                if (ids.count(path)) Check(ids[path] == scope, "scope changed id", frame, path);
+                ids[path]                         = scope;
+                std::vector<double> const &all    = samples[path];
+                size_t const               count  = std::min<size_t>(all.size(), window);
+                double                     minUs  = 1e30, maxUs = 0.0, sum = 0.0;
+                for (size_t i = all.size() - count; i < all.size(); i++) {
+                    minUs = std::min(minUs, all[i]);
+                    maxUs = std::max(maxUs, all[i]);
+                    sum += all[i];
+                }
+                GpuTimingStats const &stats = collector.GetScopes()[scope].stats;
+                if (count)
+                    Check(stats.samples == count && std::fabs(stats.minUs - minUs) < 1e-6 && std::fabs(stats.maxUs - maxUs) < 1e-6 &&
+                              std::fabs(stats.avgUs - sum / double(count)) < 1e-6,
+                          "wrong statistics of", frame, path);
+            }
+            double const frameUs = expected.last > expected.first ? double(expected.last - expected.first) * usPerTick : 0.0;
+            Check(std::fabs(collector.GetFrameUs() - frameUs) < 1e-6, "wrong frame time", frame);
+            checked++;
+        } else {
+            Check(collector.GetResultFrame() == -1, "results before any frame finished", frame);
+        }
+
+        RecordFrame(driver, frame);
+        records.push_back(driver.End());
+    }
+
+    // Parents first, each scope one level below its parent
+    std::vector<int> const        order  = collector.GetScopeOrder();
+    auto const &                  scopes = collector.GetScopes();
+    std::vector<bool>             listed(scopes.size(), false);
+    for (int scope : order) {
+        int const parent = scopes[scope].parent;
+        Check(parent < 0 || listed[parent], "child before its parent", 0, scopes[scope].name);
+        Check(scopes[scope].depth == (parent < 0 ? 0 : scopes[parent].depth + 1), "wrong depth", 0, scopes[scope].name);
+        listed[scope] = true;
+    }
+    Check(order.size() == scopes.size(), "scope order misses scopes", 0);
+
+    printf("%u frames, latency %u, %u queries per frame, window %u\n", frames, latency, queries, window);
+    printf("%u frames checked, %u readbacks, %zu scopes, %u failed checks\n", checked, gpu.GetReads(), scopes.size(), s_failures);
+    for (int scope : order)
+        printf("%*s%-*s %8.2f us  min %8.2f  avg %8.2f  max %8.2f\n", 2 * scopes[scope].depth, "", 16 - 2 * scopes[scope].depth, scopes[scope].name.c_str(),
+               scopes[scope].stats.lastUs, scopes[scope].stats.minUs, scopes[scope].stats.avgUs, scopes[scope].stats.maxUs);
+    return s_failures ? 1 : 0;
+}
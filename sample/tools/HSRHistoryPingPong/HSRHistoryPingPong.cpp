@@ -0,0 +1,137 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Plays the reflection G-buffer history (HistoryPingPong.h) through a run of frames and tracks which frame each surface
+// holds: the two ping-pong slots, the copy surface and the G-buffer the copying frames render into. The optimized
+// downsample is switched on and off, the window is resized and now and then a frame draws no reflections. Every frame
+// that draws them has to read the previous frame's depth and normals, or no history when the previous frame did not
+// write any or the surfaces were recreated since. Prints how many copies are left against copying every frame, the lit
+// scene history is copied by every frame either way.
+//
+// Usage: HSRHistoryPingPong [--frames 1000] [--toggle-every 37] [--resize-every 101] [--idle-every 59] [--frame-parity]
+//
+// --frame-parity picks the slots by frame index alone, the run then passes only if a frame reads a stale history.
+// The exit code is 1 if a frame reads a stale history or loses a valid one, 2 on usage errors.
+
+#include "HistoryPingPong.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRHistoryPingPong [--frames 1000] [--toggle-every 37] [--resize-every 101] [--idle-every 59] [--frame-parity]\n"); }
+
+static char const *SurfaceName(HistoryPingPong::Surface surface) {
+    static char const *names[] = {"slot 0", "slot 1", "copy", "none"};
+    return names[surface];
+}
+
+int main(int argc, char **argv) {
+    uint32_t frames = 1000, toggleEvery = 37, resizeEvery = 101, idleEvery = 59;
+    bool     frameParity = false;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && hasValue)
+            frames = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--toggle-every") && hasValue)
+            toggleEvery = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--resize-every") && hasValue)
+            resizeEvery = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--idle-every") && hasValue)
+            idleEvery = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--frame-parity"))
+            frameParity = true;
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (!frames) {
+        PrintUsage();
+        return 2;
+    }
+
+    // Frame each surface holds, -1 for garbage. Indexed by HistoryPingPong::Surface, the last entry is the G-buffer
+    // a copying frame renders into, which the next frame overwrites.
+    int const       garbage = -1;
+    int             surfaces[4];
+    HistoryPingPong history;
+    bool            optimized = true, previousWrote = false;
+    uint32_t        drawn = 0, pingPonged = 0, stale = 0, lost = 0;
+    for (int &surface : surfaces) surface = garbage;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        if (toggleEvery && frame && frame % toggleEvery == 0) optimized = !optimized;
+        bool const resized = resizeEvery && frame && frame % resizeEvery == 0;
+        bool const idle    = idleEvery && frame % idleEvery == idleEvery - 1;
+        if (resized) {
+            history.Reset();
+            for (int &surface : surfaces) surface = garbage;
+        }
+
+        // What SampleRenderer::OnRender does, or picking the slots by frame index.
+        HistoryPingPong::Surface write, read;
+        if (idle)
+            history.Reset();
+        else
+            history.BeginFrame(optimized);
+        write = history.GetWrite();
+        read  = history.GetHistory();
+        if (frameParity && !idle) {
+            write = optimized ? HistoryPingPong::Surface(frame % 2) : HistoryPingPong::HISTORY_SURFACE_COPY;
+            read  = optimized ? HistoryPingPong::Surface((frame + 1) % 2) : HistoryPingPong::HISTORY_SURFACE_COPY;
+        }
+        bool const valid = previousWrote && !resized;
+        previousWrote    = !idle;
+        if (idle) continue;
+        drawn++;
+
+        // The optimized downsample writes its slot before the passes read the history, a copying frame renders the
+        // G-buffer first and copies it once the history was read.
+        if (HistoryPingPong::IsSlot(write)) {
+            if (write == read) {
+                if (!stale) fprintf(stderr, "frame %u: writes %s, which holds the history\n", frame, SurfaceName(write));
+                stale++;
+            }
+            surfaces[write] = int(frame);
+            pingPonged++;
+        } else {
+            surfaces[3] = int(frame);
+        }
+        if (read != HistoryPingPong::HISTORY_SURFACE_NONE) {
+            if (!valid || surfaces[read] != int(frame) - 1) {
+                if (!stale) fprintf(stderr, "frame %u: reads a stale history from %s\n", frame, SurfaceName(read));
+                stale++;
+            }
+        } else if (valid) {
+            if (!lost) fprintf(stderr, "frame %u: has no history although the previous frame wrote one\n", frame);
+            lost++;
+        }
+        if (write == HistoryPingPong::HISTORY_SURFACE_COPY) surfaces[HistoryPingPong::HISTORY_SURFACE_COPY] = surfaces[3];
+    }
+
+    // Depth and normals used to be copied by every frame that draws reflections. The lit scene still is, it has to be
+    // taken before the bloom composites into it (see SampleRenderer::CopyHistorySurfaces).
+    printf("%u frames, %u with reflections, %u of them ping-ponged\n", frames, drawn, pingPonged);
+    printf("depth and normal copies: %u of %u, lit scene copies: %u of %u\n", 2 * (drawn - pingPonged), 2 * drawn, drawn, drawn);
+    printf("%u stale reads, %u lost histories\n", stale, lost);
+    return (stale + lost != 0) != frameParity ? 1 : 0;
+}
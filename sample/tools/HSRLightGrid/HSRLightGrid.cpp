@@ -0,0 +1,162 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Benchmarks the light grid of the reflection hit shading (LightGridBuilder.h) on random scenes: one sun, and point and
+// spot lights of 3 to 15 m range spread over a square that grows with the light count, so the density stays that of a
+// lit street. For each light count it times the grid build and the lights found for random hit points, with the grid
+// and by testing every light like the shader used to, checks that both find the same lights and prints how many lights
+// a hit tests with the grid.
+//
+// Usage: HSRLightGrid [--lights 80,500,2000,5000] [--points 200000] [--cells 4096] [--iterations 20]
+//
+// The exit code is 1 if the grid misses or adds a light for any point, 2 on usage errors.
+
+#include "LightGridBuilder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRLightGrid [--lights 80,500,2000,5000] [--points 200000] [--cells 4096] [--iterations 20]\n"); }
+
+template <typename FUNCTION> static double MillisecondsPerIteration(uint32_t iterations, FUNCTION const &function) {
+    auto const begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / iterations;
+}
+
+static bool ParseCounts(char const *pList, std::vector<uint32_t> &counts) {
+    counts.clear();
+    for (char const *p = pList; *p;) {
+        char *pEnd  = NULL;
+        long  count = strtol(p, &pEnd, 10);
+        if (pEnd == p || count <= 0) return false;
+        counts.push_back(uint32_t(count));
+        p = *pEnd == ',' ? pEnd + 1 : pEnd;
+        if (*pEnd && *pEnd != ',') return false;
+    }
+    return !counts.empty();
+}
+
+int main(int argc, char **argv) {
+    std::vector<uint32_t> lightCounts = {80, 500, 2000, 5000};
+    uint32_t              points = 200000, cells = 4096, iterations = 20;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--lights") && hasValue) {
+            if (!ParseCounts(argv[++i], lightCounts)) {
+                PrintUsage();
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--points") && hasValue)
+            points = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--cells") && hasValue)
+            cells = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--iterations") && hasValue)
+            iterations = uint32_t(atoi(argv[++i]));
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (!points || !cells || !iterations) {
+        PrintUsage();
+        return 2;
+    }
+
+    printf("%u points, %u target cells\n", points, cells);
+    printf("%7s %7s %8s %7s %9s %9s %11s %11s %9s %9s\n", "lights", "cells", "occupied", "global", "entries", "build ms", "all ns/pt", "grid ns/pt", "tested", "lit by");
+    auto const random = [](float scale) { return float(rand()) / float(RAND_MAX) * scale; };
+    for (uint32_t lightCount : lightCounts) {
+        // One light per 15 m square, at 1 to 8 m high.
+        float const area = 15.0f * std::sqrt(float(lightCount));
+        srand(lightCount);
+        std::vector<LightGridBuilder::Light> lights(lightCount);
+        for (uint32_t i = 0; i < lightCount; i++) {
+            LightGridBuilder::Light &light = lights[i];
+            float const              x = random(area), y = 1.0f + random(7.0f), z = random(area);
+            light.position[0] = x;
+            light.position[1] = y;
+            light.position[2] = z;
+            light.range       = 3.0f + random(12.0f);
+            if (i == 0) {
+                light.type  = LIGHT_GRID_TYPE_DIRECTIONAL;
+                light.range = 30.0f;
+            } else {
+                light.type = rand() % 10 < 7 ? LIGHT_GRID_TYPE_SPOT : LIGHT_GRID_TYPE_POINT;
+            }
+            // Mostly downwards, spots shine along -direction.
+            float const dx = random(2.0f) - 1.0f, dy = 0.5f + random(1.5f), dz = random(2.0f) - 1.0f;
+            float const length = std::sqrt(dx * dx + dy * dy + dz * dz);
+            light.direction[0] = dx / length;
+            light.direction[1] = dy / length;
+            light.direction[2] = dz / length;
+            light.outerConeCos = std::cos(0.35f + random(0.7f));
+        }
+        std::vector<float> hits(points * 3);
+        for (uint32_t i = 0; i < points; i++) {
+            hits[i * 3 + 0] = random(area);
+            hits[i * 3 + 1] = random(8.0f);
+            hits[i * 3 + 2] = random(area);
+        }
+
+        LightGridBuilder grid;
+        double const     buildMs = MillisecondsPerIteration(iterations, [&]() { grid.Build(lights.data(), lightCount, true, cells); });
+
+        std::vector<uint32_t> found;
+        uint64_t              lit = 0, tested = 0;
+        double const          allMs = MillisecondsPerIteration(1, [&]() {
+            for (uint32_t i = 0; i < points; i++) {
+                QueryLightsBruteForce(lights.data(), lightCount, &hits[i * 3], found);
+                lit += found.size();
+            }
+        });
+        double const gridMs = MillisecondsPerIteration(1, [&]() {
+            for (uint32_t i = 0; i < points; i++) {
+                uint32_t candidates = 0;
+                grid.Query(&hits[i * 3], found, &candidates);
+                tested += candidates;
+            }
+        });
+
+        std::vector<uint32_t> reference;
+        for (uint32_t i = 0; i < points; i++) {
+            QueryLightsBruteForce(lights.data(), lightCount, &hits[i * 3], reference);
+            grid.Query(&hits[i * 3], found);
+            std::sort(found.begin(), found.end());
+            if (found != reference) {
+                fprintf(stderr, "%u lights, point %u (%g, %g, %g): the grid finds %zu lights, testing every light finds %zu\n", lightCount, i, hits[i * 3], hits[i * 3 + 1],
+                        hits[i * 3 + 2], found.size(), reference.size());
+                return 1;
+            }
+        }
+
+        LightGridBuilder::Stats const &stats = grid.GetStats();
+        printf("%7u %7u %8u %7u %9llu %9.3f %11.1f %11.1f %9.2f %9.2f\n", lightCount, stats.cells, stats.occupiedCells, stats.globalLights,
+               (unsigned long long)stats.listEntries, buildMs, allMs * 1.0e6 / points, gridMs * 1.0e6 / points, double(tested) / points, double(lit) / points);
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Scripts the lights of a run of frames and feeds them to the light list (LightListBuilder.h). A sun and spot lights
+// stand still, the first few spots sweep around every frame, a light is added now and then and the last one removed
+// again, and the shadow tiles are repacked once. Then every light stands still for a while, and finally the lights are
+// dropped from the end one by one, still standing. Every frame, a copy of the GPU buffer that only receives the ranges
+// the builder asks for has to hold exactly the packed lights, which have to unpack to the lights given. The still and
+// the shrinking frames have to upload nothing. Prints the bytes uploaded against copying every light slot of the frame
+// constants each frame, as before.
+//
+// Usage: HSRLightList [--frames 600] [--lights 12] [--moving 2] [--repack-at F] [--still 60] [--shrink-every 10]
+//
+// The exit code is 1 if the buffer differs from the lights or a still or shrinking frame uploads, 2 on usage errors.
+
+#include "LightListBuilder.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRLightList [--frames 600] [--lights 12] [--moving 2] [--repack-at F] [--still 60] [--shrink-every 10]\n"); }
+
+// Light 'i' of the scene at 'frame', light 0 is the sun.
+static LightListBuilder::Light MakeLight(uint32_t i, uint32_t frame, uint32_t moving, bool repacked) {
+    LightListBuilder::Light light;
+    memset(&light, 0, sizeof(light));
+    float const angle = i >= 1 && i <= moving ? float(frame) * 0.05f + float(i) : float(i);
+    for (int k = 0; k < 16; k++) light.viewProj[k] = (k % 5 == 0 ? 1.0f : 0.0f) + 0.01f * float(i) * float(k);
+    light.viewProj[3]  = 10.0f * std::cos(angle);
+    light.viewProj[7]  = 10.0f * std::sin(angle);
+    light.direction[1] = 1.0f;
+    light.color[0]     = 1.0f;
+    light.color[1]     = 0.9f;
+    light.color[2]     = 0.8f;
+    light.position[0]  = 10.0f * std::cos(angle);
+    light.position[1]  = 5.0f;
+    light.position[2]  = 10.0f * std::sin(angle);
+    light.intensity    = i ? 30.0f : 4.0f;
+    light.range        = i ? 15.0f : -1.0f;
+    light.innerConeCos = 0.9f;
+    light.outerConeCos = 0.8f;
+    light.type         = i ? 2 : 0; // LightType_Spot, LightType_Directional
+    light.depthBias    = i ? 20.0f / 100000.0f : 1.0f / 100000.0f;
+    // ShadowAtlasTile.h packs the tile position, repacking moves it
+    light.shadowMapIndex = int(i) + (repacked ? 64 : 0);
+    return light;
+}
+
+int main(int argc, char **argv) {
+    uint32_t frames = 600, lights = 12, moving = 2, repackAt = ~0u, still = 60, shrinkEvery = 10;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && hasValue)
+            frames = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--lights") && hasValue)
+            lights = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--moving") && hasValue)
+            moving = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--repack-at") && hasValue)
+            repackAt = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--still") && hasValue)
+            still = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--shrink-every") && hasValue)
+            shrinkEvery = uint32_t(atoi(argv[++i]));
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (!frames || !lights || lights >= LIGHT_LIST_MAX_LIGHTS || moving >= lights || !still || !shrinkEvery) {
+        PrintUsage();
+        return 2;
+    }
+
+    // The scripted frames, then the still ones, then the shrinking ones, which keep the lights of the last scripted frame.
+    uint32_t const        lastCount = lights + (((frames - 1) / 50) % 2);
+    uint32_t const        total     = frames + still + (lastCount - 1) * shrinkEvery;
+    LightListBuilder      list;
+    std::vector<uint32_t> gpu(LIGHT_LIST_MAX_LIGHTS * LIGHT_LIST_LIGHT_WORDS, 0xdeadbeefu);
+    uint64_t              uploaded = 0, uploads = 0, stillUploaded = 0, shrinkUploaded = 0, stillSkipped = 0;
+    uint32_t              wrong    = 0;
+    for (uint32_t frame = 0; frame < total; frame++) {
+        bool const     scripted = frame < frames;
+        bool const     standing = !scripted && frame < frames + still;
+        uint32_t const shrunk   = scripted || standing ? 0 : (frame - frames - still) / shrinkEvery + 1;
+        // One light more for 50 frames out of every 100
+        uint32_t const                       count = scripted ? lights + ((frame / 50) % 2) : lastCount - shrunk;
+        uint32_t const                       time  = scripted ? frame : frames - 1;
+        std::vector<LightListBuilder::Light> frameLights;
+        for (uint32_t i = 0; i < count; i++) frameLights.push_back(MakeLight(i, time, moving, time >= repackAt));
+
+        uint64_t const skipped = list.GetStats().skippedUploads;
+        if (list.Build(frameLights.data(), count)) {
+            size_t const first = size_t(list.GetDirtyFirst()) * LIGHT_LIST_LIGHT_WORDS;
+            size_t const words = size_t(list.GetDirtyCount()) * LIGHT_LIST_LIGHT_WORDS;
+            memcpy(&gpu[first], &list.GetWords()[first], words * 4);
+            uploaded += words * 4;
+            uploads++;
+            if (standing) stillUploaded += words * 4;
+            if (shrunk) shrinkUploaded += words * 4;
+        }
+        if (standing) stillSkipped += list.GetStats().skippedUploads - skipped;
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t packed[LIGHT_LIST_LIGHT_WORDS];
+            PackLight(frameLights[i], packed);
+            LightListBuilder::Light unpacked;
+            UnpackLight(&gpu[size_t(i) * LIGHT_LIST_LIGHT_WORDS], unpacked);
+            if (!memcmp(packed, &gpu[size_t(i) * LIGHT_LIST_LIGHT_WORDS], sizeof(packed)) && !memcmp(&unpacked, &frameLights[i], sizeof(unpacked))) continue;
+            if (!wrong) fprintf(stderr, "frame %u: light %u differs in the GPU buffer\n", frame, i);
+            wrong++;
+        }
+    }
+
+    // Before, the frame constants carried all 80 lights of Cauldron's per_frame, 192 bytes each
+    uint64_t const before = uint64_t(total) * 80 * 192;
+    printf("%u frames, %u lights (%u moving), then %u still and %u shrinking to 1\n", frames, lights, moving, still, total - frames - still);
+    printf("uploads: %llu frames of %u, %llu bytes against %llu (%.2f%%), %u wrong\n", (unsigned long long)uploads, total, (unsigned long long)uploaded,
+           (unsigned long long)before, 100.0 * double(uploaded) / double(before), wrong);
+    printf("still: %llu of %u uploads skipped, %llu bytes; shrinking: %llu bytes\n", (unsigned long long)stillSkipped, still, (unsigned long long)stillUploaded,
+           (unsigned long long)shrinkUploaded);
+    bool const idle = stillSkipped > 0 && stillUploaded == 0 && shrinkUploaded == 0;
+    if (!idle) fprintf(stderr, "the lights uploaded while they stood still or shrank\n");
+    return wrong || !idle ? 1 : 0;
+}
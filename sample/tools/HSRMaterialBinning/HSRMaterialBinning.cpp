@@ -0,0 +1,275 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Bins a hit list by material the way HSR_MATERIAL_BINNING does and prints how divergent the shading waves are
+// before and after (MaterialBinning.h). The hits are a synthetic frame or a list recorded with the "Capture HW Ray
+// Hits" button. The binning runs twice: with the CPU reference, and with a model of the three GPU passes of
+// Intersect.hlsl that keeps their wave granularity (one atomic per distinct bin in a wave, lanes in prefix order
+// within it) and retires the scatter waves in a random order. Checks that:
+// - every binned list is a permutation of the hits and every lane lies in the range of its own bin, both of which
+//   ValidateMaterialBinning and a direct histogram agree on;
+// - the scan leaves the counters zeroed for the next frame and the GPU offsets match the reference;
+// - a binned wave only spans the bins that start in it, so the binned list has at most waves + bins - 1 bins summed
+//   over its waves;
+// - the validator rejects a list with two lanes of different bins swapped.
+//
+// Usage: HSRMaterialBinning [--size 960x540] [--materials 40] [--scatter 0.25] [--wave 32] [--seed 1] [hits.bin]
+//
+// The synthetic frame is the reflection of a scene made of patches, each of one of 'materials' materials with a few
+// of them covering most of the screen. The hits are in the ray list order, 8x8 tiles after each other, one in ten
+// falls back to the environment and 'scatter' of them, the rough reflections, hit a random material instead of the
+// one of their patch. The exit code is 1 if a lane is mis-binned or a check fails, 2 on usage errors.
+
+#include "MaterialBinning.h"
+
+#include "../../src/Shaders/RayGbuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace RayGbufferCodec;
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRMaterialBinning [--size 960x540] [--materials 40] [--scatter 0.25] [--wave 32] [--seed 1] [hits.bin]\n"); }
+
+static uint32_t s_failures = 0;
+
+static void Check(bool condition, char const *pWhat, std::string const &detail = "") {
+    if (condition) return;
+    if (s_failures < 10) fprintf(stderr, "%s %s\n", pWhat, detail.c_str());
+    s_failures++;
+}
+
+static std::vector<uint32_t> SyntheticHits(uint32_t width, uint32_t height, uint32_t materials, float scatter, std::mt19937 &rng) {
+    // Zipf weights, the first materials are the floor and walls of the scene.
+    std::vector<double> weights(materials);
+    for (uint32_t m = 0; m < materials; m++) weights[m] = 1.0 / (m + 1);
+    std::discrete_distribution<uint32_t>  pickMaterial(weights.begin(), weights.end());
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    // Patches are the cells of a jittered 48 pixel grid, a pixel takes the patch of the nearest cell center.
+    uint32_t const        cell = 48, cellsX = (width + cell - 1) / cell + 1, cellsY = (height + cell - 1) / cell + 1;
+    std::vector<float>    centers(2 * cellsX * cellsY);
+    std::vector<uint32_t> patchMaterial(cellsX * cellsY);
+    for (uint32_t c = 0; c < cellsX * cellsY; c++) {
+        centers[2 * c + 0] = (float(c % cellsX) + unit(rng)) * cell;
+        centers[2 * c + 1] = (float(c / cellsX) + unit(rng)) * cell;
+        patchMaterial[c] = pickMaterial(rng);
+    }
+    auto patchAt = [&](uint32_t x, uint32_t y) {
+        uint32_t best = 0;
+        float    bestDistance = 1e30f;
+        for (uint32_t cy = y / cell > 0 ? y / cell - 1 : 0; cy <= std::min(y / cell + 1, cellsY - 1); cy++)
+            for (uint32_t cx = x / cell > 0 ? x / cell - 1 : 0; cx <= std::min(x / cell + 1, cellsX - 1); cx++) {
+                uint32_t const c = cy * cellsX + cx;
+                float const    dx = centers[2 * c] - x, dy = centers[2 * c + 1] - y;
+                if (dx * dx + dy * dy < bestDistance) bestDistance = dx * dx + dy * dy, best = c;
+            }
+        return best;
+    };
+
+    std::vector<uint32_t> words;
+    for (uint32_t ty = 0; ty < height; ty += 8)
+        for (uint32_t tx = 0; tx < width; tx += 8)
+            for (uint32_t y = ty; y < std::min(ty + 8, height); y++)
+                for (uint32_t x = tx; x < std::min(tx + 8, width); x++) {
+                    float const    roll = unit(rng);
+                    bool const     skip = roll < 0.1f;
+                    uint32_t const material = roll < 0.1f + scatter ? pickMaterial(rng) : patchMaterial[patchAt(x, y)];
+                    // Spread the ids over the 15 bits, materials are not numbered densely in a scene.
+                    words.push_back(FFX_Reflections_PackRayGbufferNormalMaterial(unit(rng), unit(rng), (material * 613u) & 0x7fffu, skip));
+                }
+    return words;
+}
+
+// CountMaterialBins, ScanMaterialBins and ScatterMaterialBins with waves of 'waveSize' lanes. The scan is a single
+// sequential sum here, its result does not depend on the order of the additions.
+static void GpuBinning(std::vector<uint32_t> const &words, uint32_t waveSize, std::mt19937 &rng, std::vector<uint32_t> &offsets, std::vector<uint32_t> &order) {
+    std::vector<uint32_t> counters(FFX_REFLECTIONS_MATERIAL_BIN_COUNT, 0);
+    uint32_t const        waves = uint32_t((words.size() + waveSize - 1) / waveSize);
+    std::vector<uint32_t> laneBins;
+    auto                  loadWave = [&](uint32_t wave) {
+        laneBins.clear();
+        for (size_t ray = size_t(wave) * waveSize; ray < std::min(words.size(), size_t(wave + 1) * waveSize); ray++) laneBins.push_back(FFX_Reflections_RayGbufferMaterialBin(words[ray]));
+    };
+
+    for (uint32_t wave = 0; wave < waves; wave++) {
+        loadWave(wave);
+        std::vector<bool> done(laneBins.size(), false);
+        // Each iteration of the waterfall loop serves the bin of the first active lane.
+        for (size_t first = 0; first < laneBins.size(); first++) {
+            if (done[first]) continue;
+            uint32_t count = 0;
+            for (size_t lane = first; lane < laneBins.size(); lane++)
+                if (!done[lane] && laneBins[lane] == laneBins[first]) done[lane] = true, count++;
+            counters[laneBins[first]] += count;
+        }
+    }
+
+    offsets.assign(FFX_REFLECTIONS_MATERIAL_BIN_COUNT, 0);
+    uint32_t sum = 0;
+    for (uint32_t bin = 0; bin < FFX_REFLECTIONS_MATERIAL_BIN_COUNT; bin++) {
+        offsets[bin] = sum;
+        sum += counters[bin];
+        counters[bin] = 0;
+    }
+    Check(std::all_of(counters.begin(), counters.end(), [](uint32_t c) { return c == 0; }), "the scan left counters for the next frame");
+
+    std::vector<uint32_t> next = offsets;
+    std::vector<uint32_t> scheduled(waves);
+    for (uint32_t wave = 0; wave < waves; wave++) scheduled[wave] = wave;
+    std::shuffle(scheduled.begin(), scheduled.end(), rng);
+    order.assign(words.size(), ~0u);
+    for (uint32_t wave : scheduled) {
+        loadWave(wave);
+        std::vector<bool> done(laneBins.size(), false);
+        for (size_t first = 0; first < laneBins.size(); first++) {
+            if (done[first]) continue;
+            uint32_t const bin = laneBins[first];
+            uint32_t       prefix = 0, count = 0;
+            for (size_t lane = first; lane < laneBins.size(); lane++)
+                if (!done[lane] && laneBins[lane] == bin) count++;
+            uint32_t const base = next[bin];
+            next[bin] += count;
+            for (size_t lane = first; lane < laneBins.size(); lane++)
+                if (!done[lane] && laneBins[lane] == bin) {
+                    done[lane] = true;
+                    uint32_t const slot = base + prefix++;
+                    if (slot < order.size()) order[slot] = uint32_t(size_t(wave) * waveSize + lane);
+                }
+        }
+    }
+}
+
+// Counts the lanes of 'order' that lie outside of the range the histogram of the hits gives their bin.
+static uint32_t CountMisbinnedLanes(std::vector<uint32_t> const &words, std::vector<uint32_t> const &order, std::vector<uint32_t> const &histogramOffsets) {
+    uint32_t misbinned = 0;
+    for (size_t lane = 0; lane < order.size(); lane++) {
+        if (order[lane] >= words.size()) {
+            misbinned++;
+            continue;
+        }
+        uint32_t const bin = FFX_Reflections_RayGbufferMaterialBin(words[order[lane]]);
+        if (lane < histogramOffsets[bin] || lane >= histogramOffsets[bin + 1]) misbinned++;
+    }
+    return misbinned;
+}
+
+static void PrintDivergence(char const *pName, ShadingDivergence const &divergence) {
+    printf("%-20s %8u %14.2f %14u %16.1f%%\n", pName, divergence.waves, divergence.avgBinsPerWave, divergence.maxBinsPerWave, 100.0 * divergence.laneUtilization);
+}
+
+int main(int argc, char **argv) {
+    uint32_t    width = 960, height = 540, materials = 40, waveSize = 32, seed = 1;
+    float       scatter = 0.25f;
+    std::string filename;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--size") && hasValue) {
+            if (sscanf(argv[++i], "%ux%u", &width, &height) != 2) width = 0;
+        } else if (!strcmp(argv[i], "--materials") && hasValue)
+            materials = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--scatter") && hasValue)
+            scatter = float(atof(argv[++i]));
+        else if (!strcmp(argv[i], "--wave") && hasValue)
+            waveSize = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+            seed = uint32_t(atoi(argv[++i]));
+        else if (argv[i][0] != '-' && filename.empty())
+            filename = argv[i];
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (width == 0 || height == 0 || materials == 0 || waveSize == 0 || scatter < 0.0f || scatter > 0.9f) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::mt19937          rng(seed);
+    std::vector<uint32_t> words;
+    if (!filename.empty()) {
+        std::string error;
+        if (!LoadRecordedRayHits(filename, words, &error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+        printf("%s: %zu hits\n", filename.c_str(), words.size());
+    } else {
+        words = SyntheticHits(width, height, materials, scatter, rng);
+        printf("%ux%u, %u materials, %.0f%% scattered: %zu hits\n", width, height, materials, 100.0 * scatter, words.size());
+    }
+
+    // Offsets straight from a histogram, independent of both binnings.
+    std::vector<uint32_t> histogram(FFX_REFLECTIONS_MATERIAL_BIN_COUNT + 1, 0);
+    for (uint32_t word : words) histogram[FFX_Reflections_RayGbufferMaterialBin(word) + 1]++;
+    uint32_t const bins = uint32_t(std::count_if(histogram.begin() + 1, histogram.end(), [](uint32_t c) { return c != 0; }));
+    for (size_t bin = 1; bin < histogram.size(); bin++) histogram[bin] += histogram[bin - 1];
+
+    std::vector<uint32_t> referenceOffsets, referenceOrder, gpuOffsets, gpuOrder;
+    BinRayHitsByMaterial(words, referenceOffsets, referenceOrder);
+    GpuBinning(words, waveSize, rng, gpuOffsets, gpuOrder);
+    Check(referenceOffsets == histogram, "reference bin offsets differ from the histogram");
+    Check(std::equal(gpuOffsets.begin(), gpuOffsets.end(), histogram.begin()), "GPU bin offsets differ from the histogram");
+
+    uint32_t misbinned = 0;
+    for (auto const &binned : {std::make_pair("reference", &referenceOrder), std::make_pair("GPU", &gpuOrder)}) {
+        std::string error;
+        Check(ValidateMaterialBinning(words, *binned.second, &error), binned.first, error);
+        uint32_t const lanes = CountMisbinnedLanes(words, *binned.second, histogram);
+        Check(lanes == 0, binned.first, std::to_string(lanes) + " mis-binned lanes");
+        misbinned += lanes;
+    }
+
+    ShadingDivergence const unbinned = EstimateShadingDivergence(words, {}, waveSize);
+    ShadingDivergence const reference = EstimateShadingDivergence(words, referenceOrder, waveSize);
+    ShadingDivergence const gpu = EstimateShadingDivergence(words, gpuOrder, waveSize);
+    for (ShadingDivergence const *pBinned : {&reference, &gpu}) {
+        uint64_t const summed = uint64_t(std::llround(pBinned->avgBinsPerWave * pBinned->waves));
+        Check(summed <= uint64_t(pBinned->waves) + bins - 1, "binned waves span more bins than start in them",
+              std::to_string(summed) + " > " + std::to_string(pBinned->waves + bins - 1));
+    }
+
+    // The validator has to notice two lanes of different bins trading places.
+    for (size_t lane = 1; lane < referenceOrder.size(); lane++) {
+        uint32_t const a = FFX_Reflections_RayGbufferMaterialBin(words[referenceOrder[lane - 1]]);
+        uint32_t const b = FFX_Reflections_RayGbufferMaterialBin(words[referenceOrder[lane]]);
+        if (a == b) continue;
+        std::vector<uint32_t> swapped = referenceOrder;
+        std::swap(swapped[lane - 1], swapped[lane]);
+        Check(!ValidateMaterialBinning(words, swapped), "the validator accepted two swapped lanes");
+        Check(CountMisbinnedLanes(words, swapped, histogram) == 2, "two swapped lanes are not counted as mis-binned");
+        break;
+    }
+
+    printf("%u bins, %u-lane waves\n", bins, waveSize);
+    printf("%-20s %8s %14s %14s %17s\n", "order", "waves", "bins per wave", "max per wave", "lane utilization");
+    PrintDivergence("unbinned", unbinned);
+    PrintDivergence("binned (reference)", reference);
+    PrintDivergence("binned (GPU)", gpu);
+    printf("%u mis-binned lanes, %u failed checks\n", misbinned, s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,338 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Runs synthetic frames of per lane events through models of the wave aggregated counters of Shaders/Metrics.h, reads
+// the blocks back through HsrMetricsReadback the way HSR::Draw does and checks the decoded metrics (HsrMetrics.h).
+// A frame is waves of lanes going through the screen space, HW and deferred shading passes, each lane with random
+// outcomes, ray lengths and march distances. Checks that:
+// - each frame read back is the one that retired 'slots' frames earlier, and decodes to the exact totals of its
+//   lanes, counters and histograms, although the GPU adds them once per wave or per distinct bin in a wave;
+// - the frames summed with HsrMetrics::Accumulate as the benchmark does match the totals of the frames read back;
+// - legacy, short and unknown blocks decode or fail as documented, and the hybrid count survives a torn block;
+// - the bin lower bounds agree with the histogram bins of the shaders, and the percentiles with a direct count.
+// The GPU of the model finishes a frame 'latency' frames after it was recorded and the slots hold garbage until
+// then, a latency above the slot count reads back stale blocks and fails the checks.
+//
+// Usage: HSRMetrics [--frames 200] [--slots 3] [--latency 3] [--wave 32] [--seed 1]
+//
+// The exit code is 1 if a check fails, 2 on usage errors.
+
+#include "HsrMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+using namespace HsrMetricsCodec;
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRMetrics [--frames 200] [--slots 3] [--latency 3] [--wave 32] [--seed 1]\n"); }
+
+static uint32_t s_failures = 0;
+
+static void Check(bool condition, char const *pWhat, int64_t frame, std::string const &detail = "") {
+    if (condition) return;
+    if (s_failures < 10) fprintf(stderr, "frame %lld: %s %s\n", (long long)frame, pWhat, detail.c_str());
+    s_failures++;
+}
+
+static std::string Expected(uint64_t value, uint64_t expected) { return std::to_string(value) + ", expected " + std::to_string(expected); }
+
+// g_rw_metrics and the wave intrinsics of FFX_Reflections_CountMetric and FFX_Reflections_AddMetricHistogram.
+class MetricsBlockModel {
+public:
+    explicit MetricsBlockModel(uint32_t waveSize) : m_waveSize(waveSize) {}
+
+    // PrepareIndirectArgs.
+    void Prepare(uint32_t swRays, uint32_t hwRays, uint32_t denoiseTiles) {
+        std::fill(m_words, m_words + HSR_METRICS_WORD_COUNT, 0u);
+        m_words[HSR_METRICS_SW_RAYS]       = swRays;
+        m_words[HSR_METRICS_HW_RAYS]       = hwRays;
+        m_words[HSR_METRICS_VERSION_WORD]  = HSR_METRICS_VERSION;
+        m_words[HSR_METRICS_DENOISE_TILES] = denoiseTiles;
+    }
+
+    // One atomic per wave with a lane that counts, the conditions are those of the lanes of the pass in order.
+    void CountMetric(uint32_t word, std::vector<bool> const &conditions) {
+        for (size_t first = 0; first < conditions.size(); first += m_waveSize) {
+            uint32_t count = 0;
+            for (size_t lane = first; lane < std::min(conditions.size(), first + m_waveSize); lane++) count += conditions[lane] ? 1u : 0u;
+            if (count > 0) Add(word, count);
+        }
+    }
+
+    // One atomic per distinct bin of the counting lanes of a wave, in the order of the waterfall loop.
+    void AddMetricHistogram(uint32_t firstWord, std::vector<uint32_t> const &bins, std::vector<bool> const &conditions) {
+        for (size_t first = 0; first < bins.size(); first += m_waveSize) {
+            size_t const      last = std::min(bins.size(), first + m_waveSize);
+            std::vector<bool> done(last - first, false);
+            for (size_t lane = first; lane < last; lane++) {
+                if (!conditions[lane] || done[lane - first]) continue;
+                uint32_t count = 0;
+                for (size_t other = lane; other < last; other++)
+                    if (conditions[other] && !done[other - first] && bins[other] == bins[lane]) done[other - first] = true, count++;
+                Add(firstWord + bins[lane], count);
+            }
+        }
+    }
+
+    void     Store(uint32_t word, uint32_t value) { m_words[word] = value; }
+    void     Add(uint32_t word, uint32_t value) { m_words[word] += value, m_counted += value, m_atomics++; }
+    uint32_t const *GetWords() const { return m_words; }
+    uint64_t GetAtomics() const { return m_atomics; }
+    uint64_t GetCounted() const { return m_counted; } // Atomics one per counting lane would take.
+
+private:
+    uint32_t m_waveSize;
+    uint32_t m_words[HSR_METRICS_WORD_COUNT] = {};
+    uint64_t m_atomics                       = 0;
+    uint64_t m_counted                       = 0;
+};
+
+struct Frame {
+    uint32_t   words[HSR_METRICS_WORD_COUNT];
+    HsrMetrics expected; // Summed lane by lane.
+    uint64_t   lanes = 0;
+};
+
+static Frame RunFrame(MetricsBlockModel &gpu, std::mt19937 &rng) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<int>    exponent(-9, 14);
+    auto logUniform = [&]() { return std::ldexp(1.0f + unit(rng), exponent(rng)); };
+
+    Frame     frame;
+    uint32_t  swRays = 20000 + uint32_t(unit(rng) * 20000.0f), hwRays = 2000 + uint32_t(unit(rng) * 8000.0f), denoiseTiles = 500 + uint32_t(unit(rng) * 1500.0f);
+    HsrMetrics &e = frame.expected;
+    e.version = HSR_METRICS_VERSION, e.frameCount = 1, e.swRays = swRays, e.denoiseTiles = denoiseTiles;
+    gpu.Prepare(swRays, hwRays, denoiseTiles);
+
+    // Screen space pass, the rejected rays join the HW list as hybrid rays.
+    std::vector<bool>     rejected(swRays), rough(swRays), missed(swRays), resolved(swRays), valid(swRays);
+    std::vector<uint32_t> lengthBins(swRays), marchBins(swRays);
+    for (uint32_t lane = 0; lane < swRays; lane++) {
+        valid[lane]    = unit(rng) < 0.95f;
+        bool const doHw = valid[lane] && unit(rng) < 0.15f;
+        rejected[lane] = doHw;
+        rough[lane]    = doHw && unit(rng) < 0.3f;
+        resolved[lane] = valid[lane] && !doHw && unit(rng) < 0.8f;
+        missed[lane]   = valid[lane] && !doHw && !resolved[lane];
+        lengthBins[lane] = FFX_Reflections_RayLengthMetricBin(logUniform());
+        marchBins[lane]  = FFX_Reflections_MarchMetricBin(logUniform());
+        e.swConfidenceRejected += rejected[lane];
+        e.swRoughFallback += rough[lane];
+        e.swMisses += missed[lane];
+        if (resolved[lane]) e.rayLengthHistogram[lengthBins[lane]]++;
+        if (valid[lane]) e.marchHistogram[marchBins[lane]]++;
+    }
+    gpu.CountMetric(HSR_METRICS_SW_CONFIDENCE_REJECTED, rejected);
+    gpu.CountMetric(HSR_METRICS_SW_ROUGH_FALLBACK, rough);
+    gpu.CountMetric(HSR_METRICS_SW_MISSES, missed);
+    gpu.AddMetricHistogram(HSR_METRICS_RAY_LENGTH_HISTOGRAM, lengthBins, resolved);
+    gpu.AddMetricHistogram(HSR_METRICS_MARCH_HISTOGRAM, marchBins, valid);
+
+    uint32_t const deferredRays = hwRays + uint32_t(e.swConfidenceRejected - e.swRoughFallback);
+    gpu.Store(HSR_METRICS_DEFERRED_HW_RAYS, deferredRays);
+    e.hwRays = deferredRays, e.hybridRays = deferredRays - hwRays;
+
+    // HW pass, then the deferred shading of its hits.
+    std::vector<bool>     opaqueMiss(deferredRays), transparent(deferredRays), skip(deferredRays), shaded(deferredRays);
+    std::vector<uint32_t> hitBins(deferredRays);
+    for (uint32_t lane = 0; lane < deferredRays; lane++) {
+        opaqueMiss[lane]  = unit(rng) < 0.1f;
+        transparent[lane] = unit(rng) < 0.05f;
+        skip[lane]        = opaqueMiss[lane] || unit(rng) < 0.02f;
+        shaded[lane]      = !skip[lane];
+        hitBins[lane]     = FFX_Reflections_RayLengthMetricBin(logUniform());
+        e.hwMisses += opaqueMiss[lane];
+        e.hwTransparentHits += transparent[lane];
+        e.deferredShadeSkips += skip[lane];
+        if (shaded[lane]) e.rayLengthHistogram[hitBins[lane]]++;
+    }
+    gpu.CountMetric(HSR_METRICS_HW_MISSES, opaqueMiss);
+    gpu.CountMetric(HSR_METRICS_HW_TRANSPARENT_HITS, transparent);
+    gpu.CountMetric(HSR_METRICS_DEFERRED_SHADE_SKIPS, skip);
+    gpu.AddMetricHistogram(HSR_METRICS_RAY_LENGTH_HISTOGRAM, hitBins, shaded);
+
+    memcpy(frame.words, gpu.GetWords(), sizeof(frame.words));
+    frame.lanes = uint64_t(swRays) + deferredRays;
+    return frame;
+}
+
+static void CheckMetrics(HsrMetrics const &m, HsrMetrics const &e, int64_t frame) {
+    Check(m.version == e.version, "version", frame, Expected(m.version, e.version));
+    Check(m.frameCount == e.frameCount, "frame count", frame, Expected(m.frameCount, e.frameCount));
+    std::pair<char const *, std::pair<uint64_t, uint64_t>> const fields[] = {
+        {"swRays", {m.swRays, e.swRays}},
+        {"hwRays", {m.hwRays, e.hwRays}},
+        {"hybridRays", {m.hybridRays, e.hybridRays}},
+        {"swConfidenceRejected", {m.swConfidenceRejected, e.swConfidenceRejected}},
+        {"swRoughFallback", {m.swRoughFallback, e.swRoughFallback}},
+        {"swMisses", {m.swMisses, e.swMisses}},
+        {"hwMisses", {m.hwMisses, e.hwMisses}},
+        {"hwTransparentHits", {m.hwTransparentHits, e.hwTransparentHits}},
+        {"deferredShadeSkips", {m.deferredShadeSkips, e.deferredShadeSkips}},
+        {"denoiseTiles", {m.denoiseTiles, e.denoiseTiles}},
+    };
+    for (auto const &field : fields) Check(field.second.first == field.second.second, field.first, frame, Expected(field.second.first, field.second.second));
+    for (int bin = 0; bin < HSR_METRICS_HISTOGRAM_BINS; bin++) {
+        Check(m.rayLengthHistogram[bin] == e.rayLengthHistogram[bin], "ray length histogram bin", frame, std::to_string(bin) + ": " + Expected(m.rayLengthHistogram[bin], e.rayLengthHistogram[bin]));
+        Check(m.marchHistogram[bin] == e.marchHistogram[bin], "march histogram bin", frame, std::to_string(bin) + ": " + Expected(m.marchHistogram[bin], e.marchHistogram[bin]));
+    }
+}
+
+static void CheckDecoder() {
+    uint32_t    block[HSR_METRICS_WORD_COUNT] = {};
+    HsrMetrics  metrics;
+    std::string error;
+
+    // Legacy blocks have no version word, only the three ray counts are read.
+    uint32_t const legacy[] = {100, 20, 35, 0};
+    Check(DecodeHsrMetrics(legacy, 4, metrics, &error), "legacy block does not decode", -1, error);
+    Check(metrics.version == 1 && metrics.swRays == 100 && metrics.hwRays == 35 && metrics.hybridRays == 15 && metrics.swMisses == 0, "legacy block", -1);
+
+    Check(!DecodeHsrMetrics(legacy, 3, metrics), "block without a version word decodes", -1);
+    Check(!DecodeHsrMetrics(nullptr, HSR_METRICS_WORD_COUNT, metrics), "null block decodes", -1);
+    block[HSR_METRICS_VERSION_WORD] = HSR_METRICS_VERSION + 1;
+    Check(!DecodeHsrMetrics(block, HSR_METRICS_WORD_COUNT, metrics), "unknown version decodes", -1);
+    block[HSR_METRICS_VERSION_WORD] = HSR_METRICS_VERSION;
+    Check(!DecodeHsrMetrics(block, HSR_METRICS_WORD_COUNT - 1, metrics), "short block decodes", -1);
+
+    // A block cleared between the two HW counts must not wrap the hybrid count.
+    block[HSR_METRICS_HW_RAYS] = 50, block[HSR_METRICS_DEFERRED_HW_RAYS] = 0;
+    Check(DecodeHsrMetrics(block, HSR_METRICS_WORD_COUNT, metrics) && metrics.hybridRays == 0, "torn block wraps the hybrid count", -1);
+}
+
+static void CheckBins() {
+    for (int bin = 1; bin < HSR_METRICS_HISTOGRAM_BINS; bin++) {
+        float const rayLength = float(HsrRayLengthBinLowerBound(bin)), march = float(HsrMarchBinLowerBound(bin));
+        Check(FFX_Reflections_RayLengthMetricBin(rayLength) == uint(bin), "ray length bin of the lower bound", bin);
+        Check(FFX_Reflections_RayLengthMetricBin(std::nextafter(rayLength, 0.0f)) == uint(bin - 1), "ray length bin below the lower bound", bin);
+        Check(FFX_Reflections_MarchMetricBin(march) == uint(bin), "march bin of the lower bound", bin);
+        Check(FFX_Reflections_MarchMetricBin(std::nextafter(march, 0.0f)) == uint(bin - 1), "march bin below the lower bound", bin);
+    }
+    for (float outside : {0.0f, -1.0f, 1e-30f}) Check(FFX_Reflections_RayLengthMetricBin(outside) == 0u, "ray length below the first bin", -1);
+    Check(FFX_Reflections_RayLengthMetricBin(1e30f) == HSR_METRICS_HISTOGRAM_BINS - 1u, "ray length above the last bin", -1);
+
+    std::mt19937 rng(7);
+    for (int trial = 0; trial < 1000; trial++) {
+        uint64_t histogram[HSR_METRICS_HISTOGRAM_BINS] = {};
+        uint64_t total = 0;
+        for (uint64_t &count : histogram) total += count = rng() % 4 == 0 ? rng() % 100 : 0;
+        double const p = double(rng() % 1001) / 10.0;
+        int const    bin = HsrMetricsPercentileBin(histogram, p);
+        if (total == 0) {
+            Check(bin == -1, "percentile of an empty histogram", trial);
+            continue;
+        }
+        // Nearest rank: the smallest bin with at least ceil(p * total) samples up to it, and at least one.
+        uint64_t const rank = std::max<uint64_t>(1, uint64_t(std::ceil(p / 100.0 * double(total))));
+        uint64_t       below = 0;
+        for (int b = 0; b < bin; b++) below += histogram[b];
+        Check(bin >= 0 && below < rank && below + histogram[bin] >= rank, "percentile bin", trial, std::to_string(p) + "% in bin " + std::to_string(bin));
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t frames = 200, slots = 3, latency = 3, waveSize = 32, seed = 1;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && hasValue)
+            frames = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--slots") && hasValue)
+            slots = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--latency") && hasValue)
+            latency = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--wave") && hasValue)
+            waveSize = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+            seed = uint32_t(atoi(argv[++i]));
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (frames == 0 || slots == 0 || latency == 0 || waveSize == 0) {
+        PrintUsage();
+        return 2;
+    }
+
+    CheckDecoder();
+    CheckBins();
+
+    std::mt19937          rng(seed);
+    MetricsBlockModel     gpu(waveSize);
+    HsrMetricsReadback    readback;
+    std::vector<uint32_t> mapped(size_t(slots) * HSR_METRICS_WORD_COUNT, 0xcdcdcdcdu); // never written before a copy lands
+    std::vector<Frame>    recorded;
+    std::deque<std::pair<uint32_t, uint32_t>> copies; // frame, slot of the copies the GPU has not run yet
+    readback.OnCreate(slots);
+
+    HsrMetrics benchmark, expectedSum;
+    int64_t    benchmarkFrame = -1, lastRead = -1;
+    uint64_t   lanes = 0, reads = 0;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        // The copies of the frames that finished on the GPU land in the mapped slots.
+        while (!copies.empty() && copies.front().first + latency <= frame) {
+            memcpy(&mapped[size_t(copies.front().second) * HSR_METRICS_WORD_COUNT], recorded[copies.front().first].words, sizeof(Frame::words));
+            copies.pop_front();
+        }
+
+        HsrMetrics  metrics;
+        int64_t     metricsFrame = -1;
+        std::string error;
+        if (readback.ReadRetired(mapped.data(), metrics, metricsFrame, &error)) {
+            Check(metricsFrame == int64_t(frame) - int64_t(slots), "read back the wrong frame", frame, Expected(uint64_t(metricsFrame), frame - slots));
+            Check(metricsFrame == lastRead + 1, "skipped or repeated a frame", frame);
+            if (metricsFrame >= 0 && metricsFrame < int64_t(recorded.size())) {
+                CheckMetrics(metrics, recorded[size_t(metricsFrame)].expected, metricsFrame);
+                expectedSum.Accumulate(recorded[size_t(metricsFrame)].expected);
+            }
+            lastRead = metricsFrame;
+            reads++;
+        } else {
+            Check(error.empty() && frame < slots, "no block read back", frame, error);
+        }
+
+        // The benchmark samples the state every frame and sums each metrics frame once.
+        if (lastRead >= 0 && lastRead != benchmarkFrame) {
+            benchmark.Accumulate(metrics);
+            benchmarkFrame = lastRead;
+        }
+
+        recorded.push_back(RunFrame(gpu, rng));
+        lanes += recorded.back().lanes;
+        copies.push_back(std::make_pair(frame, readback.GetSlot()));
+        readback.EndFrame();
+    }
+    CheckMetrics(benchmark, expectedSum, -1);
+    Check(benchmark.frameCount == reads, "benchmark frame count", -1, Expected(benchmark.frameCount, reads));
+
+    printf("%u frames, %llu lanes, %llu atomics in waves of %u (%.1f%% of one per counted lane)\n", frames, (unsigned long long)lanes,
+           (unsigned long long)gpu.GetAtomics(), waveSize, 100.0 * double(gpu.GetAtomics()) / double(gpu.GetCounted()));
+    printf("%llu blocks read back %u frames late, %llu rays summed\n", (unsigned long long)reads, slots, (unsigned long long)(benchmark.swRays + benchmark.hwRays));
+    printf("%u failed checks\n", s_failures);
+    return s_failures ? 1 : 0;
+}
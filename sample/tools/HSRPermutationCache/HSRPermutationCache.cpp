@@ -0,0 +1,335 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Checks the HSR PSO permutations (HsrPermutations.h) and their cache (PermutationCache.h) with a mock backend whose
+// tables only record the mask they were built for:
+// - every combination of options packs into its own mask, with the defines of its bits and nothing else, and the
+//   defines of the pso_prewarm config map back to the same bits;
+// - a mask that is not ready falls back to the ready permutation with the same required bits and the fewest other
+//   differing bits, lowest mask on ties, compared with a brute force search over random ready sets;
+// - a background build does not block Acquire while a fallback is ready, each mask is built once, and evicted, rebuilt
+//   and cleared tables are released exactly once;
+// - a build that fails, on a worker thread or inline, leaves its mask unbuilt without stopping the caller, which keeps
+//   getting the fallback until a Rebuild tries the mask again.
+//
+// Usage: HSRPermutationCache [--trials 2000] [--seed 1] [--no-required-bits]
+//
+// --no-required-bits gives the cache no required bits, the run then has to fail. The exit code is 1 if a check
+// fails, 2 on usage errors.
+
+#include "HsrPermutations.h"
+#include "PermutationCache.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRPermutationCache [--trials 2000] [--seed 1] [--no-required-bits]\n"); }
+
+static uint32_t s_failures = 0;
+
+static void Check(bool condition, char const *pWhat, uint32_t mask) {
+    if (condition) return;
+    if (s_failures < 10) fprintf(stderr, "mask 0x%02x: %s\n", mask, pWhat);
+    s_failures++;
+}
+
+// What the mock backend builds.
+struct MockTable {
+    uint32_t mask       = 0;
+    uint32_t generation = 0; // 0 for a first build, one more with each Rebuild.
+};
+
+// Counts the builds and releases of the tables, holds the builds of the worker threads until Open(), and throws for
+// the masks given to Fail() like a shader that does not compile.
+class MockBackend {
+public:
+    MockTable Build(uint32_t mask, MockTable const *pPrevious) {
+        if (std::this_thread::get_id() != m_mainThread) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_opened.wait(lock, [this]() { return m_open; });
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_attempts[mask]++;
+        if (m_failing.count(mask)) throw 1;
+        m_builds[mask]++;
+        MockTable table;
+        table.mask       = mask;
+        table.generation = pPrevious ? pPrevious->generation + 1 : 0;
+        return table;
+    }
+    void Destroy(MockTable &table) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_destroys[table.mask]++;
+    }
+    void Open() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = true;
+        m_opened.notify_all();
+    }
+    void Fail(uint32_t mask, bool fail) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (fail)
+            m_failing.insert(mask);
+        else
+            m_failing.erase(mask);
+    }
+    uint32_t GetAttempts(uint32_t mask) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_attempts[mask];
+    }
+    uint32_t GetBuilds(uint32_t mask) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_builds[mask];
+    }
+    uint32_t GetDestroys(uint32_t mask) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_destroys[mask];
+    }
+
+private:
+    std::thread::id             m_mainThread = std::this_thread::get_id();
+    std::mutex                  m_mutex;
+    std::condition_variable     m_opened;
+    bool                        m_open = false;
+    std::set<uint32_t>           m_failing;
+    std::map<uint32_t, uint32_t> m_attempts;
+    std::map<uint32_t, uint32_t> m_builds;
+    std::map<uint32_t, uint32_t> m_destroys;
+};
+
+static void InitCache(PermutationCache<MockTable> &cache, MockBackend &backend, uint32_t requiredBits, bool allowAsync) {
+    cache.Init([&backend](uint32_t mask, MockTable const *pPrevious) { return backend.Build(mask, pPrevious); }, //
+               [&backend](MockTable &table) { backend.Destroy(table); },                                       //
+               requiredBits, allowAsync);
+}
+
+static uint32_t CountBits(uint32_t bits) {
+    uint32_t count = 0;
+    for (; bits; bits &= bits - 1) count++;
+    return count;
+}
+
+static void CheckKeys() {
+    for (uint32_t combination = 0; combination < HSR_PERMUTATION_COUNT; combination++) {
+        HSRPermutationOptions options;
+        options.debug             = (combination & 1) != 0;
+        options.transparentQuery  = (combination & 2) != 0;
+        options.shadingUseScreen  = (combination & 4) != 0;
+        options.upscale           = (combination & 8) != 0;
+        options.compactRayGbuffer = (combination & 16) != 0;
+        options.materialBinning   = (combination & 32) != 0;
+        options.packedRadiance    = (combination & 64) != 0;
+        options.convergedTiles    = (combination & 128) != 0;
+        uint32_t const mask       = GetPermutationMask(options);
+        Check(mask < HSR_PERMUTATION_COUNT, "mask out of range", mask);
+        Check(((mask & HSR_PERMUTATION_DEBUG) != 0) == options.debug, "HSR_DEBUG bit", mask);
+        Check(((mask & HSR_PERMUTATION_TRANSPARENT_QUERY) != 0) == options.transparentQuery, "HSR_TRANSPARENT_QUERY bit", mask);
+        Check(((mask & HSR_PERMUTATION_SHADING_USE_SCREEN) != 0) == options.shadingUseScreen, "HSR_SHADING_USE_SCREEN bit", mask);
+        Check(((mask & HSR_PERMUTATION_UPSCALE) != 0) == options.upscale, "UPSCALE bit", mask);
+        Check(((mask & HSR_PERMUTATION_COMPACT_RAY_GBUFFER) != 0) == options.compactRayGbuffer, "HSR_COMPACT_RAY_GBUFFER bit", mask);
+        Check(((mask & HSR_PERMUTATION_MATERIAL_BINNING) != 0) == options.materialBinning, "HSR_MATERIAL_BINNING bit", mask);
+        Check(((mask & HSR_PERMUTATION_PACKED_RADIANCE) != 0) == options.packedRadiance, "HSR_PACKED_RADIANCE bit", mask);
+        Check(((mask & HSR_PERMUTATION_CONVERGED_TILES) != 0) == options.convergedTiles, "HSR_CONVERGED_TILES bit", mask);
+
+        // The defines of the mask, and what the pso_prewarm config makes of them
+        std::map<const std::string, std::string> defines;
+        GetPermutationDefines(mask, defines);
+        Check(defines.size() == CountBits(mask), "one define per bit", mask);
+        uint32_t fromDefines = 0;
+        for (auto const &define : defines) fromDefines |= GetPermutationBit(define.first);
+        Check(fromDefines == mask, "defines map back to the mask", mask);
+    }
+    Check(GetPermutationBit("HSR_NOT_A_PERMUTATION") == 0, "unknown define has a bit", 0);
+    Check((HSR_PERMUTATION_REQUIRED_BITS & HSR_PERMUTATION_DEBUG) == 0, "HSR_DEBUG is required", HSR_PERMUTATION_REQUIRED_BITS);
+    Check((HSR_PERMUTATION_REQUIRED_BITS & HSR_PERMUTATION_UPSCALE) != 0, "UPSCALE is not required", HSR_PERMUTATION_REQUIRED_BITS);
+}
+
+// What FindFallback has to pick, HSR_PERMUTATION_COUNT if there is no compatible ready permutation.
+static uint32_t FindFallbackBruteForce(std::vector<bool> const &ready, uint32_t mask) {
+    uint32_t best = HSR_PERMUTATION_COUNT, bestDist = ~0u;
+    for (uint32_t other = 0; other < HSR_PERMUTATION_COUNT; other++) {
+        if (!ready[other] || ((other ^ mask) & HSR_PERMUTATION_REQUIRED_BITS)) continue;
+        uint32_t const dist = CountBits(other ^ mask);
+        if (dist < bestDist) {
+            bestDist = dist;
+            best     = other;
+        }
+    }
+    return best;
+}
+
+// A random mask, the required bits are mostly the ones of a typical run so that most masks have a fallback.
+static uint32_t RandomMask(std::mt19937 &random) {
+    uint32_t mask = random() % HSR_PERMUTATION_COUNT;
+    if (random() % 4) mask = (mask & ~HSR_PERMUTATION_REQUIRED_BITS) | ((random() % 2) ? uint32_t(HSR_PERMUTATION_UPSCALE) : 0u);
+    return mask;
+}
+
+// Builds inline, so the first Acquire of a mask returns the fallback and builds it on the spot.
+static void CheckFallbacks(uint32_t trials, uint32_t seed, uint32_t requiredBits, uint32_t &fallbacks, uint32_t &blocking) {
+    std::mt19937 random(seed);
+    for (uint32_t trial = 0; trial < trials; trial++) {
+        MockBackend                 backend;
+        PermutationCache<MockTable> cache;
+        InitCache(cache, backend, requiredBits, false);
+        std::vector<bool>     ready(HSR_PERMUTATION_COUNT, false);
+        std::vector<uint32_t> prewarm;
+        uint32_t const        readyCount = random() % 8;
+        for (uint32_t i = 0; i < readyCount; i++) {
+            uint32_t const mask = RandomMask(random);
+            prewarm.push_back(mask);
+            ready[mask] = true;
+        }
+        cache.Prewarm(prewarm);
+
+        uint32_t const   mask     = RandomMask(random);
+        uint32_t const   expected = ready[mask] ? mask : FindFallbackBruteForce(ready, mask);
+        MockTable const &table    = cache.Acquire(mask);
+        if (expected == HSR_PERMUTATION_COUNT) {
+            Check(table.mask == mask, "no compatible fallback, has to wait for the mask", mask);
+            blocking++;
+        } else {
+            Check(table.mask == expected, "wrong fallback", mask);
+            Check(!((table.mask ^ mask) & HSR_PERMUTATION_REQUIRED_BITS), "fallback differs in a required bit", mask);
+            if (table.mask != mask) fallbacks++;
+        }
+        Check(cache.IsReady(mask), "not built", mask);
+        for (uint32_t other = 0; other < HSR_PERMUTATION_COUNT; other++)
+            if (ready[other] || other == mask) Check(backend.GetBuilds(other) == 1, "built more than once", other);
+        cache.Clear();
+        for (uint32_t other = 0; other < HSR_PERMUTATION_COUNT; other++) Check(backend.GetDestroys(other) == backend.GetBuilds(other), "not released once", other);
+    }
+}
+
+// Background builds are held until the backend opens.
+static void CheckAsync(uint32_t requiredBits) {
+    uint32_t const              shipping = HSR_PERMUTATION_UPSCALE;
+    uint32_t const              debug    = shipping | HSR_PERMUTATION_DEBUG | HSR_PERMUTATION_TRANSPARENT_QUERY;
+    uint32_t const              native   = 0;
+    MockBackend                 backend;
+    PermutationCache<MockTable> cache;
+    InitCache(cache, backend, requiredBits, true);
+
+    // Nothing ready, built on the calling thread
+    Check(cache.Acquire(shipping).mask == shipping, "first Acquire returns the mask", shipping);
+    // Compatible fallback while the build is held
+    Check(cache.Acquire(debug).mask == shipping, "Acquire does not fall back while the mask builds", debug);
+    Check(cache.IsPending(debug), "build not queued", debug);
+    Check(cache.Acquire(debug).mask == shipping, "Acquire blocks on a pending build", debug);
+    // Nothing compatible, waits for its own build on the calling thread
+    Check(cache.Acquire(native).mask == native, "Acquire falls back across a required bit", native);
+    cache.Prewarm({shipping | HSR_PERMUTATION_SHADING_USE_SCREEN});
+    Check(cache.GetPendingCount() == 2, "prewarm not queued", shipping | HSR_PERMUTATION_SHADING_USE_SCREEN);
+
+    backend.Open();
+    while (cache.GetPendingCount()) {
+        std::this_thread::yield();
+        cache.Update();
+    }
+    Check(cache.Acquire(debug).mask == debug, "finished build not picked up", debug);
+    Check(backend.GetBuilds(debug) == 1, "built more than once", debug);
+
+    cache.Rebuild();
+    Check(cache.Acquire(debug).generation == 1, "Rebuild does not pass the previous table", debug);
+    cache.Evict(HSR_PERMUTATION_DEBUG);
+    Check(!cache.IsReady(debug) && backend.GetDestroys(debug) == 1, "Evict does not release the debug table", debug);
+    Check(cache.IsReady(shipping) && !backend.GetDestroys(shipping), "Evict releases a shipping table", shipping);
+    cache.Clear();
+    for (uint32_t mask : {shipping, debug, native}) Check(backend.GetDestroys(mask) == 1, "not released once", mask);
+}
+
+// Failed builds are given up on until the next Rebuild.
+static void CheckFailedBuilds(uint32_t requiredBits) {
+    uint32_t const              shipping = HSR_PERMUTATION_UPSCALE;
+    uint32_t const              debug    = shipping | HSR_PERMUTATION_DEBUG;
+    uint32_t const              native   = 0;
+    MockBackend                 backend;
+    PermutationCache<MockTable> cache;
+    InitCache(cache, backend, requiredBits, true);
+    backend.Open();
+
+    Check(cache.Acquire(shipping).mask == shipping, "first Acquire returns the mask", shipping);
+    backend.Fail(debug, true);
+    Check(cache.Acquire(debug).mask == shipping, "Acquire does not fall back while the mask builds", debug);
+    while (cache.GetPendingCount()) {
+        std::this_thread::yield();
+        cache.Update();
+    }
+    Check(!cache.IsReady(debug) && cache.IsFailed(debug), "failed build not recorded", debug);
+    Check(cache.Acquire(debug).mask == shipping, "Acquire does not fall back after a failed build", debug);
+    Check(!cache.IsPending(debug) && backend.GetAttempts(debug) == 1, "failed build retried before a Rebuild", debug);
+
+    // Nothing compatible to return, the failure reaches the caller
+    backend.Fail(native, true);
+    bool thrown = false;
+    try {
+        cache.Acquire(native);
+    } catch (...) {
+        thrown = true;
+    }
+    Check(thrown && !cache.IsReady(native), "failed build without a fallback returns a table", native);
+
+    backend.Fail(debug, false);
+    backend.Fail(native, false);
+    cache.Rebuild();
+    Check(!cache.IsFailed(debug) && cache.Acquire(native).mask == native, "Rebuild does not retry failed builds", native);
+    cache.Acquire(debug);
+    while (cache.GetPendingCount()) {
+        std::this_thread::yield();
+        cache.Update();
+    }
+    Check(cache.Acquire(debug).mask == debug, "failed build not retried after a Rebuild", debug);
+    cache.Clear();
+    for (uint32_t mask : {shipping, debug, native}) Check(backend.GetDestroys(mask) == 1, "not released once", mask);
+}
+
+int main(int argc, char **argv) {
+    uint32_t trials = 2000, seed = 1, requiredBits = HSR_PERMUTATION_REQUIRED_BITS;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--trials") && hasValue)
+            trials = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+            seed = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--no-required-bits"))
+            requiredBits = 0;
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    CheckKeys();
+    uint32_t fallbacks = 0, blocking = 0;
+    CheckFallbacks(trials, seed, requiredBits, fallbacks, blocking);
+    CheckAsync(requiredBits);
+    CheckFailedBuilds(requiredBits);
+    printf("%u masks, required bits 0x%02x\n", uint32_t(HSR_PERMUTATION_COUNT), requiredBits);
+    printf("%u trials: %u fell back, %u waited without a compatible permutation, %u failed checks\n", trials, fallbacks, blocking, s_failures);
+    return s_failures ? 1 : 0;
+}
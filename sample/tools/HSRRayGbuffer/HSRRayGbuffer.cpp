@@ -0,0 +1,217 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Round trips random hits through both layouts of the ray GBuffer (Shaders/RayGbuffer.h) and checks the largest
+// decoding error of every field against the precision of its encoding:
+// - normal/material word: octahedral u and v within half a step of 1/255, normals within the angle that half a step
+//   can move them (0.95 degrees), material id and skip bit exact;
+// - default layout: uv within the rounding of fp16, ray length exact;
+// - compact layout: uv within half a step of 1/2048 on the wrapped [0, 1) circle, ray length within 2^-7 relative
+//   error on [2^-7, 2^9) and clamped outside of it, and every code decodes to a length that encodes back to it.
+// The normal error of the truncating encoding the default layout used before is printed for reference.
+//
+// Usage: HSRRayGbuffer [--samples 1000000] [--seed 1]
+//
+// The exit code is 1 if an error is larger than its bound, 2 on usage errors.
+
+#include "../../src/Shaders/RayGbuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace RayGbufferCodec;
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRRayGbuffer [--samples 1000000] [--seed 1]\n"); }
+
+static uint32_t s_failures = 0;
+
+static void Check(bool condition, char const *pWhat, double value, double bound) {
+    if (condition) return;
+    if (s_failures < 10) fprintf(stderr, "%s: %g, bound %g\n", pWhat, value, bound);
+    s_failures++;
+}
+
+struct Float3 {
+    float x, y, z;
+};
+
+// C++ twins of OctahedronUV and UVtoOctahedron in Common.hlsl.
+static void OctahedronUV(Float3 n, float &u, float &v) {
+    float const l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    float       x = n.x / l1, y = n.y / l1;
+    if (n.z <= 0.0f) {
+        float const ox = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float const oy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = ox, y = oy;
+    }
+    u = x * 0.5f + 0.5f;
+    v = y * 0.5f + 0.5f;
+}
+
+static Float3 UVtoOctahedron(float u, float v) {
+    float x = 2.0f * (u - 0.5f), y = 2.0f * (v - 0.5f);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float const l = std::sqrt(x * x + y * y + z * z);
+    return {x / l, y / l, z / l};
+}
+
+static double AngleDegrees(Float3 a, Float3 b) {
+    double const d = double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z;
+    return std::acos(std::min(1.0, std::max(-1.0, d))) * 180.0 / 3.14159265358979;
+}
+
+// f32tof16 and f16tof32 of the default layout, round to nearest even as the GPU conversion does.
+static uint32_t F32ToF16(float f) {
+    uint32_t const bits = asuint(f);
+    uint32_t const sign = (bits >> 16) & 0x8000u;
+    uint32_t const abs = bits & 0x7fffffffu;
+    if (abs >= 0x47800000u) return sign | 0x7c00u; // overflow to infinity, the uvs never get there
+    if (abs < 0x38800000u) {                       // fp16 denormal
+        float const scaled = asfloat(abs) * 16777216.0f; // * 2^24, exact
+        return sign | uint32_t(std::nearbyint(scaled));
+    }
+    uint32_t const mantissa = abs & 0x1fffu;
+    uint32_t       half = (abs - 0x38000000u) >> 13;
+    if (mantissa > 0x1000u || (mantissa == 0x1000u && (half & 1u))) half++;
+    return sign | half;
+}
+
+static float F16ToF32(uint32_t h) {
+    float const magnitude = (h & 0x7c00u) ? asfloat((((h & 0x7fffu) >> 10) + 112u) << 23 | (h & 0x3ffu) << 13) : float(h & 0x3ffu) / 16777216.0f;
+    return (h & 0x8000u) ? -magnitude : magnitude;
+}
+
+static double WrappedDistance(float a, float b) {
+    double const d = std::fabs(double(a) - double(b));
+    return std::min(d, 1.0 - d);
+}
+
+int main(int argc, char **argv) {
+    uint32_t samples = 1000000, seed = 1;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--samples") && hasValue)
+            samples = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+            seed = uint32_t(atoi(argv[++i]));
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (samples == 0) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::mt19937                          rng(seed);
+    std::normal_distribution<float>       gaussian;
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> texcoord(-4.0f, 4.0f);
+    std::uniform_int_distribution<uint>   material(0u, 0x7fffu);
+
+    // Half a step of 1/255 moves x and y of the point on the octahedron by up to 1/255 and z by up to 2/255, so by
+    // sqrt(6) / 255. Seen from the origin, that is the largest angle at the face centers, 1 / sqrt(3) away.
+    // u * 255 + 0.5 is rounded to float before the truncation, which can cross a half step by an ulp of 1.
+    double const octahedralBound = 0.5 / 255.0 + 1.0 / 8388608.0;
+    double const angleBound = std::asin(std::sqrt(18.0) / 255.0) * 180.0 / 3.14159265358979 * (1.0 + 1e-5);
+    double const uvBound = 0.5 / 2048.0 * (1.0 + 1e-5);
+    double const lengthBound = 1.0 / 128.0 * (1.0 + 1e-5);
+    float const  lengthMin = asfloat(FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_MIN_BITS);
+    float const  lengthMax = FFX_Reflections_DecodeRayGbufferLength((1u << FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_BITS) - 1u);
+
+    double maxOctahedral = 0.0, maxAngle = 0.0, maxTruncatedAngle = 0.0, maxHalfError = 0.0, maxUVError = 0.0, maxLengthError = 0.0;
+    for (uint32_t i = 0; i < samples; i++) {
+        Float3 n = {gaussian(rng), gaussian(rng), gaussian(rng)};
+        float  l = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+        if (l < 1e-6f) continue;
+        n = {n.x / l, n.y / l, n.z / l};
+        float u, v;
+        OctahedronUV(n, u, v);
+        uint const id = material(rng);
+        bool const skip = (i & 7u) == 0u;
+
+        // Normal/material word, shared by both layouts.
+        uint const   pack = FFX_Reflections_PackRayGbufferNormalMaterial(u, v, id, skip);
+        float const  du = FFX_Reflections_RayGbufferOctahedralU(pack), dv = FFX_Reflections_RayGbufferOctahedralV(pack);
+        double const octahedral = std::max(std::fabs(double(du) - u), std::fabs(double(dv) - v));
+        double const angle = AngleDegrees(n, UVtoOctahedron(du, dv));
+        Check(octahedral <= octahedralBound, "octahedral uv error", octahedral, octahedralBound);
+        Check(angle <= angleBound, "normal error in degrees", angle, angleBound);
+        Check(FFX_Reflections_RayGbufferMaterialId(pack) == id, "material id", FFX_Reflections_RayGbufferMaterialId(pack), id);
+        Check(FFX_Reflections_RayGbufferIsSkip(pack) == skip, "skip bit", FFX_Reflections_RayGbufferIsSkip(pack), skip);
+        maxOctahedral = std::max(maxOctahedral, octahedral);
+        maxAngle = std::max(maxAngle, angle);
+        Float3 const truncated = UVtoOctahedron(float(uint(255.0f * u)) / 255.0f, float(uint(255.0f * v)) / 255.0f);
+        maxTruncatedAngle = std::max(maxTruncatedAngle, AngleDegrees(n, truncated));
+
+        // Default layout: uv as fp16, length as fp32.
+        float const tu = texcoord(rng), tv = texcoord(rng);
+        for (float t : {tu, tv}) {
+            double const error = std::fabs(double(F16ToF32(F32ToF16(t))) - t);
+            double const bound = std::max(std::fabs(double(t)) / 2048.0, 1.0 / 16777216.0) * (1.0 + 1e-5); // half an ulp
+            Check(error <= bound, "fp16 uv error", error, bound);
+            maxHalfError = std::max(maxHalfError, error / std::max(std::fabs(double(t)), 1.0 / 16384.0));
+        }
+
+        // Compact layout: wrapped uv and log2 ray length.
+        float const  rayLength = std::exp2(-7.0f + 16.0f * unit(rng)); // [2^-7, 2^9)
+        uint const   compact = FFX_Reflections_PackCompactRayGbufferUVLength(tu, tv, rayLength);
+        double const uvError = std::max(WrappedDistance(FFX_Reflections_CompactRayGbufferU(compact), frac(tu)),
+                                        WrappedDistance(FFX_Reflections_CompactRayGbufferV(compact), frac(tv)));
+        double const lengthError = std::fabs(double(FFX_Reflections_CompactRayGbufferLength(compact)) - rayLength) / rayLength;
+        Check(uvError <= uvBound, "compact uv error", uvError, uvBound);
+        Check(lengthError <= lengthBound, "compact ray length relative error", lengthError, lengthBound);
+        maxUVError = std::max(maxUVError, uvError);
+        maxLengthError = std::max(maxLengthError, lengthError);
+    }
+
+    // Lengths outside of the range clamp to its ends, 0 and negative lengths to the lower one.
+    for (float outside : {0.0f, -1.0f, lengthMin * 0.25f, lengthMin * 0.999f})
+        Check(FFX_Reflections_DecodeRayGbufferLength(FFX_Reflections_EncodeRayGbufferLength(outside)) == lengthMin, "length below the range", outside, lengthMin);
+    for (float outside : {512.0f, 1000.0f, 1e30f})
+        Check(FFX_Reflections_DecodeRayGbufferLength(FFX_Reflections_EncodeRayGbufferLength(outside)) == lengthMax, "length above the range", outside, lengthMax);
+    for (uint code = 0; code < (1u << FFX_REFLECTIONS_RAY_GBUFFER_LENGTH_BITS); code++)
+        Check(FFX_Reflections_EncodeRayGbufferLength(FFX_Reflections_DecodeRayGbufferLength(code)) == code, "length code does not round trip", code, code);
+    for (uint code = 0; code < (1u << FFX_REFLECTIONS_RAY_GBUFFER_UV_BITS); code++)
+        Check(FFX_Reflections_EncodeRayGbufferUV(FFX_Reflections_DecodeRayGbufferUV(code)) == code, "uv code does not round trip", code, code);
+    for (uint code = 0; code < 256u; code++) {
+        uint const pack = FFX_Reflections_PackRayGbufferNormalMaterial(float(code) / 255.0f, float(255u - code) / 255.0f, 0u, false);
+        Check((pack & 0xffffu) == (code | (255u - code) << 8), "octahedral code does not round trip", pack & 0xffffu, code | (255u - code) << 8);
+    }
+
+    printf("%u samples\n", samples);
+    printf("normal/material: octahedral uv %.6f (bound %.6f), normal %.3f degrees (bound %.3f, %.3f truncating)\n", maxOctahedral, octahedralBound, maxAngle,
+           angleBound, maxTruncatedAngle);
+    printf("default:         uv %.2e relative (bound %.2e), ray length exact\n", maxHalfError, 1.0 / 2048.0);
+    printf("compact:         uv %.6f (bound %.6f), ray length %.4f relative (bound %.4f) in [%g, %g]\n", maxUVError, uvBound, maxLengthError, lengthBound, lengthMin,
+           lengthMax);
+    printf("%u failed checks\n", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,248 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Checks the shader hot reload (ShaderDependencyGraph.h) without a GPU:
+// - the include parser on directives with comments, angle brackets and odd spacing;
+// - include resolution and the transitive dependencies on an in-memory copy of the sample's include layout, with a
+//   cycle and a missing include;
+// - which roots the change detector reports when single files are touched, gain or lose includes, or disappear,
+//   against the roots whose dependencies contain the file.
+// With --shaders, the sample's shader directory is copied to a temporary directory, every .hlsl file is tracked and
+// each file in turn is touched on disk, checking the same.
+//
+// Usage: HSRShaderReload [--shaders sample/src/Shaders]
+//
+// The exit code is 1 if a check fails, 2 on usage errors.
+
+#include "ShaderDependencyGraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRShaderReload [--shaders sample/src/Shaders]\n"); }
+
+static uint32_t s_failures = 0;
+
+static void Check(bool condition, char const *pWhat, std::string const &detail) {
+    if (condition) return;
+    if (s_failures < 10) fprintf(stderr, "%s: %s\n", pWhat, detail.c_str());
+    s_failures++;
+}
+
+static std::string Join(std::vector<std::string> const &items) {
+    std::string joined;
+    for (auto const &item : items) joined += (joined.empty() ? "" : ", ") + item;
+    return joined;
+}
+
+// Files held in memory, every write bumps the stamp of the file.
+class MemoryFileSystem {
+public:
+    void Write(std::string const &path, std::string const &contents) {
+        m_files[path] = contents;
+        m_stamps[path] = ++m_clock;
+    }
+    void Remove(std::string const &path) {
+        m_files.erase(path);
+        m_stamps.erase(path);
+    }
+    ShaderFileSystem Get() {
+        ShaderFileSystem fs;
+        fs.read = [this](std::string const &path, std::string &contents) {
+            auto it = m_files.find(path);
+            if (it == m_files.end()) return false;
+            contents = it->second;
+            return true;
+        };
+        fs.stamp = [this](std::string const &path) -> uint64_t {
+            auto it = m_stamps.find(path);
+            return it == m_stamps.end() ? 0 : it->second;
+        };
+        return fs;
+    }
+
+private:
+    std::map<std::string, std::string> m_files;
+    std::map<std::string, uint64_t>    m_stamps;
+    uint64_t                           m_clock = 0;
+};
+
+static void CheckParser() {
+    std::string const source = "#include \"A.h\"\n"
+                               "  #  include   <B.h>\n"
+                               "// #include \"Commented.h\"\n"
+                               "/* #include \"Block.h\"\n"
+                               "   #include \"StillBlock.h\" */ #include \"AfterBlock.h\"\n"
+                               "#include \"C.h\" // trailing comment\n"
+                               "#define include \"NotAnInclude.h\"\n"
+                               "#include \"Unterminated.h\n"
+                               "#include \"sub/D.h\"";
+    std::vector<std::string> const expected = {"A.h", "B.h", "AfterBlock.h", "C.h", "sub/D.h"};
+    std::vector<std::string> const parsed   = ShaderDependencyGraph::ParseIncludes(source);
+    Check(parsed == expected, "ParseIncludes", Join(parsed));
+}
+
+// Roots and the files each one depends on, to compare with what the detector reports.
+static std::vector<std::string> RootsDependingOn(ShaderDependencyGraph &graph, std::vector<std::string> const &roots, std::string const &file) {
+    std::vector<std::string> depending;
+    for (auto const &root : roots) {
+        std::set<std::string> const &dependencies = graph.GetDependencies(root);
+        if (dependencies.find(file) != dependencies.end()) depending.push_back(root);
+    }
+    return depending;
+}
+
+static void CheckMemory() {
+    // The sample's layout: the shaders next to each other, the FidelityFX headers found through a search path
+    MemoryFileSystem files;
+    files.Write("Shaders/Descriptors.h", "#pragma once\n");
+    files.Write("Shaders/Declarations.h", "#include \"Descriptors.h\"\n");
+    files.Write("Shaders/Common.hlsl", "#include \"ffx_denoiser_reflections_common.h\"\n");
+    files.Write("Shaders/RTShading.h", "#include \"LightList.h\"\n#include \"Missing.h\"\n");
+    files.Write("Shaders/LightList.h", "#pragma once\n");
+    files.Write("Shaders/Intersect.hlsl", "#include \"Declarations.h\"\n#include \"Common.hlsl\"\n#include \"RTShading.h\"\n");
+    files.Write("Shaders/ApplyDecals.hlsl", "#include \"Declarations.h\"\n#include \"RTShading.h\"\n");
+    files.Write("Shaders/Reproject.hlsl", "#include \"Declarations.h\"\n#include \"Common.hlsl\"\n");
+    files.Write("Shaders/DrawAtmosphere.hlsl", "#include \"Atmosphere.h\"\n");
+    files.Write("Shaders/Atmosphere.h", "#include \"DrawAtmosphere.hlsl\"\n"); // Cycle
+    files.Write("ffx/ffx_denoiser_reflections_common.h", "#include \"ffx_denoiser_reflections_config.h\"\n");
+    files.Write("ffx/ffx_denoiser_reflections_config.h", "#pragma once\n");
+    // Shadowed by the one next to the includer
+    files.Write("ffx/LightList.h", "#pragma once\n");
+
+    ShaderDependencyGraph graph(files.Get());
+    graph.AddSearchPath("Shaders");
+    graph.AddSearchPath("ffx");
+    Check(graph.Resolve("LightList.h", "Shaders") == "Shaders/LightList.h", "Resolve prefers the includer's directory", graph.Resolve("LightList.h", "Shaders"));
+    Check(graph.Resolve("LightList.h", "ffx") == "ffx/LightList.h", "Resolve prefers the includer's directory", graph.Resolve("LightList.h", "ffx"));
+    Check(graph.Resolve("Missing.h").empty(), "Resolve finds a missing file", graph.Resolve("Missing.h"));
+
+    std::set<std::string> const intersect = {"Shaders/Intersect.hlsl", "Shaders/Declarations.h",           "Shaders/Descriptors.h",
+                                             "Shaders/Common.hlsl",    "ffx/ffx_denoiser_reflections_common.h", "ffx/ffx_denoiser_reflections_config.h",
+                                             "Shaders/RTShading.h",    "Shaders/LightList.h"};
+    auto const &dependencies = graph.GetDependencies("Intersect.hlsl");
+    Check(dependencies == intersect, "GetDependencies(Intersect.hlsl)", Join(std::vector<std::string>(dependencies.begin(), dependencies.end())));
+    Check(graph.GetDependencies("DrawAtmosphere.hlsl").size() == 2, "GetDependencies with a cycle", std::to_string(graph.GetDependencies("DrawAtmosphere.hlsl").size()));
+
+    std::vector<std::string> const roots = {"Intersect.hlsl", "ApplyDecals.hlsl", "Reproject.hlsl", "DrawAtmosphere.hlsl"};
+    ShaderChangeDetector           detector(graph);
+    for (auto const &root : roots) detector.Track(root);
+    Check(detector.Poll().empty(), "Poll without changes", "");
+
+    // Every file alone
+    std::vector<std::string> const all = {"Shaders/Descriptors.h", "Shaders/Declarations.h", "Shaders/Common.hlsl", "Shaders/RTShading.h",
+                                          "Shaders/LightList.h",   "Shaders/Intersect.hlsl", "Shaders/Atmosphere.h", "ffx/ffx_denoiser_reflections_config.h",
+                                          "ffx/LightList.h"};
+    for (auto const &file : all) {
+        std::string contents;
+        files.Get().read(file, contents);
+        files.Write(file, contents);
+        std::vector<std::string> const expected = RootsDependingOn(graph, roots, file);
+        std::vector<std::string> const polled   = detector.Poll();
+        Check(polled == expected, ("touching " + file).c_str(), Join(polled));
+        Check(detector.Poll().empty(), "Poll reports a change twice", file);
+    }
+
+    // A new include is watched from the change that adds it
+    files.Write("Shaders/Metrics.h", "#pragma once\n");
+    files.Write("Shaders/Reproject.hlsl", "#include \"Declarations.h\"\n#include \"Common.hlsl\"\n#include \"Metrics.h\"\n");
+    Check(detector.Poll() == std::vector<std::string>{"Reproject.hlsl"}, "adding an include", "Reproject.hlsl");
+    files.Write("Shaders/Metrics.h", "#pragma once\n// Changed\n");
+    Check(detector.Poll() == std::vector<std::string>{"Reproject.hlsl"}, "touching a new include", "Shaders/Metrics.h");
+    // A dropped include is not
+    files.Write("Shaders/ApplyDecals.hlsl", "#include \"Declarations.h\"\n");
+    Check(detector.Poll() == std::vector<std::string>{"ApplyDecals.hlsl"}, "dropping an include", "ApplyDecals.hlsl");
+    files.Write("Shaders/RTShading.h", "#include \"LightList.h\"\n");
+    Check(detector.Poll() == std::vector<std::string>{"Intersect.hlsl"}, "touching a dropped include", "Shaders/RTShading.h");
+    // A file that appears where an include used to miss, and one that disappears
+    files.Write("Shaders/Missing.h", "#pragma once\n");
+    files.Write("Shaders/RTShading.h", "#include \"LightList.h\"\n#include \"Missing.h\"\n");
+    Check(detector.Poll() == std::vector<std::string>{"Intersect.hlsl"}, "adding a missing include", "Shaders/Missing.h");
+    files.Remove("Shaders/Missing.h");
+    Check(detector.Poll() == std::vector<std::string>{"Intersect.hlsl"}, "removing an include", "Shaders/Missing.h");
+}
+
+// Touches every file of a copy of the shader directory on disk.
+static void CheckDisk(std::string const &shaders) {
+    std::error_code ec;
+    fs::path const  copy = fs::temp_directory_path() / "HSRShaderReload";
+    fs::remove_all(copy, ec);
+    fs::copy(shaders, copy, fs::copy_options::recursive, ec);
+    if (ec) {
+        Check(false, "copying the shaders", ec.message());
+        return;
+    }
+
+    ShaderDependencyGraph graph;
+    graph.AddSearchPath(copy.generic_string());
+    std::vector<std::string> roots, files;
+    for (auto const &entry : fs::directory_iterator(copy)) {
+        if (!entry.is_regular_file()) continue;
+        std::string const name = entry.path().filename().generic_string();
+        files.push_back(entry.path().lexically_normal().generic_string());
+        if (entry.path().extension() == ".hlsl") roots.push_back(name);
+    }
+    std::sort(roots.begin(), roots.end());
+    std::sort(files.begin(), files.end());
+    ShaderChangeDetector detector(graph);
+    size_t               dependencies = 0;
+    for (auto const &root : roots) {
+        detector.Track(root);
+        dependencies += graph.GetDependencies(root).size();
+    }
+
+    auto const stamped = fs::last_write_time(files.front());
+    for (size_t i = 0; i < files.size(); i++) {
+        // Later than anything written so far, whatever the resolution of the file times
+        fs::last_write_time(files[i], stamped + std::chrono::hours(1 + i), ec);
+        std::vector<std::string> const expected = RootsDependingOn(graph, roots, files[i]);
+        std::vector<std::string> const polled   = detector.Poll();
+        Check(!ec && polled == expected, ("touching " + files[i]).c_str(), Join(polled));
+    }
+    printf("%s: %zu roots, %zu files, %.1f dependencies per root\n", shaders.c_str(), roots.size(), files.size(), roots.empty() ? 0.0 : double(dependencies) / roots.size());
+    fs::remove_all(copy, ec);
+}
+
+int main(int argc, char **argv) {
+    std::string shaders;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--shaders") && hasValue)
+            shaders = argv[++i];
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    CheckParser();
+    CheckMemory();
+    if (!shaders.empty()) CheckDisk(shaders);
+    printf("%u failed checks\n", s_failures);
+    return s_failures ? 1 : 0;
+}
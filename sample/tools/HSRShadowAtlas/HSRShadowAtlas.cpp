@@ -0,0 +1,144 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Runs the shadow atlas allocator (ShadowAtlas.h) on a camera flying past a field of spot lights plus the sun, with
+// lights switching on and off along the way. Every frame checks that the tiles are power of two squares aligned to
+// their size, inside the atlas and not overlapping, that the packed Light::shadowMapIndex decodes back to the tile and
+// that an unchanged frame keeps the layout. Prints how often the atlas was repacked and the memory against the 32
+// fixed 4096x4096 maps it replaces.
+//
+// Usage: HSRShadowAtlas [--frames 600] [--lights 32] [--atlas 8192] [--min-tile 256] [--hysteresis 0.25] [--toggle-every 60]
+//
+// The exit code is 1 if a check fails, 2 on usage errors.
+
+#include "ShadowAtlas.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void PrintUsage() {
+    fprintf(stderr, "Usage: HSRShadowAtlas [--frames 600] [--lights 32] [--atlas 8192] [--min-tile 256] [--hysteresis 0.25] [--toggle-every 60]\n");
+}
+
+static bool CheckLayout(ShadowAtlas const &atlas, uint32_t frame) {
+    using namespace ShadowAtlasModel;
+    ShadowAtlas::Config const &      config = atlas.GetConfig();
+    std::vector<ShadowAtlas::Tile> const &tiles  = atlas.GetTiles();
+    for (size_t i = 0; i < tiles.size(); i++) {
+        ShadowAtlas::Tile const &tile = tiles[i];
+        bool                     ok   = tile.size >= config.minTileSize && tile.size <= config.maxTileSize && (tile.size & (tile.size - 1)) == 0 &&
+                  tile.x % tile.size == 0 && tile.y % tile.size == 0 && tile.x + tile.size <= config.atlasSize && tile.y + tile.size <= config.atlasSize &&
+                  (config.atlasSize >> tile.level) == tile.size;
+        int packed = tile.Pack();
+        ok         = ok && packed >= 0 && ShadowAtlas_TileX(packed) * tile.size == tile.x && ShadowAtlas_TileY(packed) * tile.size == tile.y &&
+             ShadowAtlas_TileLevel(packed) == tile.level;
+        if (!ok) {
+            fprintf(stderr, "frame %u: bad tile for light %u at %u,%u size %u level %u\n", frame, tile.id, tile.x, tile.y, tile.size, tile.level);
+            return false;
+        }
+        for (size_t j = 0; j < i; j++) {
+            ShadowAtlas::Tile const &other = tiles[j];
+            if (tile.x < other.x + other.size && other.x < tile.x + tile.size && tile.y < other.y + other.size && other.y < tile.y + tile.size) {
+                fprintf(stderr, "frame %u: tiles of lights %u and %u overlap\n", frame, tile.id, other.id);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t            frames      = 600;
+    uint32_t            lights      = 32;
+    uint32_t            toggleEvery = 60;
+    ShadowAtlas::Config config;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && hasValue)
+            frames = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--lights") && hasValue)
+            lights = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--atlas") && hasValue)
+            config.atlasSize = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--min-tile") && hasValue)
+            config.minTileSize = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--hysteresis") && hasValue)
+            config.hysteresis = float(atof(argv[++i]));
+        else if (!strcmp(argv[i], "--toggle-every") && hasValue)
+            toggleEvery = uint32_t(atoi(argv[++i]));
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    bool powerOfTwo = config.atlasSize && config.minTileSize && (config.atlasSize & (config.atlasSize - 1)) == 0 &&
+                      (config.minTileSize & (config.minTileSize - 1)) == 0;
+    if (!frames || !lights || !powerOfTwo || config.minTileSize > config.atlasSize) {
+        PrintUsage();
+        return 2;
+    }
+    if (config.maxTileSize > config.atlasSize) config.maxTileSize = config.atlasSize;
+    if (config.maxTileSize < config.minTileSize) config.maxTileSize = config.minTileSize;
+
+    ShadowAtlas atlas;
+    atlas.Init(config);
+
+    // Light 0 is the sun, the spots sit every 10 m along the path of the camera, 3 m to its side, with a 15 m range.
+    float const tanHalfFovY = std::tan(0.5f * 1.0472f);
+    float const aspect      = 16.0f / 9.0f;
+    uint32_t    repacks     = 0;
+    uint32_t    maxDropped  = 0;
+    uint64_t    maxUsed     = 0;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        float const                       cameraZ = float(frame) * 0.5f;
+        std::vector<ShadowAtlas::Request> requests;
+        requests.push_back({0, 1.0f, 1.0f});
+        for (uint32_t i = 1; i < lights; i++) {
+            // Every 'toggleEvery' frames one light switches, which changes the set of lights.
+            if (toggleEvery && (frame / toggleEvery) % lights == i && (frame / toggleEvery) % 2) continue;
+            float const dz       = float(i) * 10.0f - std::fmod(cameraZ, float(lights) * 10.0f);
+            float const distance = std::sqrt(dz * dz + 9.0f);
+            float const coverage = EstimateShadowScreenCoverage(distance, 15.0f, tanHalfFovY, aspect);
+            requests.push_back({i, coverage, 0.25f + 0.75f * float(i % 4) / 3.0f});
+        }
+        if (atlas.Update(requests.data(), requests.size())) repacks++;
+        if (!CheckLayout(atlas, frame)) return 1;
+        if (atlas.Update(requests.data(), requests.size())) {
+            fprintf(stderr, "frame %u: the same requests changed the layout\n", frame);
+            return 1;
+        }
+        if (atlas.GetDropped() > maxDropped) maxDropped = atlas.GetDropped();
+        if (atlas.GetUsedTexels() > maxUsed) maxUsed = atlas.GetUsedTexels();
+    }
+
+    double const atlasMB = double(config.atlasSize) * config.atlasSize * 4 / (1024.0 * 1024.0);
+    double const fixedMB = 32.0 * 4096.0 * 4096.0 * 4 / (1024.0 * 1024.0);
+    printf("%u frames, %u lights: repacked %u times, at most %u lights without shadow\n", frames, lights, repacks, maxDropped);
+    printf("atlas %ux%u, at most %.1f%% in use\n", config.atlasSize, config.atlasSize,
+           100.0 * double(maxUsed) / (double(config.atlasSize) * config.atlasSize));
+    printf("memory: %.0f MB, was %.0f MB for 32 4096x4096 maps\n", atlasMB, fixedMB);
+    for (ShadowAtlas::Tile const &tile : atlas.GetTiles()) printf("  light %2u: %4ux%-4u at %4u,%4u\n", tile.id, tile.size, tile.size, tile.x, tile.y);
+    return 0;
+}
@@ -0,0 +1,178 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Scripts lights and shadow casters over a run of frames and feeds them to the shadow cache (ShadowCache.h). Spot lights
+// look down on a field of static boxes, a few boxes drive in circles, a few are animated in place like skinned meshes and
+// one disappears now and then. Every frame, each light the cache keeps has to see exactly what it saw when its map was
+// last rendered: the same tile, view projection and casters with the same bounds, and no animated caster. Prints how
+// many maps were rendered against rendering every light every frame.
+//
+// Usage: HSRShadowCache [--frames 600] [--lights 16] [--casters 400] [--moving 4] [--animated 2] [--move-light-at F]
+//                       [--repack-at F] [--forget-animated]
+//
+// --forget-animated leaves the animated flag off, the run then passes only if a light keeps a stale map.
+// The exit code is 1 if a light keeps a stale map, 2 on usage errors.
+
+#include "ShadowCache.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void PrintUsage() {
+    fprintf(stderr, "Usage: HSRShadowCache [--frames 600] [--lights 16] [--casters 400] [--moving 4] [--animated 2] [--move-light-at F] [--repack-at F] "
+                    "[--forget-animated]\n");
+}
+
+// Spot light 10 m above (x, z) looking straight down, 90 degree cone, 0.1 to 20 m.
+static ShadowCache::Light MakeLight(uint32_t id, int tile, float x, float z) {
+    float const near = 0.1f, far = 20.0f, height = 10.0f;
+    float const a            = far / (far - near);
+    float const viewProj[16] = {
+        1.0f, 0.0f,  0.0f, -x,                  // x
+        0.0f, 0.0f,  1.0f, -z,                  // y
+        0.0f, -a,    0.0f, (height - near) * a, // z
+        0.0f, -1.0f, 0.0f, height,              // w, distance below the light
+    };
+    ShadowCache::Light light;
+    light.id   = id;
+    light.tile = tile;
+    memcpy(light.viewProj, viewProj, sizeof(viewProj));
+    return light;
+}
+
+// What a shadow map was rendered from.
+struct Content {
+    int                   tile;
+    float                 viewProj[16];
+    std::vector<uint32_t> ids;
+    std::vector<float>    bounds;
+    bool                  animated;
+};
+
+static Content Capture(ShadowCache::Light const &light, std::vector<ShadowCache::Caster> const &casters) {
+    Content content;
+    content.tile     = light.tile;
+    content.animated = false;
+    memcpy(content.viewProj, light.viewProj, sizeof(content.viewProj));
+    for (ShadowCache::Caster const &caster : casters) {
+        if (!ShadowFrustumOverlapsBox(light.viewProj, caster.boundsMin, caster.boundsMax)) continue;
+        content.ids.push_back(caster.id);
+        content.bounds.insert(content.bounds.end(), caster.boundsMin, caster.boundsMin + 3);
+        content.bounds.insert(content.bounds.end(), caster.boundsMax, caster.boundsMax + 3);
+        content.animated |= caster.animated;
+    }
+    return content;
+}
+
+static bool Same(Content const &a, Content const &b) {
+    return a.tile == b.tile && !memcmp(a.viewProj, b.viewProj, sizeof(a.viewProj)) && a.ids == b.ids && a.bounds == b.bounds && !a.animated && !b.animated;
+}
+
+int main(int argc, char **argv) {
+    uint32_t frames = 600, lights = 16, casters = 400, moving = 4, animated = 2;
+    uint32_t moveLightAt = ~0u, repackAt = ~0u;
+    bool     forgetAnimated = false;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && hasValue)
+            frames = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--lights") && hasValue)
+            lights = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--casters") && hasValue)
+            casters = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--moving") && hasValue)
+            moving = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--animated") && hasValue)
+            animated = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--move-light-at") && hasValue)
+            moveLightAt = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--repack-at") && hasValue)
+            repackAt = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--forget-animated"))
+            forgetAnimated = true;
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (!frames || !lights || moving + animated + 1 > casters) {
+        PrintUsage();
+        return 2;
+    }
+
+    // Lights on a 15 m grid, boxes scattered over the same area. The first 'moving' boxes drive in circles, the next
+    // 'animated' ones are animated in place and the last one vanishes every other 50 frames.
+    uint32_t const grid = uint32_t(std::ceil(std::sqrt(float(lights))));
+    float const    area = float(grid) * 15.0f;
+    srand(1);
+    std::vector<float> home(casters * 2);
+    for (float &v : home) v = float(rand()) / float(RAND_MAX) * area;
+
+    ShadowCache          cache;
+    std::vector<Content> rendered(lights);
+    uint64_t             renderCount = 0;
+    uint32_t             stale       = 0;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        std::vector<ShadowCache::Light> frameLights;
+        for (uint32_t i = 0; i < lights; i++) {
+            float x = (float(i % grid) + 0.5f) * 15.0f, z = (float(i / grid) + 0.5f) * 15.0f;
+            if (frame >= moveLightAt && i == 0) x += 1.0f;
+            frameLights.push_back(MakeLight(i, int(i) + (frame >= repackAt ? 100 : 0), x, z));
+        }
+        std::vector<ShadowCache::Caster> frameCasters;
+        for (uint32_t i = 0; i < casters; i++) {
+            if (i == casters - 1 && (frame / 50) % 2) continue;
+            float x = home[i * 2], z = home[i * 2 + 1];
+            if (i < moving) {
+                x += 5.0f * std::cos(float(frame) * 0.02f + float(i));
+                z += 5.0f * std::sin(float(frame) * 0.02f + float(i));
+            }
+            ShadowCache::Caster caster = {i, {x - 0.5f, 0.0f, z - 0.5f}, {x + 0.5f, 1.0f, z + 0.5f}, i >= moving && i < moving + animated};
+            frameCasters.push_back(caster);
+        }
+
+        std::vector<ShadowCache::Caster> told = frameCasters;
+        if (forgetAnimated)
+            for (ShadowCache::Caster &caster : told) caster.animated = false;
+        cache.Update(frameLights.data(), frameLights.size(), told.data(), told.size());
+
+        for (uint32_t i = 0; i < lights; i++) {
+            Content content = Capture(frameLights[i], frameCasters);
+            if (cache.IsDirty(i)) {
+                rendered[i] = content;
+                renderCount++;
+            } else if (!Same(rendered[i], content)) {
+                if (!stale) fprintf(stderr, "frame %u: light %u keeps a stale shadow map\n", frame, i);
+                stale++;
+            }
+        }
+    }
+
+    uint64_t const naive = uint64_t(frames) * lights;
+    printf("%u frames, %u lights, %u casters (%u moving, %u animated)\n", frames, lights, casters, moving, animated);
+    printf("shadow maps rendered: %llu of %llu (%.1f%%), %u stale\n", (unsigned long long)renderCount, (unsigned long long)naive,
+           100.0 * double(renderCount) / double(naive), stale);
+    return (stale != 0) != forgetAnimated ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+/**********************************************************************
+Copyright (c) 2021 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+// Benchmarks the per light culling of shadow casters (ShadowCulling.h) on a random scene: boxes scattered over a
+// square, spot lights looking down on it from a grid. Times the scalar test of every box against every light, the SSE2
+// path on one thread and the SSE2 path split over threads, checks that all three find the same boxes and prints how
+// many casters per light the shadow draws would submit against the whole scene.
+//
+// Usage: HSRShadowCulling [--boxes 20000] [--lights 80] [--threads 0] [--iterations 50]
+//
+// The exit code is 1 if the paths disagree, 2 on usage errors.
+
+#include "ShadowCache.h"
+#include "ShadowCulling.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void PrintUsage() { fprintf(stderr, "Usage: HSRShadowCulling [--boxes 20000] [--lights 80] [--threads 0] [--iterations 50]\n"); }
+
+// Spot light 10 m above (x, z) looking straight down, 90 degree cone, 0.1 to 20 m.
+static void MakeViewProj(float x, float z, float viewProj[16]) {
+    float const near = 0.1f, far = 20.0f, height = 10.0f;
+    float const a     = far / (far - near);
+    float const m[16] = {
+        1.0f, 0.0f,  0.0f, -x,                  // x
+        0.0f, 0.0f,  1.0f, -z,                  // y
+        0.0f, -a,    0.0f, (height - near) * a, // z
+        0.0f, -1.0f, 0.0f, height,              // w, distance below the light
+    };
+    memcpy(viewProj, m, sizeof(m));
+}
+
+template <typename FUNCTION> static double MillisecondsPerIteration(uint32_t iterations, FUNCTION const &function) {
+    auto const begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / iterations;
+}
+
+int main(int argc, char **argv) {
+    uint32_t boxCount = 20000, lights = 80, threads = 0, iterations = 50;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--boxes") && hasValue)
+            boxCount = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--lights") && hasValue)
+            lights = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--threads") && hasValue)
+            threads = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--iterations") && hasValue)
+            iterations = uint32_t(atoi(argv[++i]));
+        else {
+            PrintUsage();
+            return 2;
+        }
+    }
+    if (!boxCount || !lights || !iterations) {
+        PrintUsage();
+        return 2;
+    }
+
+    // Lights on a 15 m grid, boxes of 0.2 to 2 m scattered over the same area and up to 5 m high.
+    uint32_t const grid = uint32_t(std::ceil(std::sqrt(float(lights))));
+    float const    area = float(grid) * 15.0f;
+    srand(1);
+    auto const random = [](float scale) { return float(rand()) / float(RAND_MAX) * scale; };
+
+    ShadowCullBoxes boxes;
+    for (uint32_t i = 0; i < boxCount; i++) {
+        float const x = random(area), y = random(5.0f), z = random(area), size = 0.2f + random(1.8f);
+        float const boundsMin[3] = {x - size * 0.5f, y, z - size * 0.5f};
+        float const boundsMax[3] = {x + size * 0.5f, y + size, z + size * 0.5f};
+        boxes.Add(boundsMin, boundsMax);
+    }
+    std::vector<float> viewProjs(lights * 16);
+    for (uint32_t i = 0; i < lights; i++) MakeViewProj((float(i % grid) + 0.5f) * 15.0f, (float(i / grid) + 0.5f) * 15.0f, &viewProjs[i * 16]);
+
+    std::vector<std::vector<uint32_t>> reference(lights), simd, threaded;
+    double const scalarMs = MillisecondsPerIteration(iterations, [&]() {
+        for (uint32_t light = 0; light < lights; light++) {
+            reference[light].clear();
+            for (uint32_t i = 0; i < boxCount; i++) {
+                float const boundsMin[3] = {boxes.minX[i], boxes.minY[i], boxes.minZ[i]};
+                float const boundsMax[3] = {boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]};
+                if (ShadowFrustumOverlapsBox(&viewProjs[light * 16], boundsMin, boundsMax)) reference[light].push_back(i);
+            }
+        }
+    });
+    double const simdMs     = MillisecondsPerIteration(iterations, [&]() { CullShadowCastersForLights(boxes, viewProjs.data(), lights, simd, 1); });
+    double const threadedMs = MillisecondsPerIteration(iterations, [&]() { CullShadowCastersForLights(boxes, viewProjs.data(), lights, threaded, threads, 0); });
+
+    uint64_t visible = 0;
+    for (uint32_t light = 0; light < lights; light++) {
+        if (simd[light] != reference[light] || threaded[light] != reference[light]) {
+            fprintf(stderr, "light %u: the culling paths disagree\n", light);
+            return 1;
+        }
+        visible += reference[light].size();
+    }
+
+    printf("%u boxes, %u lights\n", boxCount, lights);
+    printf("scalar          %8.3f ms\n", scalarMs);
+    printf("SSE2, 1 thread  %8.3f ms  (%.1fx)\n", simdMs, scalarMs / simdMs);
+    printf("SSE2, threaded  %8.3f ms  (%.1fx)\n", threadedMs, scalarMs / threadedMs);
+    printf("casters drawn per light: %.1f of %u (%.2f%%)\n", double(visible) / lights, boxCount, 100.0 * double(visible) / (double(lights) * boxCount));
+    return 0;
+}